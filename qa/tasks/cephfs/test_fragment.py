@@ -227,3 +227,56 @@ class TestFragmentation(CephFSTestCase):
             if o.startswith("{0:x}.".format(dir_inode_no)):
                 frag_objs.append(o)
         self.assertListEqual(frag_objs, [])
+
+    def get_prefetches(self):
+        return self.fs.mds_asok(['perf', 'dump', 'mds'])['mds']['dir_prefetch']
+
+    def _list_cold(self, path, expect):
+        """
+        Restart the MDS so that nothing of the directory is in its cache,
+        then list it from a fresh mount.
+        """
+        self.mount_a.umount_wait()
+        self.mds_cluster.mds_fail_restart()
+        self.fs.wait_for_daemons()
+        self.mount_a.mount()
+        self.mount_a.wait_until_mounted()
+
+        self.assertEqual(self.get_prefetches(), 0)
+        self.assertEqual(sorted(self.mount_a.ls(path)), sorted(expect))
+
+    def test_dir_prefetch(self):
+        """
+        That a readdir of a fragmented directory that is not in cache
+        prefetches the fragments after the one being read, that the
+        listing is still complete, and that mds_dir_prefetch_max=0
+        turns prefetching off.
+        """
+
+        split_size = 100
+        file_count = split_size * 4
+
+        self._configure(
+            mds_bal_split_size=split_size,
+            mds_bal_merge_size=1,
+            mds_bal_split_bits=3,
+            mds_dir_prefetch_max=4
+        )
+
+        self.mount_a.create_n_files("splitdir/file", file_count, sync=True)
+        self.wait_until_true(
+            lambda: self.get_splits() >= 1,
+            timeout=30
+        )
+        frags = self.get_dir_ino("/splitdir")['dirfrags']
+        self.assertGreater(len(frags), 1)
+        self.fs.mds_asok(['flush', 'journal'])
+
+        expect = ["file_{0}".format(i) for i in range(file_count)]
+
+        self._list_cold("splitdir", expect)
+        self.assertGreater(self.get_prefetches(), 0)
+
+        self.ceph_cluster.set_ceph_conf("mds", "mds_dir_prefetch_max", "0")
+        self._list_cold("splitdir", expect)
+        self.assertEqual(self.get_prefetches(), 0)
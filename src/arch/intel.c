@@ -23,6 +23,7 @@ int ceph_arch_intel_ssse3 = 0;
 int ceph_arch_intel_sse3 = 0;
 int ceph_arch_intel_sse2 = 0;
 int ceph_arch_intel_aesni = 0;
+int ceph_arch_intel_avx2 = 0;
 
 #ifdef __x86_64__
 #include <cpuid.h>
@@ -36,6 +37,20 @@ int ceph_arch_intel_aesni = 0;
 #define CPUID_SSE3	(1)
 #define CPUID_SSE2	(1 << 26)
 #define CPUID_AESNI (1 << 25)
+#define CPUID_OSXSAVE	(1 << 27)
+#define CPUID_AVX	(1 << 28)
+
+/* http://en.wikipedia.org/wiki/CPUID#EAX.3D7.2C_ECX.3D0:_Extended_Features */
+
+#define CPUID_AVX2	(1 << 5)
+
+/* the OS must save the ymm registers on context switch, see XCR0 */
+static int ceph_arch_intel_os_avx(void)
+{
+	unsigned int eax, edx;
+	__asm__ volatile ("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+	return (eax & 0x6) == 0x6;
+}
 
 int ceph_arch_intel_probe(void)
 {
@@ -65,6 +80,12 @@ int ceph_arch_intel_probe(void)
   if ((ecx & CPUID_AESNI) != 0) {
           ceph_arch_intel_aesni = 1;
   }
+	if ((ecx & CPUID_OSXSAVE) != 0 && (ecx & CPUID_AVX) != 0 &&
+	    ceph_arch_intel_os_avx() &&
+	    __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) &&
+	    (ebx & CPUID_AVX2) != 0) {
+		ceph_arch_intel_avx2 = 1;
+	}
 
 	return 0;
 }
@@ -495,6 +495,8 @@ void Client::_finish_init()
     plb.add_time_avg(l_c_wrlat, "wrlat", "Latency of a file data write operation");
     plb.add_time_avg(l_c_read, "rdlat", "Latency of a file data read operation");
     plb.add_time_avg(l_c_fsync, "fsync", "Latency of a file sync operation");
+    plb.add_u64_counter(l_c_async_create, "async_create", "Files created without waiting for the MDS");
+    plb.add_u64_counter(l_c_async_unlink, "async_unlink", "Files unlinked without waiting for the MDS");
     logger.reset(plb.create_perf_counters());
     cct->get_perfcounters_collection()->add(logger.get());
   }
@@ -684,6 +686,8 @@ void Client::update_inode_file_size(Inode *in, int issued, uint64_t size,
 {
   uint64_t prior_size = in->size;
 
+  _ll_cache_invalidate(in);
+
   if (truncate_seq > in->truncate_seq ||
       (truncate_seq == in->truncate_seq && size > in->size)) {
     ldout(cct, 10) << "size " << in->size << " -> " << size << dendl;
@@ -727,6 +731,7 @@ void Client::update_inode_file_time(Inode *in, int issued, uint64_t time_warp_se
   ldout(cct, 10) << __func__ << " " << *in << " " << ccap_string(issued)
 		 << " ctime " << ctime << " mtime " << mtime << dendl;
 
+  _ll_cache_invalidate(in);
   if (time_warp_seq > in->time_warp_seq)
     ldout(cct, 10) << " mds time_warp_seq " << time_warp_seq
 		   << " is higher than local time_warp_seq "
@@ -825,6 +830,7 @@ Inode * Client::add_update_inode(InodeStat *st, utime_t from,
     was_new = true;
   }
 
+  _ll_cache_invalidate(in);
   in->rdev = st->rdev;
   if (in->is_symlink())
     in->symlink = st->symlink;
@@ -1785,6 +1791,93 @@ int Client::make_request(MetaRequest *request,
   return r;
 }
 
+/**
+ * Send a request without waiting for the reply.  The caller has already
+ * picked the session; @onfinish is completed with the result on the first
+ * reply, or if the request has to be given up before one arrives.
+ */
+void Client::make_async_request(MetaRequest *request,
+				const UserPerm& perms,
+				MetaSession *session, Context *onfinish)
+{
+  ceph_tid_t tid = ++last_tid;
+  request->set_tid(tid);
+  request->op_stamp = ceph_clock_now();
+
+  mds_requests[tid] = request->get();
+  if (oldest_tid == 0)
+    oldest_tid = tid;
+
+  request->set_caller_perms(perms);
+  request->set_oldest_client_tid(oldest_tid);
+  request->async = true;
+  request->onfinish = onfinish;
+
+  // fsync on the parent (and on the new inode) waits for us
+  Inode *dir = request->inode();
+  if (dir)
+    dir->unsafe_ops.push_back(&request->unsafe_dir_item);
+  if (request->target)
+    request->target->unsafe_ops.push_back(&request->unsafe_target_item);
+
+  ldout(cct, 10) << __func__ << " tid " << tid << " to mds."
+		 << session->mds_num << dendl;
+  send_request(request, session);
+}
+
+/**
+ * An async request was forwarded or needs to be resent; there is no
+ * caller to do it, so do it here if the target mds is ready.
+ */
+void Client::kick_async_request(MetaRequest *req)
+{
+  if (!req->aborted()) {
+    mds_rank_t mds = choose_target_mds(req);
+    int state = (mds == MDS_RANK_NONE) ? MDSMap::STATE_NULL :
+		mdsmap->get_state(mds);
+    if ((state == MDSMap::STATE_ACTIVE || state == MDSMap::STATE_STOPPING) &&
+	have_open_session(mds)) {
+      send_request(req, &mds_sessions.at(mds));
+      return;
+    }
+    ldout(cct, 10) << __func__ << " tid " << req->get_tid() << " mds." << mds
+		   << " not ready, giving up" << dendl;
+    req->abort(-EIO);
+  }
+  finish_async_request(req);
+}
+
+void Client::finish_async_request(MetaRequest *request)
+{
+  int r;
+  if (request->reply) {
+    auto reply = std::move(request->reply);
+    r = reply->get_result();
+    if (r >= 0)
+      request->success = true;
+
+    utime_t lat = ceph_clock_now();
+    lat -= request->sent_stamp;
+    logger->tinc(l_c_lat, lat);
+    logger->tinc(l_c_reply, lat);
+  } else {
+    ceph_assert(request->aborted());
+    r = request->get_abort_code();
+    request->item.remove_myself();
+    request->unsafe_dir_item.remove_myself();
+    request->unsafe_target_item.remove_myself();
+    signal_cond_list(request->waitfor_safe);
+    unregister_request(request);
+  }
+  ldout(cct, 10) << __func__ << " tid " << request->get_tid() << " = " << r
+		 << dendl;
+
+  Context *onfinish = request->onfinish;
+  request->onfinish = nullptr;
+  put_request(request);
+  onfinish->complete(r);
+}
+
 void Client::unregister_request(MetaRequest *req)
 {
   mds_requests.erase(req->tid);
@@ -1839,6 +1932,7 @@ int Client::encode_inode_release(Inode *in, MetaRequest *req,
     if ((drop & cap.issued) &&
 	!(unless & cap.issued)) {
       ldout(cct, 25) << "Dropping caps. Initial " << ccap_string(cap.issued) << dendl;
+      _ll_cache_invalidate(in);
       cap.issued &= ~drop;
       cap.implemented &= ~drop;
       released = 1;
@@ -2012,9 +2106,11 @@ MetaSession *Client::_open_mds_session(mds_rank_t mds)
 {
   ldout(cct, 10) << __func__ << " mds." << mds << dendl;
   auto addrs = mdsmap->get_addrs(mds);
+  std::unique_lock sl{session_lock};
   auto em = mds_sessions.emplace(std::piecewise_construct,
       std::forward_as_tuple(mds),
       std::forward_as_tuple(mds, messenger->connect_to_mds(addrs), addrs));
+  sl.unlock();
   ceph_assert(em.second); /* not already present */
   MetaSession *session = &em.first->second;
 
@@ -2055,6 +2151,7 @@ void Client::_closed_mds_session(MetaSession *s)
   mount_cond.notify_all();
   remove_session_caps(s);
   kick_requests_closed(s);
+  std::unique_lock sl{session_lock};
   mds_sessions.erase(s->mds_num);
 }
 
@@ -2101,8 +2198,10 @@ void Client::handle_client_session(const MConstRef<MClientSession>& m)
   case CEPH_SESSION_RENEWCAPS:
     if (session->cap_renew_seq == m->get_seq()) {
       bool was_stale = ceph_clock_now() >= session->cap_ttl;
+      std::unique_lock sl{session_lock};
       session->cap_ttl =
 	session->last_cap_renew_request + mdsmap->get_session_timeout();
+      sl.unlock();
       if (was_stale)
 	wake_up_session_caps(session, false);
     }
@@ -2110,9 +2209,12 @@ void Client::handle_client_session(const MConstRef<MClientSession>& m)
 
   case CEPH_SESSION_STALE:
     // invalidate session caps/leases
-    session->cap_gen++;
-    session->cap_ttl = ceph_clock_now();
-    session->cap_ttl -= 1;
+    {
+      std::unique_lock sl{session_lock};
+      session->cap_gen++;
+      session->cap_ttl = ceph_clock_now();
+      session->cap_ttl -= 1;
+    }
     renew_caps(session);
     break;
 
@@ -2298,7 +2400,10 @@ void Client::handle_client_request_forward(const MConstRef<MClientRequestForward
   request->item.remove_myself();
   request->num_fwd = fwd->get_num_fwd();
   request->resend_mds = fwd->get_dest_mds();
-  request->caller_cond->notify_all();
+  if (request->async)
+    kick_async_request(request);
+  else
+    request->caller_cond->notify_all();
 }
 
 bool Client::is_dir_operation(MetaRequest *req)
@@ -2353,6 +2458,9 @@ void Client::handle_client_reply(const MConstRef<MClientReply>& reply)
          (it = in->caps.find(request->resend_mds)) != in->caps.end() ||
          request->sent_on_mseq == it->second.mseq)) {
       ldout(cct, 20) << "have to return ESTALE" << dendl;
+    } else if (request->async) {
+      kick_async_request(request);
+      return;
     } else {
       request->caller_cond->notify_all();
       return;
@@ -2361,6 +2469,22 @@ void Client::handle_client_reply(const MConstRef<MClientReply>& reply)
   
   ceph_assert(!request->reply);
   request->reply = reply;
+
+  if (request->get_op() == CEPH_MDS_OP_CREATE && !request->got_unsafe &&
+      session->mds_features.test(CEPHFS_FEATURE_DELEG_INO)) {
+    // the created ino may be followed by more inos for async creates
+    auto p = reply->get_extra_bl().cbegin();
+    if (p.get_remaining() > sizeof(inodeno_t)) {
+      inodeno_t created_ino;
+      interval_set<inodeno_t> delegated;
+      decode(created_ino, p);
+      decode(delegated, p);
+      ldout(cct, 10) << __func__ << " mds." << session->mds_num
+		     << " delegated " << delegated << dendl;
+      session->delegated_inos.union_of(delegated);
+    }
+  }
+
   insert_trace(request, session);
 
   // Handle unsafe reply
@@ -2380,7 +2504,10 @@ void Client::handle_client_reply(const MConstRef<MClientReply>& reply)
 
   // Only signal the caller once (on the first reply):
   // Either its an unsafe reply, or its a safe reply and no unsafe reply was sent.
-  if (!is_safe || !request->got_unsafe) {
+  if (request->async) {
+    if (request->onfinish)
+      finish_async_request(request);
+  } else if (!is_safe || !request->got_unsafe) {
     ceph::condition_variable cond;
     request->dispatch_cond = &cond;
 
@@ -2403,7 +2530,7 @@ void Client::handle_client_reply(const MConstRef<MClientReply>& reply)
   if (is_safe) {
     // the filesystem change is committed to disk
     // we're done, clean up
-    if (request->got_unsafe) {
+    if (request->got_unsafe || request->async) {
       request->unsafe_item.remove_myself();
       request->unsafe_dir_item.remove_myself();
       request->unsafe_target_item.remove_myself();
@@ -2760,6 +2887,8 @@ void Client::send_reconnect(MetaSession *session)
 
   // reset my cap seq number
   session->seq = 0;
+  // the restarted mds does not remember what it delegated
+  session->delegated_inos.clear();
   //connect to the mds' offload targets
   connect_mds_targets(mds);
   //make sure unsafe requests get saved
@@ -2802,6 +2931,7 @@ void Client::send_reconnect(MetaSession *session)
       cap.seq = 0;  // reset seq.
       cap.issue_seq = 0;  // reset seq.
       cap.mseq = 0;  // reset seq.
+      _ll_cache_invalidate(in);
       // cap gen should catch up with session cap_gen
       if (cap.gen < session->cap_gen) {
 	cap.gen = session->cap_gen;
@@ -2922,6 +3052,11 @@ void Client::kick_requests_closed(MetaSession *session)
       if (req->caller_cond) {
 	req->kick = true;
 	req->caller_cond->notify_all();
+      } else if (req->onfinish) {
+	// async request never answered; there is nobody to retry it
+	req->abort(-EIO);
+	finish_async_request(req);
+	continue;
       }
       req->item.remove_myself();
       if (req->got_unsafe) {
@@ -2999,6 +3134,7 @@ void Client::handle_lease(const MConstRef<MClientLease>& m)
     Dentry *dn = in->dir->dentries[m->dname];
     ldout(cct, 10) << " revoked DN lease on " << dn << dendl;
     dn->lease_mds = -1;
+    _ll_cache_invalidate_dentry(in, m->dname);
   }
 
  revoke:
@@ -3019,6 +3155,7 @@ void Client::put_inode(Inode *in, int n)
     remove_all_caps(in);
 
     ldout(cct, 10) << __func__ << " deleting " << *in << dendl;
+    _ll_cache_invalidate(in);
     bool unclean = objectcacher->release_set(&in->oset);
     ceph_assert(!unclean);
     inode_map.erase(in->vino());
@@ -3072,6 +3209,8 @@ Dentry* Client::link(Dir *dir, const string& name, Inode *in, Dentry *dn)
 		   << " dn " << dn << " (old dn)" << dendl;
   }
 
+  _ll_cache_invalidate_dentry(dir->parent_inode, name);
+
   if (in) {    // link to inode
     InodeRef tmp_ref;
     // only one parent for directories!
@@ -3098,6 +3237,8 @@ void Client::unlink(Dentry *dn, bool keepdir, bool keepdentry)
   ldout(cct, 15) << "unlink dir " << dn->dir->parent_inode << " '" << dn->name << "' dn " << dn
 		 << " inode " << dn->inode << dendl;
 
+  _ll_cache_invalidate_dentry(dn->dir->parent_inode, dn->name);
+
   // unlink from inode
   if (dn->inode) {
     dn->unlink();
@@ -3205,6 +3346,9 @@ int Client::get_caps(Inode *in, int need, int want, int *phave, loff_t endoff)
     return r;
 
   while (1) {
+    if (in->async_create_err)
+      return in->async_create_err;
+
     int file_wanted = in->caps_file_wanted();
     if ((file_wanted & need) != need) {
       ldout(cct, 10) << "get_caps " << *in << " need " << ccap_string(need)
@@ -3312,6 +3456,7 @@ void Client::send_cap(Inode *in, MetaSession *session, Cap *cap,
 		      int flags, int used, int want, int retain,
 		      int flush, ceph_tid_t flush_tid)
 {
+  _ll_cache_invalidate(in);
   int held = cap->issued | cap->implemented;
   int revoking = cap->implemented & ~cap->issued;
   retain &= ~revoking;
@@ -3815,6 +3960,7 @@ void Client::wake_up_session_caps(MetaSession *s, bool reconnect)
     } else {
       if (cap->gen < s->cap_gen) {
 	// mds did not re-issue stale cap.
+	_ll_cache_invalidate(&in);
 	cap->issued = cap->implemented = CEPH_CAP_PIN;
 	// make sure mds knows what we want.
 	if (in.caps_file_wanted() & ~cap->wanted)
@@ -3999,6 +4145,7 @@ void Client::add_update_cap(Inode *in, MetaSession *mds_session, uint64_t cap_id
     }
   }
 
+  _ll_cache_invalidate(in);
   mds_rank_t mds = mds_session->mds_num;
   const auto &capem = in->caps.emplace(std::piecewise_construct, std::forward_as_tuple(mds), std::forward_as_tuple(*in, mds_session));
   Cap &cap = capem.first->second;
@@ -4082,6 +4229,7 @@ void Client::remove_cap(Cap *cap, bool queue_release)
   mds_rank_t mds = cap->session->mds_num;
 
   ldout(cct, 10) << __func__ << " mds." << mds << " on " << in << dendl;
+  _ll_cache_invalidate(&in);
   
   if (queue_release) {
     session->enqueue_cap_release(
@@ -4500,6 +4648,7 @@ void Client::early_kick_flushing_caps(MetaSession *session)
     cap->seq = 0;
     cap->issue_seq = 0;
     cap->mseq = 0;
+    _ll_cache_invalidate(in);
     cap->issued = cap->implemented;
 
     kick_flushing_caps(in, session);
@@ -4926,6 +5075,7 @@ void Client::handle_cap_export(MetaSession *session, Inode *in, const MConstRef<
 	    tcap.cap_id = m->peer.cap_id;
 	    tcap.seq = m->peer.seq - 1;
 	    tcap.issue_seq = tcap.seq;
+	    _ll_cache_invalidate(in);
 	    tcap.issued |= cap.issued;
 	    tcap.implemented |= cap.issued;
 	    if (&cap == in->auth_cap)
@@ -5163,6 +5313,8 @@ void Client::handle_cap_grant(MetaSession *session, Inode *in, Cap *cap, const M
   int used = get_caps_used(in);
   int wanted = in->caps_wanted();
 
+  _ll_cache_invalidate(in);
+
   const unsigned new_caps = m->get_caps();
   const bool was_stale = session->cap_gen > cap->gen;
   ldout(cct, 5) << __func__ << " on in " << m->get_ino() 
@@ -5908,6 +6060,8 @@ int Client::mount(const std::string &mount_root, const UserPerm& perms,
   _ll_get(root);
 
   mounted = true;
+  // cached ll hits are not written to the trace
+  _ll_cache_set_enabled(cct->_conf->client_trace.empty());
 
   // trace?
   if (!cct->_conf->client_trace.empty()) {
@@ -5986,6 +6140,8 @@ void Client::_abort_mds_sessions(int err)
     if (req->caller_cond) {
       req->kick = true;
       req->caller_cond->notify_all();
+    } else if (req->onfinish) {
+      finish_async_request(req);
     }
   }
 
@@ -6013,6 +6169,7 @@ void Client::_unmount(bool abort)
     ldout(cct, 2) << "unmounting" << dendl;
   }
   unmounting = true;
+  _ll_cache_set_enabled(false);
 
   deleg_timeout = 0;
 
@@ -6367,6 +6524,12 @@ int Client::_lookup(Inode *dir, const string& dname, int mask, InodeRef *target,
     }
   }
 
+  if (dn && dn->inode && (dn->inode->flags & I_ASYNC_CREATE)) {
+    // the mds may not have seen the create yet
+    InodeRef tmp_ref(dn->inode);
+    wait_async_create(tmp_ref.get());
+  }
+
   r = _do_lookup(dir, dname, mask, target, perms);
   goto done;
 
@@ -6828,6 +6991,10 @@ int Client::_getattr(Inode *in, int mask, const UserPerm& perms, bool force)
   if (yes && !force)
     return 0;
 
+  int r = wait_async_create(in);
+  if (r < 0)
+    return r;
+
   MetaRequest *req = new MetaRequest(CEPH_MDS_OP_GETATTR);
   filepath path;
   in->make_nosnap_relative_path(path);
@@ -6858,6 +7025,10 @@ int Client::_do_setattr(Inode *in, struct ceph_statx *stx, int mask,
     return -EDQUOT;
   }
 
+  int r = wait_async_create(in);
+  if (r < 0)
+    return r;
+
   // make the change locally?
   if ((in->cap_dirtier_uid >= 0 && perms.uid() != in->cap_dirtier_uid) ||
       (in->cap_dirtier_gid >= 0 && perms.gid() != in->cap_dirtier_gid)) {
@@ -8743,6 +8914,13 @@ int Client::_open(Inode *in, int flags, mode_t mode, Fh **fhp,
   int want = ceph_caps_for_mode(cmode);
   int result = 0;
 
+  if ((flags & O_TRUNC) || !in->caps_issued_mask(want)) {
+    // we are about to ask the mds for the inode
+    result = wait_async_create(in);
+    if (result < 0)
+      return result;
+  }
+
   in->get_open_ref(cmode);  // make note of pending open, since it effects _wanted_ caps.
 
   if ((flags & O_TRUNC) == 0 && in->caps_issued_mask(want)) {
@@ -9027,27 +9205,32 @@ int Client::uninline_data(Inode *in, Context *onfinish)
 
 int Client::read(int fd, char *buf, loff_t size, loff_t offset)
 {
-  std::lock_guard lock(client_lock);
-  tout(cct) << "read" << std::endl;
-  tout(cct) << fd << std::endl;
-  tout(cct) << size << std::endl;
-  tout(cct) << offset << std::endl;
+  bufferlist bl;
+  int r;
+  {
+    std::lock_guard lock(client_lock);
+    tout(cct) << "read" << std::endl;
+    tout(cct) << fd << std::endl;
+    tout(cct) << size << std::endl;
+    tout(cct) << offset << std::endl;
 
-  if (unmounting)
-    return -ENOTCONN;
+    if (unmounting)
+      return -ENOTCONN;
 
-  Fh *f = get_filehandle(fd);
-  if (!f)
-    return -EBADF;
+    Fh *f = get_filehandle(fd);
+    if (!f)
+      return -EBADF;
 #if defined(__linux__) && defined(O_PATH)
-  if (f->flags & O_PATH)
-    return -EBADF;
+    if (f->flags & O_PATH)
+      return -EBADF;
 #endif
-  bufferlist bl;
-  /* We can't return bytes written larger than INT_MAX, clamp size to that */
-  size = std::min(size, (loff_t)INT_MAX);
-  int r = _read(f, offset, size, &bl);
-  ldout(cct, 3) << "read(" << fd << ", " << (void*)buf << ", " << size << ", " << offset << ") = " << r << dendl;
+    /* We can't return bytes written larger than INT_MAX, clamp size to that */
+    size = std::min(size, (loff_t)INT_MAX);
+    r = _read(f, offset, size, &bl);
+    ldout(cct, 3) << "read(" << fd << ", " << (void*)buf << ", " << size << ", " << offset << ") = " << r << dendl;
+  }
+
+  // copy out to the caller without holding client_lock
   if (r >= 0) {
     bl.copy(0, bl.length(), buf);
     r = bl.length();
@@ -9354,6 +9537,14 @@ void Client::_sync_write_commit(Inode *in)
 
 int Client::write(int fd, const char *buf, loff_t size, loff_t offset) 
 {
+  /* We can't return bytes written larger than INT_MAX, clamp size to that */
+  size = std::min(size, (loff_t)INT_MAX);
+
+  // copy in the caller's data without holding client_lock
+  bufferlist bl;
+  if (size > 0)
+    bl.append(buf, size);
+
   std::lock_guard lock(client_lock);
   tout(cct) << "write" << std::endl;
   tout(cct) << fd << std::endl;
@@ -9370,9 +9561,7 @@ int Client::write(int fd, const char *buf, loff_t size, loff_t offset)
   if (fh->flags & O_PATH)
     return -EBADF;
 #endif
-  /* We can't return bytes written larger than INT_MAX, clamp size to that */
-  size = std::min(size, (loff_t)INT_MAX);
-  int r = _write(fh, offset, size, buf, NULL, false);
+  int r = _write(fh, offset, std::move(bl));
   ldout(cct, 3) << "write(" << fd << ", \"...\", " << size << ", " << offset << ") = " << r << dendl;
   return r;
 }
@@ -9384,75 +9573,102 @@ int Client::pwritev(int fd, const struct iovec *iov, int iovcnt, int64_t offset)
   return _preadv_pwritev(fd, iov, iovcnt, offset, true);
 }
 
-int64_t Client::_preadv_pwritev_locked(Fh *fh, const struct iovec *iov,
-				   unsigned iovcnt, int64_t offset, bool write,
-				   bool clamp_to_int)
+static loff_t iov_length(const struct iovec *iov, unsigned iovcnt,
+                         bool clamp_to_int)
 {
-#if defined(__linux__) && defined(O_PATH)
-    if (fh->flags & O_PATH)
-        return -EBADF;
-#endif
-    loff_t totallen = 0;
-    for (unsigned i = 0; i < iovcnt; i++) {
-        totallen += iov[i].iov_len;
+  loff_t totallen = 0;
+  for (unsigned i = 0; i < iovcnt; i++) {
+    totallen += iov[i].iov_len;
+  }
+
+  /*
+   * Some of the API functions take 64-bit size values, but only return
+   * 32-bit signed integers. Clamp the I/O sizes in those functions so that
+   * we don't do I/Os larger than the values we can return.
+   */
+  if (clamp_to_int) {
+    totallen = std::min(totallen, (loff_t)INT_MAX);
+  }
+  return totallen;
+}
+
+static void copy_from_iov(const struct iovec *iov, unsigned iovcnt,
+                          uint64_t len, bufferlist *bl)
+{
+  for (unsigned i = 0; i < iovcnt && len > 0; i++) {
+    uint64_t n = std::min<uint64_t>(iov[i].iov_len, len);
+    if (n > 0) {
+      bl->append((const char *)iov[i].iov_base, n);
     }
+    len -= n;
+  }
+}
 
+static void copy_to_iov(const bufferlist &bl, uint64_t len,
+                        const struct iovec *iov, unsigned iovcnt)
+{
+  uint64_t bufoff = 0;
+  for (unsigned j = 0; j < iovcnt && len > 0; j++) {
     /*
-     * Some of the API functions take 64-bit size values, but only return
-     * 32-bit signed integers. Clamp the I/O sizes in those functions so that
-     * we don't do I/Os larger than the values we can return.
+     * This piece of code aims to handle the case that bufferlist does not
+     * have enough data to fill in the iov
      */
-    if (clamp_to_int) {
-      totallen = std::min(totallen, (loff_t)INT_MAX);
-    }
+    uint64_t n = std::min<uint64_t>(iov[j].iov_len, len);
+    bl.copy(bufoff, n, (char *)iov[j].iov_base);
+    len -= n;
+    bufoff += n;
+  }
+}
+
+int64_t Client::_preadv_pwritev_locked(Fh *fh, bufferlist *bl, uint64_t len,
+                                       int64_t offset, bool write)
+{
+#if defined(__linux__) && defined(O_PATH)
+    if (fh->flags & O_PATH)
+        return -EBADF;
+#endif
     if (write) {
-        int64_t w = _write(fh, offset, totallen, NULL, iov, iovcnt);
-        ldout(cct, 3) << "pwritev(" << fh << ", \"...\", " << totallen << ", " << offset << ") = " << w << dendl;
+        int64_t w = _write(fh, offset, std::move(*bl));
+        ldout(cct, 3) << "pwritev(" << fh << ", \"...\", " << len << ", " << offset << ") = " << w << dendl;
         return w;
     } else {
-        bufferlist bl;
-        int64_t r = _read(fh, offset, totallen, &bl);
+        int64_t r = _read(fh, offset, len, bl);
         ldout(cct, 3) << "preadv(" << fh << ", " <<  offset << ") = " << r << dendl;
-        if (r <= 0)
-          return r;
-
-        int bufoff = 0;
-        for (unsigned j = 0, resid = r; j < iovcnt && resid > 0; j++) {
-               /*
-                * This piece of code aims to handle the case that bufferlist does not have enough data 
-                * to fill in the iov 
-                */
-               if (resid < iov[j].iov_len) {
-                    bl.copy(bufoff, resid, (char *)iov[j].iov_base);
-                    break;
-               } else {
-                    bl.copy(bufoff, iov[j].iov_len, (char *)iov[j].iov_base);
-               }
-               resid -= iov[j].iov_len;
-               bufoff += iov[j].iov_len;
-        }
-        return r;  
+        return r;
     }
 }
 
 int Client::_preadv_pwritev(int fd, const struct iovec *iov, unsigned iovcnt, int64_t offset, bool write)
 {
-    std::lock_guard lock(client_lock);
-    tout(cct) << fd << std::endl;
-    tout(cct) << offset << std::endl;
+    // copy the caller's buffers in and out without holding client_lock
+    loff_t len = iov_length(iov, iovcnt, true);
+    bufferlist bl;
+    if (write)
+        copy_from_iov(iov, iovcnt, len, &bl);
 
-    if (unmounting)
-     return -ENOTCONN;
+    int64_t r;
+    {
+        std::lock_guard lock(client_lock);
+        tout(cct) << fd << std::endl;
+        tout(cct) << offset << std::endl;
 
-    Fh *fh = get_filehandle(fd);
-    if (!fh)
-        return -EBADF;
-    return _preadv_pwritev_locked(fh, iov, iovcnt, offset, write, true);
+        if (unmounting)
+            return -ENOTCONN;
+
+        Fh *fh = get_filehandle(fd);
+        if (!fh)
+            return -EBADF;
+        r = _preadv_pwritev_locked(fh, &bl, len, offset, write);
+    }
+
+    if (!write && r > 0)
+        copy_to_iov(bl, r, iov, iovcnt);
+    return r;
 }
 
-int64_t Client::_write(Fh *f, int64_t offset, uint64_t size, const char *buf,
-	                const struct iovec *iov, int iovcnt)
+int64_t Client::_write(Fh *f, int64_t offset, bufferlist&& bl)
 {
+  uint64_t size = bl.length();
   uint64_t fpos = 0;
 
   if ((uint64_t)(offset+size) > mdsmap->get_max_filesize()) //too large!
@@ -9511,19 +9727,6 @@ int64_t Client::_write(Fh *f, int64_t offset, uint64_t size, const char *buf,
     ceph_assert(in->inline_version > 0);
   }
 
-  // copy into fresh buffer (since our write may be resub, async)
-  bufferlist bl;
-  if (buf) {
-    if (size > 0)
-      bl.append(buf, size);
-  } else if (iov){
-    for (int i = 0; i < iovcnt; i++) {
-      if (iov[i].iov_len > 0) {
-        bl.append((const char *)iov[i].iov_base, iov[i].iov_len);
-      }
-    }
-  }
-
   utime_t lat;
   uint64_t totalwritten;
   int want, have;
@@ -10657,9 +10860,202 @@ Inode *Client::open_snapdir(Inode *diri)
   return in;
 }
 
+bool Client::_ll_cache_gens(Inode *in, ll_cap_gens_t *gens)
+{
+  for (const auto &p : in->caps) {
+    const Cap &cap = p.second;
+    if (in->cap_is_valid(cap))
+      gens->emplace_back(cap.session->mds_num, cap.session->cap_gen);
+  }
+  return !gens->empty();
+}
+
+void Client::_ll_cache_attr(Inode *in)
+{
+  if (!ll_cache_enabled || in->snapid != CEPH_NOSNAP)
+    return;
+  if (in->ll_cached && ll_attr_cache.count(in))
+    return;
+
+  // only what the mds alone may change, so that the cap hooks see it first
+  int implemented;
+  int issued = in->caps_issued(&implemented);
+  if ((issued & CEPH_STAT_CAP_INODE_ALL) != CEPH_STAT_CAP_INODE_ALL ||
+      (issued & CEPH_CAP_ANY_WR) || (implemented & ~issued) ||
+      in->caps_dirty() || !in->cap_snaps.empty())
+    return;
+
+  LLCachedAttr attr;
+  if (!_ll_cache_gens(in, &attr.gens))
+    return;
+  fill_stat(in, &attr.st);
+  fill_statx(in, CEPH_STAT_CAP_INODE_ALL, &attr.stx);
+
+  std::unique_lock l{ll_cache_lock};
+  ll_attr_cache[in] = std::move(attr);
+  in->ll_cached = true;
+}
+
+void Client::_ll_cache_dentry(Inode *dir, const string& dname, Inode *in)
+{
+  if (!ll_cache_enabled || dir->snapid != CEPH_NOSNAP || !dir->dir ||
+      dname == "." || dname == ".." || dname == cct->_conf->client_snapdir)
+    return;
+  auto p = dir->dir->dentries.find(dname);
+  if (p == dir->dir->dentries.end() || p->second->inode != in)
+    return;
+  Dentry *dn = p->second;
+
+  // same two ways _lookup trusts a dentry: its lease, or dir Fs caps
+  LLCachedDentry entry{in, utime_t(), {}};
+  utime_t now = ceph_clock_now();
+  if (dn->lease_mds >= 0 && dn->lease_ttl > now &&
+      mds_sessions.count(dn->lease_mds)) {
+    entry.lease_ttl = dn->lease_ttl;
+    entry.gens.emplace_back(dn->lease_mds, dn->lease_gen);
+  } else if (!dir->caps_issued_mask(CEPH_CAP_FILE_SHARED, true) ||
+	     dn->cap_shared_gen != dir->shared_gen ||
+	     !_ll_cache_gens(dir, &entry.gens)) {
+    return;
+  }
+
+  std::unique_lock l{ll_cache_lock};
+  ll_dentry_cache[std::make_pair(dir, dname)] = std::move(entry);
+  dir->ll_cached = true;
+  in->ll_cached = true;
+}
+
+void Client::_ll_cache_invalidate(Inode *in)
+{
+  if (!in->ll_cached)
+    return;
+
+  std::unique_lock l{ll_cache_lock};
+  ll_attr_cache.erase(in);
+  for (auto p = ll_dentry_cache.lower_bound(std::make_pair(in, string()));
+       p != ll_dentry_cache.end() && p->first.first == in; )
+    p = ll_dentry_cache.erase(p);
+  for (auto p = in->dentries.begin(); !p.end(); ++p) {
+    Dentry *dn = *p;
+    ll_dentry_cache.erase(std::make_pair(dn->dir->parent_inode, dn->name));
+  }
+  in->ll_cached = false;
+}
+
+void Client::_ll_cache_invalidate_dentry(Inode *dir, const string& dname)
+{
+  if (!dir->ll_cached)
+    return;
+
+  std::unique_lock l{ll_cache_lock};
+  ll_dentry_cache.erase(std::make_pair(dir, dname));
+}
+
+void Client::_ll_cache_set_enabled(bool enabled)
+{
+  std::unique_lock l{ll_cache_lock};
+  ll_cache_enabled = enabled;
+  if (!enabled) {
+    ll_attr_cache.clear();
+    ll_dentry_cache.clear();
+  }
+}
+
+bool Client::ll_cache_valid(const ll_cap_gens_t& gens, utime_t now)
+{
+  std::shared_lock l{session_lock};
+  for (const auto& [mds, gen] : gens) {
+    auto p = mds_sessions.find(mds);
+    if (p == mds_sessions.end() ||
+	p->second.cap_gen != gen ||
+	p->second.cap_ttl <= now)
+      return false;
+  }
+  return true;
+}
+
+// called with ll_cache_lock held shared
+const Client::LLCachedAttr *Client::ll_cache_get_attr(Inode *in, utime_t now)
+{
+  auto p = ll_attr_cache.find(in);
+  if (p == ll_attr_cache.end() || !ll_cache_valid(p->second.gens, now))
+    return nullptr;
+  return &p->second;
+}
+
+// like may_lookup, but only for the cases that need nothing but the mode
+bool Client::ll_cache_may_lookup(Inode *dir, const UserPerm& perms, utime_t now)
+{
+  if (perms.uid() == 0)
+    return true;
+  const LLCachedAttr *attr = ll_cache_get_attr(dir, now);
+  return attr && attr->st.st_uid == perms.uid() &&
+    (attr->st.st_mode & S_IXUSR);
+}
+
+bool Client::ll_cache_getattr(Inode *in, struct stat *attr,
+			      struct ceph_statx *stx)
+{
+  std::shared_lock l{ll_cache_lock};
+  if (!ll_cache_enabled)
+    return false;
+  const LLCachedAttr *cached = ll_cache_get_attr(in, ceph_clock_now());
+  if (!cached)
+    return false;
+  if (attr)
+    *attr = cached->st;
+  if (stx)
+    *stx = cached->stx;
+  return true;
+}
+
+/*
+ * Returns the inode with an ll ref taken, or nullptr if the caller has to
+ * go the slow way.
+ */
+Inode *Client::ll_cache_lookup(Inode *parent, const char *name,
+			       const UserPerm& perms, struct stat *attr,
+			       struct ceph_statx *stx)
+{
+  std::shared_lock l{ll_cache_lock};
+  if (!ll_cache_enabled)
+    return nullptr;
+  auto p = ll_dentry_cache.find(std::make_pair(parent, string(name)));
+  if (p == ll_dentry_cache.end())
+    return nullptr;
+  const LLCachedDentry& dn = p->second;
+
+  utime_t now = ceph_clock_now();
+  if ((!dn.lease_ttl.is_zero() && dn.lease_ttl <= now) ||
+      !ll_cache_valid(dn.gens, now))
+    return nullptr;
+  const LLCachedAttr *cached = ll_cache_get_attr(dn.in, now);
+  if (!cached)
+    return nullptr;
+  if (!cct->_conf.get_val<bool>("fuse_default_permissions") &&
+      !ll_cache_may_lookup(parent, perms, now))
+    return nullptr;
+  // an inode without ll refs may be on its way out; leave it to client_lock
+  if (!dn.in->ll_get_if_referenced())
+    return nullptr;
+
+  if (attr)
+    *attr = cached->st;
+  if (stx)
+    *stx = cached->stx;
+  return dn.in;
+}
+
 int Client::ll_lookup(Inode *parent, const char *name, struct stat *attr,
 		      Inode **out, const UserPerm& perms)
 {
+  if (Inode *hit = ll_cache_lookup(parent, name, perms, attr, nullptr)) {
+    ldout(cct, 3) << __func__ << " " << _get_vino(parent) << " " << name
+		  << " -> 0 (" << hex << attr->st_ino << dec << ") cached" << dendl;
+    *out = hit;
+    return 0;
+  }
+
   std::lock_guard lock(client_lock);
   vinodeno_t vparent = _get_vino(parent);
   ldout(cct, 3) << __func__ << " " << vparent << " " << name << dendl;
@@ -10692,6 +11088,9 @@ int Client::ll_lookup(Inode *parent, const char *name, struct stat *attr,
   ceph_assert(in);
   fill_stat(in, attr);
   _ll_get(in.get());
+  _ll_cache_attr(parent);
+  _ll_cache_attr(in.get());
+  _ll_cache_dentry(parent, dname, in.get());
 
  out:
   ldout(cct, 3) << __func__ << " " << vparent << " " << name
@@ -10757,6 +11156,13 @@ int Client::ll_lookupx(Inode *parent, const char *name, Inode **out,
 		       struct ceph_statx *stx, unsigned want, unsigned flags,
 		       const UserPerm& perms)
 {
+  if (Inode *hit = ll_cache_lookup(parent, name, perms, nullptr, stx)) {
+    ldout(cct, 3) << __func__ << " " << _get_vino(parent) << " " << name
+		  << " -> 0 (" << hex << stx->stx_ino << dec << ") cached" << dendl;
+    *out = hit;
+    return 0;
+  }
+
   std::lock_guard lock(client_lock);
   vinodeno_t vparent = _get_vino(parent);
   ldout(cct, 3) << __func__ << " " << vparent << " " << name << dendl;
@@ -10787,6 +11193,9 @@ int Client::ll_lookupx(Inode *parent, const char *name, Inode **out,
     ceph_assert(in);
     fill_statx(in, mask, stx);
     _ll_get(in.get());
+    _ll_cache_attr(parent);
+    _ll_cache_attr(in.get());
+    _ll_cache_dentry(parent, dname, in.get());
   }
 
   ldout(cct, 3) << __func__ << " " << vparent << " " << name
@@ -10846,9 +11255,10 @@ void Client::_ll_get(Inode *in)
 
 int Client::_ll_put(Inode *in, uint64_t num)
 {
-  in->ll_put(num);
-  ldout(cct, 20) << __func__ << " " << in << " " << in->ino << " " << num << " -> " << in->ll_ref << dendl;
-  if (in->ll_ref == 0) {
+  // cached ll_lookup hits may add refs concurrently, but never from 0
+  uint64_t left = in->ll_put(num);
+  ldout(cct, 20) << __func__ << " " << in << " " << in->ino << " " << num << " -> " << left << dendl;
+  if (left == 0) {
     if (in->is_dir() && !in->dentries.empty()) {
       ceph_assert(in->dentries.size() == 1); // dirs can't be hard-linked
       in->get_first_parent()->put(); // unpin dentry
@@ -10863,7 +11273,7 @@ int Client::_ll_put(Inode *in, uint64_t num)
     put_inode(in);
     return 0;
   } else {
-    return in->ll_ref;
+    return left;
   }
 }
 
@@ -10988,6 +11398,11 @@ int Client::_ll_getattr(Inode *in, int caps, const UserPerm& perms)
 
 int Client::ll_getattr(Inode *in, struct stat *attr, const UserPerm& perms)
 {
+  if (ll_cache_getattr(in, attr, nullptr)) {
+    ldout(cct, 3) << __func__ << " " << _get_vino(in) << " = 0 cached" << dendl;
+    return 0;
+  }
+
   std::lock_guard lock(client_lock);
 
   if (unmounting)
@@ -10995,8 +11410,10 @@ int Client::ll_getattr(Inode *in, struct stat *attr, const UserPerm& perms)
 
   int res = _ll_getattr(in, CEPH_STAT_CAP_INODE_ALL, perms);
 
-  if (res == 0)
+  if (res == 0) {
     fill_stat(in, attr);
+    _ll_cache_attr(in);
+  }
   ldout(cct, 3) << __func__ << " " << _get_vino(in) << " = " << res << dendl;
   return res;
 }
@@ -11004,6 +11421,12 @@ int Client::ll_getattr(Inode *in, struct stat *attr, const UserPerm& perms)
 int Client::ll_getattrx(Inode *in, struct ceph_statx *stx, unsigned int want,
 			unsigned int flags, const UserPerm& perms)
 {
+  // the cached statx has every field statx_to_mask() can ask for
+  if (ll_cache_getattr(in, nullptr, stx)) {
+    ldout(cct, 3) << __func__ << " " << _get_vino(in) << " = 0 cached" << dendl;
+    return 0;
+  }
+
   std::lock_guard lock(client_lock);
 
   if (unmounting)
@@ -11015,8 +11438,10 @@ int Client::ll_getattrx(Inode *in, struct ceph_statx *stx, unsigned int want,
   if (mask && !in->caps_issued_mask(mask, true))
     res = _ll_getattr(in, mask, perms);
 
-  if (res == 0)
+  if (res == 0) {
     fill_statx(in, mask, stx);
+    _ll_cache_attr(in);
+  }
   ldout(cct, 3) << __func__ << " " << _get_vino(in) << " = " << res << dendl;
   return res;
 }
@@ -11437,6 +11862,10 @@ int Client::_do_setxattr(Inode *in, const char *name, const void *value,
   if (flags & XATTR_REPLACE)
     xattr_flags |= CEPH_XATTR_REPLACE;
 
+  int res = wait_async_create(in);
+  if (res < 0)
+    return res;
+
   MetaRequest *req = new MetaRequest(CEPH_MDS_OP_SETXATTR);
   filepath path;
   in->make_nosnap_relative_path(path);
@@ -11450,7 +11879,7 @@ int Client::_do_setxattr(Inode *in, const char *name, const void *value,
   bl.append((const char*)value, size);
   req->set_data(bl);
 
-  int res = make_request(req, perms);
+  res = make_request(req, perms);
 
   trim_cache();
   ldout(cct, 3) << __func__ << "(" << in->ino << ", \"" << name << "\") = " <<
@@ -11650,6 +12079,10 @@ int Client::_removexattr(Inode *in, const char *name, const UserPerm& perms)
   if (vxattr && vxattr->readonly)
     return -EOPNOTSUPP;
 
+  int res = wait_async_create(in);
+  if (res < 0)
+    return res;
+
   MetaRequest *req = new MetaRequest(CEPH_MDS_OP_RMXATTR);
   filepath path;
   in->make_nosnap_relative_path(path);
@@ -11657,7 +12090,7 @@ int Client::_removexattr(Inode *in, const char *name, const UserPerm& perms)
   req->set_filepath2(name);
   req->set_inode(in);
  
-  int res = make_request(req, perms);
+  res = make_request(req, perms);
 
   trim_cache();
   ldout(cct, 8) << "_removexattr(" << in->ino << ", \"" << name << "\") = " << res << dendl;
@@ -12181,9 +12614,25 @@ int Client::_create(Inode *dir, const char *name, int flags, mode_t mode,
     goto fail;
   req->set_dentry(de);
 
-  res = make_request(req, perms, inp, created);
-  if (res < 0) {
-    goto reply_error;
+  {
+    MetaSession *session = nullptr;
+    if (xattrs_bl.length() == 0 && pool_id < 0 && !stripe_unit &&
+	!stripe_count && !object_size && !de->inode &&
+	dir->create_layout.pool_id >= 0)
+      session = get_async_dirop_session(req, dir);
+    if (session && !session->delegated_inos.empty()) {
+      _async_create(req, session, dir, de, mode, perms, inp);
+      if (created)
+	*created = true;
+    } else {
+      res = make_request(req, perms, inp, created);
+      if (res < 0) {
+	goto reply_error;
+      }
+      // async creates in this directory will guess the same layout
+      if (*inp)
+	dir->create_layout = (*inp)->layout;
+    }
   }
 
   /* If the caller passed a value in fhp, do the open */
@@ -12208,6 +12657,110 @@ int Client::_create(Inode *dir, const char *name, int flags, mode_t mode,
 }
 
 
+/*
+ * Return the session to send an async create or unlink in @dir to, or
+ * NULL if it has to be done synchronously.  While we hold Fx on a
+ * complete directory no other client can see or change it, so we already
+ * know what the mds will make of the request.
+ */
+MetaSession *Client::get_async_dirop_session(MetaRequest *req, Inode *dir)
+{
+  if (!cct->_conf.get_val<bool>("client_async_dirops"))
+    return nullptr;
+  if (!dir->auth_cap || !(dir->flags & I_COMPLETE) ||
+      !dir->caps_issued_mask(CEPH_CAP_FILE_EXCL))
+    return nullptr;
+
+  MetaSession *session = dir->auth_cap->session;
+  if (session->state != MetaSession::STATE_OPEN ||
+      !session->mds_features.test(CEPHFS_FEATURE_DELEG_INO) ||
+      mdsmap->get_state(session->mds_num) != MDSMap::STATE_ACTIVE)
+    return nullptr;
+  if (choose_target_mds(req) != session->mds_num)
+    return nullptr;
+  return session;
+}
+
+/*
+ * Requests that name an inode by number must not reach the mds before
+ * its async create does.
+ */
+int Client::wait_async_create(Inode *in)
+{
+  while (in->flags & I_ASYNC_CREATE) {
+    ldout(cct, 10) << __func__ << " " << *in << dendl;
+    wait_on_list(in->waitfor_caps);
+  }
+  return in->async_create_err;
+}
+
+void Client::_async_create(MetaRequest *req, MetaSession *session,
+			   Inode *dir, Dentry *de, mode_t mode,
+			   const UserPerm& perms, InodeRef *inp)
+{
+  inodeno_t ino = session->delegated_inos.range_start();
+  session->delegated_inos.erase(ino);
+  if (cct->_conf.get_val<bool>("client_inject_async_create_failure")) {
+    // no mds hands out inos from the top of the range
+    ino = inodeno_t(-1ull - last_tid);
+  }
+  req->head.ino = ino;
+  // we only get here knowing the name is free
+  req->head.args.open.flags = req->head.args.open.flags | CEPH_O_EXCL;
+
+  // build the inode the mds is about to; version 0 lets the reply
+  // overwrite all of it
+  utime_t now = ceph_clock_now();
+  InodeStat st;
+  st.vino = vinodeno_t(ino, CEPH_NOSNAP);
+  memset(&st.cap, 0, sizeof(st.cap));
+  st.layout = dir->create_layout;
+  st.ctime = st.btime = st.mtime = st.atime = now;
+  st.truncate_size = -1ull;
+  st.truncate_seq = 1;
+  st.inline_version = CEPH_INLINE_NONE;
+  st.mode = mode;
+  st.uid = perms.uid();
+  st.gid = (dir->mode & S_ISGID) ? dir->gid : perms.gid();
+  st.nlink = 1;
+  st.dir_pin = MDS_RANK_NONE;
+
+  Inode *in = add_update_inode(&st, now, session, perms);
+  in->flags |= I_ASYNC_CREATE;
+  link(dir->dir, de->name, in, de);
+  de->cap_shared_gen = dir->shared_gen;
+  clear_dir_complete_and_ordered(dir, false);
+
+  req->target = in;
+  *inp = in;
+
+  ldout(cct, 10) << __func__ << " " << *in << " in " << *dir << dendl;
+  logger->inc(l_c_async_create);
+  InodeRef dirref(dir), inref(in);
+  make_async_request(req, perms, session, new LambdaContext(
+    [this, dirref, inref](int r) {
+      _async_create_finish(dirref.get(), inref.get(), r);
+    }));
+}
+
+void Client::_async_create_finish(Inode *dir, Inode *in, int r)
+{
+  ldout(cct, 10) << __func__ << " " << *in << " = " << r << dendl;
+  in->flags &= ~I_ASYNC_CREATE;
+  if (r < 0) {
+    lderr(cct) << "async create of " << in->ino << " in " << dir->ino
+	       << " failed: " << cpp_strerror(r) << dendl;
+    // reported by fsync/close of the file
+    in->async_create_err = r;
+    in->set_async_err(r);
+    clear_dir_complete_and_ordered(dir, true);
+    while (!in->dentries.empty())
+      unlink(in->get_first_parent(), true, true);  // keep dir, dentry
+  }
+  signal_cond_list(in->waitfor_caps);
+}
+
+
 int Client::_mkdir(Inode *dir, const char *name, mode_t mode, const UserPerm& perm,
 		   InodeRef *inp)
 {
@@ -12498,12 +13051,30 @@ int Client::_unlink(Inode *dir, const char *name, const UserPerm& perm)
     goto fail;
 
   in = otherin.get();
+  // the unlink must not overtake the create; if that failed, the name
+  // is gone and the mds says so
+  wait_async_create(in);
   req->set_other_inode(in);
   in->break_all_delegs();
   req->other_inode_drop = CEPH_CAP_LINK_SHARED | CEPH_CAP_LINK_EXCL;
 
   req->set_inode(dir);
 
+  if (!in->is_dir() && de->inode == in) {
+    MetaSession *session = get_async_dirop_session(req, dir);
+    if (session) {
+      unlink(de, true, true);  // keep dir, dentry
+      InodeRef dirref(dir);
+      make_async_request(req, perm, session, new LambdaContext(
+	[this, dirref](int r) {
+	  _async_unlink_finish(dirref.get(), r);
+	}));
+      ldout(cct, 8) << "unlink(" << path << ") = 0 (async)" << dendl;
+      logger->inc(l_c_async_unlink);
+      return 0;
+    }
+  }
+
   res = make_request(req, perm);
 
   trim_cache();
@@ -12515,6 +13086,18 @@ int Client::_unlink(Inode *dir, const char *name, const UserPerm& perm)
   return res;
 }
 
+void Client::_async_unlink_finish(Inode *dir, int r)
+{
+  ldout(cct, 10) << __func__ << " " << *dir << " = " << r << dendl;
+  if (r < 0) {
+    lderr(cct) << "async unlink in " << dir->ino << " failed: "
+	       << cpp_strerror(r) << dendl;
+    // reported by fsync/close of the directory
+    dir->set_async_err(r);
+    clear_dir_complete_and_ordered(dir, true);
+  }
+}
+
 int Client::ll_unlink(Inode *in, const char *name, const UserPerm& perm)
 {
   std::lock_guard lock(client_lock);
@@ -12696,6 +13279,9 @@ int Client::_rename(Inode *fromdir, const char *fromname, Inode *todir, const ch
       goto fail;
 
     Inode *oldinode = oldin.get();
+    // neither the rename nor the unlink of its target may overtake a
+    // create; if that failed, the mds reports the missing name
+    wait_async_create(oldinode);
     oldinode->break_all_delegs();
     req->set_old_inode(oldinode);
     req->old_inode_drop = CEPH_CAP_LINK_SHARED;
@@ -12738,6 +13324,7 @@ int Client::_rename(Inode *fromdir, const char *fromname, Inode *todir, const ch
     case 0:
       {
 	Inode *in = otherin.get();
+	wait_async_create(in);
 	req->set_other_inode(in);
 	in->break_all_delegs();
       }
@@ -12821,6 +13408,11 @@ int Client::_link(Inode *in, Inode *dir, const char *newname, const UserPerm& pe
     return -EDQUOT;
   }
 
+  // the link names the inode by number
+  int res = wait_async_create(in);
+  if (res < 0)
+    return res;
+
   in->break_all_delegs();
   MetaRequest *req = new MetaRequest(CEPH_MDS_OP_LINK);
 
@@ -12834,7 +13426,7 @@ int Client::_link(Inode *in, Inode *dir, const char *newname, const UserPerm& pe
   req->inode_unless = CEPH_CAP_FILE_EXCL;
 
   Dentry *de;
-  int res = get_or_create(dir, newname, &de);
+  res = get_or_create(dir, newname, &de);
   if (res < 0)
     goto fail;
   req->set_dentry(de);
@@ -13263,29 +13855,29 @@ int Client::ll_read_block(Inode *in, uint64_t blockid,
 			  uint64_t length,
 			  file_layout_t* layout)
 {
-  std::lock_guard lock(client_lock);
-
-  if (unmounting)
-    return -ENOTCONN;
-
-  vinodeno_t vino = _get_vino(in);
-  object_t oid = file_object_t(vino.ino, blockid);
   C_SaferCond onfinish;
   bufferlist bl;
+  {
+    std::lock_guard lock(client_lock);
 
-  objecter->read(oid,
-		 object_locator_t(layout->pool_id),
-		 offset,
-		 length,
-		 vino.snapid,
-		 &bl,
-		 CEPH_OSD_FLAG_READ,
-                 &onfinish);
+    if (unmounting)
+      return -ENOTCONN;
 
-  client_lock.unlock();
-  int r = onfinish.wait();
-  client_lock.lock();
+    vinodeno_t vino = _get_vino(in);
+    object_t oid = file_object_t(vino.ino, blockid);
 
+    objecter->read(oid,
+		   object_locator_t(layout->pool_id),
+		   offset,
+		   length,
+		   vino.snapid,
+		   &bl,
+		   CEPH_OSD_FLAG_READ,
+		   &onfinish);
+  }
+
+  // neither the wait nor the copy out need client_lock
+  int r = onfinish.wait();
   if (r >= 0) {
       bl.copy(0, bl.length(), buf);
       r = bl.length();
@@ -13383,6 +13975,14 @@ int Client::ll_commit_blocks(Inode *in,
 
 int Client::ll_write(Fh *fh, loff_t off, loff_t len, const char *data)
 {
+  /* We can't return bytes written larger than INT_MAX, clamp len to that */
+  len = std::min(len, (loff_t)INT_MAX);
+
+  // copy in the caller's data without holding client_lock
+  bufferlist bl;
+  if (len > 0)
+    bl.append(data, len);
+
   std::lock_guard lock(client_lock);
   ldout(cct, 3) << "ll_write " << fh << " " << fh->inode->ino << " " << off <<
     "~" << len << dendl;
@@ -13394,9 +13994,7 @@ int Client::ll_write(Fh *fh, loff_t off, loff_t len, const char *data)
   if (unmounting)
     return -ENOTCONN;
 
-  /* We can't return bytes written larger than INT_MAX, clamp len to that */
-  len = std::min(len, (loff_t)INT_MAX);
-  int r = _write(fh, off, len, data, NULL, 0);
+  int r = _write(fh, off, std::move(bl));
   ldout(cct, 3) << "ll_write " << fh << " " << off << "~" << len << " = " << r
 		<< dendl;
   return r;
@@ -13404,18 +14002,33 @@ int Client::ll_write(Fh *fh, loff_t off, loff_t len, const char *data)
 
 int64_t Client::ll_writev(struct Fh *fh, const struct iovec *iov, int iovcnt, int64_t off)
 {
+  // copy in the caller's data without holding client_lock
+  loff_t len = iov_length(iov, iovcnt, false);
+  bufferlist bl;
+  copy_from_iov(iov, iovcnt, len, &bl);
+
   std::lock_guard lock(client_lock);
   if (unmounting)
    return -ENOTCONN;
-  return _preadv_pwritev_locked(fh, iov, iovcnt, off, true, false);
+  return _preadv_pwritev_locked(fh, &bl, len, off, true);
 }
 
 int64_t Client::ll_readv(struct Fh *fh, const struct iovec *iov, int iovcnt, int64_t off)
 {
-  std::lock_guard lock(client_lock);
-  if (unmounting)
-   return -ENOTCONN;
-  return _preadv_pwritev_locked(fh, iov, iovcnt, off, false, false);
+  loff_t len = iov_length(iov, iovcnt, false);
+  bufferlist bl;
+  int64_t r;
+  {
+    std::lock_guard lock(client_lock);
+    if (unmounting)
+     return -ENOTCONN;
+    r = _preadv_pwritev_locked(fh, &bl, len, off, false);
+  }
+
+  // copy out to the caller without holding client_lock
+  if (r > 0)
+    copy_to_iov(bl, r, iov, iovcnt);
+  return r;
 }
 
 int Client::ll_flush(Fh *fh)
@@ -44,6 +44,7 @@
 #include <memory>
 #include <set>
 #include <string>
+#include <vector>
 
 using std::set;
 using std::map;
@@ -74,6 +75,8 @@ enum {
   l_c_wrlat,
   l_c_read,
   l_c_fsync,
+  l_c_async_create,
+  l_c_async_unlink,
   l_c_last,
 };
 
@@ -799,6 +802,10 @@ protected:
   int make_request(MetaRequest *req, const UserPerm& perms,
 		   InodeRef *ptarget = 0, bool *pcreated = 0,
 		   mds_rank_t use_mds=-1, bufferlist *pdirbl=0);
+  void make_async_request(MetaRequest *req, const UserPerm& perms,
+			  MetaSession *session, Context *onfinish);
+  void kick_async_request(MetaRequest *req);
+  void finish_async_request(MetaRequest *req);
   void put_request(MetaRequest *request);
   void unregister_request(MetaRequest *request);
 
@@ -961,9 +968,43 @@ protected:
 
   // global client lock
   //  - protects Client and buffer cache both!
+  //  - file data is copied to and from the caller's buffers without it
   ceph::mutex client_lock = ceph::make_mutex("Client::client_lock");
 ;
 
+  // mds_sessions membership and each session's cap_gen/cap_ttl are
+  // changed with both client_lock and session_lock held, so either one
+  // is enough to read them.  Taken after client_lock and ll_cache_lock.
+  ceph::shared_mutex session_lock = ceph::make_shared_mutex("Client::session_lock");
+
+  /*
+   * ll_lookup/ll_getattr hits served without client_lock.
+   *
+   * Entries are added under client_lock once a lookup or getattr could be
+   * answered from the caps or dentry lease we hold, and dropped under
+   * client_lock whenever what they were built from changes: the inode's
+   * attrs or caps, the dentry's link or lease, or the inode going away.
+   * Inodes that we may change locally (write or exclusive caps, dirty or
+   * flushing caps) are never cached.  What changes without us doing
+   * anything -- a session going stale, a lease or cap ttl running out --
+   * is checked on each hit against the sessions an entry relies on.
+   */
+  typedef std::vector<std::pair<mds_rank_t, uint64_t>> ll_cap_gens_t;
+  struct LLCachedAttr {
+    struct stat st;
+    struct ceph_statx stx;  // with all of CEPH_STAT_CAP_INODE_ALL
+    ll_cap_gens_t gens;     // (mds, cap_gen) of the sessions it relies on
+  };
+  struct LLCachedDentry {
+    Inode *in;
+    utime_t lease_ttl;      // zero unless it relies on a dentry lease
+    ll_cap_gens_t gens;
+  };
+  ceph::shared_mutex ll_cache_lock = ceph::make_shared_mutex("Client::ll_cache_lock");
+  bool ll_cache_enabled = false;
+  ceph::unordered_map<Inode*, LLCachedAttr> ll_attr_cache;
+  std::map<std::pair<Inode*, std::string>, LLCachedDentry> ll_dentry_cache;
+
   std::map<snapid_t, int> ll_snap_ref;
 
   Inode*                 root = nullptr;
@@ -1045,6 +1086,20 @@ private:
   int _ll_put(Inode *in, uint64_t num);
   void _ll_drop_pins();
 
+  bool _ll_cache_gens(Inode *in, ll_cap_gens_t *gens);
+  void _ll_cache_attr(Inode *in);
+  void _ll_cache_dentry(Inode *dir, const std::string& dname, Inode *in);
+  void _ll_cache_invalidate(Inode *in);
+  void _ll_cache_invalidate_dentry(Inode *dir, const std::string& dname);
+  void _ll_cache_set_enabled(bool enabled);
+  bool ll_cache_valid(const ll_cap_gens_t& gens, utime_t now);
+  const LLCachedAttr *ll_cache_get_attr(Inode *in, utime_t now);
+  bool ll_cache_may_lookup(Inode *dir, const UserPerm& perms, utime_t now);
+  bool ll_cache_getattr(Inode *in, struct stat *attr, struct ceph_statx *stx);
+  Inode *ll_cache_lookup(Inode *parent, const char *name,
+			 const UserPerm& perms, struct stat *attr,
+			 struct ceph_statx *stx);
+
   Fh *_create_fh(Inode *in, int flags, int cmode, const UserPerm& perms);
   int _release_fh(Fh *fh);
   void _put_fh(Fh *fh);
@@ -1065,6 +1120,13 @@ private:
   int _link(Inode *in, Inode *dir, const char *name, const UserPerm& perm,
 	    InodeRef *inp = 0);
   int _unlink(Inode *dir, const char *name, const UserPerm& perm);
+  MetaSession *get_async_dirop_session(MetaRequest *req, Inode *dir);
+  int wait_async_create(Inode *in);
+  void _async_create(MetaRequest *req, MetaSession *session, Inode *dir,
+		     Dentry *de, mode_t mode, const UserPerm& perms,
+		     InodeRef *inp);
+  void _async_create_finish(Inode *dir, Inode *in, int r);
+  void _async_unlink_finish(Inode *dir, int r);
   int _rename(Inode *olddir, const char *oname, Inode *ndir, const char *nname, const UserPerm& perm);
   int _mkdir(Inode *dir, const char *name, mode_t mode, const UserPerm& perm,
 	     InodeRef *inp = 0);
@@ -1113,10 +1175,9 @@ private:
 
   loff_t _lseek(Fh *fh, loff_t offset, int whence);
   int64_t _read(Fh *fh, int64_t offset, uint64_t size, bufferlist *bl);
-  int64_t _write(Fh *fh, int64_t offset, uint64_t size, const char *buf,
-          const struct iovec *iov, int iovcnt);
-  int64_t _preadv_pwritev_locked(Fh *f, const struct iovec *iov,
-	      unsigned iovcnt, int64_t offset, bool write, bool clamp_to_int);
+  int64_t _write(Fh *fh, int64_t offset, bufferlist&& bl);
+  int64_t _preadv_pwritev_locked(Fh *f, bufferlist *bl, uint64_t len,
+	      int64_t offset, bool write);
   int _preadv_pwritev(int fd, const struct iovec *iov, unsigned iovcnt, int64_t offset, bool write);
   int _flush(Fh *fh);
   int _fsync(Fh *fh, bool syncdataonly);
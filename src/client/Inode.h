@@ -4,6 +4,7 @@
 #ifndef CEPH_CLIENT_INODE_H
 #define CEPH_CLIENT_INODE_H
 
+#include <atomic>
 #include <numeric>
 
 #include "include/ceph_assert.h"
@@ -114,6 +115,7 @@ struct CapSnap {
 #define I_CAP_DROPPED	4
 #define I_SNAPDIR_OPEN	8
 #define I_KICK_FLUSH	16
+#define I_ASYNC_CREATE	32
 
 struct Inode {
   Client *client;
@@ -140,6 +142,7 @@ struct Inode {
   // file (data access)
   ceph_dir_layout dir_layout;
   file_layout_t layout;
+  file_layout_t create_layout;  // on directory, layout of the last create
   uint64_t   size;        // on directory, # dentries
   uint32_t   truncate_seq;
   uint64_t   truncate_size;
@@ -221,7 +224,9 @@ struct Inode {
   uint64_t     reported_size, wanted_max_size, requested_max_size;
 
   int       _ref;      // ref count. 1 for each dentry, fh that links to me.
-  uint64_t  ll_ref;   // separate ref count for ll client
+  // separate ref count for ll client; changes to and from 0 happen under
+  // client_lock, cached ll_lookup hits bump it when it's already non-zero
+  std::atomic<uint64_t> ll_ref;
   xlist<Dentry *> dentries; // if i'm linked to a dentry.
   string    symlink;  // symlink content, if it's a symlink
   map<string,bufferptr> xattrs;
@@ -249,9 +254,18 @@ struct Inode {
   void ll_get() {
     ll_ref++;
   }
-  void ll_put(uint64_t n=1) {
+  // take another ll ref, unless there is none yet
+  bool ll_get_if_referenced() {
+    uint64_t n = ll_ref;
+    while (n) {
+      if (ll_ref.compare_exchange_weak(n, n + 1))
+	return true;
+    }
+    return false;
+  }
+  uint64_t ll_put(uint64_t n=1) {
     ceph_assert(ll_ref >= n);
-    ll_ref -= n;
+    return ll_ref -= n;
   }
 
   // file locks
@@ -261,11 +275,15 @@ struct Inode {
   list<Delegation> delegations;
 
   xlist<MetaRequest*> unsafe_ops;
+  int async_create_err = 0;  // the mds refused our async create
 
   std::set<Fh*> fhs;
 
   mds_rank_t dir_pin;
 
+  // Client::ll_attr_cache/ll_dentry_cache may hold entries about me
+  bool ll_cached = false;
+
   Inode(Client *c, vinodeno_t vino, file_layout_t *newlayout)
     : client(c), ino(vino.ino), snapid(vino.snapid), faked_ino(0),
       rdev(0), mode(0), uid(0), gid(0), nlink(0),
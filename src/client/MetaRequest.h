@@ -15,6 +15,7 @@
 #include "messages/MClientRequest.h"
 #include "messages/MClientReply.h"
 
+class Context;
 class Dentry;
 class dir_result_t;
 
@@ -66,6 +67,8 @@ public:
 
   ceph::condition_variable *caller_cond;          // who to take up
   ceph::condition_variable *dispatch_cond;        // who to kick back
+  bool async;                                     // nobody waits for the reply
+  Context *onfinish;                              // async: completed on first reply
   list<ceph::condition_variable*> waitfor_safe;
 
   InodeRef target;
@@ -86,7 +89,7 @@ public:
     kick(false), success(false), dirp(NULL),
     got_unsafe(false), item(this), unsafe_item(this),
     unsafe_dir_item(this), unsafe_target_item(this),
-    caller_cond(0), dispatch_cond(0) {
+    caller_cond(0), dispatch_cond(0), async(false), onfinish(nullptr) {
     memset(&head, 0, sizeof(head));
     head.op = op;
   }
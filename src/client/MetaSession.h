@@ -4,6 +4,7 @@
 #ifndef CEPH_CLIENT_METASESSION_H
 #define CEPH_CLIENT_METASESSION_H
 
+#include "include/interval_set.h"
 #include "include/types.h"
 #include "include/utime.h"
 #include "include/xlist.h"
@@ -52,6 +53,7 @@ struct MetaSession {
   xlist<MetaRequest*> requests;
   xlist<MetaRequest*> unsafe_requests;
   std::set<ceph_tid_t> flushing_caps_tids;
+  interval_set<inodeno_t> delegated_inos; // for async creates
 
   ceph::ref_t<MClientCapRelease> release;
 
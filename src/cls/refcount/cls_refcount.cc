@@ -125,7 +125,15 @@ static int cls_rc_refcount_put(cls_method_context_t hctx, bufferlist *in, buffer
   objr.refs.erase(iter);
 
   if (objr.refs.empty()) {
-    return cls_cxx_remove(hctx);
+    ret = cls_cxx_remove(hctx);
+    if (ret < 0)
+      return ret;
+
+    // only returned to callers that asked for the op's output
+    cls_refcount_put_ret put_ret;
+    put_ret.removed = true;
+    encode(put_ret, *out);
+    return 0;
   }
 
   ret = set_refcount(hctx, objr);
@@ -27,6 +27,35 @@ void cls_refcount_put(librados::ObjectWriteOperation& op, const string& tag, boo
   op.exec("refcount", "put", in);
 }
 
+class RefcountPutCtx : public ObjectOperationCompletion {
+  bool *removed;
+public:
+  explicit RefcountPutCtx(bool *_removed) : removed(_removed) {}
+  void handle_completion(int r, bufferlist& outbl) override {
+    *removed = false;
+    if (r >= 0 && outbl.length() > 0) {
+      cls_refcount_put_ret ret;
+      try {
+        auto iter = outbl.cbegin();
+        decode(ret, iter);
+        *removed = ret.removed;
+      } catch (buffer::error& err) {
+        // treat it as not removed
+      }
+    }
+  }
+};
+
+void cls_refcount_put(librados::ObjectWriteOperation& op, const string& tag, bool implicit_ref, bool *removed)
+{
+  bufferlist in;
+  cls_refcount_put_op call;
+  call.tag = tag;
+  call.implicit_ref = implicit_ref;
+  encode(call, in);
+  op.exec("refcount", "put", in, new RefcountPutCtx(removed));
+}
+
 void cls_refcount_set(librados::ObjectWriteOperation& op, list<string>& refs)
 {
   bufferlist in;
@@ -28,6 +28,10 @@
 
 void cls_refcount_get(librados::ObjectWriteOperation& op, const string& tag, bool implicit_ref = false);
 void cls_refcount_put(librados::ObjectWriteOperation& op, const string& tag, bool implicit_ref = false);
+// as above, also setting *removed if the last reference was dropped and the
+// object removed. this is only reported if op is sent with
+// librados::OPERATION_RETURNVEC; otherwise *removed is always false
+void cls_refcount_put(librados::ObjectWriteOperation& op, const string& tag, bool implicit_ref, bool *removed);
 void cls_refcount_set(librados::ObjectWriteOperation& op, list<string>& refs);
 // these overloads which call io_ctx.operate() or io_ctx.exec() should not be called in the rgw.
 // rgw_rados_operate() should be called after the overloads w/o calls to io_ctx.operate()/exec()
@@ -36,6 +36,18 @@ void cls_refcount_put_op::generate_test_instances(list<cls_refcount_put_op*>& ls
 
 
 
+void cls_refcount_put_ret::dump(ceph::Formatter *f) const
+{
+  f->dump_bool("removed", removed);
+}
+
+void cls_refcount_put_ret::generate_test_instances(list<cls_refcount_put_ret*>& ls)
+{
+  ls.push_back(new cls_refcount_put_ret);
+  ls.push_back(new cls_refcount_put_ret);
+  ls.back()->removed = true;
+}
+
 void cls_refcount_set_op::dump(ceph::Formatter *f) const
 {
   encode_json("refs", refs, f);
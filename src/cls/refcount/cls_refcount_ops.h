@@ -57,6 +57,26 @@ struct cls_refcount_put_op {
 };
 WRITE_CLASS_ENCODER(cls_refcount_put_op)
 
+struct cls_refcount_put_ret {
+  bool removed = false; // the last reference was dropped
+
+  void encode(bufferlist& bl) const {
+    ENCODE_START(1, 1, bl);
+    encode(removed, bl);
+    ENCODE_FINISH(bl);
+  }
+
+  void decode(bufferlist::const_iterator& bl) {
+    DECODE_START(1, bl);
+    decode(removed, bl);
+    DECODE_FINISH(bl);
+  }
+
+  void dump(ceph::Formatter *f) const;
+  static void generate_test_instances(list<cls_refcount_put_ret*>& ls);
+};
+WRITE_CLASS_ENCODER(cls_refcount_put_ret)
+
 struct cls_refcount_set_op {
   list<string> refs;
 
@@ -25,13 +25,15 @@ CLS_NAME(rgw)
 #define BI_BUCKET_LOG_INDEX           1
 #define BI_BUCKET_OBJ_INSTANCE_INDEX  2
 #define BI_BUCKET_OLH_DATA_INDEX      3
+#define BI_BUCKET_RESHARD_LOG_INDEX   4
 
-#define BI_BUCKET_LAST_INDEX          4
+#define BI_BUCKET_LAST_INDEX          5
 
 static std::string bucket_index_prefixes[] = { "", /* special handling for the objs list index */
                                           "0_",     /* bucket log index */
                                           "1000_",  /* obj instance index */
                                           "1001_",  /* olh data index */
+                                          "1002_",  /* reshard log index */
 
                                           /* this must be the last index */
                                           "9999_",};
@@ -405,6 +407,73 @@ static int read_bucket_header(cls_method_context_t hctx,
   return 0;
 }
 
+/*
+ * While a bucket is resharded online, its index shards are in
+ * CLS_RGW_RESHARD_IN_LOGRECORD and the reshard copies their entries
+ * without blocking writes.  Every op that changes the index entries of
+ * an object records the object's name in the reshard log, so that the
+ * reshard can copy those entries again before it switches over.  Each
+ * record carries a version that every later write bumps, so that the
+ * reshard can trim what it copied without losing a write that raced
+ * with the copy.
+ */
+static void reshard_log_index_key(const string& name, string *key)
+{
+  key->clear();
+  key->push_back(BI_PREFIX_CHAR);
+  key->append(bucket_index_prefixes[BI_BUCKET_RESHARD_LOG_INDEX]);
+  key->append(name);
+}
+
+static int reshard_log_record(cls_method_context_t hctx,
+                              const rgw_bucket_dir_header& header,
+                              const string& name)
+{
+  if (!header.resharding_log_record()) {
+    return 0;
+  }
+
+  string key;
+  reshard_log_index_key(name, &key);
+  uint64_t ver = 0;
+  bufferlist bl;
+  int rc = cls_cxx_map_get_val(hctx, key, &bl);
+  if (rc < 0 && rc != -ENOENT) {
+    CLS_LOG(1, "ERROR: %s(): failed to read record of %s rc=%d", __func__,
+            escape_str(name).c_str(), rc);
+    return rc;
+  }
+  if (rc >= 0) {
+    try {
+      auto iter = bl.cbegin();
+      decode(ver, iter);
+    } catch (buffer::error& err) {
+      CLS_LOG(1, "ERROR: %s(): failed to decode record of %s", __func__,
+              escape_str(name).c_str());
+      return -EIO;
+    }
+  }
+  bl.clear();
+  encode(ver + 1, bl);
+  rc = cls_cxx_map_set_val(hctx, key, &bl);
+  if (rc < 0) {
+    CLS_LOG(1, "ERROR: %s(): failed to record %s rc=%d", __func__,
+            escape_str(name).c_str(), rc);
+  }
+  return rc;
+}
+
+static int reshard_log_record(cls_method_context_t hctx, const string& name)
+{
+  rgw_bucket_dir_header header;
+  int rc = read_bucket_header(hctx, &header);
+  if (rc < 0) {
+    CLS_LOG(1, "ERROR: %s(): failed to read header\n", __func__);
+    return rc;
+  }
+  return reshard_log_record(hctx, header, name);
+}
+
 int rgw_bucket_list(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
 {
   auto iter = in->cbegin();
@@ -432,6 +501,7 @@ int rgw_bucket_list(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
   bool done = false;
   uint32_t left_to_read = op.num_entries;
   bool more;
+  const bool has_delimiter = !op.delimiter.empty();
 
   do {
     rc = get_obj_vals(hctx, start_key, op.filter_prefix, left_to_read, &keys, &more);
@@ -481,6 +551,37 @@ int rgw_bucket_list(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
         CLS_LOG(20, "entry %s[%s] is not visible\n", key.name.c_str(), key.instance.c_str());
         continue;
       }
+
+      if (has_delimiter) {
+        size_t delim_pos = key.name.find(op.delimiter, op.filter_prefix.size());
+        if (delim_pos != string::npos) {
+          /* return the common prefix, with its trailing delimiter, as a
+           * single entry and seek past everything under it */
+          string prefix_key = key.name.substr(0, delim_pos + op.delimiter.size());
+          if (m.size() < op.num_entries) {
+            rgw_bucket_dir_entry& proxy = m[prefix_key];
+            proxy.key.name = prefix_key;
+            proxy.flags = RGW_BUCKET_DIRENT_FLAG_COMMON_PREFIX;
+          }
+          left_to_read--;
+
+          start_key = prefix_key;
+          start_key.append(1, char(0xFF));
+          CLS_LOG(20, "got common prefix %s, skipping to %s\n",
+                  prefix_key.c_str(), escape_str(start_key).c_str());
+
+          /* keys under the prefix that we already have are skipped in
+           * place; if the batch ends inside the prefix, the next read
+           * starts after it */
+          auto next = keys.upper_bound(start_key);
+          if (next == keys.end()) {
+            break;
+          }
+          kiter = std::prev(next);
+          continue;
+        }
+      }
+
       if (m.size() < op.num_entries) {
         m[kiter->first] = entry;
       }
@@ -491,6 +592,10 @@ int rgw_bucket_list(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
   } while (left_to_read > 0 && !done);
 
   ret.is_truncated = more && !done;
+  if (ret.is_truncated) {
+    uint64_t ver;
+    decode_list_index_key(start_key, &ret.marker, &ver);
+  }
 
   encode(ret, *out);
   return 0;
@@ -834,6 +939,11 @@ int rgw_bucket_complete_op(cls_method_context_t hctx, bufferlist *in, bufferlist
     return -EINVAL;
   }
 
+  rc = reshard_log_record(hctx, header, op.key.name);
+  if (rc < 0) {
+    return rc;
+  }
+
   rgw_bucket_dir_entry entry;
   bool ondisk = true;
 
@@ -957,6 +1067,11 @@ int rgw_bucket_complete_op(cls_method_context_t hctx, bufferlist *in, bufferlist
 	    int(remove_entry.meta.category));
     unaccount_entry(header, remove_entry);
 
+    ret = reshard_log_record(hctx, header, remove_key.name);
+    if (ret < 0) {
+      return ret;
+    }
+
     if (op.log_op && !header.syncstopped) {
       ++header.ver; // increment index version, or we'll overwrite keys previously written
       rc = log_index_operation(hctx, remove_key, CLS_RGW_OP_DEL, op.tag, remove_entry.meta.mtime,
@@ -1539,6 +1654,11 @@ static int rgw_bucket_link_olh(cls_method_context_t hctx, bufferlist *in, buffer
     return ret;
   }
 
+  ret = reshard_log_record(hctx, header, op.key.name);
+  if (ret < 0) {
+    return ret;
+  }
+
   if (op.log_op && !header.syncstopped) {
     rgw_bucket_dir_entry& entry = obj.get_dir_entry();
 
@@ -1698,6 +1818,11 @@ static int rgw_bucket_unlink_instance(cls_method_context_t hctx, bufferlist *in,
     return ret;
   }
 
+  ret = reshard_log_record(hctx, header, op.key.name);
+  if (ret < 0) {
+    return ret;
+  }
+
   if (op.log_op && !header.syncstopped) {
     rgw_bucket_entry_ver ver;
     ver.epoch = (op.olh_epoch ? op.olh_epoch : olh.get_epoch());
@@ -1818,7 +1943,7 @@ static int rgw_bucket_trim_olh_log(cls_method_context_t hctx, bufferlist *in, bu
     return ret;
   }
 
-  return 0;
+  return reshard_log_record(hctx, op.olh.name);
 }
 
 static int rgw_bucket_clear_olh(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
@@ -1859,6 +1984,11 @@ static int rgw_bucket_clear_olh(cls_method_context_t hctx, bufferlist *in, buffe
     return ret;
   }
 
+  ret = reshard_log_record(hctx, op.key.name);
+  if (ret < 0) {
+    return ret;
+  }
+
   rgw_bucket_dir_entry plain_entry;
 
   /* read plain entry, make sure it's a versioned place holder */
@@ -1955,6 +2085,10 @@ int rgw_dir_suggest_changes(cls_method_context_t hctx,
 	    (int)cur_change.pending_map.size(), cur_change.exists);
 
     if (cur_disk.pending_map.empty()) {
+      ret = reshard_log_record(hctx, header, cur_change.key.name);
+      if (ret < 0) {
+        return ret;
+      }
       if (cur_disk.exists) {
         rgw_bucket_category_stats& old_stats = header.stats[cur_disk.meta.category];
         CLS_LOG(10, "total_entries: %" PRId64 " -> %" PRId64 "\n", old_stats.num_entries, old_stats.num_entries - 1);
@@ -3781,6 +3915,119 @@ static int rgw_reshard_remove(cls_method_context_t hctx, bufferlist *in, bufferl
   return ret;
 }
 
+static int reshard_log_clear(cls_method_context_t hctx)
+{
+  string key_begin;
+  key_begin.push_back(BI_PREFIX_CHAR);
+  key_begin.append(bucket_index_prefixes[BI_BUCKET_RESHARD_LOG_INDEX]);
+
+  string key_end;
+  key_end.push_back(BI_PREFIX_CHAR);
+  key_end.append(bucket_index_prefixes[BI_BUCKET_RESHARD_LOG_INDEX + 1]);
+
+  int rc = cls_cxx_map_remove_range(hctx, key_begin, key_end);
+  if (rc < 0) {
+    CLS_LOG(1, "ERROR: %s(): cls_cxx_map_remove_range failed rc=%d", __func__, rc);
+  }
+  return rc;
+}
+
+static int rgw_reshard_log_list(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
+{
+  cls_rgw_reshard_log_list_op op;
+  auto in_iter = in->cbegin();
+  try {
+    decode(op, in_iter);
+  } catch (buffer::error& err) {
+    CLS_LOG(1, "ERROR: %s(): failed to decode request\n", __func__);
+    return -EINVAL;
+  }
+
+  string filter_prefix;
+  filter_prefix.push_back(BI_PREFIX_CHAR);
+  filter_prefix.append(bucket_index_prefixes[BI_BUCKET_RESHARD_LOG_INDEX]);
+
+  // the bare prefix sorts before every entry, so an empty marker lists
+  // from the start
+  string start_after;
+  reshard_log_index_key(op.marker, &start_after);
+
+  map<string, bufferlist> keys;
+  cls_rgw_reshard_log_list_ret op_ret;
+  int rc = cls_cxx_map_get_vals(hctx, start_after, filter_prefix,
+                                std::min<uint32_t>(op.max, 1000), &keys,
+                                &op_ret.is_truncated);
+  if (rc < 0) {
+    return rc;
+  }
+
+  for (auto& kv : keys) {
+    uint64_t ver;
+    try {
+      auto iter = kv.second.cbegin();
+      decode(ver, iter);
+    } catch (buffer::error& err) {
+      CLS_LOG(1, "ERROR: %s(): failed to decode record %s", __func__,
+              escape_str(kv.first).c_str());
+      return -EIO;
+    }
+    op_ret.entries[kv.first.substr(filter_prefix.size())] = ver;
+  }
+
+  encode(op_ret, *out);
+  return 0;
+}
+
+/*
+ * Drop the records the reshard copied.  A record whose version changed
+ * since it was listed belongs to a write that may not have been seen
+ * by the copy, and is kept for the next pass.
+ */
+static int rgw_reshard_log_trim(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
+{
+  cls_rgw_reshard_log_trim_op op;
+  auto in_iter = in->cbegin();
+  try {
+    decode(op, in_iter);
+  } catch (buffer::error& err) {
+    CLS_LOG(1, "ERROR: %s(): failed to decode request\n", __func__);
+    return -EINVAL;
+  }
+
+  for (auto& [name, ver] : op.entries) {
+    string key;
+    reshard_log_index_key(name, &key);
+    bufferlist bl;
+    int rc = cls_cxx_map_get_val(hctx, key, &bl);
+    if (rc == -ENOENT) {
+      continue;
+    }
+    if (rc < 0) {
+      return rc;
+    }
+    uint64_t cur_ver;
+    try {
+      auto iter = bl.cbegin();
+      decode(cur_ver, iter);
+    } catch (buffer::error& err) {
+      CLS_LOG(1, "ERROR: %s(): failed to decode record of %s", __func__,
+              escape_str(name).c_str());
+      return -EIO;
+    }
+    if (cur_ver != ver) {
+      continue;
+    }
+    rc = cls_cxx_map_remove_key(hctx, key);
+    if (rc < 0) {
+      CLS_LOG(1, "ERROR: %s(): failed to remove record of %s rc=%d", __func__,
+              escape_str(name).c_str(), rc);
+      return rc;
+    }
+  }
+
+  return 0;
+}
+
 static int rgw_set_bucket_resharding(cls_method_context_t hctx, bufferlist *in,  bufferlist *out)
 {
   cls_rgw_set_bucket_resharding_op op;
@@ -3800,8 +4047,20 @@ static int rgw_set_bucket_resharding(cls_method_context_t hctx, bufferlist *in,
     return rc;
   }
 
+  const auto prev_status = header.new_instance.reshard_status;
   header.new_instance.set_status(op.entry.new_bucket_instance_id, op.entry.num_shards, op.entry.reshard_status);
 
+  // start an online reshard with an empty log, and drop the log once
+  // the reshard is over; a resumed reshard keeps what was logged so far
+  if ((header.resharding_log_record() &&
+       prev_status == CLS_RGW_RESHARD_NOT_RESHARDING) ||
+      op.entry.reshard_status == CLS_RGW_RESHARD_NOT_RESHARDING) {
+    rc = reshard_log_clear(hctx);
+    if (rc < 0) {
+      return rc;
+    }
+  }
+
   return write_bucket_header(hctx, &header);
 }
 
@@ -3825,6 +4084,11 @@ static int rgw_clear_bucket_resharding(cls_method_context_t hctx, bufferlist *in
   }
   header.new_instance.clear();
 
+  rc = reshard_log_clear(hctx);
+  if (rc < 0) {
+    return rc;
+  }
+
   return write_bucket_header(hctx, &header);
 }
 
@@ -3933,6 +4197,8 @@ CLS_INIT(rgw)
   cls_method_handle_t h_rgw_clear_bucket_resharding;
   cls_method_handle_t h_rgw_guard_bucket_resharding;
   cls_method_handle_t h_rgw_get_bucket_resharding;
+  cls_method_handle_t h_rgw_reshard_log_list;
+  cls_method_handle_t h_rgw_reshard_log_trim;
 
   cls_register(RGW_CLASS, &h_class);
 
@@ -4003,6 +4269,10 @@ CLS_INIT(rgw)
 			  rgw_guard_bucket_resharding, &h_rgw_guard_bucket_resharding);
   cls_register_cxx_method(h_class, RGW_GET_BUCKET_RESHARDING, CLS_METHOD_RD ,
 			  rgw_get_bucket_resharding, &h_rgw_get_bucket_resharding);
+  cls_register_cxx_method(h_class, RGW_RESHARD_LOG_LIST, CLS_METHOD_RD,
+			  rgw_reshard_log_list, &h_rgw_reshard_log_list);
+  cls_register_cxx_method(h_class, RGW_RESHARD_LOG_TRIM, CLS_METHOD_RD | CLS_METHOD_WR,
+			  rgw_reshard_log_trim, &h_rgw_reshard_log_trim);
 
   return;
 }
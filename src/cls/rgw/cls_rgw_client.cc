@@ -210,6 +210,7 @@ void cls_rgw_bucket_complete_op(ObjectWriteOperation& o, RGWModifyOp op, string&
 void cls_rgw_bucket_list_op(librados::ObjectReadOperation& op,
                             const cls_rgw_obj_key& start_obj,
                             const std::string& filter_prefix,
+                            const std::string& delimiter,
                             uint32_t num_entries,
                             bool list_versions,
                             rgw_cls_list_ret* result)
@@ -218,6 +219,7 @@ void cls_rgw_bucket_list_op(librados::ObjectReadOperation& op,
   rgw_cls_list_op call;
   call.start_obj = start_obj;
   call.filter_prefix = filter_prefix;
+  call.delimiter = delimiter;
   call.num_entries = num_entries;
   call.list_versions = list_versions;
   encode(call, in);
@@ -228,18 +230,19 @@ void cls_rgw_bucket_list_op(librados::ObjectReadOperation& op,
 static bool issue_bucket_list_op(librados::IoCtx& io_ctx, const string& oid,
 				 const cls_rgw_obj_key& start_obj,
 				 const string& filter_prefix,
+				 const string& delimiter,
 				 uint32_t num_entries, bool list_versions,
 				 BucketIndexAioManager *manager,
 				 rgw_cls_list_ret *pdata) {
   librados::ObjectReadOperation op;
-  cls_rgw_bucket_list_op(op, start_obj, filter_prefix,
+  cls_rgw_bucket_list_op(op, start_obj, filter_prefix, delimiter,
                          num_entries, list_versions, pdata);
   return manager->aio_operate(io_ctx, oid, &op);
 }
 
 int CLSRGWIssueBucketList::issue_op(int shard_id, const string& oid)
 {
-  return issue_bucket_list_op(io_ctx, oid, start_obj, filter_prefix, num_entries, list_versions, &manager, &result[shard_id]);
+  return issue_bucket_list_op(io_ctx, oid, start_obj, filter_prefix, delimiter, num_entries, list_versions, &manager, &result[shard_id]);
 }
 
 void cls_rgw_remove_obj(librados::ObjectWriteOperation& o, list<string>& keep_attr_prefixes)
@@ -578,7 +581,7 @@ void cls_rgw_suggest_changes(ObjectWriteOperation& o, bufferlist& updates)
 int CLSRGWIssueGetDirHeader::issue_op(int shard_id, const string& oid)
 {
   cls_rgw_obj_key nokey;
-  return issue_bucket_list_op(io_ctx, oid, nokey, "", 0, false, &manager, &result[shard_id]);
+  return issue_bucket_list_op(io_ctx, oid, nokey, "", "", 0, false, &manager, &result[shard_id]);
 }
 
 static bool issue_resync_bi_log(librados::IoCtx& io_ctx, const string& oid, BucketIndexAioManager *manager)
@@ -1030,6 +1033,44 @@ int cls_rgw_get_bucket_resharding(librados::IoCtx& io_ctx, const string& oid,
   return 0;
 }
 
+int cls_rgw_reshard_log_list(librados::IoCtx& io_ctx, const string& oid,
+                             const string& marker, uint32_t max,
+                             map<string, uint64_t> *entries,
+                             bool *is_truncated)
+{
+  bufferlist in, out;
+  cls_rgw_reshard_log_list_op call;
+  call.marker = marker;
+  call.max = max;
+  encode(call, in);
+  int r = io_ctx.exec(oid, RGW_CLASS, RGW_RESHARD_LOG_LIST, in, out);
+  if (r < 0)
+    return r;
+
+  cls_rgw_reshard_log_list_ret op_ret;
+  auto iter = out.cbegin();
+  try {
+    decode(op_ret, iter);
+  } catch (buffer::error& err) {
+    return -EIO;
+  }
+
+  entries->swap(op_ret.entries);
+  *is_truncated = op_ret.is_truncated;
+
+  return 0;
+}
+
+void cls_rgw_reshard_log_trim(librados::ObjectWriteOperation& op,
+                              const map<string, uint64_t>& entries)
+{
+  bufferlist in;
+  cls_rgw_reshard_log_trim_op call;
+  call.entries = entries;
+  encode(call, in);
+  op.exec(RGW_CLASS, RGW_RESHARD_LOG_TRIM, in);
+}
+
 void cls_rgw_guard_bucket_resharding(librados::ObjectOperation& op, int ret_err)
 {
   bufferlist in, out;
@@ -418,6 +418,9 @@ int cls_rgw_usage_log_trim(librados::IoCtx& io_ctx, const string& oid, const str
  * io_ctx        - IO context for rados.
  * start_obj     - marker for the listing.
  * filter_prefix - filter prefix.
+ * delimiter     - if not empty, each shard returns a single entry flagged
+ *                 RGW_BUCKET_DIRENT_FLAG_COMMON_PREFIX for every common
+ *                 prefix, instead of the entries under it.
  * num_entries   - number of entries to request for each object (note the total
  *                 amount of entries returned depends on the number of shardings).
  * list_results  - the list results keyed by bucket index object id.
@@ -429,6 +432,7 @@ int cls_rgw_usage_log_trim(librados::IoCtx& io_ctx, const string& oid, const str
 class CLSRGWIssueBucketList : public CLSRGWConcurrentIO {
   cls_rgw_obj_key start_obj;
   string filter_prefix;
+  string delimiter;
   uint32_t num_entries;
   bool list_versions;
   map<int, rgw_cls_list_ret>& result;
@@ -436,18 +440,20 @@ protected:
   int issue_op(int shard_id, const string& oid) override;
 public:
   CLSRGWIssueBucketList(librados::IoCtx& io_ctx, const cls_rgw_obj_key& _start_obj,
-                        const string& _filter_prefix, uint32_t _num_entries,
+                        const string& _filter_prefix, const string& _delimiter,
+                        uint32_t _num_entries,
                         bool _list_versions,
                         map<int, string>& oids,
                         map<int, rgw_cls_list_ret>& list_results,
                         uint32_t max_aio) :
   CLSRGWConcurrentIO(io_ctx, oids, max_aio),
-  start_obj(_start_obj), filter_prefix(_filter_prefix), num_entries(_num_entries), list_versions(_list_versions), result(list_results) {}
+  start_obj(_start_obj), filter_prefix(_filter_prefix), delimiter(_delimiter), num_entries(_num_entries), list_versions(_list_versions), result(list_results) {}
 };
 
 void cls_rgw_bucket_list_op(librados::ObjectReadOperation& op,
                             const cls_rgw_obj_key& start_obj,
                             const std::string& filter_prefix,
+                            const std::string& delimiter,
                             uint32_t num_entries,
                             bool list_versions,
                             rgw_cls_list_ret* result);
@@ -629,5 +635,11 @@ int cls_rgw_clear_bucket_resharding(librados::IoCtx& io_ctx, const string& oid);
 int cls_rgw_get_bucket_resharding(librados::IoCtx& io_ctx, const string& oid,
                                   cls_rgw_bucket_instance_entry *entry);
 #endif
+int cls_rgw_reshard_log_list(librados::IoCtx& io_ctx, const string& oid,
+                             const string& marker, uint32_t max,
+                             map<string, uint64_t> *entries,
+                             bool *is_truncated);
+void cls_rgw_reshard_log_trim(librados::ObjectWriteOperation& op,
+                              const map<string, uint64_t>& entries);
 
 #endif
@@ -71,5 +71,7 @@
 #define RGW_CLEAR_BUCKET_RESHARDING "clear_bucket_resharding"
 #define RGW_GUARD_BUCKET_RESHARDING "guard_bucket_resharding"
 #define RGW_GET_BUCKET_RESHARDING "get_bucket_resharding"
+#define RGW_RESHARD_LOG_LIST "reshard_log_list"
+#define RGW_RESHARD_LOG_TRIM "reshard_log_trim"
 
 #endif
@@ -291,6 +291,7 @@ void rgw_cls_list_op::generate_test_instances(list<rgw_cls_list_op*>& o)
   op->start_obj.name = "start_obj";
   op->num_entries = 100;
   op->filter_prefix = "filter_prefix";
+  op->delimiter = "/";
   o.push_back(op);
   o.push_back(new rgw_cls_list_op);
 }
@@ -299,6 +300,7 @@ void rgw_cls_list_op::dump(Formatter *f) const
 {
   f->dump_string("start_obj", start_obj.name);
   f->dump_unsigned("num_entries", num_entries);
+  f->dump_string("delimiter", delimiter);
 }
 
 void rgw_cls_list_ret::generate_test_instances(list<rgw_cls_list_ret*>& o)
@@ -312,6 +314,7 @@ void rgw_cls_list_ret::generate_test_instances(list<rgw_cls_list_ret*>& o)
     rgw_cls_list_ret *ret = new rgw_cls_list_ret;
     ret->dir = *d;
     ret->is_truncated = true;
+    ret->marker.name = "marker";
 
     o.push_back(ret);
 
@@ -327,6 +330,7 @@ void rgw_cls_list_ret::dump(Formatter *f) const
   dir.dump(f);
   f->close_section();
   f->dump_int("is_truncated", (int)is_truncated);
+  encode_json("marker", marker, f);
 }
 
 void rgw_cls_check_index_ret::generate_test_instances(list<rgw_cls_check_index_ret*>& o)
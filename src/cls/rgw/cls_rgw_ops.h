@@ -383,19 +383,21 @@ struct rgw_cls_list_op
   uint32_t num_entries;
   string filter_prefix;
   bool list_versions;
+  string delimiter; // if set, collapse each common prefix into one entry
 
   rgw_cls_list_op() : num_entries(0), list_versions(false) {}
 
   void encode(bufferlist &bl) const {
-    ENCODE_START(5, 4, bl);
+    ENCODE_START(6, 4, bl);
     encode(num_entries, bl);
     encode(filter_prefix, bl);
     encode(start_obj, bl);
     encode(list_versions, bl);
+    encode(delimiter, bl);
     ENCODE_FINISH(bl);
   }
   void decode(bufferlist::const_iterator &bl) {
-    DECODE_START_LEGACY_COMPAT_LEN(5, 2, 2, bl);
+    DECODE_START_LEGACY_COMPAT_LEN(6, 2, 2, bl);
     if (struct_v < 4) {
       decode(start_obj.name, bl);
     }
@@ -406,6 +408,8 @@ struct rgw_cls_list_op
       decode(start_obj, bl);
     if (struct_v >= 5)
       decode(list_versions, bl);
+    if (struct_v >= 6)
+      decode(delimiter, bl);
     DECODE_FINISH(bl);
   }
   void dump(Formatter *f) const;
@@ -416,19 +420,27 @@ WRITE_CLASS_ENCODER(rgw_cls_list_op)
 struct rgw_cls_list_ret {
   rgw_bucket_dir dir;
   bool is_truncated;
+  // the last index key this shard considered, whether returned or
+  // skipped; a truncated listing has nothing left that sorts at or
+  // before it
+  cls_rgw_obj_key marker;
 
   rgw_cls_list_ret() : is_truncated(false) {}
 
   void encode(bufferlist &bl) const {
-    ENCODE_START(2, 2, bl);
+    ENCODE_START(3, 2, bl);
     encode(dir, bl);
     encode(is_truncated, bl);
+    encode(marker, bl);
     ENCODE_FINISH(bl);
   }
   void decode(bufferlist::const_iterator &bl) {
-    DECODE_START_LEGACY_COMPAT_LEN(2, 2, 2, bl);
+    DECODE_START_LEGACY_COMPAT_LEN(3, 2, 2, bl);
     decode(dir, bl);
     decode(is_truncated, bl);
+    if (struct_v >= 3) {
+      decode(marker, bl);
+    }
     DECODE_FINISH(bl);
   }
   void dump(Formatter *f) const;
@@ -1426,4 +1438,64 @@ struct cls_rgw_get_bucket_resharding_ret  {
 };
 WRITE_CLASS_ENCODER(cls_rgw_get_bucket_resharding_ret)
 
+struct cls_rgw_reshard_log_list_op {
+  string marker;
+  uint32_t max{0};
+
+  void encode(bufferlist& bl) const {
+    ENCODE_START(1, 1, bl);
+    encode(marker, bl);
+    encode(max, bl);
+    ENCODE_FINISH(bl);
+  }
+
+  void decode(bufferlist::const_iterator& bl) {
+    DECODE_START(1, bl);
+    decode(marker, bl);
+    decode(max, bl);
+    DECODE_FINISH(bl);
+  }
+};
+WRITE_CLASS_ENCODER(cls_rgw_reshard_log_list_op)
+
+struct cls_rgw_reshard_log_list_ret {
+  // names of the objects whose index entries changed while the shard
+  // was in CLS_RGW_RESHARD_IN_LOGRECORD, with the version of each record
+  map<string, uint64_t> entries;
+  bool is_truncated{false};
+
+  void encode(bufferlist& bl) const {
+    ENCODE_START(1, 1, bl);
+    encode(entries, bl);
+    encode(is_truncated, bl);
+    ENCODE_FINISH(bl);
+  }
+
+  void decode(bufferlist::const_iterator& bl) {
+    DECODE_START(1, bl);
+    decode(entries, bl);
+    decode(is_truncated, bl);
+    DECODE_FINISH(bl);
+  }
+};
+WRITE_CLASS_ENCODER(cls_rgw_reshard_log_list_ret)
+
+struct cls_rgw_reshard_log_trim_op {
+  // records to drop, each only if its version is still the one listed
+  map<string, uint64_t> entries;
+
+  void encode(bufferlist& bl) const {
+    ENCODE_START(1, 1, bl);
+    encode(entries, bl);
+    ENCODE_FINISH(bl);
+  }
+
+  void decode(bufferlist::const_iterator& bl) {
+    DECODE_START(1, bl);
+    decode(entries, bl);
+    DECODE_FINISH(bl);
+  }
+};
+WRITE_CLASS_ENCODER(cls_rgw_reshard_log_trim_op)
+
 #endif /* CEPH_CLS_RGW_OPS_H */
@@ -656,6 +656,10 @@ void cls_rgw_reshard_entry::dump(Formatter *f) const
   encode_json("new_instance_id", new_instance_id, f);
   encode_json("old_num_shards", old_num_shards, f);
   encode_json("new_num_shards", new_num_shards, f);
+  if (checkpoint_shard >= 0) {
+    encode_json("checkpoint_shard", checkpoint_shard, f);
+    encode_json("checkpoint_marker", checkpoint_marker, f);
+  }
 
 }
 
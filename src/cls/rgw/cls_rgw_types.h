@@ -330,6 +330,7 @@ WRITE_CLASS_ENCODER(cls_rgw_obj_key)
 #define RGW_BUCKET_DIRENT_FLAG_CURRENT       0x2    /* the last object instance of a versioned object */
 #define RGW_BUCKET_DIRENT_FLAG_DELETE_MARKER 0x4    /* delete marker */
 #define RGW_BUCKET_DIRENT_FLAG_VER_MARKER    0x8    /* object is versioned, a placeholder for the plain entry */
+#define RGW_BUCKET_DIRENT_FLAG_COMMON_PREFIX 0x8000 /* generated by the osd for a delimited listing; stands for a common prefix */
 
 struct rgw_bucket_dir_entry {
   cls_rgw_obj_key key;
@@ -403,6 +404,9 @@ struct rgw_bucket_dir_entry {
     return is_current() && !is_delete_marker();
   }
   bool is_valid() { return (flags & RGW_BUCKET_DIRENT_FLAG_VER_MARKER) == 0; }
+  bool is_common_prefix() const {
+    return (flags & RGW_BUCKET_DIRENT_FLAG_COMMON_PREFIX) != 0;
+  }
 
   void dump(Formatter *f) const;
   void decode_json(JSONObj *obj);
@@ -642,6 +646,7 @@ enum cls_rgw_reshard_status {
   CLS_RGW_RESHARD_NOT_RESHARDING  = 0,
   CLS_RGW_RESHARD_IN_PROGRESS     = 1,
   CLS_RGW_RESHARD_DONE            = 2,
+  CLS_RGW_RESHARD_IN_LOGRECORD    = 3, /* online copy; writes are logged, not blocked */
 };
 
 static inline std::string to_string(const enum cls_rgw_reshard_status status)
@@ -656,6 +661,9 @@ static inline std::string to_string(const enum cls_rgw_reshard_status status)
   case CLS_RGW_RESHARD_DONE:
     return "done";
     break;
+  case CLS_RGW_RESHARD_IN_LOGRECORD:
+    return "in-logrecord";
+    break;
   default:
     break;
   };
@@ -699,12 +707,17 @@ struct cls_rgw_bucket_instance_entry {
     num_shards = new_num_shards;
   }
 
+  // true while index writes must wait for the reshard
   bool resharding() const {
-    return reshard_status != CLS_RGW_RESHARD_NOT_RESHARDING;
+    return reshard_status != CLS_RGW_RESHARD_NOT_RESHARDING &&
+      reshard_status != CLS_RGW_RESHARD_IN_LOGRECORD;
   }
   bool resharding_in_progress() const {
     return reshard_status == CLS_RGW_RESHARD_IN_PROGRESS;
   }
+  bool resharding_log_record() const {
+    return reshard_status == CLS_RGW_RESHARD_IN_LOGRECORD;
+  }
 };
 WRITE_CLASS_ENCODER(cls_rgw_bucket_instance_entry)
 
@@ -766,6 +779,9 @@ struct rgw_bucket_dir_header {
   bool resharding_in_progress() const {
     return new_instance.resharding_in_progress();
   }
+  bool resharding_log_record() const {
+    return new_instance.resharding_log_record();
+  }
 };
 WRITE_CLASS_ENCODER(rgw_bucket_dir_header)
 
@@ -975,27 +991,32 @@ struct cls_rgw_obj {
   string pool;
   cls_rgw_obj_key key;
   string loc;
+  uint64_t size{0}; /* 0 if unknown */
 
   cls_rgw_obj() {}
   cls_rgw_obj(string& _p, cls_rgw_obj_key& _k) : pool(_p), key(_k) {}
 
   void encode(bufferlist& bl) const {
-    ENCODE_START(2, 1, bl);
+    ENCODE_START(3, 1, bl);
     encode(pool, bl);
     encode(key.name, bl);
     encode(loc, bl);
     encode(key, bl);
+    encode(size, bl);
     ENCODE_FINISH(bl);
   }
 
   void decode(bufferlist::const_iterator& bl) {
-    DECODE_START(2, bl);
+    DECODE_START(3, bl);
     decode(pool, bl);
     decode(key.name, bl);
     decode(loc, bl);
     if (struct_v >= 2) {
       decode(key, bl);
     }
+    if (struct_v >= 3) {
+      decode(size, bl);
+    }
     DECODE_FINISH(bl);
   }
 
@@ -1004,6 +1025,7 @@ struct cls_rgw_obj {
     f->dump_string("oid", key.name);
     f->dump_string("key", loc);
     f->dump_string("instance", key.instance);
+    f->dump_unsigned("size", size);
   }
   static void generate_test_instances(list<cls_rgw_obj*>& ls) {
     ls.push_back(new cls_rgw_obj);
@@ -1020,11 +1042,13 @@ struct cls_rgw_obj_chain {
 
   cls_rgw_obj_chain() {}
 
-  void push_obj(const string& pool, const cls_rgw_obj_key& key, const string& loc) {
+  void push_obj(const string& pool, const cls_rgw_obj_key& key, const string& loc,
+                uint64_t size = 0) {
     cls_rgw_obj obj;
     obj.pool = pool;
     obj.key = key;
     obj.loc = loc;
+    obj.size = size;
     objs.push_back(obj);
   }
 
@@ -1138,11 +1162,20 @@ struct cls_rgw_reshard_entry
   string new_instance_id;
   uint32_t old_num_shards{0};
   uint32_t new_num_shards{0};
+  /* progress of an online reshard: source shards before
+   * checkpoint_shard, and that shard up to checkpoint_marker, are
+   * copied to new_instance_id */
+  int32_t checkpoint_shard{-1};
+  string checkpoint_marker;
 
   cls_rgw_reshard_entry() {}
 
+  bool has_checkpoint() const {
+    return !new_instance_id.empty() && checkpoint_shard >= 0;
+  }
+
   void encode(bufferlist& bl) const {
-    ENCODE_START(1, 1, bl);
+    ENCODE_START(2, 1, bl);
     encode(time, bl);
     encode(tenant, bl);
     encode(bucket_name, bl);
@@ -1150,11 +1183,13 @@ struct cls_rgw_reshard_entry
     encode(new_instance_id, bl);
     encode(old_num_shards, bl);
     encode(new_num_shards, bl);
+    encode(checkpoint_shard, bl);
+    encode(checkpoint_marker, bl);
     ENCODE_FINISH(bl);
   }
 
   void decode(bufferlist::const_iterator& bl) {
-    DECODE_START(1, bl);
+    DECODE_START(2, bl);
     decode(time, bl);
     decode(tenant, bl);
     decode(bucket_name, bl);
@@ -1162,6 +1197,10 @@ struct cls_rgw_reshard_entry
     decode(new_instance_id, bl);
     decode(old_num_shards, bl);
     decode(new_num_shards, bl);
+    if (struct_v >= 2) {
+      decode(checkpoint_shard, bl);
+      decode(checkpoint_marker, bl);
+    }
     DECODE_FINISH(bl);
   }
 
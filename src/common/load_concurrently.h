@@ -0,0 +1,85 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#ifndef CEPH_COMMON_LOAD_CONCURRENTLY_H
+#define CEPH_COMMON_LOAD_CONCURRENTLY_H
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "common/ceph_mutex.h"
+#include "common/Thread.h"
+
+namespace ceph {
+
+/**
+ * Call load(item) for each of items from up to num_threads threads named
+ * name, and pass every item to loaded(item) on the calling thread as soon
+ * as its load completes, so that whatever follows a load overlaps with
+ * the remaining ones.  Items reach loaded() in the order their loads
+ * complete.  With num_threads <= 1 (or a single item) everything runs on
+ * the calling thread, in order.
+ */
+template <typename T, typename Load, typename Loaded>
+void load_concurrently(std::string_view name,
+		       const std::vector<T>& items,
+		       uint64_t num_threads,
+		       Load&& load,
+		       Loaded&& loaded)
+{
+  num_threads = std::min<uint64_t>(num_threads, items.size());
+  if (num_threads <= 1) {
+    for (auto& item : items) {
+      load(item);
+      loaded(item);
+    }
+    return;
+  }
+
+  ceph::mutex lock = ceph::make_mutex("load_concurrently::lock");
+  ceph::condition_variable cond;
+  std::deque<size_t> done;
+  std::atomic<size_t> next = {0};
+  std::vector<std::thread> loaders;
+  for (uint64_t i = 0; i < num_threads; ++i) {
+    loaders.push_back(make_named_thread(name, [&] {
+      for (size_t n = next++; n < items.size(); n = next++) {
+	load(items[n]);
+	std::lock_guard l(lock);
+	done.push_back(n);
+	cond.notify_one();
+      }
+    }));
+  }
+
+  for (size_t i = 0; i < items.size(); ++i) {
+    size_t n;
+    {
+      std::unique_lock l(lock);
+      cond.wait(l, [&] { return !done.empty(); });
+      n = done.front();
+      done.pop_front();
+    }
+    loaded(items[n]);
+  }
+  for (auto& t : loaders) {
+    t.join();
+  }
+}
+
+} // namespace ceph
+
+#endif
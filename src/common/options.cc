@@ -1123,6 +1123,37 @@ std::vector<Option> get_global_options() {
     .set_description("Maximum threadpool size of AsyncMessenger")
     .add_see_also("ms_async_op_threads"),
 
+    Option("ms_async_rx_buffer_pool_size", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("Number of page-aligned receive buffers each msgr2 connection keeps for reuse by message data payloads")
+    .set_long_description("Buffers are only reused once the previous message no longer references them. Each pooled buffer is as large as the largest payload it has received, so memory use grows with connections times this value; 0 disables the pool."),
+
+    Option("ms_async_affinity_cores", Option::TYPE_STR, Option::LEVEL_ADVANCED)
+    .set_default("")
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("List of cores to pin AsyncMessenger worker threads to")
+    .set_long_description("Each worker thread is pinned to a single core from this list (e.g. 0-3,8-11); workers are spread round-robin over the numa nodes the list covers. Empty means no pinning.")
+    .add_see_also("ms_async_numa_node"),
+
+    Option("ms_async_numa_node", Option::TYPE_INT, Option::LEVEL_ADVANCED)
+    .set_default(-1)
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("Pin AsyncMessenger worker threads to the cores of this numa node (-1 for none)")
+    .add_see_also("ms_async_affinity_cores"),
+
+    Option("ms_async_bind_numa_memory", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(true)
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("Prefer memory from the local numa node for allocations made by pinned AsyncMessenger workers")
+    .add_see_also("ms_async_affinity_cores"),
+
+    Option("ms_async_steer_incoming_cpu", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("Hand accepted connections to the worker pinned closest to the core receiving their packets (SO_INCOMING_CPU)")
+    .set_long_description("Only useful together with pinned workers and NIC receive queues whose interrupts are spread over the same cores.")
+    .add_see_also("ms_async_affinity_cores"),
+
     Option("ms_async_rdma_device_name", Option::TYPE_STR, Option::LEVEL_ADVANCED)
     .set_default("")
     .set_description(""),
@@ -2784,6 +2815,11 @@ std::vector<Option> get_global_options() {
     .set_default(true)
     .set_description(""),
 
+    Option("osd_load_pgs_threads", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(8)
+    .set_description("Number of threads reading the state and log of the PGs when the OSD starts")
+    .set_long_description("The PGs are loaded concurrently by that many threads and registered as they complete; 0 or 1 loads them one after the other."),
+
     Option("osd_op_num_threads_per_shard", Option::TYPE_INT, Option::LEVEL_ADVANCED)
     .set_default(0)
     .set_flag(Option::FLAG_STARTUP)
@@ -2907,6 +2943,12 @@ std::vector<Option> get_global_options() {
     .set_default(false)
     .set_description(""),
 
+    Option("osd_ec_parity_delta_writes", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_flag(Option::FLAG_RUNTIME)
+    .set_description("Update parity in place for small overwrites of erasure coded objects")
+    .set_long_description("When a write only changes a few data chunks of the stripes it overwrites, read just those chunks and the coding chunks and update the parity from the difference between the old and new data, instead of reading and re-encoding the whole stripes. Only used with plugins that support it, such as jerasure and isa Reed-Solomon, and when all the shards of the object are available."),
+
     Option("osd_recover_clone_overlap_limit", Option::TYPE_INT, Option::LEVEL_ADVANCED)
     .set_default(10)
     .set_description(""),
@@ -3889,6 +3931,18 @@ std::vector<Option> get_global_options() {
     .set_default(16)
     .set_description(""),
 
+    Option("bdev_ioring", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_description("Enables Linux io_uring API instead of libaio")
+    .set_long_description("Applies to the main block device, and to a db or wal device that shares it. If the running kernel lacks io_uring support, or ceph was built without liburing, KernelDevice falls back to libaio.")
+    .add_see_also("bluestore_block_db_ioring")
+    .add_see_also("bluestore_block_wal_ioring"),
+
+    Option("bdev_ioring_sqthread_poll", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_description("Use a kernel thread to poll the io_uring submission queue")
+    .set_long_description("A kernel thread polls the submission queue, so that IO can be submitted without a system call. This burns a CPU core while the device is busy."),
+
     Option("bdev_block_size", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
     .set_default(4_K)
     .set_description(""),
@@ -4077,6 +4131,12 @@ std::vector<Option> get_global_options() {
     .add_see_also("bluestore_block_db_path")
     .add_see_also("bluestore_block_db_size"),
 
+    Option("bluestore_block_db_ioring", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_description("Use io_uring instead of libaio for a separate db device")
+    .add_see_also("bdev_ioring")
+    .add_see_also("bluestore_block_db_path"),
+
     Option("bluestore_block_wal_path", Option::TYPE_STR, Option::LEVEL_DEV)
     .set_default("")
     .set_flag(Option::FLAG_CREATE)
@@ -4094,6 +4154,12 @@ std::vector<Option> get_global_options() {
     .add_see_also("bluestore_block_wal_path")
     .add_see_also("bluestore_block_wal_size"),
 
+    Option("bluestore_block_wal_ioring", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_description("Use io_uring instead of libaio for a separate wal device")
+    .add_see_also("bdev_ioring")
+    .add_see_also("bluestore_block_wal_path"),
+
     Option("bluestore_block_preallocate_file", Option::TYPE_BOOL, Option::LEVEL_DEV)
     .set_default(false)
     .set_flag(Option::FLAG_CREATE)
@@ -4275,6 +4341,14 @@ std::vector<Option> get_global_options() {
     .set_enum_allowed({"2q", "lru"})
     .set_description("Cache replacement algorithm"),
 
+    Option("bluestore_onode_cache_type", Option::TYPE_STR, Option::LEVEL_ADVANCED)
+    .set_default("lru")
+    .set_enum_allowed({"lru", "clock"})
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("Onode cache replacement algorithm")
+    .set_long_description("clock keeps onodes on a CLOCK ring instead of an LRU list: cache hits only set a reference bit and take no cache shard lock, which reduces lock contention when many PGs share a cache shard.")
+    .add_see_also("bluestore_cache_type"),
+
     Option("bluestore_2q_cache_kin_ratio", Option::TYPE_FLOAT, Option::LEVEL_DEV)
     .set_default(.5)
     .set_description("2Q paper suggests .5"),
@@ -4330,6 +4404,16 @@ std::vector<Option> get_global_options() {
     .set_description("Allocator policy")
     .set_long_description("Allocator to use for bluestore.  Stupid should only be used for testing."),
 
+    Option("bluestore_alloc_snapshot", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_description("Persist the allocator state at umount to speed up the next mount")
+    .set_long_description("On a clean umount the free extents of the allocator are written to the kv store, tagged with the freelist generation. The next mount loads them with a single sequential read instead of scanning the whole freelist, as long as the freelist has not been modified since. Otherwise the freelist is scanned as usual."),
+
+    Option("bluestore_alloc_snapshot_chunk_extents", Option::TYPE_UINT, Option::LEVEL_DEV)
+    .set_default(65536)
+    .set_min(1)
+    .set_description("Number of free extents stored per kv record of the allocator snapshot"),
+
     Option("bluestore_freelist_blocks_per_key", Option::TYPE_SIZE, Option::LEVEL_DEV)
     .set_default(128)
     .set_description("Block (and bits) per database key"),
@@ -4558,6 +4642,11 @@ std::vector<Option> get_global_options() {
     .set_default(5)
     .set_description("log operation if it's slower than this age (seconds)"),
 
+    Option("bluestore_omap_readahead", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
+    .set_default(256_K)
+    .set_description("Readahead size for bulk omap range reads")
+    .set_long_description("When an omap range is read in one call (e.g. for OMAPGETVALS), bluestore bounds the underlying key-value iterator to the object's omap keys and asks it to prefetch this many bytes per sequential read. 0 leaves the key-value store default."),
+
     Option("bluestore_log_omap_iterator_age", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
     .set_default(5)
     .set_description("log omap iteration operation if it's slower than this age (seconds)"),
@@ -5395,6 +5484,35 @@ std::vector<Option> get_rgw_options() {
         "When full, the RGW metadata cache evicts least recently used entries.")
     .add_see_also("rgw_cache_enabled"),
 
+    Option("rgw_datacache_enabled", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("Enable RGW local object data cache.")
+    .set_long_description(
+        "The data cache stores tail data of objects read by GET requests in "
+        "files under rgw_datacache_path, ideally on a local SSD, and serves "
+        "repeated reads of the same data from there instead of from RADOS. "
+        "Entries are keyed on the object's tag, so overwritten objects are "
+        "never served stale. The cache is emptied when RGW starts.")
+    .add_see_also({"rgw_datacache_path", "rgw_datacache_size"}),
+
+    Option("rgw_datacache_path", Option::TYPE_STR, Option::LEVEL_ADVANCED)
+    .set_default("/var/lib/ceph/radosgw/$cluster-$id/datacache")
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("Directory for the RGW data cache.")
+    .set_long_description(
+        "Cache files left in this directory by a previous run are removed at "
+        "startup; other files are left alone.")
+    .add_see_also("rgw_datacache_enabled"),
+
+    Option("rgw_datacache_size", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
+    .set_default(1_G)
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("Max bytes stored in the RGW data cache.")
+    .set_long_description(
+        "When full, the data cache evicts least recently used entries.")
+    .add_see_also("rgw_datacache_enabled"),
+
     Option("rgw_socket_path", Option::TYPE_STR, Option::LEVEL_ADVANCED)
     .set_default("")
     .set_description("RGW FastCGI socket path (for FastCGI over Unix domain sockets).")
@@ -6097,6 +6215,21 @@ std::vector<Option> get_rgw_options() {
     .set_description("Max number of keys to remove from garbage collector log in a single operation")
     .add_see_also({"rgw_gc_max_objs", "rgw_gc_obj_min_wait", "rgw_gc_processor_max_time", "rgw_gc_max_concurrent_io"}),
 
+    Option("rgw_gc_max_concurrent_shards", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(4)
+    .set_min(1)
+    .set_description("Number of garbage collector shards processed in parallel")
+    .set_long_description(
+        "Each gc cycle processes up to this many gc log shards at a time, each "
+        "with its own window of rgw_gc_max_concurrent_io operations.")
+    .add_see_also({"rgw_gc_max_objs", "rgw_gc_max_concurrent_io"}),
+
+    Option("rgw_gc_process_batch_size", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(512)
+    .set_min(1)
+    .set_description("Number of gc log entries listed, processed and trimmed at a time")
+    .add_see_also({"rgw_gc_max_concurrent_shards"}),
+
     Option("rgw_gc_max_deferred_entries_size", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
     .set_default(3072)
     .set_description("maximum allowed size of deferred entries in queue head for gc"),
@@ -6560,6 +6693,46 @@ std::vector<Option> get_rgw_options() {
     .add_tag("performance")
     .add_service("rgw"),
 
+    Option("rgw_reshard_online", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(true)
+    .set_description("Copy bucket index entries while writes to the bucket continue")
+    .set_long_description(
+        "When enabled, writes to a bucket that is being resharded are "
+        "recorded in the old bucket index while its entries are copied, "
+        "and are only blocked for the short time it takes to copy the "
+        "recorded entries again before switching to the new index. When "
+        "disabled, writes are blocked for the whole reshard.")
+    .add_service("rgw")
+    .add_see_also({"rgw_reshard_checkpoint_interval"}),
+
+    Option("rgw_reshard_checkpoint_interval", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(30)
+    .set_description("Seconds between saving the progress of an online reshard")
+    .set_long_description(
+        "An online reshard that was interrupted after its progress was "
+        "saved is resumed from that point by the reshard thread instead "
+        "of starting over. Only applies to reshards from the reshard queue.")
+    .add_service("rgw")
+    .add_see_also({"rgw_reshard_online"}),
+
+    Option("rgw_reshard_catchup_threshold", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(1000)
+    .set_description("Objects written during an online reshard that may be copied with writes blocked")
+    .set_long_description(
+        "Once an online reshard has copied the bucket index, it copies "
+        "again the entries of the objects written in the meantime, while "
+        "writes go on, until a pass finds at most this many objects. Only "
+        "then are writes blocked to copy what was written during the last "
+        "pass.")
+    .add_service("rgw")
+    .add_see_also({"rgw_reshard_online", "rgw_reshard_catchup_max_passes"}),
+
+    Option("rgw_reshard_catchup_max_passes", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(10)
+    .set_description("Passes an online reshard makes over the writes it logged before blocking writes")
+    .add_service("rgw")
+    .add_see_also({"rgw_reshard_catchup_threshold"}),
+
     Option("rgw_trust_forwarded_https", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(false)
     .set_description("Trust Forwarded and X-Forwarded-Proto headers")
@@ -6997,6 +7170,35 @@ static std::vector<Option> get_rbd_options() {
     .set_default(false)
     .set_description("whether to enable rbd shared ro cache"),
 
+    Option("rbd_persistent_cache_enabled", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_description("whether to enable the persistent write-back cache")
+    .set_long_description("Writes are logged to a file on local storage and "
+                          "acknowledged once durable there, then written back "
+                          "to the image in the background. The cache is only "
+                          "used while the exclusive lock is held and is not "
+                          "compatible with journaling.")
+    .add_see_also({"rbd_persistent_cache_path", "rbd_persistent_cache_size"}),
+
+    Option("rbd_persistent_cache_path", Option::TYPE_STR, Option::LEVEL_ADVANCED)
+    .set_default("")
+    .set_description("directory holding persistent write-back cache logs")
+    .set_long_description("Required when the cache is enabled. This should be "
+                          "on fast, persistent local storage such as an SSD: a "
+                          "log left behind by a crash holds writes the image "
+                          "doesn't have and is replayed the next time the "
+                          "image is opened on this host."),
+
+    Option("rbd_persistent_cache_size", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
+    .set_default(1_G)
+    .set_min(32_M)
+    .set_description("size of the persistent write-back cache log per image"),
+
+    Option("rbd_persistent_cache_writeback_bytes", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
+    .set_default(16_M)
+    .set_min(1_M)
+    .set_description("amount of logged data coalesced into one write back to the image"),
+
     Option("rbd_concurrent_management_ops", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
     .set_default(10)
     .set_min(1)
@@ -7042,6 +7244,13 @@ static std::vector<Option> get_rbd_options() {
     .set_default(50_M)
     .set_description("how many bytes are read in total before readahead is disabled"),
 
+    Option("rbd_readahead_buffer_max_bytes", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
+    .set_default(32_M)
+    .set_description("maximum size of prefetched objects buffered per image when the object cacher is not in use")
+    .set_long_description("Without the object cacher, readahead prefetches "
+                          "whole objects. Set to 0 to disable readahead in "
+                          "that case."),
+
     Option("rbd_clone_copy_on_read", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(false)
     .set_description("copy-up parent image blocks to clone upon read request"),
@@ -7078,6 +7287,18 @@ static std::vector<Option> get_rbd_options() {
       })
     .set_description("minimum aligned size of discard operations"),
 
+    Option("rbd_fast_diff_dirty_blocks", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_description("track modified blocks within objects for fast-diff")
+    .set_long_description("When enabled on an image with the fast-diff "
+                          "feature, the exclusive lock owner records which "
+                          "blocks of each object (1/64th of the object size, "
+                          "but no smaller than 4K) were written since the "
+                          "last snapshot, so that whole-object diffs report "
+                          "block extents instead of entire objects. Once "
+                          "enabled, tracking persists for the image until "
+                          "the object map is disabled."),
+
     Option("rbd_enable_alloc_hint", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(true)
     .set_description("when writing a object, it will issue a hint to osd backend to indicate the expected size object need"),
@@ -7475,6 +7696,18 @@ std::vector<Option> get_mds_options() {
     .set_default(64_K)
     .set_description("threshold for number of dentries that can be trimmed"),
 
+    Option("mds_cache_trim_time_slice", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(.02)
+    .set_min(0.0)
+    .set_description("longest time in seconds a cache trim may hold the MDS lock")
+    .set_long_description("A trim that runs out of time stops and resumes after waiting as long again, so that requests are not held up behind a large trim. 0 means no limit."),
+
+    Option("mds_cache_compact_inode_ratio", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(.1)
+    .set_min_max(0.0, 1.0)
+    .set_description("share of the cache memory limit used to remember where trimmed inodes were linked")
+    .set_long_description("Clean inodes that are trimmed from the cache are remembered by parent directory and name, so that they can be opened again by inode number without reading their backtrace. 0 disables this."),
+
     Option("mds_max_file_recover", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
     .set_default(32)
     .set_description("maximum number of files to recover file sizes in parallel"),
@@ -7487,6 +7720,11 @@ std::vector<Option> get_mds_options() {
     .set_default(16384)
     .set_description("number of directory entries to read in one RADOS operation"),
 
+    Option("mds_dir_prefetch_max", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(8)
+    .set_description("number of dirfrags to fetch ahead of a directory listing or scrub")
+    .set_long_description("When a readdir or scrub reaches a fragment of a fragmented directory, the MDS starts loading up to this many of the following fragments concurrently. 0 disables prefetching."),
+
     Option("mds_decay_halflife", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
     .set_default(5)
     .set_description("rate of decay for temperature counters on each directory for balancing"),
@@ -7583,6 +7821,11 @@ std::vector<Option> get_mds_options() {
     .set_default(1000)
     .set_description("number of unused inodes to pre-allocate to clients for file creation"),
 
+    Option("mds_client_delegate_inos_pct", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(50)
+    .set_description("percentage of preallocated inos to delegate to clients for async creates")
+    .set_long_description("Delegated inos let a client that holds the needed capabilities create files without waiting for the MDS. 0 disables delegation."),
+
     Option("mds_early_reply", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(true)
     .set_description("additional reply to clients that metadata requests are complete but not yet durable"),
@@ -7687,7 +7930,46 @@ std::vector<Option> get_mds_options() {
 
     Option("mds_bal_mode", Option::TYPE_INT, Option::LEVEL_DEV)
     .set_default(0)
-    .set_description(""),
+    .set_description("method for calculating MDS load")
+    .set_long_description("0 = hybrid of metadata popularity, request rate and queue length; 1 = request rate and queue length; 2 = CPU load; 3 = measured cost of client requests (time spent dispatching them and bytes journaled), with migration cost and hysteresis applied to exports."),
+
+    Option("mds_bal_cost_request", Option::TYPE_FLOAT, Option::LEVEL_DEV)
+    .set_default(.05)
+    .set_min(0.0)
+    .set_description("load charged per client request in measured-cost balancing, in milliseconds")
+    .set_long_description("Accounts for per-request work done outside of request dispatch, such as messaging.")
+    .add_see_also("mds_bal_mode"),
+
+    Option("mds_bal_cost_journal_kb", Option::TYPE_FLOAT, Option::LEVEL_DEV)
+    .set_default(.02)
+    .set_min(0.0)
+    .set_description("load charged per KiB journaled for a client request in measured-cost balancing, in milliseconds")
+    .add_see_also("mds_bal_mode"),
+
+    Option("mds_bal_migration_cost", Option::TYPE_FLOAT, Option::LEVEL_DEV)
+    .set_default(10.0)
+    .set_min(0.0)
+    .set_description("fixed cost of migrating a subtree in measured-cost balancing")
+    .set_long_description("A subtree is only exported if its load exceeds the cost of migrating it. The cost is expressed in the same units as the subtree's load.")
+    .add_see_also("mds_bal_mode")
+    .add_see_also("mds_bal_migration_cost_per_dentry"),
+
+    Option("mds_bal_migration_cost_per_dentry", Option::TYPE_FLOAT, Option::LEVEL_DEV)
+    .set_default(.001)
+    .set_min(0.0)
+    .set_description("additional cost of migrating a subtree, per cached dentry in its root dirfrag")
+    .add_see_also("mds_bal_migration_cost"),
+
+    Option("mds_bal_min_residency", Option::TYPE_FLOAT, Option::LEVEL_DEV)
+    .set_default(60.0)
+    .set_min(0.0)
+    .set_description("seconds an imported subtree stays on its new rank before it may be exported again in measured-cost balancing")
+    .add_see_also("mds_bal_mode"),
+
+    Option("mds_bal_overload_epochs", Option::TYPE_INT, Option::LEVEL_DEV)
+    .set_default(2)
+    .set_min(1)
+    .set_description("number of balancer epochs a rank must be overloaded before it exports load"),
 
     Option("mds_bal_min_rebalance", Option::TYPE_FLOAT, Option::LEVEL_DEV)
     .set_default(.1)
@@ -8091,6 +8373,10 @@ std::vector<Option> get_mds_client_options() {
     .set_default(false)
     .set_description(""),
 
+    Option("client_inject_async_create_failure", Option::TYPE_BOOL, Option::LEVEL_DEV)
+    .set_default(false)
+    .set_description("name an ino the MDS did not delegate in async creates, so that they fail"),
+
     Option("client_metadata", Option::TYPE_STR, Option::LEVEL_ADVANCED)
     .set_default("")
     .set_description("metadata key=value comma-delimited pairs appended to session metadata"),
@@ -8112,6 +8398,11 @@ std::vector<Option> get_mds_client_options() {
     .set_default(false)
     .set_description(""),
 
+    Option("client_async_dirops", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_description("create and unlink files without waiting for the MDS when possible")
+    .set_long_description("When the client holds exclusive capabilities on a directory and, for creates, has inode numbers delegated by the MDS, file creates and unlinks in that directory return immediately and the requests to the MDS are pipelined. Errors are reported by a later fsync, or by close if they are already known."),
+
     // note: the max amount of "in flight" dirty data is roughly (max - target)
     Option("fuse_use_invalidate_cb", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(true)
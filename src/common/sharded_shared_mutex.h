@@ -0,0 +1,82 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#ifndef CEPH_COMMON_SHARDED_SHARED_MUTEX_H
+#define CEPH_COMMON_SHARDED_SHARED_MUTEX_H
+
+#include <array>
+#include <atomic>
+#include <shared_mutex>
+
+namespace ceph {
+
+// A reader-writer mutex for read-mostly state that is hit from many
+// threads at once (e.g. the Objecter's OSDMap).
+//
+// A single std::shared_mutex serializes its readers on the cache line
+// holding the reader count even though they never block each other.
+// Here each thread takes the shared lock on "its" shard only, so
+// readers on different shards touch disjoint cache lines; writers
+// take every shard, in order, which is correspondingly more expensive.
+//
+// It models SharedMutex, so it works with std::unique_lock,
+// std::shared_lock, boost::shared_lock and ceph::shunique_lock.  As
+// with std::shared_mutex, a shared lock must be released by the thread
+// that took it.
+template<std::size_t NumShards = 16>
+class sharded_shared_mutex {
+  static_assert(NumShards > 0, "need at least one shard");
+
+  struct alignas(64) shard_t {
+    std::shared_mutex m;
+  };
+  std::array<shard_t, NumShards> shards;
+
+  static std::size_t thread_shard() {
+    static std::atomic<std::size_t> next_shard{0};
+    thread_local const std::size_t my_shard =
+      next_shard.fetch_add(1, std::memory_order_relaxed) % NumShards;
+    return my_shard;
+  }
+
+public:
+  sharded_shared_mutex() = default;
+  sharded_shared_mutex(const sharded_shared_mutex&) = delete;
+  sharded_shared_mutex& operator=(const sharded_shared_mutex&) = delete;
+
+  void lock() {
+    for (auto& s : shards) {
+      s.m.lock();
+    }
+  }
+  bool try_lock() {
+    for (std::size_t i = 0; i < NumShards; ++i) {
+      if (!shards[i].m.try_lock()) {
+	while (i-- > 0) {
+	  shards[i].m.unlock();
+	}
+	return false;
+      }
+    }
+    return true;
+  }
+  void unlock() {
+    for (std::size_t i = NumShards; i-- > 0; ) {
+      shards[i].m.unlock();
+    }
+  }
+
+  void lock_shared() {
+    shards[thread_shard()].m.lock_shared();
+  }
+  bool try_lock_shared() {
+    return shards[thread_shard()].m.try_lock_shared();
+  }
+  void unlock_shared() {
+    shards[thread_shard()].m.unlock_shared();
+  }
+};
+
+} // namespace ceph
+
+#endif // CEPH_COMMON_SHARDED_SHARED_MUTEX_H
@@ -1586,6 +1586,35 @@ public:
       out[i] = rawout[i];
   }
 
+  /**
+   * map each of xs through the rule, like do_rule(), in one batch
+   *
+   * @param outs [out] outs[i] is the mapping of xs[i]
+   */
+  template<typename WeightVector>
+  void do_rule_batch(int rule, const std::vector<int>& xs,
+		     std::vector<std::vector<int>> *outs, int maxout,
+		     const WeightVector& weight,
+		     uint64_t choose_args_index) const {
+    outs->resize(xs.size());
+    if (xs.empty())
+      return;
+    std::vector<int> rawout(xs.size() * maxout);
+    std::vector<int> rawlen(xs.size());
+    char work[crush_work_size(crush, maxout)];
+    crush_init_workspace(crush, work);
+    crush_choose_arg_map arg_map = choose_args_get_with_fallback(
+      choose_args_index);
+    crush_do_rule_batch(crush, rule, &xs[0], xs.size(), &rawout[0],
+			&rawlen[0], maxout, &weight[0], weight.size(), work,
+			arg_map.args);
+    for (unsigned i = 0; i < xs.size(); ++i) {
+      int numrep = std::max(rawlen[i], 0);
+      auto p = rawout.begin() + i * maxout;
+      (*outs)[i].assign(p, p + numrep);
+    }
+  }
+
   int _choose_type_stack(
     CephContext *cct,
     const std::vector<std::pair<int,int>>& stack,
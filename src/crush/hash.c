@@ -2,6 +2,13 @@
 # include <linux/crush/hash.h>
 #else
 # include "hash.h"
+# if defined(__x86_64__)
+#  include "arch/intel.h"
+#  include "hash_avx2.h"
+# elif defined(__aarch64__) && defined(__ARM_NEON)
+#  include <arm_neon.h>
+#  define CRUSH_HASH_NEON
+# endif
 #endif
 
 /*
@@ -120,6 +127,76 @@ __u32 crush_hash32_3(int type, __u32 a, __u32 b, __u32 c)
 	}
 }
 
+#ifdef CRUSH_HASH_NEON
+
+/* lane-wise crush_hashmix() */
+#define crush_hashmix_neon(a, b, c) do {				\
+		a = vsubq_u32(a, b);  a = vsubq_u32(a, c);		\
+		a = veorq_u32(a, vshrq_n_u32(c, 13));			\
+		b = vsubq_u32(b, c);  b = vsubq_u32(b, a);		\
+		b = veorq_u32(b, vshlq_n_u32(a, 8));			\
+		c = vsubq_u32(c, a);  c = vsubq_u32(c, b);		\
+		c = veorq_u32(c, vshrq_n_u32(b, 13));			\
+		a = vsubq_u32(a, b);  a = vsubq_u32(a, c);		\
+		a = veorq_u32(a, vshrq_n_u32(c, 12));			\
+		b = vsubq_u32(b, c);  b = vsubq_u32(b, a);		\
+		b = veorq_u32(b, vshlq_n_u32(a, 16));			\
+		c = vsubq_u32(c, a);  c = vsubq_u32(c, b);		\
+		c = veorq_u32(c, vshrq_n_u32(b, 5));			\
+		a = vsubq_u32(a, b);  a = vsubq_u32(a, c);		\
+		a = veorq_u32(a, vshrq_n_u32(c, 3));			\
+		b = vsubq_u32(b, c);  b = vsubq_u32(b, a);		\
+		b = veorq_u32(b, vshlq_n_u32(a, 10));			\
+		c = vsubq_u32(c, a);  c = vsubq_u32(c, b);		\
+		c = veorq_u32(c, vshrq_n_u32(b, 15));			\
+	} while (0)
+
+static unsigned crush_hash32_rjenkins1_3_neon(__u32 a, const __s32 *b,
+					      __u32 c, __u32 *out, unsigned n)
+{
+	const uint32x4_t seed = vdupq_n_u32(crush_hash_seed ^ a ^ c);
+	unsigned i;
+
+	for (i = 0; i + 4 <= n; i += 4) {
+		uint32x4_t xa = vdupq_n_u32(a);
+		uint32x4_t xb = vld1q_u32((const __u32 *)(b + i));
+		uint32x4_t xc = vdupq_n_u32(c);
+		uint32x4_t x = vdupq_n_u32(231232);
+		uint32x4_t y = vdupq_n_u32(1232);
+		uint32x4_t hash = veorq_u32(seed, xb);
+
+		crush_hashmix_neon(xa, xb, hash);
+		crush_hashmix_neon(xc, x, hash);
+		crush_hashmix_neon(y, xa, hash);
+		crush_hashmix_neon(xb, x, hash);
+		crush_hashmix_neon(y, xc, hash);
+		vst1q_u32(out + i, hash);
+	}
+	return i;
+}
+
+#endif /* CRUSH_HASH_NEON */
+
+void crush_hash32_3_batch(int type, __u32 a, const __s32 *b, __u32 c,
+			  __u32 *out, unsigned n)
+{
+	unsigned i = 0;
+
+	if (type != CRUSH_HASH_RJENKINS1) {
+		for (; i < n; i++)
+			out[i] = crush_hash32_3(type, a, b[i], c);
+		return;
+	}
+#if !defined(__KERNEL__) && defined(__x86_64__)
+	if (ceph_arch_intel_avx2 && crush_hash32_rjenkins1_3_avx2_exists())
+		i = crush_hash32_rjenkins1_3_avx2(a, b, c, out, n);
+#elif defined(CRUSH_HASH_NEON)
+	i = crush_hash32_rjenkins1_3_neon(a, b, c, out, n);
+#endif
+	for (; i < n; i++)
+		out[i] = crush_hash32_rjenkins1_3(a, b[i], c);
+}
+
 __u32 crush_hash32_4(int type, __u32 a, __u32 b, __u32 c, __u32 d)
 {
 	switch (type) {
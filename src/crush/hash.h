@@ -16,6 +16,13 @@ extern const char *crush_hash_name(int type);
 extern __u32 crush_hash32(int type, __u32 a);
 extern __u32 crush_hash32_2(int type, __u32 a, __u32 b);
 extern __u32 crush_hash32_3(int type, __u32 a, __u32 b, __u32 c);
+/*
+ * hash (a, b[i], c) into out[i] for each of the n entries of b, using
+ * SIMD instructions where the cpu has them.  equivalent to calling
+ * crush_hash32_3(type, a, b[i], c) in a loop.
+ */
+extern void crush_hash32_3_batch(int type, __u32 a, const __s32 *b, __u32 c,
+				 __u32 *out, unsigned n);
 extern __u32 crush_hash32_4(int type, __u32 a, __u32 b, __u32 c, __u32 d);
 extern __u32 crush_hash32_5(int type, __u32 a, __u32 b, __u32 c, __u32 d,
 			    __u32 e);
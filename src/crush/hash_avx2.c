@@ -0,0 +1,79 @@
+/*
+ * AVX2 version of the rjenkins1 hash, used to compute the straw2
+ * draws for several bucket items at once.
+ *
+ * LGPL-2.1 or LGPL-3.0
+ */
+
+#include "acconfig.h"
+#include "hash_avx2.h"
+
+#ifdef HAVE_INTEL_AVX2
+
+#include <immintrin.h>
+
+#define vsub(x, y) _mm256_sub_epi32(x, y)
+#define vxor(x, y) _mm256_xor_si256(x, y)
+#define vshr(x, n) _mm256_srli_epi32(x, n)
+#define vshl(x, n) _mm256_slli_epi32(x, n)
+
+/* lane-wise crush_hashmix(), see hash.c */
+#define crush_hashmix_avx2(a, b, c) do {				\
+		a = vsub(a, b);  a = vsub(a, c);  a = vxor(a, vshr(c, 13)); \
+		b = vsub(b, c);  b = vsub(b, a);  b = vxor(b, vshl(a, 8)); \
+		c = vsub(c, a);  c = vsub(c, b);  c = vxor(c, vshr(b, 13)); \
+		a = vsub(a, b);  a = vsub(a, c);  a = vxor(a, vshr(c, 12)); \
+		b = vsub(b, c);  b = vsub(b, a);  b = vxor(b, vshl(a, 16)); \
+		c = vsub(c, a);  c = vsub(c, b);  c = vxor(c, vshr(b, 5)); \
+		a = vsub(a, b);  a = vsub(a, c);  a = vxor(a, vshr(c, 3)); \
+		b = vsub(b, c);  b = vsub(b, a);  b = vxor(b, vshl(a, 10)); \
+		c = vsub(c, a);  c = vsub(c, b);  c = vxor(c, vshr(b, 15)); \
+	} while (0)
+
+#define crush_hash_seed 1315423911
+
+int crush_hash32_rjenkins1_3_avx2_exists(void)
+{
+	return 1;
+}
+
+unsigned crush_hash32_rjenkins1_3_avx2(__u32 a, const __s32 *b, __u32 c,
+				       __u32 *out, unsigned n)
+{
+	const __m256i va = _mm256_set1_epi32(a);
+	const __m256i vc = _mm256_set1_epi32(c);
+	const __m256i seed = _mm256_set1_epi32(crush_hash_seed ^ a ^ c);
+	unsigned i;
+
+	for (i = 0; i + 8 <= n; i += 8) {
+		__m256i xa = va;
+		__m256i xb = _mm256_loadu_si256((const __m256i *)(b + i));
+		__m256i xc = vc;
+		__m256i x = _mm256_set1_epi32(231232);
+		__m256i y = _mm256_set1_epi32(1232);
+		__m256i hash = vxor(seed, xb);
+
+		crush_hashmix_avx2(xa, xb, hash);
+		crush_hashmix_avx2(xc, x, hash);
+		crush_hashmix_avx2(y, xa, hash);
+		crush_hashmix_avx2(xb, x, hash);
+		crush_hashmix_avx2(y, xc, hash);
+		_mm256_storeu_si256((__m256i *)(out + i), hash);
+	}
+	return i;
+}
+
+#else /* HAVE_INTEL_AVX2 */
+
+int crush_hash32_rjenkins1_3_avx2_exists(void)
+{
+	return 0;
+}
+
+unsigned crush_hash32_rjenkins1_3_avx2(__u32 a, const __s32 *b, __u32 c,
+				       __u32 *out, unsigned n)
+{
+	return 0;
+}
+
+#endif /* HAVE_INTEL_AVX2 */
@@ -0,0 +1,24 @@
+#ifndef CEPH_CRUSH_HASH_AVX2_H
+#define CEPH_CRUSH_HASH_AVX2_H
+
+#include "crush_compat.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern int crush_hash32_rjenkins1_3_avx2_exists(void);
+
+/*
+ * hash (a, b[i], c) for i in [0, n) into out[i], 8 lanes at a time.
+ * returns the number of entries hashed (a multiple of 8 <= n); the
+ * caller is responsible for the tail.
+ */
+extern unsigned crush_hash32_rjenkins1_3_avx2(__u32 a, const __s32 *b, __u32 c,
+					      __u32 *out, unsigned n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
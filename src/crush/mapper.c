@@ -331,10 +331,9 @@ static inline __s32 *get_choose_arg_ids(const struct crush_bucket_straw2 *bucket
  * for reference, see the exponential distribution example at:  
  * https://en.wikipedia.org/wiki/Inverse_transform_sampling#Examples
  */
-static inline __s64 generate_exponential_distribution(int type, int x, int y, int z, 
+static inline __s64 generate_exponential_distribution(unsigned int u,
                                                       int weight)
 {
-	unsigned int u = crush_hash32_3(type, x, y, z);
 	u &= 0xffff;
 
 	/*
@@ -358,25 +357,40 @@ static inline __s64 generate_exponential_distribution(int type, int x, int y, in
 	return div64_s64(ln, weight);
 }
 
+/*
+ * the hashes for a straw2 bucket are computed a chunk of items at a
+ * time, so that crush_hash32_3_batch() can use SIMD lanes for them.
+ */
+#define CRUSH_STRAW2_HASH_BATCH 64
+
 static int bucket_straw2_choose(const struct crush_bucket_straw2 *bucket,
 				int x, int r, const struct crush_choose_arg *arg,
                                 int position)
 {
-	unsigned int i, high = 0;
+	unsigned int i, j, n, high = 0;
 	__s64 draw, high_draw = 0;
+	__u32 u[CRUSH_STRAW2_HASH_BATCH];
         __u32 *weights = get_choose_arg_weights(bucket, arg, position);
         __s32 *ids = get_choose_arg_ids(bucket, arg);
-	for (i = 0; i < bucket->h.size; i++) {
-                dprintk("weight 0x%x item %d\n", weights[i], ids[i]);
-		if (weights[i]) {
-			draw = generate_exponential_distribution(bucket->h.hash, x, ids[i], r, weights[i]);
-		} else {
-			draw = S64_MIN;
-		}
+	for (i = 0; i < bucket->h.size; i += n) {
+		n = bucket->h.size - i;
+		if (n > CRUSH_STRAW2_HASH_BATCH)
+			n = CRUSH_STRAW2_HASH_BATCH;
+		crush_hash32_3_batch(bucket->h.hash, x, ids + i, r, u, n);
+		for (j = 0; j < n; j++) {
+			dprintk("weight 0x%x item %d\n", weights[i + j],
+				ids[i + j]);
+			if (weights[i + j]) {
+				draw = generate_exponential_distribution(
+					u[j], weights[i + j]);
+			} else {
+				draw = S64_MIN;
+			}
 
-		if (i == 0 || draw > high_draw) {
-			high = i;
-			high_draw = draw;
+			if (i + j == 0 || draw > high_draw) {
+				high = i + j;
+				high_draw = draw;
+			}
 		}
 	}
 
@@ -1103,3 +1117,42 @@ int crush_do_rule(const struct crush_map *map,
 
 	return result_len;
 }
+
+/**
+ * crush_do_rule_batch - calculate the mappings of many inputs
+ * @map: the crush_map
+ * @ruleno: the rule id
+ * @x: array of hash inputs
+ * @num_x: number of inputs
+ * @result: result_max * num_x array; mapping i starts at result + i * result_max
+ * @result_len: num_x array of result lengths
+ * @result_max: maximum result size of each mapping
+ * @weight: weight vector (for map leaves)
+ * @weight_max: size of weight vector
+ * @cwin: workspace initialized by crush_init_workspace
+ * @choose_args: weights and ids for each known bucket
+ *
+ * Equivalent to calling crush_do_rule() for each input, but the rule
+ * lookup and the workspace are shared by the whole batch.
+ */
+void crush_do_rule_batch(const struct crush_map *map,
+			 int ruleno, const int *x, int num_x,
+			 int *result, int *result_len, int result_max,
+			 const __u32 *weight, int weight_max,
+			 void *cwin, const struct crush_choose_arg *choose_args)
+{
+	int i;
+
+	if ((__u32)ruleno >= map->max_rules || !map->rules[ruleno]) {
+		dprintk(" bad ruleno %d\n", ruleno);
+		for (i = 0; i < num_x; i++)
+			result_len[i] = 0;
+		return;
+	}
+	for (i = 0; i < num_x; i++) {
+		result_len[i] = crush_do_rule(map, ruleno, x[i],
+					      result + i * result_max,
+					      result_max, weight, weight_max,
+					      cwin, choose_args);
+	}
+}
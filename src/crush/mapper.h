@@ -78,6 +78,35 @@ extern int crush_do_rule(const struct crush_map *map,
 			 const __u32 *weights, int weight_max,
 			 void *cwin, const struct crush_choose_arg *choose_args);
 
+/** @ingroup API
+ *
+ * Map each of the __num_x__ inputs in __x__ like crush_do_rule() does.
+ * The mapping of __x[i]__ is stored in
+ * __result[i * result_max, i * result_max + result_len[i][__.
+ *
+ * Mapping a whole pool in one call saves the per input setup that
+ * would otherwise be repeated by the caller (workspace, choose_args
+ * lookup), and keeps the map hot in the cache.
+ *
+ * @param map the crush_map
+ * @param ruleno a positive integer < __CRUSH_MAX_RULES__
+ * @param x the values to map
+ * @param num_x the size of the __x__ array
+ * @param result an array of items of size __result_max__ * __num_x__
+ * @param result_len an array of size __num_x__
+ * @param result_max the maximum size of each mapping
+ * @param weights an array of weights of size __weight_max__
+ * @param weight_max the size of the __weights__ array
+ * @param cwin must be an char array initialized by crush_init_workspace
+ * @param choose_args weights and ids for each known bucket
+ */
+extern void crush_do_rule_batch(const struct crush_map *map,
+				int ruleno, const int *x, int num_x,
+				int *result, int *result_len, int result_max,
+				const __u32 *weights, int weight_max,
+				void *cwin,
+				const struct crush_choose_arg *choose_args);
+
 /* Returns the exact amount of workspace that will need to be used
    for a given combination of crush_map and result_max. The caller can
    then allocate this much on its own, either on the stack, in a
@@ -208,6 +208,73 @@ int ErasureCode::encode_chunks(const set<int> &want_to_encode,
 {
   ceph_abort_msg("ErasureCode::encode_chunks not implemented");
 }
+
+int ErasureCode::encode_stripes(const set<int> &want_to_encode,
+                                const bufferlist &in,
+                                unsigned int chunk_size,
+                                map<int, bufferlist> *encoded)
+{
+  unsigned int k = get_data_chunk_count();
+  uint64_t stripe_width = (uint64_t)k * chunk_size;
+  ceph_assert(in.length() % stripe_width == 0);
+  for (uint64_t off = 0; off < in.length(); off += stripe_width) {
+    bufferlist stripe;
+    stripe.substr_of(in, off, stripe_width);
+    map<int, bufferlist> chunks;
+    int r = encode(want_to_encode, stripe, &chunks);
+    if (r)
+      return r;
+    for (auto& i : chunks) {
+      ceph_assert(i.second.length() == chunk_size);
+      (*encoded)[i.first].claim_append(i.second);
+    }
+  }
+  return 0;
+}
+
+int ErasureCode::encode_stripes_contiguous(const set<int> &want_to_encode,
+                                           const bufferlist &in,
+                                           unsigned int chunk_size,
+                                           map<int, bufferlist> *encoded)
+{
+  unsigned int k = get_data_chunk_count();
+  unsigned int m = get_chunk_count() - k;
+  uint64_t stripe_width = (uint64_t)k * chunk_size;
+  ceph_assert(in.length() % stripe_width == 0);
+  uint64_t stripes = in.length() / stripe_width;
+  if (stripes <= 1)
+    return encode(want_to_encode, in, encoded);
+
+  // gather each data chunk of every stripe into one aligned buffer, in a
+  // single pass over the input, so that the coding kernel runs once over
+  // stripes * chunk_size bytes per chunk instead of once per stripe
+  uint64_t blocksize = stripes * chunk_size;
+  map<int, bufferlist> chunks;
+  vector<char*> data(k);
+  for (unsigned int i = 0; i < k; i++) {
+    bufferptr buf(buffer::create_aligned(blocksize, SIMD_ALIGN));
+    data[i] = buf.c_str();
+    chunks[chunk_index(i)].push_back(std::move(buf));
+  }
+  auto p = in.cbegin();
+  for (uint64_t s = 0; s < stripes; s++) {
+    for (unsigned int i = 0; i < k; i++) {
+      p.copy(chunk_size, data[i] + s * chunk_size);
+    }
+  }
+  for (unsigned int i = k; i < k + m; i++) {
+    chunks[chunk_index(i)].push_back(
+      buffer::create_aligned(blocksize, SIMD_ALIGN));
+  }
+  int r = encode_chunks(want_to_encode, &chunks);
+  if (r)
+    return r;
+  for (auto& i : chunks) {
+    if (want_to_encode.count(i.first))
+      (*encoded)[i.first].claim_append(i.second);
+  }
+  return 0;
+}
  
 int ErasureCode::_decode(const set<int> &want_to_read,
 			 const map<int, bufferlist> &chunks,
@@ -261,6 +328,82 @@ int ErasureCode::decode_chunks(const set<int> &want_to_read,
   ceph_abort_msg("ErasureCode::decode_chunks not implemented");
 }
 
+int ErasureCode::decode_stripes(const set<int> &want_to_read,
+                                const map<int, bufferlist> &chunks,
+                                unsigned int chunk_size,
+                                map<int, bufferlist> *decoded)
+{
+  ceph_assert(!chunks.empty());
+  uint64_t length = chunks.begin()->second.length();
+  ceph_assert(length % chunk_size == 0);
+  for (uint64_t off = 0; off < length; off += chunk_size) {
+    map<int, bufferlist> stripe;
+    for (auto& i : chunks) {
+      ceph_assert(i.second.length() == length);
+      stripe[i.first].substr_of(i.second, off, chunk_size);
+    }
+    map<int, bufferlist> out;
+    int r = decode(want_to_read, stripe, &out, chunk_size);
+    if (r)
+      return r;
+    for (auto i : want_to_read) {
+      (*decoded)[i].claim_append(out[i]);
+    }
+  }
+  return 0;
+}
+
+int ErasureCode::decode_stripes_contiguous(const set<int> &want_to_read,
+                                           const map<int, bufferlist> &chunks,
+                                           unsigned int chunk_size,
+                                           map<int, bufferlist> *decoded)
+{
+  ceph_assert(!chunks.empty());
+  ceph_assert(chunks.begin()->second.length() % chunk_size == 0);
+  // the coding kernels are position independent: recover all the
+  // stripes in a single pass
+  map<int, bufferlist> out;
+  int r = _decode(want_to_read, chunks, &out);
+  if (r)
+    return r;
+  for (auto i : want_to_read) {
+    (*decoded)[i].claim_append(out[i]);
+  }
+  return 0;
+}
+
+uint64_t ErasureCode::get_supported_optimizations() const
+{
+  return 0;
+}
+
+void ErasureCode::encode_delta(const bufferlist &old_data,
+                               const bufferlist &new_data,
+                               bufferlist *delta)
+{
+  // all the codes we ship work in GF(2^w), where subtraction is a xor
+  ceph_assert(old_data.length() == new_data.length());
+  unsigned length = old_data.length();
+  bufferptr buf(buffer::create_aligned(length, SIMD_ALIGN));
+  new_data.begin().copy(length, buf.c_str());
+  unsigned off = 0;
+  for (auto& p : old_data.buffers()) {
+    const char *src = p.c_str();
+    char *dst = buf.c_str() + off;
+    for (unsigned i = 0; i < p.length(); i++)
+      dst[i] ^= src[i];
+    off += p.length();
+  }
+  delta->clear();
+  delta->push_back(std::move(buf));
+}
+
+int ErasureCode::apply_delta(const map<int, bufferlist> &deltas,
+                             map<int, bufferlist> *parity)
+{
+  return -EOPNOTSUPP;
+}
+
 int ErasureCode::parse(const ErasureCodeProfile &profile,
 		       ostream *ss)
 {
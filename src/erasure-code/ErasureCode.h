@@ -94,6 +94,37 @@ namespace ceph {
                               const std::map<int, bufferlist> &chunks,
                               std::map<int, bufferlist> *decoded) override;
 
+    int encode_stripes(const std::set<int> &want_to_encode,
+                       const bufferlist &in,
+                       unsigned int chunk_size,
+                       std::map<int, bufferlist> *encoded) override;
+
+    int decode_stripes(const std::set<int> &want_to_read,
+                       const std::map<int, bufferlist> &chunks,
+                       unsigned int chunk_size,
+                       std::map<int, bufferlist> *decoded) override;
+
+    /// encode_stripes() for codes that work column by column
+    int encode_stripes_contiguous(const std::set<int> &want_to_encode,
+                                  const bufferlist &in,
+                                  unsigned int chunk_size,
+                                  std::map<int, bufferlist> *encoded);
+
+    /// decode_stripes() for codes that work column by column
+    int decode_stripes_contiguous(const std::set<int> &want_to_read,
+                                  const std::map<int, bufferlist> &chunks,
+                                  unsigned int chunk_size,
+                                  std::map<int, bufferlist> *decoded);
+
+    uint64_t get_supported_optimizations() const override;
+
+    void encode_delta(const bufferlist &old_data,
+                      const bufferlist &new_data,
+                      bufferlist *delta) override;
+
+    int apply_delta(const std::map<int, bufferlist> &deltas,
+                    std::map<int, bufferlist> *parity) override;
+
     const std::vector<int> &get_chunk_mapping() const override;
 
     int to_mapping(const ErasureCodeProfile &profile,
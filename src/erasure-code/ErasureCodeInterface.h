@@ -370,6 +370,34 @@ namespace ceph {
     virtual int encode_chunks(const std::set<int> &want_to_encode,
                               std::map<int, bufferlist> *encoded) = 0;
 
+    /**
+     * Encode several consecutive stripes of **in** at once and
+     * store the result in **encoded**.
+     *
+     * The length of **in** must be a multiple of the stripe width,
+     * i.e. **chunk_size** * get_data_chunk_count(), where
+     * **chunk_size** is the value get_chunk_size() returns for one
+     * stripe. For each chunk index, **encoded** receives the
+     * concatenation of that chunk for every stripe, in stripe
+     * order: the same result as calling encode() once per stripe
+     * and appending the chunks.
+     *
+     * Plugins whose coding does not depend on the position within
+     * a chunk compute all stripes with a single call into their
+     * coding kernel; the default implementation encodes stripe by
+     * stripe.
+     *
+     * @param [in] want_to_encode chunk indexes to be encoded
+     * @param [in] in stripes to be encoded
+     * @param [in] chunk_size size of the chunks of a single stripe
+     * @param [out] encoded map chunk indexes to chunk data
+     * @return **0** on success or a negative errno on error.
+     */
+    virtual int encode_stripes(const std::set<int> &want_to_encode,
+                               const bufferlist &in,
+                               unsigned int chunk_size,
+                               std::map<int, bufferlist> *encoded) = 0;
+
     /**
      * Decode the **chunks** and store at least **want_to_read**
      * chunks in **decoded**.
@@ -412,6 +440,73 @@ namespace ceph {
                               const std::map<int, bufferlist> &chunks,
                               std::map<int, bufferlist> *decoded) = 0;
 
+    /**
+     * Decode several consecutive stripes at once. Each buffer in
+     * **chunks** holds the same chunk index of every stripe, one
+     * **chunk_size** chunk after the other, as produced by
+     * encode_stripes(). The buffers stored in **decoded** use the
+     * same layout.
+     *
+     * @param [in] want_to_read chunk indexes to be decoded
+     * @param [in] chunks map chunk indexes to the chunks of all stripes
+     * @param [in] chunk_size size of the chunks of a single stripe
+     * @param [out] decoded map chunk indexes to the chunks of all stripes
+     * @return **0** on success or a negative errno on error.
+     */
+    virtual int decode_stripes(const std::set<int> &want_to_read,
+                               const std::map<int, bufferlist> &chunks,
+                               unsigned int chunk_size,
+                               std::map<int, bufferlist> *decoded) = 0;
+
+    /**
+     * Optional optimizations reported by get_supported_optimizations().
+     */
+    enum {
+      /// parity can be updated with encode_delta() and apply_delta()
+      FLAG_EC_PLUGIN_PARITY_DELTA_OPTIMIZATION = 1 << 0,
+    };
+
+    /**
+     * Return the optimizations supported by the instance, as a mask
+     * of the FLAG_EC_PLUGIN_* values. The result only depends on the
+     * profile given to **init**.
+     *
+     * @return a mask of FLAG_EC_PLUGIN_* values
+     */
+    virtual uint64_t get_supported_optimizations() const = 0;
+
+    /**
+     * Compute in **delta** the difference between the **old_data**
+     * and **new_data** contents of a data chunk, to be given to
+     * apply_delta(). Both buffers must have the same size.
+     *
+     * @param [in] old_data previous content of the chunk
+     * @param [in] new_data new content of the chunk
+     * @param [out] delta difference between the two
+     */
+    virtual void encode_delta(const bufferlist &old_data,
+                              const bufferlist &new_data,
+                              bufferlist *delta) = 0;
+
+    /**
+     * Update the coding chunks in **parity** so that they match data
+     * chunks changed by the differences in **deltas**, as computed
+     * by encode_delta(). Data chunks that are not in **deltas** are
+     * left unchanged, and **parity** must contain every coding chunk.
+     *
+     * Because the coding is the same for every byte of a chunk, the
+     * buffers may hold several consecutive stripes, as long as they
+     * all have the same size. This is only supported if
+     * get_supported_optimizations() reports
+     * FLAG_EC_PLUGIN_PARITY_DELTA_OPTIMIZATION.
+     *
+     * @param [in] deltas map data chunk indexes to their difference
+     * @param [in,out] parity map coding chunk indexes to chunk data
+     * @return **0** on success or a negative errno on error.
+     */
+    virtual int apply_delta(const std::map<int, bufferlist> &deltas,
+                            std::map<int, bufferlist> *parity) = 0;
+
     /**
      * Return the ordered list of chunks or an empty vector
      * if no remapping is necessary.
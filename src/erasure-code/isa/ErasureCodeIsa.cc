@@ -116,6 +116,47 @@ int ErasureCodeIsa::decode_chunks(const set<int> &want_to_read,
 
 // -----------------------------------------------------------------------------
 
+uint64_t
+ErasureCodeIsa::get_supported_optimizations() const
+{
+  // both matrices are linear: a data chunk contributes to each coding
+  // chunk independently of the other data chunks
+  if (!get_chunk_mapping().empty())
+    return 0;
+  return FLAG_EC_PLUGIN_PARITY_DELTA_OPTIMIZATION;
+}
+
+// -----------------------------------------------------------------------------
+
+int
+ErasureCodeIsa::apply_delta(const map<int, bufferlist> &deltas,
+                            map<int, bufferlist> *parity)
+{
+  if (!get_supported_optimizations())
+    return -EOPNOTSUPP;
+  if (deltas.empty())
+    return 0;
+  unsigned blocksize = deltas.begin()->second.length();
+  char *coding[m];
+  for (int i = 0; i < m; i++) {
+    auto p = parity->find(k + i);
+    if (p == parity->end() || p->second.length() != blocksize)
+      return -EINVAL;
+    p->second.rebuild_aligned(EC_ISA_ADDRESS_ALIGNMENT);
+    coding[i] = p->second.c_str();
+  }
+  for (auto& i : deltas) {
+    if (i.first >= k || i.second.length() != blocksize)
+      return -EINVAL;
+    bufferlist delta = i.second;
+    delta.rebuild_aligned(EC_ISA_ADDRESS_ALIGNMENT);
+    isa_apply_delta(i.first, delta.c_str(), coding, blocksize);
+  }
+  return 0;
+}
+
+// -----------------------------------------------------------------------------
+
 void
 ErasureCodeIsaDefault::isa_encode(char **data,
                                   char **coding,
@@ -132,6 +173,23 @@ ErasureCodeIsaDefault::isa_encode(char **data,
 
 // -----------------------------------------------------------------------------
 
+void
+ErasureCodeIsaDefault::isa_apply_delta(int data_index,
+                                       char *delta,
+                                       char **coding,
+                                       int blocksize)
+{
+  if (m == 1)
+    // single parity stripe: same xor as isa_encode
+    byte_xor((unsigned char*) delta, (unsigned char*) coding[0],
+             (unsigned char*) delta + blocksize);
+  else
+    ec_encode_data_update(blocksize, k, m, data_index, encode_tbls,
+                          (unsigned char*) delta, (unsigned char**) coding);
+}
+
+// -----------------------------------------------------------------------------
+
 bool
 ErasureCodeIsaDefault::erasure_contains(int *erasures, int i)
 {
@@ -80,6 +80,25 @@ public:
                             const std::map<int, ceph::buffer::list> &chunks,
                             std::map<int, ceph::buffer::list> *decoded) override;
 
+  int encode_stripes(const std::set<int> &want_to_encode,
+                    const ceph::buffer::list &in,
+                    unsigned int chunk_size,
+                    std::map<int, ceph::buffer::list> *encoded) override {
+    return encode_stripes_contiguous(want_to_encode, in, chunk_size, encoded);
+  }
+
+  int decode_stripes(const std::set<int> &want_to_read,
+                    const std::map<int, ceph::buffer::list> &chunks,
+                    unsigned int chunk_size,
+                    std::map<int, ceph::buffer::list> *decoded) override {
+    return decode_stripes_contiguous(want_to_read, chunks, chunk_size, decoded);
+  }
+
+  uint64_t get_supported_optimizations() const override;
+
+  int apply_delta(const std::map<int, ceph::buffer::list> &deltas,
+                  std::map<int, ceph::buffer::list> *parity) override;
+
   int init(ceph::ErasureCodeProfile &profile, std::ostream *ss) override;
 
   virtual void isa_encode(char **data,
@@ -92,6 +111,11 @@ public:
                          char **coding,
                          int blocksize) = 0;
 
+  virtual void isa_apply_delta(int data_index,
+                               char *delta,
+                               char **coding,
+                               int blocksize) = 0;
+
   virtual unsigned get_alignment() const = 0;
 
   virtual void prepare() = 0;
@@ -141,6 +165,11 @@ public:
                          char **coding,
                          int blocksize) override;
 
+  void isa_apply_delta(int data_index,
+                       char *delta,
+                       char **coding,
+                       int blocksize) override;
+
   unsigned get_alignment() const override;
 
   void prepare() override;
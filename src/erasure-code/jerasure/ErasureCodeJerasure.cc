@@ -137,6 +137,66 @@ int ErasureCodeJerasure::decode_chunks(const set<int> &want_to_read,
   return jerasure_decode(erasures, data, coding, blocksize);
 }
 
+uint64_t ErasureCodeJerasure::get_supported_optimizations() const
+{
+  // a Reed-Solomon coding chunk is a linear combination of the data
+  // chunks; the bit matrix techniques are not handled
+  if (!get_coding_matrix() || !chunk_mapping.empty())
+    return 0;
+  return FLAG_EC_PLUGIN_PARITY_DELTA_OPTIMIZATION;
+}
+
+int ErasureCodeJerasure::apply_delta(const map<int, bufferlist> &deltas,
+				     map<int, bufferlist> *parity)
+{
+  if (!get_supported_optimizations())
+    return -EOPNOTSUPP;
+  if (deltas.empty())
+    return 0;
+  const int *matrix = get_coding_matrix();
+  unsigned blocksize = deltas.begin()->second.length();
+  char *coding[m];
+  for (int i = 0; i < m; i++) {
+    auto p = parity->find(k + i);
+    if (p == parity->end() || p->second.length() != blocksize)
+      return -EINVAL;
+    p->second.rebuild_aligned(LARGEST_VECTOR_WORDSIZE);
+    coding[i] = p->second.c_str();
+  }
+  for (auto& i : deltas) {
+    if (i.first >= k || i.second.length() != blocksize)
+      return -EINVAL;
+    bufferlist delta = i.second;
+    delta.rebuild_aligned(LARGEST_VECTOR_WORDSIZE);
+    for (int j = 0; j < m; j++) {
+      int coefficient = matrix[j * k + i.first];
+      if (coefficient == 0)
+	continue;
+      if (coefficient == 1) {
+	galois_region_xor(delta.c_str(), coding[j], blocksize);
+	continue;
+      }
+      switch (w) {
+      case 8:
+	galois_w08_region_multiply(delta.c_str(), coefficient, blocksize,
+				   coding[j], 1);
+	break;
+      case 16:
+	galois_w16_region_multiply(delta.c_str(), coefficient, blocksize,
+				   coding[j], 1);
+	break;
+      case 32:
+	galois_w32_region_multiply(delta.c_str(), coefficient, blocksize,
+				   coding[j], 1);
+	break;
+      default:
+	return -EINVAL;
+      }
+    }
+  }
+  return 0;
+}
+
 bool ErasureCodeJerasure::is_prime(int value)
 {
   int prime55[] = {
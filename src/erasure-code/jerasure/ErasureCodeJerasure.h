@@ -63,6 +63,25 @@ public:
 		    const std::map<int, ceph::buffer::list> &chunks,
 		    std::map<int, ceph::buffer::list> *decoded) override;
 
+  int encode_stripes(const std::set<int> &want_to_encode,
+		    const ceph::buffer::list &in,
+		    unsigned int chunk_size,
+		    std::map<int, ceph::buffer::list> *encoded) override {
+    return encode_stripes_contiguous(want_to_encode, in, chunk_size, encoded);
+  }
+
+  int decode_stripes(const std::set<int> &want_to_read,
+		    const std::map<int, ceph::buffer::list> &chunks,
+		    unsigned int chunk_size,
+		    std::map<int, ceph::buffer::list> *decoded) override {
+    return decode_stripes_contiguous(want_to_read, chunks, chunk_size, decoded);
+  }
+
+  uint64_t get_supported_optimizations() const override;
+
+  int apply_delta(const std::map<int, ceph::buffer::list> &deltas,
+		  std::map<int, ceph::buffer::list> *parity) override;
+
   int init(ceph::ErasureCodeProfile &profile, std::ostream *ss) override;
 
   virtual void jerasure_encode(char **data,
@@ -74,6 +93,8 @@ public:
                                int blocksize) = 0;
   virtual unsigned get_alignment() const = 0;
   virtual void prepare() = 0;
+  /// the coding matrix of Reed-Solomon techniques, NULL otherwise
+  virtual const int *get_coding_matrix() const { return nullptr; }
   static bool is_prime(int value);
 protected:
   virtual int parse(ceph::ErasureCodeProfile &profile, std::ostream *ss);
@@ -104,6 +125,9 @@ public:
                                int blocksize) override;
   unsigned get_alignment() const override;
   void prepare() override;
+  const int *get_coding_matrix() const override {
+    return matrix;
+  }
 private:
   int parse(ceph::ErasureCodeProfile& profile, std::ostream *ss) override;
 };
@@ -134,6 +158,9 @@ public:
                                int blocksize) override;
   unsigned get_alignment() const override;
   void prepare() override;
+  const int *get_coding_matrix() const override {
+    return matrix;
+  }
 private:
   int parse(ceph::ErasureCodeProfile& profile, std::ostream *ss) override;
 };
@@ -75,6 +75,9 @@
 /* Defined if you have libaio */
 #cmakedefine HAVE_LIBAIO
 
+/* Defined if you have liburing */
+#cmakedefine HAVE_LIBURING
+
 /* Defind if you have POSIX AIO */
 #cmakedefine HAVE_POSIXAIO
 
@@ -220,6 +223,9 @@
 /* Define to 1 if you have the `pipe2' function. */
 #cmakedefine HAVE_PIPE2 1
 
+/* Support AVX2 instructions */
+#cmakedefine HAVE_INTEL_AVX2
+
 /* Support NEON instructions */
 #cmakedefine HAVE_NEON
 
@@ -87,16 +87,19 @@
 #define RBD_OPERATION_FEATURE_CLONE_CHILD       (1ULL<<1)
 #define RBD_OPERATION_FEATURE_GROUP             (1ULL<<2)
 #define RBD_OPERATION_FEATURE_SNAP_TRASH        (1ULL<<3)
+#define RBD_OPERATION_FEATURE_DIRTY_BLOCKS      (1ULL<<4)
 
 #define RBD_OPERATION_FEATURE_NAME_CLONE_PARENT "clone-parent"
 #define RBD_OPERATION_FEATURE_NAME_CLONE_CHILD  "clone-child"
 #define RBD_OPERATION_FEATURE_NAME_GROUP        "group"
 #define RBD_OPERATION_FEATURE_NAME_SNAP_TRASH   "snap-trash"
+#define RBD_OPERATION_FEATURE_NAME_DIRTY_BLOCKS "dirty-blocks"
 
 /// all valid operation features
 #define RBD_OPERATION_FEATURES_ALL (RBD_OPERATION_FEATURE_CLONE_PARENT | \
                                     RBD_OPERATION_FEATURE_CLONE_CHILD  | \
                                     RBD_OPERATION_FEATURE_GROUP        | \
-                                    RBD_OPERATION_FEATURE_SNAP_TRASH)
+                                    RBD_OPERATION_FEATURE_SNAP_TRASH   | \
+                                    RBD_OPERATION_FEATURE_DIRTY_BLOCKS)
 
 #endif
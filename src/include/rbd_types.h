@@ -20,6 +20,7 @@
  *   rbd_id.foo              - id of image
  *   rbd_header.<id>         - image metadata
  *   rbd_object_map.<id>     - optional image object map
+ *   rbd_object_map_dirty.<id> - optional sub-object dirty blocks for fast-diff
  *   rbd_data.<id>.00000000
  *   rbd_data.<id>.00000001
  *   ...                     - data
@@ -27,6 +28,7 @@
 
 #define RBD_HEADER_PREFIX      "rbd_header."
 #define RBD_OBJECT_MAP_PREFIX  "rbd_object_map."
+#define RBD_OBJECT_MAP_DIRTY_PREFIX "rbd_object_map_dirty."
 #define RBD_DATA_PREFIX        "rbd_data."
 #define RBD_ID_PREFIX          "rbd_id."
 
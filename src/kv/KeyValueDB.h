@@ -8,6 +8,7 @@
 #include <set>
 #include <map>
 #include <string>
+#include <optional>
 #include <boost/scoped_ptr.hpp>
 #include "include/encoding.h"
 #include "common/Formatter.h"
@@ -277,7 +278,22 @@ public:
   };
   typedef std::shared_ptr< WholeSpaceIteratorImpl > WholeSpaceIterator;
 
-private:
+  /**
+   * Hints for an iterator that will only walk a bounded key range.
+   *
+   * Bounds are keys within the iterator's prefix; lower_bound is
+   * inclusive and upper_bound exclusive.  readahead is the number of
+   * bytes the backend may prefetch per sequential read (0 leaves the
+   * backend default).  Backends are free to ignore all of these, so
+   * callers must still check the keys they get back.
+   */
+  struct IteratorBounds {
+    std::optional<std::string> lower_bound;
+    std::optional<std::string> upper_bound;
+    size_t readahead = 0;
+  };
+
+protected:
   // This class filters a WholeSpaceIterator by a prefix.
   class PrefixIteratorImpl : public IteratorImpl {
     const std::string prefix;
@@ -334,6 +350,11 @@ public:
       prefix,
       get_wholespace_iterator());
   }
+  /// iterator over [bounds.lower_bound, bounds.upper_bound) within prefix
+  virtual Iterator get_bounded_iterator(const std::string &prefix,
+					const IteratorBounds &bounds) {
+    return get_iterator(prefix);
+  }
 
   void add_column_family(const std::string& cf_name, void *handle) {
     cf_handles.insert(std::make_pair(cf_name, handle));
@@ -1386,14 +1386,35 @@ RocksDBStore::WholeSpaceIterator RocksDBStore::get_wholespace_iterator()
     db->NewIterator(rocksdb::ReadOptions(), default_cf));
 }
 
+RocksDBStore::IteratorBoundsStorage::IteratorBoundsStorage(
+  std::optional<string>&& l,
+  std::optional<string>&& u,
+  size_t readahead)
+{
+  if (l) {
+    lower = std::move(*l);
+    lower_slice = rocksdb::Slice(lower);
+    options.iterate_lower_bound = &lower_slice;
+  }
+  if (u) {
+    upper = std::move(*u);
+    upper_slice = rocksdb::Slice(upper);
+    options.iterate_upper_bound = &upper_slice;
+  }
+  options.readahead_size = readahead;
+}
+
 class CFIteratorImpl : public KeyValueDB::IteratorImpl {
 protected:
   string prefix;
   rocksdb::Iterator *dbiter;
+  std::unique_ptr<RocksDBStore::IteratorBoundsStorage> bounds;
 public:
-  explicit CFIteratorImpl(const std::string& p,
-				 rocksdb::Iterator *iter)
-    : prefix(p), dbiter(iter) { }
+  explicit CFIteratorImpl(
+    const std::string& p,
+    rocksdb::Iterator *iter,
+    std::unique_ptr<RocksDBStore::IteratorBoundsStorage> b = nullptr)
+    : prefix(p), dbiter(iter), bounds(std::move(b)) { }
   ~CFIteratorImpl() {
     delete dbiter;
   }
@@ -1463,3 +1484,31 @@ KeyValueDB::Iterator RocksDBStore::get_iterator(const std::string& prefix)
     return KeyValueDB::get_iterator(prefix);
   }
 }
+
+KeyValueDB::Iterator RocksDBStore::get_bounded_iterator(
+  const std::string& prefix,
+  const IteratorBounds& b)
+{
+  rocksdb::ColumnFamilyHandle *cf_handle =
+    static_cast<rocksdb::ColumnFamilyHandle*>(get_cf_handle(prefix));
+  if (cf_handle) {
+    auto bounds = std::make_unique<IteratorBoundsStorage>(
+      std::optional<string>(b.lower_bound),
+      std::optional<string>(b.upper_bound),
+      b.readahead);
+    rocksdb::Iterator *it = db->NewIterator(bounds->options, cf_handle);
+    return std::make_shared<CFIteratorImpl>(prefix, it, std::move(bounds));
+  }
+  // keys in the default column family carry the prefix; keep the
+  // iterator from wandering into the next prefix even without an
+  // explicit upper bound.
+  auto bounds = std::make_unique<IteratorBoundsStorage>(
+    combine_strings(prefix, b.lower_bound.value_or(string())),
+    b.upper_bound ? combine_strings(prefix, *b.upper_bound) :
+                    past_prefix(prefix),
+    b.readahead);
+  rocksdb::Iterator *it = db->NewIterator(bounds->options, default_cf);
+  return std::make_shared<PrefixIteratorImpl>(
+    prefix,
+    std::make_shared<RocksDBWholeSpaceIteratorImpl>(it, std::move(bounds)));
+}
@@ -15,6 +15,7 @@
 #include "rocksdb/perf_context.h"
 #include "rocksdb/iostats_context.h"
 #include "rocksdb/statistics.h"
+#include "rocksdb/options.h"
 #include "rocksdb/table.h"
 #include "kv/rocksdb_cache/BinnedLRUCache.h"
 #include <errno.h>
@@ -359,13 +360,29 @@ public:
     bufferlist *out) override;
 
 
+  /// backing storage for the bound slices referenced by rocksdb::ReadOptions
+  struct IteratorBoundsStorage {
+    string lower, upper;
+    rocksdb::Slice lower_slice, upper_slice;
+    rocksdb::ReadOptions options;
+
+    IteratorBoundsStorage(std::optional<string>&& l,
+			  std::optional<string>&& u,
+			  size_t readahead);
+    IteratorBoundsStorage(const IteratorBoundsStorage&) = delete;
+    IteratorBoundsStorage& operator=(const IteratorBoundsStorage&) = delete;
+  };
+
   class RocksDBWholeSpaceIteratorImpl :
     public KeyValueDB::WholeSpaceIteratorImpl {
   protected:
     rocksdb::Iterator *dbiter;
+    std::unique_ptr<IteratorBoundsStorage> bounds;
   public:
-    explicit RocksDBWholeSpaceIteratorImpl(rocksdb::Iterator *iter) :
-      dbiter(iter) { }
+    explicit RocksDBWholeSpaceIteratorImpl(
+      rocksdb::Iterator *iter,
+      std::unique_ptr<IteratorBoundsStorage> b = nullptr) :
+      dbiter(iter), bounds(std::move(b)) { }
     //virtual ~RocksDBWholeSpaceIteratorImpl() { }
     ~RocksDBWholeSpaceIteratorImpl() override;
 
@@ -389,6 +406,8 @@ public:
   };
 
   Iterator get_iterator(const std::string& prefix) override;
+  Iterator get_bounded_iterator(const std::string& prefix,
+				const IteratorBounds& bounds) override;
 
   /// Utility
   static string combine_strings(const string &prefix, const string &value) {
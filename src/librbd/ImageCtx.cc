@@ -286,6 +286,9 @@ public:
     plb.add_u64_counter(l_librbd_readahead_bytes, "readahead_bytes", "Data size in read ahead", NULL, 0, unit_t(UNIT_BYTES));
     plb.add_u64_counter(l_librbd_invalidate_cache, "invalidate_cache", "Cache invalidates");
 
+    plb.add_u64_counter(l_librbd_sched_delayed, "sched_delayed", "Writes delayed by the IO scheduler");
+    plb.add_u64_counter(l_librbd_sched_dispatched, "sched_dispatched", "Writes dispatched by the IO scheduler after merging");
+
     plb.add_time(l_librbd_opened_time, "opened_time", "Opened time",
                  "ots", perf_prio);
     plb.add_time(l_librbd_lock_acquired_time, "lock_acquired_time",
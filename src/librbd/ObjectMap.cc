@@ -39,6 +39,8 @@ ObjectMap<I>::ObjectMap(I &image_ctx, uint64_t snap_id)
   : RefCountedObject(image_ctx.cct),
     m_image_ctx(image_ctx), m_snap_id(snap_id),
     m_lock(ceph::make_shared_mutex(util::unique_lock_name("librbd::ObjectMap::lock", this))),
+    m_dirty_block_size(get_dirty_block_size(image_ctx.layout)),
+    m_dirty_blocks_per_object(get_dirty_block_count(image_ctx.layout, 1)),
     m_update_guard(new UpdateGuard(m_image_ctx.cct)) {
 }
 
@@ -66,6 +68,53 @@ std::string ObjectMap<I>::object_map_name(const std::string &image_id,
   return oid;
 }
 
+template <typename I>
+std::string ObjectMap<I>::dirty_map_name(const std::string &image_id,
+                                         uint64_t snap_id) {
+  std::string oid(RBD_OBJECT_MAP_DIRTY_PREFIX + image_id);
+  if (snap_id != CEPH_NOSNAP) {
+    std::stringstream snap_suffix;
+    snap_suffix << "." << std::setfill('0') << std::setw(16) << std::hex
+		<< snap_id;
+    oid += snap_suffix.str();
+  }
+  return oid;
+}
+
+template <typename I>
+uint64_t ObjectMap<I>::get_dirty_block_size(const file_layout_t& layout) {
+  // 64 blocks per object, but no smaller than 4K
+  uint64_t object_size = layout.object_size;
+  return std::min<uint64_t>(object_size,
+                            std::max<uint64_t>(object_size >> 6, 1 << 12));
+}
+
+template <typename I>
+uint64_t ObjectMap<I>::get_dirty_block_count(const file_layout_t& layout,
+                                             uint64_t object_count) {
+  return object_count * (layout.object_size / get_dirty_block_size(layout));
+}
+
+template <typename I>
+void ObjectMap<I>::mark_dirty(const ceph::BitVector<2> &object_map,
+                              uint64_t blocks_per_object,
+                              ceph::BitVector<2> *dirty_map) {
+  // nothing is known about which blocks of existing objects were written
+  uint64_t block_count = object_map.size() * blocks_per_object;
+  object_map::ResizeRequest::resize(dirty_map, block_count,
+                                    OBJECT_EXISTS_CLEAN);
+
+  auto dirty_it = dirty_map->begin();
+  for (uint64_t object_no = 0; object_no < object_map.size(); ++object_no) {
+    uint8_t state = object_map[object_no];
+    for (uint64_t i = 0; i < blocks_per_object; ++i, ++dirty_it) {
+      if (state == OBJECT_EXISTS || state == OBJECT_PENDING) {
+        *dirty_it = OBJECT_EXISTS;
+      }
+    }
+  }
+}
+
 template <typename I>
 bool ObjectMap<I>::is_compatible(const file_layout_t& layout, uint64_t size) {
   uint64_t object_count = Striper::get_num_objects(layout, size);
@@ -145,12 +194,51 @@ bool ObjectMap<I>::update_required(const ceph::BitVector<2>::Iterator& it,
   return true;
 }
 
+template <typename I>
+bool ObjectMap<I>::update_required(uint64_t start_object_no,
+                                   uint64_t end_object_no,
+                                   uint64_t start_block, uint64_t end_block,
+                                   uint8_t new_state,
+                                   bool *update_object_map) {
+  ceph_assert(ceph_mutex_is_locked(m_lock));
+  auto it = m_object_map.begin() + start_object_no;
+  auto end_it = m_object_map.begin() + end_object_no;
+  for (; it != end_it; ++it) {
+    if (update_required(it, new_state)) {
+      break;
+    }
+  }
+
+  *update_object_map = (it != end_it);
+  if (*update_object_map) {
+    return true;
+  } else if (new_state != OBJECT_EXISTS) {
+    // objects that no longer exist don't need to be (re-)marked
+    return false;
+  }
+
+  // the object is already flagged as written since the last snapshot --
+  // but possibly not the blocks covered by this write
+  end_block = std::min(end_block, m_dirty_map.size());
+  if (start_block >= end_block) {
+    return false;
+  }
+  auto dirty_it = m_dirty_map.begin() + start_block;
+  auto dirty_end_it = m_dirty_map.begin() + end_block;
+  for (; dirty_it != dirty_end_it; ++dirty_it) {
+    if (*dirty_it != OBJECT_EXISTS) {
+      return true;
+    }
+  }
+  return false;
+}
+
 template <typename I>
 void ObjectMap<I>::open(Context *on_finish) {
   Context *ctx = create_context_callback<Context>(on_finish, this);
 
   auto req = object_map::RefreshRequest<I>::create(
-    m_image_ctx, &m_lock, &m_object_map, m_snap_id, ctx);
+    m_image_ctx, &m_lock, &m_object_map, &m_dirty_map, m_snap_id, ctx);
   req->send();
 }
 
@@ -184,6 +272,31 @@ void ObjectMap<I>::rollback(uint64_t snap_id, Context *on_finish) {
 
   std::unique_lock locker{m_lock};
   Context *ctx = create_context_callback<Context>(on_finish, this);
+  if ((m_image_ctx.op_features & RBD_OPERATION_FEATURE_DIRTY_BLOCKS) != 0) {
+    // blocks written since the last snapshot are no longer known -- the
+    // dirty map is reinitialized from the rolled back object map
+    m_dirty_map.clear();
+    ctx = new LambdaContext([this, ctx](int r) {
+        if (r < 0) {
+          ctx->complete(r);
+          return;
+        }
+        librados::AioCompletion *comp = util::create_rados_callback(
+          new LambdaContext([this, ctx](int r) {
+              if (r < 0 && r != -ENOENT) {
+                lderr(m_image_ctx.cct) << "failed to remove dirty map: "
+                                       << cpp_strerror(r) << dendl;
+                ctx->complete(r);
+                return;
+              }
+              ctx->complete(0);
+            }));
+        r = m_image_ctx.md_ctx.aio_remove(
+          dirty_map_name(m_image_ctx.id, CEPH_NOSNAP), comp);
+        ceph_assert(r == 0);
+        comp->release();
+      });
+  }
 
   object_map::SnapshotRollbackRequest *req =
     new object_map::SnapshotRollbackRequest(m_image_ctx, snap_id, ctx);
@@ -200,7 +313,7 @@ void ObjectMap<I>::snapshot_add(uint64_t snap_id, Context *on_finish) {
 
   object_map::SnapshotCreateRequest *req =
     new object_map::SnapshotCreateRequest(m_image_ctx, &m_lock, &m_object_map,
-                                          snap_id, ctx);
+                                          &m_dirty_map, snap_id, ctx);
   req->send();
 }
 
@@ -214,7 +327,7 @@ void ObjectMap<I>::snapshot_remove(uint64_t snap_id, Context *on_finish) {
 
   object_map::SnapshotRemoveRequest *req =
     new object_map::SnapshotRemoveRequest(m_image_ctx, &m_lock, &m_object_map,
-                                          snap_id, ctx);
+                                          &m_dirty_map, snap_id, ctx);
   req->send();
 }
 
@@ -224,7 +337,7 @@ void ObjectMap<I>::aio_save(Context *on_finish) {
   ceph_assert(ceph_mutex_is_locked(m_image_ctx.image_lock));
   ceph_assert(m_image_ctx.test_features(RBD_FEATURE_OBJECT_MAP,
                                         m_image_ctx.image_lock));
-  std::shared_lock locker{m_lock};
+  std::unique_lock locker{m_lock};
 
   librados::ObjectWriteOperation op;
   if (m_snap_id == CEPH_NOSNAP) {
@@ -233,6 +346,17 @@ void ObjectMap<I>::aio_save(Context *on_finish) {
   cls_client::object_map_save(&op, m_object_map);
 
   Context *ctx = create_context_callback<Context>(on_finish, this);
+  if (m_dirty_map.size() > 0) {
+    // the saved map replaces whatever was tracked since the last snapshot
+    mark_dirty(m_object_map, m_dirty_blocks_per_object, &m_dirty_map);
+    ctx = new LambdaContext([this, ctx](int r) {
+        if (r < 0) {
+          ctx->complete(r);
+          return;
+        }
+        aio_save_dirty_map(ctx);
+      });
+  }
 
   std::string oid(object_map_name(m_image_ctx.id, m_snap_id));
   librados::AioCompletion *comp = util::create_rados_callback(ctx);
@@ -242,6 +366,21 @@ void ObjectMap<I>::aio_save(Context *on_finish) {
   comp->release();
 }
 
+template <typename I>
+void ObjectMap<I>::aio_save_dirty_map(Context *on_finish) {
+  librados::ObjectWriteOperation op;
+  {
+    std::shared_lock locker{m_lock};
+    cls_client::object_map_save(&op, m_dirty_map);
+  }
+
+  std::string oid(dirty_map_name(m_image_ctx.id, m_snap_id));
+  librados::AioCompletion *comp = util::create_rados_callback(on_finish);
+  int r = m_image_ctx.md_ctx.aio_operate(oid, comp, &op);
+  ceph_assert(r == 0);
+  comp->release();
+}
+
 template <typename I>
 void ObjectMap<I>::aio_resize(uint64_t new_size, uint8_t default_object_state,
 			      Context *on_finish) {
@@ -254,6 +393,18 @@ void ObjectMap<I>::aio_resize(uint64_t new_size, uint8_t default_object_state,
               m_image_ctx.exclusive_lock->is_lock_owner());
 
   Context *ctx = create_context_callback<Context>(on_finish, this);
+  {
+    std::shared_lock locker{m_lock};
+    if (m_dirty_map.size() > 0) {
+      ctx = new LambdaContext([this, new_size, ctx](int r) {
+          if (r < 0) {
+            ctx->complete(r);
+            return;
+          }
+          aio_resize_dirty_map(new_size, ctx);
+        });
+    }
+  }
 
   object_map::ResizeRequest *req = new object_map::ResizeRequest(
     m_image_ctx, &m_lock, &m_object_map, m_snap_id, new_size,
@@ -261,6 +412,80 @@ void ObjectMap<I>::aio_resize(uint64_t new_size, uint8_t default_object_state,
   req->send();
 }
 
+template <typename I>
+void ObjectMap<I>::aio_resize_dirty_map(uint64_t new_size,
+                                        Context *on_finish) {
+  CephContext *cct = m_image_ctx.cct;
+  uint64_t block_count = get_dirty_block_count(
+    m_image_ctx.layout, Striper::get_num_objects(m_image_ctx.layout, new_size));
+
+  librados::ObjectWriteOperation op;
+  Context *ctx;
+  {
+    std::unique_lock locker{m_lock};
+    uint64_t orig_block_count = m_dirty_map.size();
+    ldout(cct, 20) << "block_count=" << block_count << dendl;
+
+    if (block_count > cls::rbd::MAX_OBJECT_MAP_OBJECT_COUNT) {
+      // stop tracking until the image shrinks again
+      lderr(cct) << "too many blocks to track: " << block_count << dendl;
+      m_dirty_map.clear();
+      op.remove();
+      ctx = new LambdaContext([this, on_finish](int r) {
+          handle_resize_dirty_map(r, on_finish);
+        });
+    } else if (block_count < orig_block_count) {
+      // keep the blocks of trimmed objects, marked dirty, until the next
+      // snapshot: objects recreated by growing the image again must not
+      // be diffed against what they held before the shrink
+      cls_client::object_map_update(&op, block_count, orig_block_count,
+                                    OBJECT_EXISTS, boost::none);
+      ctx = new LambdaContext([this, block_count, orig_block_count,
+                               on_finish](int r) {
+          if (r == 0) {
+            std::unique_lock locker{m_lock};
+            auto it = m_dirty_map.begin() + block_count;
+            auto end_it = m_dirty_map.begin() +
+                          std::min(orig_block_count, m_dirty_map.size());
+            for (; it != end_it; ++it) {
+              *it = OBJECT_EXISTS;
+            }
+          }
+          handle_resize_dirty_map(r, on_finish);
+        });
+    } else {
+      cls_client::object_map_resize(&op, block_count, OBJECT_EXISTS_CLEAN);
+      ctx = new LambdaContext([this, block_count, on_finish](int r) {
+          if (r == 0) {
+            std::unique_lock locker{m_lock};
+            object_map::ResizeRequest::resize(&m_dirty_map, block_count,
+                                              OBJECT_EXISTS_CLEAN);
+          }
+          handle_resize_dirty_map(r, on_finish);
+        });
+    }
+  }
+
+  std::string oid(dirty_map_name(m_image_ctx.id, m_snap_id));
+  librados::AioCompletion *comp = util::create_rados_callback(ctx);
+  int r = m_image_ctx.md_ctx.aio_operate(oid, comp, &op);
+  ceph_assert(r == 0);
+  comp->release();
+}
+
+template <typename I>
+void ObjectMap<I>::handle_resize_dirty_map(int r, Context *on_finish) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 20) << "r=" << r << dendl;
+
+  if (r < 0 && r != -ENOENT) {
+    // blocks beyond the in-memory dirty map are not tracked and a stale
+    // on-disk size is corrected when the dirty map is next loaded
+    lderr(cct) << "failed to resize dirty map: " << cpp_strerror(r) << dendl;
+  }
+  on_finish->complete(0);
+}
+
 template <typename I>
 void ObjectMap<I>::detained_aio_update(UpdateOperation &&op) {
   CephContext *cct = m_image_ctx.cct;
@@ -293,8 +518,9 @@ void ObjectMap<I>::detained_aio_update(UpdateOperation &&op) {
   Context *ctx = new LambdaContext([this, cell, on_finish](int r) {
       handle_detained_aio_update(cell, r, on_finish);
     });
-  aio_update(CEPH_NOSNAP, op.start_object_no, op.end_object_no, op.new_state,
-             op.current_state, op.parent_trace, op.ignore_enoent, ctx);
+  aio_update(CEPH_NOSNAP, op.start_object_no, op.end_object_no,
+             op.start_block, op.end_block, op.new_state, op.current_state,
+             op.parent_trace, op.ignore_enoent, ctx);
 }
 
 template <typename I>
@@ -319,7 +545,8 @@ void ObjectMap<I>::handle_detained_aio_update(BlockGuardCell *cell, int r,
 
 template <typename I>
 void ObjectMap<I>::aio_update(uint64_t snap_id, uint64_t start_object_no,
-                              uint64_t end_object_no, uint8_t new_state,
+                              uint64_t end_object_no, uint64_t start_block,
+                              uint64_t end_block, uint8_t new_state,
                               const boost::optional<uint8_t> &current_state,
                               const ZTracer::Trace &parent_trace,
                               bool ignore_enoent, Context *on_finish) {
@@ -336,6 +563,11 @@ void ObjectMap<I>::aio_update(uint64_t snap_id, uint64_t start_object_no,
                  << (current_state ?
                        stringify(static_cast<uint32_t>(*current_state)) : "")
 		 << "->" << static_cast<uint32_t>(new_state) << dendl;
+  bool dirty_tracking = m_dirty_map.size() > 0;
+  if (!dirty_tracking) {
+    start_block = end_block = 0;
+  }
+
   if (snap_id == CEPH_NOSNAP) {
     ceph_assert(ceph_mutex_is_wlocked(m_lock));
     end_object_no = std::min(end_object_no, m_object_map.size());
@@ -345,24 +577,30 @@ void ObjectMap<I>::aio_update(uint64_t snap_id, uint64_t start_object_no,
       return;
     }
 
-    auto it = m_object_map.begin() + start_object_no;
-    auto end_it = m_object_map.begin() + end_object_no;
-    for (; it != end_it; ++it) {
-      if (update_required(it, new_state)) {
-        break;
-      }
-    }
-    if (it == end_it) {
+    bool update_object_map;
+    if (!update_required(start_object_no, end_object_no, start_block,
+                         end_block, new_state, &update_object_map)) {
       ldout(cct, 20) << "object map update not required" << dendl;
       m_image_ctx.op_work_queue->queue(on_finish, 0);
       return;
+    } else if (!update_object_map) {
+      // only the dirty blocks need to be recorded
+      ldout(cct, 20) << "dirty block update only: [" << start_block << ","
+                     << end_block << ")" << dendl;
+      start_object_no = end_object_no;
     }
+  } else if (dirty_tracking && new_state == OBJECT_EXISTS) {
+    // snapshot object maps are only updated for whole objects
+    start_block = start_object_no * m_dirty_blocks_per_object;
+    end_block = end_object_no * m_dirty_blocks_per_object;
+  } else {
+    start_block = end_block = 0;
   }
 
   auto req = object_map::UpdateRequest<I>::create(
-    m_image_ctx, &m_lock, &m_object_map, snap_id, start_object_no,
-    end_object_no, new_state, current_state, parent_trace, ignore_enoent,
-    on_finish);
+    m_image_ctx, &m_lock, &m_object_map, &m_dirty_map, snap_id,
+    start_object_no, end_object_no, start_block, end_block, new_state,
+    current_state, parent_trace, ignore_enoent, on_finish);
   req->send();
 }
 
@@ -36,6 +36,14 @@ public:
   static int aio_remove(librados::IoCtx &io_ctx, const std::string &image_id, librados::AioCompletion *c);
   static std::string object_map_name(const std::string &image_id,
 				     uint64_t snap_id);
+  static std::string dirty_map_name(const std::string &image_id,
+                                    uint64_t snap_id);
+  static uint64_t get_dirty_block_size(const file_layout_t& layout);
+  static uint64_t get_dirty_block_count(const file_layout_t& layout,
+                                        uint64_t object_count);
+  static void mark_dirty(const ceph::BitVector<2> &object_map,
+                         uint64_t blocks_per_object,
+                         ceph::BitVector<2> *dirty_map);
 
   static bool is_compatible(const file_layout_t& layout, uint64_t size);
 
@@ -84,36 +92,43 @@ public:
     ceph_assert(start_object_no < end_object_no);
     std::unique_lock locker{m_lock};
 
-    if (snap_id == CEPH_NOSNAP) {
-      end_object_no = std::min(end_object_no, m_object_map.size());
-      if (start_object_no >= end_object_no) {
-        return false;
-      }
-
-      auto it = m_object_map.begin() + start_object_no;
-      auto end_it = m_object_map.begin() + end_object_no;
-      for (; it != end_it; ++it) {
-        if (update_required(it, new_state)) {
-          break;
-        }
-      }
+    // without an extent, objects that become (or stop) existing are
+    // considered dirty throughout
+    uint64_t start_block = 0;
+    uint64_t end_block = 0;
+    if (new_state == OBJECT_EXISTS || new_state == OBJECT_PENDING) {
+      start_block = start_object_no * m_dirty_blocks_per_object;
+      end_block = end_object_no * m_dirty_blocks_per_object;
+    }
+    return aio_update<T, MF>(snap_id, start_object_no, end_object_no,
+                             start_block, end_block, new_state, current_state,
+                             parent_trace, ignore_enoent, callback_object);
+  }
 
-      if (it == end_it) {
-        return false;
-      }
+  template <typename T, void(T::*MF)(int) = &T::complete>
+  bool aio_update(uint64_t snap_id, uint64_t object_no, uint64_t object_off,
+                  uint64_t object_len, uint8_t new_state,
+                  const boost::optional<uint8_t> &current_state,
+                  const ZTracer::Trace &parent_trace, bool ignore_enoent,
+                  T *callback_object) {
+    std::unique_lock locker{m_lock};
 
-      UpdateOperation update_operation(start_object_no, end_object_no,
-                                       new_state, current_state, parent_trace,
-                                       ignore_enoent,
-                                       util::create_context_callback<T, MF>(
-                                         callback_object));
-      detained_aio_update(std::move(update_operation));
-    } else {
-      aio_update(snap_id, start_object_no, end_object_no, new_state,
-                 current_state, parent_trace, ignore_enoent,
-                 util::create_context_callback<T, MF>(callback_object));
+    // only the blocks touched by the write become dirty
+    uint64_t start_block = 0;
+    uint64_t end_block = 0;
+    if (new_state == OBJECT_EXISTS && object_len > 0) {
+      start_block = object_no * m_dirty_blocks_per_object +
+                    object_off / m_dirty_block_size;
+      end_block = object_no * m_dirty_blocks_per_object +
+                  (object_off + object_len + m_dirty_block_size - 1) /
+                    m_dirty_block_size;
+    } else if (new_state == OBJECT_EXISTS || new_state == OBJECT_PENDING) {
+      start_block = object_no * m_dirty_blocks_per_object;
+      end_block = (object_no + 1) * m_dirty_blocks_per_object;
     }
-    return true;
+    return aio_update<T, MF>(snap_id, object_no, object_no + 1, start_block,
+                             end_block, new_state, current_state, parent_trace,
+                             ignore_enoent, callback_object);
   }
 
   void rollback(uint64_t snap_id, Context *on_finish);
@@ -124,6 +139,8 @@ private:
   struct UpdateOperation {
     uint64_t start_object_no;
     uint64_t end_object_no;
+    uint64_t start_block;
+    uint64_t end_block;
     uint8_t new_state;
     boost::optional<uint8_t> current_state;
     ZTracer::Trace parent_trace;
@@ -131,12 +148,14 @@ private:
     Context *on_finish;
 
     UpdateOperation(uint64_t start_object_no, uint64_t end_object_no,
+                    uint64_t start_block, uint64_t end_block,
                     uint8_t new_state,
                     const boost::optional<uint8_t> &current_state,
                     const ZTracer::Trace &parent_trace,
                     bool ignore_enoent, Context *on_finish)
       : start_object_no(start_object_no), end_object_no(end_object_no),
-        new_state(new_state), current_state(current_state),
+        start_block(start_block), end_block(end_block), new_state(new_state),
+        current_state(current_state),
         parent_trace(parent_trace), ignore_enoent(ignore_enoent),
         on_finish(on_finish) {
     }
@@ -150,19 +169,69 @@ private:
   mutable ceph::shared_mutex m_lock;
   ceph::BitVector<2> m_object_map;
 
+  // blocks written since the last snapshot (OBJECT_EXISTS) -- empty if
+  // sub-object dirty tracking is not in use
+  ceph::BitVector<2> m_dirty_map;
+  uint64_t m_dirty_block_size;
+  uint64_t m_dirty_blocks_per_object;
+
   UpdateGuard *m_update_guard = nullptr;
 
+  void aio_save_dirty_map(Context *on_finish);
+  void aio_resize_dirty_map(uint64_t new_size, Context *on_finish);
+  void handle_resize_dirty_map(int r, Context *on_finish);
+
   void detained_aio_update(UpdateOperation &&update_operation);
   void handle_detained_aio_update(BlockGuardCell *cell, int r,
                                   Context *on_finish);
 
+  template <typename T, void(T::*MF)(int)>
+  bool aio_update(uint64_t snap_id, uint64_t start_object_no,
+                  uint64_t end_object_no, uint64_t start_block,
+                  uint64_t end_block, uint8_t new_state,
+                  const boost::optional<uint8_t> &current_state,
+                  const ZTracer::Trace &parent_trace, bool ignore_enoent,
+                  T *callback_object) {
+    ceph_assert(ceph_mutex_is_wlocked(m_lock));
+    if (snap_id == CEPH_NOSNAP) {
+      end_object_no = std::min(end_object_no, m_object_map.size());
+      if (start_object_no >= end_object_no) {
+        return false;
+      }
+
+      bool update_object_map;
+      if (!update_required(start_object_no, end_object_no, start_block,
+                           end_block, new_state, &update_object_map)) {
+        return false;
+      }
+
+      UpdateOperation update_operation(start_object_no, end_object_no,
+                                       start_block, end_block, new_state,
+                                       current_state, parent_trace,
+                                       ignore_enoent,
+                                       util::create_context_callback<T, MF>(
+                                         callback_object));
+      detained_aio_update(std::move(update_operation));
+    } else {
+      aio_update(snap_id, start_object_no, end_object_no, start_block,
+                 end_block, new_state, current_state, parent_trace,
+                 ignore_enoent,
+                 util::create_context_callback<T, MF>(callback_object));
+    }
+    return true;
+  }
+
   void aio_update(uint64_t snap_id, uint64_t start_object_no,
-                  uint64_t end_object_no, uint8_t new_state,
+                  uint64_t end_object_no, uint64_t start_block,
+                  uint64_t end_block, uint8_t new_state,
                   const boost::optional<uint8_t> &current_state,
                   const ZTracer::Trace &parent_trace, bool ignore_enoent,
                   Context *on_finish);
   bool update_required(const ceph::BitVector<2>::Iterator &it,
                        uint8_t new_state);
+  bool update_required(uint64_t start_object_no, uint64_t end_object_no,
+                       uint64_t start_block, uint64_t end_block,
+                       uint8_t new_state, bool *update_object_map);
 
 };
 
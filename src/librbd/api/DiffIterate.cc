@@ -32,9 +32,10 @@ namespace api {
 namespace {
 
 enum ObjectDiffState {
-  OBJECT_DIFF_STATE_NONE    = 0,
-  OBJECT_DIFF_STATE_UPDATED = 1,
-  OBJECT_DIFF_STATE_HOLE    = 2
+  OBJECT_DIFF_STATE_NONE           = 0,
+  OBJECT_DIFF_STATE_UPDATED        = 1,
+  OBJECT_DIFF_STATE_HOLE           = 2,
+  OBJECT_DIFF_STATE_UPDATED_BLOCKS = 3  ///< only dirty blocks updated
 };
 
 struct DiffContext {
@@ -225,6 +226,51 @@ int simple_diff_cb(uint64_t off, size_t len, int exists, void *arg) {
   return 0;
 }
 
+int diff_dirty_blocks(CephContext* cct, DiffIterate<>::Callback callback,
+                      void *callback_arg,
+                      const std::vector<ObjectExtent>& object_extents,
+                      uint64_t off, uint64_t object_no, uint64_t block_size,
+                      uint64_t blocks_per_object,
+                      const BitVector<2>& block_diff_state) {
+  // intersect each extent with the dirty blocks of the object
+  interval_set<uint64_t> dirty;
+  uint64_t block_no = object_no * blocks_per_object;
+  for (uint64_t i = 0; i < blocks_per_object; ++i) {
+    if (block_diff_state[block_no + i] != 0) {
+      dirty.union_insert(i * block_size, block_size);
+    }
+  }
+  ldout(cct, 20) << "object " << object_no << " dirty blocks " << dirty
+                 << dendl;
+
+  for (auto& q : object_extents) {
+    if (dirty.empty()) {
+      // nothing recorded for an updated object: provide all of it
+      int r = callback(off + q.offset, q.length, true, callback_arg);
+      if (r < 0) {
+        return r;
+      }
+      continue;
+    }
+
+    uint64_t opos = q.offset;
+    for (auto& be : q.buffer_extents) {
+      interval_set<uint64_t> overlap;
+      overlap.insert(opos, be.second);
+      overlap.intersection_of(dirty);
+      for (auto s = overlap.begin(); s != overlap.end(); ++s) {
+        int r = callback(off + be.first + s.get_start() - opos, s.get_len(),
+                         true, callback_arg);
+        if (r < 0) {
+          return r;
+        }
+      }
+      opos += be.second;
+    }
+  }
+  return 0;
+}
+
 } // anonymous namespace
 
 template <typename I>
@@ -313,10 +359,12 @@ int DiffIterate<I>::execute() {
   int r;
   bool fast_diff_enabled = false;
   BitVector<2> object_diff_state;
+  BitVector<2> block_diff_state;
   {
     std::shared_lock image_locker{m_image_ctx.image_lock};
     if (m_whole_object && (m_image_ctx.features & RBD_FEATURE_FAST_DIFF) != 0) {
-      r = diff_object_map(from_snap_id, end_snap_id, &object_diff_state);
+      r = diff_object_map(from_snap_id, end_snap_id, &object_diff_state,
+                          &block_diff_state);
       if (r < 0) {
         ldout(cct, 5) << "fast diff disabled" << dendl;
       } else {
@@ -356,6 +404,10 @@ int DiffIterate<I>::execute() {
   }
 
   uint64_t period = m_image_ctx.get_stripe_period();
+  uint64_t block_size = ObjectMap<>::get_dirty_block_size(
+    m_image_ctx.layout);
+  uint64_t blocks_per_object = ObjectMap<>::get_dirty_block_count(
+    m_image_ctx.layout, 1);
   uint64_t off = m_offset;
   uint64_t left = m_length;
 
@@ -377,7 +429,14 @@ int DiffIterate<I>::execute() {
 
       if (fast_diff_enabled) {
         const uint64_t object_no = p->second.front().objectno;
-        if (object_diff_state[object_no] != OBJECT_DIFF_STATE_NONE) {
+        if (object_diff_state[object_no] == OBJECT_DIFF_STATE_UPDATED_BLOCKS) {
+          r = diff_dirty_blocks(cct, m_callback, m_callback_arg, p->second,
+                                off, object_no, block_size, blocks_per_object,
+                                block_diff_state);
+          if (r < 0) {
+            return r;
+          }
+        } else if (object_diff_state[object_no] != OBJECT_DIFF_STATE_NONE) {
           bool updated = (object_diff_state[object_no] ==
                             OBJECT_DIFF_STATE_UPDATED);
           for (std::vector<ObjectExtent>::iterator q = p->second.begin();
@@ -413,9 +472,43 @@ int DiffIterate<I>::execute() {
   return 0;
 }
 
+template <typename I>
+void DiffIterate<I>::diff_dirty_map(uint64_t snap_id, uint64_t num_objs,
+                                    BitVector<2>* block_diff_state) {
+  ceph_assert(ceph_mutex_is_locked(m_image_ctx.image_lock));
+  CephContext* cct = m_image_ctx.cct;
+
+  block_diff_state->clear();
+  if ((m_image_ctx.op_features & RBD_OPERATION_FEATURE_DIRTY_BLOCKS) == 0) {
+    return;
+  }
+
+  BitVector<2> dirty_map;
+  std::string oid(ObjectMap<>::dirty_map_name(m_image_ctx.id, snap_id));
+  int r = cls_client::object_map_load(&m_image_ctx.md_ctx, oid, &dirty_map);
+  if (r < 0) {
+    ldout(cct, 5) << "diff_object_map: failed to load dirty map " << oid
+                  << ": " << cpp_strerror(r) << dendl;
+    return;
+  }
+
+  uint64_t num_blocks = ObjectMap<>::get_dirty_block_count(
+    m_image_ctx.layout, num_objs);
+  if (dirty_map.size() < num_blocks) {
+    ldout(cct, 5) << "diff_object_map: dirty map too small: "
+                  << dirty_map.size() << " < " << num_blocks << dendl;
+    return;
+  }
+  ldout(cct, 20) << "diff_object_map: loaded dirty map " << oid << dendl;
+
+  dirty_map.resize(num_blocks);
+  *block_diff_state = std::move(dirty_map);
+}
+
 template <typename I>
 int DiffIterate<I>::diff_object_map(uint64_t from_snap_id, uint64_t to_snap_id,
-                                    BitVector<2>* object_diff_state) {
+                                    BitVector<2>* object_diff_state,
+                                    BitVector<2>* block_diff_state) {
   ceph_assert(ceph_mutex_is_locked(m_image_ctx.image_lock));
   CephContext* cct = m_image_ctx.cct;
 
@@ -429,6 +522,9 @@ int DiffIterate<I>::diff_object_map(uint64_t from_snap_id, uint64_t to_snap_id,
   }
 
   object_diff_state->clear();
+  block_diff_state->clear();
+  uint64_t blocks_per_object = ObjectMap<>::get_dirty_block_count(
+    m_image_ctx.layout, 1);
   uint64_t current_snap_id = from_snap_id;
   uint64_t next_snap_id = to_snap_id;
   BitVector<2> prev_object_map;
@@ -481,6 +577,13 @@ int DiffIterate<I>::diff_object_map(uint64_t from_snap_id, uint64_t to_snap_id,
     }
     object_map.resize(num_objs);
     object_diff_state->resize(object_map.size());
+    block_diff_state->resize(object_map.size() * blocks_per_object);
+
+    // blocks written since the previous snapshot, if they were tracked
+    BitVector<2> dirty_map;
+    if (prev_object_map_valid) {
+      diff_dirty_map(current_snap_id, num_objs, &dirty_map);
+    }
 
     uint64_t overlap = std::min(object_map.size(), prev_object_map.size());
     auto it = object_map.begin();
@@ -496,6 +599,19 @@ int DiffIterate<I>::diff_object_map(uint64_t from_snap_id, uint64_t to_snap_id,
         if (*pre_it != OBJECT_NONEXISTENT) {
           *diff_it = OBJECT_DIFF_STATE_HOLE;
         }
+      } else if (*it == OBJECT_EXISTS && dirty_map.size() > 0 &&
+                 (*pre_it == OBJECT_EXISTS ||
+                  *pre_it == OBJECT_EXISTS_CLEAN) &&
+                 (*diff_it == OBJECT_DIFF_STATE_NONE ||
+                  *diff_it == OBJECT_DIFF_STATE_UPDATED_BLOCKS)) {
+        // the object was only partially rewritten
+        *diff_it = OBJECT_DIFF_STATE_UPDATED_BLOCKS;
+        for (uint64_t b = i * blocks_per_object;
+             b < (i + 1) * blocks_per_object; ++b) {
+          if (dirty_map[b] == OBJECT_EXISTS) {
+            (*block_diff_state)[b] = 1;
+          }
+        }
       } else if (*it == OBJECT_EXISTS ||
                  (*pre_it != *it &&
                   !(*pre_it == OBJECT_EXISTS &&
@@ -54,7 +54,10 @@ private:
   int execute();
 
   int diff_object_map(uint64_t from_snap_id, uint64_t to_snap_id,
-                      BitVector<2>* object_diff_state);
+                      BitVector<2>* object_diff_state,
+                      BitVector<2>* block_diff_state);
+  void diff_dirty_map(uint64_t snap_id, uint64_t num_objs,
+                      BitVector<2>* block_diff_state);
 
 };
 
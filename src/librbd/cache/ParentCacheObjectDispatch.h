@@ -64,6 +64,15 @@ public:
     return false;
   }
 
+  bool write_extents(
+      uint64_t object_no, io::Extents&& extents, ceph::bufferlist&& data,
+      const ::SnapContext &snapc, int op_flags,
+      const ZTracer::Trace &parent_trace, int* object_dispatch_flags,
+      uint64_t* journal_tid, io::DispatchResult* dispatch_result,
+      Context** on_finish, Context* on_dispatched) {
+    return false;
+  }
+
   bool write_same(
       uint64_t object_no, uint64_t object_off, uint64_t object_len,
       io::LightweightBufferExtents&& buffer_extents, ceph::bufferlist&& data, 
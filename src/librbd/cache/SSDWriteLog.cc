@@ -0,0 +1,1133 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "SSDWriteLog.h"
+#include "cls/rbd/cls_rbd_client.h"
+#include "common/Cond.h"
+#include "common/Thread.h"
+#include "common/WorkQueue.h"
+#include "common/dout.h"
+#include "common/errno.h"
+#include "common/hostname.h"
+#include "common/safe_io.h"
+#include "include/byteorder.h"
+#include "include/crc32c.h"
+#include "include/intarith.h"
+#include "include/stringify.h"
+#include "librbd/ImageCtx.h"
+#include "librbd/Utils.h"
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+#define dout_subsys ceph_subsys_rbd
+#undef dout_prefix
+#define dout_prefix *_dout << "librbd::cache::SSDWriteLog: " << this << " " \
+                           <<  __func__ << ": "
+
+namespace librbd {
+namespace cache {
+
+namespace {
+
+/*
+ * Log file layout:
+ *
+ *   [superblock][record][record]...[pad]   <- wraps back to the first record
+ *
+ * Each record is a header followed by its data, padded to RECORD_ALIGN.
+ * Records carry consecutive sequence numbers; recovery starts from the
+ * superblock's head and accepts records for as long as the sequence
+ * continues and the header and data checksums match.
+ */
+const uint32_t SUPERBLOCK_MAGIC = 0x72626c67;   // "rblg"
+const uint32_t RECORD_MAGIC = 0x7262726e;       // "rbrn"
+const uint32_t LOG_VERSION = 1;
+
+const uint64_t SUPERBLOCK_SIZE = 4096;
+const uint64_t RECORD_ALIGN = 512;
+const uint64_t RECORD_MAX_DATA = 1 << 20;
+
+enum : uint32_t {
+  RECORD_WRITE = 1,
+  RECORD_PAD = 2,         ///< skip to the start of the log
+};
+
+struct superblock_t {
+  ceph_le32 magic;
+  ceph_le32 version;
+  ceph_le64 log_size;
+  ceph_le64 head;
+  ceph_le64 head_seq;
+  ceph_le32 crc;
+} __attribute__ ((packed));
+
+struct record_header_t {
+  ceph_le32 magic;
+  ceph_le32 type;
+  ceph_le64 seq;
+  ceph_le64 image_offset;
+  ceph_le64 length;
+  ceph_le32 data_crc;
+  ceph_le32 crc;
+} __attribute__ ((packed));
+
+const uint64_t HEADER_SIZE = sizeof(record_header_t);
+
+uint64_t record_length(uint64_t data_length) {
+  return p2roundup(HEADER_SIZE + data_length, RECORD_ALIGN);
+}
+
+template <typename T>
+uint32_t struct_crc(const T &t) {
+  return ceph_crc32c(0, reinterpret_cast<const unsigned char*>(&t),
+                     offsetof(T, crc));
+}
+
+} // anonymous namespace
+
+const std::string SSDWriteLogState::KEY(".librbd/persistent_cache_state");
+
+std::string SSDWriteLogState::encode() const {
+  return host + ":" + path;
+}
+
+bool SSDWriteLogState::decode(const std::string &value) {
+  auto pos = value.find(':');
+  if (pos == 0 || pos == std::string::npos || pos + 1 == value.size()) {
+    return false;
+  }
+  host = value.substr(0, pos);
+  path = value.substr(pos + 1);
+  return true;
+}
+
+std::ostream &operator<<(std::ostream &os, const SSDWriteLogState &state) {
+  return os << "[host=" << state.host << ", path=" << state.path << "]";
+}
+
+template <typename I>
+SSDWriteLog<I>::SSDWriteLog(I &image_ctx, const SSDWriteLogState &state)
+  : m_image_ctx(image_ctx), m_image_writeback(image_ctx), m_state(state) {
+  auto& config = m_image_ctx.config;
+  m_path = config.template get_val<std::string>("rbd_persistent_cache_path") +
+    "/rbd-ssd-wl." + stringify(m_image_ctx.md_ctx.get_id()) + "." +
+    m_image_ctx.id;
+  m_log_size = SUPERBLOCK_SIZE + p2align<uint64_t>(
+    config.template get_val<Option::size_t>("rbd_persistent_cache_size"),
+    RECORD_ALIGN);
+  // an append group must always fit in the log, even when it is empty
+  m_writeback_bytes = std::min<uint64_t>(
+    config.template get_val<Option::size_t>(
+      "rbd_persistent_cache_writeback_bytes"),
+    (m_log_size - SUPERBLOCK_SIZE) / 4);
+  m_head = m_tail = m_committed_tail = data_start();
+  m_next_seq = m_committed_seq = 1;
+}
+
+template <typename I>
+SSDWriteLog<I>::~SSDWriteLog() {
+  stop_threads();
+  if (m_fd >= 0) {
+    // anything still logged is replayed when the cache is next opened
+    VOID_TEMP_FAILURE_RETRY(::close(m_fd));
+  }
+}
+
+template <typename I>
+uint64_t SSDWriteLog<I>::data_start() const {
+  return SUPERBLOCK_SIZE;
+}
+
+template <typename I>
+uint64_t SSDWriteLog<I>::free_space() const {
+  return m_log_size - data_start() - m_used;
+}
+
+template <typename I>
+bool SSDWriteLog<I>::reserve(uint64_t length, uint64_t *offset,
+                             uint64_t *pad) {
+  ceph_assert(ceph_mutex_is_locked(m_lock));
+  *pad = 0;
+  if (length > free_space()) {
+    return false;
+  }
+  if (m_tail < m_head) {
+    // free space is [tail, head)
+    *offset = m_tail;
+    return true;
+  }
+
+  // free space is [tail, end) + [start, head)
+  if (m_tail + length <= m_log_size) {
+    *offset = m_tail;
+    return true;
+  }
+  if (data_start() + length > m_head) {
+    return false;
+  }
+  *pad = m_log_size - m_tail;
+  if (*pad + length > free_space()) {
+    return false;
+  }
+  *offset = data_start();
+  return true;
+}
+
+template <typename I>
+int SSDWriteLog<I>::open_log(bool *created) {
+  CephContext *cct = m_image_ctx.cct;
+  *created = false;
+
+  // only the log the image still names may hold data it doesn't have
+  const bool dirty = !m_state.empty();
+  m_fd = ::open(m_path.c_str(), O_RDWR | O_CLOEXEC | (dirty ? 0 : O_CREAT),
+                0600);
+  if (m_fd < 0) {
+    int r = -errno;
+    if (dirty && r == -ENOENT) {
+      lderr(cct) << "log " << m_path << " is missing, writes it held are "
+                 << "lost; remove image metadata " << SSDWriteLogState::KEY
+                 << " to go on without them" << dendl;
+    } else {
+      lderr(cct) << "failed to open " << m_path << ": " << cpp_strerror(r)
+                 << dendl;
+    }
+    return r;
+  }
+
+  // a process that lost the exclusive lock may still have the log open
+  if (::flock(m_fd, LOCK_EX | LOCK_NB) < 0) {
+    int r = -errno;
+    lderr(cct) << "failed to lock " << m_path << ": " << cpp_strerror(r)
+               << dendl;
+    return r == -EWOULDBLOCK ? -EBUSY : r;
+  }
+
+  superblock_t sb;
+  int r = safe_pread_exact(m_fd, &sb, sizeof(sb), 0);
+  if (!dirty) {
+    ldout(cct, 5) << "creating new log " << m_path << dendl;
+  } else if (r == 0 && sb.magic == SUPERBLOCK_MAGIC &&
+             sb.version == LOG_VERSION && sb.crc == struct_crc(sb) &&
+             sb.log_size > SUPERBLOCK_SIZE && sb.head >= SUPERBLOCK_SIZE &&
+             sb.head <= sb.log_size) {
+    if (sb.log_size != m_log_size) {
+      ldout(cct, 1) << "keeping existing log size " << sb.log_size
+                    << " until the log is written back" << dendl;
+      m_log_size = sb.log_size;
+      m_writeback_bytes = std::min(m_writeback_bytes,
+                                   (m_log_size - SUPERBLOCK_SIZE) / 4);
+    }
+    m_head = m_tail = m_committed_tail = sb.head;
+    m_next_seq = m_committed_seq = sb.head_seq;
+    return 0;
+  } else {
+    lderr(cct) << "log " << m_path << " is damaged, writes it held are "
+               << "lost; remove image metadata " << SSDWriteLogState::KEY
+               << " to go on without them" << dendl;
+    return -EIO;
+  }
+
+  // anything left from an earlier session was written back or discarded
+  *created = true;
+  if (::ftruncate(m_fd, 0) < 0 || ::ftruncate(m_fd, m_log_size) < 0) {
+    r = -errno;
+    lderr(cct) << "failed to size " << m_path << ": " << cpp_strerror(r)
+               << dendl;
+    return r;
+  }
+  return write_superblock(m_head, m_next_seq);
+}
+
+template <typename I>
+int SSDWriteLog<I>::write_superblock(uint64_t head, uint64_t head_seq) {
+  superblock_t sb;
+  sb.magic = SUPERBLOCK_MAGIC;
+  sb.version = LOG_VERSION;
+  sb.log_size = m_log_size;
+  sb.head = head;
+  sb.head_seq = head_seq;
+  sb.crc = struct_crc(sb);
+
+  // the superblock fits in one sector, so it is never torn
+  int r = safe_pwrite(m_fd, &sb, sizeof(sb), 0);
+  if (r == 0 && ::fdatasync(m_fd) < 0) {
+    r = -errno;
+  }
+  if (r < 0) {
+    lderr(m_image_ctx.cct) << "failed to write superblock: "
+                           << cpp_strerror(r) << dendl;
+  }
+  return r;
+}
+
+template <typename I>
+int SSDWriteLog<I>::replay() {
+  CephContext *cct = m_image_ctx.cct;
+  const uint64_t capacity = m_log_size - data_start();
+
+  uint64_t pos = m_head;
+  uint64_t seq = m_next_seq;
+  uint64_t scanned = 0;
+  while (scanned < capacity) {
+    if (pos == m_log_size) {
+      pos = data_start();
+    }
+    record_header_t h;
+    if (safe_pread_exact(m_fd, &h, sizeof(h), pos) < 0 ||
+        h.magic != RECORD_MAGIC || h.seq != seq || h.crc != struct_crc(h)) {
+      break;
+    }
+
+    LogEntry entry;
+    entry.seq = seq;
+    entry.log_offset = pos;
+    if (h.type == RECORD_PAD) {
+      entry.log_length = m_log_size - pos;
+    } else if (h.type == RECORD_WRITE && h.length > 0 &&
+               h.length <= RECORD_MAX_DATA) {
+      entry.log_length = record_length(h.length);
+      if (pos + entry.log_length > m_log_size) {
+        break;
+      }
+      ceph::bufferptr data(h.length);
+      if (safe_pread_exact(m_fd, data.c_str(), h.length,
+                           pos + HEADER_SIZE) < 0 ||
+          ceph_crc32c(0, reinterpret_cast<unsigned char*>(data.c_str()),
+                      h.length) != h.data_crc) {
+        // torn append that was never acknowledged
+        break;
+      }
+      entry.image_offset = h.image_offset;
+      entry.length = h.length;
+    } else {
+      break;
+    }
+    if (scanned + entry.log_length > capacity) {
+      break;
+    }
+
+    if (entry.length > 0) {
+      map_insert(entry.image_offset, entry.length, pos + HEADER_SIZE);
+    }
+    m_entries.push_back(entry);
+    scanned += entry.log_length;
+    pos += entry.log_length;
+    ++seq;
+  }
+
+  m_used = scanned;
+  m_tail = m_committed_tail = (pos == m_log_size ? data_start() : pos);
+
+  // Records of an append group that were not all made durable may remain
+  // past the new tail.  Skip far enough ahead that none of their sequence
+  // numbers can ever be expected by a later replay.
+  m_next_seq = m_committed_seq = seq + capacity / RECORD_ALIGN + 1;
+
+  ldout(cct, 5) << "replayed " << m_entries.size() << " log entries, "
+                << scanned << " bytes" << dendl;
+  return 0;
+}
+
+template <typename I>
+void SSDWriteLog<I>::map_insert(uint64_t image_offset, uint64_t length,
+                                uint64_t data_offset) {
+  uint64_t end = image_offset + length;
+  auto it = m_extent_map.lower_bound(image_offset);
+  if (it != m_extent_map.begin()) {
+    auto prev = std::prev(it);
+    uint64_t prev_end = prev->first + prev->second.length;
+    if (prev_end > image_offset) {
+      uint64_t prev_data = prev->second.data_offset;
+      prev->second.length = image_offset - prev->first;
+      if (prev_end > end) {
+        m_extent_map[end] = {prev_end - end, prev_data + (end - prev->first)};
+      }
+    }
+  }
+  while (it != m_extent_map.end() && it->first < end) {
+    uint64_t it_end = it->first + it->second.length;
+    if (it_end > end) {
+      LogExtent rest{it_end - end, it->second.data_offset + (end - it->first)};
+      m_extent_map.erase(it);
+      m_extent_map[end] = rest;
+      break;
+    }
+    it = m_extent_map.erase(it);
+  }
+  m_extent_map[image_offset] = {length, data_offset};
+}
+
+template <typename I>
+void SSDWriteLog<I>::map_remove(const LogEntry &entry) {
+  // only extents that still point into this record's data are removed;
+  // those can only lie within the record's image range
+  uint64_t data_begin = entry.log_offset + HEADER_SIZE;
+  uint64_t data_end = data_begin + entry.length;
+  uint64_t end = entry.image_offset + entry.length;
+  auto it = m_extent_map.lower_bound(entry.image_offset);
+  if (it != m_extent_map.begin()) {
+    --it;
+  }
+  while (it != m_extent_map.end() && it->first < end) {
+    if (it->second.data_offset >= data_begin &&
+        it->second.data_offset < data_end) {
+      it = m_extent_map.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+template <typename I>
+void SSDWriteLog<I>::queue_op(Op &&op) {
+  std::lock_guard locker{m_lock};
+  if (m_stopping) {
+    m_image_ctx.op_work_queue->queue(op.on_finish, -ESHUTDOWN);
+    return;
+  }
+  m_ops.push_back(std::move(op));
+  m_append_cond.notify_all();
+}
+
+template <typename I>
+void SSDWriteLog<I>::queue_barrier(std::function<void(Context*)> &&fn,
+                                   Context *on_finish) {
+  Op op{Op::BARRIER};
+  op.barrier_fn = std::move(fn);
+  op.on_finish = on_finish;
+  queue_op(std::move(op));
+}
+
+template <typename I>
+void SSDWriteLog<I>::aio_read(Extents &&image_extents, bufferlist *bl,
+                              int fadvise_flags, Context *on_finish) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 20) << "image_extents=" << image_extents << ", "
+                 << "on_finish=" << on_finish << dendl;
+
+  struct Segment {
+    uint64_t length;
+    bool hit;
+    ceph::bufferptr data;
+  };
+  std::vector<Segment> segments;
+  Extents miss_extents;
+  std::vector<std::pair<uint64_t, uint64_t>> hits;   // data offset, length
+
+  // hold off retirement (and reuse) of the log space we read from
+  std::shared_lock space_locker{m_space_lock};
+  {
+    std::lock_guard locker{m_lock};
+    for (auto [offset, length] : image_extents) {
+      uint64_t end = offset + length;
+      auto it = m_extent_map.upper_bound(offset);
+      if (it != m_extent_map.begin()) {
+        --it;
+      }
+      while (offset < end) {
+        while (it != m_extent_map.end() &&
+               it->first + it->second.length <= offset) {
+          ++it;
+        }
+        if (it == m_extent_map.end() || it->first >= end) {
+          segments.push_back({end - offset, false, {}});
+          miss_extents.emplace_back(offset, end - offset);
+          break;
+        }
+        if (it->first > offset) {
+          segments.push_back({it->first - offset, false, {}});
+          miss_extents.emplace_back(offset, it->first - offset);
+          offset = it->first;
+        }
+        uint64_t hit_len = std::min(end, it->first + it->second.length) -
+          offset;
+        segments.push_back({hit_len, true, {}});
+        hits.emplace_back(it->second.data_offset + (offset - it->first),
+                          hit_len);
+        offset += hit_len;
+      }
+    }
+  }
+
+  if (hits.empty()) {
+    space_locker.unlock();
+    m_image_writeback.aio_read(std::move(image_extents), bl, fadvise_flags,
+                               on_finish);
+    return;
+  }
+
+  auto hit = hits.begin();
+  for (auto& segment : segments) {
+    if (!segment.hit) {
+      continue;
+    }
+    segment.data = ceph::bufferptr(hit->second);
+    int r = safe_pread_exact(m_fd, segment.data.c_str(), hit->second,
+                             hit->first);
+    if (r < 0) {
+      lderr(cct) << "failed to read log: " << cpp_strerror(r) << dendl;
+      space_locker.unlock();
+      on_finish->complete(r);
+      return;
+    }
+    ++hit;
+  }
+  space_locker.unlock();
+
+  auto miss_bl = new ceph::bufferlist();
+  auto ctx = new LambdaContext(
+    [segments=std::move(segments), miss_bl, bl, on_finish](int r) mutable {
+      if (r >= 0) {
+        bl->clear();
+        for (auto& segment : segments) {
+          if (segment.hit) {
+            bl->append(std::move(segment.data));
+          } else {
+            ceph::bufferlist part;
+            miss_bl->splice(0, segment.length, &part);
+            bl->claim_append(part);
+          }
+        }
+        r = 0;
+      }
+      delete miss_bl;
+      on_finish->complete(r);
+    });
+  if (miss_extents.empty()) {
+    ctx->complete(0);
+    return;
+  }
+  m_image_writeback.aio_read(std::move(miss_extents), miss_bl, fadvise_flags,
+                             ctx);
+}
+
+template <typename I>
+void SSDWriteLog<I>::aio_write(Extents &&image_extents,
+                               bufferlist&& bl,
+                               int fadvise_flags,
+                               Context *on_finish) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 20) << "image_extents=" << image_extents << ", "
+                 << "on_finish=" << on_finish << dendl;
+
+  if (bl.length() > (m_log_size - data_start()) / 2) {
+    // too large to stage in the log; write it through in order instead
+    queue_barrier(
+      [this, image_extents=std::move(image_extents), bl=std::move(bl),
+       fadvise_flags](Context *ctx) mutable {
+        m_image_writeback.aio_write(std::move(image_extents), std::move(bl),
+                                    fadvise_flags, ctx);
+      }, on_finish);
+    return;
+  }
+
+  Op op{Op::WRITE};
+  op.image_extents = std::move(image_extents);
+  op.bl = std::move(bl);
+  op.on_finish = on_finish;
+  queue_op(std::move(op));
+}
+
+template <typename I>
+void SSDWriteLog<I>::aio_discard(uint64_t offset, uint64_t length,
+                                 uint32_t discard_granularity_bytes,
+                                 Context *on_finish) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 20) << "offset=" << offset << ", "
+                 << "length=" << length << ", "
+                 << "on_finish=" << on_finish << dendl;
+
+  queue_barrier(
+    [this, offset, length, discard_granularity_bytes](Context *ctx) {
+      m_image_writeback.aio_discard(offset, length, discard_granularity_bytes,
+                                    ctx);
+    }, on_finish);
+}
+
+template <typename I>
+void SSDWriteLog<I>::aio_flush(Context *on_finish) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 20) << "on_finish=" << on_finish << dendl;
+
+  // acknowledged writes are already durable in the log
+  Op op{Op::FLUSH};
+  op.on_finish = on_finish;
+  queue_op(std::move(op));
+}
+
+template <typename I>
+void SSDWriteLog<I>::aio_writesame(uint64_t offset, uint64_t length,
+                                   bufferlist&& bl, int fadvise_flags,
+                                   Context *on_finish) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 20) << "offset=" << offset << ", "
+                 << "length=" << length << ", "
+                 << "data_len=" << bl.length() << ", "
+                 << "on_finish=" << on_finish << dendl;
+
+  queue_barrier(
+    [this, offset, length, bl=std::move(bl), fadvise_flags](
+        Context *ctx) mutable {
+      m_image_writeback.aio_writesame(offset, length, std::move(bl),
+                                      fadvise_flags, ctx);
+    }, on_finish);
+}
+
+template <typename I>
+void SSDWriteLog<I>::aio_compare_and_write(Extents &&image_extents,
+                                           bufferlist&& cmp_bl,
+                                           bufferlist&& bl,
+                                           uint64_t *mismatch_offset,
+                                           int fadvise_flags,
+                                           Context *on_finish) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 20) << "image_extents=" << image_extents << ", "
+                 << "on_finish=" << on_finish << dendl;
+
+  queue_barrier(
+    [this, image_extents=std::move(image_extents), cmp_bl=std::move(cmp_bl),
+     bl=std::move(bl), mismatch_offset, fadvise_flags](Context *ctx) mutable {
+      m_image_writeback.aio_compare_and_write(
+        std::move(image_extents), std::move(cmp_bl), std::move(bl),
+        mismatch_offset, fadvise_flags, ctx);
+    }, on_finish);
+}
+
+template <typename I>
+void SSDWriteLog<I>::init(Context *on_finish) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 5) << "path=" << m_path << ", size=" << m_log_size << ", "
+                << "state=" << m_state << dendl;
+
+  if (m_image_ctx.config.template get_val<std::string>(
+        "rbd_persistent_cache_path").empty()) {
+    // a default like /tmp may not survive the reboot the log has to
+    lderr(cct) << "rbd_persistent_cache_path must be set" << dendl;
+    on_finish->complete(-EINVAL);
+    return;
+  }
+  if (!m_state.empty() && m_state.path != m_path) {
+    lderr(cct) << "image cache state " << m_state << " does not name "
+               << m_path << dendl;
+    on_finish->complete(-EINVAL);
+    return;
+  }
+
+  bool created;
+  int r = open_log(&created);
+  if (r == 0 && !created) {
+    r = replay();
+  }
+  if (r < 0) {
+    on_finish->complete(r);
+    return;
+  }
+
+  m_append_thread = make_named_thread("rbd_wl_append",
+                                      &SSDWriteLog<I>::append_entry, this);
+  m_writeback_thread = make_named_thread("rbd_wl_wb",
+                                         &SSDWriteLog<I>::writeback_entry,
+                                         this);
+
+  if (created) {
+    // nothing is logged before the image names the log
+    set_state(on_finish);
+    return;
+  }
+  if (m_entries.empty()) {
+    // persist the skipped-ahead sequence before anything is appended
+    on_finish->complete(write_superblock(m_committed_tail, m_committed_seq));
+    return;
+  }
+
+  // nothing may read the image until the replayed data is written back
+  ldout(cct, 1) << "writing back " << m_entries.size()
+                << " log entries recovered from " << m_path << dendl;
+  queue_barrier({}, on_finish);
+}
+
+template <typename I>
+void SSDWriteLog<I>::shut_down(Context *on_finish) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 5) << dendl;
+
+  queue_barrier({}, new LambdaContext([this, on_finish](int r) {
+      if (r < 0) {
+        // the log keeps the data; leave the cache up so nothing is lost
+        lderr(m_image_ctx.cct) << "failed to write back log: "
+                               << cpp_strerror(r) << dendl;
+        on_finish->complete(r);
+        return;
+      }
+
+      // the log is written back; once the image stops naming it, it is
+      // never replayed again
+      remove_state(new LambdaContext([this, on_finish](int r) {
+          if (r < 0 && r != -ENOENT) {
+            lderr(m_image_ctx.cct) << "failed to remove cache state: "
+                                   << cpp_strerror(r) << dendl;
+            on_finish->complete(r);
+            return;
+          }
+
+          // cannot join the append thread from its own barrier
+          m_image_ctx.op_work_queue->queue(new LambdaContext(
+            [this, on_finish](int r) {
+              stop_threads();
+              VOID_TEMP_FAILURE_RETRY(::close(m_fd));
+              m_fd = -1;
+              if (::unlink(m_path.c_str()) < 0) {
+                ldout(m_image_ctx.cct, 5) << "failed to remove " << m_path
+                                          << dendl;
+              }
+              on_finish->complete(0);
+            }), 0);
+        }));
+    }));
+}
+
+template <typename I>
+void SSDWriteLog<I>::set_state(Context *on_finish) {
+  SSDWriteLogState state{ceph_get_hostname(), m_path};
+  ldout(m_image_ctx.cct, 10) << state << dendl;
+
+  std::map<std::string, ceph::bufferlist> data;
+  data[SSDWriteLogState::KEY].append(state.encode());
+  librados::ObjectWriteOperation op;
+  cls_client::metadata_set(&op, data);
+
+  auto comp = util::create_rados_callback(on_finish);
+  int r = m_image_ctx.md_ctx.aio_operate(m_image_ctx.header_oid, comp, &op);
+  ceph_assert(r == 0);
+  comp->release();
+}
+
+template <typename I>
+void SSDWriteLog<I>::remove_state(Context *on_finish) {
+  ldout(m_image_ctx.cct, 10) << dendl;
+
+  librados::ObjectWriteOperation op;
+  cls_client::metadata_remove(&op, SSDWriteLogState::KEY);
+
+  auto comp = util::create_rados_callback(on_finish);
+  int r = m_image_ctx.md_ctx.aio_operate(m_image_ctx.header_oid, comp, &op);
+  ceph_assert(r == 0);
+  comp->release();
+}
+
+template <typename I>
+void SSDWriteLog<I>::invalidate(Context *on_finish) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 20) << dendl;
+
+  // only dirty data is kept, and it must not be dropped
+  flush(on_finish);
+}
+
+template <typename I>
+void SSDWriteLog<I>::flush(Context *on_finish) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 20) << dendl;
+
+  // internal flush -- write back the whole log
+  queue_barrier({}, on_finish);
+}
+
+template <typename I>
+void SSDWriteLog<I>::append_entry() {
+  std::unique_lock locker{m_lock};
+  while (true) {
+    m_append_cond.wait(locker, [this] {
+        return m_stopping || !m_ops.empty();
+      });
+    if (m_stopping) {
+      break;
+    }
+
+    if (m_ops.front().type == Op::BARRIER) {
+      Op op = std::move(m_ops.front());
+      m_ops.pop_front();
+      run_barrier(locker, op);
+      continue;
+    }
+
+    // group everything up to the next barrier into one log commit
+    std::deque<Op> ops;
+    uint64_t bytes = 0;
+    while (!m_ops.empty() && m_ops.front().type != Op::BARRIER &&
+           bytes < m_writeback_bytes) {
+      bytes += m_ops.front().bl.length();
+      ops.push_back(std::move(m_ops.front()));
+      m_ops.pop_front();
+    }
+    append_writes(locker, std::move(ops));
+  }
+
+  for (auto& op : m_ops) {
+    m_image_ctx.op_work_queue->queue(op.on_finish, -ESHUTDOWN);
+  }
+  m_ops.clear();
+}
+
+template <typename I>
+void SSDWriteLog<I>::append_writes(std::unique_lock<ceph::mutex> &locker,
+                                   std::deque<Op> &&ops) {
+  CephContext *cct = m_image_ctx.cct;
+
+  const uint64_t first_tail = m_tail;
+  const uint64_t first_seq = m_next_seq;
+  uint64_t reserved = 0;
+  std::vector<LogEntry> entries;
+  std::vector<std::pair<uint64_t, ceph::bufferlist>> runs;
+
+  auto append_record = [&](uint64_t offset, ceph::bufferlist &&record) {
+    if (runs.empty() ||
+        runs.back().first + runs.back().second.length() != offset) {
+      runs.emplace_back(offset, ceph::bufferlist());
+    }
+    runs.back().second.claim_append(record);
+  };
+
+  int r = 0;
+  for (auto& op : ops) {
+    if (op.type != Op::WRITE || r < 0) {
+      continue;
+    }
+    uint64_t bl_offset = 0;
+    for (auto [image_offset, length] : op.image_extents) {
+      for (uint64_t done = 0; done < length && r == 0; ) {
+        uint64_t data_len = std::min(length - done, RECORD_MAX_DATA);
+        uint64_t log_len = record_length(data_len);
+
+        uint64_t offset, pad;
+        while (!reserve(log_len, &offset, &pad)) {
+          if (m_writeback_result < 0) {
+            r = m_writeback_result;
+            break;
+          } else if (m_stopping) {
+            r = -ESHUTDOWN;
+            break;
+          }
+          ldout(cct, 10) << "log full, waiting for writeback" << dendl;
+          m_writeback_cond.notify_all();
+          m_append_cond.wait(locker);
+        }
+        if (r < 0) {
+          break;
+        }
+
+        if (pad > 0) {
+          record_header_t h = {};
+          h.magic = RECORD_MAGIC;
+          h.type = RECORD_PAD;
+          h.seq = m_next_seq;
+          h.crc = struct_crc(h);
+          ceph::bufferlist record;
+          record.append(reinterpret_cast<const char*>(&h), sizeof(h));
+          append_record(m_tail, std::move(record));
+          entries.push_back({m_next_seq, m_tail, pad, 0, 0});
+          ++m_next_seq;
+          m_used += pad;
+          reserved += pad;
+        }
+
+        ceph::bufferlist data;
+        data.substr_of(op.bl, bl_offset + done, data_len);
+        record_header_t h = {};
+        h.magic = RECORD_MAGIC;
+        h.type = RECORD_WRITE;
+        h.seq = m_next_seq;
+        h.image_offset = image_offset + done;
+        h.length = data_len;
+        h.data_crc = data.crc32c(0);
+        h.crc = struct_crc(h);
+        ceph::bufferlist record;
+        record.append(reinterpret_cast<const char*>(&h), sizeof(h));
+        record.claim_append(data);
+        record.append_zero(log_len - HEADER_SIZE - data_len);
+        append_record(offset, std::move(record));
+
+        entries.push_back({m_next_seq, offset, log_len, image_offset + done,
+                           data_len});
+        ++m_next_seq;
+        m_used += log_len;
+        reserved += log_len;
+        m_tail = offset + log_len;
+        if (m_tail == m_log_size) {
+          m_tail = data_start();
+        }
+        done += data_len;
+      }
+      bl_offset += length;
+    }
+  }
+
+  if (r == 0 && !runs.empty()) {
+    locker.unlock();
+    for (auto& [offset, bl] : runs) {
+      r = bl.write_fd(m_fd, offset);
+      if (r < 0) {
+        break;
+      }
+    }
+    // acknowledge only once the whole group is on stable storage
+    if (r == 0 && ::fdatasync(m_fd) < 0) {
+      r = -errno;
+    }
+    locker.lock();
+    if (r < 0) {
+      lderr(cct) << "failed to append to log: " << cpp_strerror(r) << dendl;
+    }
+  }
+
+  if (r < 0) {
+    // nothing after this group has been reserved yet
+    m_tail = first_tail;
+    m_next_seq = first_seq;
+    m_used -= reserved;
+  } else if (!entries.empty()) {
+    for (auto& entry : entries) {
+      if (entry.length > 0) {
+        map_insert(entry.image_offset, entry.length,
+                   entry.log_offset + HEADER_SIZE);
+      }
+      m_entries.push_back(entry);
+    }
+    m_committed_tail = m_tail;
+    m_committed_seq = m_next_seq;
+    m_writeback_cond.notify_all();
+  }
+
+  locker.unlock();
+  for (auto& op : ops) {
+    op.on_finish->complete(r);
+  }
+  locker.lock();
+}
+
+template <typename I>
+void SSDWriteLog<I>::run_barrier(std::unique_lock<ceph::mutex> &locker,
+                                 Op &op) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 20) << "waiting for " << m_entries.size() << " log entries"
+                 << dendl;
+
+  m_writeback_cond.notify_all();
+  m_append_cond.wait(locker, [this] {
+      return m_entries.empty() || m_writeback_result < 0 || m_stopping;
+    });
+  int r = m_writeback_result;
+  if (r == 0 && m_stopping) {
+    r = -ESHUTDOWN;
+  }
+  locker.unlock();
+
+  if (r == 0 && op.barrier_fn) {
+    // later ops must not overtake the pass-through request
+    C_SaferCond ctx;
+    op.barrier_fn(&ctx);
+    r = ctx.wait();
+  }
+  op.on_finish->complete(r);
+
+  locker.lock();
+}
+
+template <typename I>
+void SSDWriteLog<I>::writeback_entry() {
+  std::unique_lock locker{m_lock};
+  while (true) {
+    m_writeback_cond.wait(locker, [this] {
+        return m_stopping || m_retire_count > 0 ||
+          (m_writeback_result == 0 && !m_writeback_in_flight &&
+           m_writeback_pos < m_entries.size());
+      });
+    if (m_stopping) {
+      break;
+    }
+    if (m_retire_count > 0) {
+      retire_batch(locker);
+    } else {
+      writeback_batch(locker);
+    }
+  }
+}
+
+template <typename I>
+void SSDWriteLog<I>::writeback_batch(std::unique_lock<ceph::mutex> &locker) {
+  CephContext *cct = m_image_ctx.cct;
+
+  std::vector<LogEntry> batch;
+  uint64_t bytes = 0;
+  for (size_t i = m_writeback_pos;
+       i < m_entries.size() && bytes < m_writeback_bytes; ++i) {
+    batch.push_back(m_entries[i]);
+    bytes += m_entries[i].length;
+  }
+  m_writeback_pos += batch.size();
+  m_writeback_in_flight = true;
+  locker.unlock();
+
+  // coalesce: later records overwrite earlier ones, adjacent ones merge
+  std::map<uint64_t, ceph::bufferlist> extents;
+  int r = 0;
+  for (auto& entry : batch) {
+    if (entry.length == 0) {
+      continue;
+    }
+    ceph::bufferptr bp(entry.length);
+    r = safe_pread_exact(m_fd, bp.c_str(), entry.length,
+                         entry.log_offset + HEADER_SIZE);
+    if (r < 0) {
+      lderr(cct) << "failed to read log: " << cpp_strerror(r) << dendl;
+      break;
+    }
+
+    uint64_t begin = entry.image_offset;
+    uint64_t end = begin + entry.length;
+    auto it = extents.lower_bound(begin);
+    if (it != extents.begin()) {
+      auto prev = std::prev(it);
+      uint64_t prev_end = prev->first + prev->second.length();
+      if (prev_end > begin) {
+        if (prev_end > end) {
+          ceph::bufferlist rest;
+          rest.substr_of(prev->second, end - prev->first, prev_end - end);
+          extents[end] = std::move(rest);
+        }
+        ceph::bufferlist head;
+        head.substr_of(prev->second, 0, begin - prev->first);
+        prev->second = std::move(head);
+      }
+    }
+    while (it != extents.end() && it->first < end) {
+      uint64_t it_end = it->first + it->second.length();
+      if (it_end > end) {
+        ceph::bufferlist rest;
+        rest.substr_of(it->second, end - it->first, it_end - end);
+        extents.erase(it);
+        extents[end] = std::move(rest);
+        break;
+      }
+      it = extents.erase(it);
+    }
+    extents[begin].clear();
+    extents[begin].append(std::move(bp));
+  }
+
+  Extents image_extents;
+  ceph::bufferlist bl;
+  for (auto& [offset, data] : extents) {
+    if (!image_extents.empty() &&
+        image_extents.back().first + image_extents.back().second == offset) {
+      image_extents.back().second += data.length();
+    } else {
+      image_extents.emplace_back(offset, data.length());
+    }
+    bl.claim_append(data);
+  }
+
+  ldout(cct, 20) << "writing back " << batch.size() << " log entries as "
+                 << image_extents.size() << " extents, " << bl.length()
+                 << " bytes" << dendl;
+
+  auto count = batch.size();
+  auto finish = new LambdaContext([this, count](int r) {
+      std::lock_guard locker{m_lock};
+      m_retire_count = count;
+      m_retire_result = r;
+      m_writeback_cond.notify_all();
+      m_append_cond.notify_all();
+    });
+  if (r < 0 || image_extents.empty()) {
+    finish->complete(r);
+    locker.lock();
+    return;
+  }
+
+  // the log head may only move past data the cluster has made durable
+  auto ctx = new LambdaContext([this, finish](int r) {
+      if (r < 0) {
+        finish->complete(r);
+        return;
+      }
+      m_image_writeback.aio_flush(finish);
+    });
+  m_image_writeback.aio_write(std::move(image_extents), std::move(bl), 0, ctx);
+  locker.lock();
+}
+
+template <typename I>
+void SSDWriteLog<I>::retire_batch(std::unique_lock<ceph::mutex> &locker) {
+  CephContext *cct = m_image_ctx.cct;
+
+  size_t count = m_retire_count;
+  int r = m_retire_result;
+  m_retire_count = 0;
+
+  uint64_t head = m_committed_tail;
+  uint64_t head_seq = m_committed_seq;
+  if (r == 0 && count < m_entries.size()) {
+    head = m_entries[count].log_offset;
+    head_seq = m_entries[count].seq;
+  }
+  locker.unlock();
+
+  if (r == 0) {
+    r = write_superblock(head, head_seq);
+  } else {
+    lderr(cct) << "failed to write back log entries: " << cpp_strerror(r)
+               << dendl;
+  }
+
+  {
+    std::unique_lock space_locker{m_space_lock};
+    locker.lock();
+    if (r < 0) {
+      // keep the entries; they are written back when the log is replayed
+      m_writeback_result = r;
+      m_writeback_pos -= count;
+    } else {
+      for (size_t i = 0; i < count; ++i) {
+        auto& entry = m_entries.front();
+        if (entry.length > 0) {
+          map_remove(entry);
+        }
+        m_used -= entry.log_length;
+        m_entries.pop_front();
+      }
+      m_writeback_pos -= count;
+      m_head = head;
+    }
+    m_writeback_in_flight = false;
+  }
+  m_append_cond.notify_all();
+}
+
+template <typename I>
+void SSDWriteLog<I>::stop_threads() {
+  {
+    std::unique_lock locker{m_lock};
+    m_stopping = true;
+    m_append_cond.notify_all();
+    m_writeback_cond.notify_all();
+
+    // a writeback request still references us until it completes
+    m_append_cond.wait(locker, [this] {
+        return !m_writeback_in_flight || m_retire_count > 0;
+      });
+  }
+  if (m_append_thread.joinable()) {
+    m_append_thread.join();
+  }
+  if (m_writeback_thread.joinable()) {
+    m_writeback_thread.join();
+  }
+}
+
+} // namespace cache
+} // namespace librbd
+
+template class librbd::cache::SSDWriteLog<librbd::ImageCtx>;
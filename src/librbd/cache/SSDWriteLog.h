@@ -0,0 +1,213 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#ifndef CEPH_LIBRBD_CACHE_SSD_WRITE_LOG
+#define CEPH_LIBRBD_CACHE_SSD_WRITE_LOG
+
+#include "ImageCache.h"
+#include "ImageWriteback.h"
+#include "common/ceph_mutex.h"
+#include "include/buffer.h"
+#include <deque>
+#include <functional>
+#include <map>
+#include <string>
+#include <thread>
+
+namespace librbd {
+
+struct ImageCtx;
+
+namespace cache {
+
+/**
+ * Image metadata naming the host and log file of a persistent cache.
+ *
+ * It is set once the log is created, before anything is logged, and is
+ * removed only after a clean shut down has written the whole log back.
+ * While it is set, the image may be missing acknowledged writes, so the
+ * exclusive lock is refused to every client except one on the same
+ * host with the cache enabled, which replays the log.  Removing the key
+ * (rbd image-meta remove) discards the log.
+ */
+struct SSDWriteLogState {
+  static const std::string KEY;
+
+  std::string host;
+  std::string path;
+
+  bool empty() const {
+    return host.empty();
+  }
+  std::string encode() const;
+  bool decode(const std::string &value);
+};
+
+std::ostream &operator<<(std::ostream &os, const SSDWriteLogState &state);
+
+/**
+ * Persistent write-back image cache backed by a log file on local SSD.
+ *
+ * Writes are appended to the log in submission order and acknowledged
+ * once the log append is durable, so a guest fsync costs one local
+ * fdatasync instead of a round trip to the cluster.  Appends that are
+ * queued together are committed with a single fdatasync.  A background
+ * thread writes the oldest log entries back to the image in coalesced
+ * batches; the log head only advances once a batch has been flushed to
+ * the cluster.
+ *
+ * Reads are served from the log where it holds newer data than the
+ * image.  Discard, write-same and compare-and-write are ordering
+ * barriers: everything logged before them is written back first, then
+ * they are passed through to the image.
+ *
+ * The log survives a crash.  On init, valid entries past the persisted
+ * head are replayed and written back before any new IO is accepted.  On
+ * a clean shut down the log is written back and removed.  A log is only
+ * replayed if the image's SSDWriteLogState still names it; otherwise it
+ * is stale and is discarded.
+ *
+ * The cache is only active while the image's exclusive lock is held.
+ */
+template <typename ImageCtxT = librbd::ImageCtx>
+class SSDWriteLog : public ImageCache {
+public:
+  /// state is the image's SSDWriteLogState, empty if it has none
+  static SSDWriteLog* create(ImageCtxT &image_ctx,
+                             const SSDWriteLogState &state) {
+    return new SSDWriteLog(image_ctx, state);
+  }
+
+  SSDWriteLog(ImageCtxT &image_ctx, const SSDWriteLogState &state);
+  ~SSDWriteLog() override;
+
+  /// client AIO methods
+  void aio_read(Extents&& image_extents, ceph::bufferlist *bl,
+                int fadvise_flags, Context *on_finish) override;
+  void aio_write(Extents&& image_extents, ceph::bufferlist&& bl,
+                 int fadvise_flags, Context *on_finish) override;
+  void aio_discard(uint64_t offset, uint64_t length,
+                   uint32_t discard_granularity_bytes,
+                   Context *on_finish) override;
+  void aio_flush(Context *on_finish) override;
+  void aio_writesame(uint64_t offset, uint64_t length,
+                     ceph::bufferlist&& bl,
+                     int fadvise_flags, Context *on_finish) override;
+  void aio_compare_and_write(Extents&& image_extents,
+                             ceph::bufferlist&& cmp_bl, ceph::bufferlist&& bl,
+                             uint64_t *mismatch_offset,int fadvise_flags,
+                             Context *on_finish) override;
+
+  /// internal state methods
+  void init(Context *on_finish) override;
+  void shut_down(Context *on_finish) override;
+
+  void invalidate(Context *on_finish) override;
+  void flush(Context *on_finish) override;
+
+private:
+  /**
+   * A record in the log: either a write of [image_offset, +length) or
+   * padding up to the end of the log file before it wraps.
+   */
+  struct LogEntry {
+    uint64_t seq = 0;
+    uint64_t log_offset = 0;     ///< file offset of the record header
+    uint64_t log_length = 0;     ///< record size including padding
+    uint64_t image_offset = 0;
+    uint64_t length = 0;         ///< 0 for padding records
+  };
+
+  /// where the newest logged data for an image extent lives in the file
+  struct LogExtent {
+    uint64_t length;
+    uint64_t data_offset;
+  };
+
+  struct Op {
+    enum Type {
+      WRITE,
+      FLUSH,
+      BARRIER,
+    } type;
+    Extents image_extents;
+    ceph::bufferlist bl;
+    /// BARRIER: issued once the log is written back, completes on_finish
+    std::function<void(Context*)> barrier_fn;
+    Context *on_finish;
+  };
+
+  ImageCtxT &m_image_ctx;
+  ImageWriteback<ImageCtxT> m_image_writeback;
+
+  SSDWriteLogState m_state;       ///< found in the image when opened
+  std::string m_path;
+  int m_fd = -1;
+  uint64_t m_log_size;
+  uint64_t m_writeback_bytes;
+
+  /// readers hold this shared; freeing log space takes it exclusive
+  ceph::shared_mutex m_space_lock =
+    ceph::make_shared_mutex("librbd::cache::SSDWriteLog::m_space_lock");
+
+  ceph::mutex m_lock = ceph::make_mutex("librbd::cache::SSDWriteLog::m_lock");
+  ceph::condition_variable m_append_cond;
+  ceph::condition_variable m_writeback_cond;
+
+  std::deque<Op> m_ops;
+  bool m_stopping = false;
+
+  // log space, protected by m_lock
+  uint64_t m_head;                ///< oldest record not written back
+  uint64_t m_tail;                ///< where the next record goes
+  uint64_t m_used = 0;
+  uint64_t m_next_seq;
+  uint64_t m_committed_tail;      ///< end of the durable records
+  uint64_t m_committed_seq;
+
+  std::deque<LogEntry> m_entries;  ///< logged, not yet retired
+  size_t m_writeback_pos = 0;      ///< first entry not yet written back
+  bool m_writeback_in_flight = false;
+  size_t m_retire_count = 0;       ///< entries written back, not yet retired
+  int m_retire_result = 0;
+  int m_writeback_result = 0;
+  std::map<uint64_t, LogExtent> m_extent_map;
+
+  std::thread m_append_thread;
+  std::thread m_writeback_thread;
+
+  uint64_t data_start() const;
+  uint64_t free_space() const;
+  bool reserve(uint64_t length, uint64_t *offset, uint64_t *pad);
+
+  int open_log(bool *created);
+  void set_state(Context *on_finish);
+  void remove_state(Context *on_finish);
+  int write_superblock(uint64_t head, uint64_t head_seq);
+  int replay();
+
+  void map_insert(uint64_t image_offset, uint64_t length,
+                  uint64_t data_offset);
+  void map_remove(const LogEntry &entry);
+
+  void queue_op(Op &&op);
+  void queue_barrier(std::function<void(Context*)> &&fn, Context *on_finish);
+
+  void append_entry();
+  void append_writes(std::unique_lock<ceph::mutex> &locker,
+                     std::deque<Op> &&ops);
+  void run_barrier(std::unique_lock<ceph::mutex> &locker, Op &op);
+
+  void writeback_entry();
+  void writeback_batch(std::unique_lock<ceph::mutex> &locker);
+  void retire_batch(std::unique_lock<ceph::mutex> &locker);
+
+  void stop_threads();
+};
+
+} // namespace cache
+} // namespace librbd
+
+extern template class librbd::cache::SSDWriteLog<librbd::ImageCtx>;
+
+#endif // CEPH_LIBRBD_CACHE_SSD_WRITE_LOG
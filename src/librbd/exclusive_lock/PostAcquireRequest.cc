@@ -4,8 +4,10 @@
 #include "librbd/exclusive_lock/PostAcquireRequest.h"
 #include "cls/lock/cls_lock_client.h"
 #include "cls/lock/cls_lock_types.h"
+#include "cls/rbd/cls_rbd_client.h"
 #include "common/dout.h"
 #include "common/errno.h"
+#include "common/hostname.h"
 #include "common/WorkQueue.h"
 #include "include/stringify.h"
 #include "librbd/ExclusiveLock.h"
@@ -15,6 +17,7 @@
 #include "librbd/Journal.h"
 #include "librbd/ObjectMap.h"
 #include "librbd/Utils.h"
+#include "librbd/cache/SSDWriteLog.h"
 #include "librbd/image/RefreshRequest.h"
 #include "librbd/journal/Policy.h"
 
@@ -100,6 +103,74 @@ void PostAcquireRequest<I>::handle_refresh(int r) {
   send_open_object_map();
 }
 
+template <typename I>
+void PostAcquireRequest<I>::send_get_image_cache_state() {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 10) << dendl;
+
+  librados::ObjectReadOperation op;
+  cls_client::metadata_get_start(&op, cache::SSDWriteLogState::KEY);
+
+  using klass = PostAcquireRequest<I>;
+  auto comp = create_rados_callback<
+    klass, &klass::handle_get_image_cache_state>(this);
+  m_out_bl.clear();
+  int r = m_image_ctx.md_ctx.aio_operate(m_image_ctx.header_oid, comp, &op,
+                                         &m_out_bl);
+  ceph_assert(r == 0);
+  comp->release();
+}
+
+template <typename I>
+void PostAcquireRequest<I>::handle_get_image_cache_state(int r) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 10) << "r=" << r << dendl;
+
+  std::string value;
+  if (r == 0) {
+    auto it = m_out_bl.cbegin();
+    r = cls_client::metadata_get_finish(&it, &value);
+  }
+  if (r == 0 && !m_image_cache_state.decode(value)) {
+    r = -EINVAL;
+  }
+  if (r == -ENOENT) {
+    send_open_journal();
+    return;
+  } else if (r < 0) {
+    lderr(cct) << "failed to retrieve persistent cache state: "
+               << cpp_strerror(r) << dendl;
+    save_result(r);
+    send_close_object_map();
+    return;
+  }
+
+  // a persistent cache holds writes the image doesn't have yet and only
+  // the host it lives on can write them back
+  bool journal_enabled;
+  {
+    std::shared_lock image_locker{m_image_ctx.image_lock};
+    journal_enabled = (m_image_ctx.test_features(RBD_FEATURE_JOURNALING,
+                                                 m_image_ctx.image_lock) &&
+                       !m_image_ctx.get_journal_policy()->journal_disabled());
+  }
+  if (journal_enabled ||
+      !m_image_ctx.config.template get_val<bool>(
+        "rbd_persistent_cache_enabled") ||
+      m_image_cache_state.host != ceph_get_hostname()) {
+    lderr(cct) << "image has a dirty persistent cache "
+               << m_image_cache_state << ": open it there with "
+               << "rbd_persistent_cache_enabled, or remove image metadata "
+               << cache::SSDWriteLogState::KEY << " to discard the cache"
+               << dendl;
+    save_result(-EROFS);
+    send_close_object_map();
+    return;
+  }
+
+  send_open_journal();
+}
+
 template <typename I>
 void PostAcquireRequest<I>::send_open_journal() {
   // alert caller that we now own the exclusive lock
@@ -114,8 +185,7 @@ void PostAcquireRequest<I>::send_open_journal() {
                        !m_image_ctx.get_journal_policy()->journal_disabled());
   }
   if (!journal_enabled) {
-    apply();
-    finish();
+    send_open_image_cache();
     return;
   }
 
@@ -176,6 +246,48 @@ void PostAcquireRequest<I>::handle_allocate_journal_tag(int r) {
   finish();
 }
 
+template <typename I>
+void PostAcquireRequest<I>::send_open_image_cache() {
+  // logged writes would bypass the journal, so the two are exclusive
+  if (!m_image_ctx.config.template get_val<bool>(
+        "rbd_persistent_cache_enabled")) {
+    apply();
+    finish();
+    return;
+  }
+
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 10) << dendl;
+
+  using klass = PostAcquireRequest<I>;
+  Context *ctx = create_context_callback<
+    klass, &klass::handle_open_image_cache>(this);
+  m_image_cache = cache::SSDWriteLog<I>::create(m_image_ctx,
+                                                m_image_cache_state);
+  m_image_cache->init(ctx);
+}
+
+template <typename I>
+void PostAcquireRequest<I>::handle_open_image_cache(int r) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 10) << "r=" << r << dendl;
+
+  if (r < 0) {
+    // the log may hold data the image doesn't have yet, so don't go on
+    // without it
+    lderr(cct) << "failed to open persistent cache: " << cpp_strerror(r)
+               << dendl;
+    delete m_image_cache;
+    m_image_cache = nullptr;
+    save_result(r);
+    send_close_object_map();
+    return;
+  }
+
+  apply();
+  finish();
+}
+
 template <typename I>
 void PostAcquireRequest<I>::send_close_journal() {
   CephContext *cct = m_image_ctx.cct;
@@ -203,7 +315,7 @@ void PostAcquireRequest<I>::handle_close_journal(int r) {
 template <typename I>
 void PostAcquireRequest<I>::send_open_object_map() {
   if (!m_image_ctx.test_features(RBD_FEATURE_OBJECT_MAP)) {
-    send_open_journal();
+    send_get_image_cache_state();
     return;
   }
 
@@ -236,7 +348,7 @@ void PostAcquireRequest<I>::handle_open_object_map(int r) {
     }
   }
 
-  send_open_journal();
+  send_get_image_cache_state();
 }
 
 template <typename I>
@@ -278,6 +390,9 @@ void PostAcquireRequest<I>::apply() {
 
     ceph_assert(m_image_ctx.journal == nullptr);
     m_image_ctx.journal = m_journal;
+
+    ceph_assert(m_image_ctx.image_cache == nullptr);
+    m_image_ctx.image_cache = m_image_cache;
   }
 
   m_prepare_lock_completed = true;
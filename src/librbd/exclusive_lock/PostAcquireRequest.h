@@ -7,6 +7,7 @@
 #include "include/int_types.h"
 #include "include/buffer.h"
 #include "librbd/ImageCtx.h"
+#include "librbd/cache/SSDWriteLog.h"
 #include "msg/msg_types.h"
 #include <string>
 
@@ -40,22 +41,25 @@ private:
    * OPEN_OBJECT_MAP (skip if
    *      |           disabled)
    *      v
-   * OPEN_JOURNAL (skip if
-   *      |   *     disabled)
-   *      |   *
-   *      |   * * * * * * * *
-   *      v                 *
-   *  ALLOCATE_JOURNAL_TAG  *
-   *      |            *    *
-   *      |            *    *
-   *      |            v    v
-   *      |         CLOSE_JOURNAL
-   *      |               |
-   *      |               v
-   *      |         CLOSE_OBJECT_MAP
-   *      |               |
-   *      v               |
-   *  <finish> <----------/
+   * GET_IMAGE_CACHE_STATE  * * * * * * * * * * * * * * *
+   *      |                                             *
+   *      v                                             *
+   * OPEN_JOURNAL (skip if  . . . . . . . . .
+   *      |   *     disabled)                 .
+   *      |   *                               v
+   *      |   * * * * * * * *          OPEN_IMAGE_CACHE
+   *      v                 *          (skip if disabled)
+   *  ALLOCATE_JOURNAL_TAG  *             |      *
+   *      |            *    *             |      *
+   *      |            *    *             |      *
+   *      |            v    v             |      *
+   *      |         CLOSE_JOURNAL         |      *
+   *      |               |               |      *
+   *      |               v               |      *
+   *      |         CLOSE_OBJECT_MAP < * *|* * * * * * * *
+   *      |               |               |
+   *      v               |               |
+   *  <finish> <----------/ <-------------/
    *
    * @endverbatim
    */
@@ -69,6 +73,10 @@ private:
 
   decltype(m_image_ctx.object_map) m_object_map;
   decltype(m_image_ctx.journal) m_journal;
+  decltype(m_image_ctx.image_cache) m_image_cache = nullptr;
+  cache::SSDWriteLogState m_image_cache_state;
+
+  bufferlist m_out_bl;
 
   bool m_prepare_lock_completed = false;
   int m_error_result;
@@ -76,6 +84,9 @@ private:
   void send_refresh();
   void handle_refresh(int r);
 
+  void send_get_image_cache_state();
+  void handle_get_image_cache_state(int r);
+
   void send_open_journal();
   void handle_open_journal(int r);
 
@@ -85,6 +96,9 @@ private:
   void send_open_object_map();
   void handle_open_object_map(int r);
 
+  void send_open_image_cache();
+  void handle_open_image_cache(int r);
+
   void send_close_journal();
   void handle_close_journal(int r);
 
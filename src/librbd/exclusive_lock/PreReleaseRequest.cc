@@ -11,6 +11,7 @@
 #include "librbd/Journal.h"
 #include "librbd/ObjectMap.h"
 #include "librbd/Utils.h"
+#include "librbd/cache/ImageCache.h"
 #include "librbd/io/ImageRequestWQ.h"
 #include "librbd/io/ObjectDispatcher.h"
 
@@ -157,6 +158,47 @@ void PreReleaseRequest<I>::handle_wait_for_ops(int r) {
   CephContext *cct = m_image_ctx.cct;
   ldout(cct, 10) << dendl;
 
+  send_shut_down_image_cache();
+}
+
+template <typename I>
+void PreReleaseRequest<I>::send_shut_down_image_cache() {
+  if (m_image_ctx.image_cache == nullptr) {
+    send_invalidate_cache();
+    return;
+  }
+
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 10) << dendl;
+
+  // writes back everything logged before the lock can move on
+  Context *ctx = create_context_callback<
+      PreReleaseRequest<I>,
+      &PreReleaseRequest<I>::handle_shut_down_image_cache>(this);
+  m_image_ctx.image_cache->shut_down(ctx);
+}
+
+template <typename I>
+void PreReleaseRequest<I>::handle_shut_down_image_cache(int r) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 10) << "r=" << r << dendl;
+
+  if (r < 0 && r != -EBLACKLISTED) {
+    lderr(cct) << "failed to shut down image cache: " << cpp_strerror(r)
+               << dendl;
+    m_image_ctx.io_work_queue->unblock_writes();
+    save_result(r);
+    finish();
+    return;
+  }
+
+  decltype(m_image_ctx.image_cache) image_cache = nullptr;
+  {
+    std::unique_lock image_locker{m_image_ctx.image_lock};
+    std::swap(image_cache, m_image_ctx.image_cache);
+  }
+  delete image_cache;
+
   send_invalidate_cache();
 }
 
@@ -13,6 +13,7 @@
 #include "librbd/image/CloseRequest.h"
 #include "librbd/image/RefreshRequest.h"
 #include "librbd/image/SetSnapRequest.h"
+#include "librbd/io/ReadaheadObjectDispatch.h"
 #include "librbd/io/SimpleSchedulerObjectDispatch.h"
 #include <boost/algorithm/string/predicate.hpp>
 #include "include/ceph_assert.h"
@@ -688,6 +689,18 @@ Context *OpenRequest<I>::finalize(int r) {
         io::SimpleSchedulerObjectDispatch<I>::create(m_image_ctx);
       io_scheduler->init();
     }
+
+    // the object cacher does its own readahead
+    auto cache_policy = m_image_ctx->config.template get_val<std::string>(
+      "rbd_cache_policy");
+    bool object_cacher = (m_image_ctx->cache && m_image_ctx->child == nullptr &&
+                          cache_policy != "writearound");
+    if (!object_cacher && m_image_ctx->readahead_max_bytes > 0 &&
+        m_image_ctx->config.template get_val<Option::size_t>(
+          "rbd_readahead_buffer_max_bytes") > 0) {
+      auto readahead = io::ReadaheadObjectDispatch<I>::create(m_image_ctx);
+      readahead->init();
+    }
   }
 
   return m_on_finish;
@@ -364,6 +364,34 @@ void RemoveRequest<I>::handle_object_map_remove(int r) {
     r = 0;
   }
 
+  send_dirty_map_remove();
+}
+
+template<typename I>
+void RemoveRequest<I>::send_dirty_map_remove() {
+  ldout(m_cct, 20) << dendl;
+
+  using klass = RemoveRequest<I>;
+  librados::AioCompletion *rados_completion =
+    create_rados_callback<klass, &klass::handle_dirty_map_remove>(this);
+
+  int r = m_ioctx.aio_remove(
+    ObjectMap<>::dirty_map_name(m_image_id, CEPH_NOSNAP), rados_completion);
+  ceph_assert(r == 0);
+  rados_completion->release();
+}
+
+template<typename I>
+void RemoveRequest<I>::handle_dirty_map_remove(int r) {
+  ldout(m_cct, 20) << "r=" << r << dendl;
+
+  if (r < 0 && r != -ENOENT) {
+    lderr(m_cct) << "failed to remove dirty map: " << cpp_strerror(r)
+                 << dendl;
+    finish(r);
+    return;
+  }
+
   mirror_image_remove();
 }
 
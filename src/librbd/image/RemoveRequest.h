@@ -84,6 +84,10 @@ private:
    * |               |                /  |
    * |               |-------<-------/   |
    * |               |                   v
+   * |               |          REMOVE DIRTY MAP
+   * |               |                /  |
+   * |               |-------<-------/   |
+   * |               |                   v
    * |               |    REMOVE MIRROR IMAGE
    * |               |                /  |
    * |               |-------<-------/   |
@@ -144,6 +148,9 @@ private:
   void send_object_map_remove();
   void handle_object_map_remove(int r);
 
+  void send_dirty_map_remove();
+  void handle_dirty_map_remove(int r);
+
   void mirror_image_remove();
   void handle_mirror_image_remove(int r);
 
@@ -89,6 +89,26 @@ bool ObjectDispatch<I>::write(
   return true;
 }
 
+template <typename I>
+bool ObjectDispatch<I>::write_extents(
+    uint64_t object_no, Extents&& extents, ceph::bufferlist&& data,
+    const ::SnapContext &snapc, int op_flags,
+    const ZTracer::Trace &parent_trace, int* object_dispatch_flags,
+    uint64_t* journal_tid, DispatchResult* dispatch_result,
+    Context** on_finish, Context* on_dispatched) {
+  auto cct = m_image_ctx->cct;
+  ldout(cct, 20) << data_object_name(m_image_ctx, object_no) << " "
+                 << extents << dendl;
+
+  *dispatch_result = DISPATCH_RESULT_COMPLETE;
+  auto req = new ObjectWriteRequest<I>(m_image_ctx, object_no,
+                                       std::move(extents), std::move(data),
+                                       snapc, op_flags, parent_trace,
+                                       on_dispatched);
+  req->send();
+  return true;
+}
+
 template <typename I>
 bool ObjectDispatch<I>::write_same(
     uint64_t object_no, uint64_t object_off, uint64_t object_len,
@@ -48,6 +48,15 @@ struct ObjectDispatchInterface {
       uint64_t* journal_tid, DispatchResult* dispatch_result,
       Context**on_finish, Context* on_dispatched) = 0;
 
+  // several disjoint extents of one object, in ascending order, whose
+  // data are concatenated in data, written by a single object operation
+  virtual bool write_extents(
+      uint64_t object_no, Extents&& extents, ceph::bufferlist&& data,
+      const ::SnapContext &snapc, int op_flags,
+      const ZTracer::Trace &parent_trace, int* object_dispatch_flags,
+      uint64_t* journal_tid, DispatchResult* dispatch_result,
+      Context**on_finish, Context* on_dispatched) = 0;
+
   virtual bool write_same(
       uint64_t object_no, uint64_t object_off, uint64_t object_len,
       LightweightBufferExtents&& buffer_extents, ceph::bufferlist&& data,
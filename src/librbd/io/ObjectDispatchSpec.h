@@ -92,6 +92,18 @@ public:
     }
   };
 
+  struct WriteExtentsRequest : public WriteRequestBase {
+    Extents extents;
+    ceph::bufferlist data;
+
+    WriteExtentsRequest(uint64_t object_no, Extents&& extents,
+                        ceph::bufferlist&& data, const ::SnapContext& snapc,
+                        uint64_t journal_tid)
+      : WriteRequestBase(object_no, extents.front().first, snapc, journal_tid),
+        extents(std::move(extents)), data(std::move(data)) {
+    }
+  };
+
   struct WriteSameRequest : public WriteRequestBase {
     uint64_t object_len;
     LightweightBufferExtents buffer_extents;
@@ -135,6 +147,7 @@ public:
   typedef boost::variant<ReadRequest,
                          DiscardRequest,
                          WriteRequest,
+                         WriteExtentsRequest,
                          WriteSameRequest,
                          CompareAndWriteRequest,
                          FlushRequest> Request;
@@ -193,6 +206,21 @@ public:
                                   op_flags, parent_trace, on_finish);
   }
 
+  template <typename ImageCtxT>
+  static ObjectDispatchSpec* create_write_extents(
+      ImageCtxT* image_ctx, ObjectDispatchLayer object_dispatch_layer,
+      uint64_t object_no, Extents&& extents, ceph::bufferlist&& data,
+      const ::SnapContext &snapc, int op_flags, uint64_t journal_tid,
+      const ZTracer::Trace &parent_trace, Context *on_finish) {
+    return new ObjectDispatchSpec(image_ctx->io_object_dispatcher,
+                                  object_dispatch_layer,
+                                  WriteExtentsRequest{object_no,
+                                                      std::move(extents),
+                                                      std::move(data), snapc,
+                                                      journal_tid},
+                                  op_flags, parent_trace, on_finish);
+  }
+
   template <typename ImageCtxT>
   static ObjectDispatchSpec* create_write_same(
       ImageCtxT* image_ctx, ObjectDispatchLayer object_dispatch_layer,
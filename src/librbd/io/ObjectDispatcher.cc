@@ -136,6 +136,17 @@ struct ObjectDispatcher<I>::SendVisitor : public boost::static_visitor<bool> {
       &object_dispatch_spec->dispatcher_ctx);
   }
 
+  bool operator()(ObjectDispatchSpec::WriteExtentsRequest& write) const {
+    return object_dispatch->write_extents(
+      write.object_no, std::move(write.extents), std::move(write.data),
+      write.snapc, object_dispatch_spec->op_flags,
+      object_dispatch_spec->parent_trace,
+      &object_dispatch_spec->object_dispatch_flags, &write.journal_tid,
+      &object_dispatch_spec->dispatch_result,
+      &object_dispatch_spec->dispatcher_ctx.on_finish,
+      &object_dispatch_spec->dispatcher_ctx);
+  }
+
   bool operator()(ObjectDispatchSpec::WriteSameRequest& write_same) const {
     return object_dispatch->write_same(
       write_same.object_no, write_same.object_off, write_same.object_len,
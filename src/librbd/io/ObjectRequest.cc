@@ -351,14 +351,15 @@ template <typename I>
 AbstractObjectWriteRequest<I>::AbstractObjectWriteRequest(
     I *ictx, uint64_t object_no, uint64_t object_off, uint64_t len,
     const ::SnapContext &snapc, const char *trace_name,
-    const ZTracer::Trace &parent_trace, Context *completion)
+    const ZTracer::Trace &parent_trace, Context *completion, bool sparse)
   : ObjectRequest<I>(ictx, object_no, object_off, len, CEPH_NOSNAP, trace_name,
                      parent_trace, completion),
     m_snap_seq(snapc.seq.val)
 {
   m_snaps.insert(m_snaps.end(), snapc.snaps.begin(), snapc.snaps.end());
 
-  if (this->m_object_off == 0 &&
+  // a sparse write leaves gaps in its extent that still need copyup
+  if (!sparse && this->m_object_off == 0 &&
       this->m_object_len == ictx->get_object_size()) {
     m_full_object = true;
   }
@@ -448,8 +449,8 @@ void AbstractObjectWriteRequest<I>::pre_write_object_map_update() {
   if (image_ctx->object_map->template aio_update<
         AbstractObjectWriteRequest<I>,
         &AbstractObjectWriteRequest<I>::handle_pre_write_object_map_update>(
-          CEPH_NOSNAP, this->m_object_no, new_state, {}, this->m_trace, false,
-          this)) {
+          CEPH_NOSNAP, this->m_object_no, this->m_object_off,
+          this->m_object_len, new_state, {}, this->m_trace, false, this)) {
     image_ctx->image_lock.unlock_shared();
     return;
   }
@@ -639,10 +640,25 @@ template <typename I>
 void ObjectWriteRequest<I>::add_write_ops(librados::ObjectWriteOperation *wr) {
   if (this->m_full_object) {
     wr->write_full(m_write_data);
-  } else {
+    wr->set_op_flags2(m_op_flags);
+    return;
+  }
+  if (m_write_extents.size() <= 1) {
     wr->write(this->m_object_off, m_write_data);
+    wr->set_op_flags2(m_op_flags);
+    return;
+  }
+
+  // op flags apply to the op added last, so repeat them for each extent
+  uint64_t buffer_off = 0;
+  for (auto& [object_off, object_len] : m_write_extents) {
+    ceph::bufferlist bl;
+    bl.substr_of(m_write_data, buffer_off, object_len);
+    buffer_off += object_len;
+
+    wr->write(object_off, bl);
+    wr->set_op_flags2(m_op_flags);
   }
-  wr->set_op_flags2(m_op_flags);
 }
 
 template <typename I>
@@ -154,7 +154,8 @@ public:
   AbstractObjectWriteRequest(
       ImageCtxT *ictx, uint64_t object_no, uint64_t object_off, uint64_t len,
       const ::SnapContext &snapc, const char *trace_name,
-      const ZTracer::Trace &parent_trace, Context *completion);
+      const ZTracer::Trace &parent_trace, Context *completion,
+      bool sparse = false);
 
   virtual bool is_empty_write_op() const {
     return false;
@@ -263,6 +264,21 @@ public:
                                             parent_trace, completion),
       m_write_data(std::move(data)), m_op_flags(op_flags) {
   }
+  // write the disjoint extents, in ascending order, whose data are
+  // concatenated in data -- object_off~len spans them all
+  ObjectWriteRequest(
+      ImageCtxT *ictx, uint64_t object_no, Extents&& write_extents,
+      ceph::bufferlist&& data, const ::SnapContext &snapc, int op_flags,
+      const ZTracer::Trace &parent_trace, Context *completion)
+    : AbstractObjectWriteRequest<ImageCtxT>(
+        ictx, object_no, write_extents.front().first,
+        write_extents.back().first + write_extents.back().second -
+          write_extents.front().first,
+        snapc, "write", parent_trace, completion,
+        write_extents.size() > 1),
+      m_write_extents(std::move(write_extents)),
+      m_write_data(std::move(data)), m_op_flags(op_flags) {
+  }
 
   bool is_empty_write_op() const override {
     return (m_write_data.length() == 0);
@@ -276,6 +292,7 @@ protected:
   void add_write_ops(librados::ObjectWriteOperation *wr) override;
 
 private:
+  Extents m_write_extents;
   ceph::bufferlist m_write_data;
   int m_op_flags;
 };
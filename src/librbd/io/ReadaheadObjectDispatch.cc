@@ -0,0 +1,486 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "librbd/io/ReadaheadObjectDispatch.h"
+#include "common/dout.h"
+#include "common/errno.h"
+#include "common/perf_counters.h"
+#include "common/WorkQueue.h"
+#include "include/Context.h"
+#include "librbd/ImageCtx.h"
+#include "librbd/Types.h"
+#include "librbd/Utils.h"
+#include "librbd/io/ObjectDispatchSpec.h"
+#include "librbd/io/ObjectDispatcher.h"
+#include "librbd/io/Utils.h"
+#include "osdc/Striper.h"
+
+#include <algorithm>
+#include <vector>
+
+#define dout_subsys ceph_subsys_rbd
+#undef dout_prefix
+#define dout_prefix *_dout << "librbd::io::ReadaheadObjectDispatch: " \
+                           << this << " " << __func__ << ": "
+
+namespace librbd {
+namespace io {
+
+using librbd::util::data_object_name;
+
+static const size_t MAX_STREAMS = 4;
+
+template <typename I>
+ReadaheadObjectDispatch<I>::ReadaheadObjectDispatch(I* image_ctx)
+  : m_image_ctx(image_ctx),
+    m_object_size(image_ctx->layout.object_size),
+    m_trigger_requests(image_ctx->config.template get_val<uint64_t>(
+      "rbd_readahead_trigger_requests")),
+    m_max_bytes(image_ctx->config.template get_val<Option::size_t>(
+      "rbd_readahead_max_bytes")),
+    m_disable_after_bytes(image_ctx->config.template get_val<Option::size_t>(
+      "rbd_readahead_disable_after_bytes")),
+    m_buffer_max_bytes(image_ctx->config.template get_val<Option::size_t>(
+      "rbd_readahead_buffer_max_bytes")),
+    m_lock(ceph::make_mutex(librbd::util::unique_lock_name(
+      "librbd::io::ReadaheadObjectDispatch::lock", this))) {
+  auto cct = m_image_ctx->cct;
+  ldout(cct, 5) << "ictx=" << image_ctx << dendl;
+}
+
+template <typename I>
+ReadaheadObjectDispatch<I>::~ReadaheadObjectDispatch() {
+  ceph_assert(m_buffers.empty());
+}
+
+template <typename I>
+void ReadaheadObjectDispatch<I>::init() {
+  auto cct = m_image_ctx->cct;
+  ldout(cct, 5) << dendl;
+
+  // add ourself to the IO object dispatcher chain
+  m_image_ctx->io_object_dispatcher->register_object_dispatch(this);
+}
+
+template <typename I>
+void ReadaheadObjectDispatch<I>::shut_down(Context* on_finish) {
+  auto cct = m_image_ctx->cct;
+  ldout(cct, 5) << dendl;
+
+  // the image waits for pending readahead before shutting down the
+  // dispatcher, so no prefetch can still be in flight
+  invalidate(true, 0);
+  on_finish->complete(0);
+}
+
+template <typename I>
+bool ReadaheadObjectDispatch<I>::read(
+    uint64_t object_no, uint64_t object_off, uint64_t object_len,
+    librados::snap_t snap_id, int op_flags, const ZTracer::Trace &parent_trace,
+    ceph::bufferlist* read_data, ExtentMap* extent_map,
+    int* object_dispatch_flags, DispatchResult* dispatch_result,
+    Context** on_finish, Context* on_dispatched) {
+  auto cct = m_image_ctx->cct;
+  ldout(cct, 20) << data_object_name(m_image_ctx, object_no) << " "
+                 << object_off << "~" << object_len << dendl;
+
+  bool random = (op_flags & LIBRADOS_OP_FLAG_FADVISE_RANDOM) != 0;
+  uint64_t object_count = 0;
+  if (!random) {
+    std::shared_lock image_locker{m_image_ctx->image_lock};
+    object_count = Striper::get_num_objects(
+      m_image_ctx->layout, m_image_ctx->get_image_size(snap_id));
+  }
+
+  std::list<Prefetch*> prefetches;
+  bool handled = false;
+  int r = 0;
+  {
+    std::lock_guard locker{m_lock};
+    if (!random) {
+      update_stream(object_no, object_off, object_len, snap_id, object_count,
+                    &prefetches);
+    }
+
+    auto it = m_buffers.find({snap_id, object_no});
+    if (it != m_buffers.end()) {
+      auto& buffer = it->second;
+      handled = true;
+      *dispatch_result = DISPATCH_RESULT_COMPLETE;
+      if (!buffer.ready) {
+        ldout(cct, 20) << "waiting for prefetch" << dendl;
+        buffer.waiters.push_back({object_off, object_len, read_data,
+                                  extent_map, dispatch_result, on_dispatched});
+        on_dispatched = nullptr;
+      } else {
+        ldout(cct, 20) << "prefetch hit" << dendl;
+        r = buffer.r;
+        copy_buffer(buffer, object_off, object_len, read_data, extent_map);
+        if (object_off + object_len >= m_object_size) {
+          // the stream has moved past this object
+          erase_buffer(it, nullptr);
+        } else {
+          m_lru.splice(m_lru.begin(), m_lru, buffer.lru_pos);
+        }
+      }
+    }
+  }
+
+  for (auto prefetch_req : prefetches) {
+    prefetch(prefetch_req);
+  }
+
+  if (handled && on_dispatched != nullptr) {
+    m_image_ctx->op_work_queue->queue(on_dispatched, r);
+  }
+  return handled;
+}
+
+template <typename I>
+bool ReadaheadObjectDispatch<I>::discard(
+    uint64_t object_no, uint64_t object_off, uint64_t object_len,
+    const ::SnapContext &snapc, int discard_flags,
+    const ZTracer::Trace &parent_trace, int* object_dispatch_flags,
+    uint64_t* journal_tid, DispatchResult* dispatch_result,
+    Context** on_finish, Context* on_dispatched) {
+  auto cct = m_image_ctx->cct;
+  ldout(cct, 20) << data_object_name(m_image_ctx, object_no) << " "
+                 << object_off << "~" << object_len << dendl;
+
+  start_write(object_no, on_finish);
+  return false;
+}
+
+template <typename I>
+bool ReadaheadObjectDispatch<I>::write(
+    uint64_t object_no, uint64_t object_off, ceph::bufferlist&& data,
+    const ::SnapContext &snapc, int op_flags,
+    const ZTracer::Trace &parent_trace, int* object_dispatch_flags,
+    uint64_t* journal_tid, DispatchResult* dispatch_result,
+    Context** on_finish, Context* on_dispatched) {
+  auto cct = m_image_ctx->cct;
+  ldout(cct, 20) << data_object_name(m_image_ctx, object_no) << " "
+                 << object_off << "~" << data.length() << dendl;
+
+  start_write(object_no, on_finish);
+  return false;
+}
+
+template <typename I>
+bool ReadaheadObjectDispatch<I>::write_same(
+    uint64_t object_no, uint64_t object_off, uint64_t object_len,
+    LightweightBufferExtents&& buffer_extents, ceph::bufferlist&& data,
+    const ::SnapContext &snapc, int op_flags,
+    const ZTracer::Trace &parent_trace, int* object_dispatch_flags,
+    uint64_t* journal_tid, DispatchResult* dispatch_result,
+    Context** on_finish, Context* on_dispatched) {
+  auto cct = m_image_ctx->cct;
+  ldout(cct, 20) << data_object_name(m_image_ctx, object_no) << " "
+                 << object_off << "~" << object_len << dendl;
+
+  start_write(object_no, on_finish);
+  return false;
+}
+
+template <typename I>
+bool ReadaheadObjectDispatch<I>::compare_and_write(
+    uint64_t object_no, uint64_t object_off, ceph::bufferlist&& cmp_data,
+    ceph::bufferlist&& write_data, const ::SnapContext &snapc, int op_flags,
+    const ZTracer::Trace &parent_trace, uint64_t* mismatch_offset,
+    int* object_dispatch_flags, uint64_t* journal_tid,
+    DispatchResult* dispatch_result, Context** on_finish,
+    Context* on_dispatched) {
+  auto cct = m_image_ctx->cct;
+  ldout(cct, 20) << data_object_name(m_image_ctx, object_no) << " "
+                 << object_off << "~" << write_data.length() << dendl;
+
+  start_write(object_no, on_finish);
+  return false;
+}
+
+template <typename I>
+bool ReadaheadObjectDispatch<I>::invalidate_cache(Context* on_finish) {
+  auto cct = m_image_ctx->cct;
+  ldout(cct, 5) << dendl;
+
+  invalidate(true, 0);
+  return false;
+}
+
+template <typename I>
+void ReadaheadObjectDispatch<I>::update_stream(
+    uint64_t object_no, uint64_t object_off, uint64_t object_len,
+    librados::snap_t snap_id, uint64_t object_count,
+    std::list<Prefetch*>* prefetches) {
+  ceph_assert(ceph_mutex_is_locked(m_lock));
+
+  // a read continues a stream if it starts where the last one ended,
+  // possibly at the start of the following object
+  auto it = std::find_if(
+    m_streams.begin(), m_streams.end(),
+    [this, object_no, object_off, snap_id](const Stream& stream) {
+      return (stream.snap_id == snap_id &&
+              ((stream.object_no == object_no &&
+                stream.object_off == object_off) ||
+               (stream.object_no + 1 == object_no &&
+                stream.object_off == m_object_size && object_off == 0)));
+    });
+  if (it == m_streams.end()) {
+    m_streams.push_front({snap_id, object_no, object_off, 0, 0});
+    if (m_streams.size() > MAX_STREAMS) {
+      m_streams.pop_back();
+    }
+  } else {
+    m_streams.splice(m_streams.begin(), m_streams, it);
+  }
+
+  auto& stream = m_streams.front();
+  stream.object_no = object_no;
+  stream.object_off = object_off + object_len;
+  ++stream.requests;
+
+  m_total_bytes_read += object_len;
+  if (m_disable_after_bytes != 0 &&
+      m_total_bytes_read > m_disable_after_bytes) {
+    return;
+  } else if (stream.requests < m_trigger_requests) {
+    return;
+  }
+
+  uint64_t objects_ahead = std::max<uint64_t>(
+    1, (m_max_bytes + m_object_size - 1) / m_object_size);
+  uint64_t end_object_no = std::min(object_count,
+                                    object_no + 1 + objects_ahead);
+  for (uint64_t prefetch_object_no = std::max(object_no + 1,
+                                              stream.prefetch_object_no);
+       prefetch_object_no < end_object_no; ++prefetch_object_no) {
+    if (m_writes_in_flight.count(prefetch_object_no) != 0) {
+      // it could read the object from before the write; try again once
+      // the write completes
+      ldout(m_image_ctx->cct, 20) << "write in flight" << dendl;
+      break;
+    }
+
+    Key key{snap_id, prefetch_object_no};
+    if (m_buffers.count(key) == 0) {
+      if (!reserve_buffer()) {
+        ldout(m_image_ctx->cct, 20) << "buffer pool full" << dendl;
+        break;
+      }
+
+      auto& buffer = m_buffers[key];
+      buffer.tid = ++m_last_tid;
+      buffer.size = m_object_size;
+      m_buffer_bytes += buffer.size;
+      prefetches->push_back(new Prefetch{key, buffer.tid});
+    }
+    stream.prefetch_object_no = prefetch_object_no + 1;
+  }
+}
+
+template <typename I>
+bool ReadaheadObjectDispatch<I>::reserve_buffer() {
+  ceph_assert(ceph_mutex_is_locked(m_lock));
+
+  // in-flight prefetches cannot be evicted, only ready buffers
+  while (m_buffer_bytes + m_object_size > m_buffer_max_bytes &&
+         !m_lru.empty()) {
+    auto it = m_buffers.find(m_lru.back());
+    ceph_assert(it != m_buffers.end());
+    erase_buffer(it, nullptr);
+  }
+  return (m_buffer_bytes + m_object_size <= m_buffer_max_bytes);
+}
+
+template <typename I>
+void ReadaheadObjectDispatch<I>::prefetch(Prefetch* prefetch) {
+  auto cct = m_image_ctx->cct;
+  ldout(cct, 20) << data_object_name(m_image_ctx, prefetch->key.second)
+                 << dendl;
+
+  // the image waits for pending readahead before it shuts down the
+  // object dispatcher
+  librbd::util::get_image_ctx(m_image_ctx)->readahead.inc_pending();
+  m_image_ctx->perfcounter->inc(l_librbd_readahead);
+  m_image_ctx->perfcounter->inc(l_librbd_readahead_bytes, m_object_size);
+
+  auto ctx = new LambdaContext([this, prefetch](int r) {
+      handle_prefetch(prefetch, r);
+    });
+  auto req = ObjectDispatchSpec::create_read(
+    m_image_ctx, OBJECT_DISPATCH_LAYER_READAHEAD, prefetch->key.second, 0,
+    m_object_size, prefetch->key.first, 0, {}, &prefetch->data,
+    &prefetch->extent_map, ctx);
+  req->send();
+}
+
+template <typename I>
+void ReadaheadObjectDispatch<I>::handle_prefetch(Prefetch* prefetch, int r) {
+  auto cct = m_image_ctx->cct;
+  ldout(cct, 20) << data_object_name(m_image_ctx, prefetch->key.second)
+                 << " r=" << r << dendl;
+
+  std::list<Waiter> continue_list;
+  std::vector<Context*> complete_list;
+  {
+    std::lock_guard locker{m_lock};
+    auto it = m_buffers.find(prefetch->key);
+    if (it == m_buffers.end() || it->second.tid != prefetch->tid) {
+      ldout(cct, 20) << "invalidated while in flight" << dendl;
+    } else if (m_writes_in_flight.count(prefetch->key.second) != 0) {
+      // start_write() drops the buffer, so this can't be expected, but
+      // never keep data a write may have overtaken
+      ldout(cct, 20) << "write in flight" << dendl;
+      erase_buffer(it, &continue_list);
+    } else if (r < 0 && r != -ENOENT) {
+      ldout(cct, 5) << "failed to prefetch "
+                    << data_object_name(m_image_ctx, prefetch->key.second)
+                    << ": " << cpp_strerror(r) << dendl;
+      erase_buffer(it, &continue_list);
+    } else {
+      auto& buffer = it->second;
+      buffer.ready = true;
+      buffer.r = r;
+      buffer.data = std::move(prefetch->data);
+      buffer.extent_map = std::move(prefetch->extent_map);
+
+      // charge the pool for what was actually read
+      m_buffer_bytes -= buffer.size;
+      buffer.size = buffer.data.length();
+      m_buffer_bytes += buffer.size;
+
+      m_lru.push_front(prefetch->key);
+      buffer.lru_pos = m_lru.begin();
+
+      for (auto& waiter : buffer.waiters) {
+        copy_buffer(buffer, waiter.object_off, waiter.object_len,
+                    waiter.read_data, waiter.extent_map);
+        complete_list.push_back(waiter.on_dispatched);
+      }
+      buffer.waiters.clear();
+    }
+  }
+
+  for (auto ctx : complete_list) {
+    ctx->complete(r);
+  }
+  continue_waiters(std::move(continue_list));
+
+  delete prefetch;
+  librbd::util::get_image_ctx(m_image_ctx)->readahead.dec_pending();
+}
+
+template <typename I>
+void ReadaheadObjectDispatch<I>::copy_buffer(
+    const Buffer& buffer, uint64_t object_off, uint64_t object_len,
+    ceph::bufferlist* read_data, ExtentMap* extent_map) const {
+  if (buffer.extent_map.empty()) {
+    // plain read, possibly short
+    if (object_off < buffer.data.length()) {
+      read_data->substr_of(buffer.data, object_off,
+                           std::min(object_len,
+                                    buffer.data.length() - object_off));
+    }
+    return;
+  }
+
+  // sparse read: hand back the intersecting extents, or zero-fill the
+  // holes if the caller did not ask for an extent map
+  uint64_t object_end = object_off + object_len;
+  uint64_t data_off = 0;
+  for (auto [extent_off, extent_len] : buffer.extent_map) {
+    uint64_t start = std::max(object_off, extent_off);
+    uint64_t end = std::min(object_end, extent_off + extent_len);
+    if (start < end) {
+      ceph::bufferlist bl;
+      bl.substr_of(buffer.data, data_off + (start - extent_off), end - start);
+      if (extent_map != nullptr) {
+        (*extent_map)[start] = end - start;
+      } else {
+        read_data->append_zero(start - object_off - read_data->length());
+      }
+      read_data->claim_append(bl);
+    }
+    data_off += extent_len;
+  }
+}
+
+template <typename I>
+void ReadaheadObjectDispatch<I>::erase_buffer(typename Buffers::iterator it,
+                                              std::list<Waiter>* waiters) {
+  ceph_assert(ceph_mutex_is_locked(m_lock));
+
+  auto& buffer = it->second;
+  if (buffer.ready) {
+    m_lru.erase(buffer.lru_pos);
+  }
+  m_buffer_bytes -= buffer.size;
+  if (waiters != nullptr) {
+    waiters->splice(waiters->end(), buffer.waiters);
+  } else {
+    ceph_assert(buffer.waiters.empty());
+  }
+  m_buffers.erase(it);
+}
+
+template <typename I>
+void ReadaheadObjectDispatch<I>::invalidate(bool all, uint64_t object_no) {
+  std::list<Waiter> waiters;
+  {
+    std::lock_guard locker{m_lock};
+    for (auto it = m_buffers.begin(); it != m_buffers.end(); ) {
+      if (all || it->first.second == object_no) {
+        // reads still waiting on an in-flight prefetch fall through to the
+        // lower layers, and the stale prefetch is dropped when it completes
+        erase_buffer(it++, &waiters);
+      } else {
+        ++it;
+      }
+    }
+  }
+
+  continue_waiters(std::move(waiters));
+}
+
+template <typename I>
+void ReadaheadObjectDispatch<I>::start_write(uint64_t object_no,
+                                             Context** on_finish) {
+  {
+    std::lock_guard locker{m_lock};
+    ++m_writes_in_flight[object_no];
+  }
+  invalidate(false, object_no);
+
+  auto ctx = *on_finish;
+  *on_finish = new LambdaContext([this, object_no, ctx](int r) {
+      finish_write(object_no);
+      ctx->complete(r);
+    });
+}
+
+template <typename I>
+void ReadaheadObjectDispatch<I>::finish_write(uint64_t object_no) {
+  auto cct = m_image_ctx->cct;
+  ldout(cct, 20) << data_object_name(m_image_ctx, object_no) << dendl;
+
+  std::lock_guard locker{m_lock};
+  auto it = m_writes_in_flight.find(object_no);
+  ceph_assert(it != m_writes_in_flight.end());
+  if (--it->second == 0) {
+    m_writes_in_flight.erase(it);
+  }
+}
+
+template <typename I>
+void ReadaheadObjectDispatch<I>::continue_waiters(
+    std::list<Waiter>&& waiters) {
+  for (auto& waiter : waiters) {
+    *waiter.dispatch_result = DISPATCH_RESULT_CONTINUE;
+    m_image_ctx->op_work_queue->queue(waiter.on_dispatched, 0);
+  }
+}
+
+} // namespace io
+} // namespace librbd
+
+template class librbd::io::ReadaheadObjectDispatch<librbd::ImageCtx>;
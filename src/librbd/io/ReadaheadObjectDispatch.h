@@ -0,0 +1,200 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#ifndef CEPH_LIBRBD_IO_READAHEAD_OBJECT_DISPATCH_H
+#define CEPH_LIBRBD_IO_READAHEAD_OBJECT_DISPATCH_H
+
+#include "common/ceph_mutex.h"
+#include "include/buffer.h"
+#include "include/rados/librados.hpp"
+#include "librbd/io/ObjectDispatchInterface.h"
+#include "librbd/io/Types.h"
+
+#include <list>
+#include <map>
+#include <utility>
+
+struct Context;
+
+namespace librbd {
+
+class ImageCtx;
+
+namespace io {
+
+/**
+ * Readahead plugin for object dispatcher layer.
+ *
+ * Tracks a few sequential read streams per image in object space.  Once
+ * a stream has issued enough back-to-back requests, the objects ahead of
+ * it are read in full into a bounded buffer pool, and subsequent reads of
+ * those objects are served from the pool (or wait for the prefetch still
+ * in flight).  Any modification of an object drops its buffer, and the
+ * object is not prefetched again until the modification completes.
+ *
+ * Used when the object cacher, which has its own readahead, is not.
+ */
+template <typename ImageCtxT = ImageCtx>
+class ReadaheadObjectDispatch : public ObjectDispatchInterface {
+public:
+  static ReadaheadObjectDispatch* create(ImageCtxT* image_ctx) {
+    return new ReadaheadObjectDispatch(image_ctx);
+  }
+
+  ReadaheadObjectDispatch(ImageCtxT* image_ctx);
+  ~ReadaheadObjectDispatch() override;
+
+  ObjectDispatchLayer get_object_dispatch_layer() const override {
+    return OBJECT_DISPATCH_LAYER_READAHEAD;
+  }
+
+  void init();
+  void shut_down(Context* on_finish) override;
+
+  bool read(
+      uint64_t object_no, uint64_t object_off, uint64_t object_len,
+      librados::snap_t snap_id, int op_flags,
+      const ZTracer::Trace &parent_trace, ceph::bufferlist* read_data,
+      ExtentMap* extent_map, int* object_dispatch_flags,
+      DispatchResult* dispatch_result, Context** on_finish,
+      Context* on_dispatched) override;
+
+  bool discard(
+      uint64_t object_no, uint64_t object_off, uint64_t object_len,
+      const ::SnapContext &snapc, int discard_flags,
+      const ZTracer::Trace &parent_trace, int* object_dispatch_flags,
+      uint64_t* journal_tid, DispatchResult* dispatch_result,
+      Context** on_finish, Context* on_dispatched) override;
+
+  bool write(
+      uint64_t object_no, uint64_t object_off, ceph::bufferlist&& data,
+      const ::SnapContext &snapc, int op_flags,
+      const ZTracer::Trace &parent_trace, int* object_dispatch_flags,
+      uint64_t* journal_tid, DispatchResult* dispatch_result,
+      Context** on_finish, Context* on_dispatched) override;
+
+  bool write_extents(
+      uint64_t object_no, Extents&& extents, ceph::bufferlist&& data,
+      const ::SnapContext &snapc, int op_flags,
+      const ZTracer::Trace &parent_trace, int* object_dispatch_flags,
+      uint64_t* journal_tid, DispatchResult* dispatch_result,
+      Context** on_finish, Context* on_dispatched) override {
+    return false;
+  }
+
+  bool write_same(
+      uint64_t object_no, uint64_t object_off, uint64_t object_len,
+      LightweightBufferExtents&& buffer_extents, ceph::bufferlist&& data,
+      const ::SnapContext &snapc, int op_flags,
+      const ZTracer::Trace &parent_trace, int* object_dispatch_flags,
+      uint64_t* journal_tid, DispatchResult* dispatch_result,
+      Context** on_finish, Context* on_dispatched) override;
+
+  bool compare_and_write(
+      uint64_t object_no, uint64_t object_off, ceph::bufferlist&& cmp_data,
+      ceph::bufferlist&& write_data, const ::SnapContext &snapc, int op_flags,
+      const ZTracer::Trace &parent_trace, uint64_t* mismatch_offset,
+      int* object_dispatch_flags, uint64_t* journal_tid,
+      DispatchResult* dispatch_result, Context** on_finish,
+      Context* on_dispatched) override;
+
+  bool flush(
+      FlushSource flush_source, const ZTracer::Trace &parent_trace,
+      uint64_t* journal_tid, DispatchResult* dispatch_result,
+      Context** on_finish, Context* on_dispatched) override {
+    return false;
+  }
+
+  bool invalidate_cache(Context* on_finish) override;
+
+  bool reset_existence_cache(Context* on_finish) override {
+    return false;
+  }
+
+  void extent_overwritten(
+      uint64_t object_no, uint64_t object_off, uint64_t object_len,
+      uint64_t journal_tid, uint64_t new_journal_tid) override {
+  }
+
+private:
+  typedef std::pair<librados::snap_t, uint64_t> Key; // (snap_id, object_no)
+
+  struct Stream {
+    librados::snap_t snap_id;
+    uint64_t object_no;        ///< where the next sequential read starts
+    uint64_t object_off;
+    uint64_t requests;
+    uint64_t prefetch_object_no; ///< first object not yet prefetched
+  };
+
+  struct Waiter {
+    uint64_t object_off;
+    uint64_t object_len;
+    ceph::bufferlist* read_data;
+    ExtentMap* extent_map;
+    DispatchResult* dispatch_result;
+    Context* on_dispatched;
+  };
+
+  struct Buffer {
+    uint64_t tid;
+    uint64_t size;             ///< bytes charged against the pool
+    bool ready = false;
+    int r = 0;
+    ceph::bufferlist data;
+    ExtentMap extent_map;
+    std::list<Waiter> waiters;
+    std::list<Key>::iterator lru_pos;
+  };
+
+  struct Prefetch {
+    Key key;
+    uint64_t tid;
+    ceph::bufferlist data;
+    ExtentMap extent_map;
+  };
+
+  typedef std::map<Key, Buffer> Buffers;
+
+  ImageCtxT* m_image_ctx;
+  uint64_t m_object_size;
+  uint64_t m_trigger_requests;
+  uint64_t m_max_bytes;
+  uint64_t m_disable_after_bytes;
+  uint64_t m_buffer_max_bytes;
+
+  ceph::mutex m_lock;
+  std::list<Stream> m_streams; ///< front is the most recently used
+  uint64_t m_total_bytes_read = 0;
+
+  Buffers m_buffers;
+  std::list<Key> m_lru;        ///< ready buffers, front is most recently used
+  uint64_t m_buffer_bytes = 0; ///< includes whole objects still in flight
+  uint64_t m_last_tid = 0;
+
+  std::map<uint64_t, uint64_t> m_writes_in_flight; ///< by object_no
+
+  void update_stream(uint64_t object_no, uint64_t object_off,
+                     uint64_t object_len, librados::snap_t snap_id,
+                     uint64_t object_count, std::list<Prefetch*>* prefetches);
+  bool reserve_buffer();
+  void prefetch(Prefetch* prefetch);
+  void handle_prefetch(Prefetch* prefetch, int r);
+
+  void copy_buffer(const Buffer& buffer, uint64_t object_off,
+                   uint64_t object_len, ceph::bufferlist* read_data,
+                   ExtentMap* extent_map) const;
+  void erase_buffer(typename Buffers::iterator it,
+                    std::list<Waiter>* waiters);
+  void invalidate(bool all, uint64_t object_no);
+  void start_write(uint64_t object_no, Context** on_finish);
+  void finish_write(uint64_t object_no);
+  void continue_waiters(std::list<Waiter>&& waiters);
+};
+
+} // namespace io
+} // namespace librbd
+
+extern template class librbd::io::ReadaheadObjectDispatch<librbd::ImageCtx>;
+
+#endif // CEPH_LIBRBD_IO_READAHEAD_OBJECT_DISPATCH_H
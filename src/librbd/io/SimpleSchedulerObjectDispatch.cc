@@ -6,6 +6,7 @@
 #include "common/WorkQueue.h"
 #include "common/errno.h"
 #include "librbd/ImageCtx.h"
+#include "librbd/Types.h"
 #include "librbd/Utils.h"
 #include "librbd/io/ObjectDispatchSpec.h"
 #include "librbd/io/ObjectDispatcher.h"
@@ -28,6 +29,7 @@ using namespace boost::accumulators;
 using librbd::util::data_object_name;
 
 static const int LATENCY_STATS_WINDOW_SIZE = 10;
+static const uint32_t MAX_DELAY_SHIFT = 3;
 
 class LatencyStats {
 private:
@@ -62,7 +64,8 @@ bool SimpleSchedulerObjectDispatch<I>::ObjectRequests::try_delay_request(
     int op_flags, int object_dispatch_flags, Context* on_dispatched) {
   if (!m_delayed_requests.empty()) {
     if (snapc.seq != m_snapc.seq || op_flags != m_op_flags ||
-        data.length() == 0 || intersects(object_off, data.length())) {
+        data.length() == 0 ||
+        m_delayed_requests.begin()->second.data.length() == 0) {
       return false;
     }
   } else {
@@ -70,101 +73,105 @@ bool SimpleSchedulerObjectDispatch<I>::ObjectRequests::try_delay_request(
     m_op_flags = op_flags;
   }
 
+  ++m_delayed_write_count;
+  m_object_dispatch_flags |= object_dispatch_flags;
+
   if (data.length() == 0) {
     // a zero length write is usually a special case,
     // and we don't want it to be merged with others
     ceph_assert(m_delayed_requests.empty());
     m_delayed_request_extents.insert(0, UINT64_MAX);
-  } else {
-    m_delayed_request_extents.insert(object_off, data.length());
+    auto iter = m_delayed_requests.insert({object_off, {}}).first;
+    iter->second.requests.push_back(on_dispatched);
+    return true;
   }
-  m_object_dispatch_flags |= object_dispatch_flags;
 
-  if (!m_delayed_requests.empty()) {
-    // try to merge front to an existing request
-    auto iter = m_delayed_requests.find(object_off + data.length());
-    if (iter != m_delayed_requests.end()) {
-      auto new_iter = m_delayed_requests.insert({object_off, {}}).first;
-      new_iter->second.data = std::move(data);
-      new_iter->second.data.append(std::move(iter->second.data));
-      new_iter->second.requests = std::move(iter->second.requests);
-      new_iter->second.requests.push_back(on_dispatched);
-      m_delayed_requests.erase(iter);
-
-      if (new_iter != m_delayed_requests.begin()) {
-        auto prev = new_iter;
-        try_merge_delayed_requests(--prev, new_iter);
-      }
-      return true;
-    }
+  uint64_t object_end = object_off + data.length();
+  m_delayed_request_extents.union_insert(object_off, data.length());
 
-    // try to merge back to an existing request
-    iter = m_delayed_requests.lower_bound(object_off);
-    if (iter == m_delayed_requests.end() || iter->first > object_off) {
-      iter--;
+  // find the requests overlapping or adjacent to the new one
+  auto first = m_delayed_requests.lower_bound(object_off);
+  if (first != m_delayed_requests.begin()) {
+    auto prev = first;
+    --prev;
+    if (prev->first + prev->second.data.length() >= object_off) {
+      first = prev;
     }
-    if (iter != m_delayed_requests.end() &&
-        iter->first + iter->second.data.length() == object_off) {
-      iter->second.data.append(std::move(data));
-      iter->second.requests.push_back(on_dispatched);
-
-      auto next = iter;
-      if (++next != m_delayed_requests.end()) {
-        try_merge_delayed_requests(iter, next);
-      }
-      return true;
+  }
+  auto last = m_delayed_requests.upper_bound(object_end);
+
+  // merge them all into a single request, newer data winning where
+  // extents overlap
+  MergedRequests merged;
+  uint64_t merged_off = object_off;
+  for (auto iter = first; iter != last; ++iter) {
+    auto &request = iter->second;
+    uint64_t off = iter->first;
+    uint64_t end = off + request.data.length();
+    if (off < object_off) {
+      merged_off = off;
+      merged.data.substr_of(request.data, 0, object_off - off);
+    }
+    if (end > object_end) {
+      ceph::bufferlist tail;
+      tail.substr_of(request.data, object_end - off, end - object_end);
+      data.claim_append(tail);
     }
+    merged.requests.splice(merged.requests.end(), request.requests);
   }
+  merged.data.claim_append(data);
+  merged.requests.push_back(on_dispatched);
 
-  // create a new request
-  auto iter = m_delayed_requests.insert({object_off, {}}).first;
-  iter->second.data = std::move(data);
-  iter->second.requests.push_back(on_dispatched);
+  m_delayed_requests.erase(first, last);
+  m_delayed_requests.insert({merged_off, std::move(merged)});
   return true;
 }
 
-template <typename I>
-void SimpleSchedulerObjectDispatch<I>::ObjectRequests::try_merge_delayed_requests(
-    typename std::map<uint64_t, MergedRequests>::iterator &iter1,
-    typename std::map<uint64_t, MergedRequests>::iterator &iter2) {
-  if (iter1->first + iter1->second.data.length() != iter2->first) {
-    return;
-  }
-
-  iter1->second.data.append(std::move(iter2->second.data));
-  iter1->second.requests.insert(iter1->second.requests.end(),
-                                iter2->second.requests.begin(),
-                                iter2->second.requests.end());
-  m_delayed_requests.erase(iter2);
-}
-
 template <typename I>
 void SimpleSchedulerObjectDispatch<I>::ObjectRequests::dispatch_delayed_requests(
     I *image_ctx, LatencyStats *latency_stats, ceph::mutex *latency_stats_lock) {
+  // the merged requests do not touch one another: send them all in a
+  // single multi-extent write
+  Extents extents;
+  ceph::bufferlist data;
+  std::list<Context *> requests;
   for (auto &it : m_delayed_requests) {
-    auto offset = it.first;
     auto &merged_requests = it.second;
+    extents.emplace_back(it.first, merged_requests.data.length());
+    data.claim_append(merged_requests.data);
+    requests.splice(requests.end(), merged_requests.requests);
+  }
 
-    auto ctx = new LambdaContext(
-        [requests=std::move(merged_requests.requests), latency_stats,
-         latency_stats_lock, start_time=ceph_clock_now()](int r) {
-          if (latency_stats) {
-	    std::lock_guard locker{*latency_stats_lock};
-            auto latency = ceph_clock_now() - start_time;
-            latency_stats->add(latency.to_nsec());
-          }
-          for (auto on_dispatched : requests) {
-            on_dispatched->complete(r);
-          }
-        });
-
-    auto req = ObjectDispatchSpec::create_write(
-        image_ctx, OBJECT_DISPATCH_LAYER_SCHEDULER,
-        m_object_no, offset, std::move(merged_requests.data), m_snapc,
-        m_op_flags, 0, {}, ctx);
-
-    req->object_dispatch_flags = m_object_dispatch_flags;
-    req->send();
+  auto ctx = new LambdaContext(
+      [requests=std::move(requests), latency_stats, latency_stats_lock,
+       start_time=ceph_clock_now()](int r) {
+        if (latency_stats) {
+          std::lock_guard locker{*latency_stats_lock};
+          auto latency = ceph_clock_now() - start_time;
+          latency_stats->add(latency.to_nsec());
+        }
+        for (auto on_dispatched : requests) {
+          on_dispatched->complete(r);
+        }
+      });
+
+  ObjectDispatchSpec *req;
+  if (extents.size() == 1) {
+    req = ObjectDispatchSpec::create_write(
+        image_ctx, OBJECT_DISPATCH_LAYER_SCHEDULER, m_object_no,
+        extents.front().first, std::move(data), m_snapc, m_op_flags, 0, {},
+        ctx);
+  } else {
+    req = ObjectDispatchSpec::create_write_extents(
+        image_ctx, OBJECT_DISPATCH_LAYER_SCHEDULER, m_object_no,
+        std::move(extents), std::move(data), m_snapc, m_op_flags, 0, {}, ctx);
+  }
+  req->object_dispatch_flags = m_object_dispatch_flags;
+  req->send();
+
+  if (image_ctx->perfcounter != nullptr) {
+    image_ctx->perfcounter->inc(l_librbd_sched_delayed, m_delayed_write_count);
+    image_ctx->perfcounter->inc(l_librbd_sched_dispatched);
   }
 
   m_dispatch_time = {};
@@ -367,9 +374,11 @@ bool SimpleSchedulerObjectDispatch<I>::try_delay_write(
   if (delayed && !object_requests->is_scheduled_dispatch()) {
     auto dispatch_time = ceph::real_clock::now();
     if (m_latency_stats) {
-      dispatch_time += std::chrono::nanoseconds(m_latency_stats->avg() / 2);
+      dispatch_time += std::chrono::nanoseconds(
+        (m_latency_stats->avg() / 2) >> m_delay_shift);
     } else {
-      dispatch_time += std::chrono::milliseconds(m_max_delay);
+      dispatch_time += std::chrono::microseconds(
+        (m_max_delay * 1000) >> m_delay_shift);
     }
     object_requests->set_scheduled_dispatch(dispatch_time);
     m_dispatch_queue.push_back(object_requests);
@@ -455,6 +464,17 @@ void SimpleSchedulerObjectDispatch<I>::dispatch_delayed_requests(
     return;
   }
 
+  // shorten the delay while writes do not queue up behind in-flight ones
+  // to be merged, and restore it once they do
+  if (object_requests->delayed_write_count() > 1) {
+    if (m_delay_shift > 0) {
+      --m_delay_shift;
+    }
+  } else if (m_delay_shift < MAX_DELAY_SHIFT) {
+    ++m_delay_shift;
+  }
+  ldout(cct, 20) << "delay_shift=" << m_delay_shift << dendl;
+
   object_requests->dispatch_delayed_requests(m_image_ctx, m_latency_stats.get(),
                                              &m_lock);
 
@@ -26,6 +26,12 @@ class LatencyStats;
 
 /**
  * Simple scheduler plugin for object dispatcher layer.
+ *
+ * Writes to an object with a request already in flight are delayed until
+ * the in-flight request completes or the delay expires.  The delayed
+ * writes that overlap or abut one another are merged into a single extent,
+ * and the extents are then dispatched together as one multi-extent write.
+ * The delay shrinks while writes are not queueing up to be merged.
  */
 template <typename ImageCtxT = ImageCtx>
 class SimpleSchedulerObjectDispatch : public ObjectDispatchInterface {
@@ -70,6 +76,15 @@ public:
       uint64_t* journal_tid, DispatchResult* dispatch_result,
       Context** on_finish, Context* on_dispatched) override;
 
+  bool write_extents(
+      uint64_t object_no, Extents&& extents, ceph::bufferlist&& data,
+      const ::SnapContext &snapc, int op_flags,
+      const ZTracer::Trace &parent_trace, int* object_dispatch_flags,
+      uint64_t* journal_tid, DispatchResult* dispatch_result,
+      Context** on_finish, Context* on_dispatched) override {
+    return false;
+  }
+
   bool write_same(
       uint64_t object_no, uint64_t object_off, uint64_t object_len,
       LightweightBufferExtents&& buffer_extents, ceph::bufferlist&& data,
@@ -144,6 +159,10 @@ private:
       return m_delayed_requests.size();
     }
 
+    uint64_t delayed_write_count() const {
+      return m_delayed_write_count;
+    }
+
     bool intersects(uint64_t object_off, uint64_t len) const {
       return m_delayed_request_extents.intersects(object_off, len);
     }
@@ -165,10 +184,7 @@ private:
     int m_object_dispatch_flags = 0;
     std::map<uint64_t, MergedRequests> m_delayed_requests;
     interval_set<uint64_t> m_delayed_request_extents;
-
-    void try_merge_delayed_requests(
-        typename std::map<uint64_t, MergedRequests>::iterator &iter,
-        typename std::map<uint64_t, MergedRequests>::iterator &iter2);
+    uint64_t m_delayed_write_count = 0;
   };
 
   typedef std::shared_ptr<ObjectRequests> ObjectRequestsRef;
@@ -181,6 +197,7 @@ private:
   ceph::mutex *m_timer_lock;
   uint64_t m_max_delay;
   uint64_t m_dispatch_seq = 0;
+  uint32_t m_delay_shift = 0; ///< delay is scaled down by 2^m_delay_shift
 
   Requests m_requests;
   std::list<ObjectRequestsRef> m_dispatch_queue;
@@ -60,6 +60,7 @@ enum DispatchResult {
 enum ObjectDispatchLayer {
   OBJECT_DISPATCH_LAYER_NONE = 0,
   OBJECT_DISPATCH_LAYER_CACHE,
+  OBJECT_DISPATCH_LAYER_READAHEAD,
   OBJECT_DISPATCH_LAYER_JOURNAL,
   OBJECT_DISPATCH_LAYER_PARENT_CACHE,
   OBJECT_DISPATCH_LAYER_SCHEDULER,
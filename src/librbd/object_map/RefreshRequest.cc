@@ -27,9 +27,11 @@ namespace object_map {
 template <typename I>
 RefreshRequest<I>::RefreshRequest(I &image_ctx, ceph::shared_mutex* object_map_lock,
                                   ceph::BitVector<2> *object_map,
+                                  ceph::BitVector<2> *dirty_map,
                                   uint64_t snap_id, Context *on_finish)
   : m_image_ctx(image_ctx), m_object_map_lock(object_map_lock),
-     m_object_map(object_map), m_snap_id(snap_id), m_on_finish(on_finish),
+     m_object_map(object_map), m_dirty_map(dirty_map), m_snap_id(snap_id),
+     m_on_finish(on_finish),
     m_object_count(0), m_truncate_on_disk_object_map(false) {
 }
 
@@ -155,7 +157,7 @@ Context *RefreshRequest<I>::handle_load(int *ret_val) {
   }
 
   apply();
-  return m_on_finish;
+  return send_load_dirty_map();
 }
 
 template <typename I>
@@ -189,7 +191,7 @@ Context *RefreshRequest<I>::handle_invalidate(int *ret_val) {
   }
 
   apply();
-  return m_on_finish;
+  return send_load_dirty_map();
 }
 
 template <typename I>
@@ -221,7 +223,7 @@ Context *RefreshRequest<I>::handle_resize_invalidate(int *ret_val) {
     lderr(cct) << "failed to invalidate object map: " << cpp_strerror(*ret_val)
                << dendl;
     apply();
-    return m_on_finish;
+    return send_load_dirty_map();
   }
 
   send_resize();
@@ -263,7 +265,7 @@ Context *RefreshRequest<I>::handle_resize(int *ret_val) {
   }
 
   apply();
-  return m_on_finish;
+  return send_load_dirty_map();
 }
 
 template <typename I>
@@ -300,6 +302,168 @@ Context *RefreshRequest<I>::handle_invalidate_and_close(int *ret_val) {
   return m_on_finish;
 }
 
+template <typename I>
+Context *RefreshRequest<I>::send_load_dirty_map() {
+  {
+    std::shared_lock image_locker{m_image_ctx.image_lock};
+    if (m_snap_id != CEPH_NOSNAP ||
+        (m_image_ctx.features & RBD_FEATURE_FAST_DIFF) == 0 ||
+        ((m_image_ctx.op_features & RBD_OPERATION_FEATURE_DIRTY_BLOCKS) == 0 &&
+         !m_image_ctx.config.template get_val<bool>(
+           "rbd_fast_diff_dirty_blocks"))) {
+      return m_on_finish;
+    }
+  }
+
+  CephContext *cct = m_image_ctx.cct;
+  uint64_t block_count = ObjectMap<>::get_dirty_block_count(
+    m_image_ctx.layout, m_object_count);
+  if (block_count > cls::rbd::MAX_OBJECT_MAP_OBJECT_COUNT) {
+    ldout(cct, 5) << this << " " << __func__ << ": "
+                  << "too many blocks to track: " << block_count << dendl;
+    return m_on_finish;
+  }
+
+  std::string oid(ObjectMap<>::dirty_map_name(m_image_ctx.id, m_snap_id));
+  ldout(cct, 10) << this << " " << __func__ << ": oid=" << oid << dendl;
+
+  librados::ObjectReadOperation op;
+  cls_client::object_map_load_start(&op);
+
+  using klass = RefreshRequest<I>;
+  m_out_bl.clear();
+  librados::AioCompletion *rados_completion =
+    create_rados_callback<klass, &klass::handle_load_dirty_map>(this);
+  int r = m_image_ctx.md_ctx.aio_operate(oid, rados_completion, &op, &m_out_bl);
+  ceph_assert(r == 0);
+  rados_completion->release();
+  return nullptr;
+}
+
+template <typename I>
+Context *RefreshRequest<I>::handle_load_dirty_map(int *ret_val) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 10) << this << " " << __func__ << ": r=" << *ret_val << dendl;
+
+  if (*ret_val == 0) {
+    auto bl_it = m_out_bl.cbegin();
+    *ret_val = cls_client::object_map_load_finish(&bl_it,
+                                                  &m_on_disk_dirty_map);
+  }
+
+  uint64_t block_count = ObjectMap<>::get_dirty_block_count(
+    m_image_ctx.layout, m_object_count);
+  if (*ret_val == 0 && m_on_disk_dirty_map.size() >= block_count) {
+    apply_dirty_map();
+    return m_on_finish;
+  } else if (*ret_val < 0 && *ret_val != -ENOENT && *ret_val != -EINVAL) {
+    // continue without tracking -- fast-diff falls back to whole objects
+    lderr(cct) << "failed to load dirty map: " << cpp_strerror(*ret_val)
+               << dendl;
+    *ret_val = 0;
+    return m_on_finish;
+  }
+
+  ldout(cct, 5) << this << " " << __func__ << ": "
+                << "initializing dirty map" << dendl;
+  *ret_val = 0;
+  {
+    std::shared_lock object_map_locker{*m_object_map_lock};
+    m_on_disk_dirty_map.clear();
+    ObjectMap<>::mark_dirty(
+      *m_object_map, ObjectMap<>::get_dirty_block_count(m_image_ctx.layout, 1),
+      &m_on_disk_dirty_map);
+  }
+
+  std::shared_lock image_locker{m_image_ctx.image_lock};
+  if ((m_image_ctx.op_features & RBD_OPERATION_FEATURE_DIRTY_BLOCKS) == 0) {
+    send_set_op_feature();
+  } else {
+    send_save_dirty_map();
+  }
+  return nullptr;
+}
+
+template <typename I>
+void RefreshRequest<I>::send_set_op_feature() {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 10) << this << " " << __func__ << dendl;
+
+  // prevent clients that would not maintain the dirty map from
+  // snapshotting the image
+  librados::ObjectWriteOperation op;
+  cls_client::op_features_set(&op, RBD_OPERATION_FEATURE_DIRTY_BLOCKS,
+                              RBD_OPERATION_FEATURE_DIRTY_BLOCKS);
+
+  using klass = RefreshRequest<I>;
+  librados::AioCompletion *rados_completion =
+    create_rados_callback<klass, &klass::handle_set_op_feature>(this);
+  int r = m_image_ctx.md_ctx.aio_operate(m_image_ctx.header_oid,
+                                         rados_completion, &op);
+  ceph_assert(r == 0);
+  rados_completion->release();
+}
+
+template <typename I>
+Context *RefreshRequest<I>::handle_set_op_feature(int *ret_val) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 10) << this << " " << __func__ << ": r=" << *ret_val << dendl;
+
+  if (*ret_val < 0) {
+    lderr(cct) << "failed to enable dirty block tracking: "
+               << cpp_strerror(*ret_val) << dendl;
+    *ret_val = 0;
+    return m_on_finish;
+  }
+
+  {
+    std::unique_lock image_locker{m_image_ctx.image_lock};
+    m_image_ctx.op_features |= RBD_OPERATION_FEATURE_DIRTY_BLOCKS;
+  }
+
+  send_save_dirty_map();
+  return nullptr;
+}
+
+template <typename I>
+void RefreshRequest<I>::send_save_dirty_map() {
+  CephContext *cct = m_image_ctx.cct;
+  std::string oid(ObjectMap<>::dirty_map_name(m_image_ctx.id, m_snap_id));
+  ldout(cct, 10) << this << " " << __func__ << ": oid=" << oid << dendl;
+
+  librados::ObjectWriteOperation op;
+  cls_client::object_map_save(&op, m_on_disk_dirty_map);
+
+  using klass = RefreshRequest<I>;
+  librados::AioCompletion *rados_completion =
+    create_rados_callback<klass, &klass::handle_save_dirty_map>(this);
+  int r = m_image_ctx.md_ctx.aio_operate(oid, rados_completion, &op);
+  ceph_assert(r == 0);
+  rados_completion->release();
+}
+
+template <typename I>
+Context *RefreshRequest<I>::handle_save_dirty_map(int *ret_val) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 10) << this << " " << __func__ << ": r=" << *ret_val << dendl;
+
+  if (*ret_val < 0) {
+    lderr(cct) << "failed to save dirty map: " << cpp_strerror(*ret_val)
+               << dendl;
+    *ret_val = 0;
+    return m_on_finish;
+  }
+
+  apply_dirty_map();
+  return m_on_finish;
+}
+
+template <typename I>
+void RefreshRequest<I>::apply_dirty_map() {
+  std::unique_lock object_map_locker{*m_object_map_lock};
+  *m_dirty_map = m_on_disk_dirty_map;
+}
+
 } // namespace object_map
 } // namespace librbd
 
@@ -24,13 +24,15 @@ public:
   static RefreshRequest *create(ImageCtxT &image_ctx,
 				ceph::shared_mutex* object_map_lock,
                                 ceph::BitVector<2> *object_map,
+                                ceph::BitVector<2> *dirty_map,
                                 uint64_t snap_id, Context *on_finish) {
-    return new RefreshRequest(image_ctx, object_map_lock, object_map, snap_id,
-                              on_finish);
+    return new RefreshRequest(image_ctx, object_map_lock, object_map,
+                              dirty_map, snap_id, on_finish);
   }
 
   RefreshRequest(ImageCtxT &image_ctx, ceph::shared_mutex* object_map_lock,
-                 ceph::BitVector<2> *object_map, uint64_t snap_id,
+                 ceph::BitVector<2> *object_map,
+                 ceph::BitVector<2> *dirty_map, uint64_t snap_id,
                  Context *on_finish);
 
   void send();
@@ -56,20 +58,39 @@ private:
    *    *             |                      v  v               |
    *    *             \--------------------> LOCK <-------------/
    *    *                                     |
-   *    v                                     v
+   *    *                                     v
+   *    *                              LOAD_DIRTY_MAP (skip if untracked)
+   *    *                                     |
+   *    *           (missing or invalid)      |
+   *    *       /-----------------------------/
+   *    *       |                             |
+   *    *       v                             |
+   *    *   SET_OP_FEATURE (skip if set)      |
+   *    *       |                             |
+   *    *       v                             |
+   *    *   SAVE_DIRTY_MAP                    |
+   *    *       |                             |
+   *    v       v                             v
    * INVALIDATE_AND_CLOSE ---------------> <finish>
    *
    * @endverbatim
+   *
+   * Sub-object dirty tracking applies to the HEAD object map of images
+   * with fast-diff, once enabled through the dirty-blocks operation
+   * feature or the rbd_fast_diff_dirty_blocks option.  A missing dirty map
+   * is created conservatively from the object map.
    */
 
   ImageCtxT &m_image_ctx;
   ceph::shared_mutex* m_object_map_lock;
   ceph::BitVector<2> *m_object_map;
+  ceph::BitVector<2> *m_dirty_map;
   uint64_t m_snap_id;
   Context *m_on_finish;
 
   uint64_t m_object_count;
   ceph::BitVector<2> m_on_disk_object_map;
+  ceph::BitVector<2> m_on_disk_dirty_map;
   bool m_truncate_on_disk_object_map;
   bufferlist m_out_bl;
 
@@ -91,7 +112,17 @@ private:
   void send_invalidate_and_close();
   Context *handle_invalidate_and_close(int *ret_val);
 
+  Context *send_load_dirty_map();
+  Context *handle_load_dirty_map(int *ret_val);
+
+  void send_set_op_feature();
+  Context *handle_set_op_feature(int *ret_val);
+
+  void send_save_dirty_map();
+  Context *handle_save_dirty_map(int *ret_val);
+
   void apply();
+  void apply_dirty_map();
 };
 
 } // namespace object_map
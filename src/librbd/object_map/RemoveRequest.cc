@@ -44,9 +44,18 @@ void RemoveRequest<I>::send_remove_object_map() {
   std::lock_guard locker{m_lock};
   ceph_assert(m_ref_counter == 0);
 
+  std::vector<std::string> oids;
+  bool dirty_blocks = ((m_image_ctx->op_features &
+                          RBD_OPERATION_FEATURE_DIRTY_BLOCKS) != 0);
   for (auto snap_id : snap_ids) {
+    oids.push_back(ObjectMap<>::object_map_name(m_image_ctx->id, snap_id));
+    if (dirty_blocks) {
+      oids.push_back(ObjectMap<>::dirty_map_name(m_image_ctx->id, snap_id));
+    }
+  }
+
+  for (auto &oid : oids) {
     m_ref_counter++;
-    std::string oid(ObjectMap<>::object_map_name(m_image_ctx->id, snap_id));
     using klass = RemoveRequest<I>;
     librados::AioCompletion *comp =
       create_rados_callback<klass, &klass::handle_remove_object_map>(this);
@@ -78,6 +87,43 @@ Context *RemoveRequest<I>::handle_remove_object_map(int *result) {
   }
   if (m_error_result < 0) {
     *result = m_error_result;
+    return m_on_finish;
+  }
+  return send_disable_dirty_blocks();
+}
+
+template <typename I>
+Context *RemoveRequest<I>::send_disable_dirty_blocks() {
+  {
+    std::shared_lock image_locker{m_image_ctx->image_lock};
+    if ((m_image_ctx->op_features & RBD_OPERATION_FEATURE_DIRTY_BLOCKS) == 0) {
+      return m_on_finish;
+    }
+  }
+
+  CephContext *cct = m_image_ctx->cct;
+  ldout(cct, 20) << __func__ << dendl;
+
+  librados::ObjectWriteOperation op;
+  cls_client::op_features_set(&op, 0, RBD_OPERATION_FEATURE_DIRTY_BLOCKS);
+
+  using klass = RemoveRequest<I>;
+  librados::AioCompletion *comp =
+    create_rados_callback<klass, &klass::handle_disable_dirty_blocks>(this);
+  int r = m_image_ctx->md_ctx.aio_operate(m_image_ctx->header_oid, comp, &op);
+  ceph_assert(r == 0);
+  comp->release();
+  return nullptr;
+}
+
+template <typename I>
+Context *RemoveRequest<I>::handle_disable_dirty_blocks(int *result) {
+  CephContext *cct = m_image_ctx->cct;
+  ldout(cct, 20) << __func__ << ": r=" << *result << dendl;
+
+  if (*result < 0) {
+    lderr(cct) << "failed to disable dirty block tracking: "
+               << cpp_strerror(*result) << dendl;
   }
   return m_on_finish;
 }
@@ -33,9 +33,12 @@ private:
    * <start>
    *    |          .  .  .
    *    v          v     .
-   * REMOVE_OBJECT_MAP   . (for every snapshot)
-   *    |          .     .
+   * REMOVE_OBJECT_MAP   . (for every snapshot, along with
+   *    |          .     .  any dirty map)
    *    v          .  .  .
+   * DISABLE_DIRTY_BLOCKS (skip if not enabled)
+   *    |
+   *    v
    * <finis>
    *
    * @endverbatim
@@ -53,6 +56,9 @@ private:
 
   void send_remove_object_map();
   Context *handle_remove_object_map(int *result);
+
+  Context *send_disable_dirty_blocks();
+  Context *handle_disable_dirty_blocks(int *result);
 };
 
 } // namespace object_map
@@ -3,6 +3,7 @@
 
 #include "librbd/object_map/SnapshotCreateRequest.h"
 #include "common/dout.h"
+#include "common/errno.h"
 #include "librbd/ImageCtx.h"
 #include "librbd/ObjectMap.h"
 #include "cls/lock/cls_lock_client.h"
@@ -29,6 +30,12 @@ std::ostream& operator<<(std::ostream& os,
   case SnapshotCreateRequest::STATE_ADD_SNAPSHOT:
     os << "ADD_SNAPSHOT";
     break;
+  case SnapshotCreateRequest::STATE_WRITE_DIRTY_MAP:
+    os << "WRITE_DIRTY_MAP";
+    break;
+  case SnapshotCreateRequest::STATE_RESET_DIRTY_MAP:
+    os << "RESET_DIRTY_MAP";
+    break;
   default:
     os << "UNKNOWN (" << static_cast<uint32_t>(state) << ")";
     break;
@@ -46,6 +53,21 @@ bool SnapshotCreateRequest::should_complete(int r) {
   CephContext *cct = m_image_ctx.cct;
   ldout(cct, 5) << this << " " << __func__ << ": state=" << m_state << ", "
                 << "r=" << r << dendl;
+  if (m_state == STATE_WRITE_DIRTY_MAP) {
+    if (r < 0) {
+      lderr(cct) << "failed to write snapshot dirty map: " << cpp_strerror(r)
+                 << dendl;
+    }
+    return send_reset_dirty_map();
+  } else if (m_state == STATE_RESET_DIRTY_MAP) {
+    if (r < 0) {
+      lderr(cct) << "failed to reset dirty map: " << cpp_strerror(r) << dendl;
+    } else {
+      update_dirty_map();
+    }
+    return true;
+  }
+
   if (r < 0 && m_ret_val == 0) {
     m_ret_val = r;
   }
@@ -65,7 +87,7 @@ bool SnapshotCreateRequest::should_complete(int r) {
     break;
   case STATE_ADD_SNAPSHOT:
     update_object_map();
-    finished = true;
+    finished = send_write_dirty_map();
     break;
   default:
     ceph_abort();
@@ -131,6 +153,46 @@ bool SnapshotCreateRequest::send_add_snapshot() {
   return false;
 }
 
+bool SnapshotCreateRequest::send_write_dirty_map() {
+  std::shared_lock object_map_locker{*m_object_map_lock};
+  if (m_dirty_map == nullptr || m_dirty_map->size() == 0) {
+    return true;
+  }
+
+  CephContext *cct = m_image_ctx.cct;
+  std::string snap_oid(ObjectMap<>::dirty_map_name(m_image_ctx.id, m_snap_id));
+  ldout(cct, 5) << this << " " << __func__ << ": snap_oid=" << snap_oid
+                << dendl;
+  m_state = STATE_WRITE_DIRTY_MAP;
+
+  // IO is still blocked -- the in-memory dirty map is current
+  librados::ObjectWriteOperation op;
+  cls_client::object_map_save(&op, *m_dirty_map);
+
+  librados::AioCompletion *rados_completion = create_callback_completion();
+  int r = m_image_ctx.md_ctx.aio_operate(snap_oid, rados_completion, &op);
+  ceph_assert(r == 0);
+  rados_completion->release();
+  return false;
+}
+
+bool SnapshotCreateRequest::send_reset_dirty_map() {
+  CephContext *cct = m_image_ctx.cct;
+  std::string oid(ObjectMap<>::dirty_map_name(m_image_ctx.id, CEPH_NOSNAP));
+  ldout(cct, 5) << this << " " << __func__ << ": oid=" << oid << dendl;
+  m_state = STATE_RESET_DIRTY_MAP;
+
+  // dirty blocks are recorded as _EXISTS and cleared to _EXISTS_CLEAN
+  librados::ObjectWriteOperation op;
+  cls_client::object_map_snap_add(&op);
+
+  librados::AioCompletion *rados_completion = create_callback_completion();
+  int r = m_image_ctx.md_ctx.aio_operate(oid, rados_completion, &op);
+  ceph_assert(r == 0);
+  rados_completion->release();
+  return false;
+}
+
 void SnapshotCreateRequest::update_object_map() {
   std::unique_lock object_map_locker{*m_object_map_lock};
 
@@ -143,5 +205,17 @@ void SnapshotCreateRequest::update_object_map() {
   }
 }
 
+void SnapshotCreateRequest::update_dirty_map() {
+  std::unique_lock object_map_locker{*m_object_map_lock};
+
+  auto it = m_dirty_map->begin();
+  auto end_it = m_dirty_map->end();
+  for (; it != end_it; ++it) {
+    if (*it == OBJECT_EXISTS) {
+      *it = OBJECT_EXISTS_CLEAN;
+    }
+  }
+}
+
 } // namespace object_map
 } // namespace librbd
@@ -30,27 +30,39 @@ public:
    * STATE_READ_MAP
    *    |
    *    v            (skip)
-   * STATE_WRITE_MAP . . . . . . .
-   *    |                        .
-   *    v                        v
-   * STATE_ADD_SNAPSHOT ---> <finish>
+   * STATE_WRITE_MAP . . . . . . . . . . . . .
+   *    |                                  .
+   *    v                       (skip)     .
+   * STATE_ADD_SNAPSHOT . . . . . . . . . >.
+   *    |                                  .
+   *    v                                  .
+   * STATE_WRITE_DIRTY_MAP                 .
+   *    |                                  .
+   *    v                                  v
+   * STATE_RESET_DIRTY_MAP -----------> <finish>
    *
    * @endverbatim
    *
    * The _ADD_SNAPSHOT state is skipped if the FAST_DIFF feature isn't enabled.
+   * The _DIRTY_MAP states are skipped if sub-object dirty tracking isn't in
+   * use.  Failing to preserve the dirty blocks of the snapshot only costs
+   * precision, so errors from these states do not invalidate the object map.
    */
   enum State {
     STATE_READ_MAP,
     STATE_WRITE_MAP,
-    STATE_ADD_SNAPSHOT
+    STATE_ADD_SNAPSHOT,
+    STATE_WRITE_DIRTY_MAP,
+    STATE_RESET_DIRTY_MAP
   };
 
   SnapshotCreateRequest(ImageCtx &image_ctx, ceph::shared_mutex* object_map_lock,
-                        ceph::BitVector<2> *object_map, uint64_t snap_id,
+                        ceph::BitVector<2> *object_map,
+                        ceph::BitVector<2> *dirty_map, uint64_t snap_id,
                         Context *on_finish)
     : Request(image_ctx, snap_id, on_finish),
       m_object_map_lock(object_map_lock), m_object_map(*object_map),
-      m_ret_val(0) {
+      m_dirty_map(dirty_map), m_ret_val(0) {
   }
 
   void send() override;
@@ -61,6 +73,7 @@ protected:
 private:
   ceph::shared_mutex* m_object_map_lock;
   ceph::BitVector<2> &m_object_map;
+  ceph::BitVector<2> *m_dirty_map;
 
   State m_state = STATE_READ_MAP;
   bufferlist m_read_bl;
@@ -69,8 +82,11 @@ private:
   void send_read_map();
   void send_write_map();
   bool send_add_snapshot();
+  bool send_write_dirty_map();
+  bool send_reset_dirty_map();
 
   void update_object_map();
+  void update_dirty_map();
 
 };
 
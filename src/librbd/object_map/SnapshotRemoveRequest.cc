@@ -21,6 +21,8 @@ void SnapshotRemoveRequest::send() {
   ceph_assert(ceph_mutex_is_locked(m_image_ctx.owner_lock));
   ceph_assert(ceph_mutex_is_wlocked(m_image_ctx.image_lock));
 
+  m_dirty_tracking = ((m_image_ctx.op_features &
+                         RBD_OPERATION_FEATURE_DIRTY_BLOCKS) != 0);
   if ((m_image_ctx.features & RBD_FEATURE_FAST_DIFF) != 0) {
     int r = m_image_ctx.get_flags(m_snap_id, &m_flags);
     ceph_assert(r == 0);
@@ -59,7 +61,7 @@ void SnapshotRemoveRequest::handle_load_map(int r) {
   if (r == -ENOENT) {
     // implies we have already deleted this snapshot and handled the
     // necessary fast-diff cleanup
-    complete(0);
+    remove_dirty_map();
     return;
   } else if (r < 0) {
     std::string oid(ObjectMap<>::object_map_name(m_image_ctx.id, m_snap_id));
@@ -120,6 +122,10 @@ void SnapshotRemoveRequest::handle_remove_snapshot(int r) {
 
   std::shared_lock image_locker{m_image_ctx.image_lock};
   update_object_map();
+  if (m_dirty_tracking) {
+    load_dirty_map();
+    return;
+  }
   remove_map();
 }
 
@@ -181,6 +187,150 @@ void SnapshotRemoveRequest::handle_remove_map(int r) {
     return;
   }
 
+  remove_dirty_map();
+}
+
+void SnapshotRemoveRequest::load_dirty_map() {
+  CephContext *cct = m_image_ctx.cct;
+  std::string snap_oid(ObjectMap<>::dirty_map_name(m_image_ctx.id, m_snap_id));
+  ldout(cct, 5) << "snap_oid=" << snap_oid << dendl;
+
+  librados::ObjectReadOperation op;
+  cls_client::object_map_load_start(&op);
+
+  m_out_bl.clear();
+  auto rados_completion = librbd::util::create_rados_callback<
+    SnapshotRemoveRequest, &SnapshotRemoveRequest::handle_load_dirty_map>(this);
+  int r = m_image_ctx.md_ctx.aio_operate(snap_oid, rados_completion, &op,
+                                         &m_out_bl);
+  ceph_assert(r == 0);
+  rados_completion->release();
+}
+
+void SnapshotRemoveRequest::handle_load_dirty_map(int r) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 5) << "r=" << r << dendl;
+
+  if (r == 0) {
+    auto it = m_out_bl.cbegin();
+    r = cls_client::object_map_load_finish(&it, &m_snap_dirty_map);
+  }
+  if (r < 0) {
+    // the blocks written before the snapshot are unknown
+    ldout(cct, 5) << "failed to load snapshot dirty map: " << cpp_strerror(r)
+                  << dendl;
+    invalidate_next_dirty_map();
+    return;
+  }
+
+  merge_dirty_map();
+}
+
+void SnapshotRemoveRequest::merge_dirty_map() {
+  CephContext *cct = m_image_ctx.cct;
+  std::string oid(ObjectMap<>::dirty_map_name(m_image_ctx.id, m_next_snap_id));
+  ldout(cct, 5) << "oid=" << oid << dendl;
+
+  // dirty blocks are recorded as _EXISTS, so they fold into the next
+  // dirty map the same way object states do
+  librados::ObjectWriteOperation op;
+  cls_client::object_map_snap_remove(&op, m_snap_dirty_map);
+
+  auto rados_completion = librbd::util::create_rados_callback<
+    SnapshotRemoveRequest,
+    &SnapshotRemoveRequest::handle_merge_dirty_map>(this);
+  int r = m_image_ctx.md_ctx.aio_operate(oid, rados_completion, &op);
+  ceph_assert(r == 0);
+  rados_completion->release();
+}
+
+void SnapshotRemoveRequest::handle_merge_dirty_map(int r) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 5) << "r=" << r << dendl;
+
+  if (r < 0 && r != -ENOENT) {
+    lderr(cct) << "failed to merge dirty map: " << cpp_strerror(r) << dendl;
+    invalidate_next_dirty_map();
+    return;
+  } else if (r == 0) {
+    std::shared_lock image_locker{m_image_ctx.image_lock};
+    update_dirty_map(false);
+  }
+
+  remove_map();
+}
+
+void SnapshotRemoveRequest::invalidate_next_dirty_map() {
+  CephContext *cct = m_image_ctx.cct;
+  std::string oid(ObjectMap<>::dirty_map_name(m_image_ctx.id, m_next_snap_id));
+  ldout(cct, 5) << "oid=" << oid << dendl;
+
+  librados::ObjectWriteOperation op;
+  {
+    std::shared_lock image_locker{m_image_ctx.image_lock};
+    if (update_dirty_map(true)) {
+      std::shared_lock object_map_locker{*m_object_map_lock};
+      cls_client::object_map_save(&op, *m_dirty_map);
+    } else {
+      // reinitialized from the object map when next tracked
+      op.remove();
+    }
+  }
+
+  auto rados_completion = librbd::util::create_rados_callback<
+    SnapshotRemoveRequest,
+    &SnapshotRemoveRequest::handle_invalidate_next_dirty_map>(this);
+  int r = m_image_ctx.md_ctx.aio_operate(oid, rados_completion, &op);
+  ceph_assert(r == 0);
+  rados_completion->release();
+}
+
+void SnapshotRemoveRequest::handle_invalidate_next_dirty_map(int r) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 5) << "r=" << r << dendl;
+
+  if (r < 0 && r != -ENOENT) {
+    std::string oid(ObjectMap<>::dirty_map_name(m_image_ctx.id,
+                                                m_next_snap_id));
+    lderr(cct) << "failed to invalidate dirty map " << oid << ": "
+               << cpp_strerror(r) << dendl;
+  }
+
+  remove_map();
+}
+
+void SnapshotRemoveRequest::remove_dirty_map() {
+  if (!m_dirty_tracking) {
+    complete(0);
+    return;
+  }
+
+  CephContext *cct = m_image_ctx.cct;
+  std::string oid(ObjectMap<>::dirty_map_name(m_image_ctx.id, m_snap_id));
+  ldout(cct, 5) << "oid=" << oid << dendl;
+
+  librados::ObjectWriteOperation op;
+  op.remove();
+
+  auto rados_completion = librbd::util::create_rados_callback<
+    SnapshotRemoveRequest,
+    &SnapshotRemoveRequest::handle_remove_dirty_map>(this);
+  int r = m_image_ctx.md_ctx.aio_operate(oid, rados_completion, &op);
+  ceph_assert(r == 0);
+  rados_completion->release();
+}
+
+void SnapshotRemoveRequest::handle_remove_dirty_map(int r) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 5) << "r=" << r << dendl;
+
+  if (r < 0 && r != -ENOENT) {
+    // a leftover dirty map is never consulted
+    std::string oid(ObjectMap<>::dirty_map_name(m_image_ctx.id, m_snap_id));
+    lderr(cct) << "failed to remove dirty map " << oid << ": "
+               << cpp_strerror(r) << dendl;
+  }
+
   complete(0);
 }
 
@@ -223,5 +373,33 @@ void SnapshotRemoveRequest::update_object_map() {
   }
 }
 
+bool SnapshotRemoveRequest::update_dirty_map(bool all) {
+  assert(ceph_mutex_is_locked(m_image_ctx.image_lock));
+  std::unique_lock object_map_locker{*m_object_map_lock};
+  if (m_next_snap_id != m_image_ctx.snap_id ||
+      m_next_snap_id != CEPH_NOSNAP || m_dirty_map->size() == 0) {
+    return false;
+  }
+
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 5) << "all=" << all << dendl;
+
+  auto it = m_dirty_map->begin();
+  auto end_it = m_dirty_map->end();
+  auto snap_it = m_snap_dirty_map.begin();
+  uint64_t i = 0;
+  for (; it != end_it; ++it) {
+    if (*it == OBJECT_EXISTS_CLEAN &&
+        (all || i >= m_snap_dirty_map.size() || *snap_it == OBJECT_EXISTS)) {
+      *it = OBJECT_EXISTS;
+    }
+    if (i < m_snap_dirty_map.size()) {
+      ++snap_it;
+    }
+    ++i;
+  }
+  return true;
+}
+
 } // namespace object_map
 } // namespace librbd
@@ -26,8 +26,21 @@ public:
    *    . . . > STATE_INVALIDATE_NEXT_MAP    |
    *    .                      |             |
    *    .                      |             |
-   *    . (fast diff disabled) v             v
-   *    . . . . . . . . . . > STATE_REMOVE_MAP
+   *    .                      |             |
+   *    .                      |             v
+   *    .                      |   STATE_LOAD_DIRTY_MAP
+   *    .                      |             |
+   *    .                      |             v     (error)
+   *    .                      |   STATE_MERGE_DIRTY_MAP * * *
+   *    .                      |             |               *
+   *    .                      |             |               v
+   *    .                      |             |   STATE_INVALIDATE_NEXT_DIRTY_MAP
+   *    .                      |             |               |
+   *    . (fast diff disabled) v             v               |
+   *    . . . . . . . . . . > STATE_REMOVE_MAP <-------------/
+   *                                 |
+   *                                 v
+   *                         STATE_REMOVE_DIRTY_MAP
    *                                 |
    *                                 v
    *                             <finish>
@@ -38,14 +51,21 @@ public:
    * If the fast diff feature is enabled and the snapshot is flagged as
    * invalid, the next snapshot / HEAD object mapis flagged as invalid;
    * otherwise, the state machine proceeds to remove the object map.
+   *
+   * The _DIRTY_MAP states are skipped unless sub-object dirty tracking is
+   * enabled. The dirty blocks of the removed snapshot are folded into the
+   * next snapshot / HEAD; if that fails, every block of the next dirty map
+   * is considered dirty.
    */
 
   SnapshotRemoveRequest(ImageCtx &image_ctx, ceph::shared_mutex* object_map_lock,
-                        ceph::BitVector<2> *object_map, uint64_t snap_id,
+                        ceph::BitVector<2> *object_map,
+                        ceph::BitVector<2> *dirty_map, uint64_t snap_id,
                         Context *on_finish)
     : AsyncRequest(image_ctx, on_finish),
       m_object_map_lock(object_map_lock), m_object_map(*object_map),
-      m_snap_id(snap_id), m_next_snap_id(CEPH_NOSNAP) {
+      m_dirty_map(dirty_map), m_snap_id(snap_id),
+      m_next_snap_id(CEPH_NOSNAP) {
   }
 
   void send() override;
@@ -58,12 +78,15 @@ protected:
 private:
   ceph::shared_mutex* m_object_map_lock;
   ceph::BitVector<2> &m_object_map;
+  ceph::BitVector<2> *m_dirty_map;
   uint64_t m_snap_id;
   uint64_t m_next_snap_id;
 
   uint64_t m_flags = 0;
+  bool m_dirty_tracking = false;
 
   ceph::BitVector<2> m_snap_object_map;
+  ceph::BitVector<2> m_snap_dirty_map;
   bufferlist m_out_bl;
 
   void load_map();
@@ -78,8 +101,21 @@ private:
   void remove_map();
   void handle_remove_map(int r);
 
+  void load_dirty_map();
+  void handle_load_dirty_map(int r);
+
+  void merge_dirty_map();
+  void handle_merge_dirty_map(int r);
+
+  void invalidate_next_dirty_map();
+  void handle_invalidate_next_dirty_map(int r);
+
+  void remove_dirty_map();
+  void handle_remove_dirty_map(int r);
+
   void compute_next_snap_id();
   void update_object_map();
+  bool update_dirty_map(bool all);
 };
 
 } // namespace object_map
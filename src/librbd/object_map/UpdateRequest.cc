@@ -5,6 +5,7 @@
 #include "include/rbd/object_map_types.h"
 #include "include/stringify.h"
 #include "common/dout.h"
+#include "common/errno.h"
 #include "librbd/ImageCtx.h"
 #include "librbd/ObjectMap.h"
 #include "librbd/Utils.h"
@@ -28,7 +29,11 @@ const uint64_t MAX_OBJECTS_PER_UPDATE = 256 * (1 << 10);
 
 template <typename I>
 void UpdateRequest<I>::send() {
-  update_object_map();
+  if (m_start_object_no < m_end_object_no) {
+    update_object_map();
+  } else {
+    update_dirty_map();
+  }
 }
 
 template <typename I>
@@ -91,6 +96,13 @@ void UpdateRequest<I>::handle_update_object_map(int r) {
     }
   }
 
+  if (m_ret_val == 0 && m_update_start_block < m_end_block) {
+    std::shared_lock image_locker{m_image_ctx.image_lock};
+    std::unique_lock object_map_locker{*m_object_map_lock};
+    update_dirty_map();
+    return;
+  }
+
   // no more batch updates to send
   complete(m_ret_val);
 }
@@ -119,6 +131,82 @@ void UpdateRequest<I>::update_in_memory_object_map() {
   }
 }
 
+template <typename I>
+void UpdateRequest<I>::update_dirty_map() {
+  ceph_assert(ceph_mutex_is_locked(m_image_ctx.image_lock));
+  ceph_assert(ceph_mutex_is_locked(*m_object_map_lock));
+  ceph_assert(m_update_start_block < m_end_block);
+  CephContext *cct = m_image_ctx.cct;
+
+  m_update_end_block = std::min(
+    m_end_block, m_update_start_block + MAX_OBJECTS_PER_UPDATE);
+
+  std::string oid(ObjectMap<>::dirty_map_name(m_image_ctx.id, m_snap_id));
+  ldout(cct, 20) << "ictx=" << &m_image_ctx << ", oid=" << oid << ", "
+                 << "[" << m_update_start_block << ","
+                        << m_update_end_block << ")" << dendl;
+
+  // the dirty map is only maintained while holding the object map lock,
+  // which is asserted by the object map update
+  librados::ObjectWriteOperation op;
+  cls_client::object_map_update(&op, m_update_start_block, m_update_end_block,
+                                OBJECT_EXISTS, boost::none);
+
+  auto rados_completion = librbd::util::create_rados_callback<
+    UpdateRequest<I>, &UpdateRequest<I>::handle_update_dirty_map>(this);
+  std::vector<librados::snap_t> snaps;
+  int r = m_image_ctx.md_ctx.aio_operate(
+    oid, rados_completion, &op, 0, snaps,
+    (m_trace.valid() ? m_trace.get_info() : nullptr));
+  ceph_assert(r == 0);
+  rados_completion->release();
+}
+
+template <typename I>
+void UpdateRequest<I>::handle_update_dirty_map(int r) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 20) << "r=" << r << dendl;
+
+  if (m_snap_id != CEPH_NOSNAP && (r == -ENOENT || r == -ERANGE)) {
+    // snapshot predates dirty tracking (or the last resize)
+    complete(m_ret_val);
+    return;
+  } else if (r < 0) {
+    lderr(cct) << "failed to update dirty map: " << cpp_strerror(r) << dendl;
+    complete(r);
+    return;
+  }
+
+  {
+    std::shared_lock image_locker{m_image_ctx.image_lock};
+    std::unique_lock object_map_locker{*m_object_map_lock};
+    update_in_memory_dirty_map();
+
+    if (m_update_end_block < m_end_block) {
+      m_update_start_block = m_update_end_block;
+      update_dirty_map();
+      return;
+    }
+  }
+
+  complete(m_ret_val);
+}
+
+template <typename I>
+void UpdateRequest<I>::update_in_memory_dirty_map() {
+  ceph_assert(ceph_mutex_is_locked(*m_object_map_lock));
+
+  if (m_snap_id == m_image_ctx.snap_id && m_dirty_map != nullptr) {
+    auto it = m_dirty_map->begin() +
+      std::min(m_update_start_block, m_dirty_map->size());
+    auto end_it = m_dirty_map->begin() +
+      std::min(m_update_end_block, m_dirty_map->size());
+    for (; it != end_it; ++it) {
+      *it = OBJECT_EXISTS;
+    }
+  }
+}
+
 template <typename I>
 void UpdateRequest<I>::finish_request() {
 }
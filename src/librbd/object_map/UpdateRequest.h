@@ -25,28 +25,35 @@ public:
   static UpdateRequest *create(ImageCtx &image_ctx,
                                ceph::shared_mutex* object_map_lock,
                                ceph::BitVector<2> *object_map,
+                               ceph::BitVector<2> *dirty_map,
                                uint64_t snap_id, uint64_t start_object_no,
-                               uint64_t end_object_no, uint8_t new_state,
+                               uint64_t end_object_no, uint64_t start_block,
+                               uint64_t end_block, uint8_t new_state,
                                const boost::optional<uint8_t> &current_state,
                                const ZTracer::Trace &parent_trace,
                                bool ignore_enoent, Context *on_finish) {
-    return new UpdateRequest(image_ctx, object_map_lock, object_map, snap_id,
-                             start_object_no, end_object_no, new_state,
+    return new UpdateRequest(image_ctx, object_map_lock, object_map,
+                             dirty_map, snap_id, start_object_no,
+                             end_object_no, start_block, end_block, new_state,
                              current_state, parent_trace, ignore_enoent,
                              on_finish);
   }
 
   UpdateRequest(ImageCtx &image_ctx, ceph::shared_mutex* object_map_lock,
-                ceph::BitVector<2> *object_map, uint64_t snap_id,
+                ceph::BitVector<2> *object_map,
+                ceph::BitVector<2> *dirty_map, uint64_t snap_id,
                 uint64_t start_object_no, uint64_t end_object_no,
-                uint8_t new_state,
+                uint64_t start_block, uint64_t end_block, uint8_t new_state,
                 const boost::optional<uint8_t> &current_state,
       	        const ZTracer::Trace &parent_trace, bool ignore_enoent,
                 Context *on_finish)
     : Request(image_ctx, snap_id, on_finish),
       m_object_map_lock(object_map_lock), m_object_map(*object_map),
+      m_dirty_map(dirty_map),
       m_start_object_no(start_object_no), m_end_object_no(end_object_no),
-      m_update_start_object_no(start_object_no), m_new_state(new_state),
+      m_update_start_object_no(start_object_no),
+      m_end_block(end_block), m_update_start_block(start_block),
+      m_new_state(new_state),
       m_current_state(current_state),
       m_trace(util::create_trace(image_ctx, "update object map", parent_trace)),
       m_ignore_enoent(ignore_enoent)
@@ -72,18 +79,29 @@ private:
    *    v                   | (repeat in batches)
    * UPDATE_OBJECT_MAP -----/
    *    |
+   *    |/------------------\
+   *    v                   | (repeat in batches)
+   * UPDATE_DIRTY_MAP ------/
+   *    |
    *    v
    * <finish>
    *
    * @endverbatim
+   *
+   * UPDATE_OBJECT_MAP is skipped for an empty object range and
+   * UPDATE_DIRTY_MAP for an empty block range.
    */
 
   ceph::shared_mutex* m_object_map_lock;
   ceph::BitVector<2> &m_object_map;
+  ceph::BitVector<2> *m_dirty_map;
   uint64_t m_start_object_no;
   uint64_t m_end_object_no;
   uint64_t m_update_start_object_no;
   uint64_t m_update_end_object_no = 0;
+  uint64_t m_end_block;
+  uint64_t m_update_start_block;
+  uint64_t m_update_end_block = 0;
   uint8_t m_new_state;
   boost::optional<uint8_t> m_current_state;
   ZTracer::Trace m_trace;
@@ -96,6 +114,11 @@ private:
 
   void update_in_memory_object_map();
 
+  void update_dirty_map();
+  void handle_update_dirty_map(int r);
+
+  void update_in_memory_dirty_map();
+
 };
 
 } // namespace object_map
@@ -0,0 +1,206 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#ifndef CEPH_MDS_BALANCERCOSTMODEL_H
+#define CEPH_MDS_BALANCERCOSTMODEL_H
+
+#include <cstdint>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "common/config_proxy.h"
+
+/**
+ * Cost model behind the measured-cost balancer (mds_bal_mode = 3).
+ *
+ * Load is expressed in milliseconds of MDS time: the time a request
+ * spent in Server::dispatch_client_request, plus fixed charges per
+ * request and per KiB journaled.  A migration is only worth making if
+ * the subtree carries more load than it costs to move, and a subtree
+ * that was imported recently is left where it is for a while so that
+ * it does not bounce between ranks.
+ *
+ * The search for subtrees to export, choose_exports(), is shared with
+ * MDBalancer::find_exports for all balancer modes.
+ *
+ * This is kept free of MDS state so that cephfs-balancer-sim applies
+ * exactly the same policy when replaying dumped load histories.
+ */
+struct BalancerCostModel {
+  double request_cost = 0;
+  double journal_kb_cost = 0;
+  double migration_cost = 0;
+  double migration_dentry_cost = 0;
+  double min_residency = 0;
+  int64_t overload_epochs = 0;
+
+  // find_exports search, as fractions of the load still needed
+  double min_start = 0;
+  double need_min = 0;
+  double need_max = 0;
+  double midchunk = 0;
+  double minchunk = 0;
+
+  // imports are worth exporting back before looking for anything else
+  static constexpr double MIN_REEXPORT = 5;
+  // once less than this is still to be exported, stop looking
+  static constexpr double MIN_OFFLOAD = 10;
+
+  /// a subtree choose_exports() may take
+  template<typename D>
+  struct ExportCandidate {
+    double load;
+    D dir;
+    bool replicated;
+  };
+
+  static const std::set<std::string>& get_tracked_keys() {
+    static const std::set<std::string> keys = {
+      "mds_bal_cost_request",
+      "mds_bal_cost_journal_kb",
+      "mds_bal_migration_cost",
+      "mds_bal_migration_cost_per_dentry",
+      "mds_bal_min_residency",
+      "mds_bal_overload_epochs",
+      "mds_bal_min_start",
+      "mds_bal_need_min",
+      "mds_bal_need_max",
+      "mds_bal_midchunk",
+      "mds_bal_minchunk",
+    };
+    return keys;
+  }
+
+  void update(const ConfigProxy& conf) {
+    request_cost = conf.get_val<double>("mds_bal_cost_request");
+    journal_kb_cost = conf.get_val<double>("mds_bal_cost_journal_kb");
+    migration_cost = conf.get_val<double>("mds_bal_migration_cost");
+    migration_dentry_cost =
+      conf.get_val<double>("mds_bal_migration_cost_per_dentry");
+    min_residency = conf.get_val<double>("mds_bal_min_residency");
+    overload_epochs = conf.get_val<int64_t>("mds_bal_overload_epochs");
+    min_start = conf.get_val<double>("mds_bal_min_start");
+    need_min = conf.get_val<double>("mds_bal_need_min");
+    need_max = conf.get_val<double>("mds_bal_need_max");
+    midchunk = conf.get_val<double>("mds_bal_midchunk");
+    minchunk = conf.get_val<double>("mds_bal_minchunk");
+  }
+
+  /// load charged for a request that spent dispatch_secs being dispatched
+  double get_request_cost(double dispatch_secs) const {
+    return request_cost + dispatch_secs * 1000.0;
+  }
+  /// load charged for a journaled event
+  double get_journal_cost(uint64_t bytes) const {
+    return journal_kb_cost * bytes / 1024.0;
+  }
+
+  /// cost of migrating a subtree whose root dirfrag has this many dentries
+  double get_migration_cost(uint64_t dentries) const {
+    return migration_cost + migration_dentry_cost * dentries;
+  }
+  bool worth_migrating(double load, uint64_t dentries) const {
+    return load > get_migration_cost(dentries);
+  }
+
+  /// true if a subtree imported age seconds ago may be exported again
+  bool may_reexport(double age) const {
+    return age >= min_residency;
+  }
+
+  /// true if a rank last seen underloaded at epoch last_under has been
+  /// overloaded long enough to start exporting
+  bool overloaded_long_enough(int last_under, int epoch) const {
+    return !(last_under && epoch - last_under < overload_epochs);
+  }
+
+  /// false once enough of amount has been found to stop searching
+  bool wants_exports(double amount, double have) const {
+    return amount - have >= amount * min_start;
+  }
+  /// subtrees with less load than this are not worth considering
+  double get_minchunk(double amount, double have) const {
+    return (amount - have) * minchunk;
+  }
+
+  /**
+   * Choose among the subtrees found under one directory, in the order
+   * they were found, towards exporting amount, of which have is already
+   * chosen.  A subtree that needs no more searching wins outright;
+   * otherwise the biggest of the smaller subtrees are taken, then the
+   * bigger unreplicated subtrees are searched, then the remaining
+   * smaller subtrees are taken, and finally the bigger replicated ones
+   * are searched.  take(dir, load) is called for each subtree chosen,
+   * and descend(dir) to search one, which is expected to recurse with
+   * the same amount and have.
+   */
+  template<typename D, typename Take, typename Descend>
+  void choose_exports(double amount, double &have,
+		      const std::vector<ExportCandidate<D>> &candidates,
+		      Take &&take, Descend &&descend) const {
+    double need = amount - have;
+    double needmax = need * need_max;
+    double needmin = need * need_min;
+    double mid = need * midchunk;
+
+    std::vector<D> bigger_rep, bigger_unrep;
+    std::multimap<double, D> smaller;
+    for (const auto &c : candidates) {
+      if (c.load > needmin && c.load < needmax) {
+	take(c.dir, c.load);
+	have += c.load;
+	return;
+      }
+      if (c.load > need) {
+	if (c.replicated)
+	  bigger_rep.push_back(c.dir);
+	else
+	  bigger_unrep.push_back(c.dir);
+      } else {
+	smaller.emplace(c.load, c.dir);
+      }
+    }
+
+    // grab some sufficiently big small items
+    auto it = smaller.rbegin();
+    for (; it != smaller.rend() && it->first >= mid; ++it) {
+      take(it->second, it->first);
+      have += it->first;
+      if (have > needmin)
+	return;
+    }
+
+    for (const auto &dir : bigger_unrep) {
+      descend(dir);
+      if (have > needmin)
+	return;
+    }
+
+    // ok fine, use smaller bits
+    for (; it != smaller.rend(); ++it) {
+      take(it->second, it->first);
+      have += it->first;
+      if (have > needmin)
+	return;
+    }
+
+    for (const auto &dir : bigger_rep) {
+      descend(dir);
+      if (have > needmin)
+	return;
+    }
+  }
+};
+
+#endif
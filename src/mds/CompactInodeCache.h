@@ -0,0 +1,126 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#ifndef CEPH_MDS_COMPACTINODECACHE_H
+#define CEPH_MDS_COMPACTINODECACHE_H
+
+#include <string_view>
+#include <vector>
+
+#include "include/mempool.h"
+#include "mdstypes.h"
+
+/**
+ * Second tier of the MDS cache: where clean inodes were linked before
+ * they were trimmed.
+ *
+ * Each entry keeps only the inode number, its parent directory and its
+ * dentry name, a few dozen bytes against the kilobytes a CInode and
+ * CDentry take.  MDCache::open_ino() uses the entries as ancestors so
+ * that an inode which fell out of the cache can be found again by
+ * fetching its directories, without first reading its backtrace from
+ * the data pool.  Entries are only hints: a rename or unlink of a
+ * trimmed inode by another rank goes unnoticed here, and the
+ * traversal falls back to the backtrace when the hint is wrong.
+ *
+ * Entries are allocated from the mds_co mempool so they count against
+ * mds_cache_memory_limit like the rest of the cache.  The oldest are
+ * dropped first once they would use more than max_bytes.
+ */
+class CompactInodeCache {
+public:
+  /// rough footprint of an entry, besides its name
+  static constexpr uint64_t ENTRY_OVERHEAD = 96;
+  /// give up following parents after this many levels
+  static constexpr unsigned MAX_DEPTH = 64;
+
+  void set_max_bytes(uint64_t b) {
+    max_bytes = b;
+    trim();
+  }
+  uint64_t get_bytes() const { return bytes; }
+  size_t size() const { return entries.size(); }
+
+  void add(inodeno_t ino, inodeno_t dirino, std::string_view dname) {
+    if (max_bytes == 0)
+      return;
+    remove(ino);
+    order.push_back(ino);
+    auto& e = entries[ino];
+    e.dirino = dirino;
+    e.dname = dname;
+    e.pos = std::prev(order.end());
+    bytes += ENTRY_OVERHEAD + dname.size();
+    trim();
+  }
+
+  void remove(inodeno_t ino) {
+    auto it = entries.find(ino);
+    if (it == entries.end())
+      return;
+    bytes -= ENTRY_OVERHEAD + it->second.dname.size();
+    order.erase(it->second.pos);
+    entries.erase(it);
+  }
+
+  void clear() {
+    entries.clear();
+    order.clear();
+    bytes = 0;
+  }
+
+  /**
+   * Build the ancestors of ino, nearest first, the way a backtrace
+   * lists them.  The walk stops at the first directory for which
+   * is_cached(dirino) returns true, or at the first one that has no
+   * entry of its own.
+   *
+   * @return false if there is no entry for ino
+   */
+  template<typename F>
+  bool get_ancestors(inodeno_t ino, std::vector<inode_backpointer_t>& ancestors,
+		     F&& is_cached) const {
+    ancestors.clear();
+    for (unsigned depth = 0; depth < MAX_DEPTH; depth++) {
+      auto it = entries.find(ino);
+      if (it == entries.end())
+	break;
+      const auto& e = it->second;
+      ancestors.emplace_back(e.dirino, e.dname, 0);
+      if (is_cached(e.dirino))
+	break;
+      ino = e.dirino;
+    }
+    return !ancestors.empty();
+  }
+
+private:
+  typedef mempool::mds_co::list<inodeno_t> order_t;
+
+  struct entry_t {
+    inodeno_t dirino;
+    mempool::mds_co::string dname;
+    order_t::iterator pos;
+  };
+
+  void trim() {
+    while (bytes > max_bytes && !order.empty())
+      remove(order.front());
+  }
+
+  mempool::mds_co::unordered_map<inodeno_t, entry_t> entries;
+  order_t order;  ///< oldest first
+  uint64_t bytes = 0;
+  uint64_t max_bytes = 0;
+};
+
+#endif
@@ -55,8 +55,8 @@ using std::chrono::duration_cast;
 
 
 #define MIN_LOAD    50   //  ??
-#define MIN_REEXPORT 5  // will automatically reexport
-#define MIN_OFFLOAD 10   // point at which i stop trying, close enough
+#define MIN_REEXPORT BalancerCostModel::MIN_REEXPORT  // will automatically reexport
+#define MIN_OFFLOAD BalancerCostModel::MIN_OFFLOAD    // point at which i stop trying, close enough
 
 
 int MDBalancer::proc_message(const cref_t<Message> &m)
@@ -80,6 +80,7 @@ MDBalancer::MDBalancer(MDSRank *m, Messenger *msgr, MonClient *monc) :
 {
   bal_fragment_dirs = g_conf().get_val<bool>("mds_bal_fragment_dirs");
   bal_fragment_interval = g_conf().get_val<int64_t>("mds_bal_fragment_interval");
+  cost_model.update(g_conf());
 }
 
 void MDBalancer::handle_conf_change(const std::set<std::string>& changed, const MDSMap& mds_map)
@@ -88,6 +89,12 @@ void MDBalancer::handle_conf_change(const std::set<std::string>& changed, const
     bal_fragment_dirs = g_conf().get_val<bool>("mds_bal_fragment_dirs");
   if (changed.count("mds_bal_fragment_interval"))
     bal_fragment_interval = g_conf().get_val<int64_t>("mds_bal_fragment_interval");
+  for (const auto& key : BalancerCostModel::get_tracked_keys()) {
+    if (changed.count(key)) {
+      cost_model.update(g_conf());
+      break;
+    }
+  }
 }
 
 void MDBalancer::handle_export_pins(void)
@@ -241,11 +248,39 @@ double mds_load_t::mds_load() const
   case 2:
     return cpu_load_avg;
 
+  case 3:
+    return auth.cost_load();
+
   }
   ceph_abort();
   return 0;
 }
 
+double MDBalancer::get_subtree_load(const dirfrag_load_vec_t& pop) const
+{
+  if (g_conf()->mds_bal_mode == 3)
+    return pop.cost_load();
+  return pop.meta_load();
+}
+
+bool MDBalancer::may_export(CDir *dir, double pop) const
+{
+  if (g_conf()->mds_bal_mode != 3)
+    return true;
+
+  if (import_stamps.count(dir->dirfrag())) {
+    dout(15) << "  recently imported " << *dir << ", leaving it" << dendl;
+    return false;
+  }
+  if (!cost_model.worth_migrating(pop, dir->get_num_any())) {
+    dout(15) << "  load " << pop << " does not cover migration cost "
+	     << cost_model.get_migration_cost(dir->get_num_any())
+	     << " of " << *dir << dendl;
+    return false;
+  }
+  return true;
+}
+
 mds_load_t MDBalancer::get_load()
 {
   auto now = clock::now();
@@ -390,7 +425,7 @@ void MDBalancer::send_heartbeat()
     mds_rank_t from = im->inode->authority().first;
     if (from == mds->get_nodeid()) continue;
     if (im->get_inode()->is_stray()) continue;
-    import_map[from] += im->pop_auth_subtree.meta_load();
+    import_map[from] += get_subtree_load(im->pop_auth_subtree);
   }
   mds_import_map[ mds->get_nodeid() ] = import_map;
 
@@ -646,7 +681,7 @@ void MDBalancer::prep_rebalance(int beat)
     double load_fac = 1.0;
     map<mds_rank_t, mds_load_t>::iterator m = mds_load.find(whoami);
     if ((m != mds_load.end()) && (m->second.mds_load() > 0)) {
-      double metald = m->second.auth.meta_load();
+      double metald = get_subtree_load(m->second.auth);
       double mdsld = m->second.mds_load();
       load_fac = metald / mdsld;
       dout(7) << " load_fac is " << load_fac
@@ -698,7 +733,7 @@ void MDBalancer::prep_rebalance(int beat)
       return;
     }
     // am i over long enough?
-    if (last_epoch_under && beat_epoch - last_epoch_under < 2) {
+    if (!cost_model.overloaded_long_enough(last_epoch_under, beat_epoch)) {
       dout(5) << "  i am overloaded, but only for " << (beat_epoch - last_epoch_under) << " epochs" << dendl;
       return;
     }
@@ -721,7 +756,7 @@ void MDBalancer::prep_rebalance(int beat)
 	importer_set.insert(it->second);
       } else {
 	int mds_last_epoch_under = mds_last_epoch_under_map[it->second];
-	if (!(mds_last_epoch_under && beat_epoch - mds_last_epoch_under < 2)) {
+	if (cost_model.overloaded_long_enough(mds_last_epoch_under, beat_epoch)) {
 	  dout(15) << "   mds." << it->second << " is exporter" << dendl;
 	  exporters.insert(pair<double,mds_rank_t>(it->first,it->second));
 	  exporter_set.insert(it->second);
@@ -847,6 +882,16 @@ void MDBalancer::try_rebalance(balance_state_t& state)
     return;
   }
 
+  // forget imports that have settled
+  auto now = clock::now();
+  for (auto p = import_stamps.begin(); p != import_stamps.end(); ) {
+    double age = std::chrono::duration<double>(now - p->second).count();
+    if (cost_model.may_reexport(age))
+      import_stamps.erase(p++);
+    else
+      ++p;
+  }
+
   // make a sorted list of my imports
   multimap<double, CDir*> import_pop_map;
   multimap<mds_rank_t, pair<CDir*, double> > import_from_map;
@@ -860,8 +905,13 @@ void MDBalancer::try_rebalance(balance_state_t& state)
     if (dir->is_freezing() || dir->is_frozen())
       continue;  // export pbly already in progress
 
+    if (g_conf()->mds_bal_mode == 3 && import_stamps.count(dir->dirfrag())) {
+      dout(15) << "  recently imported " << *dir << ", leaving it" << dendl;
+      continue;
+    }
+
     mds_rank_t from = diri->authority().first;
-    double pop = dir->pop_auth_subtree.meta_load();
+    double pop = get_subtree_load(dir->pop_auth_subtree);
     if (g_conf()->mds_bal_idle_threshold > 0 &&
 	pop < g_conf()->mds_bal_idle_threshold &&
 	diri != mds->mdcache->get_root() &&
@@ -912,7 +962,7 @@ void MDBalancer::try_rebalance(balance_state_t& state)
 	  continue;
 	ceph_assert(dir->inode->authority().first == target);  // cuz that's how i put it in the map, dummy
 
-	if (pop <= amount-have) {
+	if (pop <= amount-have && may_export(dir, pop)) {
 	  dout(5) << "reexporting " << *dir << " pop " << pop
 		  << " back to mds." << target << dendl;
 	  mds->mdcache->migrator->export_dir_nicely(dir, target);
@@ -955,7 +1005,7 @@ void MDBalancer::try_rebalance(balance_state_t& state)
       }
 
       double pop = p->first;
-      if (pop <= amount-have && pop > MIN_REEXPORT) {
+      if (pop <= amount-have && pop > MIN_REEXPORT && may_export(dir, pop)) {
 	dout(0) << "reexporting " << *dir << " pop " << pop
 		<< " to mds." << target << dendl;
 	have += pop;
@@ -996,7 +1046,7 @@ void MDBalancer::try_rebalance(balance_state_t& state)
 
     for (const auto& dir : exports) {
       dout(5) << "   - exporting " << dir->pop_auth_subtree
-	      << " " << dir->pop_auth_subtree.meta_load()
+	      << " " << get_subtree_load(dir->pop_auth_subtree)
 	      << " to mds." << target << " " << *dir << dendl;
       mds->mdcache->migrator->export_dir_nicely(dir, target);
     }
@@ -1022,20 +1072,16 @@ void MDBalancer::find_exports(CDir *dir,
 
   ceph_assert(dir->is_auth());
 
-  double need = amount - have;
-  if (need < amount * g_conf()->mds_bal_min_start)
+  if (!cost_model.wants_exports(amount, have))
     return;   // good enough!
 
-  double needmax = need * g_conf()->mds_bal_need_max;
-  double needmin = need * g_conf()->mds_bal_need_min;
-  double midchunk = need * g_conf()->mds_bal_midchunk;
-  double minchunk = need * g_conf()->mds_bal_minchunk;
+  double need = amount - have;
+  double minchunk = cost_model.get_minchunk(amount, have);
 
-  std::vector<CDir*> bigger_rep, bigger_unrep;
-  multimap<double, CDir*> smaller;
+  std::vector<BalancerCostModel::ExportCandidate<CDir*>> candidates;
 
-  double dir_pop = dir->pop_auth_subtree.meta_load();
-  dout(7) << " find_exports in " << dir_pop << " " << *dir << " need " << need << " (" << needmin << " - " << needmax << ")" << dendl;
+  double dir_pop = get_subtree_load(dir->pop_auth_subtree);
+  dout(7) << " find_exports in " << dir_pop << " " << *dir << " need " << need << dendl;
 
   double subdir_sum = 0;
   for (elist<CInode*>::iterator it = dir->pop_lru_subdirs.begin_use_current();
@@ -1060,7 +1106,7 @@ void MDBalancer::find_exports(CDir *dir,
 	continue;  // can't export this right now!
 
       // how popular?
-      double pop = subdir->pop_auth_subtree.meta_load();
+      double pop = get_subtree_load(subdir->pop_auth_subtree);
       subdir_sum += pop;
       dout(15) << "   subdir pop " << pop << " " << *subdir << dendl;
 
@@ -1069,73 +1115,27 @@ void MDBalancer::find_exports(CDir *dir,
 	continue;
       }
 
-      // lucky find?
-      if (pop > needmin && pop < needmax) {
-	exports->push_back(subdir);
-	already_exporting.insert(subdir);
-	have += pop;
-	return;
-      }
+      if (!may_export(subdir, pop))
+	continue;
 
-      if (pop > need) {
-	if (subdir->is_rep())
-	  bigger_rep.push_back(subdir);
-	else
-	  bigger_unrep.push_back(subdir);
-      } else
-	smaller.insert(pair<double,CDir*>(pop, subdir));
+      candidates.push_back({pop, subdir, subdir->is_rep()});
     }
     if (dfls.size() == num_idle_frags)
       in->item_pop_lru.remove_myself();
   }
   dout(15) << "   sum " << subdir_sum << " / " << dir_pop << dendl;
 
-  // grab some sufficiently big small items
-  multimap<double,CDir*>::reverse_iterator it;
-  for (it = smaller.rbegin();
-       it != smaller.rend();
-       ++it) {
-
-    if ((*it).first < midchunk)
-      break;  // try later
-
-    dout(7) << "   taking smaller " << *(*it).second << dendl;
-
-    exports->push_back((*it).second);
-    already_exporting.insert((*it).second);
-    have += (*it).first;
-    if (have > needmin)
-      return;
-  }
-
-  // apprently not enough; drill deeper into the hierarchy (if non-replicated)
-  for (const auto& dir : bigger_unrep) {
-    dout(15) << "   descending into " << *dir << dendl;
-    find_exports(dir, amount, exports, have, already_exporting);
-    if (have > needmin)
-      return;
-  }
-
-  // ok fine, use smaller bits
-  for (;
-       it != smaller.rend();
-       ++it) {
-    dout(7) << "   taking (much) smaller " << it->first << " " << *(*it).second << dendl;
-
-    exports->push_back((*it).second);
-    already_exporting.insert((*it).second);
-    have += (*it).first;
-    if (have > needmin)
-      return;
-  }
-
-  // ok fine, drill into replicated dirs
-  for (const auto& dir : bigger_rep) {
-    dout(7) << "   descending into replicated " << *dir << dendl;
-    find_exports(dir, amount, exports, have, already_exporting);
-    if (have > needmin)
-      return;
-  }
+  cost_model.choose_exports(
+    amount, have, candidates,
+    [&](CDir *subdir, double pop) {
+      dout(7) << "   taking " << pop << " " << *subdir << dendl;
+      exports->push_back(subdir);
+      already_exporting.insert(subdir);
+    },
+    [&](CDir *subdir) {
+      dout(7) << "   descending into " << *subdir << dendl;
+      find_exports(subdir, amount, exports, have, already_exporting);
+    });
 }
 
 void MDBalancer::hit_inode(CInode *in, int type, int who)
@@ -1302,6 +1302,8 @@ void MDBalancer::add_import(CDir *dir)
 {
   dirfrag_load_vec_t subload = dir->pop_auth_subtree;
 
+  import_stamps[dir->dirfrag()] = clock::now();
+
   while (true) {
     dir = dir->inode->get_parent_dir();
     if (!dir) break;
@@ -1360,6 +1362,9 @@ int MDBalancer::dump_loads(Formatter *f) const
   }
 
   f->open_object_section("loads");
+  f->dump_int("rank", mds->get_nodeid());
+  f->dump_int("beat_epoch", beat_epoch);
+  f->dump_float("stamp", (double)ceph_clock_now());
 
   f->open_array_section("dirfrags");
   while (!dfs.empty()) {
@@ -1368,6 +1373,11 @@ int MDBalancer::dump_loads(Formatter *f) const
 
     f->open_object_section("dir");
     dir->dump_load(f);
+    f->dump_bool("is_auth", dir->is_auth());
+    f->dump_bool("is_subtree_root", dir->is_subtree_root());
+    f->dump_unsigned("num_dentries", dir->get_num_any());
+    f->dump_float("meta_load", dir->pop_me.meta_load());
+    f->dump_float("cost_load", dir->pop_me.cost_load());
     f->close_section();
 
     for (auto it = dir->begin(); it != dir->end(); ++it) {
@@ -1377,7 +1387,8 @@ int MDBalancer::dump_loads(Formatter *f) const
 
       auto&& ls = in->get_dirfrags();
       for (const auto& subdir : ls) {
-	if (subdir->pop_nested.meta_load() < .001)
+	if (subdir->pop_nested.meta_load() < .001 &&
+	    subdir->pop_nested.cost_load() < .001)
 	  continue;
 	dfs.push_back(subdir);
       }
@@ -22,6 +22,7 @@
 #include "messages/MHeartbeat.h"
 
 #include "MDSMap.h"
+#include "BalancerCostModel.h"
 
 class MDSRank;
 class MHeartbeat;
@@ -71,6 +72,8 @@ public:
 
   int dump_loads(Formatter *f) const;
 
+  const BalancerCostModel& get_cost_model() const { return cost_model; }
+
 private:
   typedef struct {
     std::map<mds_rank_t, double> targets;
@@ -99,6 +102,17 @@ private:
                    mds_rank_t ex, double& maxex,
                    mds_rank_t im, double& maxim);
 
+  /**
+   * The load of a dirfrag or subtree, in the units the balancer
+   * currently works in (measured cost for mds_bal_mode 3).
+   */
+  double get_subtree_load(const dirfrag_load_vec_t& pop) const;
+  /**
+   * With measured-cost balancing, check that a subtree has stayed put
+   * long enough and is worth the cost of migrating.
+   */
+  bool may_export(CDir *dir, double pop) const;
+
   double get_maxim(balance_state_t &state, mds_rank_t im) {
     return target_load - mds_meta_load[im] - state.imported[im];
   }
@@ -117,6 +131,7 @@ private:
 
   bool bal_fragment_dirs;
   int64_t bal_fragment_interval;
+  BalancerCostModel cost_model;
   static const unsigned int AUTH_TREES_THRESHOLD = 5;
 
   MDSRank *mds;
@@ -141,6 +156,9 @@ private:
   // dirfrags that already have one in flight.
   set<dirfrag_t> split_pending, merge_pending;
 
+  // when subtrees were imported, for mds_bal_min_residency
+  std::map<dirfrag_t, time> import_stamps;
+
   // per-epoch scatter/gathered info
   std::map<mds_rank_t, mds_load_t> mds_load;
   std::map<mds_rank_t, double> mds_meta_load;
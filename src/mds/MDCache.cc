@@ -151,6 +151,9 @@ MDCache::MDCache(MDSRank *m, PurgeQueue &purge_queue_) :
   cache_memory_limit = g_conf().get_val<Option::size_t>("mds_cache_memory_limit");
   cache_reservation = g_conf().get_val<double>("mds_cache_reservation");
   cache_health_threshold = g_conf().get_val<double>("mds_health_cache_threshold");
+  cache_compact_inode_ratio = g_conf().get_val<double>("mds_cache_compact_inode_ratio");
+  cache_trim_time_slice = g_conf().get_val<double>("mds_cache_trim_time_slice");
+  compact_inodes.set_max_bytes(cache_memory_limit*cache_compact_inode_ratio);
 
   lru.lru_set_midpoint(g_conf().get_val<double>("mds_cache_mid"));
 
@@ -164,13 +167,17 @@ MDCache::MDCache(MDSRank *m, PurgeQueue &purge_queue_) :
       auto now = clock::now();
       auto since = now-upkeep_last_trim;
       auto interval = clock::duration(g_conf().get_val<std::chrono::seconds>("mds_cache_trim_interval"));
-      if (since >= interval*.90) {
+      bool due = since >= interval*.90;
+      if (due || upkeep_trim_resume.load()) {
         lock.unlock(); /* mds_lock -> upkeep_mutex */
         std::scoped_lock mds_lock(mds->mds_lock);
         lock.lock();
         if (upkeep_trim_shutdown.load())
           return;
-        if (mds->is_cache_trimmable()) {
+        if (!mds->is_cache_trimmable()) {
+          dout(10) << "cache not ready for trimming" << dendl;
+          upkeep_trim_resume = false;
+        } else if (due) {
           dout(20) << "upkeep thread trimming cache; last trim " << since << " ago" << dendl;
           trim_client_leases();
           trim();
@@ -179,11 +186,19 @@ MDCache::MDCache(MDSRank *m, PurgeQueue &purge_queue_) :
           mds->server->recall_client_state(nullptr, flags);
           upkeep_last_trim = clock::now();
         } else {
-          dout(10) << "cache not ready for trimming" << dendl;
+          dout(20) << "upkeep thread resuming time-sliced trim" << dendl;
+          trim();
         }
-      } else {
+      }
+      if (!due) {
         interval -= since;
       }
+      if (upkeep_trim_resume.load()) {
+        /* give mds_lock back to request dispatch for as long as we held it */
+        auto slice = std::chrono::duration_cast<clock::duration>(
+          std::chrono::duration<double>(g_conf().get_val<double>("mds_cache_trim_time_slice")));
+        interval = std::min(interval, slice);
+      }
       dout(20) << "upkeep thread waiting interval " << interval << dendl;
       upkeep_cvar.wait_for(lock, interval);
     }
@@ -209,6 +224,13 @@ void MDCache::handle_conf_change(const std::set<std::string>& changed, const MDS
     cache_reservation = g_conf().get_val<double>("mds_cache_reservation");
   if (changed.count("mds_health_cache_threshold"))
     cache_health_threshold = g_conf().get_val<double>("mds_health_cache_threshold");
+  if (changed.count("mds_cache_compact_inode_ratio"))
+    cache_compact_inode_ratio = g_conf().get_val<double>("mds_cache_compact_inode_ratio");
+  if (changed.count("mds_cache_memory_limit") ||
+      changed.count("mds_cache_compact_inode_ratio"))
+    compact_inodes.set_max_bytes(cache_memory_limit*cache_compact_inode_ratio);
+  if (changed.count("mds_cache_trim_time_slice"))
+    cache_trim_time_slice = g_conf().get_val<double>("mds_cache_trim_time_slice");
   if (changed.count("mds_cache_mid"))
     lru.lru_set_midpoint(g_conf().get_val<double>("mds_cache_mid"));
   if (changed.count("mds_cache_trim_decay_rate")) {
@@ -266,6 +288,7 @@ void MDCache::add_inode(CInode *in)
     auto &p = inode_map[in->ino()];
     ceph_assert(!p); // should be no dup inos!
     p = in;
+    compact_inodes.remove(in->ino());
   } else {
     auto &p = snap_inode_map[in->vino()];
     ceph_assert(!p); // should be no dup inos!
@@ -6554,9 +6577,20 @@ std::pair<bool, uint64_t> MDCache::trim_lru(uint64_t count, expiremap& expiremap
 
   const uint64_t trim_counter_start = trim_counter.get();
   bool throttled = false;
+
+  // hand mds_lock back to request dispatch after a slice of trimming
+  const auto start = clock::now();
+  const auto slice = std::chrono::duration<double>(cache_trim_time_slice);
+  bool sliced = false;
+  auto out_of_time = [&]() {
+    if (cache_trim_time_slice > 0 && !sliced)
+      sliced = clock::now() - start >= slice;
+    return sliced;
+  };
+
   while (1) {
     throttled |= trim_counter_start+trimmed >= trim_threshold;
-    if (throttled) break;
+    if (throttled || out_of_time()) break;
     CDentry *dn = static_cast<CDentry*>(bottom_lru.lru_expire());
     if (!dn)
       break;
@@ -6574,9 +6608,9 @@ std::pair<bool, uint64_t> MDCache::trim_lru(uint64_t count, expiremap& expiremap
 
   // trim dentries from the LRU until count is reached
   // if mds is in standbyreplay and will trim all inodes which aren't in segments
-  while (!throttled && (cache_toofull() || count > 0 || is_standby_replay)) {
+  while (!throttled && !sliced && (cache_toofull() || count > 0 || is_standby_replay)) {
     throttled |= trim_counter_start+trimmed >= trim_threshold;
-    if (throttled) break;
+    if (throttled || out_of_time()) break;
     CDentry *dn = static_cast<CDentry*>(lru.lru_expire());
     if (!dn) {
       break;
@@ -6601,8 +6635,16 @@ std::pair<bool, uint64_t> MDCache::trim_lru(uint64_t count, expiremap& expiremap
   }
   unexpirables.clear();
 
+  upkeep_trim_resume = sliced && cache_toofull();
+  if (sliced) {
+    dout(7) << "trim_lru used up its " << cache_trim_time_slice
+            << "s time slice" << dendl;
+    if (logger)
+      logger->inc(l_mdc_trim_slices);
+  }
+
   dout(7) << "trim_lru trimmed " << trimmed << " items" << dendl;
-  return std::pair<bool, uint64_t>(throttled, trimmed);
+  return std::pair<bool, uint64_t>(throttled || sliced, trimmed);
 }
 
 /*
@@ -6732,6 +6774,9 @@ std::pair<bool, uint64_t> MDCache::trim(uint64_t count)
   // send any expire messages
   send_expire_messages(expiremap);
 
+  if (logger)
+    logger->set(l_mdc_num_compact_inodes, compact_inodes.size());
+
   return result;
 }
 
@@ -6955,6 +7000,14 @@ bool MDCache::trim_inode(CDentry *dn, CInode *in, CDir *con, expiremap& expirema
     }
   }
   */
+
+  // remember where a clean auth inode lived, so it can be opened
+  // again without its backtrace
+  if (dn && in->is_auth() && in->last == CEPH_NOSNAP) {
+    CInode *diri = dn->get_dir()->get_inode();
+    if (!diri->is_stray() && !diri->is_mdsdir())
+      compact_inodes.add(in->ino(), diri->ino(), dn->get_name());
+  }
     
   // unlink
   if (dn)
@@ -8426,6 +8479,53 @@ void MDCache::open_remote_dirfrag(CInode *diri, frag_t approxfg, MDSContext *fin
 }
 
 
+/**
+ * prefetch_dirfrags -- start fetching the dirfrags that follow a dirfrag
+ *
+ * Listings and scrubs visit the dirfrags of a fragmented directory in
+ * order.  Fetching the next few ahead of time overlaps their omap reads
+ * rather than having each fragment wait for the one before it.
+ *
+ * @param diri base inode
+ * @param fg the dirfrag being visited
+ */
+void MDCache::prefetch_dirfrags(CInode *diri, frag_t fg)
+{
+  uint64_t max = g_conf().get_val<uint64_t>("mds_dir_prefetch_max");
+  if (!max || diri->dirfragtree.is_leaf(frag_t()))
+    return;
+
+  frag_vec_t leaves;
+  diri->dirfragtree.get_leaves(leaves);
+  std::sort(leaves.begin(), leaves.end(),
+	    [](frag_t a, frag_t b) { return a.value() < b.value(); });
+
+  uint64_t ahead = 0;
+  for (const auto& leaf : leaves) {
+    if (leaf.value() <= fg.value())
+      continue;
+    if (ahead++ >= max)
+      break;
+
+    CDir *dir = diri->get_dirfrag(leaf);
+    if (!dir) {
+      if (!diri->is_auth())
+	continue;
+      dir = diri->get_or_open_dirfrag(this, leaf);
+    }
+    if (!dir->is_auth() || dir->is_complete() ||
+	dir->state_test(CDir::STATE_FETCHING) ||
+	dir->is_frozen() || !dir->can_auth_pin())
+      continue;
+
+    dout(10) << __func__ << " " << *dir << dendl;
+    dir->fetch(nullptr);
+    if (mds->logger)
+      mds->logger->inc(l_mds_dir_prefetch);
+  }
+}
+
+
 /** 
  * get_dentry_inode - get or open inode
  *
@@ -8832,6 +8932,8 @@ void MDCache::do_open_ino(inodeno_t ino, open_ino_info_t& info, int err)
     }
     if (err != -ENOENT && err != -ENOTDIR)
       info.last_err = err;
+    // the inode has moved since it was trimmed
+    compact_inodes.remove(ino);
   }
 
   if (info.check_peers || info.discover) {
@@ -9048,6 +9150,14 @@ void MDCache::open_ino(inodeno_t ino, int64_t pool, MDSContext* fin,
       info.fetch_backtrace = false;
       info.checking = mds->get_nodeid();
       _open_ino_traverse_dir(ino, info, 0);
+    } else if (compact_inodes.get_ancestors(ino, info.ancestors,
+		 [this](inodeno_t dirino) { return get_inode(dirino) != nullptr; })) {
+      dout(10) << " trimmed from " << info.ancestors << dendl;
+      if (logger)
+	logger->inc(l_mdc_compact_inode_hits);
+      info.fetch_backtrace = false;
+      info.checking = mds->get_nodeid();
+      _open_ino_traverse_dir(ino, info, 0);
     } else {
       do_open_ino(ino, info, 0);
     }
@@ -12312,6 +12422,11 @@ void MDCache::cache_status(Formatter *f)
   mempool::get_pool(mempool::mds_co::id).dump(f);
   f->close_section();
 
+  f->open_object_section("compact_inodes");
+  f->dump_unsigned("items", compact_inodes.size());
+  f->dump_unsigned("bytes", compact_inodes.get_bytes());
+  f->close_section();
+
   f->close_section();
 }
 
@@ -12970,6 +13085,14 @@ void MDCache::register_perfcounters()
     pcb.add_u64_counter(l_mdc_recovery_started, "recovery_started",
                         "File recoveries started");
 
+    // cache trimming
+    pcb.add_u64(l_mdc_num_compact_inodes, "num_compact_inodes",
+                "Trimmed inodes remembered in compact form");
+    pcb.add_u64_counter(l_mdc_compact_inode_hits, "compact_inode_hits",
+                        "Inodes opened from their compact form");
+    pcb.add_u64_counter(l_mdc_trim_slices, "trim_slices",
+                        "Cache trims stopped by the time slice");
+
     // along with other stray dentries stats
     pcb.add_u64(l_mdc_num_strays_delayed, "num_strays_delayed",
                 "Stray dentries delayed");
@@ -57,6 +57,7 @@
 #include "RecoveryQueue.h"
 #include "StrayManager.h"
 #include "OpenFileTable.h"
+#include "CompactInodeCache.h"
 #include "MDSContext.h"
 #include "MDSMap.h"
 #include "Mutation.h"
@@ -100,6 +101,13 @@ enum {
   // How many inodes ever completed size recovery
   l_mdc_recovery_completed,
 
+  // How many trimmed inodes are remembered in compact form
+  l_mdc_num_compact_inodes,
+  // How many inodes were opened from their compact form
+  l_mdc_compact_inode_hits,
+  // How many trims stopped at mds_cache_trim_time_slice
+  l_mdc_trim_slices,
+
   l_mdss_ireq_enqueue_scrub,
   l_mdss_ireq_exportdir,
   l_mdss_ireq_flush,
@@ -785,6 +793,7 @@ class MDCache {
   CInode *cache_traverse(const filepath& path);
 
   void open_remote_dirfrag(CInode *diri, frag_t fg, MDSContext *fin);
+  void prefetch_dirfrags(CInode *diri, frag_t fg);
   CInode *get_dentry_inode(CDentry *dn, MDRequestRef& mdr, bool projected=false);
 
   bool parallel_fetch(map<inodeno_t,filepath>& pathmap, set<inodeno_t>& missing);
@@ -957,6 +966,7 @@ class MDCache {
   std::set<CInode *> export_pin_delayed_queue;
 
   OpenFileTable open_file_table;
+  CompactInodeCache compact_inodes;
 
  protected:
   // track master requests whose slaves haven't acknowledged commit
@@ -1260,6 +1270,8 @@ class MDCache {
   uint64_t cache_memory_limit;
   double cache_reservation;
   double cache_health_threshold;
+  double cache_compact_inode_ratio;
+  double cache_trim_time_slice;
 
   std::array<CInode *, NUM_STRAY> strays{}; // my stray dir
 
@@ -1287,6 +1299,8 @@ class MDCache {
   ceph::condition_variable upkeep_cvar;
   time upkeep_last_trim = time::min();
   std::atomic<bool> upkeep_trim_shutdown{false};
+  // set when the last trim ran out of time with the cache still too full
+  std::atomic<bool> upkeep_trim_resume{false};
 };
 
 class C_MDS_RetryRequest : public MDSInternalContext {
@@ -404,6 +404,7 @@ void MDLog::_submit_thread()
 	fin = dynamic_cast<MDSLogContextBase*>(data.fin);
 	ceph_assert(fin);
 	fin->set_write_pos(new_write_pos);
+	fin->set_write_len(new_write_pos - write_pos);
       } else {
 	fin = new C_MDL_Flushed(this, new_write_pos);
       }
@@ -125,10 +125,12 @@ class MDSLogContextBase : public MDSIOContextBase
 {
 protected:
   uint64_t write_pos = 0;
+  uint64_t write_len = 0;
 public:
   MDSLogContextBase() = default;
   void complete(int r) final;
   void set_write_pos(uint64_t wp) { write_pos = wp; }
+  void set_write_len(uint64_t len) { write_len = len; }
   virtual void pre_finish(int r) {}
   void print(ostream& out) const override {
     out << "log_event(" << write_pos << ")";
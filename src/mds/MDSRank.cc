@@ -3187,6 +3187,8 @@ void MDSRank::create_logger()
     mds_plb.add_u64(l_mds_root_rsnaps, "root_rsnaps", "root inode rsnaps");
     mds_plb.add_u64_counter(l_mds_dir_fetch, "dir_fetch", "Directory fetch");
     mds_plb.add_u64_counter(l_mds_dir_commit, "dir_commit", "Directory commit");
+    mds_plb.add_u64_counter(l_mds_dir_prefetch, "dir_prefetch",
+                            "Directory fetch ahead of a listing or scrub");
     mds_plb.add_u64_counter(l_mds_dir_split, "dir_split", "Directory split");
     mds_plb.add_u64_counter(l_mds_dir_merge, "dir_merge", "Directory merge");
     mds_plb.add_u64(l_mds_inode_max, "inode_max", "Max inodes, cache size");
@@ -3646,13 +3648,26 @@ const char** MDSRankDispatcher::get_tracked_conf_keys() const
     "clog_to_syslog_level",
     "fsid",
     "host",
+    "mds_bal_cost_journal_kb",
+    "mds_bal_cost_request",
     "mds_bal_fragment_dirs",
     "mds_bal_fragment_interval",
+    "mds_bal_midchunk",
+    "mds_bal_migration_cost",
+    "mds_bal_migration_cost_per_dentry",
+    "mds_bal_min_residency",
+    "mds_bal_min_start",
+    "mds_bal_minchunk",
+    "mds_bal_need_max",
+    "mds_bal_need_min",
+    "mds_bal_overload_epochs",
+    "mds_cache_compact_inode_ratio",
     "mds_cache_memory_limit",
     "mds_cache_mid",
     "mds_cache_reservation",
     "mds_cache_size",
     "mds_cache_trim_decay_rate",
+    "mds_cache_trim_time_slice",
     "mds_cap_revoke_eviction_timeout",
     "mds_dump_cache_threshold_file",
     "mds_dump_cache_threshold_formatter",
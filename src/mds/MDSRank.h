@@ -49,6 +49,7 @@ enum {
   l_mds_forward,
   l_mds_dir_fetch,
   l_mds_dir_commit,
+  l_mds_dir_prefetch,
   l_mds_dir_split,
   l_mds_dir_merge,
   l_mds_inode_max,
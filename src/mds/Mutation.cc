@@ -365,6 +365,15 @@ bool MDRequestImpl::is_batch_op()
      client_request->get_filepath().depth() == 0);
 }
 
+void MDRequestImpl::stop_dispatch_clock()
+{
+  if (dispatch_start == ceph::mono_clock::zero())
+    return;
+  dispatch_secs += std::chrono::duration<double>(
+    ceph::mono_clock::now() - dispatch_start).count();
+  dispatch_start = ceph::mono_clock::zero();
+}
+
 cref_t<MClientRequest> MDRequestImpl::release_client_request()
 {
   msg_lock.lock();
@@ -287,6 +287,11 @@ struct MDRequestImpl : public MutationImpl {
   // indicator for vxattr osdmap update
   bool waited_for_osdmap;
 
+  // measured cost, charged to the balancer when the request completes
+  ceph::mono_time dispatch_start = ceph::mono_clock::zero(); ///< set while in dispatch_client_request
+  double dispatch_secs = 0;
+  uint64_t journal_bytes = 0;
+
   // break rarely-used fields into a separately allocated structure 
   // to save memory for most ops
   struct More {
@@ -402,6 +407,7 @@ struct MDRequestImpl : public MutationImpl {
   void set_filepath2(const filepath& fp);
   bool is_queued_for_replay() const;
   bool is_batch_op();
+  void stop_dispatch_clock();
 
   void print(ostream &out) const override;
   void dump(Formatter *f) const override;
@@ -289,6 +289,7 @@ bool ScrubStack::get_next_cdir(CInode *in, CDir **new_dir)
     // we got a frag to scrub, otherwise it would be ENOENT
     dout(25) << "looking up new frag " << next_frag << dendl;
     CDir *next_dir = in->get_or_open_dirfrag(mdcache, next_frag);
+    mdcache->prefetch_dirfrags(in, next_frag);
     if (!next_dir->is_complete()) {
       scrubs_in_progress++;
       next_dir->fetch(&scrub_kick);
@@ -43,6 +43,7 @@
 
 #include "include/stringify.h"
 #include "include/filepath.h"
+#include "include/scope_guard.h"
 #include "common/errno.h"
 #include "common/Timer.h"
 #include "common/perf_counters.h"
@@ -127,8 +128,10 @@ protected:
 
   MDRequestRef mdr;
   void pre_finish(int r) override {
-    if (mdr)
+    if (mdr) {
       mdr->mark_event("journal_committed: ");
+      mdr->journal_bytes += write_len;
+    }
   }
 public:
   explicit ServerLogContext(Server *s) : server(s) {
@@ -745,6 +748,7 @@ void Server::_session_logged(Session *session, uint64_t state_seq, bool open, ve
     ceph_assert(session->is_closing() || session->is_killing() ||
 	   session->is_opening()); // re-open closing session
     session->info.prealloc_inos.subtract(inos);
+    session->delegated_inos.clear();
     mds->inotable->apply_release_ids(inos);
     ceph_assert(mds->inotable->get_version() == piv);
   }
@@ -1810,6 +1814,8 @@ void Server::submit_mdlog_entry(LogEvent *le, MDSLogContextBase *fin, MDRequestR
 void Server::respond_to_request(MDRequestRef& mdr, int r)
 {
   if (mdr->client_request) {
+    charge_request_cost(mdr);
+
     if (mdr->is_batch_op() && mdr->is_batch_head) {
       int mask = mdr->client_request->head.args.getattr.mask;
 
@@ -1839,6 +1845,32 @@ void Server::respond_to_request(MDRequestRef& mdr, int r)
   }
 }
 
+/*
+ * charge the measured cost of a completed request to the dirfrag it
+ * targeted, for the balancer.
+ */
+void Server::charge_request_cost(MDRequestRef& mdr)
+{
+  mdr->stop_dispatch_clock();
+
+  CDir *dir = nullptr;
+  if (!mdr->dn[0].empty())
+    dir = mdr->dn[0].back()->get_dir();
+  else if (mdr->in[0] && mdr->in[0]->get_parent_dn())
+    dir = mdr->in[0]->get_parent_dn()->get_dir();
+  if (!dir)
+    return;
+
+  const auto& model = mds->balancer->get_cost_model();
+  double cost = model.get_request_cost(mdr->dispatch_secs) +
+		model.get_journal_cost(mdr->journal_bytes);
+  dout(20) << __func__ << " " << cost << " (" << mdr->dispatch_secs << "s, "
+	   << mdr->journal_bytes << " bytes journaled) to " << *dir << dendl;
+  mds->balancer->hit_dir(dir, META_POP_COST, -1, cost);
+  mdr->dispatch_secs = 0;
+  mdr->journal_bytes = 0;
+}
+
 // statistics mds req op number and latency 
 void Server::perf_gather_op_latency(const cref_t<MClientRequest> &req, utime_t lat)
 {
@@ -2409,6 +2441,9 @@ void Server::dispatch_client_request(MDRequestRef& mdr)
 
   const cref_t<MClientRequest> &req = mdr->client_request;
 
+  mdr->dispatch_start = ceph::mono_clock::now();
+  auto stop_clock = make_scope_guard([mdr] { mdr->stop_dispatch_clock(); });
+
   if (logger) logger->inc(l_mdss_dispatch_client_request);
 
   dout(7) << "dispatch_client_request " << *req << dendl;
@@ -3218,10 +3253,12 @@ CInode* Server::prepare_new_inode(MDRequestRef& mdr, CDir *dir, inodeno_t useino
   bool allow_prealloc_inos = !mdr->session->is_opening();
 
   // assign ino
+  inodeno_t prealloc_ino;
   if (allow_prealloc_inos &&
-      mdr->session->info.prealloc_inos.size()) {
-    mdr->used_prealloc_ino = 
-      in->inode.ino = mdr->session->take_ino(useino);  // prealloc -> used
+      mdr->session->info.prealloc_inos.size())
+    prealloc_ino = mdr->session->take_ino(useino);  // prealloc -> used
+  if (prealloc_ino) {
+    mdr->used_prealloc_ino = in->inode.ino = prealloc_ino;
     mds->sessionmap.mark_projected(mdr->session);
 
     dout(10) << "prepare_new_inode used_prealloc " << mdr->used_prealloc_ino
@@ -4195,6 +4232,16 @@ void Server::handle_client_openc(MDRequestRef& mdr)
     return;
   }
 
+  // an async create names one of the inos delegated to the session
+  inodeno_t useino(req->head.ino);
+  if (useino && !req->is_replay() &&
+      !mdr->session->info.prealloc_inos.contains(useino)) {
+    dout(10) << "client asked for ino " << useino
+	     << " that was not preallocated to it" << dendl;
+    respond_to_request(mdr, -EINVAL);
+    return;
+  }
+
   bool excl = req->head.args.open.flags & CEPH_O_EXCL;
 
   if (!excl) {
@@ -4353,6 +4400,16 @@ void Server::handle_client_openc(MDRequestRef& mdr)
     dout(10) << "adding ino to reply to indicate inode was created" << dendl;
     // add the file created flag onto the reply if create_flags features is supported
     encode(in->inode.ino, mdr->reply_extra_bl);
+
+    if (mdr->session->info.has_feature(CEPHFS_FEATURE_DELEG_INO)) {
+      // top up the inos the client may use for async creates
+      interval_set<inodeno_t> delegated;
+      int want = g_conf()->mds_client_prealloc_inos *
+	g_conf().get_val<uint64_t>("mds_client_delegate_inos_pct") / 100;
+      mdr->session->delegate_inos(want, delegated);
+      dout(10) << "delegating " << delegated << " to client" << dendl;
+      encode(delegated, mdr->reply_extra_bl);
+    }
   }
 
   journal_and_reply(mdr, in, dn, le, fin);
@@ -4429,6 +4486,10 @@ void Server::handle_client_readdir(MDRequestRef& mdr)
   dout(10) << "handle_client_readdir on " << *dir << dendl;
   ceph_assert(dir->is_auth());
 
+  // starting on a new frag; get the ones after it loading too
+  if (offset_str.empty())
+    mdcache->prefetch_dirfrags(diri, fg);
+
   if (!dir->is_complete()) {
     if (dir->is_frozen()) {
       dout(7) << "dir is frozen " << *dir << dendl;
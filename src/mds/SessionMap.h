@@ -192,6 +192,7 @@ public:
   size_t get_request_count() const;
 
   interval_set<inodeno_t> pending_prealloc_inos; // journaling prealloc, will be added to prealloc_inos
+  interval_set<inodeno_t> delegated_inos; // prealloc_inos handed to the client for async creates
 
   void notify_cap_release(size_t n_caps);
   uint64_t notify_recall_sent(size_t new_limit);
@@ -217,21 +218,50 @@ public:
     return info.prealloc_inos.range_start();
   }
   inodeno_t take_ino(inodeno_t ino = 0) {
-    ceph_assert(!info.prealloc_inos.empty());
-
     if (ino) {
-      if (info.prealloc_inos.contains(ino))
+      if (info.prealloc_inos.contains(ino)) {
 	info.prealloc_inos.erase(ino);
-      else
+	if (delegated_inos.contains(ino))
+	  delegated_inos.erase(ino);
+      } else {
 	ino = 0;
+      }
     }
     if (!ino) {
-      ino = info.prealloc_inos.range_start();
+      // never hand out an ino the client may be about to use itself
+      interval_set<inodeno_t> avail(info.prealloc_inos);
+      avail.subtract(delegated_inos);
+      if (avail.empty())
+	return 0;
+      ino = avail.range_start();
       info.prealloc_inos.erase(ino);
     }
     info.used_inos.insert(ino, 1);
     return ino;
   }
+  /**
+   * Delegate up to @want of the preallocated inos to the client, which
+   * may then create files with them without waiting for a reply.  At
+   * least half of the free preallocated inos are kept back for creates
+   * that do not name an ino.
+   *
+   * @param inos newly delegated inos
+   */
+  void delegate_inos(int want, interval_set<inodeno_t>& inos) {
+    want -= (int)delegated_inos.size();
+    if (want <= 0)
+      return;
+
+    interval_set<inodeno_t> avail(info.prealloc_inos);
+    avail.subtract(delegated_inos);
+    want = std::min<int>(want, avail.size() / 2);
+    for (auto p = avail.begin(); p != avail.end() && want > 0; ++p) {
+      uint64_t len = std::min<uint64_t>(p.get_len(), want);
+      inos.insert(p.get_start(), len);
+      want -= len;
+    }
+    delegated_inos.insert(inos);
+  }
   int get_num_projected_prealloc_inos() const {
     return info.prealloc_inos.size() + pending_prealloc_inos.size();
   }
@@ -453,6 +483,7 @@ public:
 
   void clear() {
     pending_prealloc_inos.clear();
+    delegated_inos.clear();
     info.clear_meta();
 
     cap_push_seq = 0;
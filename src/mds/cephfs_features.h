@@ -33,6 +33,7 @@
 #define CEPHFS_FEATURE_MULTI_RECONNECT  12
 #define CEPHFS_FEATURE_NAUTILUS         12
 #define CEPHFS_FEATURE_OCTOPUS          13
+#define CEPHFS_FEATURE_DELEG_INO        14
 
 #define CEPHFS_FEATURES_ALL {		\
   0, 1, 2, 3, 4,			\
@@ -46,6 +47,7 @@
   CEPHFS_FEATURE_MULTI_RECONNECT,	\
   CEPHFS_FEATURE_NAUTILUS,              \
   CEPHFS_FEATURE_OCTOPUS,               \
+  CEPHFS_FEATURE_DELEG_INO,             \
 }
 
 #define CEPHFS_FEATURES_MDS_SUPPORTED CEPHFS_FEATURES_ALL
@@ -744,6 +744,7 @@ void dirfrag_load_vec_t::dump(Formatter *f, const DecayRate& rate) const
   f->dump_float("READDIR", get(META_POP_READDIR).get());
   f->dump_float("FETCH", get(META_POP_FETCH).get());
   f->dump_float("STORE", get(META_POP_STORE).get());
+  f->dump_float("COST", get(META_POP_COST).get());
 }
 
 void dirfrag_load_vec_t::generate_test_instances(std::list<dirfrag_load_vec_t*>& ls)
@@ -189,6 +189,8 @@ void Processor::accept()
 	++w->references;
       int r = listen_socket.accept(&cli_socket, opts, &addr, w);
       if (r == 0) {
+	if (msgr->get_stack()->support_incoming_cpu_steering())
+	  w = msgr->get_stack()->steer_worker(w, cli_socket.fd());
 	ldout(msgr->cct, 10) << __func__ << " accepted incoming on sd "
 			     << cli_socket.fd() << dendl;
 
@@ -43,6 +43,8 @@ class PosixNetworkStack : public NetworkStack {
  public:
   explicit PosixNetworkStack(CephContext *c, const string &t);
 
+  bool support_incoming_cpu_steering() const override { return true; }
+
   void spawn_worker(unsigned i, std::function<void ()> &&func) override {
     threads.resize(i+1);
     threads[i] = std::thread(func);
@@ -1169,8 +1169,26 @@ CtPtr ProtocolV2::read_frame_segment() {
   const auto& cur_rx_desc = rx_segments_desc.at(rx_segments_data.size());
   rx_buffer_t rx_buffer;
   try {
-    rx_buffer = buffer::ptr_node::create(buffer::create_aligned(
-      get_onwire_size(cur_rx_desc.length), cur_rx_desc.alignment));
+    if (next_tag == Tag::MESSAGE &&
+        rx_segments_data.size() == SegmentIndex::Msg::DATA &&
+        cur_rx_desc.alignment == segment_t::PAGE_SIZE_ALIGNMENT &&
+        cur_rx_desc.length >= CEPH_PAGE_SIZE &&
+        !session_stream_handlers.rx) {
+      // the header segment has been read (and verified) already, so we
+      // know where the payload will land in the object
+      const auto& hdrbl = rx_segments_data[SegmentIndex::Msg::HEADER];
+      uint16_t data_off = 0;
+      if (hdrbl.length() >= sizeof(ceph_msg_header2)) {
+        ceph_msg_header2 header2;
+        hdrbl.cbegin().copy(sizeof(header2),
+                            reinterpret_cast<char*>(&header2));
+        data_off = header2.data_off;
+      }
+      rx_buffer = alloc_rx_data_buffer(cur_rx_desc.length, data_off);
+    } else {
+      rx_buffer = buffer::ptr_node::create(buffer::create_aligned(
+        get_onwire_size(cur_rx_desc.length), cur_rx_desc.alignment));
+    }
   } catch (std::bad_alloc&) {
     // Catching because of potential issues with satisfying alignment.
     ldout(cct, 20) << __func__ << " can't allocate aligned rx_buffer "
@@ -1183,6 +1201,22 @@ CtPtr ProtocolV2::read_frame_segment() {
   return READ_RXBUF(std::move(rx_buffer), handle_read_frame_segment);
 }
 
+/**
+ * Allocate the receive buffer for a message's data segment, laid out to
+ * match data_off.  Backing buffers are kept in a small per-connection pool,
+ * saving the allocation and page faulting of a fresh multi-megabyte buffer
+ * per op.
+ */
+rx_buffer_t ProtocolV2::alloc_rx_data_buffer(uint32_t len, uint16_t data_off)
+{
+  const auto pool_size =
+    cct->_conf.get_val<uint64_t>("ms_async_rx_buffer_pool_size");
+  auto bp = rx_data_pool.get(len, data_off, pool_size);
+  ldout(cct, 20) << __func__ << " len=" << len << " data_off=" << data_off
+                 << " pool=" << rx_data_pool.size() << dendl;
+  return buffer::ptr_node::create(std::move(bp));
+}
+
 CtPtr ProtocolV2::handle_read_frame_segment(rx_buffer_t &&rx_buffer, int r) {
   ldout(cct, 20) << __func__ << " r=" << r << dendl;
 
@@ -1202,9 +1236,11 @@ CtPtr ProtocolV2::handle_read_frame_segment(rx_buffer_t &&rx_buffer, int r) {
 
     auto& new_seg = rx_segments_data.back();
     if (new_seg.length()) {
-      auto padded = session_stream_handlers.rx->authenticated_decrypt_update(
-          std::move(new_seg), segment_t::DEFAULT_ALIGNMENT);
+      // keep the alignment the sender asked for (page for the data
+      // segment) so the plaintext needs no re-alignment further down
       const auto idx = rx_segments_data.size() - 1;
+      auto padded = session_stream_handlers.rx->authenticated_decrypt_update(
+          std::move(new_seg), rx_segments_desc[idx].alignment);
       new_seg.clear();
       padded.splice(0, rx_segments_desc[idx].length, &new_seg);
 
@@ -15,10 +15,17 @@
  */
 
 #include <mutex>
+#include <map>
+#include <sys/socket.h>
+#if defined(__linux__)
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+#endif
 
 #include "include/compat.h"
 #include "common/Cond.h"
 #include "common/errno.h"
+#include "common/numa.h"
 #include "PosixStack.h"
 #ifdef HAVE_RDMA
 #include "rdma/RDMAStack.h"
@@ -34,6 +41,40 @@
 #undef dout_prefix
 #define dout_prefix *_dout << "stack "
 
+static void bind_worker_thread(CephContext *cct, Worker *w)
+{
+#if defined(__linux__)
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  CPU_SET(w->cpu, &cpu_set);
+  int r = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+  if (r != 0) {
+    lderr(cct) << __func__ << " failed to pin worker " << w->id
+	       << " to cpu " << w->cpu << ": " << cpp_strerror(r) << dendl;
+    return;
+  }
+  ldout(cct, 10) << __func__ << " worker " << w->id << " pinned to cpu "
+		 << w->cpu << " (numa node " << w->numa_node << ")" << dendl;
+
+  // prefer the local node for everything this thread allocates (buffers,
+  // event center state), falling back to other nodes under pressure
+  const int max_node = 1024;
+  if (w->numa_node < 0 || w->numa_node >= max_node ||
+      !cct->_conf.get_val<bool>("ms_async_bind_numa_memory")) {
+    return;
+  }
+  unsigned long mask[max_node / (8 * sizeof(unsigned long))] = {0};
+  mask[w->numa_node / (8 * sizeof(unsigned long))] |=
+    1ul << (w->numa_node % (8 * sizeof(unsigned long)));
+  if (syscall(SYS_set_mempolicy, MPOL_PREFERRED, mask, max_node + 1) < 0) {
+    r = errno;
+    lderr(cct) << __func__ << " failed to bind worker " << w->id
+	       << " memory to numa node " << w->numa_node << ": "
+	       << cpp_strerror(r) << dendl;
+  }
+#endif
+}
+
 std::function<void ()> NetworkStack::add_thread(unsigned worker_id)
 {
   Worker *w = workers[worker_id];
@@ -41,6 +82,9 @@ std::function<void ()> NetworkStack::add_thread(unsigned worker_id)
       char tp_name[16];
       sprintf(tp_name, "msgr-worker-%u", w->id);
       ceph_pthread_setname(pthread_self(), tp_name);
+      if (w->cpu >= 0) {
+	bind_worker_thread(cct, w);
+      }
       const unsigned EventMaxWaitUs = 30000000;
       w->center.set_owner();
       ldout(cct, 10) << __func__ << " starting" << dendl;
@@ -120,6 +164,93 @@ NetworkStack::NetworkStack(CephContext *c, const string &t): type(t), started(fa
     w->center.init(InitEventNumber, worker_id, type);
     workers.push_back(w);
   }
+  init_worker_placement();
+}
+
+void NetworkStack::init_worker_placement()
+{
+#if defined(__linux__)
+  steer_incoming_cpu = cct->_conf.get_val<bool>("ms_async_steer_incoming_cpu");
+  const auto& cores = cct->_conf.get_val<std::string>("ms_async_affinity_cores");
+  int64_t node = cct->_conf.get_val<int64_t>("ms_async_numa_node");
+  if (!steer_incoming_cpu && cores.empty() && node < 0) {
+    return;
+  }
+
+  // numa node ids may be sparse, so probe a fixed range
+  const int max_node = 1024;
+  for (int n = 0; n < max_node; ++n) {
+    size_t cpu_set_size;
+    cpu_set_t cpu_set;
+    if (get_numa_node_cpu_set(n, &cpu_set_size, &cpu_set) < 0) {
+      continue;
+    }
+    for (int cpu : cpu_set_to_set(cpu_set_size, &cpu_set)) {
+      if (cpu >= (int)cpu_numa_node.size()) {
+	cpu_numa_node.resize(cpu + 1, -1);
+      }
+      cpu_numa_node[cpu] = n;
+    }
+  }
+
+  std::set<int> cpus;
+  if (!cores.empty()) {
+    size_t cpu_set_size;
+    cpu_set_t cpu_set;
+    if (parse_cpu_set_list(cores.c_str(), &cpu_set_size, &cpu_set) < 0) {
+      lderr(cct) << __func__ << " unable to parse ms_async_affinity_cores '"
+		 << cores << "', not pinning workers" << dendl;
+      return;
+    }
+    cpus = cpu_set_to_set(cpu_set_size, &cpu_set);
+  }
+  if (node >= 0) {
+    std::set<int> local;
+    for (int cpu : cpus) {
+      if (get_cpu_numa_node(cpu) == node) {
+	local.insert(cpu);
+      }
+    }
+    if (cpus.empty()) {
+      for (unsigned cpu = 0; cpu < cpu_numa_node.size(); ++cpu) {
+	if (cpu_numa_node[cpu] == node) {
+	  local.insert(cpu);
+	}
+      }
+    }
+    if (local.empty()) {
+      lderr(cct) << __func__ << " no usable cpus on numa node " << node
+		 << ", not pinning workers" << dendl;
+      return;
+    }
+    cpus.swap(local);
+  }
+  if (cpus.empty()) {
+    return;
+  }
+
+  // interleave the nodes so that workers (and therefore connections) are
+  // spread evenly over them instead of filling up the first node
+  std::map<int, std::vector<int>> by_node;
+  for (int cpu : cpus) {
+    by_node[get_cpu_numa_node(cpu)].push_back(cpu);
+  }
+  std::vector<int> order;
+  for (size_t i = 0; order.size() < cpus.size(); ++i) {
+    for (auto& p : by_node) {
+      if (i < p.second.size()) {
+	order.push_back(p.second[i]);
+      }
+    }
+  }
+  for (unsigned i = 0; i < num_workers; ++i) {
+    Worker *w = workers[i];
+    w->cpu = order[i % order.size()];
+    w->numa_node = get_cpu_numa_node(w->cpu);
+    ldout(cct, 5) << __func__ << " worker " << i << " -> cpu " << w->cpu
+		  << " numa node " << w->numa_node << dendl;
+  }
+#endif
 }
 
 void NetworkStack::start()
@@ -169,6 +300,36 @@ Worker* NetworkStack::get_worker()
   return current_best;
 }
 
+Worker* NetworkStack::steer_worker(Worker *w, int sd)
+{
+#ifdef SO_INCOMING_CPU
+  if (!steer_incoming_cpu) {
+    return w;
+  }
+  int cpu = -1;
+  socklen_t len = sizeof(cpu);
+  if (::getsockopt(sd, SOL_SOCKET, SO_INCOMING_CPU, &cpu, &len) < 0 ||
+      cpu < 0) {
+    return w;
+  }
+  int node = get_cpu_numa_node(cpu);
+  int i = choose_steered_worker(cpu, cpu_numa_node, workers);
+  Worker *best = i < 0 ? nullptr : workers[i];
+  if (best && best != w) {
+    ldout(cct, 20) << __func__ << " sd " << sd << " rx cpu " << cpu
+		   << " worker " << w->id << " -> " << best->id << dendl;
+    ++best->references;
+    w->release_worker();
+    w = best;
+    w->perf_logger->inc(l_msgr_steered_connections);
+  }
+  if (node >= 0 && w->numa_node >= 0 && w->numa_node != node) {
+    w->perf_logger->inc(l_msgr_cross_node_connections);
+  }
+#endif
+  return w;
+}
+
 void NetworkStack::stop()
 {
   std::lock_guard lk(pool_spin);
@@ -17,6 +17,9 @@
 #ifndef CEPH_MSG_ASYNC_STACK_H
 #define CEPH_MSG_ASYNC_STACK_H
 
+#include <limits>
+#include <vector>
+
 #include "include/spinlock.h"
 #include "common/perf_counters.h"
 #include "msg/msg_types.h"
@@ -210,6 +213,9 @@ enum {
   l_msgr_send_messages_queue_lat,
   l_msgr_handle_ack_lat,
 
+  l_msgr_steered_connections,
+  l_msgr_cross_node_connections,
+
   l_msgr_last,
 };
 
@@ -224,6 +230,8 @@ class Worker {
   CephContext *cct;
   PerfCounters *perf_logger;
   unsigned id;
+  int cpu = -1;        ///< core this worker is pinned to, or -1
+  int numa_node = -1;  ///< numa node of that core, or -1
 
   std::atomic_uint references;
   EventCenter center;
@@ -253,6 +261,11 @@ class Worker {
     plb.add_time_avg(l_msgr_send_messages_queue_lat, "msgr_send_messages_queue_lat", "Network sent messages lat");
     plb.add_time_avg(l_msgr_handle_ack_lat, "msgr_handle_ack_lat", "Connection handle ack lat");
 
+    plb.add_u64_counter(l_msgr_steered_connections, "msgr_steered_connections",
+			"Accepted connections moved to the worker on their RX core");
+    plb.add_u64_counter(l_msgr_cross_node_connections, "msgr_cross_node_connections",
+			"Accepted connections served from another numa node than their RX core");
+
     perf_logger = plb.create_perf_counters();
     cct->get_perfcounters_collection()->add(perf_logger);
   }
@@ -305,7 +318,21 @@ class NetworkStack {
   ceph::spinlock pool_spin;
   bool started = false;
 
+  /// numa node of each cpu, indexed by cpu id (-1 if unknown)
+  std::vector<int> cpu_numa_node;
+  bool steer_incoming_cpu = false;
+
   std::function<void ()> add_thread(unsigned i);
+  void init_worker_placement();
+  static int get_cpu_numa_node(const std::vector<int>& cpu_numa_node,
+			       int cpu) {
+    if (cpu < 0 || cpu >= (int)cpu_numa_node.size())
+      return -1;
+    return cpu_numa_node[cpu];
+  }
+  int get_cpu_numa_node(int cpu) const {
+    return get_cpu_numa_node(cpu_numa_node, cpu);
+  }
 
  protected:
   CephContext *cct;
@@ -334,6 +361,9 @@ class NetworkStack {
   // But for dpdk backend, we maintain listen table in each thread. So we
   // need to let each thread do binding port.
   virtual bool support_local_listen_table() const { return false; }
+  // backend need to override this method if its sockets are kernel
+  // sockets, whose SO_INCOMING_CPU steer_worker() can use
+  virtual bool support_incoming_cpu_steering() const { return false; }
   virtual bool nonblock_connect_need_writable_event() const { return true; }
 
   void start();
@@ -342,6 +372,47 @@ class NetworkStack {
   Worker *get_worker(unsigned worker_id) {
     return workers[worker_id];
   }
+  /**
+   * Pick the worker for a freshly accepted socket.
+   *
+   * If ms_async_steer_incoming_cpu is set, the reference held on @p w is
+   * moved to the worker pinned closest to the core that received the
+   * socket's packets (SO_INCOMING_CPU).
+   *
+   * @return the worker that now holds the reference
+   */
+  Worker *steer_worker(Worker *w, int sd);
+  /**
+   * Choose the worker for a socket whose packets arrive on @p rx_cpu.
+   *
+   * @param cpu_numa_node numa node of each cpu, indexed by cpu id
+   * @param workers anything with the Worker's cpu and references
+   * @return the index of the worker pinned to @p rx_cpu, else of the
+   * least loaded worker pinned to a cpu on the same numa node, else -1
+   */
+  template <typename W>
+  static int choose_steered_worker(int rx_cpu,
+				   const std::vector<int>& cpu_numa_node,
+				   const std::vector<W*>& workers) {
+    if (rx_cpu < 0)
+      return -1;
+    int node = get_cpu_numa_node(cpu_numa_node, rx_cpu);
+    int best = -1;
+    unsigned min_load = std::numeric_limits<unsigned>::max();
+    for (unsigned i = 0; i < workers.size(); ++i) {
+      const W *c = workers[i];
+      if (c->cpu == rx_cpu)
+	return i;
+      if (node >= 0 && get_cpu_numa_node(cpu_numa_node, c->cpu) == node) {
+	unsigned load = c->references.load();
+	if (load < min_load) {
+	  best = i;
+	  min_load = load;
+	}
+      }
+    }
+    return best;
+  }
   void drain();
   unsigned get_num_worker() const {
     return num_workers;
@@ -2,10 +2,15 @@
 #define _MSG_ASYNC_FRAMES_V2_
 
 #include "include/types.h"
+#include "include/intarith.h"
+#include "include/page.h"
 #include "common/Clock.h"
 #include "crypto_onwire.h"
 #include <array>
 #include <utility>
+#include <vector>
+
+#include <boost/container/static_vector.hpp>
 
 /**
  * Protocol V2 Frame Structures
@@ -79,6 +84,61 @@ struct SegmentIndex {
   };
 };
 
+/**
+ * Page-aligned buffers recycled for the data segment of MESSAGE frames.
+ *
+ * Like ProtocolV1's alloc_aligned_buffer() the payload is laid out so that
+ * its offset within a page matches data_off: everything past the head then
+ * sits at the same page offset in memory as in the object, which lets the
+ * objectstore hand it to the block device without re-aligning it.  A pooled
+ * buffer is only handed out again once nothing but the pool references it.
+ */
+class RxDataBufferPool {
+  std::vector<ceph::bufferptr> buffers;
+
+public:
+  // len bytes starting at the page offset of data_off, backed by a pooled
+  // buffer if an idle one is big enough; at most max_size are kept
+  ceph::bufferptr get(uint32_t len, uint16_t data_off, std::size_t max_size) {
+    uint32_t head = 0;
+    uint32_t alloc_len = len;
+    if (data_off & ~CEPH_PAGE_MASK) {
+      head = std::min<uint32_t>(CEPH_PAGE_SIZE - (data_off & ~CEPH_PAGE_MASK),
+                                len);
+      alloc_len = CEPH_PAGE_SIZE + len - head;
+    }
+    alloc_len = p2roundup<uint32_t>(alloc_len, CEPH_PAGE_SIZE);
+
+    ceph::bufferptr backing;
+    for (auto& p : buffers) {
+      // only the pool itself references it: the last user is gone
+      if (p.raw_nref() == 1 && p.length() >= alloc_len) {
+        backing = p;
+        break;
+      }
+    }
+    if (!backing.have_raw()) {
+      backing = ceph::buffer::create_page_aligned(alloc_len);
+      if (buffers.size() < max_size) {
+        buffers.push_back(backing);
+      } else {
+        // replace an idle buffer that turned out to be too small
+        for (auto& p : buffers) {
+          if (p.raw_nref() == 1) {
+            p = backing;
+            break;
+          }
+        }
+      }
+    }
+    return ceph::bufferptr(backing, head ? CEPH_PAGE_SIZE - head : 0, len);
+  }
+
+  std::size_t size() const {
+    return buffers.size();
+  }
+};
+
 static constexpr uint8_t CRYPTO_BLOCK_SIZE { 16 };
 
 static constexpr std::size_t MAX_NUM_SEGMENTS = 4;
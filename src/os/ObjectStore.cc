@@ -115,3 +115,40 @@ int ObjectStore::read_meta(const std::string& key,
   *value = string(buf, r);
   return 0;
 }
+
+int ObjectStore::omap_get_range(
+  CollectionHandle &c,
+  const ghobject_t &oid,
+  const std::string &start_after,
+  const std::string &filter_prefix,
+  uint64_t max_return,
+  uint64_t max_bytes,
+  std::map<std::string, ceph::buffer::list> *out,
+  bool *more)
+{
+  *more = false;
+  ObjectMap::ObjectMapIterator iter = get_omap_iterator(c, oid);
+  if (!iter) {
+    return -ENOENT;
+  }
+  iter->upper_bound(start_after);
+  if (filter_prefix > start_after) {
+    iter->lower_bound(filter_prefix);
+  }
+  uint64_t bytes = 0;
+  for (; iter->valid(); iter->next()) {
+    std::string key = iter->key();
+    if (key.compare(0, filter_prefix.size(), filter_prefix) != 0) {
+      break;
+    }
+    if (out->size() >= max_return || bytes >= max_bytes) {
+      *more = true;
+      break;
+    }
+    ceph::buffer::list value = iter->value();
+    // account for the length prefixes the caller will encode
+    bytes += sizeof(uint32_t) * 2 + key.size() + value.length();
+    out->emplace(std::move(key), std::move(value));
+  }
+  return 0;
+}
@@ -714,6 +714,31 @@ public:
     std::set<std::string> *out         ///< [out] Subset of keys defined on oid
     ) = 0;
 
+  /**
+   * Get a run of consecutive key values
+   *
+   * Returns keys strictly after start_after that begin with
+   * filter_prefix, in order, stopping once max_return entries or
+   * max_bytes of encoded keys and values have been collected.  *more is
+   * set if a matching key remains past the returned range.
+   *
+   * The default implementation walks get_omap_iterator(); backends that
+   * can tell their key-value store up front which range will be scanned
+   * should override it.
+   *
+   * @return 0 on success, -ENOENT if the object does not exist
+   */
+  virtual int omap_get_range(
+    CollectionHandle &c,              ///< [in] Collection containing oid
+    const ghobject_t &oid,            ///< [in] Object containing omap
+    const std::string &start_after,   ///< [in] Return keys after this one
+    const std::string &filter_prefix, ///< [in] Only keys with this prefix
+    uint64_t max_return,              ///< [in] Max entries to return
+    uint64_t max_bytes,               ///< [in] Max bytes to return
+    std::map<std::string, ceph::buffer::list> *out, ///< [out] keys and values
+    bool *more                        ///< [out] true if truncated
+    );
+
   /**
    * Returns an object map iterator
    *
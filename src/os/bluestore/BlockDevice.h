@@ -154,8 +154,10 @@ public:
  {}
   virtual ~BlockDevice() = default;
 
+  // use_ioring asks a kernel device for io_uring rather than libaio
   static BlockDevice *create(
-    CephContext* cct, const std::string& path, aio_callback_t cb, void *cbpriv, aio_callback_t d_cb, void *d_cbpriv);
+    CephContext* cct, const std::string& path, aio_callback_t cb, void *cbpriv, aio_callback_t d_cb, void *d_cbpriv,
+    bool use_ioring);
   virtual bool supported_bdev_label() { return true; }
   virtual bool is_rotational() { return rotational; }
 
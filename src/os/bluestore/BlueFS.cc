@@ -262,8 +262,18 @@ int BlueFS::add_block_device(unsigned id, const string& path, bool trim,
   dout(10) << __func__ << " bdev " << id << " path " << path << dendl;
   ceph_assert(id < bdev.size());
   ceph_assert(bdev[id] == NULL);
+  // a device of its own may have its own io_uring setting
+  bool use_ioring = cct->_conf.get_val<bool>("bdev_ioring");
+  if (!shared_with_bluestore) {
+    if (id == BDEV_WAL || id == BDEV_NEWWAL) {
+      use_ioring = cct->_conf.get_val<bool>("bluestore_block_wal_ioring");
+    } else if (id == BDEV_DB || id == BDEV_NEWDB) {
+      use_ioring = cct->_conf.get_val<bool>("bluestore_block_db_ioring");
+    }
+  }
   BlockDevice *b = BlockDevice::create(cct, path, NULL, NULL,
-				       discard_cb[id], static_cast<void*>(this));
+				       discard_cb[id], static_cast<void*>(this),
+				       use_ioring);
   if (shared_with_bluestore) {
     b->set_no_exclusive_lock();
   }
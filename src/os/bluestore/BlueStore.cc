@@ -89,6 +89,7 @@ const string PREFIX_DEFERRED = "L";    // id -> deferred_transaction_t
 const string PREFIX_ALLOC = "B";       // u64 offset -> u64 length (freelist)
 const string PREFIX_ALLOC_BITMAP = "b";// (see BitmapFreelistManager)
 const string PREFIX_SHARED_BLOB = "X"; // u64 offset -> shared_blob_t
+const string PREFIX_ALLOC_SNAPSHOT = "A"; // header, u64 chunk -> extents
 
 const string BLUESTORE_GLOBAL_STATFS_KEY = "bluestore_statfs";
 
@@ -913,6 +914,103 @@ struct LruOnodeCacheShard : public BlueStore::OnodeCacheShard {
   }
 };
 
+// ClockOnodeCacheShard
+//
+// Onodes sit on a ring swept by a CLOCK hand.  A hit only sets the onode's
+// referenced bit, so lookups need neither the shard lock nor any list
+// manipulation (see OnodeSpace::lookup); the hand gives referenced onodes
+// a second chance and evicts the rest.
+struct ClockOnodeCacheShard : public BlueStore::OnodeCacheShard {
+  typedef boost::intrusive::list<
+    BlueStore::Onode,
+    boost::intrusive::member_hook<
+      BlueStore::Onode,
+      boost::intrusive::list_member_hook<>,
+      &BlueStore::Onode::lru_item> > list_t;
+  list_t ring;
+  list_t::iterator hand = ring.end();
+
+  explicit ClockOnodeCacheShard(CephContext *cct) : BlueStore::OnodeCacheShard(cct) {}
+
+  bool lockless_touch() const override {
+    return true;
+  }
+  void _add(BlueStore::OnodeRef& o, int level) override
+  {
+    // insert right behind the hand, i.e. last in line for eviction
+    o->referenced = level > 0;
+    ring.insert(hand, *o);
+    num = ring.size();
+  }
+  void _rm(BlueStore::OnodeRef& o) override
+  {
+    auto p = ring.iterator_to(*o);
+    if (p == hand) {
+      hand = ring.erase(p);
+    } else {
+      ring.erase(p);
+    }
+    num = ring.size();
+  }
+  void _touch(BlueStore::OnodeRef& o) override
+  {
+    // avoid dirtying the cache line if the bit is already set
+    if (!o->referenced.load(std::memory_order_relaxed)) {
+      o->referenced.store(true, std::memory_order_relaxed);
+    }
+  }
+  void _trim_to(uint64_t max) override
+  {
+    if (max >= ring.size()) {
+      return; // don't even try
+    }
+    uint64_t n = ring.size() - max;
+    int skipped = 0;
+    int max_skipped = g_conf()->bluestore_cache_trim_max_skip_pinned;
+    // every onode is passed at most twice: once to clear its bit, once
+    // more to evict it
+    uint64_t steps = 2 * ring.size();
+    while (n > 0 && steps-- > 0) {
+      if (hand == ring.end()) {
+	hand = ring.begin();
+      }
+      BlueStore::Onode *o = &*hand;
+      int refs = o->nref.load();
+      if (refs > 1) {
+        dout(20) << __func__ << "  " << o->oid << " has " << refs
+                 << " refs, skipping" << dendl;
+        if (++skipped >= max_skipped) {
+          dout(20) << __func__ << " maximum skip pinned reached; stopping with "
+                   << n << " left to trim" << dendl;
+          break;
+        }
+	++hand;
+	continue;
+      }
+      if (o->referenced.load(std::memory_order_relaxed)) {
+	o->referenced.store(false, std::memory_order_relaxed);
+	++hand;
+	continue;
+      }
+      dout(30) << __func__ << "  rm " << o->oid << dendl;
+      auto next = ring.erase(hand);
+      if (!o->c->onode_map.remove_unpinned(o)) {
+	// a lockless lookup got to it first
+	ring.insert(next, *o);
+	hand = next;
+	continue;
+      }
+      hand = next;
+      --n;
+    }
+    num = ring.size();
+  }
+  void add_stats(uint64_t *onodes) override
+  {
+    *onodes += num;
+  }
+};
+
 // OnodeCacheShard
 BlueStore::OnodeCacheShard *BlueStore::OnodeCacheShard::create(
     CephContext* cct,
@@ -920,8 +1018,12 @@ BlueStore::OnodeCacheShard *BlueStore::OnodeCacheShard::create(
     PerfCounters *logger)
 {
   BlueStore::OnodeCacheShard *c = nullptr;
-  // Currently we only implement an LRU cache for onodes
-  c = new LruOnodeCacheShard(cct);
+  if (type == "lru")
+    c = new LruOnodeCacheShard(cct);
+  else if (type == "clock")
+    c = new ClockOnodeCacheShard(cct);
+  else
+    ceph_abort_msg("unrecognized onode cache type");
   c->logger = logger;
   return c;
 }
@@ -1614,7 +1716,10 @@ BlueStore::OnodeRef BlueStore::OnodeSpace::add(const ghobject_t& oid, OnodeRef o
     return p->second;
   }
   ldout(cache->cct, 30) << __func__ << " " << oid << " " << o << dendl;
-  onode_map[oid] = o;
+  {
+    std::unique_lock ml(map_lock);
+    onode_map[oid] = o;
+  }
   cache->_add(o, 1);
   cache->_trim();
   return o;
@@ -1626,7 +1731,19 @@ BlueStore::OnodeRef BlueStore::OnodeSpace::lookup(const ghobject_t& oid)
   OnodeRef o;
   bool hit = false;
 
-  {
+  if (cache->lockless_touch()) {
+    std::shared_lock l(map_lock);
+    auto p = onode_map.find(oid);
+    if (p == onode_map.end()) {
+      ldout(cache->cct, 30) << __func__ << " " << oid << " miss" << dendl;
+    } else {
+      ldout(cache->cct, 30) << __func__ << " " << oid << " hit " << p->second
+			    << dendl;
+      cache->_touch(p->second);
+      hit = true;
+      o = p->second;
+    }
+  } else {
     std::lock_guard l(cache->lock);
     ceph::unordered_map<ghobject_t,OnodeRef>::iterator p = onode_map.find(oid);
     if (p == onode_map.end()) {
@@ -1655,6 +1772,7 @@ void BlueStore::OnodeSpace::clear()
   for (auto &p : onode_map) {
     cache->_rm(p.second);
   }
+  std::unique_lock ml(map_lock);
   onode_map.clear();
 }
 
@@ -1683,17 +1801,22 @@ void BlueStore::OnodeSpace::rename(
     ldout(cache->cct, 30) << __func__ << "  removing target " << pn->second
 			  << dendl;
     cache->_rm(pn->second);
+    std::unique_lock ml(map_lock);
     onode_map.erase(pn);
   }
   OnodeRef o = po->second;
 
   // install a non-existent onode at old location
   oldo.reset(new Onode(o->c, old_oid, o->key));
-  po->second = oldo;
-  cache->_add(po->second, 1);
-  // add at new position and fix oid, key
-  onode_map.insert(make_pair(new_oid, o));
+  {
+    std::unique_lock ml(map_lock);
+    po->second = oldo;
+    // add at new position
+    onode_map.insert(make_pair(new_oid, o));
+  }
+  cache->_add(oldo, 1);
   cache->_touch(o);
+  // fix oid, key
   o->oid = new_oid;
   o->key = new_okey;
   cache->_trim();
@@ -3698,11 +3821,17 @@ void BlueStore::Collection::split_cache(
 			    << dendl;
 
       onode_map.cache->_rm(p->second);
-      p = onode_map.onode_map.erase(p);
+      {
+	std::unique_lock ml(onode_map.map_lock);
+	p = onode_map.onode_map.erase(p);
+      }
 
       o->c = dest;
       dest->onode_map.cache->_add(o, 1);
-      dest->onode_map.onode_map[o->oid] = o;
+      {
+	std::unique_lock ml(dest->onode_map.map_lock);
+	dest->onode_map.onode_map[o->oid] = o;
+      }
       dest->onode_map.cache = dest->onode_map.cache;
 
       // move over shared blobs and buffers.  cover shared blobs from
@@ -4622,6 +4751,8 @@ void BlueStore::_init_logger()
     "Average omap iterator lower_bound call latency");
   b.add_time_avg(l_bluestore_omap_next_lat, "omap_next_lat",
     "Average omap iterator next call latency");
+  b.add_time_avg(l_bluestore_omap_get_range_lat, "omap_get_range_lat",
+    "Average omap range read latency");
   b.add_time_avg(l_bluestore_clist_lat, "clist_lat",
     "Average collection listing latency");
   logger = b.create_perf_counters();
@@ -4827,7 +4958,8 @@ int BlueStore::_open_bdev(bool create)
 {
   ceph_assert(bdev == NULL);
   string p = path + "/block";
-  bdev = BlockDevice::create(cct, p, aio_cb, static_cast<void*>(this), discard_cb, static_cast<void*>(this));
+  bdev = BlockDevice::create(cct, p, aio_cb, static_cast<void*>(this), discard_cb, static_cast<void*>(this),
+			     cct->_conf.get_val<bool>("bdev_ioring"));
   int r = bdev->open(p);
   if (r < 0)
     goto fail;
@@ -5027,6 +5159,32 @@ int BlueStore::_open_alloc()
 
   uint64_t num = 0, bytes = 0;
 
+  alloc_snapshot_loaded = false;
+  if (cct->_conf.get_val<bool>("bluestore_alloc_snapshot")) {
+    dout(1) << __func__ << " loading allocator snapshot" << dendl;
+    int r = _load_alloc_snapshot(&num, &bytes);
+    if (r == 0) {
+      // the snapshot already excludes the bluefs space
+      dout(1) << __func__ << " loaded " << byte_u_t(bytes)
+	      << " in " << num << " extents from snapshot"
+	      << dendl;
+      alloc_snapshot_loaded = true;
+      return 0;
+    }
+    dout(1) << __func__ << " no usable allocator snapshot: "
+	    << cpp_strerror(r) << dendl;
+    if (r == -EIO) {
+      // the snapshot may have been partially applied; start over
+      alloc->shutdown();
+      delete alloc;
+      alloc = Allocator::create(cct, cct->_conf->bluestore_allocator,
+				bdev->get_size(),
+				min_alloc_size, "block");
+      ceph_assert(alloc);
+    }
+    num = bytes = 0;
+  }
+
   dout(1) << __func__ << " opening allocation metadata" << dendl;
   // initialize from freelist
   fm->enumerate_reset();
@@ -5049,6 +5207,170 @@ int BlueStore::_open_alloc()
   return 0;
 }
 
+uint64_t BlueStore::_get_freelist_gen()
+{
+  bufferlist bl;
+  uint64_t gen = 0;
+  if (db->get(PREFIX_SUPER, "freelist_gen", &bl) >= 0) {
+    auto p = bl.cbegin();
+    decode(gen, p);
+  }
+  return gen;
+}
+
+/*
+ * The snapshot is only valid if nothing changed the freelist since it
+ * was taken at umount.  Every r/w open of the db, including the kv-only
+ * ones tools use, bumps the freelist generation before anything can be
+ * committed (see _invalidate_alloc_snapshot), so a snapshot whose
+ * generation still matches describes exactly what the freelist scan
+ * would produce.  Doing this in the first transaction that changes the
+ * freelist instead would race with transactions committed concurrently
+ * from other sequencers.
+ */
+int BlueStore::_load_alloc_snapshot(uint64_t *num, uint64_t *bytes)
+{
+  bufferlist bl;
+  int r = db->get(PREFIX_ALLOC_SNAPSHOT, "header", &bl);
+  if (r < 0) {
+    return -ENOENT;
+  }
+  bluestore_alloc_snapshot_t h;
+  try {
+    auto p = bl.cbegin();
+    decode(h, p);
+  } catch (buffer::error& e) {
+    derr << __func__ << " failed to decode snapshot header" << dendl;
+    return -EINVAL;
+  }
+  dout(10) << __func__ << " " << h << dendl;
+  uint64_t gen = _get_freelist_gen();
+  if (h.freelist_gen != gen ||
+      h.dev_size != bdev->get_size() ||
+      h.alloc_unit != min_alloc_size ||
+      !(h.bluefs_extents == bluefs_extents)) {
+    dout(1) << __func__ << " snapshot is stale (freelist gen " << gen
+	    << ", snapshot gen " << h.freelist_gen << ")" << dendl;
+    return -ESTALE;
+  }
+
+  utime_t start = ceph_clock_now();
+  uint64_t n = 0, b = 0;
+  uint32_t chunk = 0;
+  KeyValueDB::Iterator it = db->get_iterator(PREFIX_ALLOC_SNAPSHOT);
+  string key;
+  _key_encode_u64(0, &key);
+  for (it->lower_bound(key);
+       it->valid() && chunk < h.num_chunks;
+       it->next(), ++chunk) {
+    key.clear();
+    _key_encode_u64(chunk, &key);
+    if (it->key() != key) {
+      derr << __func__ << " missing snapshot chunk " << chunk << dendl;
+      return -EIO;
+    }
+    std::vector<std::pair<uint64_t,uint64_t>> extents;
+    try {
+      bufferlist v = it->value();
+      auto p = v.cbegin();
+      decode(extents, p);
+    } catch (buffer::error& e) {
+      derr << __func__ << " failed to decode snapshot chunk " << chunk
+	   << dendl;
+      return -EIO;
+    }
+    for (auto& e : extents) {
+      alloc->init_add_free(e.first, e.second);
+      ++n;
+      b += e.second;
+    }
+  }
+  if (chunk != h.num_chunks || n != h.num_extents || b != h.free_bytes) {
+    derr << __func__ << " snapshot is inconsistent: " << chunk << " chunks, "
+	 << n << " extents, 0x" << std::hex << b << std::dec << " bytes vs "
+	 << h << dendl;
+    return -EIO;
+  }
+  dout(5) << __func__ << " loaded in " << (ceph_clock_now() - start) << dendl;
+  *num = n;
+  *bytes = b;
+  return 0;
+}
+
+void BlueStore::_store_alloc_snapshot()
+{
+  ceph_assert(alloc);
+  if (!bluefs_extents_reclaiming.empty()) {
+    dout(1) << __func__ << " bluefs reclaim in progress, skipping" << dendl;
+    return;
+  }
+  utime_t start = ceph_clock_now();
+  KeyValueDB::Transaction t = db->get_transaction();
+  t->rmkeys_by_prefix(PREFIX_ALLOC_SNAPSHOT);
+
+  bluestore_alloc_snapshot_t h;
+  h.freelist_gen = _get_freelist_gen() + 1;
+  h.dev_size = bdev->get_size();
+  h.alloc_unit = min_alloc_size;
+  h.bluefs_extents = bluefs_extents;
+
+  const size_t chunk_extents = cct->_conf.get_val<uint64_t>(
+    "bluestore_alloc_snapshot_chunk_extents");
+  std::vector<std::pair<uint64_t,uint64_t>> extents;
+  extents.reserve(chunk_extents);
+  auto flush_chunk = [&]() {
+    bufferlist bl;
+    encode(extents, bl);
+    string key;
+    _key_encode_u64(h.num_chunks++, &key);
+    t->set(PREFIX_ALLOC_SNAPSHOT, key, bl);
+    extents.clear();
+  };
+  alloc->dump([&](uint64_t offset, uint64_t length) {
+      extents.emplace_back(offset, length);
+      ++h.num_extents;
+      h.free_bytes += length;
+      if (extents.size() >= chunk_extents) {
+	flush_chunk();
+      }
+    });
+  if (!extents.empty()) {
+    flush_chunk();
+  }
+  if (h.free_bytes != alloc->get_free()) {
+    derr << __func__ << " dumped 0x" << std::hex << h.free_bytes
+	 << " free bytes but allocator reports 0x" << alloc->get_free()
+	 << std::dec << ", skipping" << dendl;
+    return;
+  }
+
+  bufferlist bl;
+  encode(h, bl);
+  t->set(PREFIX_ALLOC_SNAPSHOT, "header", bl);
+  bufferlist genbl;
+  encode(h.freelist_gen, genbl);
+  t->set(PREFIX_SUPER, "freelist_gen", genbl);
+  db->submit_transaction_sync(t);
+  dout(1) << __func__ << " stored " << h << " in "
+	  << (ceph_clock_now() - start) << dendl;
+}
+
+void BlueStore::_invalidate_alloc_snapshot()
+{
+  bufferlist bl;
+  if (db->get(PREFIX_ALLOC_SNAPSHOT, "header", &bl) < 0) {
+    return;
+  }
+  uint64_t gen = _get_freelist_gen() + 1;
+  dout(10) << __func__ << " freelist gen " << gen << dendl;
+  KeyValueDB::Transaction t = db->get_transaction();
+  t->rmkeys_by_prefix(PREFIX_ALLOC_SNAPSHOT);
+  bufferlist genbl;
+  encode(gen, genbl);
+  t->set(PREFIX_SUPER, "freelist_gen", genbl);
+  db->submit_transaction_sync(t);
+}
+
 void BlueStore::_close_alloc()
 {
   ceph_assert(bdev);
@@ -5463,6 +5785,10 @@ int BlueStore::_open_db_and_around(bool read_only)
     if (r < 0)
       goto out_fm;
   }
+  if (!read_only) {
+    // from now on the freelist may change under any allocator snapshot
+    _invalidate_alloc_snapshot();
+  }
   return 0;
 
  out_fm:
@@ -5489,6 +5815,7 @@ void BlueStore::_close_db_and_around()
 	      << dendl;
 	break;
       }
+      _invalidate_alloc_snapshot();
       _sync_bluefs_and_fm();
       _close_db();
     }
@@ -6777,8 +7104,9 @@ void BlueStore::set_cache_shards(unsigned num)
   buffer_cache_shards.resize(num);
   for (unsigned i = oold; i < num; ++i) {
     onode_cache_shards[i] = 
-        OnodeCacheShard::create(cct, cct->_conf->bluestore_cache_type,
-                                 logger);
+        OnodeCacheShard::create(
+          cct, cct->_conf.get_val<std::string>("bluestore_onode_cache_type"),
+          logger);
   }
   for (unsigned i = bold; i < num; ++i) {
     buffer_cache_shards[i] = 
@@ -6850,6 +7178,10 @@ int BlueStore::_mount(bool kv_only, bool open_db)
     // we can bypass db open exclusively in case of kv_only mode
     ceph_assert(kv_only);
     r = _open_db(false, true);
+    if (r == 0) {
+      // the caller may change anything, the freelist included
+      _invalidate_alloc_snapshot();
+    }
   }
   if (r < 0) {
     goto out_bdev;
@@ -6922,6 +7254,9 @@ int BlueStore::umount()
     dout(20) << __func__ << " stopping kv thread" << dendl;
     _kv_stop();
     _flush_cache();
+    if (cct->_conf.get_val<bool>("bluestore_alloc_snapshot")) {
+      _store_alloc_snapshot();
+    }
     dout(20) << __func__ << " closing" << dendl;
 
   }
@@ -10616,6 +10951,90 @@ int BlueStore::omap_check_keys(
   return r;
 }
 
+int BlueStore::omap_get_range(
+  CollectionHandle &c_,
+  const ghobject_t &oid,
+  const string &start_after,
+  const string &filter_prefix,
+  uint64_t max_return,
+  uint64_t max_bytes,
+  map<string, bufferlist> *out,
+  bool *more)
+{
+  Collection *c = static_cast<Collection *>(c_.get());
+  dout(15) << __func__ << " " << c->get_cid() << " oid " << oid
+	   << " after " << start_after << " prefix " << filter_prefix
+	   << " max " << max_return << "/" << max_bytes << dendl;
+  *more = false;
+  if (!c->exists)
+    return -ENOENT;
+  auto start1 = mono_clock::now();
+  std::shared_lock l(c->lock);
+  int r = 0;
+  OnodeRef o = c->get_onode(oid, false);
+  if (!o || !o->exists) {
+    r = -ENOENT;
+    goto out;
+  }
+  if (!o->onode.has_omap()) {
+    goto out;
+  }
+  o->flush();
+  {
+    // Tell the kv store up front that we only walk this object's omap
+    // keys, starting at the requested key, so that it can prefetch
+    // sequentially and need not look past the object's tail.
+    KeyValueDB::IteratorBounds bounds;
+    string seek_key;
+    bool seek_after = filter_prefix <= start_after;
+    o->get_omap_key(seek_after ? start_after : filter_prefix, &seek_key);
+    string tail;
+    o->get_omap_tail(&tail);
+    bounds.lower_bound = seek_key;
+    bounds.upper_bound = tail;
+    bounds.readahead =
+      cct->_conf.get_val<Option::size_t>("bluestore_omap_readahead");
+    KeyValueDB::Iterator it =
+      db->get_bounded_iterator(o->get_omap_prefix(), bounds);
+    if (seek_after) {
+      it->upper_bound(seek_key);
+    } else {
+      it->lower_bound(seek_key);
+    }
+    uint64_t bytes = 0;
+    string user_key;
+    for (; it->valid(); it->next()) {
+      string db_key = it->key();
+      if (db_key >= tail) {
+	break;
+      }
+      o->decode_omap_key(db_key, &user_key);
+      if (user_key.compare(0, filter_prefix.size(), filter_prefix) != 0) {
+	break;
+      }
+      if (out->size() >= max_return || bytes >= max_bytes) {
+	*more = true;
+	break;
+      }
+      dout(30) << __func__ << "  got " << pretty_binary_string(db_key)
+	       << " -> " << user_key << dendl;
+      bufferlist value = it->value();
+      // account for the length prefixes the caller will encode
+      bytes += sizeof(uint32_t) * 2 + user_key.size() + value.length();
+      out->emplace_hint(out->end(), std::move(user_key), std::move(value));
+    }
+  }
+ out:
+  log_latency(
+    __func__,
+    l_bluestore_omap_get_range_lat,
+    mono_clock::now() - start1,
+    cct->_conf->bluestore_log_omap_iterator_age);
+  dout(10) << __func__ << " " << c->get_cid() << " oid " << oid << " = " << r
+	   << " (" << out->size() << " keys, more " << *more << ")" << dendl;
+  return r;
+}
+
 ObjectMap::ObjectMapIterator BlueStore::get_omap_iterator(
   CollectionHandle &c_,              ///< [in] collection
   const ghobject_t &oid  ///< [in] object
@@ -134,6 +134,7 @@ enum {
   l_bluestore_omap_upper_bound_lat,
   l_bluestore_omap_lower_bound_lat,
   l_bluestore_omap_next_lat,
+  l_bluestore_omap_get_range_lat,
   l_bluestore_clist_lat,
   l_bluestore_last
 };
@@ -1063,6 +1064,8 @@ public:
     mempool::bluestore_cache_other::string key;
 
     boost::intrusive::list_member_hook<> lru_item;
+    /// set on access, cleared by the CLOCK hand (ClockOnodeCacheShard)
+    std::atomic<bool> referenced = {false};
 
     bluestore_onode_t onode;  ///< metadata stored as value in kv store
     bool exists;              ///< true if object logically exists
@@ -1192,6 +1195,11 @@ public:
     virtual void _touch(OnodeRef& o) = 0;
     virtual void add_stats(uint64_t *onodes) = 0;
 
+    /// true if _touch() may be called without holding lock
+    virtual bool lockless_touch() const {
+      return false;
+    }
+
     bool empty() {
       return _get_num() == 0;
     }
@@ -1248,6 +1256,10 @@ public:
   private:
     /// forward lookups
     mempool::bluestore_cache_other::unordered_map<ghobject_t,OnodeRef> onode_map;
+    /// lets lookups skip cache->lock if the cache has a lockless _touch();
+    /// anyone modifying onode_map holds both cache->lock and this
+    ceph::shared_mutex map_lock =
+      ceph::make_shared_mutex("BlueStore::OnodeSpace::map_lock");
 
     friend class Collection; // for split_cache()
 
@@ -1260,8 +1272,18 @@ public:
     OnodeRef add(const ghobject_t& oid, OnodeRef o);
     OnodeRef lookup(const ghobject_t& o);
     void remove(const ghobject_t& oid) {
+      std::unique_lock l(map_lock);
       onode_map.erase(oid);
     }
+    /// remove o unless a lockless lookup has taken a reference meanwhile
+    bool remove_unpinned(Onode *o) {
+      std::unique_lock l(map_lock);
+      if (o->nref.load() > 1) {
+	return false;
+      }
+      onode_map.erase(o->oid);
+      return true;
+    }
     void rename(OnodeRef& o, const ghobject_t& old_oid,
 		const ghobject_t& new_oid,
 		const mempool::bluestore_cache_other::string& new_okey);
@@ -1922,6 +1944,7 @@ private:
   std::string freelist_type;
   FreelistManager *fm = nullptr;
   Allocator *alloc = nullptr;
+  bool alloc_snapshot_loaded = false; ///< alloc came from its snapshot
   uuid_d fsid;
   int path_fd = -1;  ///< open handle to $path
   int fsid_fd = -1;  ///< open handle (locked) to $path/fsid
@@ -2245,6 +2268,12 @@ private:
   void _close_fm();
   int _open_alloc();
   void _close_alloc();
+
+  // allocator snapshot, used to skip the freelist scan on mount
+  uint64_t _get_freelist_gen();
+  int _load_alloc_snapshot(uint64_t *num, uint64_t *bytes);
+  void _store_alloc_snapshot();
+  void _invalidate_alloc_snapshot();
   int _open_collections();
   void _fsck_collections(int64_t* errors);
   void _close_collections();
@@ -2741,6 +2770,17 @@ public:
     set<string> *out         ///< [out] Subset of keys defined on oid
     ) override;
 
+  int omap_get_range(
+    CollectionHandle &c,              ///< [in] Collection containing oid
+    const ghobject_t &oid,            ///< [in] Object containing omap
+    const string &start_after,        ///< [in] Return keys after this one
+    const string &filter_prefix,      ///< [in] Only keys with this prefix
+    uint64_t max_return,              ///< [in] Max entries to return
+    uint64_t max_bytes,               ///< [in] Max bytes to return
+    map<string, bufferlist> *out,     ///< [out] Returned keys and values
+    bool *more                        ///< [out] true if truncated
+    ) override;
+
   ObjectMap::ObjectMapIterator get_omap_iterator(
     CollectionHandle &c,   ///< [in] collection
     const ghobject_t &oid  ///< [in] object
@@ -2799,6 +2839,10 @@ public:
   void inject_broken_shared_blob_key(const string& key,
 			 const bufferlist& bl);
   void inject_leaked(uint64_t len);
+  /// whether the last open of the allocator loaded it from its snapshot
+  bool is_alloc_snapshot_loaded() const {
+    return alloc_snapshot_loaded;
+  }
   void inject_false_free(coll_t cid, ghobject_t oid);
   void inject_statfs(const string& key, const store_statfs_t& new_statfs);
   void inject_global_statfs(const store_statfs_t& new_statfs);
@@ -18,8 +18,10 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <sys/file.h>
+#include <mutex>
 
 #include "KernelDevice.h"
+#include "io_uring.h"
 #include "include/intarith.h"
 #include "include/types.h"
 #include "include/compat.h"
@@ -39,10 +41,10 @@
 #undef dout_prefix
 #define dout_prefix *_dout << "bdev(" << this << " " << path << ") "
 
-KernelDevice::KernelDevice(CephContext* cct, aio_callback_t cb, void *cbpriv, aio_callback_t d_cb, void *d_cbpriv)
+KernelDevice::KernelDevice(CephContext* cct, aio_callback_t cb, void *cbpriv, aio_callback_t d_cb, void *d_cbpriv,
+			   bool use_ioring)
   : BlockDevice(cct, cb, cbpriv),
     aio(false), dio(false),
-    aio_queue(cct->_conf->bdev_aio_max_queue_depth),
     discard_callback(d_cb),
     discard_callback_priv(d_cbpriv),
     aio_stop(false),
@@ -54,6 +56,22 @@ KernelDevice::KernelDevice(CephContext* cct, aio_callback_t cb, void *cbpriv, ai
 {
   fd_directs.resize(WRITE_LIFE_MAX, -1);
   fd_buffereds.resize(WRITE_LIFE_MAX, -1);
+
+  unsigned int iodepth = cct->_conf->bdev_aio_max_queue_depth;
+
+  if (use_ioring && ioring_queue_t::supported()) {
+    io_queue = std::make_unique<ioring_queue_t>(
+      iodepth, cct->_conf.get_val<bool>("bdev_ioring_sqthread_poll"));
+  } else {
+    static std::once_flag warn_once;
+    if (use_ioring) {
+      std::call_once(warn_once, [&] {
+	derr << "WARNING: io_uring API is not supported! Fallback to libaio!"
+	     << dendl;
+      });
+    }
+    io_queue = std::make_unique<aio_queue_t>(iodepth);
+  }
 }
 
 int KernelDevice::_lock()
@@ -417,7 +435,14 @@ int KernelDevice::_aio_start()
 {
   if (aio) {
     dout(10) << __func__ << dendl;
-    int r = aio_queue.init();
+    int r = io_queue->init(fd_directs);
+    if (r < 0 && dynamic_cast<ioring_queue_t*>(io_queue.get())) {
+      derr << __func__ << " io_uring setup failed: " << cpp_strerror(r)
+	   << "; falling back to libaio" << dendl;
+      io_queue = std::make_unique<aio_queue_t>(
+	cct->_conf->bdev_aio_max_queue_depth);
+      r = io_queue->init(fd_directs);
+    }
     if (r < 0) {
       if (r == -EAGAIN) {
 	derr << __func__ << " io_setup(2) failed with EAGAIN; "
@@ -439,7 +464,7 @@ void KernelDevice::_aio_stop()
     aio_stop = true;
     aio_thread.join();
     aio_stop = false;
-    aio_queue.shutdown();
+    io_queue->shutdown();
   }
 }
 
@@ -499,7 +524,7 @@ void KernelDevice::_aio_thread()
     dout(40) << __func__ << " polling" << dendl;
     int max = cct->_conf->bdev_aio_reap_max;
     aio_t *aio[max];
-    int r = aio_queue.get_next_completed(cct->_conf->bdev_aio_poll_ms,
+    int r = io_queue->get_next_completed(cct->_conf->bdev_aio_poll_ms,
 					 aio, max);
     if (r < 0) {
       derr << __func__ << " got " << cpp_strerror(r) << dendl;
@@ -764,7 +789,7 @@ void KernelDevice::aio_submit(IOContext *ioc)
 
   void *priv = static_cast<void*>(ioc);
   int r, retries = 0;
-  r = aio_queue.submit_batch(ioc->running_aios.begin(), e,
+  r = io_queue->submit_batch(ioc->running_aios.begin(), e,
 			     pending, priv, &retries);
 
   if (retries)
@@ -16,6 +16,7 @@
 #define CEPH_OS_BLUESTORE_KERNELDEVICE_H
 
 #include <atomic>
+#include <memory>
 
 #include "include/types.h"
 #include "include/interval_set.h"
@@ -45,7 +46,7 @@ class KernelDevice : public BlockDevice {
   std::atomic<bool> io_since_flush = {false};
   ceph::mutex flush_mutex = ceph::make_mutex("KernelDevice::flush_mutex");
 
-  aio_queue_t aio_queue;
+  std::unique_ptr<io_queue_t> io_queue;
   aio_callback_t discard_callback;
   void *discard_callback_priv;
   bool aio_stop;
@@ -109,7 +110,8 @@ class KernelDevice : public BlockDevice {
   int choose_fd(bool buffered, int write_hint) const;
 
 public:
-  KernelDevice(CephContext* cct, aio_callback_t cb, void *cbpriv, aio_callback_t d_cb, void *d_cbpriv);
+  KernelDevice(CephContext* cct, aio_callback_t cb, void *cbpriv, aio_callback_t d_cb, void *d_cbpriv,
+	       bool use_ioring);
 
   void aio_submit(IOContext *ioc) override;
   void discard_drain() override;
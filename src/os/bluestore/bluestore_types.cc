@@ -80,6 +80,71 @@ ostream& operator<<(ostream& out, const bluestore_bdev_label_t& l)
 	     << ")";
 }
 
+// bluestore_alloc_snapshot_t
+
+void bluestore_alloc_snapshot_t::encode(bufferlist& bl) const
+{
+  ENCODE_START(1, 1, bl);
+  encode(freelist_gen, bl);
+  encode(dev_size, bl);
+  encode(alloc_unit, bl);
+  encode(num_chunks, bl);
+  encode(num_extents, bl);
+  encode(free_bytes, bl);
+  encode(bluefs_extents, bl);
+  ENCODE_FINISH(bl);
+}
+
+void bluestore_alloc_snapshot_t::decode(bufferlist::const_iterator& p)
+{
+  DECODE_START(1, p);
+  decode(freelist_gen, p);
+  decode(dev_size, p);
+  decode(alloc_unit, p);
+  decode(num_chunks, p);
+  decode(num_extents, p);
+  decode(free_bytes, p);
+  decode(bluefs_extents, p);
+  DECODE_FINISH(p);
+}
+
+void bluestore_alloc_snapshot_t::dump(Formatter *f) const
+{
+  f->dump_unsigned("freelist_gen", freelist_gen);
+  f->dump_unsigned("dev_size", dev_size);
+  f->dump_unsigned("alloc_unit", alloc_unit);
+  f->dump_unsigned("num_chunks", num_chunks);
+  f->dump_unsigned("num_extents", num_extents);
+  f->dump_unsigned("free_bytes", free_bytes);
+  f->dump_stream("bluefs_extents") << bluefs_extents;
+}
+
+void bluestore_alloc_snapshot_t::generate_test_instances(
+  list<bluestore_alloc_snapshot_t*>& o)
+{
+  o.push_back(new bluestore_alloc_snapshot_t);
+  o.push_back(new bluestore_alloc_snapshot_t);
+  o.back()->freelist_gen = 7;
+  o.back()->dev_size = 1ull << 40;
+  o.back()->alloc_unit = 4096;
+  o.back()->num_chunks = 2;
+  o.back()->num_extents = 100000;
+  o.back()->free_bytes = 1ull << 39;
+  o.back()->bluefs_extents.insert(1ull << 30, 1ull << 30);
+}
+
+ostream& operator<<(ostream& out, const bluestore_alloc_snapshot_t& s)
+{
+  return out << "alloc_snapshot(gen " << s.freelist_gen
+	     << ", dev_size 0x" << std::hex << s.dev_size
+	     << ", alloc_unit 0x" << s.alloc_unit << std::dec
+	     << ", " << s.num_extents << " extents in "
+	     << s.num_chunks << " chunks"
+	     << ", free 0x" << std::hex << s.free_bytes
+	     << ", bluefs 0x" << s.bluefs_extents << std::dec
+	     << ")";
+}
+
 // cnode_t
 
 void bluestore_cnode_t::dump(Formatter *f) const
@@ -48,6 +48,25 @@ WRITE_CLASS_ENCODER(bluestore_bdev_label_t)
 
 ostream& operator<<(ostream& out, const bluestore_bdev_label_t& l);
 
+/// header of the allocator snapshot written at clean umount
+struct bluestore_alloc_snapshot_t {
+  uint64_t freelist_gen = 0;  ///< freelist generation the snapshot is valid for
+  uint64_t dev_size = 0;      ///< size of the main device
+  uint64_t alloc_unit = 0;    ///< min_alloc_size
+  uint32_t num_chunks = 0;    ///< number of extent chunks that follow
+  uint64_t num_extents = 0;   ///< total free extents in all chunks
+  uint64_t free_bytes = 0;    ///< total free bytes in all chunks
+  interval_set<uint64_t> bluefs_extents; ///< bluefs extents at snapshot time
+
+  void encode(bufferlist& bl) const;
+  void decode(bufferlist::const_iterator& p);
+  void dump(Formatter *f) const;
+  static void generate_test_instances(list<bluestore_alloc_snapshot_t*>& o);
+};
+WRITE_CLASS_ENCODER(bluestore_alloc_snapshot_t)
+
+ostream& operator<<(ostream& out, const bluestore_alloc_snapshot_t& s);
+
 /// collection metadata
 struct bluestore_cnode_t {
   uint32_t bits;   ///< how many bits of coll pgid are significant
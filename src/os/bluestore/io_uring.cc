@@ -0,0 +1,246 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "io_uring.h"
+
+#if defined(HAVE_LIBURING)
+
+#include <liburing.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+#include <map>
+
+#include "common/ceph_mutex.h"
+#include "include/compat.h"
+
+struct ioring_data {
+  struct io_uring io_uring;
+  ceph::mutex sq_lock = ceph::make_mutex("ioring_queue_t::sq_lock");
+  int epoll_fd = -1;
+  std::map<int, int> fixed_fds_map;  ///< real fd -> registered file index
+};
+
+static int find_fixed_fd(ioring_data *d, int real_fd)
+{
+  auto it = d->fixed_fds_map.find(real_fd);
+  if (it == d->fixed_fds_map.end())
+    return -1;
+  return it->second;
+}
+
+static void init_sqe(ioring_data *d, struct io_uring_sqe *sqe, aio_t *io)
+{
+  int fixed_fd = find_fixed_fd(d, io->fd);
+  ceph_assert(fixed_fd != -1);
+
+  if (io->iocb.aio_lio_opcode == IO_CMD_PWRITEV)
+    io_uring_prep_writev(sqe, fixed_fd, &io->iov[0],
+			 io->iov.size(), io->offset);
+  else if (io->iocb.aio_lio_opcode == IO_CMD_PREADV)
+    io_uring_prep_readv(sqe, fixed_fd, &io->iov[0],
+			io->iov.size(), io->offset);
+  else
+    ceph_abort_msg("unexpected aio opcode");
+
+  io_uring_sqe_set_data(sqe, io);
+  io_uring_sqe_set_flags(sqe, IOSQE_FIXED_FILE);
+}
+
+ioring_queue_t::ioring_queue_t(unsigned iodepth_, bool sq_thread_)
+  : d(std::make_unique<ioring_data>()),
+    iodepth(iodepth_),
+    sq_thread(sq_thread_)
+{
+}
+
+ioring_queue_t::~ioring_queue_t()
+{
+  ceph_assert(d->epoll_fd < 0);
+}
+
+bool ioring_queue_t::supported()
+{
+  struct io_uring ring;
+  int r = io_uring_queue_init(16, &ring, 0);
+  if (r < 0)
+    return false;
+  io_uring_queue_exit(&ring);
+  return true;
+}
+
+int ioring_queue_t::init(std::vector<int> &fds)
+{
+  unsigned flags = 0;
+  if (sq_thread)
+    flags |= IORING_SETUP_SQPOLL;
+
+  int r = io_uring_queue_init(iodepth, &d->io_uring, flags);
+  if (r < 0)
+    return r;
+
+  // registered files save the fget/fput per io, and are required
+  // for SQPOLL on older kernels.
+  r = io_uring_register_files(&d->io_uring, &fds[0], fds.size());
+  if (r < 0)
+    goto out_ring;
+  for (unsigned i = 0; i < fds.size(); ++i) {
+    d->fixed_fds_map[fds[i]] = i;
+  }
+
+  // the completion thread sleeps in epoll rather than in io_uring_enter(2)
+  // so that it never contends with submitters for the ring.
+  d->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  if (d->epoll_fd < 0) {
+    r = -errno;
+    goto out_ring;
+  }
+  {
+    struct epoll_event ev = {};
+    ev.events = EPOLLIN;
+    r = epoll_ctl(d->epoll_fd, EPOLL_CTL_ADD, d->io_uring.ring_fd, &ev);
+    if (r < 0) {
+      r = -errno;
+      goto out_epoll;
+    }
+  }
+  return 0;
+
+ out_epoll:
+  VOID_TEMP_FAILURE_RETRY(::close(d->epoll_fd));
+  d->epoll_fd = -1;
+ out_ring:
+  d->fixed_fds_map.clear();
+  io_uring_queue_exit(&d->io_uring);
+  return r;
+}
+
+void ioring_queue_t::shutdown()
+{
+  if (d->epoll_fd < 0)
+    return;
+  d->fixed_fds_map.clear();
+  VOID_TEMP_FAILURE_RETRY(::close(d->epoll_fd));
+  d->epoll_fd = -1;
+  io_uring_queue_exit(&d->io_uring);
+}
+
+int ioring_queue_t::submit_batch(aio_iter begin, aio_iter end,
+				 uint16_t aios_size, void *priv,
+				 int *retries)
+{
+  // same backoff as aio_queue_t: 2^16 * 125us = ~8 seconds
+  int attempts = 16;
+  int delay = 125;
+  int done = 0;
+  int queued = 0;
+
+  std::lock_guard l(d->sq_lock);
+  aio_iter cur = begin;
+  while (cur != end || queued > 0) {
+    struct io_uring_sqe *sqe = nullptr;
+    if (cur != end) {
+      sqe = io_uring_get_sqe(&d->io_uring);
+    }
+    if (sqe) {
+      cur->priv = priv;
+      init_sqe(d.get(), sqe, &*cur);
+      ++cur;
+      ++queued;
+      continue;
+    }
+    // either the batch is fully prepared or the SQ ring is full; push
+    // what we have to the kernel.
+    int r = io_uring_submit(&d->io_uring);
+    if (r <= 0) {
+      // the kernel could not consume any sqe (e.g., the completion ring
+      // is full); back off and let the completion thread reap.
+      if ((r == 0 || r == -EAGAIN || r == -EBUSY) && attempts-- > 0) {
+	usleep(delay);
+	delay *= 2;
+	(*retries)++;
+	continue;
+      }
+      return r < 0 ? r : -EAGAIN;
+    }
+    done += r;
+    queued -= r;
+    attempts = 16;
+    delay = 125;
+  }
+  ceph_assert(aios_size >= done);
+  return done;
+}
+
+int ioring_queue_t::get_next_completed(int timeout_ms, aio_t **paio, int max)
+{
+  int events = 0;
+  do {
+    struct io_uring_cqe *cqe;
+    unsigned head;
+    io_uring_for_each_cqe(&d->io_uring, head, cqe) {
+      aio_t *io = static_cast<aio_t*>(io_uring_cqe_get_data(cqe));
+      io->rval = cqe->res;
+      paio[events++] = io;
+      if (events == max)
+	break;
+    }
+    io_uring_cq_advance(&d->io_uring, events);
+    if (events > 0)
+      break;
+
+    struct epoll_event ev;
+    int r = epoll_wait(d->epoll_fd, &ev, 1, timeout_ms);
+    if (r < 0) {
+      if (errno == EINTR)
+	continue;
+      return -errno;
+    }
+    if (r == 0)
+      break;  // timed out
+  } while (true);
+  return events;
+}
+
+#else // HAVE_LIBURING
+
+struct ioring_data {};
+
+ioring_queue_t::ioring_queue_t(unsigned iodepth_, bool sq_thread_)
+{
+  ceph_abort();
+}
+
+ioring_queue_t::~ioring_queue_t()
+{
+  ceph_abort();
+}
+
+bool ioring_queue_t::supported()
+{
+  return false;
+}
+
+int ioring_queue_t::init(std::vector<int> &fds)
+{
+  ceph_abort();
+}
+
+void ioring_queue_t::shutdown()
+{
+  ceph_abort();
+}
+
+int ioring_queue_t::submit_batch(aio_iter begin, aio_iter end,
+				 uint16_t aios_size, void *priv,
+				 int *retries)
+{
+  ceph_abort();
+}
+
+int ioring_queue_t::get_next_completed(int timeout_ms, aio_t **paio, int max)
+{
+  ceph_abort();
+}
+
+#endif // HAVE_LIBURING
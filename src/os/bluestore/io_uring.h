@@ -0,0 +1,32 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#pragma once
+
+#include "acconfig.h"
+
+#include <memory>
+
+#include "ceph_aio.h"
+
+struct ioring_data;
+
+/// io_uring backed implementation of io_queue_t
+struct ioring_queue_t final : public io_queue_t {
+  std::unique_ptr<ioring_data> d;
+  unsigned iodepth = 0;
+  bool sq_thread = false;   ///< use a kernel SQ polling thread (SQPOLL)
+
+  ioring_queue_t(unsigned iodepth_, bool sq_thread_);
+  ~ioring_queue_t() final;
+
+  /// true if the running kernel can set up an io_uring instance
+  static bool supported();
+
+  int init(std::vector<int> &fds) final;
+  void shutdown() final;
+
+  int submit_batch(aio_iter begin, aio_iter end, uint16_t aios_size,
+		   void *priv, int *retries) final;
+  int get_next_completed(int timeout_ms, aio_t **paio, int max) final;
+};
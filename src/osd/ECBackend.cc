@@ -155,6 +155,8 @@ ostream &operator<<(ostream &lhs, const ECBackend::Op &rhs)
       << " pending_commit=" << rhs.pending_commit
       << " plan.to_read=" << rhs.plan.to_read
       << " plan.will_write=" << rhs.plan.will_write
+      << " parity_delta=" << rhs.parity_delta
+      << " bypasses_cache=" << rhs.bypasses_cache
       << ")";
   return lhs;
 }
@@ -1847,12 +1849,52 @@ void ECBackend::start_rmw(Op *op, PGTransactionUPtr &&t)
     },
     get_parent()->get_dpp());
 
+  if (get_parent()->get_pool().allows_ecoverwrites() &&
+      cct->_conf.get_val<bool>("osd_ec_parity_delta_writes")) {
+    ECTransaction::plan_parity_delta(sinfo, ec_impl, op->plan);
+  }
+
   dout(10) << __func__ << ": " << *op << dendl;
 
   waiting_state.push_back(*op);
   check_ops();
 }
 
+bool ECBackend::is_write_in_flight(
+  const hobject_t &hoid,
+  bool bypasses_cache) const
+{
+  for (auto &&l : {&waiting_reads, &waiting_commit}) {
+    for (auto &&op : *l) {
+      if ((!bypasses_cache || op.bypasses_cache) &&
+	  op.plan.will_write.count(hoid)) {
+	return true;
+      }
+    }
+  }
+  return false;
+}
+
+bool ECBackend::can_update_parity_in_place(const hobject_t &hoid) const
+{
+  // the shards are read directly, so they must hold the latest
+  // version of the object: nothing may be cached for it
+  if (is_write_in_flight(hoid, false))
+    return false;
+  set<shard_id_t> acting;
+  for (auto &&i : get_parent()->get_acting_shards()) {
+    acting.insert(i.shard);
+  }
+  if (acting.size() != ec_impl->get_chunk_count())
+    return false;
+  for (auto &&i : get_parent()->get_acting_recovery_backfill_shards()) {
+    auto m = get_parent()->maybe_get_shard_missing(i);
+    if (m && m->is_missing(hoid))
+      return false;
+  }
+  return true;
+}
+
 bool ECBackend::try_state_to_reads()
 {
   if (waiting_state.empty())
@@ -1868,7 +1910,24 @@ bool ECBackend::try_state_to_reads()
     return false;
   }
 
-  if (!pipeline_state.caching_enabled()) {
+  // a parity delta write bypasses the cache, so the stripes it writes
+  // can only be read back once it has committed
+  for (auto &&hpair: op->plan.to_read) {
+    if (is_write_in_flight(hpair.first, true)) {
+      dout(20) << __func__ << ": blocking " << *op
+	       << " because " << hpair.first
+	       << " has a write bypassing the cache in flight"
+	       << dendl;
+      return false;
+    }
+  }
+
+  if (!op->plan.parity_delta_reads.empty() &&
+      can_update_parity_in_place(op->plan.parity_delta_reads.begin()->first)) {
+    op->parity_delta = true;
+    op->bypasses_cache = true;
+    op->using_cache = false;
+  } else if (!pipeline_state.caching_enabled()) {
     op->using_cache = false;
   } else if (op->invalidates_cache()) {
     dout(20) << __func__ << ": invalidating cache after this op"
@@ -1906,12 +1965,43 @@ bool ECBackend::try_state_to_reads()
 	op->pending_read[hpair.first] = std::move(pending_read);
       }
     }
-  } else {
+  } else if (!op->parity_delta) {
     op->remote_read = op->plan.to_read;
   }
 
   dout(10) << __func__ << ": " << *op << dendl;
 
+  if (op->parity_delta) {
+    auto &&hpair = *(op->plan.parity_delta_reads.begin());
+    objects_read_shards_async(
+      hpair.first,
+      op->plan.to_read[hpair.first],
+      hpair.second,
+      [this, op, hoid=hpair.first](
+	pair<int, ECTransaction::shard_extents_t> &&result) {
+	if (result.first < 0) {
+	  dout(10) << "parity delta read of " << hoid
+		   << " failed with " << result.first
+		   << ", reading the whole stripes" << dendl;
+	  // still not in the cache: keep later reads of the object
+	  // blocked until this op commits
+	  op->parity_delta = false;
+	  op->remote_read = op->plan.to_read;
+	  read_remote_stripes(op);
+	  return;
+	}
+	op->parity_delta_read_result.emplace(hoid, std::move(result.second));
+	check_ops();
+      });
+  } else {
+    read_remote_stripes(op);
+  }
+
+  return true;
+}
+
+void ECBackend::read_remote_stripes(Op *op)
+{
   if (!op->remote_read.empty()) {
     ceph_assert(get_parent()->get_pool().allows_ecoverwrites());
     objects_read_async_no_cache(
@@ -1923,8 +2013,6 @@ bool ECBackend::try_state_to_reads()
 	check_ops();
       });
   }
-
-  return true;
 }
 
 bool ECBackend::try_reads_to_commit()
@@ -1975,6 +2063,7 @@ bool ECBackend::try_reads_to_commit()
       get_parent()->get_info().pgid.pgid,
       sinfo,
       op->remote_read_result,
+      op->parity_delta_read_result,
       op->log_entries,
       &written,
       &trans,
@@ -2003,7 +2092,8 @@ bool ECBackend::try_reads_to_commit()
     written_set[i.first] = i.second.get_interval_set();
   }
   dout(20) << __func__ << ": written_set: " << written_set << dendl;
-  ceph_assert(written_set == op->plan.will_write);
+  // parity delta writes only know the chunks they changed
+  ceph_assert(op->parity_delta || written_set == op->plan.will_write);
 
   if (op->using_cache) {
     for (auto &&hpair: written) {
@@ -2013,6 +2103,7 @@ bool ECBackend::try_reads_to_commit()
   }
   op->remote_read.clear();
   op->remote_read_result.clear();
+  op->parity_delta_read_result.clear();
 
   ObjectStore::Transaction empty;
   bool should_write_local = false;
@@ -2383,6 +2474,86 @@ void ECBackend::objects_read_and_reconstruct(
 }
 
 
+struct CallShardReadContexts :
+  public GenContext<pair<RecoveryMessages*, ECBackend::read_result_t& > &> {
+  hobject_t hoid;
+  ECBackend *ec;
+  set<int> shards;
+  GenContextURef<pair<int, ECTransaction::shard_extents_t> &&> func;
+  CallShardReadContexts(
+    const hobject_t &hoid,
+    ECBackend *ec,
+    const set<int> &shards,
+    GenContextURef<pair<int, ECTransaction::shard_extents_t> &&> &&func)
+    : hoid(hoid), ec(ec), shards(shards), func(std::move(func)) {}
+  void finish(pair<RecoveryMessages *, ECBackend::read_result_t &> &in) override {
+    ECBackend::read_result_t &res = in.second;
+    pair<int, ECTransaction::shard_extents_t> result(res.r, {});
+    if (result.first == 0 && !res.errors.empty()) {
+      result.first = -EIO;
+    }
+    for (auto &&read : res.returned) {
+      if (result.first != 0)
+	break;
+      uint64_t chunk_len =
+	ec->sinfo.aligned_logical_offset_to_chunk_offset(read.get<1>());
+      auto &extent = result.second[read.get<0>()];
+      for (auto &&j : read.get<2>()) {
+	if (shards.count(j.first.shard) && j.second.length() == chunk_len) {
+	  extent[j.first.shard].claim(j.second);
+	}
+      }
+      // the reads may have gone to other shards after an error
+      if (extent.size() != shards.size()) {
+	result.first = -EIO;
+      }
+    }
+    func.release()->complete(std::move(result));
+  }
+};
+
+void ECBackend::objects_read_shards(
+  const hobject_t &hoid,
+  const extent_set &to_read,
+  const set<int> &shards,
+  GenContextURef<pair<int, ECTransaction::shard_extents_t> &&> &&on_complete)
+{
+  map<pg_shard_t, vector<pair<int, int>>> need;
+  for (auto &&i : get_parent()->get_acting_shards()) {
+    if (shards.count(i.shard)) {
+      need[i].push_back(make_pair(0, ec_impl->get_sub_chunk_count()));
+    }
+  }
+  ceph_assert(need.size() == shards.size());
+
+  std::list<boost::tuple<uint64_t, uint64_t, uint32_t> > extents;
+  for (auto &&i : to_read) {
+    ceph_assert(sinfo.logical_offset_is_stripe_aligned(i.first));
+    ceph_assert(sinfo.logical_offset_is_stripe_aligned(i.second));
+    extents.emplace_back(i.first, i.second, 0);
+  }
+
+  map<hobject_t, set<int>> want_to_read;
+  want_to_read[hoid] = shards;
+  map<hobject_t, read_request_t> for_read_op;
+  for_read_op.insert(
+    make_pair(
+      hoid,
+      read_request_t(
+	extents,
+	need,
+	false,
+	new CallShardReadContexts(
+	  hoid, this, shards, std::move(on_complete)))));
+
+  start_read_op(
+    CEPH_MSG_PRIO_DEFAULT,
+    want_to_read,
+    for_read_op,
+    OpRequestRef(),
+    false, false);
+}
+
 int ECBackend::send_all_remaining_reads(
   const hobject_t &hoid,
   ReadOp &rop)
@@ -143,6 +143,7 @@ public:
     GenContextURef<map<hobject_t,pair<int, extent_map> > &&> &&func);
 
   friend struct CallClientContexts;
+  friend struct CallShardReadContexts;
   struct ClientAsyncReadStatus {
     unsigned objects_to_read;
     GenContextURef<map<hobject_t,pair<int, extent_map> > &&> func;
@@ -193,6 +194,32 @@ public:
       map<hobject_t,pair<int, extent_map> > &&, Func>(
 	  std::forward<Func>(on_complete)));
   }
+  /**
+   * Read the stripe aligned logical extents **to_read** of **hoid** from
+   * the given shards only, without decoding: on_complete receives the
+   * content of each shard by logical offset, or an error if any of the
+   * shards could not be read.
+   */
+  void objects_read_shards(
+    const hobject_t &hoid,
+    const extent_set &to_read,
+    const set<int> &shards,
+    GenContextURef<pair<int, ECTransaction::shard_extents_t> &&> &&on_complete);
+
+  template <typename Func>
+  void objects_read_shards_async(
+    const hobject_t &hoid,
+    const extent_set &to_read,
+    const set<int> &shards,
+    Func &&on_complete) {
+    objects_read_shards(
+      hoid,
+      to_read,
+      shards,
+      make_gen_lambda_context<
+      pair<int, ECTransaction::shard_extents_t> &&, Func>(
+	std::forward<Func>(on_complete)));
+  }
   void kick_reads() {
     while (in_progress_client_reads.size() &&
 	   in_progress_client_reads.front().is_complete()) {
@@ -485,7 +512,17 @@ public:
     map<hobject_t,extent_set> pending_read; // subset already being read
     map<hobject_t,extent_set> remote_read;  // subset we must read
     map<hobject_t,extent_map> remote_read_result;
+
+    /// set if the parity is updated in place, see plan_parity_delta()
+    bool parity_delta = false;
+    map<hobject_t,ECTransaction::shard_extents_t> parity_delta_read_result;
+    /// set with parity_delta, but kept until the op commits even if the
+    /// parity delta read fails and the whole stripes are read instead
+    bool bypasses_cache = false;
+
     bool read_in_progress() const {
+      if (parity_delta)
+	return parity_delta_read_result.empty();
       return !remote_read.empty() && remote_read_result.empty();
     }
 
@@ -565,7 +602,10 @@ public:
   eversion_t completed_to;
   eversion_t committed_to;
   void start_rmw(Op *op, PGTransactionUPtr &&t);
+  bool is_write_in_flight(const hobject_t &hoid, bool bypasses_cache) const;
+  bool can_update_parity_in_place(const hobject_t &hoid) const;
   bool try_state_to_reads();
+  void read_remote_stripes(Op *op);
   bool try_reads_to_commit();
   bool try_finish_rmw();
   void check_ops();
@@ -81,6 +81,136 @@ void encode_and_write(
   }
 }
 
+void ECTransaction::encode_and_write_parity_delta(
+  pg_t pgid,
+  const hobject_t &oid,
+  const ECUtil::stripe_info_t &sinfo,
+  ErasureCodeInterfaceRef &ecimpl,
+  uint64_t offset,
+  const map<int, bufferlist> &old_shards,
+  const extent_map &new_data,
+  uint32_t flags,
+  map<shard_id_t, ObjectStore::Transaction> *transactions,
+  DoutPrefixProvider *dpp) {
+  ceph_assert(sinfo.logical_offset_is_stripe_aligned(offset));
+  ceph_assert(!old_shards.empty());
+  const uint64_t k = ecimpl->get_data_chunk_count();
+  const uint64_t chunk_size = sinfo.get_chunk_size();
+  const uint64_t stripe_width = sinfo.get_stripe_width();
+  const uint64_t chunk_len = old_shards.begin()->second.length();
+
+  map<int, bufferlist> old_data;
+  map<int, bufferlist> parity;
+  map<int, bufferptr> updated;
+  for (auto &&i : old_shards) {
+    ceph_assert(i.second.length() == chunk_len);
+    if ((uint64_t)i.first < k) {
+      old_data[i.first] = i.second;
+      bufferptr ptr(buffer::create_page_aligned(chunk_len));
+      i.second.begin().copy(chunk_len, ptr.c_str());
+      updated[i.first] = std::move(ptr);
+    } else {
+      parity[i.first] = i.second;
+    }
+  }
+
+  // scatter the new data into the chunks it lands in
+  for (auto &&extent : new_data) {
+    uint64_t off = extent.get_off();
+    uint64_t end = off + extent.get_len();
+    ceph_assert(off >= offset);
+    ceph_assert(end <= offset +
+		sinfo.aligned_chunk_offset_to_logical_offset(chunk_len));
+    auto p = extent.get_val().cbegin();
+    while (off < end) {
+      uint64_t in_stripe = off % stripe_width;
+      int chunk = in_stripe / chunk_size;
+      uint64_t in_chunk = in_stripe % chunk_size;
+      uint64_t len = std::min(chunk_size - in_chunk, end - off);
+      auto u = updated.find(chunk);
+      ceph_assert(u != updated.end());
+      p.copy(len,
+	     u->second.c_str() +
+	     sinfo.aligned_logical_offset_to_chunk_offset(
+	       sinfo.logical_to_prev_stripe_offset(off) - offset) +
+	     in_chunk);
+      off += len;
+    }
+  }
+
+  map<int, bufferlist> new_shards;
+  for (auto &&i : updated) {
+    new_shards[i.first].push_back(std::move(i.second));
+  }
+  int r = ECUtil::encode_parity_delta(
+    sinfo, ecimpl, old_data, new_shards, &parity);
+  ceph_assert(r == 0);
+  new_shards.insert(parity.begin(), parity.end());
+
+  ldpp_dout(dpp, 20) << __func__ << ": " << oid
+		     << " updating shards " << new_shards.size()
+		     << " at " << sinfo.aligned_logical_offset_to_chunk_offset(
+		       offset)
+		     << "~" << chunk_len
+		     << dendl;
+
+  for (auto &&i : new_shards) {
+    auto t = transactions->find(shard_id_t(i.first));
+    if (t == transactions->end())
+      continue;
+    t->second.write(
+      coll_t(spg_t(pgid, t->first)),
+      ghobject_t(oid, ghobject_t::NO_GEN, t->first),
+      sinfo.aligned_logical_offset_to_chunk_offset(offset),
+      chunk_len,
+      i.second,
+      flags);
+  }
+}
+
+void ECTransaction::plan_parity_delta(
+  const ECUtil::stripe_info_t &sinfo,
+  ErasureCodeInterfaceRef &ecimpl,
+  WritePlan &plan)
+{
+  if (!(ecimpl->get_supported_optimizations() &
+	ErasureCodeInterface::FLAG_EC_PLUGIN_PARITY_DELTA_OPTIMIZATION))
+    return;
+  // every stripe written must be one that is partially overwritten
+  if (plan.invalidates_cache ||
+      plan.to_read.size() != 1 ||
+      plan.to_read != plan.will_write ||
+      plan.t->op_map.size() != 1)
+    return;
+  const hobject_t &oid = plan.to_read.begin()->first;
+  auto &op = plan.t->op_map.begin()->second;
+  if (plan.t->op_map.begin()->first != oid ||
+      !op.is_none() ||
+      op.truncate ||
+      op.buffer_updates.empty())
+    return;
+
+  const uint64_t k = ecimpl->get_data_chunk_count();
+  const uint64_t chunk_size = sinfo.get_chunk_size();
+  const uint64_t stripe_width = sinfo.get_stripe_width();
+  const uint64_t m = ecimpl->get_chunk_count() - k;
+  set<int> shards;
+  for (auto &&extent : op.buffer_updates) {
+    uint64_t off = extent.get_off();
+    uint64_t end = off + extent.get_len();
+    while (off < end) {
+      shards.insert((off % stripe_width) / chunk_size);
+      if (shards.size() + m >= k)
+	return;
+      off = (off / chunk_size + 1) * chunk_size;
+    }
+  }
+  for (uint64_t i = k; i < k + m; ++i) {
+    shards.insert(i);
+  }
+  plan.parity_delta_reads[oid] = std::move(shards);
+}
+
 bool ECTransaction::requires_overwrite(
   uint64_t prev_size,
   const PGTransaction::ObjectOperation &op) {
@@ -100,6 +230,7 @@ void ECTransaction::generate_transactions(
   pg_t pgid,
   const ECUtil::stripe_info_t &sinfo,
   const map<hobject_t,extent_map> &partial_extents,
+  const map<hobject_t,shard_extents_t> &parity_delta_extents,
   vector<pg_log_entry_t> &entries,
   map<hobject_t,extent_map> *written_map,
   map<shard_id_t, ObjectStore::Transaction> *transactions,
@@ -538,6 +669,56 @@ void ECTransaction::generate_transactions(
 			   << dendl;
       }
 
+      auto pditer = parity_delta_extents.find(oid);
+      if (pditer != parity_delta_extents.end()) {
+	/* Only the shards that were read change: the stripes are
+	 * still saved whole on every shard for rollback. */
+	ceph_assert(!op.truncate);
+	ceph_assert(new_size == orig_size);
+	for (auto &&pextent : pditer->second) {
+	  ceph_assert(!pextent.second.empty());
+	  uint64_t restore_from = sinfo.aligned_logical_offset_to_chunk_offset(
+	    pextent.first);
+	  uint64_t restore_len = pextent.second.begin()->second.length();
+	  uint64_t len = sinfo.aligned_chunk_offset_to_logical_offset(
+	    restore_len);
+	  ldpp_dout(dpp, 20) << __func__ << ": overwriting parity delta "
+			     << restore_from << "~" << restore_len
+			     << dendl;
+	  if (entry) {
+	    if (rollback_extents.empty()) {
+	      for (auto &&st : *transactions) {
+		st.second.touch(
+		  coll_t(spg_t(pgid, st.first)),
+		  ghobject_t(oid, entry->version.version, st.first));
+	      }
+	    }
+	    rollback_extents.emplace_back(make_pair(restore_from, restore_len));
+	    for (auto &&st : *transactions) {
+	      st.second.clone_range(
+		coll_t(spg_t(pgid, st.first)),
+		ghobject_t(oid, ghobject_t::NO_GEN, st.first),
+		ghobject_t(oid, entry->version.version, st.first),
+		restore_from,
+		restore_len,
+		restore_from);
+	    }
+	  }
+	  encode_and_write_parity_delta(
+	    pgid,
+	    oid,
+	    sinfo,
+	    ecimpl,
+	    pextent.first,
+	    pextent.second,
+	    to_write.intersect(pextent.first, len),
+	    fadvise_flags,
+	    transactions,
+	    dpp);
+	}
+	to_write.clear();
+      }
+
       set<int> want;
       for (unsigned i = 0; i < ecimpl->get_chunk_count(); ++i) {
 	want.insert(i);
@@ -30,8 +30,14 @@ namespace ECTransaction {
     map<hobject_t,extent_set> will_write; // superset of to_read
 
     map<hobject_t,ECUtil::HashInfoRef> hash_infos;
+
+    /// shards to read to update the parity in place, see plan_parity_delta()
+    map<hobject_t,set<int>> parity_delta_reads;
   };
 
+  /// old shard contents of a stripe aligned logical offset, by shard
+  typedef map<uint64_t, map<int, bufferlist>> shard_extents_t;
+
   bool requires_overwrite(
     uint64_t prev_size,
     const PGTransaction::ObjectOperation &op);
@@ -182,12 +188,42 @@ namespace ECTransaction {
     return plan;
   }
 
+  /**
+   * Fill plan.parity_delta_reads if the stripes overwritten by the plan can
+   * have their parity updated from the old contents of the data chunks the
+   * write touches, rather than from the whole stripes. This is limited to
+   * plain overwrites of a single object within its current size, and only
+   * kept when it reads fewer shards than the full stripe does.
+   */
+  void plan_parity_delta(
+    const ECUtil::stripe_info_t &sinfo,
+    ErasureCodeInterfaceRef &ecimpl,
+    WritePlan &plan);
+
+  /**
+   * Write the stripe aligned range at **offset** with **new_data**
+   * overlaid, given the old contents of the data chunks it changes and of
+   * the coding chunks in **old_shards**. Only those shards are written.
+   */
+  void encode_and_write_parity_delta(
+    pg_t pgid,
+    const hobject_t &oid,
+    const ECUtil::stripe_info_t &sinfo,
+    ErasureCodeInterfaceRef &ecimpl,
+    uint64_t offset,
+    const map<int, bufferlist> &old_shards,
+    const extent_map &new_data,
+    uint32_t flags,
+    map<shard_id_t, ObjectStore::Transaction> *transactions,
+    DoutPrefixProvider *dpp);
+
   void generate_transactions(
     WritePlan &plan,
     ErasureCodeInterfaceRef &ecimpl,
     pg_t pgid,
     const ECUtil::stripe_info_t &sinfo,
     const map<hobject_t,extent_map> &partial_extents,
+    const map<hobject_t,shard_extents_t> &parity_delta_extents,
     vector<pg_log_entry_t> &entries,
     map<hobject_t,extent_map> *written,
     map<shard_id_t, ObjectStore::Transaction> *transactions,
@@ -28,18 +28,27 @@ int ECUtil::decode(
   if (total_data_size == 0)
     return 0;
 
+  // recover all the stripes at once, then interleave the data chunks
+  // back into logical order
+  const vector<int> &mapping = ec_impl->get_chunk_mapping();
+  unsigned int k = ec_impl->get_data_chunk_count();
+  set<int> want;
+  vector<int> data_chunks(k);
+  for (unsigned int i = 0; i < k; i++) {
+    data_chunks[i] = mapping.size() > i ? mapping[i] : i;
+    want.insert(data_chunks[i]);
+  }
+  map<int, bufferlist> decoded;
+  int r = ec_impl->decode_stripes(want, to_decode, sinfo.get_chunk_size(),
+				  &decoded);
+  ceph_assert(r == 0);
   for (uint64_t i = 0; i < total_data_size; i += sinfo.get_chunk_size()) {
-    map<int, bufferlist> chunks;
-    for (map<int, bufferlist>::iterator j = to_decode.begin();
-	 j != to_decode.end();
-	 ++j) {
-      chunks[j->first].substr_of(j->second, i, sinfo.get_chunk_size());
+    for (auto j : data_chunks) {
+      ceph_assert(decoded[j].length() == total_data_size);
+      bufferlist bl;
+      bl.substr_of(decoded[j], i, sinfo.get_chunk_size());
+      out->claim_append(bl);
     }
-    bufferlist bl;
-    int r = ec_impl->decode_concat(chunks, &bl);
-    ceph_assert(r == 0);
-    ceph_assert(bl.length() == sinfo.get_stripe_width());
-    out->claim_append(bl);
   }
   return 0;
 }
@@ -133,19 +142,8 @@ int ECUtil::encode(
   if (logical_size == 0)
     return 0;
 
-  for (uint64_t i = 0; i < logical_size; i += sinfo.get_stripe_width()) {
-    map<int, bufferlist> encoded;
-    bufferlist buf;
-    buf.substr_of(in, i, sinfo.get_stripe_width());
-    int r = ec_impl->encode(want, buf, &encoded);
-    ceph_assert(r == 0);
-    for (map<int, bufferlist>::iterator i = encoded.begin();
-	 i != encoded.end();
-	 ++i) {
-      ceph_assert(i->second.length() == sinfo.get_chunk_size());
-      (*out)[i->first].claim_append(i->second);
-    }
-  }
+  int r = ec_impl->encode_stripes(want, in, sinfo.get_chunk_size(), out);
+  ceph_assert(r == 0);
 
   for (map<int, bufferlist>::iterator i = out->begin();
        i != out->end();
@@ -158,6 +156,37 @@ int ECUtil::encode(
   return 0;
 }
 
+int ECUtil::encode_parity_delta(
+  const stripe_info_t &sinfo,
+  ErasureCodeInterfaceRef &ec_impl,
+  const map<int, bufferlist> &old_data,
+  const map<int, bufferlist> &new_data,
+  map<int, bufferlist> *parity) {
+  ceph_assert(parity);
+  ceph_assert(old_data.size() == new_data.size());
+  ceph_assert(ec_impl->get_supported_optimizations() &
+	      ErasureCodeInterface::FLAG_EC_PLUGIN_PARITY_DELTA_OPTIMIZATION);
+
+  map<int, bufferlist> deltas;
+  for (auto &&i : old_data) {
+    auto j = new_data.find(i.first);
+    ceph_assert(j != new_data.end());
+    ceph_assert(i.second.length() % sinfo.get_chunk_size() == 0);
+    ec_impl->encode_delta(i.second, j->second, &deltas[i.first]);
+  }
+
+  // the buffers given back must not alias the shard reads they came from
+  for (auto &&i : *parity) {
+    ceph_assert(i.second.length() % sinfo.get_chunk_size() == 0);
+    bufferptr ptr(buffer::create_page_aligned(i.second.length()));
+    i.second.begin().copy(i.second.length(), ptr.c_str());
+    i.second.clear();
+    i.second.push_back(std::move(ptr));
+  }
+  // every stripe of the range is coded the same way: one call covers them
+  return ec_impl->apply_delta(deltas, parity);
+}
+
 void ECUtil::HashInfo::append(uint64_t old_size,
 			      map<int, bufferlist> &to_append) {
   ceph_assert(old_size == total_chunk_size);
@@ -98,6 +98,19 @@ int encode(
   const std::set<int> &want,
   std::map<int, bufferlist> *out);
 
+/**
+ * Update the coding chunks of a stripe aligned range in place: **parity**
+ * holds the old coding chunks on input and the new ones on output, given
+ * the old and new contents of the data chunks that changed in the range.
+ * All the buffers cover the same range of the shards.
+ */
+int encode_parity_delta(
+  const stripe_info_t &sinfo,
+  ErasureCodeInterfaceRef &ec_impl,
+  const std::map<int, bufferlist> &old_data,
+  const std::map<int, bufferlist> &new_data,
+  std::map<int, bufferlist> *parity);
+
 class HashInfo {
   uint64_t total_chunk_size = 0;
   std::vector<uint32_t> cumulative_shard_hashes;
@@ -54,6 +54,7 @@
 #include "common/pick_address.h"
 #include "common/blkdev.h"
 #include "common/numa.h"
+#include "common/load_concurrently.h"
 
 #include "os/ObjectStore.h"
 #ifdef HAVE_LIBFUSE
@@ -4619,7 +4620,7 @@ void OSD::load_pgs()
     derr << "failed to list pgs: " << cpp_strerror(-r) << dendl;
   }
 
-  int num = 0;
+  vector<PGRef> to_load;
   for (vector<coll_t>::iterator it = ls.begin();
        it != ls.end();
        ++it) {
@@ -4673,35 +4674,47 @@ void OSD::load_pgs()
       continue;
     }
 
-    // there can be no waiters here, so we don't call _wake_pg_slot
-
-    pg->lock();
-    pg->ch = store->open_collection(pg->coll);
-
-    // read pg state, log
-    pg->read_state(store);
+    to_load.push_back(pg);
+  }
 
-    if (pg->dne())  {
-      dout(10) << "load_pgs " << *it << " deleting dne" << dendl;
-      pg->ch = nullptr;
+  // Reading the state and log of a PG walks the omap of its pgmeta
+  // object, which dominates the boot of an OSD with many PGs: read
+  // them concurrently and register each PG as soon as it is loaded.
+  int num = 0;
+  ceph::load_concurrently(
+    "load_pgs", to_load,
+    cct->_conf.get_val<uint64_t>("osd_load_pgs_threads"),
+    [this](const PGRef& pg) {
+      pg->lock();
+      pg->ch = store->open_collection(pg->coll);
+      pg->read_state(store);
       pg->unlock();
-      recursive_remove_collection(cct, store, pgid, *it);
-      continue;
-    }
-    {
-      uint32_t shard_index = pgid.hash_to_shard(shards.size());
-      assert(NULL != shards[shard_index]);
-      store->set_collection_commit_queue(pg->coll, &(shards[shard_index]->context_queue));
-    }
+    },
+    [this, &num](const PGRef& pg) {
+      // there can be no waiters here, so we don't call _wake_pg_slot
+
+      pg->lock();
+      if (pg->dne())  {
+	dout(10) << "load_pgs " << pg->coll << " deleting dne" << dendl;
+	pg->ch = nullptr;
+	pg->unlock();
+	recursive_remove_collection(cct, store, pg->pg_id, pg->coll);
+	return;
+      }
+      {
+	uint32_t shard_index = pg->pg_id.hash_to_shard(shards.size());
+	assert(NULL != shards[shard_index]);
+	store->set_collection_commit_queue(pg->coll, &(shards[shard_index]->context_queue));
+      }
 
-    pg->reg_next_scrub();
+      pg->reg_next_scrub();
 
-    dout(10) << __func__ << " loaded " << *pg << dendl;
-    pg->unlock();
+      dout(10) << "load_pgs loaded " << *pg << dendl;
+      pg->unlock();
 
-    register_pg(pg);
-    ++num;
-  }
+      register_pg(pg);
+      ++num;
+    });
   dout(0) << __func__ << " opened " << num << " pgs" << dendl;
 }
 
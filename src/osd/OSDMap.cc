@@ -2616,17 +2616,8 @@ void OSDMap::_pg_to_up_acting_osds(
   _get_temp_osds(*pool, pg, &_acting, &_acting_primary);
   if (_acting.empty() || up || up_primary) {
     _pg_to_raw_osds(*pool, pg, &raw, &pps);
-    _apply_upmap(*pool, pg, &raw);
-    _raw_to_up_osds(*pool, raw, &_up);
-    _up_primary = _pick_primary(_up);
-    _apply_primary_affinity(pps, *pool, &_up, &_up_primary);
-    if (_acting.empty()) {
-      _acting = _up;
-      if (_acting_primary == -1) {
-        _acting_primary = _up_primary;
-      }
-    }
-  
+    _raw_to_up_acting_osds(*pool, pg, pps, &raw, &_up, &_up_primary,
+			   &_acting, &_acting_primary);
     if (up)
       up->swap(_up);
     if (up_primary)
@@ -2639,6 +2630,61 @@ void OSDMap::_pg_to_up_acting_osds(
     *acting_primary = _acting_primary;
 }
 
+void OSDMap::_raw_to_up_acting_osds(
+  const pg_pool_t& pool, pg_t pg, ps_t pps,
+  vector<int> *raw,
+  vector<int> *up, int *up_primary,
+  vector<int> *acting, int *acting_primary) const
+{
+  _apply_upmap(pool, pg, raw);
+  _raw_to_up_osds(pool, *raw, up);
+  *up_primary = _pick_primary(*up);
+  _apply_primary_affinity(pps, pool, up, up_primary);
+  if (acting->empty()) {
+    *acting = *up;
+    if (*acting_primary == -1) {
+      *acting_primary = *up_primary;
+    }
+  }
+}
+
+void OSDMap::pg_range_to_up_acting_osds(
+  int64_t poolid, unsigned ps_begin, unsigned ps_end,
+  const pg_range_mapping_cb_t& cb) const
+{
+  const pg_pool_t *pool = get_pg_pool(poolid);
+  if (!pool) {
+    for (unsigned ps = ps_begin; ps < ps_end; ++ps) {
+      cb(ps, {}, -1, {}, -1);
+    }
+    return;
+  }
+  ceph_assert(ps_begin <= ps_end);
+  vector<int> ppss(ps_end - ps_begin);
+  for (unsigned ps = ps_begin; ps < ps_end; ++ps) {
+    ppss[ps - ps_begin] = pool->raw_pg_to_pps(pg_t(ps, poolid));
+  }
+  vector<vector<int>> raws;
+  unsigned size = pool->get_size();
+  int ruleno = crush->find_rule(pool->get_crush_rule(), pool->get_type(), size);
+  if (ruleno >= 0) {
+    crush->do_rule_batch(ruleno, ppss, &raws, size, osd_weight, poolid);
+  } else {
+    raws.resize(ppss.size());
+  }
+  for (unsigned ps = ps_begin; ps < ps_end; ++ps) {
+    pg_t pg(ps, poolid);
+    vector<int>& raw = raws[ps - ps_begin];
+    vector<int> up, acting;
+    int up_primary, acting_primary;
+    _remove_nonexistent_osds(*pool, raw);
+    _get_temp_osds(*pool, pg, &acting, &acting_primary);
+    _raw_to_up_acting_osds(*pool, pg, ppss[ps - ps_begin], &raw,
+			   &up, &up_primary, &acting, &acting_primary);
+    cb(ps, std::move(up), up_primary, std::move(acting), acting_primary);
+  }
+}
+
 int OSDMap::calc_pg_rank(int osd, const vector<int>& acting, int nrep)
 {
   if (!nrep)
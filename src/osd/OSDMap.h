@@ -24,6 +24,7 @@
  *   disks, disk groups, total # osds,
  *
  */
+#include <functional>
 #include <vector>
 #include <list>
 #include <set>
@@ -1187,6 +1188,13 @@ private:
   void _get_temp_osds(const pg_pool_t& pool, pg_t pg,
                       std::vector<int> *temp_pg, int *temp_primary) const;
 
+  /// raw osds -> up and acting, given the pg temp mappings
+  void _raw_to_up_acting_osds(const pg_pool_t& pool, pg_t pg, ps_t pps,
+			      std::vector<int> *raw,
+			      std::vector<int> *up, int *up_primary,
+			      std::vector<int> *acting,
+			      int *acting_primary) const;
+
   /**
    *  map to up and acting. Fills in whatever fields are non-NULL.
    */
@@ -1232,6 +1240,20 @@ public:
     int up_primary, acting_primary;
     pg_to_up_acting_osds(pg, &up, &up_primary, &acting, &acting_primary);
   }
+  using pg_range_mapping_cb_t = std::function<void(
+    unsigned ps,
+    std::vector<int>&& up, int up_primary,
+    std::vector<int>&& acting, int acting_primary)>;
+  /**
+   * map pgs [ps_begin, ps_end) of a pool to their up and acting sets,
+   * like pg_to_up_acting_osds(), calling cb for each of them.
+   *
+   * The CRUSH placement of the whole range is computed in one batch,
+   * which is much cheaper than mapping the pgs one by one.
+   */
+  void pg_range_to_up_acting_osds(int64_t pool,
+				  unsigned ps_begin, unsigned ps_end,
+				  const pg_range_mapping_cb_t& cb) const;
   bool pg_is_ec(pg_t pg) const {
     auto i = pools.find(pg.pool());
     ceph_assert(i != pools.end());
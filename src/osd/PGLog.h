@@ -1372,24 +1372,26 @@ public:
     list<pg_log_dup_t> dups;
     if (p) {
       for (p->seek_to_first(); p->valid() ; p->next()) {
+	// key() builds a new string each time: fetch it once per entry
+	const string key = p->key();
 	// non-log pgmeta_oid keys are prefixed with _; skip those
-	if (p->key()[0] == '_')
+	if (key[0] == '_')
 	  continue;
 	bufferlist bl = p->value();//Copy bufferlist before creating iterator
 	auto bp = bl.cbegin();
-	if (p->key() == "divergent_priors") {
+	if (key == "divergent_priors") {
 	  decode(divergent_priors, bp);
 	  ldpp_dout(dpp, 20) << "read_log_and_missing " << divergent_priors.size()
 			     << " divergent_priors" << dendl;
 	  must_rebuild = true;
 	  debug_verify_stored_missing = false;
-	} else if (p->key() == "can_rollback_to") {
+	} else if (key == "can_rollback_to") {
 	  decode(on_disk_can_rollback_to, bp);
-	} else if (p->key() == "rollback_info_trimmed_to") {
+	} else if (key == "rollback_info_trimmed_to") {
 	  decode(on_disk_rollback_info_trimmed_to, bp);
-	} else if (p->key() == "may_include_deletes_in_missing") {
+	} else if (key == "may_include_deletes_in_missing") {
 	  missing.may_include_deletes = true;
-	} else if (p->key().substr(0, 7) == string("missing")) {
+	} else if (key.compare(0, 7, "missing") == 0) {
 	  hobject_t oid;
 	  pg_missing_item item;
 	  decode(oid, bp);
@@ -1399,25 +1401,25 @@ public:
 	    ceph_assert(missing.may_include_deletes);
 	  }
 	  missing.add(oid, std::move(item));
-	} else if (p->key().substr(0, 4) == string("dup_")) {
+	} else if (key.compare(0, 4, "dup_") == 0) {
 	  pg_log_dup_t dup;
 	  decode(dup, bp);
 	  if (!dups.empty()) {
 	    ceph_assert(dups.back().version < dup.version);
 	  }
-	  dups.push_back(dup);
+	  dups.push_back(std::move(dup));
 	} else {
 	  pg_log_entry_t e;
 	  e.decode_with_checksum(bp);
 	  ldpp_dout(dpp, 20) << "read_log_and_missing " << e << dendl;
 	  if (!entries.empty()) {
-	    pg_log_entry_t last_e(entries.back());
+	    const pg_log_entry_t &last_e = entries.back();
 	    ceph_assert(last_e.version.version < e.version.version);
 	    ceph_assert(last_e.version.epoch <= e.version.epoch);
 	  }
-	  entries.push_back(e);
 	  if (log_keys_debug)
 	    log_keys_debug->insert(e.get_key_name());
+	  entries.push_back(std::move(e));
 	}
       }
     }
@@ -7385,28 +7385,20 @@ int PrimaryLogPG::do_osd_ops(OpContext *ctx, vector<OSDOp>& ops)
 	bool truncated = false;
 	bufferlist bl;
 	if (oi.is_omap()) {
-	  ObjectMap::ObjectMapIterator iter = osd->store->get_omap_iterator(
-	    ch, ghobject_t(soid)
-	    );
-          if (!iter) {
-            result = -ENOENT;
-            goto fail;
-          }
-	  iter->upper_bound(start_after);
-	  if (filter_prefix > start_after) iter->lower_bound(filter_prefix);
-	  for (num = 0;
-	       iter->valid() &&
-		 iter->key().substr(0, filter_prefix.size()) == filter_prefix;
-	       ++num, iter->next()) {
-	    dout(20) << "Found key " << iter->key() << dendl;
-	    if (num >= max_return ||
-		bl.length() >= cct->_conf->osd_max_omap_bytes_per_request) {
-	      truncated = true;
-	      break;
-	    }
-	    encode(iter->key(), bl);
-	    encode(iter->value(), bl);
+	  map<string, bufferlist> out_set;
+	  int r = osd->store->omap_get_range(
+	    ch, ghobject_t(soid), start_after, filter_prefix, max_return,
+	    cct->_conf->osd_max_omap_bytes_per_request, &out_set, &truncated);
+	  if (r < 0) {
+	    result = r;
+	    goto fail;
+	  }
+	  for (auto& [key, value] : out_set) {
+	    dout(20) << "Found key " << key << dendl;
+	    encode(key, bl);
+	    encode(value, bl);
 	  }
+	  num = out_set.size();
 	} // else return empty out_set
 	encode(num, osd_op.outdata);
 	osd_op.outdata.claim_append(bl);
@@ -34,6 +34,7 @@
 #include "common/ceph_time.h"
 #include "common/ceph_timer.h"
 #include "common/config_obs.h"
+#include "common/sharded_shared_mutex.h"
 #include "common/shunique_lock.h"
 #include "common/zipkin_trace.h"
 #include "common/Finisher.h"
@@ -1328,7 +1329,11 @@ private:
   version_t last_seen_osdmap_version = 0;
   version_t last_seen_pgmap_version = 0;
 
-  mutable std::shared_mutex rwlock;
+  // Guards the osdmap and the op/session registries.  Nearly every
+  // acquisition is shared (op submit, op reply, target calculation), so
+  // shard it per thread to keep concurrent submitters from bouncing one
+  // reader count between cores; per-op state is under OSDSession::lock.
+  mutable ceph::sharded_shared_mutex<> rwlock;
   using lock_guard = std::lock_guard<decltype(rwlock)>;
   using unique_lock = std::unique_lock<decltype(rwlock)>;
   using shared_lock = boost::shared_lock<decltype(rwlock)>;
@@ -2045,7 +2050,7 @@ public:
   }
 
 private:
-  void _check_op_pool_dne(Op *op, unique_lock *sl);
+  void _check_op_pool_dne(Op *op, OSDSession::unique_lock *sl);
   void _send_op_map_check(Op *op);
   void _op_cancel_map_check(Op *op);
   void _check_linger_pool_dne(LingerOp *op, bool *need_unregister);
@@ -6213,7 +6213,7 @@ next:
       RGWRados::ent_map_t result;
       int r =
 	store->getRados()->cls_bucket_list_ordered(bucket_info, RGW_NO_SHARD, marker,
-				       prefix, 1000, true,
+				       prefix, string(), 1000, true,
 				       result, &is_truncated, &marker,
                                        null_yield,
 				       bucket_object_check_filter);
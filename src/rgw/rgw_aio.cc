@@ -45,14 +45,14 @@ void cb(librados::completion_t, void* arg) {
 }
 
 template <typename Op>
-Aio::OpFunc aio_abstract(Op&& op) {
-  return [op = std::move(op)] (Aio* aio, AioResult& r) mutable {
+Aio::OpFunc aio_abstract(Op&& op, int flags) {
+  return [op = std::move(op), flags] (Aio* aio, AioResult& r) mutable {
       constexpr bool read = std::is_same_v<std::decay_t<Op>, librados::ObjectReadOperation>;
       auto s = new (&r.user_data) state(aio, r);
       if constexpr (read) {
-        r.result = r.obj.aio_operate(s->c, &op, &r.data);
+        r.result = r.obj.aio_operate(s->c, &op, flags, &r.data);
       } else {
-        r.result = r.obj.aio_operate(s->c, &op);
+        r.result = r.obj.aio_operate(s->c, &op, flags);
       }
       if (r.result < 0) {
         s->c->release();
@@ -79,9 +79,9 @@ struct Handler {
 };
 
 template <typename Op>
-Aio::OpFunc aio_abstract(Op&& op, boost::asio::io_context& context,
+Aio::OpFunc aio_abstract(Op&& op, int flags, boost::asio::io_context& context,
                          boost::asio::yield_context yield) {
-  return [op = std::move(op), &context, yield] (Aio* aio, AioResult& r) mutable {
+  return [op = std::move(op), flags, &context, yield] (Aio* aio, AioResult& r) mutable {
       // arrange for the completion Handler to run on the yield_context's strand
       // executor so it can safely call back into Aio without locking
       using namespace boost::asio;
@@ -89,35 +89,42 @@ Aio::OpFunc aio_abstract(Op&& op, boost::asio::io_context& context,
       auto ex = get_associated_executor(init.completion_handler);
 
       auto& ref = r.obj.get_ref();
-      librados::async_operate(context, ref.pool.ioctx(), ref.obj.oid, &op, 0,
+      librados::async_operate(context, ref.pool.ioctx(), ref.obj.oid, &op, flags,
                               bind_executor(ex, Handler{aio, r}));
     };
 }
 #endif // HAVE_BOOST_CONTEXT
 
 template <typename Op>
-Aio::OpFunc aio_abstract(Op&& op, optional_yield y) {
+Aio::OpFunc aio_abstract(Op&& op, int flags, optional_yield y) {
   static_assert(std::is_base_of_v<librados::ObjectOperation, std::decay_t<Op>>);
   static_assert(!std::is_lvalue_reference_v<Op>);
   static_assert(!std::is_const_v<Op>);
 #ifdef HAVE_BOOST_CONTEXT
   if (y) {
-    return aio_abstract(std::forward<Op>(op), y.get_io_context(),
+    return aio_abstract(std::forward<Op>(op), flags, y.get_io_context(),
                         y.get_yield_context());
   }
 #endif
-  return aio_abstract(std::forward<Op>(op));
+  return aio_abstract(std::forward<Op>(op), flags);
 }
 
 } // anonymous namespace
 
 Aio::OpFunc Aio::librados_op(librados::ObjectReadOperation&& op,
-                             optional_yield y) {
-  return aio_abstract(std::move(op), y);
+                             optional_yield y, int flags) {
+  return aio_abstract(std::move(op), flags, y);
 }
 Aio::OpFunc Aio::librados_op(librados::ObjectWriteOperation&& op,
-                             optional_yield y) {
-  return aio_abstract(std::move(op), y);
+                             optional_yield y, int flags) {
+  return aio_abstract(std::move(op), flags, y);
+}
+Aio::OpFunc Aio::data_op(bufferlist&& bl) {
+  return [bl = std::move(bl)] (Aio* aio, AioResult& r) mutable {
+      r.result = 0;
+      r.data = std::move(bl);
+      aio->put(r);
+    };
 }
 
 } // namespace rgw
@@ -91,10 +91,13 @@ class Aio {
   // wait for all outstanding completions and return their results
   virtual AioResultList drain() = 0;
 
+  // flags are librados::OPERATION_*
   static OpFunc librados_op(librados::ObjectReadOperation&& op,
-                            optional_yield y);
+                            optional_yield y, int flags = 0);
   static OpFunc librados_op(librados::ObjectWriteOperation&& op,
-                            optional_yield y);
+                            optional_yield y, int flags = 0);
+  // complete immediately with data that is already at hand
+  static OpFunc data_op(bufferlist&& bl);
 };
 
 } // namespace rgw
@@ -1015,7 +1015,7 @@ int RGWBucket::check_object_index(RGWBucketAdminOpState& op_state,
     RGWRados::ent_map_t result;
 
     int r = store->getRados()->cls_bucket_list_ordered(bucket_info, RGW_NO_SHARD,
-					   marker, prefix, 1000, true,
+					   marker, prefix, string(), 1000, true,
 					   result, &is_truncated, &marker,
                                            y,
 					   bucket_object_check_filter);
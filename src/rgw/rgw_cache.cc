@@ -11,13 +11,19 @@
 
 int ObjectCache::get(const string& name, ObjectCacheInfo& info, uint32_t mask, rgw_cache_entry_info *cache_info)
 {
+  if (!enabled) {
+    return -ENOENT;
+  }
 
-  std::shared_lock rl{lock};
+  Shard& shard = shard_of(name);
+  std::shared_lock rl{shard.lock};
+  std::unique_lock wl{shard.lock, std::defer_lock};
+  // set_enabled(false) flips the flag under every shard lock
   if (!enabled) {
     return -ENOENT;
   }
-  auto iter = cache_map.find(name);
-  if (iter == cache_map.end()) {
+  auto iter = shard.cache_map.find(name);
+  if (iter == shard.cache_map.end()) {
     ldout(cct, 10) << "cache get: name=" << name << " : miss" << dendl;
     if (perfcounter) {
       perfcounter->inc(l_rgw_cache_miss);
@@ -29,14 +35,14 @@ int ObjectCache::get(const string& name, ObjectCacheInfo& info, uint32_t mask, r
        (ceph::coarse_mono_clock::now() - iter->second.info.time_added) > expiry) {
     ldout(cct, 10) << "cache get: name=" << name << " : expiry miss" << dendl;
     rl.unlock();
-    std::unique_lock wl{lock};  // write lock for insertion
+    wl.lock();  // write lock for removal
     // check that wasn't already removed by other thread
-    iter = cache_map.find(name);
-    if (iter != cache_map.end()) {
+    iter = shard.cache_map.find(name);
+    if (iter != shard.cache_map.end()) {
       for (auto &kv : iter->second.chained_entries)
         kv.first->invalidate(kv.second);
-      remove_lru(name, iter->second.lru_iter);
-      cache_map.erase(iter);
+      remove_lru(shard, iter->second);
+      shard.cache_map.erase(iter);
     }
     if (perfcounter) {
       perfcounter->inc(l_rgw_cache_miss);
@@ -46,14 +52,16 @@ int ObjectCache::get(const string& name, ObjectCacheInfo& info, uint32_t mask, r
 
   ObjectCacheEntry *entry = &iter->second;
 
-  if (lru_counter - entry->lru_promotion_ts > lru_window) {
-    ldout(cct, 20) << "cache get: touching lru, lru_counter=" << lru_counter
+  // the common case only needs the shard's read lock; entries are
+  // re-queued on the LRU at most once per lru_window touches
+  if (shard.lru_counter - entry->lru_promotion_ts > lru_window) {
+    ldout(cct, 20) << "cache get: touching lru, lru_counter=" << shard.lru_counter
                    << " promotion_ts=" << entry->lru_promotion_ts << dendl;
     rl.unlock();
-    std::unique_lock wl{lock};  // write lock for insertion
+    wl.lock();  // write lock for promotion
     /* need to redo this because entry might have dropped off the cache */
-    iter = cache_map.find(name);
-    if (iter == cache_map.end()) {
+    iter = shard.cache_map.find(name);
+    if (iter == shard.cache_map.end()) {
       ldout(cct, 10) << "lost race! cache get: name=" << name << " : miss" << dendl;
       if(perfcounter) perfcounter->inc(l_rgw_cache_miss);
       return -ENOENT;
@@ -61,8 +69,8 @@ int ObjectCache::get(const string& name, ObjectCacheInfo& info, uint32_t mask, r
 
     entry = &iter->second;
     /* check again, we might have lost a race here */
-    if (lru_counter - entry->lru_promotion_ts > lru_window) {
-      touch_lru(name, *entry, iter->second.lru_iter);
+    if (shard.lru_counter - entry->lru_promotion_ts > lru_window) {
+      touch_lru(shard, name, *entry);
     }
   }
 
@@ -91,8 +99,21 @@ int ObjectCache::get(const string& name, ObjectCacheInfo& info, uint32_t mask, r
 bool ObjectCache::chain_cache_entry(std::initializer_list<rgw_cache_entry_info*> cache_info_entries,
 				    RGWChainedCache::Entry *chained_entry)
 {
-  std::unique_lock l{lock};
+  if (!enabled) {
+    return false;
+  }
 
+  /* lock every shard involved, in index order */
+  std::array<bool, num_shards> involved{};
+  for (auto cache_info : cache_info_entries) {
+    involved[shard_index(cache_info->cache_locator)] = true;
+  }
+  std::vector<std::unique_lock<ceph::shared_mutex>> locks;
+  for (size_t i = 0; i < num_shards; ++i) {
+    if (involved[i]) {
+      locks.emplace_back(shards[i].lock);
+    }
+  }
   if (!enabled) {
     return false;
   }
@@ -103,6 +124,7 @@ bool ObjectCache::chain_cache_entry(std::initializer_list<rgw_cache_entry_info*>
   for (auto cache_info : cache_info_entries) {
     ldout(cct, 10) << "chain_cache_entry: cache_locator="
 		   << cache_info->cache_locator << dendl;
+    auto& cache_map = shard_of(cache_info->cache_locator).cache_map;
     auto iter = cache_map.find(cache_info->cache_locator);
     if (iter == cache_map.end()) {
       ldout(cct, 20) << "chain_cache_entry: couldn't find cache locator" << dendl;
@@ -133,8 +155,14 @@ bool ObjectCache::chain_cache_entry(std::initializer_list<rgw_cache_entry_info*>
 
 void ObjectCache::put(const string& name, ObjectCacheInfo& info, rgw_cache_entry_info *cache_info)
 {
-  std::unique_lock l{lock};
+  if (!enabled) {
+    return;
+  }
 
+  Shard& shard = shard_of(name);
+  std::unique_lock l{shard.lock};
+  // don't insert into a shard that a concurrent set_enabled(false)
+  // has cleared already
   if (!enabled) {
     return;
   }
@@ -142,11 +170,11 @@ void ObjectCache::put(const string& name, ObjectCacheInfo& info, rgw_cache_entry
   ldout(cct, 10) << "cache put: name=" << name << " info.flags=0x"
                  << std::hex << info.flags << std::dec << dendl;
 
-  auto [iter, inserted] = cache_map.emplace(name, ObjectCacheEntry{});
+  auto [iter, inserted] = shard.cache_map.emplace(name, ObjectCacheEntry{});
   ObjectCacheEntry& entry = iter->second;
   entry.info.time_added = ceph::coarse_mono_clock::now();
   if (inserted) {
-    entry.lru_iter = lru.end();
+    entry.name = &iter->first;
   }
   ObjectCacheInfo& target = entry.info;
 
@@ -155,7 +183,7 @@ void ObjectCache::put(const string& name, ObjectCacheInfo& info, rgw_cache_entry
   entry.chained_entries.clear();
   entry.gen++;
 
-  touch_lru(name, entry, entry.lru_iter);
+  touch_lru(shard, name, entry);
 
   target.status = info.status;
 
@@ -205,14 +233,18 @@ void ObjectCache::put(const string& name, ObjectCacheInfo& info, rgw_cache_entry
 
 bool ObjectCache::remove(const string& name)
 {
-  std::unique_lock l{lock};
+  if (!enabled) {
+    return false;
+  }
 
+  Shard& shard = shard_of(name);
+  std::unique_lock l{shard.lock};
   if (!enabled) {
     return false;
   }
 
-  auto iter = cache_map.find(name);
-  if (iter == cache_map.end())
+  auto iter = shard.cache_map.find(name);
+  if (iter == shard.cache_map.end())
     return false;
 
   ldout(cct, 10) << "removing " << name << " from cache" << dendl;
@@ -222,60 +254,54 @@ bool ObjectCache::remove(const string& name)
     kv.first->invalidate(kv.second);
   }
 
-  remove_lru(name, iter->second.lru_iter);
-  cache_map.erase(iter);
+  remove_lru(shard, entry);
+  shard.cache_map.erase(iter);
   return true;
 }
 
-void ObjectCache::touch_lru(const string& name, ObjectCacheEntry& entry,
-			    std::list<string>::iterator& lru_iter)
+size_t ObjectCache::shard_lru_size() const
 {
-  while (lru_size > (size_t)cct->_conf->rgw_cache_lru_size) {
-    auto iter = lru.begin();
-    if ((*iter).compare(name) == 0) {
+  return std::max<size_t>(1, cct->_conf->rgw_cache_lru_size / num_shards);
+}
+
+void ObjectCache::touch_lru(Shard& shard, const string& name,
+			    ObjectCacheEntry& entry)
+{
+  const size_t max_size = shard_lru_size();
+  while (shard.lru.size() > max_size) {
+    ObjectCacheEntry& victim = shard.lru.front();
+    if (&victim == &entry) {
       /*
        * if the entry we're touching happens to be at the lru end, don't remove it,
        * lru shrinking can wait for next time
        */
       break;
     }
-    auto map_iter = cache_map.find(*iter);
-    ldout(cct, 10) << "removing entry: name=" << *iter << " from cache LRU" << dendl;
-    if (map_iter != cache_map.end()) {
-      ObjectCacheEntry& entry = map_iter->second;
-      invalidate_lru(entry);
-      cache_map.erase(map_iter);
-    }
-    lru.pop_front();
-    lru_size--;
+    ldout(cct, 10) << "removing entry: name=" << *victim.name << " from cache LRU" << dendl;
+    shard.lru.pop_front();
+    invalidate_lru(victim);
+    auto map_iter = shard.cache_map.find(*victim.name);
+    ceph_assert(map_iter != shard.cache_map.end());
+    shard.cache_map.erase(map_iter);
   }
 
-  if (lru_iter == lru.end()) {
-    lru.push_back(name);
-    lru_size++;
-    lru_iter--;
+  if (!entry.lru_hook.is_linked()) {
     ldout(cct, 10) << "adding " << name << " to cache LRU end" << dendl;
   } else {
     ldout(cct, 10) << "moving " << name << " to cache LRU end" << dendl;
-    lru.erase(lru_iter);
-    lru.push_back(name);
-    lru_iter = lru.end();
-    --lru_iter;
+    shard.lru.erase(shard.lru.iterator_to(entry));
   }
+  shard.lru.push_back(entry);
 
-  lru_counter++;
-  entry.lru_promotion_ts = lru_counter;
+  entry.lru_promotion_ts = ++shard.lru_counter;
 }
 
-void ObjectCache::remove_lru(const string& name,
-			     std::list<string>::iterator& lru_iter)
+void ObjectCache::remove_lru(Shard& shard, ObjectCacheEntry& entry)
 {
-  if (lru_iter == lru.end())
+  if (!entry.lru_hook.is_linked())
     return;
 
-  lru.erase(lru_iter);
-  lru_size--;
-  lru_iter = lru.end();
+  shard.lru.erase(shard.lru.iterator_to(entry));
 }
 
 void ObjectCache::invalidate_lru(ObjectCacheEntry& entry)
@@ -289,43 +315,64 @@ void ObjectCache::invalidate_lru(ObjectCacheEntry& entry)
 
 void ObjectCache::set_enabled(bool status)
 {
-  std::unique_lock l{lock};
-
-  enabled = status;
+  if (status) {
+    enabled = true;
+    return;
+  }
 
-  if (!enabled) {
-    do_invalidate_all();
+  {
+    // flip the flag and clear the shards under every shard lock, taken in
+    // index order like chain_cache_entry() does: anything that checked
+    // the flag before then either finished or rechecks it under its lock
+    std::vector<std::unique_lock<ceph::shared_mutex>> locks;
+    locks.reserve(num_shards);
+    for (auto& shard : shards) {
+      locks.emplace_back(shard.lock);
+    }
+    enabled = false;
+    for (auto& shard : shards) {
+      clear_shard(shard);
+    }
   }
+  invalidate_chained();
 }
 
 void ObjectCache::invalidate_all()
 {
-  std::unique_lock l{lock};
-
   do_invalidate_all();
 }
 
 void ObjectCache::do_invalidate_all()
 {
-  cache_map.clear();
-  lru.clear();
+  for (auto& shard : shards) {
+    std::unique_lock l{shard.lock};
+    clear_shard(shard);
+  }
+  invalidate_chained();
+}
 
-  lru_size = 0;
-  lru_counter = 0;
-  lru_window = 0;
+void ObjectCache::clear_shard(Shard& shard)
+{
+  shard.lru.clear();
+  shard.cache_map.clear();
+  shard.lru_counter = 0;
+}
 
+void ObjectCache::invalidate_chained()
+{
+  std::lock_guard l{chained_lock};
   for (auto& cache : chained_cache) {
     cache->invalidate_all();
   }
 }
 
 void ObjectCache::chain_cache(RGWChainedCache *cache) {
-  std::unique_lock l{lock};
+  std::lock_guard l{chained_lock};
   chained_cache.push_back(cache);
 }
 
 void ObjectCache::unchain_cache(RGWChainedCache *cache) {
-  std::unique_lock l{lock};
+  std::lock_guard l{chained_lock};
 
   auto iter = chained_cache.begin();
   for (; iter != chained_cache.end(); ++iter) {
@@ -4,9 +4,12 @@
 #ifndef CEPH_RGWCACHE_H
 #define CEPH_RGWCACHE_H
 
+#include <array>
+#include <atomic>
 #include <string>
 #include <map>
 #include <unordered_map>
+#include <boost/intrusive/list.hpp>
 #include "include/types.h"
 #include "include/utime.h"
 #include "include/ceph_assert.h"
@@ -146,7 +149,9 @@ public:
 
 struct ObjectCacheEntry {
   ObjectCacheInfo info;
-  std::list<string>::iterator lru_iter;
+  // the entry's key in its shard's cache_map; node keys don't move
+  const string *name = nullptr;
+  boost::intrusive::list_member_hook<> lru_hook;
   uint64_t lru_promotion_ts;
   uint64_t gen;
   std::vector<pair<RGWChainedCache *, string> > chained_entries;
@@ -155,28 +160,53 @@ struct ObjectCacheEntry {
 };
 
 class ObjectCache {
-  std::unordered_map<string, ObjectCacheEntry> cache_map;
-  std::list<string> lru;
-  unsigned long lru_size;
-  unsigned long lru_counter;
+  using lru_list_t = boost::intrusive::list<
+    ObjectCacheEntry,
+    boost::intrusive::member_hook<ObjectCacheEntry,
+				  boost::intrusive::list_member_hook<>,
+				  &ObjectCacheEntry::lru_hook>,
+    boost::intrusive::constant_time_size<true>>;
+
+  // Entries are spread over shards by name so that lookups of unrelated
+  // user/bucket metadata don't share a lock.  Each shard keeps its own
+  // LRU (an intrusive list, so touching an entry doesn't allocate) and
+  // holds 1/num_shards of rgw_cache_lru_size.
+  struct Shard {
+    ceph::shared_mutex lock = ceph::make_shared_mutex("ObjectCache::Shard");
+    std::unordered_map<string, ObjectCacheEntry> cache_map;
+    lru_list_t lru;
+    std::atomic<uint64_t> lru_counter = { 0 };
+  };
+  static constexpr size_t num_shards = 16;
+  std::array<Shard, num_shards> shards;
   unsigned long lru_window;
-  ceph::shared_mutex lock = ceph::make_shared_mutex("ObjectCache");
   CephContext *cct;
 
+  ceph::mutex chained_lock = ceph::make_mutex("ObjectCache::chained_lock");
   vector<RGWChainedCache *> chained_cache;
 
-  bool enabled;
+  std::atomic<bool> enabled;
   ceph::timespan expiry;
 
-  void touch_lru(const string& name, ObjectCacheEntry& entry,
-		 std::list<string>::iterator& lru_iter);
-  void remove_lru(const string& name, std::list<string>::iterator& lru_iter);
+  static size_t shard_index(const string& name) {
+    return std::hash<string>{}(name) % num_shards;
+  }
+  Shard& shard_of(const string& name) {
+    return shards[shard_index(name)];
+  }
+  size_t shard_lru_size() const;
+
+  void touch_lru(Shard& shard, const string& name, ObjectCacheEntry& entry);
+  void remove_lru(Shard& shard, ObjectCacheEntry& entry);
   void invalidate_lru(ObjectCacheEntry& entry);
 
   void do_invalidate_all();
+  // the caller holds shard.lock
+  static void clear_shard(Shard& shard);
+  void invalidate_chained();
 
 public:
-  ObjectCache() : lru_size(0), lru_counter(0), lru_window(0), cct(NULL), enabled(false) { }
+  ObjectCache() : lru_window(0), cct(NULL), enabled(false) { }
   ~ObjectCache();
   int get(const std::string& name, ObjectCacheInfo& bl, uint32_t mask, rgw_cache_entry_info *cache_info);
   std::optional<ObjectCacheInfo> get(const std::string& name) {
@@ -187,10 +217,13 @@ public:
 
   template<typename F>
   void for_each(const F& f) {
-    std::shared_lock l{lock};
-    if (enabled) {
-      auto now  = ceph::coarse_mono_clock::now();
-      for (const auto& [name, entry] : cache_map) {
+    if (!enabled) {
+      return;
+    }
+    auto now  = ceph::coarse_mono_clock::now();
+    for (auto& shard : shards) {
+      std::shared_lock l{shard.lock};
+      for (const auto& [name, entry] : shard.cache_map) {
         if (expiry.count() && (now - entry.info.time_added) < expiry) {
           f(name, entry);
         }
@@ -202,7 +235,7 @@ public:
   bool remove(const std::string& name);
   void set_ctx(CephContext *_cct) {
     cct = _cct;
-    lru_window = cct->_conf->rgw_cache_lru_size / 2;
+    lru_window = shard_lru_size() / 2;
     expiry = std::chrono::seconds(cct->_conf.get_val<uint64_t>(
 						"rgw_cache_expiry_interval"));
   }
@@ -0,0 +1,227 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab ft=cpp
+
+#include <experimental/filesystem>
+
+#include "common/Thread.h"
+#include "common/ceph_crypto.h"
+#include "common/dout.h"
+#include "common/errno.h"
+
+#include "rgw_common.h"
+#include "rgw_datacache.h"
+#include "rgw_perf_counters.h"
+
+#define dout_subsys ceph_subsys_rgw
+#undef dout_prefix
+#define dout_prefix *_dout << "rgw datacache: "
+
+namespace efs = std::experimental::filesystem;
+
+RGWDataCache::RGWDataCache(CephContext *cct)
+  : cct(cct),
+    path(cct->_conf.get_val<std::string>("rgw_datacache_path")),
+    max_size(cct->_conf.get_val<Option::size_t>("rgw_datacache_size"))
+{
+  // bound the memory held by fills that the disk hasn't caught up with
+  max_pending_fill = std::max<uint64_t>(max_size / 16, 4 << 20);
+}
+
+RGWDataCache::~RGWDataCache()
+{
+  shutdown();
+}
+
+std::string RGWDataCache::make_key(const rgw_raw_obj& obj,
+				   const bufferlist& tag,
+				   uint64_t ofs, uint64_t len)
+{
+  std::string key = obj.pool.to_str();
+  key.append(1, '\0').append(obj.loc);
+  key.append(1, '\0').append(obj.oid);
+  key.append(1, '\0').append(tag.to_str());
+  key.append(1, '\0').append(std::to_string(ofs));
+  key.append(1, '\0').append(std::to_string(len));
+  return key;
+}
+
+std::string RGWDataCache::file_path(const std::string& key) const
+{
+  // keys embed arbitrary object names; hash them into a flat namespace
+  unsigned char digest[CEPH_CRYPTO_SHA256_DIGESTSIZE];
+  ceph::crypto::SHA256 hash;
+  hash.Update((const unsigned char *)key.data(), key.size());
+  hash.Final(digest);
+  char hex[CEPH_CRYPTO_SHA256_DIGESTSIZE * 2 + 1];
+  buf_to_hex(digest, sizeof(digest), hex);
+  return path + "/" + hex;
+}
+
+bool RGWDataCache::is_cache_file(const std::string& name)
+{
+  static constexpr size_t digest_len = CEPH_CRYPTO_SHA256_DIGESTSIZE * 2;
+  static const std::string tmp_suffix = ".tmp";
+  if (name.size() != digest_len &&
+      (name.size() != digest_len + tmp_suffix.size() ||
+       name.compare(digest_len, std::string::npos, tmp_suffix) != 0)) {
+    return false;
+  }
+  return std::all_of(name.begin(), name.begin() + digest_len,
+		     [](char c) {
+		       return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f');
+		     });
+}
+
+int RGWDataCache::init()
+{
+  std::error_code ec;
+  if (efs::exists(path, ec)) {
+    // the index is not persistent; drop the files of a previous run, but
+    // leave anything else sharing the directory alone
+    for (auto& p : efs::directory_iterator(path, ec)) {
+      std::error_code rec;
+      if (efs::is_regular_file(p.status(rec)) &&
+	  is_cache_file(p.path().filename().string())) {
+	efs::remove(p.path(), rec);
+	if (rec) {
+	  ldout(cct, 5) << "failed to remove " << p.path() << ": "
+			<< rec.message() << dendl;
+	}
+      }
+    }
+  } else {
+    efs::create_directories(path, ec);
+  }
+  if (ec) {
+    lderr(cct) << "failed to prepare " << path << ": " << ec.message()
+	       << dendl;
+    return -ec.value();
+  }
+  fill_thread = make_named_thread("rgw_dcache_fill",
+				  &RGWDataCache::fill_entry, this);
+  ldout(cct, 1) << "caching up to " << max_size << " bytes in " << path
+		<< dendl;
+  return 0;
+}
+
+void RGWDataCache::shutdown()
+{
+  {
+    std::lock_guard l{lock};
+    stopping = true;
+    fill_cond.notify_all();
+  }
+  if (fill_thread.joinable()) {
+    fill_thread.join();
+  }
+}
+
+void RGWDataCache::touch(const std::string& key)
+{
+  auto i = entries.find(key);
+  if (i != entries.end()) {
+    lru.splice(lru.begin(), lru, i->second.lru_pos);
+  }
+}
+
+void RGWDataCache::trim()
+{
+  while (size > max_size && !lru.empty()) {
+    std::string victim = std::move(lru.back());
+    lru.pop_back();
+    auto i = entries.find(victim);
+    ceph_assert(i != entries.end());
+    size -= i->second.size;
+    entries.erase(i);
+    ::unlink(file_path(victim).c_str());
+  }
+}
+
+bool RGWDataCache::get(const std::string& key, uint64_t len, bufferlist *bl)
+{
+  {
+    std::lock_guard l{lock};
+    auto i = entries.find(key);
+    if (i == entries.end() || i->second.size != len) {
+      perfcounter->inc(l_rgw_datacache_miss);
+      perfcounter->inc(l_rgw_datacache_miss_b, len);
+      return false;
+    }
+    touch(key);
+  }
+
+  // the entry may be evicted (and its file unlinked) while we read it;
+  // a short or failed read is treated as a miss
+  std::string err;
+  bufferlist data;
+  int r = data.read_file(file_path(key).c_str(), &err);
+  if (r < 0 || data.length() != len) {
+    ldout(cct, 10) << "failed to read cached " << file_path(key) << ": "
+		   << (r < 0 ? err : "short read") << dendl;
+    perfcounter->inc(l_rgw_datacache_miss);
+    perfcounter->inc(l_rgw_datacache_miss_b, len);
+    return false;
+  }
+  perfcounter->inc(l_rgw_datacache_hit);
+  perfcounter->inc(l_rgw_datacache_hit_b, len);
+  bl->claim_append(data);
+  return true;
+}
+
+void RGWDataCache::put_async(const std::string& key, const bufferlist& bl)
+{
+  if (bl.length() == 0 || bl.length() > max_size) {
+    return;
+  }
+  std::lock_guard l{lock};
+  if (stopping ||
+      entries.count(key) ||
+      filling.count(key) ||
+      pending_fill + bl.length() > max_pending_fill) {
+    return;
+  }
+  filling.insert(key);
+  pending_fill += bl.length();
+  fill_queue.emplace_back(key, bl);
+  fill_cond.notify_one();
+}
+
+void RGWDataCache::fill_entry()
+{
+  std::unique_lock l{lock};
+  while (true) {
+    fill_cond.wait(l, [this] { return stopping || !fill_queue.empty(); });
+    if (stopping) {
+      break;
+    }
+    auto [key, bl] = std::move(fill_queue.front());
+    fill_queue.pop_front();
+    l.unlock();
+
+    std::string fn = file_path(key);
+    std::string tmp = fn + ".tmp";
+    int r = bl.write_file(tmp.c_str(), 0600);
+    if (r == 0 && ::rename(tmp.c_str(), fn.c_str()) < 0) {
+      r = -errno;
+    }
+    if (r < 0) {
+      ldout(cct, 5) << "failed to write " << fn << ": " << cpp_strerror(r)
+		    << dendl;
+      ::unlink(tmp.c_str());
+    }
+
+    l.lock();
+    filling.erase(key);
+    pending_fill -= bl.length();
+    if (r == 0) {
+      lru.push_front(key);
+      entries[key] = entry_t{lru.begin(), bl.length()};
+      size += bl.length();
+      trim();
+      perfcounter->set(l_rgw_datacache_size, size);
+    }
+  }
+  fill_queue.clear();
+  filling.clear();
+  pending_fill = 0;
+}
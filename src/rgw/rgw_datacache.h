@@ -0,0 +1,81 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab ft=cpp
+
+#ifndef CEPH_RGW_DATACACHE_H
+#define CEPH_RGW_DATACACHE_H
+
+#include <deque>
+#include <list>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "include/buffer.h"
+#include "common/ceph_mutex.h"
+
+class CephContext;
+struct rgw_raw_obj;
+
+/*
+ * Local read cache for object tail data.
+ *
+ * Each entry is one rados read of a tail object, stored as a file
+ * under rgw_datacache_path.  Entries are keyed on the raw tail object
+ * and the head's tag, plus the read range.  A rewritten object gets a
+ * new tag and new tail objects, so a stale entry is never looked up
+ * again and simply ages out of the LRU.
+ *
+ * Lookups read the file synchronously.  Fills are queued to a
+ * background thread, and are dropped if too much fill data is already
+ * pending.  The index lives in memory only, so the cache files left in
+ * the directory are removed on startup.
+ */
+class RGWDataCache {
+  CephContext *cct;
+  std::string path;
+  uint64_t max_size;
+  uint64_t max_pending_fill;
+
+  ceph::mutex lock = ceph::make_mutex("RGWDataCache::lock");
+
+  struct entry_t {
+    std::list<std::string>::iterator lru_pos;
+    uint64_t size;
+  };
+  std::list<std::string> lru; // front is most recently used
+  std::unordered_map<std::string, entry_t> entries;
+  uint64_t size = 0;
+
+  ceph::condition_variable fill_cond;
+  std::deque<std::pair<std::string, ceph::bufferlist>> fill_queue;
+  std::unordered_set<std::string> filling;
+  uint64_t pending_fill = 0;
+  bool stopping = false;
+  std::thread fill_thread;
+
+  std::string file_path(const std::string& key) const;
+  void fill_entry();
+  void touch(const std::string& key);
+  void trim();
+
+public:
+  explicit RGWDataCache(CephContext *cct);
+  ~RGWDataCache();
+
+  static std::string make_key(const rgw_raw_obj& obj,
+			      const ceph::bufferlist& tag,
+			      uint64_t ofs, uint64_t len);
+  /// whether name is one of the files the cache creates
+  static bool is_cache_file(const std::string& name);
+
+  int init();
+  void shutdown();
+
+  /// read a cached entry of exactly len bytes; false on miss
+  bool get(const std::string& key, uint64_t len, ceph::bufferlist *bl);
+  /// queue bl to be written to the cache under key
+  void put_async(const std::string& key, const ceph::bufferlist& bl);
+};
+
+#endif
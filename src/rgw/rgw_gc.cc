@@ -14,6 +14,9 @@
 #include "cls/lock/cls_lock_client.h"
 #include "include/random.h"
 #include "rgw_gc_log.h"
+#include "rgw_aio_throttle.h"
+#include "rgw_zone.h"
+#include "services/svc_zone.h"
 
 #include <list> // XXX
 #include <sstream>
@@ -33,6 +36,7 @@ void RGWGC::initialize(CephContext *_cct, RGWRados *_store) {
   max_objs = min(static_cast<int>(cct->_conf->rgw_gc_max_objs), rgw_shards_max());
 
   obj_names = new string[max_objs];
+  transitioned_objects_cache = std::vector<std::atomic<bool>>(max_objs);
 
   for (int i = 0; i < max_objs; i++) {
     obj_names[i] = gc_oid_prefix;
@@ -40,9 +44,6 @@ void RGWGC::initialize(CephContext *_cct, RGWRados *_store) {
     snprintf(buf, 32, ".%d", i);
     obj_names[i].append(buf);
 
-    auto it = transitioned_objects_cache.begin() + i;
-    transitioned_objects_cache.insert(it, false);
-
     //version = 0 -> not ready for transition
     //version = 1 -> marked ready for transition
     librados::ObjectWriteOperation op;
@@ -167,19 +168,10 @@ int RGWGC::async_defer_chain(const string& tag, const cls_rgw_obj_chain& chain)
   return ret;
 }
 
-int RGWGC::remove(int index, const std::vector<string>& tags, AioCompletion **pc)
+rgw_raw_obj RGWGC::get_shard_obj(int index) const
 {
-  ObjectWriteOperation op;
-  cls_rgw_gc_remove(op, tags);
-
-  auto c = librados::Rados::aio_create_completion(nullptr, nullptr);
-  int ret = store->gc_aio_operate(obj_names[index], c, &op);
-  if (ret < 0) {
-    c->release();
-  } else {
-    *pc = c;
-  }
-  return ret;
+  return rgw_raw_obj(store->svc.zone->get_zone_params().gc_pool,
+		     obj_names[index]);
 }
 
 int RGWGC::remove(int index, int num_entries)
@@ -268,210 +260,261 @@ int RGWGC::list(int *index, string& marker, uint32_t max, bool expired_only, std
   return 0;
 }
 
-class RGWGCIOManager {
-  const DoutPrefixProvider* dpp;
-  CephContext *cct;
-  RGWGC *gc;
-
-  struct IO {
-    enum Type {
-      UnknownIO = 0,
-      TailIO = 1,
-      IndexIO = 2,
-    } type{UnknownIO};
-    librados::AioCompletion *c{nullptr};
-    string oid;
-    int index{-1};
-    string tag;
-  };
-
-  deque<IO> ios;
-  vector<std::vector<string> > remove_tags;
-  /* tracks the number of remaining shadow objects for a given tag in order to
-   * only remove the tag once all shadow objects have themselves been removed
-   */
-  vector<map<string, size_t> > tag_io_size;
-
-#define MAX_AIO_DEFAULT 10
-  size_t max_aio{MAX_AIO_DEFAULT};
-
-public:
-  RGWGCIOManager(const DoutPrefixProvider* _dpp, CephContext *_cct, RGWGC *_gc) : dpp(_dpp),
-                                                  cct(_cct),
-                                                  gc(_gc),
-                                                  remove_tags(cct->_conf->rgw_gc_max_objs),
-                                                  tag_io_size(cct->_conf->rgw_gc_max_objs) {
-    max_aio = cct->_conf->rgw_gc_max_concurrent_io;
+RGWGCIOManager::RGWGCIOManager(const DoutPrefixProvider* _dpp,
+			       CephContext *_cct, RGWGC *_gc,
+			       RGWSI_RADOS *_rados,
+			       std::unique_ptr<rgw::Aio> _aio)
+  : dpp(_dpp),
+    cct(_cct),
+    gc(_gc),
+    rados(_rados),
+    aio(std::move(_aio)),
+    remove_tags(cct->_conf->rgw_gc_max_objs),
+    tag_io_size(cct->_conf->rgw_gc_max_objs)
+{
+  if (!aio) {
+    aio = std::make_unique<rgw::BlockingAioThrottle>(
+      std::max<int64_t>(cct->_conf->rgw_gc_max_concurrent_io, 1));
   }
+}
 
-  ~RGWGCIOManager() {
-    for (auto io : ios) {
-      io.c->release();
-    }
-  }
+RGWGCIOManager::~RGWGCIOManager()
+{
+  aio->drain();
+}
 
-  int schedule_io(IoCtx *ioctx, const string& oid, ObjectWriteOperation *op,
-		  int index, const string& tag) {
-    while (ios.size() > max_aio) {
-      if (gc->going_down()) {
-        return 0;
-      }
-      auto ret = handle_next_completion();
-      //Return error if we are using queue, else ignore it
-      if (gc->transitioned_objects_cache[index] && ret < 0) {
-        return ret;
-      }
-    }
+uint64_t RGWGCIOManager::add_io(IO&& io)
+{
+  const uint64_t id = next_io_id++;
+  ios.emplace(id, std::move(io));
+  return id;
+}
 
-    auto c = librados::Rados::aio_create_completion(nullptr, nullptr);
-    int ret = ioctx->aio_operate(oid, c, op);
+void RGWGCIOManager::submit(const RGWSI_RADOS::Obj& obj,
+			    librados::ObjectWriteOperation&& op,
+			    uint64_t id, int flags)
+{
+  auto c = aio->get(obj,
+		    rgw::Aio::librados_op(std::move(op), null_yield, flags),
+		    1, id);
+  completed.splice(completed.end(), c);
+}
+
+int RGWGCIOManager::handle_completed()
+{
+  int ret_val = 0;
+  while (!completed.empty()) {
+    // may submit tag removals, which can complete more ios
+    int ret = handle_result(completed.front());
+    completed.pop_front_and_dispose(std::default_delete<rgw::AioResultEntry>{});
     if (ret < 0) {
-      return ret;
+      ret_val = ret;
     }
-    ios.push_back(IO{IO::TailIO, c, oid, index, tag});
-
-    return 0;
   }
+  return ret_val;
+}
 
-  int handle_next_completion() {
-    ceph_assert(!ios.empty());
-    IO& io = ios.front();
-    io.c->wait_for_complete();
-    int ret = io.c->get_return_value();
-    io.c->release();
-
-    if (ret == -ENOENT) {
-      ret = 0;
-    }
-
-    if (io.type == IO::IndexIO && ! gc->transitioned_objects_cache[io.index]) {
-      if (ret < 0) {
-        ldpp_dout(dpp, 0) << "WARNING: gc cleanup of tags on gc shard index=" <<
-	  io.index << " returned error, ret=" << ret << dendl;
-      }
-      goto done;
-    }
+int RGWGCIOManager::handle_result(rgw::AioResult& r)
+{
+  auto i = ios.find(r.id);
+  ceph_assert(i != ios.end());
+  IO io = std::move(i->second);
+  ios.erase(i);
+
+  int ret = r.result;
+  if (ret == -ENOENT) {
+    ret = 0;
+  } else if (ret == 0 && io.type == IO::TailIO && io.removed && perfcounter) {
+    // a put that only dropped a reference to a shared tail reclaims nothing
+    perfcounter->inc(l_rgw_gc_reclaim_obj);
+    perfcounter->inc(l_rgw_gc_reclaim_b, io.size);
+  }
 
+  if (io.type == IO::IndexIO) {
     if (ret < 0) {
-      ldpp_dout(dpp, 0) << "WARNING: gc could not remove oid=" << io.oid <<
-	", ret=" << ret << dendl;
-      goto done;
-    }
-
-    if (! gc->transitioned_objects_cache[io.index]) {
-      schedule_tag_removal(io.index, io.tag);
+      ldpp_dout(dpp, 0) << "WARNING: gc cleanup of tags on gc shard index=" <<
+	io.index << " returned error, ret=" << ret << dendl;
     }
-
-  done:
-    ios.pop_front();
     return ret;
   }
 
-  /* This is a request to schedule a tag removal. It will be called once when
-   * there are no shadow objects. But it will also be called for every shadow
-   * object when there are any. Since we do not want the tag to be removed
-   * until all shadow objects have been successfully removed, the scheduling
-   * will not happen until the shadow object count goes down to zero
-   */
-  void schedule_tag_removal(int index, string tag) {
-    auto& ts = tag_io_size[index];
-    auto ts_it = ts.find(tag);
-    if (ts_it != ts.end()) {
-      auto& size = ts_it->second;
-      --size;
-      // wait all shadow obj delete return
-      if (size != 0)
-        return;
-
-      ts.erase(ts_it);
-    }
+  if (ret < 0) {
+    ldpp_dout(dpp, 0) << "WARNING: gc could not remove oid=" << io.oid <<
+      ", ret=" << ret << dendl;
+    return ret;
+  }
 
-    auto& rt = remove_tags[index];
+  if (! gc->transitioned_objects_cache[io.index]) {
+    schedule_tag_removal(io.index, io.tag);
+  }
+  return ret;
+}
 
-    rt.push_back(tag);
-    if (rt.size() >= (size_t)cct->_conf->rgw_gc_max_trim_chunk) {
-      flush_remove_tags(index, rt);
-    }
+int RGWGCIOManager::schedule_io(const cls_rgw_obj& obj, int index,
+				const string& tag)
+{
+  auto robj = rados->obj(rgw_raw_obj(rgw_pool(obj.pool), obj.key.name,
+				     obj.loc));
+  int ret = robj.open();
+  if (ret < 0) {
+    ldpp_dout(dpp, 0) << "ERROR: failed to create ioctx pool=" <<
+      obj.pool << dendl;
+    return ret;
   }
 
-  void add_tag_io_size(int index, string tag, size_t size) {
-    auto& ts = tag_io_size[index];
-    ts.emplace(tag, size);
+  const uint64_t id = add_io(IO{IO::TailIO, obj.key.name, index, tag,
+				obj.size});
+  // the io stays in place until its result is handled
+  ObjectWriteOperation op;
+  cls_refcount_put(op, tag, true, &ios[id].removed);
+  submit(robj, std::move(op), id, librados::OPERATION_RETURNVEC);
+
+  ret = handle_completed();
+  //Return error if we are using queue, else ignore it
+  if (gc->transitioned_objects_cache[index] && ret < 0) {
+    return ret;
   }
+  return 0;
+}
 
-  int drain_ios() {
-    int ret_val = 0;
-    while (!ios.empty()) {
-      if (gc->going_down()) {
-        return -EAGAIN;
-      }
-      auto ret = handle_next_completion();
-      if (ret < 0) {
-        ret_val = ret;
-      }
-    }
-    return ret_val;
+/* This is a request to schedule a tag removal. It will be called once when
+ * there are no shadow objects. But it will also be called for every shadow
+ * object when there are any. Since we do not want the tag to be removed
+ * until all shadow objects have been successfully removed, the scheduling
+ * will not happen until the shadow object count goes down to zero
+ */
+void RGWGCIOManager::schedule_tag_removal(int index, string tag)
+{
+  auto& ts = tag_io_size[index];
+  auto ts_it = ts.find(tag);
+  if (ts_it != ts.end()) {
+    auto& size = ts_it->second;
+    --size;
+    // wait all shadow obj delete return
+    if (size != 0)
+      return;
+
+    ts.erase(ts_it);
   }
 
-  void drain() {
-    drain_ios();
-    flush_remove_tags();
-    /* the tags draining might have generated more ios, drain those too */
-    drain_ios();
+  auto& rt = remove_tags[index];
+
+  rt.push_back(tag);
+  if (rt.size() >= (size_t)cct->_conf->rgw_gc_max_trim_chunk) {
+    flush_remove_tags(index, rt);
   }
+}
 
-  void flush_remove_tags(int index, vector<string>& rt) {
-    IO index_io;
-    index_io.type = IO::IndexIO;
-    index_io.index = index;
+void RGWGCIOManager::add_tag_io_size(int index, string tag, size_t size)
+{
+  auto& ts = tag_io_size[index];
+  ts.emplace(tag, size);
+}
 
-    ldpp_dout(dpp, 20) << __func__ <<
-      " removing entries from gc log shard index=" << index << ", size=" <<
-      rt.size() << ", entries=" << rt << dendl;
+int RGWGCIOManager::drain_ios()
+{
+  if (gc->going_down()) {
+    return -EAGAIN;
+  }
+  auto c = aio->drain();
+  completed.splice(completed.end(), c);
+  return handle_completed();
+}
 
-    auto rt_guard = make_scope_guard(
-      [&]
-	{
-	  rt.clear();
-	}
-      );
+void RGWGCIOManager::drain()
+{
+  drain_ios();
+  flush_remove_tags();
+  /* the tags draining might have generated more ios, drain those too */
+  drain_ios();
+}
 
-    int ret = gc->remove(index, rt, &index_io.c);
-    if (ret < 0) {
-      /* we already cleared list of tags, this prevents us from
-       * ballooning in case of a persistent problem
-       */
-      ldpp_dout(dpp, 0) << "WARNING: failed to remove tags on gc shard index=" <<
-	index << " ret=" << ret << dendl;
-      return;
-    }
-    if (perfcounter) {
-      /* log the count of tags retired for rate estimation */
-      perfcounter->inc(l_rgw_gc_retire, rt.size());
-    }
-    ios.push_back(index_io);
+void RGWGCIOManager::flush_remove_tags(int index, vector<string>& rt)
+{
+  if (rt.empty()) {
+    return;
   }
 
-  void flush_remove_tags() {
-    int index = 0;
-    for (auto& rt : remove_tags) {
-      if (! gc->transitioned_objects_cache[index]) {
-        flush_remove_tags(index, rt);
+  ldpp_dout(dpp, 20) << __func__ <<
+    " removing entries from gc log shard index=" << index << ", size=" <<
+    rt.size() << ", entries=" << rt << dendl;
+
+  auto rt_guard = make_scope_guard(
+    [&]
+      {
+	rt.clear();
       }
-      ++index;
-    }
+    );
+
+  auto robj = rados->obj(gc->get_shard_obj(index));
+  int ret = robj.open();
+  if (ret < 0) {
+    /* we already cleared list of tags, this prevents us from
+     * ballooning in case of a persistent problem
+     */
+    ldpp_dout(dpp, 0) << "WARNING: failed to remove tags on gc shard index=" <<
+      index << " ret=" << ret << dendl;
+    return;
+  }
+  if (perfcounter) {
+    /* log the count of tags retired for rate estimation */
+    perfcounter->inc(l_rgw_gc_retire, rt.size());
   }
 
-  int remove_queue_entries(int index, int num_entries) {
-    int ret = gc->remove(index, num_entries);
-    if (ret < 0) {
-      ldpp_dout(dpp, 0) << "ERROR: failed to remove queue entries on index=" <<
-	    index << " ret=" << ret << dendl;
-      return ret;
+  ObjectWriteOperation op;
+  cls_rgw_gc_remove(op, rt);
+  IO index_io;
+  index_io.type = IO::IndexIO;
+  index_io.index = index;
+  submit(robj, std::move(op), add_io(std::move(index_io)));
+}
+
+void RGWGCIOManager::flush_remove_tags()
+{
+  int index = 0;
+  for (auto& rt : remove_tags) {
+    if (! gc->transitioned_objects_cache[index]) {
+      flush_remove_tags(index, rt);
     }
-    return 0;
+    ++index;
+  }
+}
+
+int RGWGCIOManager::remove_queue_entries(int index, int num_entries)
+{
+  int ret = gc->remove(index, num_entries);
+  if (ret < 0) {
+    ldpp_dout(dpp, 0) << "ERROR: failed to remove queue entries on index=" <<
+      index << " ret=" << ret << dendl;
+    return ret;
   }
-}; // class RGWGCIOManger
+  return 0;
+}
+
+static void order_by_pg(RGWRados *store,
+			vector<pair<const cls_rgw_obj*, const string*>>& removals)
+{
+  map<string, IoCtx> pools;
+  rgw_gc_order_by_pg(removals,
+    [&](const pair<const cls_rgw_obj*, const string*>& r) {
+      const cls_rgw_obj& obj = *r.first;
+      auto p = pools.find(obj.pool);
+      if (p == pools.end()) {
+	p = pools.emplace(obj.pool, IoCtx()).first;
+	if (rgw_init_ioctx(store->get_rados_handle(), obj.pool,
+			   p->second) < 0) {
+	  // schedule_io() will report the error
+	  p->second.close();
+	}
+      }
+      uint32_t pg = 0;
+      if (p->second.is_valid()) {
+	p->second.get_object_pg_hash_position2(
+	  (obj.loc.empty() ? obj.key.name : obj.loc), &pg);
+      }
+      return make_pair(obj.pool, pg);
+    });
+}
 
 int RGWGC::process(int index, int max_secs, bool expired_only,
                    RGWGCIOManager& io_manager)
@@ -503,12 +546,11 @@ int RGWGC::process(int index, int max_secs, bool expired_only,
   if (ret < 0)
     return ret;
 
+  const int max = cct->_conf.get_val<uint64_t>("rgw_gc_process_batch_size");
   string marker;
   string next_marker;
   bool truncated;
-  IoCtx *ctx = new IoCtx;
   do {
-    int max = 100;
     std::list<cls_rgw_gc_obj_info> entries;
 
     int ret = 0;
@@ -556,7 +598,9 @@ int RGWGC::process(int index, int max_secs, bool expired_only,
 
     marker = next_marker;
 
-    string last_pool;
+    {
+    bool out_of_time = false;
+    vector<pair<const cls_rgw_obj*, const string*>> removals;
     std::list<cls_rgw_gc_obj_info>::iterator iter;
     for (iter = entries.begin(); iter != entries.end(); ++iter) {
       cls_rgw_gc_obj_info& info = *iter;
@@ -565,12 +609,12 @@ int RGWGC::process(int index, int max_secs, bool expired_only,
 	info.tag << "', time=" << info.time << ", chain.objs.size()=" <<
 	info.chain.objs.size() << dendl;
 
-      std::list<cls_rgw_obj>::iterator liter;
       cls_rgw_obj_chain& chain = info.chain;
 
       utime_t now = ceph_clock_now();
       if (now >= end) {
-        goto done;
+        out_of_time = true;
+        break;
       }
       if (! transitioned_objects_cache[index]) {
         if (chain.objs.empty()) {
@@ -579,52 +623,35 @@ int RGWGC::process(int index, int max_secs, bool expired_only,
           io_manager.add_tag_io_size(index, info.tag, chain.objs.size());
         }
       }
-      if (! chain.objs.empty()) {
-	for (liter = chain.objs.begin(); liter != chain.objs.end(); ++liter) {
-	  cls_rgw_obj& obj = *liter;
-
-	  if (obj.pool != last_pool) {
-	    delete ctx;
-	    ctx = new IoCtx;
-	    ret = rgw_init_ioctx(store->get_rados_handle(), obj.pool, *ctx);
-	    if (ret < 0) {
+      for (auto& obj : chain.objs) {
+        removals.emplace_back(&obj, &info.tag);
+      }
+    } // entries loop
+
+    order_by_pg(store, removals);
+
+    for (auto& [obj, tag] : removals) {
+      ldpp_dout(this, 5) << "RGWGC::process removing " << obj->pool <<
+	":" << obj->key.name << dendl;
+      ret = io_manager.schedule_io(*obj, index, *tag);
+      if (ret < 0) {
+	ldpp_dout(this, 0) <<
+	  "WARNING: failed to schedule deletion for oid=" << obj->key.name << dendl;
         if (transitioned_objects_cache[index]) {
+          //If deleting oid failed for any of them, we will not delete queue entries
           goto done;
         }
-	      last_pool = "";
-	      ldpp_dout(this, 0) << "ERROR: failed to create ioctx pool=" <<
-		obj.pool << dendl;
-	      continue;
-	    }
-	    last_pool = obj.pool;
-	  }
-
-	  ctx->locator_set_key(obj.loc);
-
-	  const string& oid = obj.key.name; /* just stored raw oid there */
-
-	  ldpp_dout(this, 5) << "RGWGC::process removing " << obj.pool <<
-	    ":" << obj.key.name << dendl;
-	  ObjectWriteOperation op;
-	  cls_refcount_put(op, info.tag, true);
-
-	  ret = io_manager.schedule_io(ctx, oid, &op, index, info.tag);
-	  if (ret < 0) {
-	    ldpp_dout(this, 0) <<
-	      "WARNING: failed to schedule deletion for oid=" << oid << dendl;
-      if (transitioned_objects_cache[index]) {
-        //If deleting oid failed for any of them, we will not delete queue entries
-        goto done;
       }
-	  }
-	  if (going_down()) {
-	    // leave early, even if tag isn't removed, it's ok since it
-	    // will be picked up next time around
-	    goto done;
-	  }
-	} // chains loop
-      } // else -- chains not empty
-    } // entries loop
+      if (going_down()) {
+	// leave early, even if tag isn't removed, it's ok since it
+	// will be picked up next time around
+	goto done;
+      }
+    } // removals loop
+    if (out_of_time) {
+      goto done;
+    }
+    }
     if (transitioned_objects_cache[index] && entries.size() > 0) {
       ret = io_manager.drain_ios();
       if (ret < 0) {
@@ -646,7 +673,6 @@ done:
    * hold the system if backend is unresponsive
    */
   l.unlock(&store->gc_pool_ctx, obj_names[index]);
-  delete ctx;
 
   return 0;
 }
@@ -657,19 +683,43 @@ int RGWGC::process(bool expired_only)
 
   const int start = ceph::util::generate_random_number(0, max_objs - 1);
 
-  RGWGCIOManager io_manager(this, store->ctx(), this);
+  /* every worker takes the next shard nobody has taken yet; shards are
+   * also locked, so workers in other radosgws skip the ones we hold
+   */
+  const int num_workers = std::clamp<int>(
+    cct->_conf.get_val<uint64_t>("rgw_gc_max_concurrent_shards"), 1, max_objs);
+  std::atomic<int> next_shard = { 0 };
+  std::atomic<int> first_error = { 0 };
+
+  auto worker = [&] {
+    RGWGCIOManager io_manager(this, store->ctx(), this, store->svc.rados);
+
+    int i;
+    while ((i = next_shard++) < max_objs) {
+      int index = (i + start) % max_objs;
+      int ret = process(index, max_secs, expired_only, io_manager);
+      if (ret < 0) {
+        int expected = 0;
+        first_error.compare_exchange_strong(expected, ret);
+        next_shard = max_objs;
+        break;
+      }
+    }
+    if (!going_down()) {
+      io_manager.drain();
+    }
+  };
 
-  for (int i = 0; i < max_objs; i++) {
-    int index = (i + start) % max_objs;
-    int ret = process(index, max_secs, expired_only, io_manager);
-    if (ret < 0)
-      return ret;
+  std::vector<std::thread> workers;
+  for (int i = 1; i < num_workers; i++) {
+    workers.push_back(make_named_thread("rgw_gc_shard", worker));
   }
-  if (!going_down()) {
-    io_manager.drain();
+  worker();
+  for (auto& t : workers) {
+    t.join();
   }
 
-  return 0;
+  return first_error;
 }
 
 bool RGWGC::going_down()
@@ -12,9 +12,12 @@
 #include "common/Thread.h"
 #include "rgw_common.h"
 #include "rgw_rados.h"
+#include "rgw_aio.h"
 #include "cls/rgw/cls_rgw_types.h"
 
 #include <atomic>
+#include <deque>
+#include <type_traits>
 
 class RGWGCIOManager;
 
@@ -47,7 +50,7 @@ public:
     stop_processor();
     finalize();
   }
-  vector<bool> transitioned_objects_cache;
+  std::vector<std::atomic<bool>> transitioned_objects_cache;
   int send_chain(cls_rgw_obj_chain& chain, const string& tag);
 
   // asynchronously defer garbage collection on an object that's still being read
@@ -56,8 +59,8 @@ public:
   // callback for when async_defer_chain() fails with ECANCELED
   void on_defer_canceled(const cls_rgw_gc_obj_info& info);
 
-  int remove(int index, const std::vector<string>& tags, librados::AioCompletion **pc);
-  int remove(int index, int num_entries);
+  virtual rgw_raw_obj get_shard_obj(int index) const;
+  virtual int remove(int index, int num_entries);
 
   void initialize(CephContext *_cct, RGWRados *_store);
   void finalize();
@@ -68,7 +71,7 @@ public:
               RGWGCIOManager& io_manager);
   int process(bool expired_only);
 
-  bool going_down();
+  virtual bool going_down();
   void start_processor();
   void stop_processor();
 
@@ -79,5 +82,96 @@ public:
 
 };
 
+/* Removes the tail objects of gc entries through an aio throttle. For gc
+ * shards still using the omap log, an entry's tag is removed from the log
+ * once all of its tail objects are gone.
+ */
+class RGWGCIOManager {
+  const DoutPrefixProvider* dpp;
+  CephContext *cct;
+  RGWGC *gc;
+  RGWSI_RADOS *rados;
+
+  struct IO {
+    enum Type {
+      UnknownIO = 0,
+      TailIO = 1,
+      IndexIO = 2,
+    } type{UnknownIO};
+    string oid;
+    int index{-1};
+    string tag;
+    uint64_t size{0};
+    bool removed{false}; // set by the refcount put of a TailIO
+  };
+
+  /* the throttle bounds the number of ios in flight; each io is looked up
+   * by the id it was submitted with once it completes
+   */
+  std::unique_ptr<rgw::Aio> aio;
+  map<uint64_t, IO> ios;
+  uint64_t next_io_id{0};
+  rgw::AioResultList completed;
+
+  vector<std::vector<string> > remove_tags;
+  /* tracks the number of remaining shadow objects for a given tag in order to
+   * only remove the tag once all shadow objects have themselves been removed
+   */
+  vector<map<string, size_t> > tag_io_size;
+
+  uint64_t add_io(IO&& io);
+  void submit(const RGWSI_RADOS::Obj& obj, librados::ObjectWriteOperation&& op,
+	      uint64_t id, int flags = 0);
+  int handle_completed();
+  int handle_result(rgw::AioResult& r);
+
+public:
+  // without an aio, ios are throttled to rgw_gc_max_concurrent_io
+  RGWGCIOManager(const DoutPrefixProvider* _dpp, CephContext *_cct, RGWGC *_gc,
+		 RGWSI_RADOS *_rados, std::unique_ptr<rgw::Aio> _aio = nullptr);
+  ~RGWGCIOManager();
+
+  // drop tag's reference to obj, removing it if that was the last one
+  int schedule_io(const cls_rgw_obj& obj, int index, const string& tag);
+  void schedule_tag_removal(int index, string tag);
+  void add_tag_io_size(int index, string tag, size_t size);
+
+  int drain_ios();
+  void drain();
+
+  void flush_remove_tags(int index, vector<string>& rt);
+  void flush_remove_tags();
+  int remove_queue_entries(int index, int num_entries);
+};
+
+/* librados has no multi-object delete, so the removals of one batch are
+ * instead ordered so that consecutive ones go to different PGs; removals
+ * that queue up behind each other in a single PG would leave most of
+ * the aio window idle. get_pg(item) returns the (pool, pg) of an item;
+ * items in the same pg keep their order.
+ */
+template <typename T, typename PGFunc>
+void rgw_gc_order_by_pg(std::vector<T>& items, PGFunc&& get_pg)
+{
+  using PG = std::decay_t<std::invoke_result_t<PGFunc&, const T&>>;
+  std::map<PG, std::deque<T>> by_pg;
+  for (auto& item : items) {
+    by_pg[get_pg(item)].push_back(std::move(item));
+  }
+
+  items.clear();
+  while (!by_pg.empty()) {
+    for (auto i = by_pg.begin(); i != by_pg.end(); ) {
+      items.push_back(std::move(i->second.front()));
+      i->second.pop_front();
+      if (i->second.empty()) {
+	i = by_pg.erase(i);
+      } else {
+	++i;
+      }
+    }
+  }
+}
+
 
 #endif
@@ -326,6 +326,15 @@ int main(int argc, const char **argv)
     return -r;
   }
 
+  if (g_conf().get_val<bool>("rgw_datacache_enabled")) {
+    r = store->getRados()->init_datacache();
+    if (r < 0) {
+      derr << "ERROR: failed to initialize data cache: " << cpp_strerror(r)
+           << dendl;
+      return -r;
+    }
+  }
+
   rgw_rest_init(g_ceph_context, store->svc()->zone->get_zonegroup());
 
   mutex.lock();
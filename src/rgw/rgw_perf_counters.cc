@@ -31,10 +31,23 @@ int rgw_perf_start(CephContext *cct)
   plb.add_u64_counter(l_rgw_cache_hit, "cache_hit", "Cache hits");
   plb.add_u64_counter(l_rgw_cache_miss, "cache_miss", "Cache miss");
 
+  plb.add_u64_counter(l_rgw_datacache_hit, "datacache_hit", "Data cache hits");
+  plb.add_u64_counter(l_rgw_datacache_hit_b, "datacache_hit_b", "Size of data cache hits");
+  plb.add_u64_counter(l_rgw_datacache_miss, "datacache_miss", "Data cache misses");
+  plb.add_u64_counter(l_rgw_datacache_miss_b, "datacache_miss_b", "Size of data cache misses");
+  plb.add_u64(l_rgw_datacache_size, "datacache_size", "Bytes in data cache");
+
   plb.add_u64_counter(l_rgw_keystone_token_cache_hit, "keystone_token_cache_hit", "Keystone token cache hits");
   plb.add_u64_counter(l_rgw_keystone_token_cache_miss, "keystone_token_cache_miss", "Keystone token cache miss");
 
   plb.add_u64_counter(l_rgw_gc_retire, "gc_retire_object", "GC object retires");
+  plb.add_u64_counter(l_rgw_gc_reclaim_obj, "gc_reclaim_obj", "Tail objects removed by GC");
+  plb.add_u64_counter(l_rgw_gc_reclaim_b, "gc_reclaim_b", "Size of tail objects removed by GC");
+
+  plb.add_u64_counter(l_rgw_reshard_copy, "reshard_copy", "Index entries copied by reshard");
+  plb.add_u64_counter(l_rgw_reshard_replay, "reshard_replay", "Objects copied again from the reshard log");
+  plb.add_u64(l_rgw_reshard_progress, "reshard_progress", "Percent of the current reshard copied");
+  plb.add_time_avg(l_rgw_reshard_block_lat, "reshard_block_lat", "Time reshard blocked writes to a bucket");
 
   plb.add_u64_counter(l_rgw_pubsub_event_triggered, "pubsub_event_triggered", "Pubsub events with at least one topic");
   plb.add_u64_counter(l_rgw_pubsub_event_lost, "pubsub_event_lost", "Pubsub events lost");
@@ -30,10 +30,23 @@ enum {
   l_rgw_cache_hit,
   l_rgw_cache_miss,
 
+  l_rgw_datacache_hit,
+  l_rgw_datacache_hit_b,
+  l_rgw_datacache_miss,
+  l_rgw_datacache_miss_b,
+  l_rgw_datacache_size,
+
   l_rgw_keystone_token_cache_hit,
   l_rgw_keystone_token_cache_miss,
 
   l_rgw_gc_retire,
+  l_rgw_gc_reclaim_obj,
+  l_rgw_gc_reclaim_b,
+
+  l_rgw_reshard_copy,
+  l_rgw_reshard_replay,
+  l_rgw_reshard_progress,
+  l_rgw_reshard_block_lat,
 
   l_rgw_pubsub_event_triggered,
   l_rgw_pubsub_event_lost,
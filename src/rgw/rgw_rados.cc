@@ -1048,6 +1048,11 @@ void RGWRados::finalize()
   delete obj_expirer;
   obj_expirer = NULL;
 
+  if (datacache) {
+    datacache->shutdown();
+    datacache.reset();
+  }
+
   RGWQuotaHandler::free_handler(quota_handler);
   if (cr_registry) {
     cr_registry->put();
@@ -1312,6 +1317,17 @@ int RGWRados::init_ctl()
   return ctl.init(&svc);
 }
 
+int RGWRados::init_datacache()
+{
+  auto cache = std::make_unique<RGWDataCache>(cct);
+  int r = cache->init();
+  if (r < 0) {
+    return r;
+  }
+  datacache = std::move(cache);
+  return 0;
+}
+
 /** 
  * Initialize the RADOS instance and prepare to do other ops
  * Returns 0 on success, -ERR# on failure.
@@ -1766,6 +1782,17 @@ int RGWRados::Bucket::List::list_objects_ordered(int64_t max_p,
   string cur_prefix = prefix_obj.get_index_key_name();
   string after_delim_s; /* needed in !params.delim.empty() AND later */
 
+  /* let the bucket index collapse common prefixes, so we read on the
+   * order of the result size rather than the size of the subtrees. We
+   * can't when the delimiter could match the '_' used to encode
+   * namespaces into index keys, or when a filter we'd have to apply
+   * first is set. */
+  string cls_delim;
+  if (params.ns.empty() && !params.filter &&
+      params.delim.find('_') == string::npos) {
+    cls_delim = params.delim;
+  }
+
   if (!params.delim.empty()) {
     after_delim_s = after_delim(params.delim);
     /* if marker points at a common prefix, fast forward it into its
@@ -1790,6 +1817,7 @@ int RGWRados::Bucket::List::list_objects_ordered(int64_t max_p,
 					   shard_id,
 					   cur_marker,
 					   cur_prefix,
+					   cls_delim,
 					   read_ahead + 1 - count,
 					   params.list_versions,
 					   ent_map,
@@ -4520,7 +4548,7 @@ void RGWRados::update_gc_chain(rgw_obj& head_obj, RGWObjManifest& manifest, cls_
     if (mobj == raw_head)
       continue;
     cls_rgw_obj_key key(mobj.oid);
-    chain->push_obj(mobj.pool.to_str(), key, mobj.loc);
+    chain->push_obj(mobj.pool.to_str(), key, mobj.loc, iter.get_stripe_size());
   }
 }
 
@@ -6035,6 +6063,7 @@ struct get_obj_data {
   uint64_t offset; // next offset to write to client
   rgw::AioResultList completed; // completed read results, sorted by offset
   optional_yield yield;
+  std::map<uint64_t, std::string> cache_fills; // read id -> datacache key
 
   get_obj_data(RGWRados* store, RGWGetDataCB* cb, rgw::Aio* aio,
                uint64_t offset, optional_yield yield)
@@ -6046,6 +6075,17 @@ struct get_obj_data {
       return r;
     }
 
+    if (!cache_fills.empty()) {
+      for (auto& result : results) {
+        auto fill = cache_fills.find(result.id);
+        if (fill == cache_fills.end()) {
+          continue;
+        }
+        store->get_datacache()->put_async(fill->second, result.data);
+        cache_fills.erase(fill);
+      }
+    }
+
     auto cmp = [](const auto& lhs, const auto& rhs) { return lhs.id < rhs.id; };
     results.sort(cmp); // merge() requires results to be sorted first
     completed.merge(results, cmp); // merge results in sorted order
@@ -6130,12 +6170,26 @@ int RGWRados::get_obj_iterate_cb(const rgw_raw_obj& read_obj, off_t obj_ofs,
     return r;
   }
 
-  ldout(cct, 20) << "rados->get_obj_iterate_cb oid=" << read_obj.oid << " obj-ofs=" << obj_ofs << " read_ofs=" << read_ofs << " len=" << len << dendl;
-  op.read(read_ofs, len, nullptr, nullptr);
-
   const uint64_t cost = len;
   const uint64_t id = obj_ofs; // use logical object offset for sorting replies
 
+  // tail objects are immutable once written, and a rewrite of the object
+  // gets a new tag, so tail reads can be served from the local data cache
+  if (datacache && !is_head_obj && astate && astate->obj_tag.length()) {
+    std::string key = RGWDataCache::make_key(read_obj, astate->obj_tag,
+                                             read_ofs, len);
+    bufferlist bl;
+    if (datacache->get(key, len, &bl)) {
+      ldout(cct, 20) << "datacache hit oid=" << read_obj.oid << " obj-ofs=" << obj_ofs << " read_ofs=" << read_ofs << " len=" << len << dendl;
+      auto completed = d->aio->get(obj, rgw::Aio::data_op(std::move(bl)), cost, id);
+      return d->flush(std::move(completed));
+    }
+    d->cache_fills.emplace(id, std::move(key));
+  }
+
+  ldout(cct, 20) << "rados->get_obj_iterate_cb oid=" << read_obj.oid << " obj-ofs=" << obj_ofs << " read_ofs=" << read_ofs << " len=" << len << dendl;
+  op.read(read_ofs, len, nullptr, nullptr);
+
   auto completed = d->aio->get(obj, rgw::Aio::librados_op(std::move(op), d->yield), cost, id);
 
   return d->flush(std::move(completed));
@@ -7990,6 +8044,7 @@ int RGWRados::cls_bucket_list_ordered(RGWBucketInfo& bucket_info,
 				      int shard_id,
 				      const rgw_obj_index_key& start,
 				      const string& prefix,
+				      const string& delimiter,
 				      uint32_t num_entries,
 				      bool list_versions,
 				      ent_map_t& m,
@@ -8000,7 +8055,7 @@ int RGWRados::cls_bucket_list_ordered(RGWBucketInfo& bucket_info,
 {
   ldout(cct, 10) << "cls_bucket_list_ordered " << bucket_info.bucket <<
     " start " << start.name << "[" << start.instance << "] num_entries " <<
-    num_entries << dendl;
+    num_entries << " delimiter " << delimiter << dendl;
 
   RGWSI_RADOS::Pool index_pool;
   // key   - oid (for different shards if there is any)
@@ -8024,7 +8079,8 @@ int RGWRados::cls_bucket_list_ordered(RGWBucketInfo& bucket_info,
   auto& ioctx = index_pool.ioctx();
   map<int, struct rgw_cls_list_ret> list_results;
   cls_rgw_obj_key start_key(start.name, start.instance);
-  r = CLSRGWIssueBucketList(ioctx, start_key, prefix, num_entries_per_shard,
+  r = CLSRGWIssueBucketList(ioctx, start_key, prefix, delimiter,
+			    num_entries_per_shard,
 			    list_versions, oids, list_results,
 			    cct->_conf->rgw_bucket_index_max_aio)();
   if (r < 0) {
@@ -8035,23 +8091,46 @@ int RGWRados::cls_bucket_list_ordered(RGWBucketInfo& bucket_info,
   vector<RGWRados::ent_map_t::iterator> vcurrents;
   vector<RGWRados::ent_map_t::iterator> vends;
   vector<string> vnames;
+  vector<const rgw_cls_list_ret*> vresults;
   vcurrents.reserve(list_results.size());
   vends.reserve(list_results.size());
   vnames.reserve(list_results.size());
+  vresults.reserve(list_results.size());
   for (auto& iter : list_results) {
     vcurrents.push_back(iter.second.dir.m.begin());
     vends.push_back(iter.second.dir.m.end());
     vnames.push_back(oids[iter.first]);
+    vresults.push_back(&iter.second);
   }
 
   // create a map to track the next candidate entry from each shard,
   // if the entry from a specified shard is selected/erased, the next
   // entry from that shard will be inserted for next round selection
   map<string, size_t> candidates;
-  for (size_t i = 0; i < vcurrents.size(); ++i) {
-    if (vcurrents[i] != vends[i]) {
-      candidates[vcurrents[i]->first] = i;
+
+  // once we exhaust one shard that is truncated, one of its next
+  // entries may sort before any remaining candidate; we can only
+  // continue with candidates before the shard's marker (which is empty
+  // from an osd that doesn't report one); S3 and swift protocols allow
+  // returning fewer than what was requested
+  std::optional<string> bound;
+
+  auto add_candidate = [&](size_t i) {
+    // a common prefix can be returned by several shards; keep the
+    // first and step past the others
+    while (vcurrents[i] != vends[i] &&
+	   !candidates.emplace(vcurrents[i]->first, i).second) {
+      ++vcurrents[i];
+    }
+    if (vcurrents[i] == vends[i] && vresults[i]->is_truncated) {
+      const string& shard_marker = vresults[i]->marker.name;
+      if (!bound || shard_marker < *bound) {
+	bound = shard_marker;
+      }
     }
+  };
+  for (size_t i = 0; i < vcurrents.size(); ++i) {
+    add_candidate(i);
   }
 
   map<string, bufferlist> updates;
@@ -8063,9 +8142,16 @@ int RGWRados::cls_bucket_list_ordered(RGWBucketInfo& bucket_info,
     const string& name = vcurrents[pos]->first;
     struct rgw_bucket_dir_entry& dirent = vcurrents[pos]->second;
 
+    if (bound && dirent.key.name >= *bound) {
+      break;
+    }
+
     bool force_check = force_check_filter &&
         force_check_filter(dirent.key.name);
-    if ((!dirent.exists && !dirent.is_delete_marker()) ||
+    if (dirent.is_common_prefix()) {
+      // another shard may have returned this prefix already
+      r = m.count(name) ? -EEXIST : 0;
+    } else if ((!dirent.exists && !dirent.is_delete_marker()) ||
         !dirent.pending_map.empty() ||
         force_check) {
       /* there are uncommitted ops. We need to check the current
@@ -8090,15 +8176,8 @@ int RGWRados::cls_bucket_list_ordered(RGWBucketInfo& bucket_info,
 
     // refresh the candidates map
     candidates.erase(candidates.begin());
-    if (++vcurrents[pos] != vends[pos]) { // note: pre-increment
-      candidates[vcurrents[pos]->first] = pos;
-    } else if (list_results[pos].is_truncated) {
-      // once we exhaust one shard that is truncated, we need to stop,
-      // as we cannot be certain that one of the next entries needs to
-      // come from that shard; S3 and swift protocols allow returning
-      // fewer than what was requested
-      break;
-    }
+    ++vcurrents[pos];
+    add_candidate(pos);
   } // while we haven't provided requested # of result entries
 
   // suggest updates if there is any
@@ -8117,7 +8196,7 @@ int RGWRados::cls_bucket_list_ordered(RGWBucketInfo& bucket_info,
   *is_truncated = false;
   // check if all the returned entries are consumed or not
   for (size_t i = 0; i < vcurrents.size(); ++i) {
-    if (vcurrents[i] != vends[i] || list_results[i].is_truncated) {
+    if (vcurrents[i] != vends[i] || vresults[i]->is_truncated) {
       *is_truncated = true;
       break;
     }
@@ -8216,7 +8295,7 @@ int RGWRados::cls_bucket_list_unordered(RGWBucketInfo& bucket_info,
     rgw_cls_list_ret result;
 
     librados::ObjectReadOperation op;
-    cls_rgw_bucket_list_op(op, marker, prefix, num_entries,
+    cls_rgw_bucket_list_op(op, marker, prefix, "", num_entries,
                            list_versions, &result);
     r = rgw_rados_operate(ioctx, oid, &op, nullptr, null_yield);
     if (r < 0)
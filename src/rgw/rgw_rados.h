@@ -26,6 +26,7 @@
 #include "rgw_sync_module.h"
 #include "rgw_trim_bilog.h"
 #include "rgw_service.h"
+#include "rgw_datacache.h"
 
 #include "services/svc_rados.h"
 #include "services/svc_bi_rados.h"
@@ -470,6 +471,8 @@ protected:
 
   RGWQuotaHandler *quota_handler;
 
+  std::unique_ptr<RGWDataCache> datacache;
+
   RGWCoroutinesManagerRegistry *cr_registry;
 
   RGWSyncModuleInstanceRef sync_module;
@@ -501,6 +504,10 @@ public:
     return lc;
   }
 
+  RGWDataCache *get_datacache() {
+    return datacache.get();
+  }
+
   RGWRados& set_run_gc_thread(bool _use_gc_thread) {
     use_gc_thread = _use_gc_thread;
     return *this;
@@ -596,6 +603,8 @@ public:
   /** Initialize the RADOS instance and prepare to do other ops */
   int init_svc(bool raw);
   int init_ctl();
+  /// start caching object tail data on local disk (rgw_datacache_*)
+  int init_datacache();
   int init_rados();
   int init_complete();
   int initialize();
@@ -1347,6 +1356,7 @@ public:
   int cls_bucket_list_ordered(RGWBucketInfo& bucket_info, int shard_id,
 			      const rgw_obj_index_key& start,
 			      const string& prefix,
+			      const string& delimiter,
 			      uint32_t num_entries, bool list_versions,
 			      ent_map_t& m,
 			      bool *is_truncated,
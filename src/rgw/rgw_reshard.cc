@@ -13,12 +13,15 @@
 #include "cls/lock/cls_lock_client.h"
 #include "common/errno.h"
 #include "common/ceph_json.h"
+#include "include/scope_guard.h"
 
 #include "common/dout.h"
 
 #include "services/svc_zone.h"
 #include "services/svc_sys_obj.h"
 
+#include "rgw_perf_counters.h"
+
 #define dout_context g_ceph_context
 #define dout_subsys ceph_subsys_rgw
 
@@ -63,6 +66,7 @@ class BucketReshardShard {
   int num_shard;
   RGWRados::BucketShard bs;
   vector<rgw_cls_bi_entry> entries;
+  set<string> removals;
   map<RGWObjCategory, rgw_bucket_category_stats> stats;
   deque<librados::AioCompletion *>& aio_completions;
   uint64_t max_aio_completions;
@@ -119,6 +123,10 @@ public:
     return num_shard;
   }
 
+  RGWRados::BucketShard& get_bucket_shard() {
+    return bs;
+  }
+
   int add_entry(rgw_cls_bi_entry& entry, bool account, RGWObjCategory category,
                 const rgw_bucket_category_stats& entry_stats) {
     entries.push_back(entry);
@@ -129,7 +137,19 @@ public:
       target.total_size_rounded += entry_stats.total_size_rounded;
       target.actual_size += entry_stats.actual_size;
     }
-    if (entries.size() >= reshard_shard_batch_size) {
+    if (entries.size() + removals.size() >= reshard_shard_batch_size) {
+      int ret = flush();
+      if (ret < 0) {
+        return ret;
+      }
+    }
+
+    return 0;
+  }
+
+  int remove_entry(const string& idx) {
+    removals.insert(idx);
+    if (entries.size() + removals.size() >= reshard_shard_batch_size) {
       int ret = flush();
       if (ret < 0) {
         return ret;
@@ -139,12 +159,36 @@ public:
     return 0;
   }
 
+  // the stats of removed or overwritten entries can't be sent as an
+  // increment; nothing else writes to the new index yet, so read the
+  // header and store the difference
+  int unaccount(const map<RGWObjCategory, rgw_bucket_category_stats>& removed) {
+    vector<rgw_bucket_dir_header> headers;
+    int ret = store->getRados()->cls_bucket_head(bucket_info, num_shard, headers);
+    if (ret < 0) {
+      return ret;
+    }
+    if (headers.empty()) {
+      return -EIO;
+    }
+
+    auto& header_stats = headers.front().stats;
+    RGWBucketReshard::unaccount_stats(header_stats, removed);
+
+    librados::ObjectWriteOperation op;
+    cls_rgw_bucket_update_stats(op, true, header_stats);
+    return bs.bucket_obj.operate(&op, null_yield);
+  }
+
   int flush() {
-    if (entries.size() == 0) {
+    if (entries.size() == 0 && removals.size() == 0) {
       return 0;
     }
 
     librados::ObjectWriteOperation op;
+    if (!removals.empty()) {
+      op.omap_rm_keys(removals);
+    }
     for (auto& entry : entries) {
       store->getRados()->bi_put(op, bs, entry);
     }
@@ -161,6 +205,7 @@ public:
       return ret;
     }
     entries.clear();
+    removals.clear();
     stats.clear();
     return 0;
   }
@@ -184,6 +229,7 @@ class BucketReshardManager {
   deque<librados::AioCompletion *> completions;
   int num_target_shards;
   vector<BucketReshardShard *> target_shards;
+  map<int, map<RGWObjCategory, rgw_bucket_category_stats>> removed_stats;
 
 public:
   BucketReshardManager(rgw::sal::RGWRadosStore *_store,
@@ -222,7 +268,34 @@ public:
     return 0;
   }
 
-  int finish() {
+  int remove_entry(int shard_index, const string& idx) {
+    int ret = target_shards[shard_index]->remove_entry(idx);
+    if (ret < 0) {
+      derr << "ERROR: target_shards.remove_entry(" << idx <<
+	") returned error: " << cpp_strerror(-ret) << dendl;
+      return ret;
+    }
+
+    return 0;
+  }
+
+  void unaccount_entries(int shard_index,
+			 const map<RGWObjCategory, rgw_bucket_category_stats>& removed) {
+    for (auto& [category, entry_stats] : removed) {
+      rgw_bucket_category_stats& target = removed_stats[shard_index][category];
+      target.num_entries += entry_stats.num_entries;
+      target.total_size += entry_stats.total_size;
+      target.total_size_rounded += entry_stats.total_size_rounded;
+      target.actual_size += entry_stats.actual_size;
+    }
+  }
+
+  RGWRados::BucketShard& get_bucket_shard(int shard_index) {
+    return target_shards[shard_index]->get_bucket_shard();
+  }
+
+  // wait until every entry added so far is stored
+  int drain() {
     int ret = 0;
     for (auto& shard : target_shards) {
       int r = shard->flush();
@@ -237,6 +310,22 @@ public:
         derr << "ERROR: target_shards[" << shard->get_num_shard() << "].wait_all_aio() returned error: " << cpp_strerror(-r) << dendl;
         ret = r;
       }
+    }
+    return ret;
+  }
+
+  int finish() {
+    int ret = drain();
+    if (ret == 0) {
+      for (auto& [shard_index, stats] : removed_stats) {
+	int r = target_shards[shard_index]->unaccount(stats);
+	if (r < 0) {
+	  derr << "ERROR: target_shards[" << shard_index << "].unaccount() returned error: " << cpp_strerror(-r) << dendl;
+	  ret = r;
+	}
+      }
+    }
+    for (auto& shard : target_shards) {
       delete shard;
     }
     target_shards.clear();
@@ -433,6 +522,11 @@ public:
     in_progress = false;
     return 0;
   }
+
+  // leave the reshard state in place so the reshard can be resumed
+  void suspend() {
+    in_progress = false;
+  }
 };
 
 
@@ -514,12 +608,246 @@ int RGWBucketReshardLock::renew(const Clock::time_point& now) {
 }
 
 
+static int get_target_shard(rgw::sal::RGWRadosStore *store,
+			    const RGWBucketInfo& new_bucket_info,
+			    const cls_rgw_obj_key& cls_key,
+			    int *shard_index)
+{
+  rgw_obj_key key(cls_key);
+  rgw_obj obj(new_bucket_info.bucket, key);
+  int target_shard_id;
+  int ret = store->getRados()->get_target_shard_id(new_bucket_info, obj.get_hash_object(), &target_shard_id);
+  if (ret < 0) {
+    lderr(store->ctx()) << "ERROR: get_target_shard_id() returned ret=" << ret << dendl;
+    return ret;
+  }
+
+  *shard_index = (target_shard_id > 0 ? target_shard_id : 0);
+  return 0;
+}
+
+static int list_object_entries(rgw::sal::RGWRadosStore *store,
+			       RGWRados::BucketShard& bs,
+			       const string& name, int max_entries,
+			       list<rgw_cls_bi_entry> *entries)
+{
+  string marker;
+  bool is_truncated = true;
+  while (is_truncated) {
+    list<rgw_cls_bi_entry> batch;
+    int ret = store->getRados()->bi_list(bs, name, marker, max_entries, &batch, &is_truncated);
+    if (ret == -ENOENT) {
+      break;
+    }
+    if (ret < 0) {
+      return ret;
+    }
+    if (batch.empty()) {
+      break;
+    }
+    marker = batch.back().idx;
+    entries->splice(entries->end(), batch);
+  }
+  return 0;
+}
+
+void RGWBucketReshard::unaccount_stats(
+  map<RGWObjCategory, rgw_bucket_category_stats>& stats,
+  const map<RGWObjCategory, rgw_bucket_category_stats>& removed)
+{
+  for (auto& [category, s] : removed) {
+    rgw_bucket_category_stats& target = stats[category];
+    target.num_entries -= std::min(target.num_entries, s.num_entries);
+    target.total_size -= std::min(target.total_size, s.total_size);
+    target.total_size_rounded -= std::min(target.total_size_rounded,
+					  s.total_size_rounded);
+    target.actual_size -= std::min(target.actual_size, s.actual_size);
+  }
+}
+
+void RGWBucketReshard::plan_replay(
+  const list<rgw_cls_bi_entry>& entries,
+  const list<rgw_cls_bi_entry>& copied_entries,
+  set<string> *removals,
+  map<RGWObjCategory, rgw_bucket_category_stats> *unaccounted)
+{
+  // entries that still exist are overwritten rather than removed
+  set<string> keep;
+  for (auto& entry : entries) {
+    keep.insert(entry.idx);
+  }
+  for (auto entry : copied_entries) { // get_info() isn't const
+    cls_rgw_obj_key cls_key;
+    RGWObjCategory category;
+    rgw_bucket_category_stats stats;
+    if (entry.get_info(&cls_key, &category, &stats)) {
+      rgw_bucket_category_stats& target = (*unaccounted)[category];
+      target.num_entries += stats.num_entries;
+      target.total_size += stats.total_size;
+      target.total_size_rounded += stats.total_size_rounded;
+      target.actual_size += stats.actual_size;
+    }
+    if (!keep.count(entry.idx)) {
+      removals->insert(entry.idx);
+    }
+  }
+}
+
+int RGWBucketReshard::renew_locks(const Clock::time_point& now)
+{
+  if (!reshard_lock.should_renew(now)) {
+    return 0;
+  }
+  // assume outer locks have timespans at least the size of ours, so
+  // can call inside conditional
+  if (outer_reshard_lock) {
+    int ret = outer_reshard_lock->renew(now);
+    if (ret < 0) {
+      return ret;
+    }
+  }
+  int ret = reshard_lock.renew(now);
+  if (ret < 0) {
+    lderr(store->ctx()) << "Error renewing bucket lock: " << ret << dendl;
+    return ret;
+  }
+  return 0;
+}
+
+// copy again the entries of every object that was written since the
+// old index was copied.  With trim, writes to the old index may go on:
+// the records of the objects copied are dropped once their entries are
+// stored, unless the object was written again in the meantime, so the
+// next pass only has to copy what was written during this one.
+int RGWBucketReshard::replay_reshard_log(const RGWBucketInfo& new_bucket_info,
+					 int max_entries, bool trim,
+					 uint64_t *replayed)
+{
+  const int num_source_shards =
+    (bucket_info.num_shards > 0 ? bucket_info.num_shards : 1);
+  const int num_target_shards =
+    (new_bucket_info.num_shards > 0 ? new_bucket_info.num_shards : 1);
+
+  BucketReshardManager target_shards_mgr(store, new_bucket_info, num_target_shards);
+
+  *replayed = 0;
+  for (int i = 0; i < num_source_shards; ++i) {
+    RGWRados::BucketShard bs(store->getRados());
+    int ret = bs.init(bucket_info, (bucket_info.num_shards > 0 ? i : -1));
+    if (ret < 0) {
+      return ret;
+    }
+    auto& ref = bs.bucket_obj.get_ref();
+
+    string marker;
+    bool is_truncated = true;
+    while (is_truncated) {
+      map<string, uint64_t> records;
+      ret = cls_rgw_reshard_log_list(ref.pool.ioctx(), ref.obj.oid, marker,
+				     max_entries, &records, &is_truncated);
+      if (ret < 0) {
+	lderr(store->ctx()) << "ERROR: failed to list reshard log of " <<
+	  ref.obj.oid << ": " << cpp_strerror(-ret) << dendl;
+	return ret;
+      }
+
+      for (auto& [name, ver] : records) {
+	marker = name;
+
+	int shard_index;
+	ret = get_target_shard(store, new_bucket_info, cls_rgw_obj_key(name),
+			       &shard_index);
+	if (ret < 0) {
+	  return ret;
+	}
+
+	list<rgw_cls_bi_entry> entries;
+	ret = list_object_entries(store, bs, name, max_entries, &entries);
+	if (ret < 0) {
+	  return ret;
+	}
+	list<rgw_cls_bi_entry> copied_entries;
+	ret = list_object_entries(store,
+				  target_shards_mgr.get_bucket_shard(shard_index),
+				  name, max_entries, &copied_entries);
+	if (ret < 0) {
+	  return ret;
+	}
+
+	// drop what an earlier copy stored for this object
+	set<string> removals;
+	map<RGWObjCategory, rgw_bucket_category_stats> unaccounted;
+	plan_replay(entries, copied_entries, &removals, &unaccounted);
+	target_shards_mgr.unaccount_entries(shard_index, unaccounted);
+	for (auto& idx : removals) {
+	  ret = target_shards_mgr.remove_entry(shard_index, idx);
+	  if (ret < 0) {
+	    return ret;
+	  }
+	}
+
+	for (auto& entry : entries) {
+	  cls_rgw_obj_key cls_key;
+	  RGWObjCategory category;
+	  rgw_bucket_category_stats stats;
+	  bool account = entry.get_info(&cls_key, &category, &stats);
+	  ret = target_shards_mgr.add_entry(shard_index, entry, account,
+					    category, stats);
+	  if (ret < 0) {
+	    return ret;
+	  }
+	}
+	++(*replayed);
+      }
+
+      if (trim && !records.empty()) {
+	// the records may only go once what they stand for is stored
+	ret = target_shards_mgr.drain();
+	if (ret < 0) {
+	  return ret;
+	}
+	librados::ObjectWriteOperation op;
+	cls_rgw_reshard_log_trim(op, records);
+	ret = bs.bucket_obj.operate(&op, null_yield);
+	if (ret < 0) {
+	  lderr(store->ctx()) << "ERROR: failed to trim reshard log of " <<
+	    ref.obj.oid << ": " << cpp_strerror(-ret) << dendl;
+	  return ret;
+	}
+      }
+
+      ret = renew_locks(Clock::now());
+      if (ret < 0) {
+	return ret;
+      }
+    }
+  }
+
+  int ret = target_shards_mgr.finish();
+  if (ret < 0) {
+    lderr(store->ctx()) << "ERROR: failed to replay reshard log" << dendl;
+    return -EIO;
+  }
+
+  if (perfcounter) {
+    perfcounter->inc(l_rgw_reshard_replay, *replayed);
+  }
+  ldout(store->ctx(), 5) << __func__ << ": copied " << *replayed <<
+    " objects written during the reshard of bucket " <<
+    bucket_info.bucket.name << dendl;
+  return 0;
+}
+
 int RGWBucketReshard::do_reshard(int num_shards,
 				 RGWBucketInfo& new_bucket_info,
 				 int max_entries,
 				 bool verbose,
 				 ostream *out,
-				 Formatter *formatter)
+				 Formatter *formatter,
+				 bool online,
+				 RGWReshard *reshard_log,
+				 const cls_rgw_reshard_entry *resume_from,
+				 bool *suspended)
 {
   rgw_bucket& bucket = bucket_info.bucket;
 
@@ -553,6 +881,26 @@ int RGWBucketReshard::do_reshard(int num_shards,
     return ret;
   }
 
+  // once the progress of an online reshard is saved, leave the reshard
+  // in place on failure so the reshard thread can resume it
+  bool checkpointed = (resume_from != nullptr);
+  bool blocked = false;
+  bool done = false;
+  auto suspend_on_error = make_scope_guard([&] {
+      if (!checkpointed || done) {
+	return;
+      }
+      if (blocked) {
+	int r = set_resharding_status(new_bucket_info.bucket.bucket_id,
+				      num_shards, CLS_RGW_RESHARD_IN_LOGRECORD);
+	if (r < 0) {
+	  return;
+	}
+      }
+      bucket_info_updater.suspend();
+      *suspended = true;
+    });
+
   int num_target_shards = (new_bucket_info.num_shards > 0 ? new_bucket_info.num_shards : 1);
 
   BucketReshardManager target_shards_mgr(store, new_bucket_info, num_target_shards);
@@ -571,10 +919,31 @@ int RGWBucketReshard::do_reshard(int num_shards,
 
   const int num_source_shards =
     (bucket_info.num_shards > 0 ? bucket_info.num_shards : 1);
-  string marker;
-  for (int i = 0; i < num_source_shards; ++i) {
+
+  uint64_t expected_entries = 0;
+  if (perfcounter) {
+    vector<rgw_bucket_dir_header> headers;
+    if (store->getRados()->cls_bucket_head(bucket_info, RGW_NO_SHARD, headers) >= 0) {
+      for (auto& header : headers) {
+	for (auto& [category, stats] : header.stats) {
+	  expected_entries += stats.num_entries;
+	}
+      }
+    }
+    perfcounter->set(l_rgw_reshard_progress, 0);
+  }
+
+  const auto checkpoint_interval = std::chrono::seconds(
+    store->ctx()->_conf.get_val<uint64_t>("rgw_reshard_checkpoint_interval"));
+  Clock::time_point next_checkpoint = Clock::now() + checkpoint_interval;
+
+  const int start_shard = (resume_from ? resume_from->checkpoint_shard : 0);
+  string marker = (resume_from ? resume_from->checkpoint_marker : string());
+  for (int i = start_shard; i < num_source_shards; ++i) {
     bool is_truncated = true;
-    marker.clear();
+    if (i > start_shard) {
+      marker.clear();
+    }
     while (is_truncated) {
       entries.clear();
       ret = store->getRados()->bi_list(bucket, i, string(), marker, max_entries, &entries, &is_truncated);
@@ -596,42 +965,51 @@ int RGWBucketReshard::do_reshard(int num_shards,
 
 	marker = entry.idx;
 
-	int target_shard_id;
 	cls_rgw_obj_key cls_key;
 	RGWObjCategory category;
 	rgw_bucket_category_stats stats;
 	bool account = entry.get_info(&cls_key, &category, &stats);
-	rgw_obj_key key(cls_key);
-	rgw_obj obj(new_bucket_info.bucket, key);
-	int ret = store->getRados()->get_target_shard_id(new_bucket_info, obj.get_hash_object(), &target_shard_id);
+
+	int shard_index;
+	ret = get_target_shard(store, new_bucket_info, cls_key, &shard_index);
 	if (ret < 0) {
-	  lderr(store->ctx()) << "ERROR: get_target_shard_id() returned ret=" << ret << dendl;
 	  return ret;
 	}
 
-	int shard_index = (target_shard_id > 0 ? target_shard_id : 0);
-
 	ret = target_shards_mgr.add_entry(shard_index, entry, account,
 					  category, stats);
 	if (ret < 0) {
 	  return ret;
 	}
 
-	Clock::time_point now = Clock::now();
-	if (reshard_lock.should_renew(now)) {
-	  // assume outer locks have timespans at least the size of ours, so
-	  // can call inside conditional
-	  if (outer_reshard_lock) {
-	    ret = outer_reshard_lock->renew(now);
-	    if (ret < 0) {
-	      return ret;
-	    }
+	if (perfcounter) {
+	  perfcounter->inc(l_rgw_reshard_copy);
+	  if (expected_entries > 0 && !(total_entries % 1000)) {
+	    perfcounter->set(l_rgw_reshard_progress,
+			     std::min<uint64_t>(99, total_entries * 100 / expected_entries));
 	  }
-	  ret = reshard_lock.renew(now);
+	}
+
+	Clock::time_point now = Clock::now();
+	if (online && reshard_log && now >= next_checkpoint) {
+	  // everything up to the marker must be stored before it is saved
+	  ret = target_shards_mgr.drain();
 	  if (ret < 0) {
-	    lderr(store->ctx()) << "Error renewing bucket lock: " << ret << dendl;
 	    return ret;
 	  }
+	  ret = reshard_log->checkpoint(bucket_info, i, marker);
+	  if (ret < 0) {
+	    ldout(store->ctx(), 0) << __func__ <<
+	      ": failed to save reshard progress ret=" << ret << dendl;
+	  } else {
+	    checkpointed = true;
+	  }
+	  next_checkpoint = now + checkpoint_interval;
+	}
+
+	ret = renew_locks(now);
+	if (ret < 0) {
+	  return ret;
 	}
 
 	if (verbose_json_out) {
@@ -657,11 +1035,77 @@ int RGWBucketReshard::do_reshard(int num_shards,
     return -EIO;
   }
 
+  ceph::mono_time block_start = ceph::mono_clock::now();
+  if (online) {
+    if (resume_from) {
+      // entries copied after the checkpoint were accounted twice
+      ret = store->getRados()->bucket_rebuild_index(new_bucket_info);
+      if (ret < 0) {
+	lderr(store->ctx()) << "ERROR: failed to recalculate stats of new bucket index: " << cpp_strerror(-ret) << dendl;
+	return ret;
+      }
+    }
+
+    // nothing is left to copy if the reshard has to be resumed from
+    // here on
+    if (reshard_log) {
+      ret = reshard_log->checkpoint(bucket_info, num_source_shards, string());
+      if (ret < 0) {
+	ldout(store->ctx(), 0) << __func__ <<
+	  ": failed to save reshard progress ret=" << ret << dendl;
+      } else {
+	checkpointed = true;
+      }
+    }
+
+    // catch up with the writes made during the copy while they go on,
+    // until what is left is small enough to copy with writes blocked
+    const uint64_t catchup_threshold = store->ctx()->_conf.get_val<uint64_t>(
+      "rgw_reshard_catchup_threshold");
+    const uint64_t catchup_max_passes = store->ctx()->_conf.get_val<uint64_t>(
+      "rgw_reshard_catchup_max_passes");
+    for (uint64_t pass = 0; pass < catchup_max_passes; ++pass) {
+      uint64_t replayed;
+      ret = replay_reshard_log(new_bucket_info, max_entries, true, &replayed);
+      if (ret < 0) {
+	return ret;
+      }
+      if (replayed <= catchup_threshold) {
+	break;
+      }
+    }
+
+    // block writes to the old index, then copy again whatever was
+    // written during the last pass
+    block_start = ceph::mono_clock::now();
+    ret = set_resharding_status(new_bucket_info.bucket.bucket_id,
+				num_shards, CLS_RGW_RESHARD_IN_PROGRESS);
+    if (ret < 0) {
+      return ret;
+    }
+    blocked = true;
+
+    uint64_t replayed;
+    ret = replay_reshard_log(new_bucket_info, max_entries, false, &replayed);
+    if (ret < 0) {
+      return ret;
+    }
+  }
+
   ret = store->ctl()->bucket->link_bucket(new_bucket_info.owner, new_bucket_info.bucket, bucket_info.creation_time, null_yield);
   if (ret < 0) {
     lderr(store->ctx()) << "failed to link new bucket instance (bucket_id=" << new_bucket_info.bucket.bucket_id << ": " << cpp_strerror(-ret) << ")" << dendl;
     return ret;
   }
+  done = true;
+
+  if (perfcounter) {
+    perfcounter->set(l_rgw_reshard_progress, 100);
+    if (online) {
+      perfcounter->tinc(l_rgw_reshard_block_lat,
+			ceph::mono_clock::now() - block_start);
+    }
+  }
 
   ret = bucket_info_updater.complete();
   if (ret < 0) {
@@ -679,43 +1123,126 @@ int RGWBucketReshard::get_status(list<cls_rgw_bucket_instance_entry> *status)
 }
 
 
+int RGWBucketReshard::check_resume(const cls_rgw_reshard_entry& entry,
+				   const RGWBucketInfo& bucket_info,
+				   const list<cls_rgw_bucket_instance_entry>& status)
+{
+  const string& new_bucket_id = bucket_info.new_bucket_instance_id;
+  if (!entry.has_checkpoint() || new_bucket_id.empty() ||
+      entry.new_instance_id != bucket_info.bucket.name + ":" + new_bucket_id) {
+    return -ENOENT;
+  }
+  for (auto& s : status) {
+    if (s.new_bucket_instance_id != new_bucket_id ||
+	!(s.resharding_log_record() || s.resharding_in_progress())) {
+      return -ESTALE;
+    }
+  }
+  return 0;
+}
+
+// an interrupted online reshard can be resumed as long as the old
+// index shards still log writes for its new bucket instance
+int RGWBucketReshard::get_resume_instance(const cls_rgw_reshard_entry& entry,
+					  RGWBucketInfo *new_bucket_info)
+{
+  const string& new_bucket_id = bucket_info.new_bucket_instance_id;
+  list<cls_rgw_bucket_instance_entry> status;
+  int ret = get_status(&status);
+  if (ret < 0) {
+    return ret;
+  }
+  ret = check_resume(entry, bucket_info, status);
+  if (ret < 0) {
+    return ret;
+  }
+
+  rgw_bucket new_bucket = bucket_info.bucket;
+  new_bucket.bucket_id = new_bucket_id;
+  auto obj_ctx = store->svc()->sysobj->init_obj_ctx();
+  ret = store->getRados()->get_bucket_instance_info(obj_ctx, new_bucket,
+						    *new_bucket_info, nullptr,
+						    nullptr, null_yield);
+  if (ret < 0) {
+    return ret;
+  }
+
+  // writes are still blocked if the reshard stopped while replaying
+  // the log
+  return set_resharding_status(new_bucket_id, new_bucket_info->num_shards,
+			       CLS_RGW_RESHARD_IN_LOGRECORD);
+}
+
 int RGWBucketReshard::execute(int num_shards, int max_op_entries,
                               bool verbose, ostream *out, Formatter *formatter,
-			      RGWReshard* reshard_log)
+			      RGWReshard* reshard_log,
+			      const cls_rgw_reshard_entry *resume_from)
 {
   int ret = reshard_lock.lock();
   if (ret < 0) {
     return ret;
   }
 
+  bool online = store->ctx()->_conf.get_val<bool>("rgw_reshard_online");
+  bool suspended = false;
   RGWBucketInfo new_bucket_info;
-  ret = create_new_bucket_instance(num_shards, new_bucket_info);
-  if (ret < 0) {
-    // shard state is uncertain, but this will attempt to remove them anyway
-    goto error_out;
+
+  if (resume_from) {
+    ret = get_resume_instance(*resume_from, &new_bucket_info);
+    if (ret < 0) {
+      ldout(store->ctx(), 0) << __func__ << ": can't resume reshard of bucket " <<
+	bucket_info.bucket.name << ", starting over: " << cpp_strerror(-ret) << dendl;
+      resume_from = nullptr;
+      ret = clear_resharding();
+      if (ret < 0) {
+	reshard_lock.unlock();
+	return ret;
+      }
+    } else {
+      online = true;
+      num_shards = new_bucket_info.num_shards;
+    }
   }
 
-  if (reshard_log) {
-    ret = reshard_log->update(bucket_info, new_bucket_info);
+  if (!resume_from) {
+    ret = create_new_bucket_instance(num_shards, new_bucket_info);
     if (ret < 0) {
+      // shard state is uncertain, but this will attempt to remove them anyway
       goto error_out;
     }
-  }
 
-  // set resharding status of current bucket_info & shards with
-  // information about planned resharding
-  ret = set_resharding_status(new_bucket_info.bucket.bucket_id,
-			      num_shards, CLS_RGW_RESHARD_IN_PROGRESS);
-  if (ret < 0) {
-    reshard_lock.unlock();
-    return ret;
+    if (reshard_log) {
+      ret = reshard_log->update(bucket_info, new_bucket_info);
+      if (ret < 0) {
+	goto error_out;
+      }
+    }
+
+    // set resharding status of current bucket_info & shards with
+    // information about planned resharding; an online reshard only
+    // blocks writes once it has copied the index
+    ret = set_resharding_status(new_bucket_info.bucket.bucket_id,
+				num_shards,
+				(online ? CLS_RGW_RESHARD_IN_LOGRECORD :
+				 CLS_RGW_RESHARD_IN_PROGRESS));
+    if (ret < 0) {
+      reshard_lock.unlock();
+      return ret;
+    }
   }
 
   ret = do_reshard(num_shards,
 		   new_bucket_info,
 		   max_op_entries,
-                   verbose, out, formatter);
+                   verbose, out, formatter,
+		   online, reshard_log, resume_from, &suspended);
   if (ret < 0) {
+    if (suspended) {
+      ldout(store->ctx(), 0) << __func__ << ": reshard of bucket " <<
+	bucket_info.bucket.name << " interrupted, will resume from saved progress" << dendl;
+      reshard_lock.unlock();
+      return ret;
+    }
     goto error_out;
   }
 
@@ -841,6 +1368,33 @@ int RGWReshard::update(const RGWBucketInfo& bucket_info, const RGWBucketInfo& ne
   }
 
   entry.new_instance_id = new_bucket_info.bucket.name + ":"  + new_bucket_info.bucket.bucket_id;
+  entry.checkpoint_shard = -1;
+  entry.checkpoint_marker.clear();
+
+  ret = add(entry);
+  if (ret < 0) {
+    ldout(store->ctx(), 0) << __func__ << ":Error in updating entry bucket " << entry.bucket_name << ": " <<
+      cpp_strerror(-ret) << dendl;
+  }
+
+  return ret;
+}
+
+int RGWReshard::checkpoint(const RGWBucketInfo& bucket_info, int shard_id,
+			   const string& marker)
+{
+  cls_rgw_reshard_entry entry;
+  entry.bucket_name = bucket_info.bucket.name;
+  entry.bucket_id = bucket_info.bucket.bucket_id;
+  entry.tenant = bucket_info.owner.tenant;
+
+  int ret = get(entry);
+  if (ret < 0) {
+    return ret;
+  }
+
+  entry.checkpoint_shard = shard_id;
+  entry.checkpoint_marker = marker;
 
   ret = add(entry);
   if (ret < 0) {
@@ -1000,7 +1554,7 @@ int RGWReshard::process_single_logshard(int logshard_num)
     }
 
     for(auto& entry: entries) { // logshard entries
-      if(entry.new_instance_id.empty()) {
+      if (entry.new_instance_id.empty() || entry.has_checkpoint()) {
 
 	ldout(store->ctx(), 20) << __func__ << " resharding " <<
 	  entry.bucket_name  << dendl;
@@ -1043,7 +1597,8 @@ int RGWReshard::process_single_logshard(int logshard_num)
 
 	RGWBucketReshard br(store, bucket_info, attrs, nullptr);
 	ret = br.execute(entry.new_num_shards, max_entries, false, nullptr,
-			 nullptr, this);
+			 nullptr, this,
+			 (entry.has_checkpoint() ? &entry : nullptr));
 	if (ret < 0) {
 	  ldout(store->ctx(), 0) <<  __func__ <<
 	    ": Error during resharding bucket " << entry.bucket_name << ":" <<
@@ -91,7 +91,16 @@ private:
 		 int max_entries,
                  bool verbose,
                  ostream *os,
-		 Formatter *formatter);
+		 Formatter *formatter,
+		 bool online,
+		 RGWReshard *reshard_log,
+		 const cls_rgw_reshard_entry *resume_from,
+		 bool *suspended);
+  int replay_reshard_log(const RGWBucketInfo& new_bucket_info,
+			 int max_entries, bool trim, uint64_t *replayed);
+  int renew_locks(const Clock::time_point& now);
+  int get_resume_instance(const cls_rgw_reshard_entry& entry,
+			  RGWBucketInfo *new_bucket_info);
 public:
 
   // pass nullptr for the final parameter if no outer reshard lock to
@@ -100,12 +109,34 @@ public:
 		   const RGWBucketInfo& _bucket_info,
                    const std::map<string, bufferlist>& _bucket_attrs,
 		   RGWBucketReshardLock* _outer_reshard_lock);
+  // pass the queue entry of an online reshard that saved its progress
+  // as resume_from to continue it
   int execute(int num_shards, int max_op_entries,
               bool verbose = false, ostream *out = nullptr,
               Formatter *formatter = nullptr,
-	      RGWReshard *reshard_log = nullptr);
+	      RGWReshard *reshard_log = nullptr,
+	      const cls_rgw_reshard_entry *resume_from = nullptr);
   int get_status(std::list<cls_rgw_bucket_instance_entry> *status);
   int cancel();
+
+  // what copying the entries of a logged object again does to what an
+  // earlier copy stored for it: the keys it removes, and the stats of
+  // the entries it removes or overwrites
+  static void plan_replay(const std::list<rgw_cls_bi_entry>& entries,
+			  const std::list<rgw_cls_bi_entry>& copied_entries,
+			  std::set<string> *removals,
+			  std::map<RGWObjCategory, rgw_bucket_category_stats> *unaccounted);
+  // subtract removed from stats, never going below zero
+  static void unaccount_stats(
+    std::map<RGWObjCategory, rgw_bucket_category_stats>& stats,
+    const std::map<RGWObjCategory, rgw_bucket_category_stats>& removed);
+  // whether the reshard saved in entry can be resumed, given the bucket
+  // and the reshard status of its index shards: -ENOENT if it saved no
+  // progress for the bucket's new instance, -ESTALE if the shards no
+  // longer log writes for it
+  static int check_resume(const cls_rgw_reshard_entry& entry,
+			  const RGWBucketInfo& bucket_info,
+			  const std::list<cls_rgw_bucket_instance_entry>& status);
   static int clear_resharding(rgw::sal::RGWRadosStore* store,
 			      const RGWBucketInfo& bucket_info);
   int clear_resharding() {
@@ -229,6 +260,7 @@ public:
   RGWReshard(rgw::sal::RGWRadosStore* _store, bool _verbose = false, ostream *_out = nullptr, Formatter *_formatter = nullptr);
   int add(cls_rgw_reshard_entry& entry);
   int update(const RGWBucketInfo& bucket_info, const RGWBucketInfo& new_bucket_info);
+  int checkpoint(const RGWBucketInfo& bucket_info, int shard_id, const string& marker);
   int get(cls_rgw_reshard_entry& entry);
   int remove(cls_rgw_reshard_entry& entry);
   int list(int logshard_num, string& marker, uint32_t max, std::list<cls_rgw_reshard_entry>& entries, bool *is_truncated);
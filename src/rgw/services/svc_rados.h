@@ -169,6 +169,11 @@ public:
     int aio_operate(librados::AioCompletion *c, librados::ObjectWriteOperation *op);
     int aio_operate(librados::AioCompletion *c, librados::ObjectReadOperation *op,
                     bufferlist *pbl);
+    // flags are librados::OPERATION_*
+    int aio_operate(librados::AioCompletion *c, librados::ObjectWriteOperation *op,
+                    int flags);
+    int aio_operate(librados::AioCompletion *c, librados::ObjectReadOperation *op,
+                    int flags, bufferlist *pbl);
 
     int watch(uint64_t *handle, librados::WatchCtx2 *ctx);
     int aio_watch(librados::AioCompletion *c, uint64_t *handle, librados::WatchCtx2 *ctx);
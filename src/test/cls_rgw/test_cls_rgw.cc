@@ -421,7 +421,7 @@ TEST_F(cls_rgw, index_list)
   map<int, string> oids = { {0, bucket_oid} };
   map<int, struct rgw_cls_list_ret> list_results;
   cls_rgw_obj_key start_key("", "");
-  int r = CLSRGWIssueBucketList(ioctx, start_key, "", 1000, true, oids, list_results, 1)();
+  int r = CLSRGWIssueBucketList(ioctx, start_key, "", "", 1000, true, oids, list_results, 1)();
 
   ASSERT_EQ(r, 0);
   ASSERT_EQ(1u, list_results.size());
@@ -436,6 +436,220 @@ TEST_F(cls_rgw, index_list)
 }
 
 
+TEST_F(cls_rgw, list_delimited)
+{
+  string bucket_oid = "bucket_delimited";
+
+  ObjectWriteOperation op;
+  cls_rgw_bucket_init_index(op);
+  ASSERT_EQ(0, ioctx.operate(bucket_oid, &op));
+
+  // 3 top-level objects and 2 "directories" of 50 objects each
+  vector<string> names = { "a", "m", "z" };
+  for (int i = 0; i < 50; i++) {
+    names.push_back(str_int("dir1/obj", i));
+    names.push_back(str_int("dir2/sub/obj", i));
+  }
+  for (auto& name : names) {
+    cls_rgw_obj_key obj(name);
+    string tag = "tag";
+    string loc = "loc";
+    index_prepare(ioctx, bucket_oid, CLS_RGW_OP_ADD, tag, obj, loc, 0, false);
+
+    rgw_bucket_dir_entry_meta meta;
+    meta.category = RGWObjCategory::None;
+    meta.size = 1;
+    index_complete(ioctx, bucket_oid, CLS_RGW_OP_ADD, tag, 1, obj, meta, 0, false);
+  }
+
+  map<int, string> oids = { {0, bucket_oid} };
+  auto list = [&](const string& start, const string& prefix,
+                  uint32_t num_entries, rgw_cls_list_ret *ret) {
+    map<int, rgw_cls_list_ret> results;
+    cls_rgw_obj_key start_key(start, "");
+    ASSERT_EQ(0, CLSRGWIssueBucketList(ioctx, start_key, prefix, "/",
+                                       num_entries, false, oids, results, 1)());
+    ASSERT_EQ(1u, results.size());
+    *ret = std::move(results.begin()->second);
+  };
+
+  // each directory comes back as one entry, in order
+  rgw_cls_list_ret ret;
+  list("", "", 100, &ret);
+  ASSERT_FALSE(ret.is_truncated);
+  vector<string> expected = { "a", "dir1/", "dir2/", "m", "z" };
+  ASSERT_EQ(expected.size(), ret.dir.m.size());
+  auto iter = ret.dir.m.begin();
+  for (auto& name : expected) {
+    ASSERT_EQ(name, iter->first);
+    ASSERT_EQ(name.back() == '/', iter->second.is_common_prefix());
+    ++iter;
+  }
+
+  // a truncated listing reports how far it got, past the last prefix
+  list("", "", 2, &ret);
+  ASSERT_TRUE(ret.is_truncated);
+  ASSERT_EQ(2u, ret.dir.m.size());
+  ASSERT_EQ("dir1/", ret.dir.m.rbegin()->first);
+  ASSERT_LT(string("dir1/obj-9"), ret.marker.name);
+  ASSERT_GT(string("dir2/"), ret.marker.name);
+
+  list(ret.marker.name, "", 100, &ret);
+  ASSERT_FALSE(ret.is_truncated);
+  expected = { "dir2/", "m", "z" };
+  ASSERT_EQ(expected.size(), ret.dir.m.size());
+
+  // the delimiter is searched for after the prefix
+  list("", "dir2/", 100, &ret);
+  ASSERT_EQ(1u, ret.dir.m.size());
+  ASSERT_EQ("dir2/sub/", ret.dir.m.begin()->first);
+  list("", "dir1/", 100, &ret);
+  ASSERT_EQ(50u, ret.dir.m.size());
+}
+
+TEST_F(cls_rgw, reshard_log)
+{
+  string bucket_oid = "bucket_reshard_log";
+
+  ObjectWriteOperation op;
+  cls_rgw_bucket_init_index(op);
+  ASSERT_EQ(0, ioctx.operate(bucket_oid, &op));
+
+  auto write = [&](const string& name) {
+    cls_rgw_obj_key obj(name);
+    string tag = "tag";
+    string loc = "loc";
+    index_prepare(ioctx, bucket_oid, CLS_RGW_OP_ADD, tag, obj, loc);
+
+    rgw_bucket_dir_entry_meta meta;
+    meta.category = RGWObjCategory::None;
+    meta.size = 1;
+    index_complete(ioctx, bucket_oid, CLS_RGW_OP_ADD, tag, 1, obj, meta);
+  };
+  auto set_status = [&](cls_rgw_reshard_status status) {
+    cls_rgw_bucket_instance_entry entry;
+    entry.set_status("new_instance", 7, status);
+    ASSERT_EQ(0, cls_rgw_set_bucket_resharding(ioctx, bucket_oid, entry));
+  };
+
+  // nothing is logged unless an online reshard is in progress
+  write("before");
+  map<string, uint64_t> records;
+  bool truncated;
+  ASSERT_EQ(0, cls_rgw_reshard_log_list(ioctx, bucket_oid, "", 100,
+                                        &records, &truncated));
+  ASSERT_TRUE(records.empty());
+
+  // writes aren't blocked while logging
+  set_status(CLS_RGW_RESHARD_IN_LOGRECORD);
+  for (int i = 0; i < 5; i++) {
+    write(str_int("obj", i));
+  }
+  write("obj-0");
+
+  ASSERT_EQ(0, cls_rgw_reshard_log_list(ioctx, bucket_oid, "", 3,
+                                        &records, &truncated));
+  ASSERT_EQ(3u, records.size());
+  ASSERT_TRUE(truncated);
+  ASSERT_EQ("obj-0", records.begin()->first);
+  ASSERT_EQ(2u, records.begin()->second);
+  ASSERT_EQ(0, cls_rgw_reshard_log_list(ioctx, bucket_oid,
+                                        records.rbegin()->first, 100,
+                                        &records, &truncated));
+  ASSERT_EQ(2u, records.size());
+  ASSERT_FALSE(truncated);
+  ASSERT_EQ("obj-4", records.rbegin()->first);
+  ASSERT_EQ(1u, records.rbegin()->second);
+
+  // the log doesn't show up in bucket listings
+  map<int, string> oids = { {0, bucket_oid} };
+  map<int, rgw_cls_list_ret> results;
+  cls_rgw_obj_key start_key("", "");
+  ASSERT_EQ(0, CLSRGWIssueBucketList(ioctx, start_key, "", "", 100, false,
+                                     oids, results, 1)());
+  ASSERT_EQ(6u, results[0].dir.m.size());
+
+  // blocking writes keeps the log; finishing the reshard drops it
+  set_status(CLS_RGW_RESHARD_IN_PROGRESS);
+  ASSERT_EQ(0, cls_rgw_reshard_log_list(ioctx, bucket_oid, "", 100,
+                                        &records, &truncated));
+  ASSERT_EQ(5u, records.size());
+
+  set_status(CLS_RGW_RESHARD_NOT_RESHARDING);
+  ASSERT_EQ(0, cls_rgw_reshard_log_list(ioctx, bucket_oid, "", 100,
+                                        &records, &truncated));
+  ASSERT_TRUE(records.empty());
+}
+
+TEST_F(cls_rgw, reshard_log_trim)
+{
+  string bucket_oid = "bucket_reshard_log_trim";
+
+  ObjectWriteOperation op;
+  cls_rgw_bucket_init_index(op);
+  ASSERT_EQ(0, ioctx.operate(bucket_oid, &op));
+
+  auto write = [&](const string& name) {
+    cls_rgw_obj_key obj(name);
+    string tag = "tag";
+    string loc = "loc";
+    index_prepare(ioctx, bucket_oid, CLS_RGW_OP_ADD, tag, obj, loc);
+
+    rgw_bucket_dir_entry_meta meta;
+    meta.category = RGWObjCategory::None;
+    meta.size = 1;
+    index_complete(ioctx, bucket_oid, CLS_RGW_OP_ADD, tag, 1, obj, meta);
+  };
+  auto trim = [&](const map<string, uint64_t>& records) {
+    ObjectWriteOperation op;
+    cls_rgw_reshard_log_trim(op, records);
+    ASSERT_EQ(0, ioctx.operate(bucket_oid, &op));
+  };
+
+  cls_rgw_bucket_instance_entry entry;
+  entry.set_status("new_instance", 7, CLS_RGW_RESHARD_IN_LOGRECORD);
+  ASSERT_EQ(0, cls_rgw_set_bucket_resharding(ioctx, bucket_oid, entry));
+
+  write("a");
+  write("b");
+  write("c");
+
+  // a catch-up pass lists the log, copies the objects, and meanwhile
+  // "b" is written again
+  map<string, uint64_t> records;
+  bool truncated;
+  ASSERT_EQ(0, cls_rgw_reshard_log_list(ioctx, bucket_oid, "", 100,
+                                        &records, &truncated));
+  ASSERT_EQ(3u, records.size());
+  write("b");
+  write("d");
+
+  // the copied records go, but the write to "b" that raced with the
+  // copy stays for the next pass, as does the new one
+  trim(records);
+  ASSERT_EQ(0, cls_rgw_reshard_log_list(ioctx, bucket_oid, "", 100,
+                                        &records, &truncated));
+  ASSERT_EQ(2u, records.size());
+  ASSERT_EQ(1u, records.count("b"));
+  ASSERT_EQ(1u, records.count("d"));
+
+  // trimming what is already gone is harmless
+  map<string, uint64_t> gone = { {"a", 1} };
+  trim(gone);
+
+  trim(records);
+  ASSERT_EQ(0, cls_rgw_reshard_log_list(ioctx, bucket_oid, "", 100,
+                                        &records, &truncated));
+  ASSERT_TRUE(records.empty());
+
+  // an object written after its record was trimmed is logged again
+  write("a");
+  ASSERT_EQ(0, cls_rgw_reshard_log_list(ioctx, bucket_oid, "", 100,
+                                        &records, &truncated));
+  ASSERT_EQ(1u, records.size());
+  ASSERT_EQ(1u, records["a"]);
+}
+
 TEST_F(cls_rgw, bi_list)
 {
   string bucket_oid = str_int("bucket", 5);
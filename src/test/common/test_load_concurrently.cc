@@ -0,0 +1,123 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "common/load_concurrently.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <numeric>
+#include <set>
+#include <gtest/gtest.h>
+
+using namespace std::chrono_literals;
+
+static std::vector<int> make_items(int n)
+{
+  std::vector<int> items(n);
+  std::iota(items.begin(), items.end(), 0);
+  return items;
+}
+
+TEST(LoadConcurrently, Serial)
+{
+  const auto items = make_items(10);
+  const auto caller = std::this_thread::get_id();
+  std::vector<std::string> calls;
+  for (uint64_t threads : {0, 1}) {
+    calls.clear();
+    ceph::load_concurrently("test_load", items, threads,
+      [&] (int i) {
+	ASSERT_EQ(caller, std::this_thread::get_id());
+	calls.push_back("load" + std::to_string(i));
+      },
+      [&] (int i) {
+	calls.push_back("loaded" + std::to_string(i));
+      });
+    // each item is handed over before the next one is loaded
+    ASSERT_EQ(20u, calls.size());
+    for (int i = 0; i < 10; i++) {
+      ASSERT_EQ("load" + std::to_string(i), calls[2 * i]);
+      ASSERT_EQ("loaded" + std::to_string(i), calls[2 * i + 1]);
+    }
+  }
+}
+
+TEST(LoadConcurrently, Concurrent)
+{
+  const auto items = make_items(100);
+  const auto caller = std::this_thread::get_id();
+  std::mutex lock;
+  std::condition_variable cond;
+  int in_flight = 0;
+  int max_in_flight = 0;
+  std::set<std::thread::id> loaders;
+  std::vector<std::atomic<int>> loads(items.size());
+  std::multiset<int> loaded;
+
+  ceph::load_concurrently("test_load", items, 4,
+    [&] (int i) {
+      ASSERT_NE(caller, std::this_thread::get_id());
+      ++loads[i];
+      std::unique_lock l(lock);
+      loaders.insert(std::this_thread::get_id());
+      max_in_flight = std::max(max_in_flight, ++in_flight);
+      // hold the first loads until all four threads are busy
+      cond.notify_all();
+      cond.wait_for(l, 10s, [&] { return max_in_flight == 4; });
+      --in_flight;
+    },
+    [&] (int i) {
+      ASSERT_EQ(caller, std::this_thread::get_id());
+      // only items whose load completed are handed over
+      ASSERT_EQ(1, loads[i].load());
+      loaded.insert(i);
+    });
+
+  ASSERT_EQ(4, max_in_flight);
+  ASSERT_EQ(4u, loaders.size());
+  ASSERT_EQ(0, in_flight);
+  // every item was loaded and handed over exactly once
+  for (auto& n : loads) {
+    ASSERT_EQ(1, n.load());
+  }
+  ASSERT_EQ(std::multiset<int>(items.begin(), items.end()), loaded);
+}
+
+TEST(LoadConcurrently, OutOfOrder)
+{
+  const auto items = make_items(2);
+  std::atomic<bool> second_loaded = { false };
+  std::vector<int> order;
+
+  // the first load waits until the second item has been handed over
+  ceph::load_concurrently("test_load", items, 2,
+    [&] (int i) {
+      while (i == 0 && !second_loaded) {
+	std::this_thread::sleep_for(1ms);
+      }
+    },
+    [&] (int i) {
+      order.push_back(i);
+      if (i == 1) {
+	second_loaded = true;
+      }
+    });
+  ASSERT_EQ((std::vector<int>{1, 0}), order);
+}
+
+TEST(LoadConcurrently, MoreThreadsThanItems)
+{
+  const auto items = make_items(3);
+  std::atomic<int> loads = { 0 };
+  int loaded = 0;
+  ceph::load_concurrently("test_load", items, 16,
+    [&] (int) { ++loads; },
+    [&] (int) { ++loaded; });
+  ASSERT_EQ(3, loads.load());
+  ASSERT_EQ(3, loaded);
+
+  ceph::load_concurrently("test_load", std::vector<int>{}, 16,
+    [&] (int) { ++loads; },
+    [&] (int) { ++loaded; });
+  ASSERT_EQ(3, loaded);
+}
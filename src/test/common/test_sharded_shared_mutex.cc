@@ -0,0 +1,99 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <atomic>
+#include <future>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+#include "common/sharded_shared_mutex.h"
+#include "common/shunique_lock.h"
+
+#include "gtest/gtest.h"
+
+using sharded_mutex = ceph::sharded_shared_mutex<4>;
+
+template<typename Func>
+static auto in_thread(Func&& f) {
+  return std::async(std::launch::async, std::forward<Func>(f)).get();
+}
+
+TEST(ShardedSharedMutex, ReadersShare) {
+  sharded_mutex sm;
+  // more threads than shards, so some readers share a shard; every
+  // reader must be able to hold the lock at the same time
+  constexpr int num_readers = 10;
+  std::atomic<int> holding = { 0 };
+  std::vector<std::thread> threads;
+  for (int i = 0; i < num_readers; ++i) {
+    threads.emplace_back([&] {
+      std::shared_lock l(sm);
+      ++holding;
+      while (holding < num_readers) {
+	std::this_thread::yield();
+      }
+      EXPECT_FALSE(sm.try_lock());
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  ASSERT_EQ(num_readers, holding);
+  ASSERT_TRUE(sm.try_lock());
+  sm.unlock();
+}
+
+TEST(ShardedSharedMutex, WriterExcludesEveryShard) {
+  sharded_mutex sm;
+  std::unique_lock l(sm);
+  for (int i = 0; i < 8; ++i) {
+    ASSERT_FALSE(in_thread([&] { return sm.try_lock_shared(); }));
+  }
+  ASSERT_FALSE(in_thread([&] { return sm.try_lock(); }));
+  l.unlock();
+  ASSERT_TRUE(in_thread([&] {
+    bool r = sm.try_lock_shared();
+    if (r)
+      sm.unlock_shared();
+    return r;
+  }));
+}
+
+TEST(ShardedSharedMutex, FailedTryLockReleasesShards) {
+  sharded_mutex sm;
+  std::promise<void> locked, release;
+  std::thread reader([&] {
+    std::shared_lock l(sm);
+    locked.set_value();
+    release.get_future().wait();
+  });
+  locked.get_future().wait();
+  ASSERT_FALSE(sm.try_lock());
+  // any shards taken by the failed try_lock must have been dropped
+  for (int i = 0; i < 8; ++i) {
+    ASSERT_TRUE(in_thread([&] {
+      bool r = sm.try_lock_shared();
+      if (r)
+	sm.unlock_shared();
+      return r;
+    }));
+  }
+  release.set_value();
+  reader.join();
+  ASSERT_TRUE(sm.try_lock());
+  sm.unlock();
+}
+
+TEST(ShardedSharedMutex, Shunique) {
+  sharded_mutex sm;
+  ceph::shunique_lock<sharded_mutex> sul(sm, ceph::acquire_shared);
+  ASSERT_TRUE(sul.owns_lock_shared());
+  ASSERT_FALSE(in_thread([&] { return sm.try_lock(); }));
+  sul.unlock();
+  sul.lock();
+  ASSERT_TRUE(sul.owns_lock());
+  ASSERT_FALSE(in_thread([&] { return sm.try_lock_shared(); }));
+  sul.unlock();
+}
@@ -17,6 +17,7 @@
 #include "crush/CrushWrapper.h"
 #include "osd/osd_types.h"
 
+#include <random>
 #include <set>
 
 std::unique_ptr<CrushWrapper> build_indep_map(CephContext *cct, int num_rack,
@@ -637,3 +638,76 @@ TEST(CRUSH, straw2_reweight) {
     cout << "     vs " << estddev << std::endl;
   }
 }
+
+TEST(CRUSH, do_rule_batch) {
+  // a straw2 bucket larger than the hash batch, with a few
+  // zero-weight items, must map exactly like do_rule() does.
+  const int n = 150;
+  std::unique_ptr<CrushWrapper> c(new CrushWrapper);
+  const int ROOT_TYPE = 1;
+  c->set_type_name(ROOT_TYPE, "root");
+  const int OSD_TYPE = 0;
+  c->set_type_name(OSD_TYPE, "osd");
+
+  int items[n];
+  int weights[n];
+  for (int i = 0; i < n; ++i) {
+    items[i] = i;
+    weights[i] = (i % 7 == 3) ? 0 : 0x10000 * (1 + i % 5);
+  }
+  c->set_max_devices(n);
+
+  int root;
+  crush_bucket *b = crush_make_bucket(c->get_crush_map(),
+				      CRUSH_BUCKET_STRAW2, CRUSH_HASH_RJENKINS1,
+				      ROOT_TYPE, n, items, weights);
+  EXPECT_EQ(0, crush_add_bucket(c->get_crush_map(), 0, b, &root));
+  EXPECT_EQ(0, c->set_item_name(root, "root"));
+  int rule = c->add_simple_rule("rule", "root", "osd", "",
+				"firstn", pg_pool_t::TYPE_REPLICATED);
+  EXPECT_EQ(0, rule);
+  c->finalize();
+
+  vector<unsigned> reweight(n, 0x10000);
+  reweight[5] = 0;
+  reweight[17] = 0x8000;
+
+  vector<int> xs;
+  for (int x = 0; x < 10000; ++x) {
+    xs.push_back(x * 7919);
+  }
+  vector<vector<int>> outs;
+  c->do_rule_batch(rule, xs, &outs, 3, reweight, 0);
+  ASSERT_EQ(xs.size(), outs.size());
+  for (unsigned i = 0; i < xs.size(); ++i) {
+    vector<int> out;
+    c->do_rule(rule, xs[i], out, 3, reweight, 0);
+    ASSERT_EQ(out, outs[i]);
+  }
+}
+
+TEST(CRUSH, hash32_3_batch) {
+  // the SIMD lanes and the scalar tail must agree with crush_hash32_3()
+  // for any length, for negative (bucket) ids, and for an unaligned b.
+  std::mt19937 rng(1234);
+  std::uniform_int_distribution<__u32> any;
+  std::uniform_int_distribution<__s32> id(-1000, 1000);
+  const unsigned max_n = 131;
+  __s32 b[max_n + 1];
+  __u32 out[max_n];
+  for (unsigned n : {0u, 1u, 3u, 4u, 5u, 7u, 8u, 9u, 12u, 15u, 16u, 17u,
+		     31u, 63u, 64u, 65u, 100u, 131u}) {
+    for (unsigned offset : {0u, 1u}) {
+      for (int round = 0; round < 20; ++round) {
+	__u32 a = any(rng), c = any(rng);
+	for (unsigned i = 0; i < n + offset; ++i)
+	  b[i] = round % 2 ? id(rng) : (__s32)any(rng);
+	crush_hash32_3_batch(CRUSH_HASH_RJENKINS1, a, b + offset, c, out, n);
+	for (unsigned i = 0; i < n; ++i) {
+	  ASSERT_EQ(crush_hash32_3(CRUSH_HASH_RJENKINS1, a, b[offset + i], c),
+		    out[i]) << "n " << n << " i " << i;
+	}
+      }
+    }
+  }
+}
@@ -366,6 +366,98 @@ TEST_F(IsaErasureCodeTest, encode)
   }
 }
 
+TEST_F(IsaErasureCodeTest, encode_decode_stripes)
+{
+  ErasureCodeIsaDefault Isa(tcache);
+  ErasureCodeProfile profile;
+  profile["k"] = "2";
+  profile["m"] = "2";
+  Isa.init(profile, &cerr);
+
+  unsigned stripe_width = Isa.get_alignment() * 2;
+  unsigned chunk_size = Isa.get_chunk_size(stripe_width);
+  ASSERT_EQ(stripe_width, 2 * chunk_size);
+  const unsigned stripes = 5;
+  bufferlist in;
+  for (unsigned i = 0; i < stripe_width * stripes; i++)
+    in.append((char)(i * 7 + i / 13));
+  set<int> want_to_encode = { 0, 1, 2, 3 };
+
+  // all the stripes at once must match encoding them one by one
+  map<int,bufferlist> batched;
+  EXPECT_EQ(0, Isa.encode_stripes(want_to_encode, in, chunk_size, &batched));
+  map<int,bufferlist> expected;
+  for (unsigned s = 0; s < stripes; s++) {
+    bufferlist stripe;
+    stripe.substr_of(in, s * stripe_width, stripe_width);
+    map<int,bufferlist> encoded;
+    EXPECT_EQ(0, Isa.encode(want_to_encode, stripe, &encoded));
+    for (auto& i : encoded)
+      expected[i.first].claim_append(i.second);
+  }
+  EXPECT_EQ(4u, batched.size());
+  for (int i = 0; i < 4; i++) {
+    EXPECT_EQ(chunk_size * stripes, batched[i].length());
+    EXPECT_TRUE(batched[i].contents_equal(expected[i]));
+  }
+
+  // recover a data and a coding chunk of every stripe
+  map<int,bufferlist> degraded = batched;
+  degraded.erase(1);
+  degraded.erase(3);
+  map<int,bufferlist> decoded;
+  EXPECT_EQ(0, Isa.decode_stripes(set<int>{ 1, 3 }, degraded, chunk_size,
+				  &decoded));
+  EXPECT_TRUE(decoded[1].contents_equal(batched[1]));
+  EXPECT_TRUE(decoded[3].contents_equal(batched[3]));
+}
+
+TEST_F(IsaErasureCodeTest, apply_delta)
+{
+  for (unsigned m = 1; m <= 2; m++) {
+    ErasureCodeIsaDefault Isa(tcache);
+    ErasureCodeProfile profile;
+    profile["k"] = "3";
+    profile["m"] = stringify(m);
+    Isa.init(profile, &cerr);
+    EXPECT_TRUE(Isa.get_supported_optimizations() &
+		ErasureCodeInterface::FLAG_EC_PLUGIN_PARITY_DELTA_OPTIMIZATION);
+
+    unsigned chunk_size = Isa.get_chunk_size(Isa.get_alignment() * 3);
+    unsigned stripe_width = 3 * chunk_size;
+    const unsigned stripes = 4;
+    bufferlist in;
+    for (unsigned i = 0; i < stripe_width * stripes; i++)
+      in.append((char)(i * 7 + i / 13));
+    // overwrite parts of the first and last data chunks of every stripe
+    bufferlist out;
+    out.append(in.c_str(), in.length());
+    for (unsigned s = 0; s < stripes; s++) {
+      for (unsigned i = 1; i < chunk_size / 2; i++) {
+	out.c_str()[s * stripe_width + i] ^= (char)(i + s + 1);
+	out.c_str()[s * stripe_width + 2 * chunk_size + i] ^= (char)(i * 3);
+      }
+    }
+    set<int> want_to_encode;
+    for (unsigned i = 0; i < 3 + m; i++)
+      want_to_encode.insert(i);
+    map<int,bufferlist> before, after;
+    EXPECT_EQ(0, Isa.encode_stripes(want_to_encode, in, chunk_size, &before));
+    EXPECT_EQ(0, Isa.encode_stripes(want_to_encode, out, chunk_size, &after));
+
+    // the old parity plus the deltas of the changed chunks is the new parity
+    map<int,bufferlist> deltas;
+    Isa.encode_delta(before[0], after[0], &deltas[0]);
+    Isa.encode_delta(before[2], after[2], &deltas[2]);
+    map<int,bufferlist> parity;
+    for (unsigned i = 3; i < 3 + m; i++)
+      parity[i].append(before[i].c_str(), before[i].length());
+    EXPECT_EQ(0, Isa.apply_delta(deltas, &parity));
+    for (unsigned i = 3; i < 3 + m; i++)
+      EXPECT_TRUE(parity[i].contents_equal(after[i]));
+  }
+}
+
 TEST_F(IsaErasureCodeTest, sanity_check_k)
 {
   ErasureCodeIsaDefault Isa(tcache);
@@ -129,6 +129,107 @@ TYPED_TEST(ErasureCodeTest, encode_decode)
   }
 }
 
+TYPED_TEST(ErasureCodeTest, encode_decode_stripes)
+{
+  TypeParam jerasure;
+  ErasureCodeProfile profile;
+  profile["k"] = "2";
+  profile["m"] = "2";
+  profile["packetsize"] = "8";
+  jerasure.init(profile, &cerr);
+
+  unsigned stripe_width = jerasure.get_alignment() * 2;
+  unsigned chunk_size = jerasure.get_chunk_size(stripe_width);
+  ASSERT_EQ(stripe_width, 2 * chunk_size);
+  const unsigned stripes = 5;
+  bufferlist in;
+  for (unsigned i = 0; i < stripe_width * stripes; i++)
+    in.append((char)(i * 7 + i / 13));
+  set<int> want_to_encode = { 0, 1, 2, 3 };
+
+  // all the stripes at once must match encoding them one by one
+  map<int,bufferlist> batched;
+  EXPECT_EQ(0, jerasure.encode_stripes(want_to_encode, in, chunk_size,
+				       &batched));
+  map<int,bufferlist> expected;
+  for (unsigned s = 0; s < stripes; s++) {
+    bufferlist stripe;
+    stripe.substr_of(in, s * stripe_width, stripe_width);
+    map<int,bufferlist> encoded;
+    EXPECT_EQ(0, jerasure.encode(want_to_encode, stripe, &encoded));
+    for (auto& i : encoded)
+      expected[i.first].claim_append(i.second);
+  }
+  EXPECT_EQ(4u, batched.size());
+  for (int i = 0; i < 4; i++) {
+    EXPECT_EQ(chunk_size * stripes, batched[i].length());
+    EXPECT_TRUE(batched[i].contents_equal(expected[i]));
+  }
+
+  // recover a data and a coding chunk of every stripe
+  map<int,bufferlist> degraded = batched;
+  degraded.erase(0);
+  degraded.erase(2);
+  map<int,bufferlist> decoded;
+  EXPECT_EQ(0, jerasure.decode_stripes(set<int>{ 0, 2 }, degraded,
+				       chunk_size, &decoded));
+  EXPECT_TRUE(decoded[0].contents_equal(batched[0]));
+  EXPECT_TRUE(decoded[2].contents_equal(batched[2]));
+}
+
+TYPED_TEST(ErasureCodeTest, apply_delta)
+{
+  TypeParam jerasure;
+  ErasureCodeProfile profile;
+  profile["k"] = "3";
+  profile["m"] = "2";
+  profile["packetsize"] = "8";
+  jerasure.init(profile, &cerr);
+
+  if (!(jerasure.get_supported_optimizations() &
+	ErasureCodeInterface::FLAG_EC_PLUGIN_PARITY_DELTA_OPTIMIZATION)) {
+    // only the Reed-Solomon techniques update the parity in place
+    map<int,bufferlist> deltas, parity;
+    EXPECT_EQ(-EOPNOTSUPP, jerasure.apply_delta(deltas, &parity));
+    return;
+  }
+
+  unsigned chunk_size = jerasure.get_chunk_size(jerasure.get_alignment());
+  unsigned stripe_width = 3 * chunk_size;
+  const unsigned stripes = 4;
+  bufferlist in;
+  for (unsigned i = 0; i < stripe_width * stripes; i++)
+    in.append((char)(i * 7 + i / 13));
+  // overwrite part of the second data chunk of every stripe
+  bufferlist out;
+  out.append(in.c_str(), in.length());
+  for (unsigned s = 0; s < stripes; s++)
+    for (unsigned i = 3; i < chunk_size - 5; i++)
+      out.c_str()[s * stripe_width + chunk_size + i] ^= (char)(i + s + 1);
+  set<int> want_to_encode = { 0, 1, 2, 3, 4 };
+  map<int,bufferlist> before, after;
+  EXPECT_EQ(0, jerasure.encode_stripes(want_to_encode, in, chunk_size,
+				       &before));
+  EXPECT_EQ(0, jerasure.encode_stripes(want_to_encode, out, chunk_size,
+				       &after));
+  EXPECT_TRUE(before[0].contents_equal(after[0]));
+  EXPECT_TRUE(before[2].contents_equal(after[2]));
+
+  // the old parity plus the delta of the changed chunk is the new parity
+  map<int,bufferlist> deltas;
+  jerasure.encode_delta(before[1], after[1], &deltas[1]);
+  map<int,bufferlist> parity;
+  parity[3].append(before[3].c_str(), before[3].length());
+  parity[4].append(before[4].c_str(), before[4].length());
+  EXPECT_EQ(0, jerasure.apply_delta(deltas, &parity));
+  EXPECT_TRUE(parity[3].contents_equal(after[3]));
+  EXPECT_TRUE(parity[4].contents_equal(after[4]));
+
+  // every coding chunk must be given
+  parity.erase(4);
+  EXPECT_EQ(-EINVAL, jerasure.apply_delta(deltas, &parity));
+}
+
 TYPED_TEST(ErasureCodeTest, minimum_to_decode)
 {
   TypeParam jerasure;
@@ -47,6 +47,11 @@ int ErasureCodeBench::setup(int argc, char** argv) {
      "size of the buffer to be encoded")
     ("iterations,i", po::value<int>()->default_value(1),
      "number of encode/decode runs")
+    ("stripe-width,S", po::value<int>()->default_value(0),
+     "encode/decode the buffer as consecutive stripes of this width, "
+     "the way the OSD does (0 to handle it as a single object)")
+    ("batch,b", "with --stripe-width, process all the stripes with a single "
+     "encode_stripes/decode_stripes call instead of one call per stripe")
     ("plugin,p", po::value<string>()->default_value("jerasure"),
      "erasure code plugin name")
     ("workload,w", po::value<string>()->default_value("encode"),
@@ -110,6 +115,8 @@ int ErasureCodeBench::setup(int argc, char** argv) {
   }
 
   in_size = vm["size"].as<int>();
+  stripe_width = vm["stripe-width"].as<int>();
+  batch = vm.count("batch") > 0;
   max_iterations = vm["iterations"].as<int>();
   plugin = vm["plugin"].as<string>();
   workload = vm["workload"].as<string>();
@@ -167,8 +174,10 @@ int ErasureCodeBench::encode()
   }
 
   bufferlist in;
-  in.append(string(in_size, 'X'));
-  in.rebuild_aligned(ErasureCode::SIMD_ALIGN);
+  unsigned chunk_size = 0;
+  code = prepare_stripes(erasure_code, &in, &chunk_size);
+  if (code)
+    return code;
   set<int> want_to_encode;
   for (int i = 0; i < k + m; i++) {
     want_to_encode.insert(i);
@@ -176,12 +185,83 @@ int ErasureCodeBench::encode()
   utime_t begin_time = ceph_clock_now();
   for (int i = 0; i < max_iterations; i++) {
     map<int,bufferlist> encoded;
-    code = erasure_code->encode(want_to_encode, in, &encoded);
+    if (stripe_width > 0)
+      code = encode_stripes(erasure_code, want_to_encode, in, chunk_size,
+			    &encoded);
+    else
+      code = erasure_code->encode(want_to_encode, in, &encoded);
     if (code)
       return code;
   }
   utime_t end_time = ceph_clock_now();
-  cout << (end_time - begin_time) << "\t" << (max_iterations * (in_size / 1024)) << endl;
+  cout << (end_time - begin_time) << "\t" << (max_iterations * (in.length() / 1024)) << endl;
+  return 0;
+}
+
+int ErasureCodeBench::prepare_stripes(ErasureCodeInterfaceRef erasure_code,
+				      bufferlist *in,
+				      unsigned *chunk_size)
+{
+  int size = in_size;
+  if (stripe_width > 0) {
+    *chunk_size = erasure_code->get_chunk_size(stripe_width);
+    int width = k * *chunk_size;
+    size -= size % width;
+    if (size == 0) {
+      cerr << "size " << in_size << " is smaller than the stripe width "
+	   << width << endl;
+      return -EINVAL;
+    }
+  }
+  in->append(string(size, 'X'));
+  in->rebuild_aligned(ErasureCode::SIMD_ALIGN);
+  return 0;
+}
+
+int ErasureCodeBench::encode_stripes(ErasureCodeInterfaceRef erasure_code,
+				     const set<int> &want_to_encode,
+				     const bufferlist &in,
+				     unsigned chunk_size,
+				     map<int,bufferlist> *encoded)
+{
+  if (batch)
+    return erasure_code->encode_stripes(want_to_encode, in, chunk_size,
+					encoded);
+  unsigned width = k * chunk_size;
+  for (unsigned off = 0; off < in.length(); off += width) {
+    bufferlist stripe;
+    stripe.substr_of(in, off, width);
+    map<int,bufferlist> chunks;
+    int code = erasure_code->encode(want_to_encode, stripe, &chunks);
+    if (code)
+      return code;
+    for (auto& i : chunks)
+      (*encoded)[i.first].claim_append(i.second);
+  }
+  return 0;
+}
+
+int ErasureCodeBench::decode_stripes(ErasureCodeInterfaceRef erasure_code,
+				     const set<int> &want_to_read,
+				     const map<int,bufferlist> &chunks,
+				     unsigned chunk_size,
+				     map<int,bufferlist> *decoded)
+{
+  if (batch)
+    return erasure_code->decode_stripes(want_to_read, chunks, chunk_size,
+					decoded);
+  unsigned length = chunks.begin()->second.length();
+  for (unsigned off = 0; off < length; off += chunk_size) {
+    map<int,bufferlist> stripe;
+    for (auto& i : chunks)
+      stripe[i.first].substr_of(i.second, off, chunk_size);
+    map<int,bufferlist> out;
+    int code = erasure_code->decode(want_to_read, stripe, &out, chunk_size);
+    if (code)
+      return code;
+    for (auto i : want_to_read)
+      (*decoded)[i].claim_append(out[i]);
+  }
   return 0;
 }
 
@@ -262,8 +342,10 @@ int ErasureCodeBench::decode()
   }
 
   bufferlist in;
-  in.append(string(in_size, 'X'));
-  in.rebuild_aligned(ErasureCode::SIMD_ALIGN);
+  unsigned chunk_size = 0;
+  code = prepare_stripes(erasure_code, &in, &chunk_size);
+  if (code)
+    return code;
 
   set<int> want_to_encode;
   for (int i = 0; i < k + m; i++) {
@@ -271,7 +353,11 @@ int ErasureCodeBench::decode()
   }
 
   map<int,bufferlist> encoded;
-  code = erasure_code->encode(want_to_encode, in, &encoded);
+  if (stripe_width > 0)
+    code = encode_stripes(erasure_code, want_to_encode, in, chunk_size,
+			  &encoded);
+  else
+    code = erasure_code->encode(want_to_encode, in, &encoded);
   if (code)
     return code;
 
@@ -288,12 +374,21 @@ int ErasureCodeBench::decode()
   utime_t begin_time = ceph_clock_now();
   for (int i = 0; i < max_iterations; i++) {
     if (exhaustive_erasures) {
+      if (stripe_width > 0) {
+	cerr << "--erasures-generation exhaustive does not support --stripe-width"
+	     << endl;
+	return -EINVAL;
+      }
       code = decode_erasures(encoded, encoded, 0, erasures, erasure_code);
       if (code)
 	return code;
     } else if (erased.size() > 0) {
       map<int,bufferlist> decoded;
-      code = erasure_code->decode(want_to_read, encoded, &decoded, 0);
+      if (stripe_width > 0)
+	code = decode_stripes(erasure_code, want_to_read, encoded, chunk_size,
+			      &decoded);
+      else
+	code = erasure_code->decode(want_to_read, encoded, &decoded, 0);
       if (code)
 	return code;
     } else {
@@ -306,13 +401,17 @@ int ErasureCodeBench::decode()
 	chunks.erase(erasure);
       }
       map<int,bufferlist> decoded;
-      code = erasure_code->decode(want_to_read, chunks, &decoded, 0);
+      if (stripe_width > 0)
+	code = decode_stripes(erasure_code, want_to_read, chunks, chunk_size,
+			      &decoded);
+      else
+	code = erasure_code->decode(want_to_read, chunks, &decoded, 0);
       if (code)
 	return code;
     }
   }
   utime_t end_time = ceph_clock_now();
-  cout << (end_time - begin_time) << "\t" << (max_iterations * (in_size / 1024)) << endl;
+  cout << (end_time - begin_time) << "\t" << (max_iterations * (in.length() / 1024)) << endl;
   return 0;
 }
 
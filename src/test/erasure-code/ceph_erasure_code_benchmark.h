@@ -24,6 +24,8 @@ using namespace std;
 
 class ErasureCodeBench {
   int in_size;
+  int stripe_width;
+  bool batch;
   int max_iterations;
   int erasures;
   int k;
@@ -47,6 +49,19 @@ public:
 		      unsigned i,
 		      unsigned want_erasures,
 		      ErasureCodeInterfaceRef erasure_code);
+  int prepare_stripes(ErasureCodeInterfaceRef erasure_code,
+		      bufferlist *in,
+		      unsigned *chunk_size);
+  int encode_stripes(ErasureCodeInterfaceRef erasure_code,
+		     const set<int> &want_to_encode,
+		     const bufferlist &in,
+		     unsigned chunk_size,
+		     map<int,bufferlist> *encoded);
+  int decode_stripes(ErasureCodeInterfaceRef erasure_code,
+		     const set<int> &want_to_read,
+		     const map<int,bufferlist> &chunks,
+		     unsigned chunk_size,
+		     map<int,bufferlist> *decoded);
   int decode();
   int encode();
 };
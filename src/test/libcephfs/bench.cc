@@ -0,0 +1,213 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+/*
+ * Multithreaded libcephfs benchmark: many threads sharing a single mount,
+ * the way NFS and SMB gateways use libcephfs.
+ */
+
+#include "include/cephfs/libcephfs.h"
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+static void usage()
+{
+  std::cout << "usage: ceph_libcephfs_bench [flags]\n"
+      "	 --threads\n"
+      "	       number of threads sharing the mount (default 8)\n"
+      "	 --ops\n"
+      "	       number of operations per thread (default 10000)\n"
+      "	 --workload stat|write|read|mixed\n"
+      "	       operations to run (default mixed); stat looks files up and\n"
+      "	       gets their attributes through the ll_ interface, as NFS\n"
+      "	       gateways do, so that it mostly hits the client's cache\n"
+      "	 --block-size\n"
+      "	       bytes per read or write (default 4096)\n"
+      "	 --files\n"
+      "	       files per thread, cycled through (default 16)\n"
+      "	 --dir\n"
+      "	       directory to run in (default /libcephfs_bench)\n"
+      << std::endl;
+}
+
+struct Config {
+  int threads = 8;
+  int ops = 10000;
+  std::string workload = "mixed";
+  size_t block_size = 4096;
+  int files = 16;
+  std::string dir = "/libcephfs_bench";
+};
+
+static int run_thread(struct ceph_mount_info *cmount, const Config &cfg,
+                      int id, std::atomic<uint64_t> *ops)
+{
+  std::vector<int> fds;
+  std::vector<std::string> names;
+  std::vector<std::string> paths;
+  for (int i = 0; i < cfg.files; i++) {
+    std::string name = "t" + std::to_string(id) + "." + std::to_string(i);
+    std::string path = cfg.dir + "/" + name;
+    int fd = ceph_open(cmount, path.c_str(), O_CREAT|O_RDWR, 0644);
+    if (fd < 0) {
+      std::cerr << "open " << path << ": " << strerror(-fd) << std::endl;
+      return fd;
+    }
+    fds.push_back(fd);
+    names.push_back(name);
+    paths.push_back(path);
+  }
+
+  bool do_stat = cfg.workload == "stat" || cfg.workload == "mixed";
+  bool do_write = cfg.workload == "write" || cfg.workload == "mixed";
+  bool do_read = cfg.workload == "read" || cfg.workload == "mixed";
+
+  UserPerm *perms = ceph_mount_perms(cmount);
+  Inode *dir = nullptr;
+  struct ceph_statx stx;
+  if (do_stat) {
+    int r = ceph_ll_walk(cmount, cfg.dir.c_str(), &dir, &stx, 0, 0, perms);
+    if (r < 0) {
+      std::cerr << "walk " << cfg.dir << ": " << strerror(-r) << std::endl;
+      return r;
+    }
+  }
+
+  std::vector<char> buf(cfg.block_size, 'a' + id % 26);
+  if (do_read) {
+    // something to read back
+    for (auto fd : fds) {
+      ceph_write(cmount, fd, buf.data(), buf.size(), 0);
+    }
+  }
+
+  int r = 0;
+  for (int n = 0; n < cfg.ops && r >= 0; n++) {
+    int i = n % cfg.files;
+    int64_t off = (n / cfg.files) % 16 * cfg.block_size;
+    if (do_stat) {
+      Inode *in;
+      r = ceph_ll_lookup(cmount, dir, names[i].c_str(), &in, &stx, 0, 0,
+                         perms);
+      if (r >= 0) {
+        r = ceph_ll_getattr(cmount, in, &stx, CEPH_STATX_BASIC_STATS, 0,
+                            perms);
+        ceph_ll_put(cmount, in);
+      }
+    }
+    if (r >= 0 && do_write) {
+      r = ceph_write(cmount, fds[i], buf.data(), buf.size(), off);
+    }
+    if (r >= 0 && do_read) {
+      r = ceph_read(cmount, fds[i], buf.data(), buf.size(),
+                    do_write ? off : 0);
+    }
+    ++(*ops);
+  }
+  if (r < 0) {
+    std::cerr << "thread " << id << ": " << strerror(-r) << std::endl;
+  }
+
+  if (dir) {
+    ceph_ll_put(cmount, dir);
+  }
+  for (size_t i = 0; i < fds.size(); i++) {
+    ceph_close(cmount, fds[i]);
+    ceph_unlink(cmount, paths[i].c_str());
+  }
+  return r < 0 ? r : 0;
+}
+
+int main(int argc, const char **argv)
+{
+  Config cfg;
+  for (int i = 1; i < argc; i++) {
+    std::string arg(argv[i]);
+    if (arg == "-h" || arg == "--help") {
+      usage();
+      return 0;
+    } else if (i + 1 >= argc) {
+      usage();
+      return 1;
+    } else if (arg == "--threads") {
+      cfg.threads = atoi(argv[++i]);
+    } else if (arg == "--ops") {
+      cfg.ops = atoi(argv[++i]);
+    } else if (arg == "--workload") {
+      cfg.workload = argv[++i];
+    } else if (arg == "--block-size") {
+      cfg.block_size = strtoull(argv[++i], nullptr, 10);
+    } else if (arg == "--files") {
+      cfg.files = atoi(argv[++i]);
+    } else if (arg == "--dir") {
+      cfg.dir = argv[++i];
+    } else {
+      usage();
+      return 1;
+    }
+  }
+  if (cfg.threads <= 0 || cfg.ops <= 0 || cfg.files <= 0 ||
+      cfg.block_size == 0 ||
+      (cfg.workload != "stat" && cfg.workload != "write" &&
+       cfg.workload != "read" && cfg.workload != "mixed")) {
+    usage();
+    return 1;
+  }
+
+  struct ceph_mount_info *cmount;
+  int r = ceph_create(&cmount, NULL);
+  if (r == 0)
+    r = ceph_conf_read_file(cmount, NULL);
+  if (r == 0)
+    r = ceph_conf_parse_env(cmount, NULL);
+  if (r == 0)
+    r = ceph_mount(cmount, "/");
+  if (r < 0) {
+    std::cerr << "failed to mount: " << strerror(-r) << std::endl;
+    return 1;
+  }
+
+  r = ceph_mkdir(cmount, cfg.dir.c_str(), 0755);
+  if (r < 0 && r != -EEXIST) {
+    std::cerr << "mkdir " << cfg.dir << ": " << strerror(-r) << std::endl;
+    ceph_shutdown(cmount);
+    return 1;
+  }
+
+  std::cout << "threads " << cfg.threads << ", ops " << cfg.ops
+            << ", workload " << cfg.workload << ", block size "
+            << cfg.block_size << std::endl;
+
+  std::atomic<uint64_t> ops = {0};
+  std::atomic<int> errors = {0};
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (int i = 0; i < cfg.threads; i++) {
+    threads.emplace_back([&, i] {
+        if (run_thread(cmount, cfg, i, &ops) < 0) {
+          ++errors;
+        }
+      });
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+  std::chrono::duration<double> elapsed =
+    std::chrono::steady_clock::now() - start;
+
+  std::cout << ops << " ops in " << elapsed.count() << " s: "
+            << ops / elapsed.count() << " ops/s" << std::endl;
+
+  ceph_rmdir(cmount, cfg.dir.c_str());
+  ceph_shutdown(cmount);
+  return errors ? 1 : 0;
+}
@@ -27,6 +27,8 @@
 #include <sys/resource.h>
 
 #include "common/Clock.h"
+#include "common/ceph_context.h"
+#include "common/perf_counters_collection.h"
 
 #ifdef __linux__
 #include <limits.h>
@@ -2273,3 +2275,209 @@ TEST(LibCephFS, SnapXattrs) {
 
   ceph_shutdown(cmount);
 }
+
+static uint64_t get_client_counter(struct ceph_mount_info *cmount,
+                                   const std::string& name)
+{
+  uint64_t val = 0;
+  CephContext *cct = ceph_get_mount_context(cmount);
+  cct->get_perfcounters_collection()->with_counters(
+    [&](const PerfCountersCollectionImpl::CounterMap& by_path) {
+      auto p = by_path.find("client." + name);
+      if (p != by_path.end())
+        val = p->second.data->u64;
+    });
+  return val;
+}
+
+TEST(LibCephFS, AsyncDirops) {
+  struct ceph_mount_info *cmount;
+  ASSERT_EQ(ceph_create(&cmount, NULL), 0);
+  ASSERT_EQ(ceph_conf_read_file(cmount, NULL), 0);
+  ASSERT_EQ(0, ceph_conf_parse_env(cmount, NULL));
+  ASSERT_EQ(ceph_conf_set(cmount, "client_async_dirops", "true"), 0);
+  ASSERT_EQ(ceph_mount(cmount, NULL), 0);
+
+  char dir[256];
+  sprintf(dir, "/test_async_dirops_%d", getpid());
+  ASSERT_EQ(ceph_mkdir(cmount, dir, 0755), 0);
+
+  // the first create is synchronous and gets us inos to use for the rest
+  const int nfiles = 64;
+  char path[512];
+  for (int i = 0; i < nfiles; i++) {
+    sprintf(path, "%s/f%d", dir, i);
+    int fd = ceph_open(cmount, path, O_CREAT|O_EXCL|O_WRONLY, 0644);
+    ASSERT_LT(0, fd);
+    ASSERT_EQ(1, ceph_write(cmount, fd, "a", 1, 0));
+    ASSERT_EQ(0, ceph_close(cmount, fd));
+  }
+
+  // once we had inos delegated, creates went without waiting for the mds
+  ASSERT_LT(0u, get_client_counter(cmount, "async_create"));
+
+  int dirfd = ceph_open(cmount, dir, O_RDONLY|O_DIRECTORY, 0);
+  ASSERT_LT(0, dirfd);
+  ASSERT_EQ(0, ceph_fsync(cmount, dirfd, 0));
+
+  for (int i = 0; i < nfiles; i++) {
+    sprintf(path, "%s/f%d", dir, i);
+    struct ceph_statx stx;
+    ASSERT_EQ(0, ceph_statx(cmount, path, &stx, CEPH_STATX_SIZE, 0));
+    ASSERT_EQ(1u, stx.stx_size);
+  }
+
+  // the name is known to be taken without asking the mds
+  sprintf(path, "%s/f0", dir);
+  ASSERT_EQ(-EEXIST, ceph_open(cmount, path, O_CREAT|O_EXCL|O_WRONLY, 0644));
+
+  for (int i = 0; i < nfiles; i++) {
+    sprintf(path, "%s/f%d", dir, i);
+    ASSERT_EQ(0, ceph_unlink(cmount, path));
+  }
+  ASSERT_LT(0u, get_client_counter(cmount, "async_unlink"));
+  ASSERT_EQ(0, ceph_fsync(cmount, dirfd, 0));
+  ASSERT_EQ(0, ceph_close(cmount, dirfd));
+
+  ASSERT_EQ(0, ceph_rmdir(cmount, dir));
+  ceph_shutdown(cmount);
+}
+
+TEST(LibCephFS, AsyncCreateFailure) {
+  struct ceph_mount_info *cmount;
+  ASSERT_EQ(ceph_create(&cmount, NULL), 0);
+  ASSERT_EQ(ceph_conf_read_file(cmount, NULL), 0);
+  ASSERT_EQ(0, ceph_conf_parse_env(cmount, NULL));
+  ASSERT_EQ(ceph_conf_set(cmount, "client_async_dirops", "true"), 0);
+  ASSERT_EQ(ceph_mount(cmount, NULL), 0);
+
+  char dir[256];
+  sprintf(dir, "/test_async_create_failure_%d", getpid());
+  ASSERT_EQ(ceph_mkdir(cmount, dir, 0755), 0);
+
+  // get some inos delegated
+  char path[512];
+  sprintf(path, "%s/sync", dir);
+  int fd = ceph_open(cmount, path, O_CREAT|O_EXCL|O_WRONLY, 0644);
+  ASSERT_LT(0, fd);
+  ASSERT_EQ(0, ceph_close(cmount, fd));
+
+  // from now on the mds refuses our async creates
+  ASSERT_EQ(0, ceph_conf_set(cmount, "client_inject_async_create_failure",
+                             "true"));
+
+  // fsync of the file waits for the create and reports its failure
+  sprintf(path, "%s/f1", dir);
+  fd = ceph_open(cmount, path, O_CREAT|O_EXCL|O_WRONLY, 0644);
+  ASSERT_LT(0, fd);
+  ASSERT_EQ(1u, get_client_counter(cmount, "async_create"));
+  ASSERT_EQ(-EINVAL, ceph_fsync(cmount, fd, 0));
+  ASSERT_EQ(0, ceph_close(cmount, fd));
+
+  // close reports it once the create has failed
+  sprintf(path, "%s/f2", dir);
+  fd = ceph_open(cmount, path, O_CREAT|O_EXCL|O_WRONLY, 0644);
+  ASSERT_LT(0, fd);
+  ASSERT_EQ(2u, get_client_counter(cmount, "async_create"));
+  int dirfd = ceph_open(cmount, dir, O_RDONLY|O_DIRECTORY, 0);
+  ASSERT_LT(0, dirfd);
+  ASSERT_EQ(0, ceph_fsync(cmount, dirfd, 0));
+  ASSERT_EQ(-EINVAL, ceph_close(cmount, fd));
+  ASSERT_EQ(0, ceph_close(cmount, dirfd));
+
+  // neither file was created
+  ASSERT_EQ(0, ceph_conf_set(cmount, "client_inject_async_create_failure",
+                             "false"));
+  struct ceph_statx stx;
+  sprintf(path, "%s/f1", dir);
+  ASSERT_EQ(-ENOENT, ceph_statx(cmount, path, &stx, 0, 0));
+  sprintf(path, "%s/f2", dir);
+  ASSERT_EQ(-ENOENT, ceph_statx(cmount, path, &stx, 0, 0));
+
+  sprintf(path, "%s/sync", dir);
+  ASSERT_EQ(0, ceph_unlink(cmount, path));
+  ASSERT_EQ(0, ceph_rmdir(cmount, dir));
+  ceph_shutdown(cmount);
+}
+
+TEST(LibCephFS, LLCachedLookup) {
+  struct ceph_mount_info *cmount1, *cmount2;
+  ASSERT_EQ(ceph_create(&cmount1, NULL), 0);
+  ASSERT_EQ(ceph_create(&cmount2, NULL), 0);
+  ASSERT_EQ(ceph_conf_read_file(cmount1, NULL), 0);
+  ASSERT_EQ(ceph_conf_read_file(cmount2, NULL), 0);
+  ASSERT_EQ(0, ceph_conf_parse_env(cmount1, NULL));
+  ASSERT_EQ(0, ceph_conf_parse_env(cmount2, NULL));
+  ASSERT_EQ(ceph_mount(cmount1, "/"), 0);
+  ASSERT_EQ(ceph_mount(cmount2, "/"), 0);
+
+  char filename[32], newname[32];
+  sprintf(filename, "llcached%x", getpid());
+  sprintf(newname, "llcached%x.new", getpid());
+
+  Inode *root1, *file1, *root2, *file2;
+  struct ceph_statx stx;
+  Fh *fh;
+  UserPerm *perms1 = ceph_mount_perms(cmount1);
+  UserPerm *perms2 = ceph_mount_perms(cmount2);
+
+  ASSERT_EQ(ceph_ll_lookup_root(cmount1, &root1), 0);
+  ASSERT_EQ(ceph_ll_create(cmount1, root1, filename, 0666, O_RDWR|O_CREAT|O_EXCL,
+			   &file1, &fh, &stx, 0, 0, perms1), 0);
+  ASSERT_EQ(ceph_ll_close(cmount1, fh), 0);
+
+  // repeated lookups and getattrs, the later ones answered from the cache
+  ASSERT_EQ(ceph_ll_lookup_root(cmount2, &root2), 0);
+  ASSERT_EQ(ceph_ll_lookup(cmount2, root2, filename, &file2, &stx,
+			   CEPH_STATX_ALL_STATS, 0, perms2), 0);
+  for (int i = 0; i < 10; ++i) {
+    Inode *again;
+    ASSERT_EQ(ceph_ll_lookup(cmount2, root2, filename, &again, &stx,
+			     CEPH_STATX_ALL_STATS, 0, perms2), 0);
+    ASSERT_EQ(again, file2);
+    ASSERT_EQ(stx.stx_mode & 07777, 0666u);
+    ASSERT_EQ(ceph_ll_put(cmount2, again), 0);
+    ASSERT_EQ(ceph_ll_getattr(cmount2, file2, &stx, CEPH_STATX_MODE, 0, perms2), 0);
+    ASSERT_EQ(stx.stx_mode & 07777, 0666u);
+  }
+
+  // a chmod by the other client is seen by the next getattr and lookup
+  stx.stx_mode = 0644;
+  ASSERT_EQ(ceph_ll_setattr(cmount1, file1, &stx, CEPH_SETATTR_MODE, perms1), 0);
+  ASSERT_EQ(ceph_ll_getattr(cmount2, file2, &stx, CEPH_STATX_MODE, 0, perms2), 0);
+  ASSERT_EQ(stx.stx_mode & 07777, 0644u);
+  Inode *again;
+  ASSERT_EQ(ceph_ll_lookup(cmount2, root2, filename, &again, &stx,
+			   CEPH_STATX_MODE, 0, perms2), 0);
+  ASSERT_EQ(stx.stx_mode & 07777, 0644u);
+  ASSERT_EQ(ceph_ll_put(cmount2, again), 0);
+
+  // and so is a rename
+  ASSERT_EQ(ceph_ll_rename(cmount1, root1, filename, root1, newname, perms1), 0);
+  ASSERT_EQ(ceph_ll_lookup(cmount2, root2, filename, &again, &stx, 0, 0, perms2),
+	    -ENOENT);
+  ASSERT_EQ(ceph_ll_lookup(cmount2, root2, newname, &again, &stx, 0, 0, perms2), 0);
+  ASSERT_EQ(again, file2);
+  ASSERT_EQ(ceph_ll_put(cmount2, again), 0);
+
+  // lookups racing with the last put of the inode
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&] {
+      for (int i = 0; i < 1000; ++i) {
+	Inode *in;
+	struct ceph_statx tstx;
+	if (ceph_ll_lookup(cmount2, root2, newname, &in, &tstx, 0, 0, perms2) == 0)
+	  ceph_ll_put(cmount2, in);
+      }
+    });
+  }
+  ceph_ll_put(cmount2, file2);
+  for (auto& t : threads)
+    t.join();
+
+  ASSERT_EQ(ceph_ll_unlink(cmount1, root1, newname, perms1), 0);
+  ceph_ll_put(cmount1, file1);
+  ceph_shutdown(cmount1);
+  ceph_shutdown(cmount2);
+}
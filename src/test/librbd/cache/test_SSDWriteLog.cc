@@ -0,0 +1,331 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "test/librbd/test_fixture.h"
+#include "test/librbd/test_support.h"
+#include "cls/rbd/cls_rbd_client.h"
+#include "common/Cond.h"
+#include "common/hostname.h"
+#include "include/stringify.h"
+#include "librbd/ImageCtx.h"
+#include "librbd/ImageState.h"
+#include "librbd/api/Image.h"
+#include "librbd/cache/ImageWriteback.h"
+#include "librbd/cache/SSDWriteLog.h"
+#include "librbd/io/ImageRequestWQ.h"
+#include "librbd/io/ReadResult.h"
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+void register_test_ssd_write_log() {
+}
+
+class TestSSDWriteLog : public TestFixture {
+public:
+  typedef librbd::cache::SSDWriteLog<librbd::ImageCtx> SSDWriteLog;
+
+  void SetUp() override {
+    TestFixture::SetUp();
+    char dir[] = "/tmp/test_ssd_write_log.XXXXXX";
+    ASSERT_NE(nullptr, mkdtemp(dir));
+    m_dir = dir;
+  }
+
+  void TearDown() override {
+    if (!m_log_path.empty()) {
+      ::unlink(m_log_path.c_str());
+    }
+    ::rmdir(m_dir.c_str());
+    TestFixture::TearDown();
+  }
+
+  int open_cache(librbd::ImageCtx *ictx, SSDWriteLog **cache) {
+    ictx->config.set_val("rbd_persistent_cache_path", m_dir);
+    ictx->config.set_val("rbd_persistent_cache_size", "32M");
+    ictx->config.set_val("rbd_persistent_cache_writeback_bytes", "1M");
+    m_log_path = m_dir + "/rbd-ssd-wl." +
+      stringify(ictx->md_ctx.get_id()) + "." + ictx->id;
+
+    // as PostAcquireRequest does, replay only what the image names
+    librbd::cache::SSDWriteLogState state;
+    int r = get_state(ictx, &state);
+    if (r < 0 && r != -ENOENT) {
+      return r;
+    }
+
+    *cache = SSDWriteLog::create(*ictx, state);
+    C_SaferCond ctx;
+    (*cache)->init(&ctx);
+    return ctx.wait();
+  }
+
+  int write(SSDWriteLog *cache, uint64_t off, const bufferlist &bl) {
+    C_SaferCond ctx;
+    bufferlist data = bl;
+    cache->aio_write({{off, bl.length()}}, std::move(data), 0, &ctx);
+    return ctx.wait();
+  }
+
+  int read(SSDWriteLog *cache, uint64_t off, uint64_t len, bufferlist *bl) {
+    C_SaferCond ctx;
+    cache->aio_read({{off, len}}, bl, 0, &ctx);
+    return ctx.wait();
+  }
+
+  int read_image(librbd::ImageCtx *ictx, uint64_t off, uint64_t len,
+                 bufferlist *bl) {
+    librbd::cache::ImageWriteback<librbd::ImageCtx> writeback(*ictx);
+    C_SaferCond ctx;
+    writeback.aio_read({{off, len}}, bl, 0, &ctx);
+    return ctx.wait();
+  }
+
+  int get_state(librbd::ImageCtx *ictx,
+                librbd::cache::SSDWriteLogState *state) {
+    std::string value;
+    int r = librbd::cls_client::metadata_get(
+      &ictx->md_ctx, ictx->header_oid, librbd::cache::SSDWriteLogState::KEY,
+      &value);
+    if (r < 0) {
+      return r;
+    }
+    return state->decode(value) ? 0 : -EINVAL;
+  }
+
+  bool log_exists() {
+    struct stat st;
+    return ::stat(m_log_path.c_str(), &st) == 0;
+  }
+
+  std::string m_dir;
+  std::string m_log_path;
+};
+
+TEST_F(TestSSDWriteLog, ReadYourWrites) {
+  REQUIRE_FEATURE(RBD_FEATURE_EXCLUSIVE_LOCK);
+
+  librbd::ImageCtx *ictx;
+  ASSERT_EQ(0, open_image(m_image_name, &ictx));
+  ASSERT_EQ(0, acquire_exclusive_lock(*ictx));
+
+  SSDWriteLog *cache;
+  ASSERT_EQ(0, open_cache(ictx, &cache));
+
+  bufferlist a, b;
+  a.append(std::string(8192, 'a'));
+  b.append(std::string(1024, 'b'));
+  ASSERT_EQ(0, write(cache, 0, a));
+  ASSERT_EQ(0, write(cache, 4096, b));
+
+  C_SaferCond flush_ctx;
+  cache->aio_flush(&flush_ctx);
+  ASSERT_EQ(0, flush_ctx.wait());
+
+  bufferlist expected;
+  expected.append(std::string(4096, 'a'));
+  expected.append(std::string(1024, 'b'));
+  expected.append(std::string(3072, 'a'));
+  expected.append_zero(4096);
+
+  bufferlist bl;
+  ASSERT_EQ(0, read(cache, 0, 12288, &bl));
+  ASSERT_TRUE(expected.contents_equal(bl));
+
+  C_SaferCond shut_down_ctx;
+  cache->shut_down(&shut_down_ctx);
+  ASSERT_EQ(0, shut_down_ctx.wait());
+  delete cache;
+  ASSERT_FALSE(log_exists());
+
+  bl.clear();
+  ASSERT_EQ(0, read_image(ictx, 0, 12288, &bl));
+  ASSERT_TRUE(expected.contents_equal(bl));
+}
+
+TEST_F(TestSSDWriteLog, ReplayAfterCrash) {
+  REQUIRE_FEATURE(RBD_FEATURE_EXCLUSIVE_LOCK);
+
+  librbd::ImageCtx *ictx;
+  ASSERT_EQ(0, open_image(m_image_name, &ictx));
+  ASSERT_EQ(0, acquire_exclusive_lock(*ictx));
+
+  SSDWriteLog *cache;
+  ASSERT_EQ(0, open_cache(ictx, &cache));
+
+  bufferlist expected;
+  for (int i = 0; i < 16; ++i) {
+    bufferlist bl;
+    bl.append(std::string(4096, 'a' + i));
+    ASSERT_EQ(0, write(cache, i * 4096, bl));
+    expected.claim_append(bl);
+  }
+
+  // drop the cache without writing back, as if the client had crashed
+  delete cache;
+  ASSERT_TRUE(log_exists());
+
+  // replay writes everything back before init completes
+  ASSERT_EQ(0, open_cache(ictx, &cache));
+  bufferlist bl;
+  ASSERT_EQ(0, read_image(ictx, 0, expected.length(), &bl));
+  ASSERT_TRUE(expected.contents_equal(bl));
+
+  // and new writes are not confused with records left in the log
+  bufferlist z;
+  z.append(std::string(4096, 'z'));
+  ASSERT_EQ(0, write(cache, 0, z));
+  delete cache;
+
+  ASSERT_EQ(0, open_cache(ictx, &cache));
+  C_SaferCond shut_down_ctx;
+  cache->shut_down(&shut_down_ctx);
+  ASSERT_EQ(0, shut_down_ctx.wait());
+  delete cache;
+
+  bl.clear();
+  ASSERT_EQ(0, read_image(ictx, 0, 4096, &bl));
+  ASSERT_TRUE(z.contents_equal(bl));
+}
+
+TEST_F(TestSSDWriteLog, StateNamesOpenLog) {
+  REQUIRE_FEATURE(RBD_FEATURE_EXCLUSIVE_LOCK);
+
+  librbd::ImageCtx *ictx;
+  ASSERT_EQ(0, open_image(m_image_name, &ictx));
+  ASSERT_EQ(0, acquire_exclusive_lock(*ictx));
+
+  librbd::cache::SSDWriteLogState state;
+  ASSERT_EQ(-ENOENT, get_state(ictx, &state));
+
+  SSDWriteLog *cache;
+  ASSERT_EQ(0, open_cache(ictx, &cache));
+  ASSERT_EQ(0, get_state(ictx, &state));
+  ASSERT_EQ(ceph_get_hostname(), state.host);
+  ASSERT_EQ(m_log_path, state.path);
+
+  // a second cache on the same log is refused while the first is open
+  SSDWriteLog *other;
+  ASSERT_EQ(-EBUSY, open_cache(ictx, &other));
+  delete other;
+
+  C_SaferCond shut_down_ctx;
+  cache->shut_down(&shut_down_ctx);
+  ASSERT_EQ(0, shut_down_ctx.wait());
+  delete cache;
+  ASSERT_EQ(-ENOENT, get_state(ictx, &state));
+  ASSERT_FALSE(log_exists());
+}
+
+TEST_F(TestSSDWriteLog, DiscardedLogNotReplayed) {
+  REQUIRE_FEATURE(RBD_FEATURE_EXCLUSIVE_LOCK);
+
+  librbd::ImageCtx *ictx;
+  ASSERT_EQ(0, open_image(m_image_name, &ictx));
+  ASSERT_EQ(0, acquire_exclusive_lock(*ictx));
+
+  SSDWriteLog *cache;
+  ASSERT_EQ(0, open_cache(ictx, &cache));
+  bufferlist a;
+  a.append(std::string(4096, 'a'));
+  ASSERT_EQ(0, write(cache, 0, a));
+  delete cache;
+
+  // the user gave up on the log, e.g. the image was used elsewhere since
+  ASSERT_EQ(0, librbd::cls_client::metadata_remove(
+                 &ictx->md_ctx, ictx->header_oid,
+                 librbd::cache::SSDWriteLogState::KEY));
+  bufferlist b;
+  b.append(std::string(4096, 'b'));
+  ASSERT_EQ(4096, ictx->io_work_queue->write(0, b.length(), bufferlist{b},
+                                             0));
+
+  ASSERT_EQ(0, open_cache(ictx, &cache));
+  bufferlist bl;
+  ASSERT_EQ(0, read(cache, 0, 4096, &bl));
+  ASSERT_TRUE(b.contents_equal(bl));
+
+  C_SaferCond shut_down_ctx;
+  cache->shut_down(&shut_down_ctx);
+  ASSERT_EQ(0, shut_down_ctx.wait());
+  delete cache;
+
+  bl.clear();
+  ASSERT_EQ(0, read_image(ictx, 0, 4096, &bl));
+  ASSERT_TRUE(b.contents_equal(bl));
+}
+
+TEST_F(TestSSDWriteLog, MissingLog) {
+  REQUIRE_FEATURE(RBD_FEATURE_EXCLUSIVE_LOCK);
+
+  librbd::ImageCtx *ictx;
+  ASSERT_EQ(0, open_image(m_image_name, &ictx));
+  ASSERT_EQ(0, acquire_exclusive_lock(*ictx));
+
+  SSDWriteLog *cache;
+  ASSERT_EQ(0, open_cache(ictx, &cache));
+  delete cache;
+  ASSERT_EQ(0, ::unlink(m_log_path.c_str()));
+
+  // writes the image was promised are gone, so don't pretend otherwise
+  ASSERT_EQ(-ENOENT, open_cache(ictx, &cache));
+  delete cache;
+
+  ASSERT_EQ(0, librbd::cls_client::metadata_remove(
+                 &ictx->md_ctx, ictx->header_oid,
+                 librbd::cache::SSDWriteLogState::KEY));
+}
+
+TEST_F(TestSSDWriteLog, SnapshotIncludesLoggedWrites) {
+  REQUIRE_FEATURE(RBD_FEATURE_EXCLUSIVE_LOCK);
+  REQUIRE(!is_feature_enabled(RBD_FEATURE_JOURNALING));
+
+  librbd::ImageCtx *ictx;
+  ASSERT_EQ(0, open_image(m_image_name, &ictx));
+  ictx->config.set_val("rbd_persistent_cache_enabled", "true");
+  ictx->config.set_val("rbd_persistent_cache_path", m_dir);
+  ictx->config.set_val("rbd_persistent_cache_size", "32M");
+  m_log_path = m_dir + "/rbd-ssd-wl." +
+    stringify(ictx->md_ctx.get_id()) + "." + ictx->id;
+  ASSERT_EQ(0, acquire_exclusive_lock(*ictx));
+  ASSERT_NE(nullptr, ictx->image_cache);
+
+  bufferlist bl;
+  bl.append(std::string(4096, 's'));
+  ASSERT_EQ(4096, ictx->io_work_queue->write(8192, bl.length(),
+                                             bufferlist{bl}, 0));
+  ASSERT_EQ(0, snap_create(*ictx, "snap1"));
+
+  // read the snapshot through another handle while the cache is still
+  // open on the first one
+  librbd::ImageCtx *snap_ictx;
+  ASSERT_EQ(0, open_image(m_image_name, &snap_ictx));
+  ASSERT_EQ(0, librbd::api::Image<>::snap_set(
+                 snap_ictx, cls::rbd::UserSnapshotNamespace(), "snap1"));
+  bufferlist read_bl;
+  ASSERT_EQ(4096, snap_ictx->io_work_queue->read(
+                    8192, 4096, librbd::io::ReadResult{&read_bl}, 0));
+  ASSERT_TRUE(bl.contents_equal(read_bl));
+
+  close_image(snap_ictx);
+  close_image(ictx);
+  ASSERT_FALSE(log_exists());
+}
+
+TEST_F(TestSSDWriteLog, PathRequired) {
+  REQUIRE_FEATURE(RBD_FEATURE_EXCLUSIVE_LOCK);
+
+  librbd::ImageCtx *ictx;
+  ASSERT_EQ(0, open_image(m_image_name, &ictx));
+  ASSERT_EQ(0, acquire_exclusive_lock(*ictx));
+
+  ictx->config.set_val("rbd_persistent_cache_path", "");
+  SSDWriteLog *cache = SSDWriteLog::create(*ictx, {});
+  C_SaferCond ctx;
+  cache->init(&ctx);
+  ASSERT_EQ(-EINVAL, ctx.wait());
+  delete cache;
+
+  librbd::cache::SSDWriteLogState state;
+  ASSERT_EQ(-ENOENT, get_state(ictx, &state));
+}
@@ -8,8 +8,11 @@
 #include "test/librbd/mock/MockJournal.h"
 #include "test/librbd/mock/MockJournalPolicy.h"
 #include "test/librbd/mock/MockObjectMap.h"
+#include "test/librbd/mock/cache/MockImageCache.h"
 #include "test/librados_test_stub/MockTestMemIoCtxImpl.h"
 #include "test/librados_test_stub/MockTestMemRadosClient.h"
+#include "common/hostname.h"
+#include "librbd/cache/SSDWriteLog.h"
 #include "librbd/exclusive_lock/PostAcquireRequest.h"
 #include "librbd/image/RefreshRequest.h"
 #include "gmock/gmock.h"
@@ -57,6 +60,26 @@ struct RefreshRequest<librbd::MockTestImageCtx> {
 RefreshRequest<librbd::MockTestImageCtx> *RefreshRequest<librbd::MockTestImageCtx>::s_instance = nullptr;
 
 } // namespace image
+
+namespace cache {
+
+template<>
+struct SSDWriteLog<librbd::MockTestImageCtx> {
+  static MockImageCache *s_instance;
+  static SSDWriteLogState s_state;
+
+  static MockImageCache *create(librbd::MockTestImageCtx &image_ctx,
+                                const SSDWriteLogState &state) {
+    ceph_assert(s_instance != nullptr);
+    s_state = state;
+    return s_instance;
+  }
+};
+
+MockImageCache *SSDWriteLog<librbd::MockTestImageCtx>::s_instance = nullptr;
+SSDWriteLogState SSDWriteLog<librbd::MockTestImageCtx>::s_state;
+
+} // namespace cache
 } // namespace librbd
 
 // template definitions
@@ -88,6 +111,7 @@ class TestMockExclusiveLockPostAcquireRequest : public TestMockFixture {
 public:
   typedef PostAcquireRequest<MockTestImageCtx> MockPostAcquireRequest;
   typedef librbd::image::RefreshRequest<MockTestImageCtx> MockRefreshRequest;
+  typedef librbd::cache::SSDWriteLog<MockTestImageCtx> MockSSDWriteLog;
 
   void expect_test_features(MockTestImageCtx &mock_image_ctx, uint64_t features,
                             bool enabled) {
@@ -131,6 +155,22 @@ public:
                   .WillOnce(CompleteContext(0, mock_image_ctx.image_ctx->op_work_queue));
   }
 
+  void expect_get_image_cache_state(MockTestImageCtx &mock_image_ctx,
+                                    const std::string &host, int r) {
+    auto &expect = EXPECT_CALL(get_mock_io_ctx(mock_image_ctx.md_ctx),
+                               exec(mock_image_ctx.header_oid, _, StrEq("rbd"),
+                                    StrEq("metadata_get"), _, _, _));
+    if (r < 0) {
+      expect.WillOnce(Return(r));
+    } else {
+      cache::SSDWriteLogState state{host, "/tmp/rbd-ssd-wl.log"};
+      expect.WillOnce(WithArg<5>(Invoke([state](bufferlist *out_bl) {
+                        encode(state.encode(), *out_bl);
+                        return 0;
+                      })));
+    }
+  }
+
   void expect_create_journal(MockTestImageCtx &mock_image_ctx,
                              MockJournal *mock_journal) {
     EXPECT_CALL(mock_image_ctx, create_journal())
@@ -168,6 +208,13 @@ public:
                   .WillOnce(CompleteContext(r, mock_image_ctx.image_ctx->op_work_queue));
   }
 
+  void expect_init_image_cache(MockTestImageCtx &mock_image_ctx,
+                               cache::MockImageCache &mock_image_cache,
+                               int r) {
+    EXPECT_CALL(mock_image_cache, init(_))
+                  .WillOnce(CompleteContext(r, mock_image_ctx.image_ctx->op_work_queue));
+  }
+
   void expect_handle_prepare_lock_complete(MockTestImageCtx &mock_image_ctx) {
     EXPECT_CALL(*mock_image_ctx.state, handle_prepare_lock_complete());
   }
@@ -274,6 +321,172 @@ TEST_F(TestMockExclusiveLockPostAcquireRequest, SuccessJournalDisabled) {
   ASSERT_EQ(0, ctx.wait());
 }
 
+TEST_F(TestMockExclusiveLockPostAcquireRequest, SuccessImageCache) {
+  REQUIRE_FEATURE(RBD_FEATURE_EXCLUSIVE_LOCK);
+
+  librbd::ImageCtx *ictx;
+  ASSERT_EQ(0, open_image(m_image_name, &ictx));
+
+  MockTestImageCtx mock_image_ctx(*ictx);
+  mock_image_ctx.config.set_val("rbd_persistent_cache_enabled", "true");
+  expect_op_work_queue(mock_image_ctx);
+
+  InSequence seq;
+  expect_is_refresh_required(mock_image_ctx, false);
+  expect_test_features(mock_image_ctx, RBD_FEATURE_OBJECT_MAP, false);
+  expect_test_features(mock_image_ctx, RBD_FEATURE_JOURNALING,
+                       mock_image_ctx.image_lock, false);
+
+  auto mock_image_cache = new cache::MockImageCache();
+  MockSSDWriteLog::s_instance = mock_image_cache;
+  expect_init_image_cache(mock_image_ctx, *mock_image_cache, 0);
+  expect_handle_prepare_lock_complete(mock_image_ctx);
+
+  C_SaferCond acquire_ctx;
+  C_SaferCond ctx;
+  MockPostAcquireRequest *req = MockPostAcquireRequest::create(mock_image_ctx,
+                                                               &acquire_ctx,
+                                                               &ctx);
+  req->send();
+  ASSERT_EQ(0, acquire_ctx.wait());
+  ASSERT_EQ(0, ctx.wait());
+  ASSERT_EQ(mock_image_cache, mock_image_ctx.image_cache);
+  delete mock_image_cache;
+}
+
+TEST_F(TestMockExclusiveLockPostAcquireRequest, OpenImageCacheError) {
+  REQUIRE_FEATURE(RBD_FEATURE_EXCLUSIVE_LOCK);
+
+  librbd::ImageCtx *ictx;
+  ASSERT_EQ(0, open_image(m_image_name, &ictx));
+
+  MockTestImageCtx mock_image_ctx(*ictx);
+  mock_image_ctx.config.set_val("rbd_persistent_cache_enabled", "true");
+  expect_op_work_queue(mock_image_ctx);
+
+  InSequence seq;
+  expect_is_refresh_required(mock_image_ctx, false);
+
+  MockObjectMap mock_object_map;
+  expect_test_features(mock_image_ctx, RBD_FEATURE_OBJECT_MAP, true);
+  expect_create_object_map(mock_image_ctx, &mock_object_map);
+  expect_open_object_map(mock_image_ctx, mock_object_map, 0);
+  expect_test_features(mock_image_ctx, RBD_FEATURE_JOURNALING,
+                       mock_image_ctx.image_lock, false);
+
+  auto mock_image_cache = new cache::MockImageCache();
+  MockSSDWriteLog::s_instance = mock_image_cache;
+  expect_init_image_cache(mock_image_ctx, *mock_image_cache, -EIO);
+  expect_close_object_map(mock_image_ctx, mock_object_map);
+  expect_handle_prepare_lock_complete(mock_image_ctx);
+
+  C_SaferCond acquire_ctx;
+  C_SaferCond ctx;
+  MockPostAcquireRequest *req = MockPostAcquireRequest::create(mock_image_ctx,
+                                                               &acquire_ctx,
+                                                               &ctx);
+  req->send();
+  ASSERT_EQ(0, acquire_ctx.wait());
+  ASSERT_EQ(-EIO, ctx.wait());
+  ASSERT_EQ(nullptr, mock_image_ctx.image_cache);
+}
+
+TEST_F(TestMockExclusiveLockPostAcquireRequest, DirtyImageCache) {
+  REQUIRE_FEATURE(RBD_FEATURE_EXCLUSIVE_LOCK);
+
+  librbd::ImageCtx *ictx;
+  ASSERT_EQ(0, open_image(m_image_name, &ictx));
+
+  MockTestImageCtx mock_image_ctx(*ictx);
+  mock_image_ctx.config.set_val("rbd_persistent_cache_enabled", "true");
+  expect_op_work_queue(mock_image_ctx);
+
+  InSequence seq;
+  expect_is_refresh_required(mock_image_ctx, false);
+  expect_test_features(mock_image_ctx, RBD_FEATURE_OBJECT_MAP, false);
+  expect_get_image_cache_state(mock_image_ctx, ceph_get_hostname(), 0);
+  expect_test_features(mock_image_ctx, RBD_FEATURE_JOURNALING,
+                       mock_image_ctx.image_lock, false);
+  expect_test_features(mock_image_ctx, RBD_FEATURE_JOURNALING,
+                       mock_image_ctx.image_lock, false);
+
+  auto mock_image_cache = new cache::MockImageCache();
+  MockSSDWriteLog::s_instance = mock_image_cache;
+  expect_init_image_cache(mock_image_ctx, *mock_image_cache, 0);
+  expect_handle_prepare_lock_complete(mock_image_ctx);
+
+  C_SaferCond acquire_ctx;
+  C_SaferCond ctx;
+  MockPostAcquireRequest *req = MockPostAcquireRequest::create(mock_image_ctx,
+                                                               &acquire_ctx,
+                                                               &ctx);
+  req->send();
+  ASSERT_EQ(0, acquire_ctx.wait());
+  ASSERT_EQ(0, ctx.wait());
+  ASSERT_EQ(mock_image_cache, mock_image_ctx.image_cache);
+  ASSERT_EQ(ceph_get_hostname(), MockSSDWriteLog::s_state.host);
+  ASSERT_EQ("/tmp/rbd-ssd-wl.log", MockSSDWriteLog::s_state.path);
+  delete mock_image_cache;
+}
+
+TEST_F(TestMockExclusiveLockPostAcquireRequest, DirtyImageCacheOtherHost) {
+  REQUIRE_FEATURE(RBD_FEATURE_EXCLUSIVE_LOCK);
+
+  librbd::ImageCtx *ictx;
+  ASSERT_EQ(0, open_image(m_image_name, &ictx));
+
+  MockTestImageCtx mock_image_ctx(*ictx);
+  mock_image_ctx.config.set_val("rbd_persistent_cache_enabled", "true");
+  expect_op_work_queue(mock_image_ctx);
+
+  InSequence seq;
+  expect_is_refresh_required(mock_image_ctx, false);
+
+  MockObjectMap mock_object_map;
+  expect_test_features(mock_image_ctx, RBD_FEATURE_OBJECT_MAP, true);
+  expect_create_object_map(mock_image_ctx, &mock_object_map);
+  expect_open_object_map(mock_image_ctx, mock_object_map, 0);
+  expect_get_image_cache_state(mock_image_ctx, "other-host", 0);
+  expect_test_features(mock_image_ctx, RBD_FEATURE_JOURNALING,
+                       mock_image_ctx.image_lock, false);
+  expect_close_object_map(mock_image_ctx, mock_object_map);
+  expect_handle_prepare_lock_complete(mock_image_ctx);
+
+  C_SaferCond *acquire_ctx = new C_SaferCond();
+  C_SaferCond ctx;
+  MockPostAcquireRequest *req = MockPostAcquireRequest::create(mock_image_ctx,
+                                                               acquire_ctx,
+                                                               &ctx);
+  req->send();
+  ASSERT_EQ(-EROFS, ctx.wait());
+  ASSERT_EQ(nullptr, mock_image_ctx.image_cache);
+  ASSERT_EQ(nullptr, mock_image_ctx.object_map);
+}
+
+TEST_F(TestMockExclusiveLockPostAcquireRequest, GetImageCacheStateError) {
+  REQUIRE_FEATURE(RBD_FEATURE_EXCLUSIVE_LOCK);
+
+  librbd::ImageCtx *ictx;
+  ASSERT_EQ(0, open_image(m_image_name, &ictx));
+
+  MockTestImageCtx mock_image_ctx(*ictx);
+  expect_op_work_queue(mock_image_ctx);
+
+  InSequence seq;
+  expect_is_refresh_required(mock_image_ctx, false);
+  expect_test_features(mock_image_ctx, RBD_FEATURE_OBJECT_MAP, false);
+  expect_get_image_cache_state(mock_image_ctx, "", -EIO);
+  expect_handle_prepare_lock_complete(mock_image_ctx);
+
+  C_SaferCond *acquire_ctx = new C_SaferCond();
+  C_SaferCond ctx;
+  MockPostAcquireRequest *req = MockPostAcquireRequest::create(mock_image_ctx,
+                                                               acquire_ctx,
+                                                               &ctx);
+  req->send();
+  ASSERT_EQ(-EIO, ctx.wait());
+}
+
 TEST_F(TestMockExclusiveLockPostAcquireRequest, SuccessObjectMapDisabled) {
   REQUIRE_FEATURE(RBD_FEATURE_EXCLUSIVE_LOCK);
 
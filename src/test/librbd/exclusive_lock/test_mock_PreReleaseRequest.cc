@@ -6,6 +6,7 @@
 #include "test/librbd/mock/MockImageCtx.h"
 #include "test/librbd/mock/MockJournal.h"
 #include "test/librbd/mock/MockObjectMap.h"
+#include "test/librbd/mock/cache/MockImageCache.h"
 #include "test/librbd/mock/io/MockObjectDispatch.h"
 #include "test/librados_test_stub/MockTestMemIoCtxImpl.h"
 #include "common/AsyncOpTracker.h"
@@ -101,6 +102,13 @@ public:
       .WillOnce(CompleteContext(r, mock_image_ctx.image_ctx->op_work_queue));
   }
 
+  void expect_shut_down_image_cache(MockImageCtx &mock_image_ctx,
+                                    cache::MockImageCache &mock_image_cache,
+                                    int r) {
+    EXPECT_CALL(mock_image_cache, shut_down(_))
+      .WillOnce(CompleteContext(r, mock_image_ctx.image_ctx->op_work_queue));
+  }
+
   void expect_flush_notifies(MockImageCtx &mock_image_ctx) {
     EXPECT_CALL(*mock_image_ctx.image_watcher, flush(_))
                   .WillOnce(CompleteContext(0, mock_image_ctx.image_ctx->op_work_queue));
@@ -211,6 +219,62 @@ TEST_F(TestMockExclusiveLockPreReleaseRequest, SuccessObjectMapDisabled) {
   ASSERT_EQ(0, ctx.wait());
 }
 
+TEST_F(TestMockExclusiveLockPreReleaseRequest, SuccessImageCache) {
+  REQUIRE_FEATURE(RBD_FEATURE_EXCLUSIVE_LOCK);
+
+  librbd::ImageCtx *ictx;
+  ASSERT_EQ(0, open_image(m_image_name, &ictx));
+
+  MockImageCtx mock_image_ctx(*ictx);
+
+  expect_block_writes(mock_image_ctx, 0);
+  expect_op_work_queue(mock_image_ctx);
+
+  InSequence seq;
+  expect_cancel_op_requests(mock_image_ctx, 0);
+
+  auto mock_image_cache = new cache::MockImageCache();
+  mock_image_ctx.image_cache = mock_image_cache;
+  expect_shut_down_image_cache(mock_image_ctx, *mock_image_cache, 0);
+  expect_invalidate_cache(mock_image_ctx, 0);
+
+  expect_flush_notifies(mock_image_ctx);
+
+  C_SaferCond ctx;
+  MockPreReleaseRequest *req = MockPreReleaseRequest::create(
+    mock_image_ctx, true, m_async_op_tracker, &ctx);
+  req->send();
+  ASSERT_EQ(0, ctx.wait());
+  ASSERT_EQ(nullptr, mock_image_ctx.image_cache);
+}
+
+TEST_F(TestMockExclusiveLockPreReleaseRequest, ShutDownImageCacheError) {
+  REQUIRE_FEATURE(RBD_FEATURE_EXCLUSIVE_LOCK);
+
+  librbd::ImageCtx *ictx;
+  ASSERT_EQ(0, open_image(m_image_name, &ictx));
+
+  MockImageCtx mock_image_ctx(*ictx);
+
+  expect_block_writes(mock_image_ctx, 0);
+  expect_op_work_queue(mock_image_ctx);
+
+  InSequence seq;
+  expect_cancel_op_requests(mock_image_ctx, 0);
+
+  cache::MockImageCache mock_image_cache;
+  mock_image_ctx.image_cache = &mock_image_cache;
+  expect_shut_down_image_cache(mock_image_ctx, mock_image_cache, -EIO);
+  expect_unblock_writes(mock_image_ctx);
+
+  C_SaferCond ctx;
+  MockPreReleaseRequest *req = MockPreReleaseRequest::create(
+    mock_image_ctx, true, m_async_op_tracker, &ctx);
+  req->send();
+  ASSERT_EQ(-EIO, ctx.wait());
+  ASSERT_EQ(&mock_image_cache, mock_image_ctx.image_cache);
+}
+
 TEST_F(TestMockExclusiveLockPreReleaseRequest, Blacklisted) {
   REQUIRE_FEATURE(RBD_FEATURE_EXCLUSIVE_LOCK);
 
@@ -464,5 +464,36 @@ TEST_F(TestMockIoImageRequest, AioCompareAndWriteJournalAppendDisabled) {
   ASSERT_EQ(0, aio_comp_ctx.wait());
 }
 
+TEST_F(TestMockIoImageRequest, AioFlushImageCache) {
+  librbd::ImageCtx *ictx;
+  ASSERT_EQ(0, open_image(m_image_name, &ictx));
+
+  MockTestImageCtx mock_image_ctx(*ictx);
+  cache::MockImageCache mock_image_cache;
+  mock_image_ctx.image_cache = &mock_image_cache;
+
+  InSequence seq;
+  // a user flush only needs the cache to be durable ...
+  EXPECT_CALL(mock_image_cache, aio_flush(_))
+    .WillOnce(CompleteContext(0, mock_image_ctx.image_ctx->op_work_queue));
+  // ... but an internal one must reach the image
+  EXPECT_CALL(mock_image_cache, flush(_))
+    .WillOnce(CompleteContext(0, mock_image_ctx.image_ctx->op_work_queue));
+
+  for (auto flush_source : {FLUSH_SOURCE_USER, FLUSH_SOURCE_INTERNAL}) {
+    C_SaferCond aio_comp_ctx;
+    AioCompletion *aio_comp = AioCompletion::create_and_start(
+      &aio_comp_ctx, ictx, AIO_TYPE_FLUSH);
+    MockImageFlushRequest mock_aio_image_flush(mock_image_ctx, aio_comp,
+                                               flush_source, {});
+    {
+      std::shared_lock owner_locker{mock_image_ctx.owner_lock};
+      mock_aio_image_flush.send();
+    }
+    ASSERT_EQ(0, aio_comp_ctx.wait());
+  }
+  mock_image_ctx.image_cache = nullptr;
+}
+
 } // namespace io
 } // namespace librbd
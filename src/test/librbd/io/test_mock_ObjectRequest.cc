@@ -604,6 +604,46 @@ TEST_F(TestMockIoObjectRequest, WriteFull) {
   ASSERT_EQ(0, ctx.wait());
 }
 
+TEST_F(TestMockIoObjectRequest, WriteExtents) {
+  librbd::ImageCtx *ictx;
+  ASSERT_EQ(0, open_image(m_image_name, &ictx));
+
+  MockTestImageCtx mock_image_ctx(*ictx);
+  expect_get_object_size(mock_image_ctx);
+
+  MockExclusiveLock mock_exclusive_lock;
+  if (ictx->test_features(RBD_FEATURE_EXCLUSIVE_LOCK)) {
+    mock_image_ctx.exclusive_lock = &mock_exclusive_lock;
+    expect_is_lock_owner(mock_exclusive_lock);
+  }
+
+  MockObjectMap mock_object_map;
+  if (ictx->test_features(RBD_FEATURE_OBJECT_MAP)) {
+    mock_image_ctx.object_map = &mock_object_map;
+  }
+
+  // the extents span the whole object, but do not fill it
+  uint64_t object_size = ictx->get_object_size();
+  Extents extents{{0, 4096}, {object_size - 8192, 8192}};
+  bufferlist bl;
+  bl.append(std::string(4096, '1'));
+  bl.append(std::string(8192, '2'));
+
+  InSequence seq;
+  expect_get_parent_overlap(mock_image_ctx, CEPH_NOSNAP, 0, 0);
+  expect_object_may_exist(mock_image_ctx, 0, true);
+  expect_object_map_update(mock_image_ctx, 0, 1, OBJECT_EXISTS, {}, false, 0);
+  expect_write(mock_image_ctx, 0, 4096, 0);
+  expect_write(mock_image_ctx, object_size - 8192, 8192, 0);
+
+  C_SaferCond ctx;
+  auto req = new MockObjectWriteRequest(
+    &mock_image_ctx, 0, std::move(extents), std::move(bl),
+    mock_image_ctx.snapc, 0, {}, &ctx);
+  req->send();
+  ASSERT_EQ(0, ctx.wait());
+}
+
 TEST_F(TestMockIoObjectRequest, WriteObjectMap) {
   REQUIRE_FEATURE(RBD_FEATURE_OBJECT_MAP);
 
@@ -0,0 +1,296 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "test/librbd/test_mock_fixture.h"
+#include "test/librbd/test_support.h"
+#include "test/librbd/mock/MockImageCtx.h"
+#include "include/rbd/librbd.hpp"
+#include "librbd/io/ObjectDispatchSpec.h"
+#include "librbd/io/ReadaheadObjectDispatch.h"
+
+namespace librbd {
+namespace {
+
+struct MockTestImageCtx : public MockImageCtx {
+  MockTestImageCtx(ImageCtx &image_ctx) : MockImageCtx(image_ctx) {
+  }
+};
+
+} // anonymous namespace
+
+namespace util {
+
+inline ImageCtx *get_image_ctx(MockTestImageCtx *image_ctx) {
+  return image_ctx->image_ctx;
+}
+
+} // namespace util
+} // namespace librbd
+
+#include "librbd/io/ReadaheadObjectDispatch.cc"
+
+namespace librbd {
+namespace io {
+
+using ::testing::_;
+using ::testing::Invoke;
+using ::testing::Return;
+
+struct TestMockIoReadaheadObjectDispatch : public TestMockFixture {
+  typedef ReadaheadObjectDispatch<librbd::MockTestImageCtx> MockReadaheadObjectDispatch;
+
+  TestMockIoReadaheadObjectDispatch() {
+    EXPECT_EQ(0, _rados.conf_set("rbd_readahead_trigger_requests", "2"));
+  }
+
+  void expect_get_image_size(MockTestImageCtx &mock_image_ctx) {
+    // leave room for objects past the ones read by the tests
+    EXPECT_CALL(mock_image_ctx, get_image_size(_))
+      .WillRepeatedly(Return(mock_image_ctx.layout.object_size * 8));
+  }
+
+  void expect_prefetch(MockTestImageCtx &mock_image_ctx, uint64_t object_no,
+                       ObjectDispatchSpec** spec) {
+    EXPECT_CALL(*mock_image_ctx.io_object_dispatcher, send(_))
+      .WillOnce(Invoke([object_no, spec](ObjectDispatchSpec* s) {
+                  auto read = boost::get<ObjectDispatchSpec::ReadRequest>(
+                    &s->request);
+                  ASSERT_TRUE(read != nullptr);
+                  ASSERT_EQ(object_no, read->object_no);
+                  ASSERT_EQ(0U, read->object_off);
+                  ASSERT_EQ(OBJECT_DISPATCH_LAYER_READAHEAD,
+                            s->object_dispatch_layer);
+                  *spec = s;
+                }));
+  }
+
+  void complete_prefetch(ObjectDispatchSpec* spec, const bufferlist& bl) {
+    auto read = boost::get<ObjectDispatchSpec::ReadRequest>(&spec->request);
+    read->read_data->append(bl);
+    spec->dispatch_result = io::DISPATCH_RESULT_COMPLETE;
+    spec->dispatcher_ctx.complete(0);
+  }
+
+  bool read(MockReadaheadObjectDispatch &mock_readahead_object_dispatch,
+            uint64_t object_no, uint64_t object_off, uint64_t object_len,
+            bufferlist* bl, DispatchResult* dispatch_result,
+            Context* on_dispatched) {
+    Context* on_finish = nullptr;
+    return mock_readahead_object_dispatch.read(
+      object_no, object_off, object_len, CEPH_NOSNAP, 0, {}, bl, nullptr,
+      nullptr, dispatch_result, &on_finish, on_dispatched);
+  }
+
+  void shut_down(MockReadaheadObjectDispatch &mock_readahead_object_dispatch) {
+    C_SaferCond ctx;
+    mock_readahead_object_dispatch.shut_down(&ctx);
+    ASSERT_EQ(0, ctx.wait());
+  }
+};
+
+TEST_F(TestMockIoReadaheadObjectDispatch, SequentialPrefetch) {
+  librbd::ImageCtx *ictx;
+  ASSERT_EQ(0, open_image(m_image_name, &ictx));
+
+  MockTestImageCtx mock_image_ctx(*ictx);
+  MockReadaheadObjectDispatch mock_readahead_object_dispatch(&mock_image_ctx);
+  expect_op_work_queue(mock_image_ctx);
+  expect_get_image_size(mock_image_ctx);
+
+  bufferlist bl;
+  DispatchResult dispatch_result;
+  ASSERT_FALSE(read(mock_readahead_object_dispatch, 0, 0, 4096, &bl,
+                    &dispatch_result, nullptr));
+
+  // the second sequential read triggers a prefetch of the next object
+  ObjectDispatchSpec* spec = nullptr;
+  expect_prefetch(mock_image_ctx, 1, &spec);
+  ASSERT_FALSE(read(mock_readahead_object_dispatch, 0, 4096, 4096, &bl,
+                    &dispatch_result, nullptr));
+  ASSERT_TRUE(spec != nullptr);
+
+  bufferlist data;
+  data.append(std::string(4096, '1'));
+  data.append(std::string(4096, '2'));
+  complete_prefetch(spec, data);
+
+  C_SaferCond ctx;
+  ASSERT_TRUE(read(mock_readahead_object_dispatch, 1, 4096, 8192, &bl,
+                   &dispatch_result, &ctx));
+  ASSERT_EQ(0, ctx.wait());
+  ASSERT_EQ(DISPATCH_RESULT_COMPLETE, dispatch_result);
+
+  // short objects are returned short, as from rados
+  bufferlist expected_bl;
+  expected_bl.append(std::string(4096, '2'));
+  ASSERT_TRUE(expected_bl.contents_equal(bl));
+
+  shut_down(mock_readahead_object_dispatch);
+}
+
+TEST_F(TestMockIoReadaheadObjectDispatch, RandomReads) {
+  librbd::ImageCtx *ictx;
+  ASSERT_EQ(0, open_image(m_image_name, &ictx));
+
+  MockTestImageCtx mock_image_ctx(*ictx);
+  MockReadaheadObjectDispatch mock_readahead_object_dispatch(&mock_image_ctx);
+  expect_op_work_queue(mock_image_ctx);
+  expect_get_image_size(mock_image_ctx);
+  EXPECT_CALL(*mock_image_ctx.io_object_dispatcher, send(_)).Times(0);
+
+  bufferlist bl;
+  DispatchResult dispatch_result;
+  ASSERT_FALSE(read(mock_readahead_object_dispatch, 0, 0, 4096, &bl,
+                    &dispatch_result, nullptr));
+  ASSERT_FALSE(read(mock_readahead_object_dispatch, 3, 8192, 4096, &bl,
+                    &dispatch_result, nullptr));
+  ASSERT_FALSE(read(mock_readahead_object_dispatch, 1, 4096, 4096, &bl,
+                    &dispatch_result, nullptr));
+  ASSERT_FALSE(read(mock_readahead_object_dispatch, 0, 8192, 4096, &bl,
+                    &dispatch_result, nullptr));
+
+  shut_down(mock_readahead_object_dispatch);
+}
+
+TEST_F(TestMockIoReadaheadObjectDispatch, WaitForPrefetch) {
+  librbd::ImageCtx *ictx;
+  ASSERT_EQ(0, open_image(m_image_name, &ictx));
+
+  MockTestImageCtx mock_image_ctx(*ictx);
+  MockReadaheadObjectDispatch mock_readahead_object_dispatch(&mock_image_ctx);
+  expect_op_work_queue(mock_image_ctx);
+  expect_get_image_size(mock_image_ctx);
+
+  bufferlist bl;
+  DispatchResult dispatch_result;
+  ASSERT_FALSE(read(mock_readahead_object_dispatch, 0, 0, 4096, &bl,
+                    &dispatch_result, nullptr));
+
+  ObjectDispatchSpec* spec = nullptr;
+  expect_prefetch(mock_image_ctx, 1, &spec);
+  ASSERT_FALSE(read(mock_readahead_object_dispatch, 0, 4096, 4096, &bl,
+                    &dispatch_result, nullptr));
+  ASSERT_TRUE(spec != nullptr);
+
+  C_SaferCond ctx;
+  ASSERT_TRUE(read(mock_readahead_object_dispatch, 1, 0, 4096, &bl,
+                   &dispatch_result, &ctx));
+
+  bufferlist data;
+  data.append(std::string(8192, '1'));
+  complete_prefetch(spec, data);
+  ASSERT_EQ(0, ctx.wait());
+  ASSERT_EQ(DISPATCH_RESULT_COMPLETE, dispatch_result);
+
+  bufferlist expected_bl;
+  expected_bl.append(std::string(4096, '1'));
+  ASSERT_TRUE(expected_bl.contents_equal(bl));
+
+  shut_down(mock_readahead_object_dispatch);
+}
+
+TEST_F(TestMockIoReadaheadObjectDispatch, WriteInvalidates) {
+  librbd::ImageCtx *ictx;
+  ASSERT_EQ(0, open_image(m_image_name, &ictx));
+
+  MockTestImageCtx mock_image_ctx(*ictx);
+  MockReadaheadObjectDispatch mock_readahead_object_dispatch(&mock_image_ctx);
+  expect_op_work_queue(mock_image_ctx);
+  expect_get_image_size(mock_image_ctx);
+
+  bufferlist bl;
+  DispatchResult dispatch_result;
+  ASSERT_FALSE(read(mock_readahead_object_dispatch, 0, 0, 4096, &bl,
+                    &dispatch_result, nullptr));
+
+  ObjectDispatchSpec* spec = nullptr;
+  expect_prefetch(mock_image_ctx, 1, &spec);
+  ASSERT_FALSE(read(mock_readahead_object_dispatch, 0, 4096, 4096, &bl,
+                    &dispatch_result, nullptr));
+  ASSERT_TRUE(spec != nullptr);
+
+  // a read waiting on the prefetch is sent down once the object changes
+  C_SaferCond ctx;
+  ASSERT_TRUE(read(mock_readahead_object_dispatch, 1, 0, 4096, &bl,
+                   &dispatch_result, &ctx));
+
+  bufferlist write_data;
+  write_data.append(std::string(4096, '2'));
+  C_SaferCond write_ctx;
+  Context* on_finish = &write_ctx;
+  ASSERT_FALSE(mock_readahead_object_dispatch.write(
+    1, 0, std::move(write_data), mock_image_ctx.snapc, 0, {}, nullptr,
+    nullptr, nullptr, &on_finish, nullptr));
+  ASSERT_EQ(0, ctx.wait());
+  ASSERT_EQ(DISPATCH_RESULT_CONTINUE, dispatch_result);
+
+  // the stale prefetch completes while the write is still in flight and is
+  // dropped
+  bufferlist data;
+  data.append(std::string(8192, '1'));
+  complete_prefetch(spec, data);
+  ASSERT_FALSE(read(mock_readahead_object_dispatch, 1, 8192, 4096, &bl,
+                    &dispatch_result, nullptr));
+
+  on_finish->complete(0);
+  ASSERT_EQ(0, write_ctx.wait());
+  ASSERT_FALSE(read(mock_readahead_object_dispatch, 1, 8192, 4096, &bl,
+                    &dispatch_result, nullptr));
+
+  shut_down(mock_readahead_object_dispatch);
+}
+
+TEST_F(TestMockIoReadaheadObjectDispatch, NoPrefetchDuringWrite) {
+  librbd::ImageCtx *ictx;
+  ASSERT_EQ(0, open_image(m_image_name, &ictx));
+
+  MockTestImageCtx mock_image_ctx(*ictx);
+  MockReadaheadObjectDispatch mock_readahead_object_dispatch(&mock_image_ctx);
+  expect_op_work_queue(mock_image_ctx);
+  expect_get_image_size(mock_image_ctx);
+
+  bufferlist bl;
+  DispatchResult dispatch_result;
+  ASSERT_FALSE(read(mock_readahead_object_dispatch, 0, 0, 4096, &bl,
+                    &dispatch_result, nullptr));
+
+  bufferlist write_data;
+  write_data.append(std::string(4096, '2'));
+  C_SaferCond write_ctx;
+  Context* on_finish = &write_ctx;
+  ASSERT_FALSE(mock_readahead_object_dispatch.write_same(
+    1, 0, 8192, {{0, 8192}}, std::move(write_data), mock_image_ctx.snapc, 0,
+    {}, nullptr, nullptr, nullptr, &on_finish, nullptr));
+
+  // the prefetch would race with the write, so it isn't issued
+  EXPECT_CALL(*mock_image_ctx.io_object_dispatcher, send(_)).Times(0);
+  ASSERT_FALSE(read(mock_readahead_object_dispatch, 0, 4096, 4096, &bl,
+                    &dispatch_result, nullptr));
+  ASSERT_FALSE(read(mock_readahead_object_dispatch, 1, 0, 4096, &bl,
+                    &dispatch_result, nullptr));
+  ::testing::Mock::VerifyAndClearExpectations(
+    mock_image_ctx.io_object_dispatcher);
+
+  on_finish->complete(0);
+  ASSERT_EQ(0, write_ctx.wait());
+
+  // the stream picks up again once the write completes
+  ObjectDispatchSpec* spec = nullptr;
+  expect_prefetch(mock_image_ctx, 1, &spec);
+  ASSERT_FALSE(read(mock_readahead_object_dispatch, 0, 8192, 4096, &bl,
+                    &dispatch_result, nullptr));
+  ASSERT_TRUE(spec != nullptr);
+
+  bufferlist data;
+  data.append(std::string(8192, '2'));
+  complete_prefetch(spec, data);
+  C_SaferCond ctx;
+  ASSERT_TRUE(read(mock_readahead_object_dispatch, 1, 0, 4096, &bl,
+                   &dispatch_result, &ctx));
+  ASSERT_EQ(0, ctx.wait());
+
+  shut_down(mock_readahead_object_dispatch);
+}
+
+} // namespace io
+} // namespace librbd
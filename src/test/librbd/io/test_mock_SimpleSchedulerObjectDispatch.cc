@@ -411,10 +411,20 @@ TEST_F(TestMockIoSimpleSchedulerObjectDispatch, WriteMerged) {
   ASSERT_EQ(dispatch_result, io::DISPATCH_RESULT_COMPLETE);
   ASSERT_EQ(on_finish6, &cond6);
 
-  // expect two requests dispatched:
+  // expect a single request dispatched, writing two extents:
   // 0~40 (merged 0~10, 10~10, 20~10, 30~10) and 50~10
-  expect_dispatch_delayed_requests(mock_image_ctx, 0);
-  expect_dispatch_delayed_requests(mock_image_ctx, 0);
+  Extents expected_extents{{0, 40}, {50, 10}};
+  EXPECT_CALL(*mock_image_ctx.io_object_dispatcher, send(_))
+    .WillOnce(Invoke([&mock_image_ctx, &expected_extents](ObjectDispatchSpec* spec) {
+                auto write = boost::get<ObjectDispatchSpec::WriteExtentsRequest>(
+                  &spec->request);
+                ASSERT_TRUE(write != nullptr);
+                ASSERT_EQ(expected_extents, write->extents);
+                ASSERT_EQ(50U, write->data.length());
+                spec->dispatch_result = io::DISPATCH_RESULT_COMPLETE;
+                mock_image_ctx.image_ctx->op_work_queue->queue(
+                    &spec->dispatcher_ctx, 0);
+              }));
   expect_schedule_dispatch_delayed_requests(timer_task, nullptr);
 
   on_finish1->complete(0);
@@ -436,7 +446,7 @@ TEST_F(TestMockIoSimpleSchedulerObjectDispatch, WriteMerged) {
   ASSERT_EQ(0, cond6.wait());
 }
 
-TEST_F(TestMockIoSimpleSchedulerObjectDispatch, WriteNonSequential) {
+TEST_F(TestMockIoSimpleSchedulerObjectDispatch, WriteOverlapped) {
   librbd::ImageCtx *ictx;
   ASSERT_EQ(0, open_image(m_image_name, &ictx));
 
@@ -475,26 +485,154 @@ TEST_F(TestMockIoSimpleSchedulerObjectDispatch, WriteNonSequential) {
   ASSERT_EQ(on_finish2, &cond2);
   ASSERT_NE(timer_task, nullptr);
 
-  expect_dispatch_delayed_requests(mock_image_ctx, 0);
-  expect_schedule_dispatch_delayed_requests(timer_task, nullptr);
-
+  // overlapping writes are merged, the newer data winning
   object_off = 5;
   data.clear();
   data.append(std::string(10, 'Y'));
   C_SaferCond cond3;
   Context *on_finish3 = &cond3;
-  ASSERT_FALSE(mock_simple_scheduler_object_dispatch.write(
+  C_SaferCond on_dispatched3;
+  ASSERT_TRUE(mock_simple_scheduler_object_dispatch.write(
       0, object_off, std::move(data), mock_image_ctx.snapc, 0, {},
-      &object_dispatch_flags, nullptr, &dispatch_result, &on_finish3, nullptr));
-  ASSERT_NE(on_finish3, &cond3);
+      &object_dispatch_flags, nullptr, &dispatch_result, &on_finish3,
+      &on_dispatched3));
+  ASSERT_EQ(dispatch_result, io::DISPATCH_RESULT_COMPLETE);
+  ASSERT_EQ(on_finish3, &cond3);
+
+  object_off = 2;
+  data.clear();
+  data.append(std::string(2, 'Z'));
+  C_SaferCond cond4;
+  Context *on_finish4 = &cond4;
+  C_SaferCond on_dispatched4;
+  ASSERT_TRUE(mock_simple_scheduler_object_dispatch.write(
+      0, object_off, std::move(data), mock_image_ctx.snapc, 0, {},
+      &object_dispatch_flags, nullptr, &dispatch_result, &on_finish4,
+      &on_dispatched4));
+  ASSERT_EQ(dispatch_result, io::DISPATCH_RESULT_COMPLETE);
+  ASSERT_EQ(on_finish4, &cond4);
+
+  // writes with different flags cannot be merged
+  ceph::bufferlist expected_data;
+  expected_data.append("XXZZXYYYYYYYYYY");
+  EXPECT_CALL(*mock_image_ctx.io_object_dispatcher, send(_))
+    .WillOnce(Invoke([&mock_image_ctx, &expected_data](ObjectDispatchSpec* spec) {
+                auto write = boost::get<ObjectDispatchSpec::WriteRequest>(
+                  &spec->request);
+                ASSERT_TRUE(write != nullptr);
+                ASSERT_EQ(0U, write->object_off);
+                ASSERT_TRUE(expected_data.contents_equal(write->data));
+                spec->dispatch_result = io::DISPATCH_RESULT_COMPLETE;
+                mock_image_ctx.image_ctx->op_work_queue->queue(
+                    &spec->dispatcher_ctx, 0);
+              }));
+  expect_schedule_dispatch_delayed_requests(timer_task, nullptr);
+
+  object_off = 20;
+  data.clear();
+  data.append(std::string(10, 'W'));
+  C_SaferCond cond5;
+  Context *on_finish5 = &cond5;
+  ASSERT_FALSE(mock_simple_scheduler_object_dispatch.write(
+      0, object_off, std::move(data), mock_image_ctx.snapc,
+      LIBRADOS_OP_FLAG_FADVISE_DONTNEED, {}, &object_dispatch_flags, nullptr,
+      &dispatch_result, &on_finish5, nullptr));
+  ASSERT_NE(on_finish5, &cond5);
+  ASSERT_EQ(0, on_dispatched2.wait());
+  ASSERT_EQ(0, on_dispatched3.wait());
+  ASSERT_EQ(0, on_dispatched4.wait());
 
   on_finish1->complete(0);
   ASSERT_EQ(0, cond1.wait());
-  ASSERT_EQ(0, on_dispatched2.wait());
   on_finish2->complete(0);
-  ASSERT_EQ(0, cond2.wait());
   on_finish3->complete(0);
+  on_finish4->complete(0);
+  ASSERT_EQ(0, cond2.wait());
   ASSERT_EQ(0, cond3.wait());
+  ASSERT_EQ(0, cond4.wait());
+  on_finish5->complete(0);
+  ASSERT_EQ(0, cond5.wait());
+}
+
+TEST_F(TestMockIoSimpleSchedulerObjectDispatch, WriteNonAdjacent) {
+  librbd::ImageCtx *ictx;
+  ASSERT_EQ(0, open_image(m_image_name, &ictx));
+  ASSERT_TRUE(ictx->perfcounter != nullptr);
+
+  MockTestImageCtx mock_image_ctx(*ictx);
+  MockSimpleSchedulerObjectDispatch
+      mock_simple_scheduler_object_dispatch(&mock_image_ctx);
+
+  expect_get_object_name(mock_image_ctx, 0);
+
+  InSequence seq;
+
+  auto delayed = ictx->perfcounter->get(l_librbd_sched_delayed);
+  auto dispatched = ictx->perfcounter->get(l_librbd_sched_dispatched);
+
+  ceph::bufferlist data;
+  data.append("X");
+  int object_dispatch_flags = 0;
+  C_SaferCond cond1;
+  Context *on_finish1 = &cond1;
+  ASSERT_FALSE(mock_simple_scheduler_object_dispatch.write(
+      0, 0, std::move(data), mock_image_ctx.snapc, 0, {},
+      &object_dispatch_flags, nullptr, nullptr, &on_finish1, nullptr));
+  ASSERT_NE(on_finish1, &cond1);
+
+  Context *timer_task = nullptr;
+  expect_schedule_dispatch_delayed_requests(nullptr, &timer_task);
+
+  // four writes with gaps between them
+  io::DispatchResult dispatch_result;
+  C_SaferCond on_finish_conds[4];
+  C_SaferCond on_dispatched_conds[4];
+  Context *on_finishes[4];
+  for (int i = 0; i < 4; ++i) {
+    data.clear();
+    data.append(std::string(10, 'A' + i));
+    on_finishes[i] = &on_finish_conds[i];
+    ASSERT_TRUE(mock_simple_scheduler_object_dispatch.write(
+        0, 4096 * i, std::move(data), mock_image_ctx.snapc, 0, {},
+        &object_dispatch_flags, nullptr, &dispatch_result, &on_finishes[i],
+        &on_dispatched_conds[i]));
+    ASSERT_EQ(dispatch_result, io::DISPATCH_RESULT_COMPLETE);
+    ASSERT_EQ(on_finishes[i], &on_finish_conds[i]);
+  }
+  ASSERT_NE(timer_task, nullptr);
+
+  // all of them are dispatched in a single multi-extent write
+  Extents expected_extents{{0, 10}, {4096, 10}, {8192, 10}, {12288, 10}};
+  ceph::bufferlist expected_data;
+  expected_data.append("AAAAAAAAAABBBBBBBBBBCCCCCCCCCCDDDDDDDDDD");
+  EXPECT_CALL(*mock_image_ctx.io_object_dispatcher, send(_))
+    .WillOnce(Invoke([&mock_image_ctx, &expected_extents, &expected_data]
+                     (ObjectDispatchSpec* spec) {
+                auto write = boost::get<ObjectDispatchSpec::WriteExtentsRequest>(
+                  &spec->request);
+                ASSERT_TRUE(write != nullptr);
+                ASSERT_EQ(expected_extents, write->extents);
+                ASSERT_TRUE(expected_data.contents_equal(write->data));
+                spec->dispatch_result = io::DISPATCH_RESULT_COMPLETE;
+                mock_image_ctx.image_ctx->op_work_queue->queue(
+                    &spec->dispatcher_ctx, 0);
+              }));
+  expect_schedule_dispatch_delayed_requests(timer_task, nullptr);
+
+  on_finish1->complete(0);
+  ASSERT_EQ(0, cond1.wait());
+  for (int i = 0; i < 4; ++i) {
+    ASSERT_EQ(0, on_dispatched_conds[i].wait());
+  }
+
+  // four writes delayed, one dispatched
+  ASSERT_EQ(delayed + 4, ictx->perfcounter->get(l_librbd_sched_delayed));
+  ASSERT_EQ(dispatched + 1, ictx->perfcounter->get(l_librbd_sched_dispatched));
+
+  for (int i = 0; i < 4; ++i) {
+    on_finishes[i]->complete(0);
+    ASSERT_EQ(0, on_finish_conds[i].wait());
+  }
 }
 
 TEST_F(TestMockIoSimpleSchedulerObjectDispatch, Mixed) {
@@ -39,6 +39,17 @@ struct MockObjectMap {
                              ignore_enoent, callback_object);
   }
 
+  template <typename T, void(T::*MF)(int) = &T::complete>
+  bool aio_update(uint64_t snap_id, uint64_t object_no, uint64_t object_off,
+                  uint64_t object_len, uint8_t new_state,
+                  const boost::optional<uint8_t> &current_state,
+                  const ZTracer::Trace &parent_trace, bool ignore_enoent,
+                  T *callback_object) {
+    return aio_update<T, MF>(snap_id, object_no, object_no + 1, new_state,
+                             current_state, parent_trace, ignore_enoent,
+                             callback_object);
+  }
+
   template <typename T, void(T::*MF)(int) = &T::complete>
   bool aio_update(uint64_t snap_id, uint64_t start_object_no,
                   uint64_t end_object_no, uint8_t new_state,
@@ -66,6 +66,21 @@ public:
                          journal_tid, dispatch_result, on_dispatched);
   }
 
+  MOCK_METHOD8(execute_write_extents,
+               bool(uint64_t, const Extents&, const ceph::bufferlist&,
+                    const ::SnapContext &, int*, uint64_t*, DispatchResult*,
+                    Context *));
+  bool write_extents(
+      uint64_t object_no, Extents&& extents, ceph::bufferlist&& data,
+      const ::SnapContext &snapc, int op_flags,
+      const ZTracer::Trace &parent_trace, int* dispatch_flags,
+      uint64_t* journal_tid, DispatchResult* dispatch_result,
+      Context** on_finish, Context* on_dispatched) override {
+    return execute_write_extents(object_no, extents, data, snapc,
+                                 dispatch_flags, journal_tid, dispatch_result,
+                                 on_dispatched);
+  }
+
   MOCK_METHOD10(execute_write_same,
                 bool(uint64_t, uint64_t, uint64_t,
                      const LightweightBufferExtents&,
@@ -158,9 +158,11 @@ TEST_F(TestMockObjectMapRefreshRequest, SuccessHead) {
   C_SaferCond ctx;
   ceph::shared_mutex object_map_lock = ceph::make_shared_mutex("lock");
   ceph::BitVector<2> object_map;
+  ceph::BitVector<2> dirty_map;
   MockLockRequest mock_lock_request;
   MockRefreshRequest *req = new MockRefreshRequest(
-    mock_image_ctx, &object_map_lock, &object_map, CEPH_NOSNAP, &ctx);
+    mock_image_ctx, &object_map_lock, &object_map, &dirty_map, CEPH_NOSNAP,
+    &ctx);
 
   InSequence seq;
   expect_get_image_size(mock_image_ctx, CEPH_NOSNAP,
@@ -189,8 +191,10 @@ TEST_F(TestMockObjectMapRefreshRequest, SuccessSnapshot) {
   C_SaferCond ctx;
   ceph::shared_mutex object_map_lock = ceph::make_shared_mutex("lock");
   ceph::BitVector<2> object_map;
+  ceph::BitVector<2> dirty_map;
   MockRefreshRequest *req = new MockRefreshRequest(
-    mock_image_ctx, &object_map_lock, &object_map, TEST_SNAP_ID, &ctx);
+    mock_image_ctx, &object_map_lock, &object_map, &dirty_map, TEST_SNAP_ID,
+    &ctx);
 
   InSequence seq;
   expect_get_image_size(mock_image_ctx, TEST_SNAP_ID,
@@ -218,8 +222,10 @@ TEST_F(TestMockObjectMapRefreshRequest, LoadError) {
   C_SaferCond ctx;
   ceph::shared_mutex object_map_lock = ceph::make_shared_mutex("lock");
   ceph::BitVector<2> object_map;
+  ceph::BitVector<2> dirty_map;
   MockRefreshRequest *req = new MockRefreshRequest(
-    mock_image_ctx, &object_map_lock, &object_map, TEST_SNAP_ID, &ctx);
+    mock_image_ctx, &object_map_lock, &object_map, &dirty_map, TEST_SNAP_ID,
+    &ctx);
 
   InSequence seq;
   expect_get_image_size(mock_image_ctx, TEST_SNAP_ID,
@@ -249,8 +255,10 @@ TEST_F(TestMockObjectMapRefreshRequest, LoadInvalidateError) {
   C_SaferCond ctx;
   ceph::shared_mutex object_map_lock = ceph::make_shared_mutex("lock");
   ceph::BitVector<2> object_map;
+  ceph::BitVector<2> dirty_map;
   MockRefreshRequest *req = new MockRefreshRequest(
-    mock_image_ctx, &object_map_lock, &object_map, TEST_SNAP_ID, &ctx);
+    mock_image_ctx, &object_map_lock, &object_map, &dirty_map, TEST_SNAP_ID,
+    &ctx);
 
   InSequence seq;
   expect_get_image_size(mock_image_ctx, TEST_SNAP_ID,
@@ -280,8 +288,10 @@ TEST_F(TestMockObjectMapRefreshRequest, LoadCorrupt) {
   C_SaferCond ctx;
   ceph::shared_mutex object_map_lock = ceph::make_shared_mutex("lock");
   ceph::BitVector<2> object_map;
+  ceph::BitVector<2> dirty_map;
   MockRefreshRequest *req = new MockRefreshRequest(
-    mock_image_ctx, &object_map_lock, &object_map, TEST_SNAP_ID, &ctx);
+    mock_image_ctx, &object_map_lock, &object_map, &dirty_map, TEST_SNAP_ID,
+    &ctx);
 
   InSequence seq;
   expect_get_image_size(mock_image_ctx, TEST_SNAP_ID,
@@ -315,8 +325,10 @@ TEST_F(TestMockObjectMapRefreshRequest, TooSmall) {
   C_SaferCond ctx;
   ceph::shared_mutex object_map_lock = ceph::make_shared_mutex("lock");
   ceph::BitVector<2> object_map;
+  ceph::BitVector<2> dirty_map;
   MockRefreshRequest *req = new MockRefreshRequest(
-    mock_image_ctx, &object_map_lock, &object_map, TEST_SNAP_ID, &ctx);
+    mock_image_ctx, &object_map_lock, &object_map, &dirty_map, TEST_SNAP_ID,
+    &ctx);
 
   InSequence seq;
   expect_get_image_size(mock_image_ctx, TEST_SNAP_ID,
@@ -349,8 +361,10 @@ TEST_F(TestMockObjectMapRefreshRequest, TooSmallInvalidateError) {
   C_SaferCond ctx;
   ceph::shared_mutex object_map_lock = ceph::make_shared_mutex("lock");
   ceph::BitVector<2> object_map;
+  ceph::BitVector<2> dirty_map;
   MockRefreshRequest *req = new MockRefreshRequest(
-    mock_image_ctx, &object_map_lock, &object_map, TEST_SNAP_ID, &ctx);
+    mock_image_ctx, &object_map_lock, &object_map, &dirty_map, TEST_SNAP_ID,
+    &ctx);
 
   InSequence seq;
   expect_get_image_size(mock_image_ctx, TEST_SNAP_ID,
@@ -383,8 +397,10 @@ TEST_F(TestMockObjectMapRefreshRequest, TooLarge) {
   C_SaferCond ctx;
   ceph::shared_mutex object_map_lock = ceph::make_shared_mutex("lock");
   ceph::BitVector<2> object_map;
+  ceph::BitVector<2> dirty_map;
   MockRefreshRequest *req = new MockRefreshRequest(
-    mock_image_ctx, &object_map_lock, &object_map, TEST_SNAP_ID, &ctx);
+    mock_image_ctx, &object_map_lock, &object_map, &dirty_map, TEST_SNAP_ID,
+    &ctx);
 
   InSequence seq;
   expect_get_image_size(mock_image_ctx, TEST_SNAP_ID,
@@ -412,8 +428,10 @@ TEST_F(TestMockObjectMapRefreshRequest, ResizeError) {
   C_SaferCond ctx;
   ceph::shared_mutex object_map_lock = ceph::make_shared_mutex("lock");
   ceph::BitVector<2> object_map;
+  ceph::BitVector<2> dirty_map;
   MockRefreshRequest *req = new MockRefreshRequest(
-    mock_image_ctx, &object_map_lock, &object_map, TEST_SNAP_ID, &ctx);
+    mock_image_ctx, &object_map_lock, &object_map, &dirty_map, TEST_SNAP_ID,
+    &ctx);
 
   InSequence seq;
   expect_get_image_size(mock_image_ctx, TEST_SNAP_ID,
@@ -444,8 +462,10 @@ TEST_F(TestMockObjectMapRefreshRequest, LargeImageError) {
   C_SaferCond ctx;
   ceph::shared_mutex object_map_lock = ceph::make_shared_mutex("lock");
   ceph::BitVector<2> object_map;
+  ceph::BitVector<2> dirty_map;
   MockRefreshRequest *req = new MockRefreshRequest(
-    mock_image_ctx, &object_map_lock, &object_map, TEST_SNAP_ID, &ctx);
+    mock_image_ctx, &object_map_lock, &object_map, &dirty_map, TEST_SNAP_ID,
+    &ctx);
 
   InSequence seq;
   expect_get_image_size(mock_image_ctx, TEST_SNAP_ID,
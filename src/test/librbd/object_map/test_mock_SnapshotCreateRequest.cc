@@ -87,6 +87,7 @@ TEST_F(TestMockObjectMapSnapshotCreateRequest, Success) {
 
   ceph::shared_mutex object_map_lock = ceph::make_shared_mutex("lock");
   ceph::BitVector<2> object_map;
+  ceph::BitVector<2> dirty_map;
 
   uint64_t snap_id = 1;
   inject_snap_info(ictx, snap_id);
@@ -98,7 +99,8 @@ TEST_F(TestMockObjectMapSnapshotCreateRequest, Success) {
 
   C_SaferCond cond_ctx;
   AsyncRequest<> *request = new SnapshotCreateRequest(
-    *ictx, &object_map_lock, &object_map, snap_id, &cond_ctx);
+    *ictx, &object_map_lock, &object_map, &dirty_map, snap_id,
+    &cond_ctx);
   {
     std::shared_lock image_locker{ictx->image_lock};
     request->send();
@@ -117,6 +119,7 @@ TEST_F(TestMockObjectMapSnapshotCreateRequest, ReadMapError) {
 
   ceph::shared_mutex object_map_lock = ceph::make_shared_mutex("lock");
   ceph::BitVector<2> object_map;
+  ceph::BitVector<2> dirty_map;
 
   uint64_t snap_id = 1;
   inject_snap_info(ictx, snap_id);
@@ -125,7 +128,8 @@ TEST_F(TestMockObjectMapSnapshotCreateRequest, ReadMapError) {
 
   C_SaferCond cond_ctx;
   AsyncRequest<> *request = new SnapshotCreateRequest(
-    *ictx, &object_map_lock, &object_map, snap_id, &cond_ctx);
+    *ictx, &object_map_lock, &object_map, &dirty_map, snap_id,
+    &cond_ctx);
   {
     std::shared_lock image_locker{ictx->image_lock};
     request->send();
@@ -144,6 +148,7 @@ TEST_F(TestMockObjectMapSnapshotCreateRequest, WriteMapError) {
 
   ceph::shared_mutex object_map_lock = ceph::make_shared_mutex("lock");
   ceph::BitVector<2> object_map;
+  ceph::BitVector<2> dirty_map;
 
   uint64_t snap_id = 1;
   inject_snap_info(ictx, snap_id);
@@ -153,7 +158,8 @@ TEST_F(TestMockObjectMapSnapshotCreateRequest, WriteMapError) {
 
   C_SaferCond cond_ctx;
   AsyncRequest<> *request = new SnapshotCreateRequest(
-    *ictx, &object_map_lock, &object_map, snap_id, &cond_ctx);
+    *ictx, &object_map_lock, &object_map, &dirty_map, snap_id,
+    &cond_ctx);
   {
     std::shared_lock image_locker{ictx->image_lock};
     request->send();
@@ -172,6 +178,7 @@ TEST_F(TestMockObjectMapSnapshotCreateRequest, AddSnapshotError) {
 
   ceph::shared_mutex object_map_lock = ceph::make_shared_mutex("lock");
   ceph::BitVector<2> object_map;
+  ceph::BitVector<2> dirty_map;
 
   uint64_t snap_id = 1;
   inject_snap_info(ictx, snap_id);
@@ -182,7 +189,8 @@ TEST_F(TestMockObjectMapSnapshotCreateRequest, AddSnapshotError) {
 
   C_SaferCond cond_ctx;
   AsyncRequest<> *request = new SnapshotCreateRequest(
-    *ictx, &object_map_lock, &object_map, snap_id, &cond_ctx);
+    *ictx, &object_map_lock, &object_map, &dirty_map, snap_id,
+    &cond_ctx);
   {
     std::shared_lock image_locker{ictx->image_lock};
     request->send();
@@ -201,6 +209,7 @@ TEST_F(TestMockObjectMapSnapshotCreateRequest, FlagCleanObjects) {
 
   ceph::shared_mutex object_map_lock = ceph::make_shared_mutex("lock");
   ceph::BitVector<2> object_map;
+  ceph::BitVector<2> dirty_map;
   object_map.resize(1024);
   for (uint64_t i = 0; i < object_map.size(); ++i) {
     object_map[i] = i % 2 == 0 ? OBJECT_EXISTS : OBJECT_NONEXISTENT;
@@ -211,7 +220,8 @@ TEST_F(TestMockObjectMapSnapshotCreateRequest, FlagCleanObjects) {
 
   C_SaferCond cond_ctx;
   AsyncRequest<> *request = new SnapshotCreateRequest(
-    *ictx, &object_map_lock, &object_map, snap_id, &cond_ctx);
+    *ictx, &object_map_lock, &object_map, &dirty_map, snap_id,
+    &cond_ctx);
   {
     std::shared_lock image_locker{ictx->image_lock};
     request->send();
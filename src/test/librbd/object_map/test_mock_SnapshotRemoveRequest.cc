@@ -86,9 +86,11 @@ TEST_F(TestMockObjectMapSnapshotRemoveRequest, Success) {
 
   ceph::shared_mutex object_map_lock = ceph::make_shared_mutex("lock");
   ceph::BitVector<2> object_map;
+  ceph::BitVector<2> dirty_map;
   C_SaferCond cond_ctx;
   AsyncRequest<> *request = new SnapshotRemoveRequest(
-    *ictx, &object_map_lock, &object_map, snap_id, &cond_ctx);
+    *ictx, &object_map_lock, &object_map, &dirty_map, snap_id,
+    &cond_ctx);
   {
     std::shared_lock owner_locker{ictx->owner_lock};
     std::unique_lock image_locker{ictx->image_lock};
@@ -116,9 +118,11 @@ TEST_F(TestMockObjectMapSnapshotRemoveRequest, LoadMapMissing) {
 
   ceph::shared_mutex object_map_lock = ceph::make_shared_mutex("lock");
   ceph::BitVector<2> object_map;
+  ceph::BitVector<2> dirty_map;
   C_SaferCond cond_ctx;
   AsyncRequest<> *request = new SnapshotRemoveRequest(
-    *ictx, &object_map_lock, &object_map, snap_id, &cond_ctx);
+    *ictx, &object_map_lock, &object_map, &dirty_map, snap_id,
+    &cond_ctx);
   {
     std::shared_lock owner_locker{ictx->owner_lock};
     std::unique_lock image_locker{ictx->image_lock};
@@ -153,9 +157,11 @@ TEST_F(TestMockObjectMapSnapshotRemoveRequest, LoadMapError) {
 
   ceph::shared_mutex object_map_lock = ceph::make_shared_mutex("lock");
   ceph::BitVector<2> object_map;
+  ceph::BitVector<2> dirty_map;
   C_SaferCond cond_ctx;
   AsyncRequest<> *request = new SnapshotRemoveRequest(
-    *ictx, &object_map_lock, &object_map, snap_id, &cond_ctx);
+    *ictx, &object_map_lock, &object_map, &dirty_map, snap_id,
+    &cond_ctx);
   {
     std::shared_lock owner_locker{ictx->owner_lock};
     std::unique_lock image_locker{ictx->image_lock};
@@ -181,9 +187,11 @@ TEST_F(TestMockObjectMapSnapshotRemoveRequest, RemoveSnapshotMissing) {
 
   ceph::shared_mutex object_map_lock = ceph::make_shared_mutex("lock");
   ceph::BitVector<2> object_map;
+  ceph::BitVector<2> dirty_map;
   C_SaferCond cond_ctx;
   AsyncRequest<> *request = new SnapshotRemoveRequest(
-    *ictx, &object_map_lock, &object_map, snap_id, &cond_ctx);
+    *ictx, &object_map_lock, &object_map, &dirty_map, snap_id,
+    &cond_ctx);
   {
     std::shared_lock owner_locker{ictx->owner_lock};
     std::unique_lock image_locker{ictx->image_lock};
@@ -210,9 +218,11 @@ TEST_F(TestMockObjectMapSnapshotRemoveRequest, RemoveSnapshotError) {
 
   ceph::shared_mutex object_map_lock = ceph::make_shared_mutex("lock");
   ceph::BitVector<2> object_map;
+  ceph::BitVector<2> dirty_map;
   C_SaferCond cond_ctx;
   AsyncRequest<> *request = new SnapshotRemoveRequest(
-    *ictx, &object_map_lock, &object_map, snap_id, &cond_ctx);
+    *ictx, &object_map_lock, &object_map, &dirty_map, snap_id,
+    &cond_ctx);
   {
     std::shared_lock owner_locker{ictx->owner_lock};
     std::unique_lock image_locker{ictx->image_lock};
@@ -240,9 +250,11 @@ TEST_F(TestMockObjectMapSnapshotRemoveRequest, RemoveMapMissing) {
 
   ceph::shared_mutex object_map_lock = ceph::make_shared_mutex("lock");
   ceph::BitVector<2> object_map;
+  ceph::BitVector<2> dirty_map;
   C_SaferCond cond_ctx;
   AsyncRequest<> *request = new SnapshotRemoveRequest(
-    *ictx, &object_map_lock, &object_map, snap_id, &cond_ctx);
+    *ictx, &object_map_lock, &object_map, &dirty_map, snap_id,
+    &cond_ctx);
   {
     std::shared_lock owner_locker{ictx->owner_lock};
     std::unique_lock image_locker{ictx->image_lock};
@@ -270,9 +282,11 @@ TEST_F(TestMockObjectMapSnapshotRemoveRequest, RemoveMapError) {
 
   ceph::shared_mutex object_map_lock = ceph::make_shared_mutex("lock");
   ceph::BitVector<2> object_map;
+  ceph::BitVector<2> dirty_map;
   C_SaferCond cond_ctx;
   AsyncRequest<> *request = new SnapshotRemoveRequest(
-    *ictx, &object_map_lock, &object_map, snap_id, &cond_ctx);
+    *ictx, &object_map_lock, &object_map, &dirty_map, snap_id,
+    &cond_ctx);
   {
     std::shared_lock owner_locker{ictx->owner_lock};
     std::unique_lock image_locker{ictx->image_lock};
@@ -295,6 +309,7 @@ TEST_F(TestMockObjectMapSnapshotRemoveRequest, ScrubCleanObjects) {
   // update image objectmap for snap inherit
   ceph::shared_mutex object_map_lock = ceph::make_shared_mutex("lock");
   ceph::BitVector<2> object_map;
+  ceph::BitVector<2> dirty_map;
   object_map.resize(1024);
   for (uint64_t i = 512; i < object_map.size(); ++i) {
     object_map[i] = i % 2 == 0 ? OBJECT_EXISTS : OBJECT_NONEXISTENT;
@@ -321,7 +336,8 @@ TEST_F(TestMockObjectMapSnapshotRemoveRequest, ScrubCleanObjects) {
   C_SaferCond cond_ctx2;
   uint64_t snap_id = ictx->snap_info.rbegin()->first;
   AsyncRequest<> *request = new SnapshotRemoveRequest(
-    *ictx, &object_map_lock, &object_map, snap_id, &cond_ctx2);
+    *ictx, &object_map_lock, &object_map, &dirty_map, snap_id,
+    &cond_ctx2);
   {
     std::shared_lock owner_locker{ictx->owner_lock};
     std::unique_lock image_locker{ictx->image_lock};
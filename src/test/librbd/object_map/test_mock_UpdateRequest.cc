@@ -55,6 +55,22 @@ public:
     }
   }
 
+  void expect_update_dirty_map(librbd::ImageCtx *ictx, uint64_t snap_id,
+                               uint64_t start_block, uint64_t end_block,
+                               int r) {
+    bufferlist bl;
+    encode(start_block, bl);
+    encode(end_block, bl);
+    encode(static_cast<uint8_t>(OBJECT_EXISTS), bl);
+    encode(boost::optional<uint8_t>(), bl);
+
+    std::string oid(ObjectMap<>::dirty_map_name(ictx->id, snap_id));
+    EXPECT_CALL(get_mock_io_ctx(ictx->md_ctx),
+                exec(oid, _, StrEq("rbd"), StrEq("object_map_update"),
+                     ContentsEqual(bl), _, _))
+                  .WillOnce(Return(r));
+  }
+
   void expect_invalidate(librbd::ImageCtx *ictx) {
     EXPECT_CALL(get_mock_io_ctx(ictx->md_ctx),
                 exec(ictx->header_oid, _, StrEq("rbd"), StrEq("set_flags"), _, _, _))
@@ -81,8 +97,9 @@ TEST_F(TestMockObjectMapUpdateRequest, UpdateInMemory) {
 
   C_SaferCond cond_ctx;
   AsyncRequest<> *req = new UpdateRequest<>(
-    *ictx, &object_map_lock, &object_map, CEPH_NOSNAP, 0, object_map.size(),
-    OBJECT_NONEXISTENT, OBJECT_EXISTS, {}, false, &cond_ctx);
+    *ictx, &object_map_lock, &object_map, nullptr, CEPH_NOSNAP, 0,
+    object_map.size(), 0, 0, OBJECT_NONEXISTENT, OBJECT_EXISTS, {}, false,
+    &cond_ctx);
   {
     std::shared_lock image_locker{ictx->image_lock};
     std::unique_lock object_map_locker{object_map_lock};
@@ -115,8 +132,9 @@ TEST_F(TestMockObjectMapUpdateRequest, UpdateHeadOnDisk) {
 
   C_SaferCond cond_ctx;
   AsyncRequest<> *req = new UpdateRequest<>(
-    *ictx, &object_map_lock, &object_map, CEPH_NOSNAP, 0, object_map.size(),
-    OBJECT_NONEXISTENT, OBJECT_EXISTS, {}, false, &cond_ctx);
+    *ictx, &object_map_lock, &object_map, nullptr, CEPH_NOSNAP, 0,
+    object_map.size(), 0, 0, OBJECT_NONEXISTENT, OBJECT_EXISTS, {}, false,
+    &cond_ctx);
   {
     std::shared_lock image_locker{ictx->image_lock};
     std::unique_lock object_map_locker{object_map_lock};
@@ -147,8 +165,9 @@ TEST_F(TestMockObjectMapUpdateRequest, UpdateSnapOnDisk) {
 
   C_SaferCond cond_ctx;
   AsyncRequest<> *req = new UpdateRequest<>(
-    *ictx, &object_map_lock, &object_map, snap_id, 0, object_map.size(),
-    OBJECT_NONEXISTENT, OBJECT_EXISTS, {}, false, &cond_ctx);
+    *ictx, &object_map_lock, &object_map, nullptr, snap_id, 0,
+    object_map.size(), 0, 0, OBJECT_NONEXISTENT, OBJECT_EXISTS, {}, false,
+    &cond_ctx);
   {
     std::shared_lock image_locker{ictx->image_lock};
     std::unique_lock object_map_locker{object_map_lock};
@@ -176,8 +195,9 @@ TEST_F(TestMockObjectMapUpdateRequest, UpdateOnDiskError) {
 
   C_SaferCond cond_ctx;
   AsyncRequest<> *req = new UpdateRequest<>(
-    *ictx, &object_map_lock, &object_map, CEPH_NOSNAP, 0, object_map.size(),
-    OBJECT_NONEXISTENT, OBJECT_EXISTS, {}, false, &cond_ctx);
+    *ictx, &object_map_lock, &object_map, nullptr, CEPH_NOSNAP, 0,
+    object_map.size(), 0, 0, OBJECT_NONEXISTENT, OBJECT_EXISTS, {}, false,
+    &cond_ctx);
   {
     std::shared_lock image_locker{ictx->image_lock};
     std::unique_lock object_map_locker{object_map_lock};
@@ -208,8 +228,9 @@ TEST_F(TestMockObjectMapUpdateRequest, RebuildSnapOnDisk) {
 
   C_SaferCond cond_ctx;
   AsyncRequest<> *req = new UpdateRequest<>(
-    *ictx, &object_map_lock, &object_map, snap_id, 0, object_map.size(),
-    OBJECT_EXISTS_CLEAN, boost::optional<uint8_t>(), {}, false, &cond_ctx);
+    *ictx, &object_map_lock, &object_map, nullptr, snap_id, 0,
+    object_map.size(), 0, 0, OBJECT_EXISTS_CLEAN, boost::optional<uint8_t>(),
+    {}, false, &cond_ctx);
   {
     std::shared_lock image_locker{ictx->image_lock};
     std::unique_lock object_map_locker{object_map_lock};
@@ -247,8 +268,9 @@ TEST_F(TestMockObjectMapUpdateRequest, BatchUpdate) {
 
   C_SaferCond cond_ctx;
   AsyncRequest<> *req = new UpdateRequest<>(
-    *ictx, &object_map_lock, &object_map, CEPH_NOSNAP, 0, object_map.size(),
-    OBJECT_NONEXISTENT, OBJECT_EXISTS, {}, false, &cond_ctx);
+    *ictx, &object_map_lock, &object_map, nullptr, CEPH_NOSNAP, 0,
+    object_map.size(), 0, 0, OBJECT_NONEXISTENT, OBJECT_EXISTS, {}, false,
+    &cond_ctx);
   {
     std::shared_lock image_locker{ictx->image_lock};
     std::unique_lock object_map_locker{object_map_lock};
@@ -273,8 +295,9 @@ TEST_F(TestMockObjectMapUpdateRequest, IgnoreMissingObjectMap) {
 
   C_SaferCond cond_ctx;
   AsyncRequest<> *req = new UpdateRequest<>(
-    *ictx, &object_map_lock, &object_map, CEPH_NOSNAP, 0, object_map.size(),
-    OBJECT_NONEXISTENT, OBJECT_EXISTS, {}, true, &cond_ctx);
+    *ictx, &object_map_lock, &object_map, nullptr, CEPH_NOSNAP, 0,
+    object_map.size(), 0, 0, OBJECT_NONEXISTENT, OBJECT_EXISTS, {}, true,
+    &cond_ctx);
   {
     std::shared_lock image_locker{ictx->image_lock};
     std::unique_lock object_map_locker{object_map_lock};
@@ -285,5 +308,47 @@ TEST_F(TestMockObjectMapUpdateRequest, IgnoreMissingObjectMap) {
   expect_unlock_exclusive_lock(*ictx);
 }
 
+TEST_F(TestMockObjectMapUpdateRequest, UpdateDirtyMapOnly) {
+  REQUIRE_FEATURE(RBD_FEATURE_OBJECT_MAP);
+
+  librbd::ImageCtx *ictx;
+  ASSERT_EQ(0, open_image(m_image_name, &ictx));
+  ASSERT_EQ(0, acquire_exclusive_lock(*ictx));
+
+  // the object already exists: only its dirty blocks are recorded
+  expect_update_dirty_map(ictx, CEPH_NOSNAP, 2, 4, 0);
+
+  ceph::shared_mutex object_map_lock = ceph::make_shared_mutex("lock");
+  ceph::BitVector<2> object_map;
+  object_map.resize(1);
+  object_map[0] = OBJECT_EXISTS;
+  ceph::BitVector<2> dirty_map;
+  dirty_map.resize(64);
+  for (auto it = dirty_map.begin(); it != dirty_map.end(); ++it) {
+    *it = OBJECT_EXISTS_CLEAN;
+  }
+
+  C_SaferCond cond_ctx;
+  AsyncRequest<> *req = new UpdateRequest<>(
+    *ictx, &object_map_lock, &object_map, &dirty_map, CEPH_NOSNAP, 0, 0, 2, 4,
+    OBJECT_EXISTS, {}, {}, false, &cond_ctx);
+  {
+    std::shared_lock image_locker{ictx->image_lock};
+    std::unique_lock object_map_locker{object_map_lock};
+    req->send();
+  }
+  ASSERT_EQ(0, cond_ctx.wait());
+
+  for (uint64_t i = 0; i < dirty_map.size(); ++i) {
+    if (i >= 2 && i < 4) {
+      ASSERT_EQ(OBJECT_EXISTS, dirty_map[i]);
+    } else {
+      ASSERT_EQ(OBJECT_EXISTS_CLEAN, dirty_map[i]);
+    }
+  }
+
+  expect_unlock_exclusive_lock(*ictx);
+}
+
 } // namespace object_map
 } // namespace librbd
@@ -4344,6 +4344,217 @@ TYPED_TEST(DiffIterateTest, DiffIterateParentDiscard)
   ASSERT_TRUE(two.subset_of(diff));
 }
 
+class DiffIterateDirtyBlocksTest : public TestLibRBD {
+public:
+  void SetUp() override {
+    TestLibRBD::SetUp();
+    ASSERT_EQ(0, _rados.conf_get("rbd_fast_diff_dirty_blocks",
+                                 m_orig_dirty_blocks));
+    ASSERT_EQ(0, _rados.conf_set("rbd_fast_diff_dirty_blocks", "true"));
+  }
+
+  void TearDown() override {
+    ASSERT_EQ(0, _rados.conf_set("rbd_fast_diff_dirty_blocks",
+                                 m_orig_dirty_blocks.c_str()));
+    TestLibRBD::TearDown();
+  }
+
+  // fill objects [0, object_count) and snapshot them, so that later writes
+  // only partially rewrite existing objects
+  void create_image(librados::IoCtx& ioctx, librbd::Image& image,
+                    uint64_t object_count) {
+    librbd::RBD rbd;
+    std::string name = get_temp_image_name();
+    int order = 22;
+    m_object_size = 1 << order;
+    m_block_size = std::max<uint64_t>(4096, m_object_size / 64);
+
+    ASSERT_EQ(0, create_image_pp(rbd, ioctx, name.c_str(),
+                                 object_count * m_object_size, &order));
+    ASSERT_EQ(0, rbd.open(ioctx, image, name.c_str(), NULL));
+
+    bufferlist bl;
+    bl.append(std::string(m_object_size, '1'));
+    for (uint64_t i = 0; i < object_count; ++i) {
+      ASSERT_EQ((ssize_t)m_object_size,
+                image.write(i * m_object_size, m_object_size, bl));
+    }
+    ASSERT_EQ(0, image.snap_create("base"));
+  }
+
+  // write a few bytes in the middle of each block
+  void write_blocks(librbd::Image& image,
+                    std::initializer_list<uint64_t> blocks) {
+    bufferlist bl;
+    bl.append(std::string(256, '2'));
+    for (auto block : blocks) {
+      ASSERT_EQ(256, image.write(block * m_block_size + 100, 256, bl));
+    }
+  }
+
+  vector<diff_extent> block_extents(std::initializer_list<uint64_t> blocks) {
+    vector<diff_extent> extents;
+    for (auto block : blocks) {
+      extents.push_back(diff_extent(block * m_block_size, m_block_size, true,
+                                    0));
+    }
+    return extents;
+  }
+
+  std::string m_orig_dirty_blocks;
+  uint64_t m_object_size = 0;
+  uint64_t m_block_size = 0;
+};
+
+TEST_F(DiffIterateDirtyBlocksTest, SmallWrite)
+{
+  REQUIRE_FEATURE(RBD_FEATURE_FAST_DIFF);
+
+  librados::IoCtx ioctx;
+  ASSERT_EQ(0, _rados.ioctx_create(m_pool_name.c_str(), ioctx));
+
+  librbd::Image image;
+  ASSERT_NO_FATAL_FAILURE(create_image(ioctx, image, 2));
+
+  // only the block written is reported, not the whole object
+  ASSERT_NO_FATAL_FAILURE(write_blocks(image, {3}));
+
+  vector<diff_extent> extents;
+  ASSERT_EQ(0, image.diff_iterate2("base", 0, 2 * m_object_size, true, true,
+                                   vector_iterate_cb, (void *) &extents));
+  ASSERT_EQ(block_extents({3}), extents);
+
+  // a write straddling two blocks reports both
+  bufferlist bl;
+  bl.append(std::string(256, '3'));
+  ASSERT_EQ(256, image.write(m_object_size + 8 * m_block_size - 128, 256, bl));
+
+  extents.clear();
+  ASSERT_EQ(0, image.diff_iterate2("base", 0, 2 * m_object_size, true, true,
+                                   vector_iterate_cb, (void *) &extents));
+  ASSERT_EQ(2u, extents.size());
+  ASSERT_EQ(diff_extent(3 * m_block_size, m_block_size, true, 0), extents[0]);
+  ASSERT_EQ(diff_extent(m_object_size + 7 * m_block_size, 2 * m_block_size,
+                        true, 0), extents[1]);
+  ASSERT_PASSED(validate_object_map, image);
+}
+
+TEST_F(DiffIterateDirtyBlocksTest, SeveralSnapshots)
+{
+  REQUIRE_FEATURE(RBD_FEATURE_FAST_DIFF);
+
+  librados::IoCtx ioctx;
+  ASSERT_EQ(0, _rados.ioctx_create(m_pool_name.c_str(), ioctx));
+
+  librbd::Image image;
+  ASSERT_NO_FATAL_FAILURE(create_image(ioctx, image, 1));
+
+  ASSERT_NO_FATAL_FAILURE(write_blocks(image, {1}));
+  ASSERT_EQ(0, image.snap_create("snap1"));
+  ASSERT_NO_FATAL_FAILURE(write_blocks(image, {5}));
+  ASSERT_EQ(0, image.snap_create("snap2"));
+  ASSERT_NO_FATAL_FAILURE(write_blocks(image, {9}));
+
+  // the dirty maps of all snapshots in the range are combined
+  vector<diff_extent> extents;
+  ASSERT_EQ(0, image.diff_iterate2("base", 0, m_object_size, true, true,
+                                   vector_iterate_cb, (void *) &extents));
+  ASSERT_EQ(block_extents({1, 5, 9}), extents);
+
+  extents.clear();
+  ASSERT_EQ(0, image.diff_iterate2("snap1", 0, m_object_size, true, true,
+                                   vector_iterate_cb, (void *) &extents));
+  ASSERT_EQ(block_extents({5, 9}), extents);
+
+  extents.clear();
+  ASSERT_EQ(0, image.snap_set("snap2"));
+  ASSERT_EQ(0, image.diff_iterate2("base", 0, m_object_size, true, true,
+                                   vector_iterate_cb, (void *) &extents));
+  ASSERT_EQ(block_extents({1, 5}), extents);
+}
+
+TEST_F(DiffIterateDirtyBlocksTest, SnapRemove)
+{
+  REQUIRE_FEATURE(RBD_FEATURE_FAST_DIFF);
+
+  librados::IoCtx ioctx;
+  ASSERT_EQ(0, _rados.ioctx_create(m_pool_name.c_str(), ioctx));
+
+  librbd::Image image;
+  ASSERT_NO_FATAL_FAILURE(create_image(ioctx, image, 1));
+
+  ASSERT_NO_FATAL_FAILURE(write_blocks(image, {1}));
+  ASSERT_EQ(0, image.snap_create("snap1"));
+  ASSERT_NO_FATAL_FAILURE(write_blocks(image, {5}));
+  ASSERT_EQ(0, image.snap_create("snap2"));
+  ASSERT_NO_FATAL_FAILURE(write_blocks(image, {9}));
+
+  // the blocks of the removed snapshot are merged into the next one
+  ASSERT_EQ(0, image.snap_remove("snap1"));
+
+  vector<diff_extent> extents;
+  ASSERT_EQ(0, image.snap_set("snap2"));
+  ASSERT_EQ(0, image.diff_iterate2("base", 0, m_object_size, true, true,
+                                   vector_iterate_cb, (void *) &extents));
+  ASSERT_EQ(block_extents({1, 5}), extents);
+  ASSERT_EQ(0, image.snap_set(NULL));
+
+  // ... and into the head when the latest snapshot is removed
+  ASSERT_EQ(0, image.snap_remove("snap2"));
+
+  extents.clear();
+  ASSERT_EQ(0, image.diff_iterate2("base", 0, m_object_size, true, true,
+                                   vector_iterate_cb, (void *) &extents));
+  ASSERT_EQ(block_extents({1, 5, 9}), extents);
+}
+
+TEST_F(DiffIterateDirtyBlocksTest, ResizeRollback)
+{
+  REQUIRE_FEATURE(RBD_FEATURE_FAST_DIFF);
+
+  librados::IoCtx ioctx;
+  ASSERT_EQ(0, _rados.ioctx_create(m_pool_name.c_str(), ioctx));
+
+  librbd::Image image;
+  ASSERT_NO_FATAL_FAILURE(create_image(ioctx, image, 3));
+  uint64_t size = 3 * m_object_size;
+
+  // shrinking discards the trimmed objects: once the image grows back,
+  // rewriting one of them reports it whole
+  ASSERT_EQ(0, image.resize(m_object_size + m_object_size / 2));
+  ASSERT_EQ(0, image.resize(size));
+  ASSERT_NO_FATAL_FAILURE(write_blocks(image, {2 * m_object_size /
+                                                 m_block_size}));
+
+  vector<diff_extent> extents;
+  ASSERT_EQ(0, image.diff_iterate2("base", 0, size, true, true,
+                                   vector_iterate_cb, (void *) &extents));
+  ASSERT_EQ(2u, extents.size());
+  ASSERT_EQ(diff_extent(m_object_size + m_object_size / 2, m_object_size / 2,
+                        true, 0), extents[0]);
+  ASSERT_EQ(diff_extent(2 * m_object_size, m_object_size, true, 0),
+            extents[1]);
+
+  ASSERT_PASSED(validate_object_map, image);
+  ASSERT_EQ(0, image.close());
+
+  // the blocks written since the rolled back snapshot are not known: the
+  // objects that existed in it are reported whole
+  ASSERT_NO_FATAL_FAILURE(create_image(ioctx, image, 2));
+  ASSERT_NO_FATAL_FAILURE(write_blocks(image, {3}));
+  ASSERT_EQ(0, image.snap_create("snap1"));
+  ASSERT_NO_FATAL_FAILURE(write_blocks(image, {5}));
+  ASSERT_EQ(0, image.snap_rollback("snap1"));
+  ASSERT_NO_FATAL_FAILURE(write_blocks(image, {7}));
+
+  extents.clear();
+  ASSERT_EQ(0, image.diff_iterate2("snap1", 0, 2 * m_object_size, true, true,
+                                   vector_iterate_cb, (void *) &extents));
+  ASSERT_EQ(1u, extents.size());
+  ASSERT_EQ(diff_extent(0, m_object_size, true, 0), extents[0]);
+  ASSERT_PASSED(validate_object_map, image);
+}
+
 TEST_F(TestLibRBD, ZeroLengthWrite)
 {
   rados_ioctx_t ioctx;
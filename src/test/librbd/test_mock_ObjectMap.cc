@@ -30,6 +30,7 @@ struct RefreshRequest<MockTestImageCtx> {
   static RefreshRequest *s_instance;
   static RefreshRequest *create(MockTestImageCtx &image_ctx, ceph::shared_mutex*,
                                 ceph::BitVector<2u> *object_map,
+                                ceph::BitVector<2u> *dirty_map,
                                 uint64_t snap_id, Context *on_finish) {
     ceph_assert(s_instance != nullptr);
     s_instance->on_finish = on_finish;
@@ -67,8 +68,10 @@ struct UpdateRequest<MockTestImageCtx> {
   static UpdateRequest *s_instance;
   static UpdateRequest *create(MockTestImageCtx &image_ctx, ceph::shared_mutex*,
                                ceph::BitVector<2u> *object_map,
+                               ceph::BitVector<2u> *dirty_map,
                                uint64_t snap_id,
                                uint64_t start_object_no, uint64_t end_object_no,
+                               uint64_t start_block, uint64_t end_block,
                                uint8_t new_state,
                                const boost::optional<uint8_t> &current_state,
                                const ZTracer::Trace &parent_trace,
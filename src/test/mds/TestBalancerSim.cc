@@ -0,0 +1,166 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include <fstream>
+#include <unistd.h>
+
+#include "common/ceph_context.h"
+#include "global/global_context.h"
+#include "mds/BalancerCostModel.h"
+#include "tools/cephfs/BalancerSim.h"
+
+#include "gtest/gtest.h"
+
+static BalancerCostModel make_model()
+{
+  BalancerCostModel model;
+  model.update(g_ceph_context->_conf);
+  model.migration_cost = 0;
+  model.migration_dentry_cost = 0;
+  model.min_residency = 0;
+  model.overload_epochs = 0;
+  return model;
+}
+
+TEST(BalancerCostModel, Costs)
+{
+  BalancerCostModel model = make_model();
+  model.request_cost = 2;
+  model.journal_kb_cost = 1;
+  model.migration_cost = 10;
+  model.migration_dentry_cost = .5;
+  model.min_residency = 60;
+  model.overload_epochs = 2;
+
+  ASSERT_DOUBLE_EQ(52, model.get_request_cost(.05));
+  ASSERT_DOUBLE_EQ(4, model.get_journal_cost(4096));
+  ASSERT_DOUBLE_EQ(60, model.get_migration_cost(100));
+  ASSERT_FALSE(model.worth_migrating(60, 100));
+  ASSERT_TRUE(model.worth_migrating(61, 100));
+  ASSERT_FALSE(model.may_reexport(59));
+  ASSERT_TRUE(model.may_reexport(60));
+  ASSERT_TRUE(model.overloaded_long_enough(0, 1));
+  ASSERT_FALSE(model.overloaded_long_enough(5, 6));
+  ASSERT_TRUE(model.overloaded_long_enough(5, 7));
+}
+
+TEST(BalancerCostModel, ChooseExports)
+{
+  BalancerCostModel model = make_model();
+  std::vector<int> taken, descended;
+  auto take = [&](int dir, double) { taken.push_back(dir); };
+
+  // a subtree close enough to what is needed wins outright
+  double have = 0;
+  model.choose_exports<int>(100, have, {{10, 1, false}, {100, 2, false}},
+			    take, [&](int dir) { descended.push_back(dir); });
+  ASSERT_EQ(std::vector<int>{2}, taken);
+  ASSERT_TRUE(descended.empty());
+  ASSERT_DOUBLE_EQ(100, have);
+
+  // otherwise the bigger small ones, then the big ones are searched
+  taken.clear();
+  have = 0;
+  model.choose_exports<int>(100, have,
+			    {{30, 1, false}, {300, 2, true}, {50, 3, false},
+			     {200, 4, false}, {5, 5, false}},
+			    take, [&](int dir) {
+			      descended.push_back(dir);
+			      have += 5;
+			    });
+  ASSERT_EQ((std::vector<int>{3, 1}), taken);
+  ASSERT_EQ(std::vector<int>{4}, descended);
+  ASSERT_DOUBLE_EQ(85, have);
+}
+
+class BalancerSimTest : public ::testing::Test {
+protected:
+  std::string history;
+
+  void SetUp() override {
+    history = "/tmp/test_balancer_sim." + std::to_string(getpid());
+  }
+  void TearDown() override {
+    ::unlink(history.c_str());
+  }
+
+  // two ranks, with rank 0 holding two equally busy directories and
+  // rank 1 idle, for the given number of rounds
+  void write_history(unsigned rounds) {
+    std::ofstream out(history);
+    for (unsigned i = 0; i < rounds; ++i) {
+      double stamp = 10.0 * (i + 1);
+      out << "{\"loads\": {\"rank\": 0, \"stamp\": " << stamp
+	  << ", \"dirfrags\": ["
+	  << "{\"path\": \"\", \"is_auth\": true, \"num_dentries\": 2,"
+	  << " \"meta_load\": 0, \"cost_load\": 0},"
+	  << "{\"path\": \"/a\", \"is_auth\": true, \"num_dentries\": 10,"
+	  << " \"meta_load\": 100, \"cost_load\": 100},"
+	  << "{\"path\": \"/b\", \"is_auth\": true, \"num_dentries\": 10,"
+	  << " \"meta_load\": 100, \"cost_load\": 100}]}}\n"
+	  << "{\"loads\": {\"rank\": 1, \"stamp\": " << stamp + 1
+	  << ", \"dirfrags\": []}}\n";
+    }
+  }
+};
+
+TEST_F(BalancerSimTest, LoadHistory)
+{
+  write_history(2);
+  BalancerSim sim(make_model(), 0, .1, nullptr);
+  std::vector<BalancerSim::Round> rounds;
+  ASSERT_EQ(0, sim.load_history(history, &rounds));
+  ASSERT_EQ(2u, rounds.size());
+  ASSERT_EQ((std::set<int>{0, 1}), rounds[0].ranks);
+  ASSERT_DOUBLE_EQ(10, rounds[0].stamp);
+  ASSERT_DOUBLE_EQ(100, rounds[0].load.at("/a"));
+  ASSERT_EQ(10u, rounds[0].dentries.at("/b"));
+  ASSERT_EQ(0, rounds[1].auth.at("/"));
+}
+
+TEST_F(BalancerSimTest, Rebalance)
+{
+  write_history(3);
+  BalancerSim sim(make_model(), 0, .1, nullptr);
+  std::vector<BalancerSim::Round> rounds;
+  ASSERT_EQ(0, sim.load_history(history, &rounds));
+  sim.run(rounds);
+
+  // one directory moves to the idle rank and stays there
+  const auto &stats = sim.get_stats();
+  ASSERT_EQ(3u, stats.rounds);
+  ASSERT_EQ(1u, stats.migrations);
+  ASSERT_EQ(0u, stats.bounces);
+  ASSERT_DOUBLE_EQ(2 + 1 + 1, stats.imbalance_sum);
+  ASSERT_DOUBLE_EQ(3 * 2, stats.actual_imbalance_sum);
+}
+
+TEST_F(BalancerSimTest, MigrationCost)
+{
+  write_history(3);
+  BalancerCostModel model = make_model();
+  model.migration_cost = 100;
+  model.migration_dentry_cost = 1;
+  std::vector<BalancerSim::Round> rounds;
+
+  // in mode 3 neither directory carries more than it costs to move
+  BalancerSim sim(model, 3, .1, nullptr);
+  ASSERT_EQ(0, sim.load_history(history, &rounds));
+  sim.run(rounds);
+  ASSERT_EQ(0u, sim.get_stats().migrations);
+
+  // other modes do not weigh the cost
+  BalancerSim sim0(model, 0, .1, nullptr);
+  sim0.run(rounds);
+  ASSERT_EQ(1u, sim0.get_stats().migrations);
+  ASSERT_DOUBLE_EQ(110, sim0.get_stats().migration_cost);
+}
@@ -0,0 +1,83 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include <set>
+
+#include "mds/CompactInodeCache.h"
+
+#include "gtest/gtest.h"
+
+static auto cached_in(const std::set<inodeno_t>& cached)
+{
+  return [&cached](inodeno_t ino) { return cached.count(ino) > 0; };
+}
+
+TEST(CompactInodeCache, Ancestors)
+{
+  CompactInodeCache c;
+  c.set_max_bytes(1 << 20);
+  c.add(0x10000000002, 0x10000000001, "b");
+  c.add(0x10000000001, 1, "a");
+  c.add(0x10000000003, 0x10000000002, "c");
+
+  std::set<inodeno_t> cached = {1};
+  std::vector<inode_backpointer_t> ancestors;
+  ASSERT_TRUE(c.get_ancestors(0x10000000003, ancestors, cached_in(cached)));
+  ASSERT_EQ(3u, ancestors.size());
+  EXPECT_EQ(inodeno_t(0x10000000002), ancestors[0].dirino);
+  EXPECT_EQ("c", ancestors[0].dname);
+  EXPECT_EQ(inodeno_t(0x10000000001), ancestors[1].dirino);
+  EXPECT_EQ("b", ancestors[1].dname);
+  EXPECT_EQ(inodeno_t(1), ancestors[2].dirino);
+  EXPECT_EQ("a", ancestors[2].dname);
+
+  // stops at the nearest cached directory
+  cached.insert(0x10000000001);
+  ASSERT_TRUE(c.get_ancestors(0x10000000003, ancestors, cached_in(cached)));
+  EXPECT_EQ(2u, ancestors.size());
+
+  EXPECT_FALSE(c.get_ancestors(0x10000000004, ancestors, cached_in(cached)));
+  EXPECT_TRUE(ancestors.empty());
+}
+
+TEST(CompactInodeCache, Remove)
+{
+  CompactInodeCache c;
+  c.set_max_bytes(1 << 20);
+  c.add(0x10000000001, 1, "a");
+  c.add(0x10000000001, 1, "renamed");
+  EXPECT_EQ(1u, c.size());
+  EXPECT_EQ(CompactInodeCache::ENTRY_OVERHEAD + 7, c.get_bytes());
+
+  c.remove(0x10000000001);
+  EXPECT_EQ(0u, c.size());
+  EXPECT_EQ(0u, c.get_bytes());
+}
+
+TEST(CompactInodeCache, EvictOldest)
+{
+  CompactInodeCache c;
+  c.set_max_bytes(3 * (CompactInodeCache::ENTRY_OVERHEAD + 1));
+  for (uint64_t i = 0; i < 5; i++)
+    c.add(0x10000000000 + i, 1, "x");
+  EXPECT_EQ(3u, c.size());
+
+  std::set<inodeno_t> cached = {1};
+  std::vector<inode_backpointer_t> ancestors;
+  EXPECT_FALSE(c.get_ancestors(0x10000000001, ancestors, cached_in(cached)));
+  EXPECT_TRUE(c.get_ancestors(0x10000000004, ancestors, cached_in(cached)));
+
+  c.set_max_bytes(0);
+  EXPECT_EQ(0u, c.size());
+  c.add(0x10000000005, 1, "x");
+  EXPECT_EQ(0u, c.size());
+}
@@ -0,0 +1,133 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "msg/async/frames_v2.h"
+
+#include <gtest/gtest.h>
+
+using ceph::msgr::v2::RxDataBufferPool;
+
+static uintptr_t page_offset(const char *p) {
+  return reinterpret_cast<uintptr_t>(p) & ~CEPH_PAGE_MASK;
+}
+
+TEST(RxDataBufferPool, Alignment)
+{
+  RxDataBufferPool pool;
+  const uint32_t len = 3 * CEPH_PAGE_SIZE;
+
+  auto bp = pool.get(len, 0, 0);
+  ASSERT_EQ(len, bp.length());
+  ASSERT_EQ(0u, page_offset(bp.c_str()));
+
+  // the payload starts at the page offset of data_off, so whatever
+  // follows the head is page-aligned
+  for (uint16_t data_off : {100, 4096 + 100, 4095}) {
+    bp = pool.get(len, data_off, 0);
+    ASSERT_EQ(len, bp.length());
+    ASSERT_EQ(data_off & ~CEPH_PAGE_MASK, page_offset(bp.c_str()));
+    const uint32_t head = CEPH_PAGE_SIZE - (data_off & ~CEPH_PAGE_MASK);
+    ASSERT_EQ(0u, page_offset(bp.c_str() + head));
+    // the backing buffer covers the whole tail
+    ASSERT_LE(bp.offset() + len, bp.raw_length());
+    ASSERT_EQ(0u, bp.raw_length() % CEPH_PAGE_SIZE);
+  }
+
+  // a payload shorter than the head fits in the first page
+  bp = pool.get(100, 200, 0);
+  ASSERT_EQ(100u, bp.length());
+  ASSERT_EQ(200u, page_offset(bp.c_str()));
+  ASSERT_EQ(CEPH_PAGE_SIZE, bp.raw_length());
+}
+
+TEST(RxDataBufferPool, Reuse)
+{
+  RxDataBufferPool pool;
+  const uint32_t len = 2 * CEPH_PAGE_SIZE;
+
+  const char *raw;
+  {
+    auto bp = pool.get(len, 0, 1);
+    raw = bp.raw_c_str();
+    ASSERT_EQ(1u, pool.size());
+
+    // still referenced: the next one gets a fresh buffer
+    auto other = pool.get(len, 0, 1);
+    ASSERT_NE(raw, other.raw_c_str());
+    ASSERT_EQ(1u, pool.size());
+  }
+  // once released it is handed out again, whatever the page offset
+  auto bp = pool.get(len, 100, 1);
+  ASSERT_EQ(raw, bp.raw_c_str());
+  ASSERT_EQ(100u, page_offset(bp.c_str()));
+
+  // a copy of the payload (e.g. in a message's data) keeps it busy
+  ceph::bufferlist bl;
+  bl.append(bp);
+  bp = ceph::bufferptr();
+  ASSERT_NE(raw, pool.get(len, 0, 1).raw_c_str());
+  bl.clear();
+  ASSERT_EQ(raw, pool.get(len, 0, 1).raw_c_str());
+}
+
+TEST(RxDataBufferPool, Exhaustion)
+{
+  RxDataBufferPool pool;
+  const uint32_t len = CEPH_PAGE_SIZE;
+
+  auto a = pool.get(len, 0, 2);
+  auto b = pool.get(len, 0, 2);
+  ASSERT_EQ(2u, pool.size());
+  ASSERT_NE(a.raw_c_str(), b.raw_c_str());
+
+  // the pool is full and busy: allocate one that isn't kept
+  const char *c_raw;
+  {
+    auto c = pool.get(len, 0, 2);
+    c_raw = c.raw_c_str();
+    ASSERT_NE(a.raw_c_str(), c_raw);
+    ASSERT_NE(b.raw_c_str(), c_raw);
+    ASSERT_EQ(2u, pool.size());
+  }
+  {
+    auto d = pool.get(len, 0, 2);
+    ASSERT_NE(a.raw_c_str(), d.raw_c_str());
+    ASSERT_NE(b.raw_c_str(), d.raw_c_str());
+    ASSERT_EQ(1, d.raw_nref());
+  }
+
+  const char *a_raw = a.raw_c_str();
+  a = ceph::bufferptr();
+  ASSERT_EQ(a_raw, pool.get(len, 0, 2).raw_c_str());
+}
+
+TEST(RxDataBufferPool, GrowIdle)
+{
+  RxDataBufferPool pool;
+
+  pool.get(CEPH_PAGE_SIZE, 0, 1);
+  ASSERT_EQ(1u, pool.size());
+
+  // an idle buffer too small for the payload is replaced by a bigger one
+  const char *big_raw;
+  {
+    auto big = pool.get(4 * CEPH_PAGE_SIZE, 0, 1);
+    big_raw = big.raw_c_str();
+    // kept in place of the small one
+    ASSERT_EQ(2, big.raw_nref());
+    ASSERT_EQ(1u, pool.size());
+  }
+  ASSERT_EQ(big_raw, pool.get(4 * CEPH_PAGE_SIZE, 0, 1).raw_c_str());
+  // and it serves smaller payloads too
+  ASSERT_EQ(big_raw, pool.get(CEPH_PAGE_SIZE, 0, 1).raw_c_str());
+}
+
+TEST(RxDataBufferPool, Disabled)
+{
+  RxDataBufferPool pool;
+  {
+    auto bp = pool.get(CEPH_PAGE_SIZE, 0, 0);
+    ASSERT_EQ(1, bp.raw_nref());
+  }
+  ASSERT_EQ(0u, pool.size());
+}
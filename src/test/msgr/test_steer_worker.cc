@@ -0,0 +1,84 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "msg/async/Stack.h"
+
+#include <atomic>
+#include <deque>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+// what choose_steered_worker() looks at in a Worker
+struct FakeWorker {
+  int cpu;
+  std::atomic_uint references;
+  FakeWorker(int cpu, unsigned refs) : cpu(cpu), references(refs) {}
+};
+
+class SteerWorker : public ::testing::Test {
+protected:
+  // cpus 0-3 on node 0, 4-7 on node 1, 8 on no known node
+  std::vector<int> cpu_numa_node{0, 0, 0, 0, 1, 1, 1, 1, -1};
+  std::deque<FakeWorker> storage;
+  std::vector<FakeWorker*> workers;
+
+  void add(int cpu, unsigned refs) {
+    storage.emplace_back(cpu, refs);
+    workers.push_back(&storage.back());
+  }
+  int choose(int rx_cpu) const {
+    return NetworkStack::choose_steered_worker(rx_cpu, cpu_numa_node,
+					       workers);
+  }
+};
+
+} // anonymous namespace
+
+TEST_F(SteerWorker, SameCpuFirst)
+{
+  add(0, 0);
+  add(1, 5);
+  add(4, 0);
+  // the worker on the rx cpu wins even when another one on its node
+  // is less loaded
+  ASSERT_EQ(1, choose(1));
+  ASSERT_EQ(2, choose(4));
+}
+
+TEST_F(SteerWorker, LeastLoadedOnNode)
+{
+  add(0, 3);
+  add(4, 0);
+  add(1, 1);
+  add(2, 2);
+  ASSERT_EQ(2, choose(3));
+  workers[2]->references = 7;
+  ASSERT_EQ(3, choose(3));
+  // the other node's idle worker is never picked for node 0
+  ASSERT_EQ(1, choose(5));
+}
+
+TEST_F(SteerWorker, NoMatch)
+{
+  add(0, 0);
+  add(1, 0);
+  // nothing on node 1
+  ASSERT_EQ(-1, choose(6));
+  // rx cpu on no known node, or unknown to the map
+  ASSERT_EQ(-1, choose(8));
+  ASSERT_EQ(-1, choose(100));
+  ASSERT_EQ(-1, choose(-1));
+}
+
+TEST_F(SteerWorker, UnpinnedWorkers)
+{
+  // workers that are not pinned have cpu -1, which is on no node
+  add(-1, 0);
+  add(-1, 0);
+  ASSERT_EQ(-1, choose(0));
+  ASSERT_EQ(-1, choose(-1));
+  add(2, 9);
+  ASSERT_EQ(2, choose(0));
+}
@@ -3310,6 +3310,98 @@ TEST_P(StoreTest, OmapSimple) {
   }
 }
 
+TEST_P(StoreTest, OmapGetRange) {
+  int r;
+  coll_t cid;
+  auto ch = store->create_new_collection(cid);
+  {
+    ObjectStore::Transaction t;
+    t.create_collection(cid, 0);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  ghobject_t hoid(hobject_t(sobject_t("omap_range_obj", CEPH_NOSNAP),
+			    "key", 123, -1, ""));
+  ghobject_t hoid2(hobject_t(sobject_t("omap_range_none", CEPH_NOSNAP),
+			     "key", 124, -1, ""));
+  map<string,bufferlist> km;
+  for (auto& k : {"a1", "a2", "a3", "b1", "b2", "c1"}) {
+    km[k].append(string("value_") + k);
+  }
+  {
+    ObjectStore::Transaction t;
+    t.touch(cid, hoid);
+    t.omap_setkeys(cid, hoid, km);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  {
+    map<string,bufferlist> out;
+    bool more = true;
+    r = store->omap_get_range(ch, hoid, string(), string(), 100, 1 << 20,
+			      &out, &more);
+    ASSERT_EQ(r, 0);
+    ASSERT_EQ(out.size(), km.size());
+    ASSERT_FALSE(more);
+    for (auto& [k, v] : km) {
+      ASSERT_TRUE(bl_eq(v, out[k]));
+    }
+  }
+  {
+    map<string,bufferlist> out;
+    bool more = false;
+    r = store->omap_get_range(ch, hoid, "a1", string(), 2, 1 << 20,
+			      &out, &more);
+    ASSERT_EQ(r, 0);
+    ASSERT_EQ(out.size(), 2u);
+    ASSERT_EQ(out.begin()->first, "a2");
+    ASSERT_EQ(out.rbegin()->first, "a3");
+    ASSERT_TRUE(more);
+  }
+  {
+    map<string,bufferlist> out;
+    bool more = true;
+    r = store->omap_get_range(ch, hoid, string(), "b", 100, 1 << 20,
+			      &out, &more);
+    ASSERT_EQ(r, 0);
+    ASSERT_EQ(out.size(), 2u);
+    ASSERT_EQ(out.begin()->first, "b1");
+    ASSERT_FALSE(more);
+
+    out.clear();
+    r = store->omap_get_range(ch, hoid, "b1", "b", 100, 1 << 20,
+			      &out, &more);
+    ASSERT_EQ(r, 0);
+    ASSERT_EQ(out.size(), 1u);
+    ASSERT_EQ(out.begin()->first, "b2");
+    ASSERT_FALSE(more);
+  }
+  {
+    // byte limit is checked before each entry, so one always fits
+    map<string,bufferlist> out;
+    bool more = false;
+    r = store->omap_get_range(ch, hoid, string(), string(), 100, 1,
+			      &out, &more);
+    ASSERT_EQ(r, 0);
+    ASSERT_EQ(out.size(), 1u);
+    ASSERT_TRUE(more);
+  }
+  {
+    map<string,bufferlist> out;
+    bool more = false;
+    r = store->omap_get_range(ch, hoid2, string(), string(), 100, 1 << 20,
+			      &out, &more);
+    ASSERT_EQ(r, -ENOENT);
+  }
+  {
+    ObjectStore::Transaction t;
+    t.remove(cid, hoid);
+    t.remove_collection(cid);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+}
+
 TEST_P(StoreTest, OmapCloneTest) {
   int r;
   coll_t cid;
@@ -6408,6 +6500,70 @@ TEST_P(StoreTestSpecificAUSize, OnodeSizeTracking) {
   }
 }
 
+TEST_P(StoreTestSpecificAUSize, ClockOnodeCache) {
+
+  if (string(GetParam()) != "bluestore")
+    return;
+
+  SetVal(g_conf(), "bluestore_onode_cache_type", "clock");
+  // small cache so that the clock hand actually evicts onodes
+  SetVal(g_conf(), "bluestore_cache_autotune", "false");
+  SetVal(g_conf(), "bluestore_cache_size", "1000000");
+  StartDeferred(0);
+
+  int r;
+  coll_t cid;
+  auto ch = store->create_new_collection(cid);
+  {
+    ObjectStore::Transaction t;
+    t.create_collection(cid, 0);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  const unsigned num_objs = 2000;
+  auto make_oid = [](unsigned i) {
+    return ghobject_t(hobject_t("obj_" + stringify(i), "", CEPH_NOSNAP,
+				i, 0, ""));
+  };
+  for (unsigned i = 0; i < num_objs; ++i) {
+    ObjectStore::Transaction t;
+    bufferlist bl;
+    bl.append(stringify(i));
+    t.write(cid, make_oid(i), 0, bl.length(), bl);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  // rename every other object on top of its neighbour
+  for (unsigned i = 0; i < num_objs; i += 2) {
+    ObjectStore::Transaction t;
+    t.collection_move_rename(cid, make_oid(i), cid, make_oid(i + 1));
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  // read everything twice so that hits and evictions interleave
+  for (unsigned pass = 0; pass < 2; ++pass) {
+    for (unsigned i = 0; i < num_objs; ++i) {
+      bufferlist bl;
+      r = store->read(ch, make_oid(i), 0, 100, bl);
+      if (i % 2 == 0) {
+	ASSERT_EQ(r, -ENOENT);
+      } else {
+	ASSERT_EQ(r, (int)stringify(i - 1).length());
+	ASSERT_EQ(string(bl.c_str(), bl.length()), stringify(i - 1));
+      }
+    }
+  }
+  {
+    ObjectStore::Transaction t;
+    for (unsigned i = 1; i < num_objs; i += 2) {
+      t.remove(cid, make_oid(i));
+    }
+    t.remove_collection(cid);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+}
+
 TEST_P(StoreTestSpecificAUSize, BlobReuseOnOverwrite) {
 
   if (string(GetParam()) != "bluestore")
@@ -7988,6 +8144,152 @@ TEST_P(StoreTestSpecificAUSize, ReproNoBlobMultiTest) {
   }
 }
 
+static void write_alloc_snapshot_objects(ObjectStore *store,
+                                         ObjectStore::CollectionHandle& ch,
+                                         coll_t cid, int first, int count)
+{
+  bufferlist bl;
+  bl.append(std::string(0x30000, 'a'));
+  for (int i = first; i < first + count; ++i) {
+    ObjectStore::Transaction t;
+    t.write(cid, make_object(stringify(i).c_str(), 0), 0, bl.length(), bl);
+    // free some of what the previous objects used
+    if (i > first) {
+      t.zero(cid, make_object(stringify(i - 1).c_str(), 0), 0x10000,
+             0x10000);
+    }
+    int r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+}
+
+TEST_P(StoreTestSpecificAUSize, BluestoreAllocSnapshotCleanUmount) {
+  if (string(GetParam()) != "bluestore")
+    return;
+  SetVal(g_conf(), "bluestore_alloc_snapshot", "true");
+  SetVal(g_conf(), "bluestore_fsck_on_mount", "false");
+  SetVal(g_conf(), "bluestore_fsck_on_umount", "false");
+  StartDeferred(0x10000);
+  BlueStore* bstore = dynamic_cast<BlueStore*> (store.get());
+
+  coll_t cid(spg_t(pg_t(0, 0), shard_id_t::NO_SHARD));
+  auto ch = store->create_new_collection(cid);
+  {
+    ObjectStore::Transaction t;
+    t.create_collection(cid, 0);
+    ASSERT_EQ(queue_transaction(store, ch, std::move(t)), 0);
+  }
+  write_alloc_snapshot_objects(store.get(), ch, cid, 0, 8);
+
+  ch.reset();
+  bstore->umount();
+  ASSERT_EQ(bstore->mount(), 0);
+  ASSERT_TRUE(bstore->is_alloc_snapshot_loaded());
+
+  // allocations made from the loaded state must not collide
+  ch = store->open_collection(cid);
+  write_alloc_snapshot_objects(store.get(), ch, cid, 8, 8);
+  ch.reset();
+  bstore->umount();
+  ASSERT_EQ(bstore->fsck(false), 0);
+  ASSERT_EQ(bstore->mount(), 0);
+  ASSERT_TRUE(bstore->is_alloc_snapshot_loaded());
+}
+
+TEST_P(StoreTestSpecificAUSize, BluestoreAllocSnapshotCrash) {
+  if (string(GetParam()) != "bluestore")
+    return;
+  SetVal(g_conf(), "bluestore_alloc_snapshot", "true");
+  SetVal(g_conf(), "bluestore_fsck_on_mount", "false");
+  SetVal(g_conf(), "bluestore_fsck_on_umount", "false");
+  StartDeferred(0x10000);
+  BlueStore* bstore = dynamic_cast<BlueStore*> (store.get());
+
+  coll_t cid(spg_t(pg_t(0, 0), shard_id_t::NO_SHARD));
+  auto ch = store->create_new_collection(cid);
+  {
+    ObjectStore::Transaction t;
+    t.create_collection(cid, 0);
+    ASSERT_EQ(queue_transaction(store, ch, std::move(t)), 0);
+  }
+  ch.reset();
+  bstore->umount();
+  ASSERT_EQ(bstore->mount(), 0);
+  ASSERT_TRUE(bstore->is_alloc_snapshot_loaded());
+
+  // change the freelist, then go down without taking a new snapshot, as
+  // a crash would
+  ch = store->open_collection(cid);
+  write_alloc_snapshot_objects(store.get(), ch, cid, 0, 8);
+  ch.reset();
+  SetVal(g_conf(), "bluestore_alloc_snapshot", "false");
+  bstore->umount();
+  SetVal(g_conf(), "bluestore_alloc_snapshot", "true");
+
+  // the snapshot taken before the writes is gone
+  ASSERT_EQ(bstore->mount(), 0);
+  ASSERT_FALSE(bstore->is_alloc_snapshot_loaded());
+  ch = store->open_collection(cid);
+  write_alloc_snapshot_objects(store.get(), ch, cid, 8, 8);
+  ch.reset();
+  bstore->umount();
+  ASSERT_EQ(bstore->fsck(false), 0);
+  ASSERT_EQ(bstore->mount(), 0);
+}
+
+TEST_P(StoreTestSpecificAUSize, BluestoreAllocSnapshotStaleGeneration) {
+  if (string(GetParam()) != "bluestore")
+    return;
+  SetVal(g_conf(), "bluestore_alloc_snapshot", "true");
+  SetVal(g_conf(), "bluestore_fsck_on_mount", "false");
+  SetVal(g_conf(), "bluestore_fsck_on_umount", "false");
+  StartDeferred(0x10000);
+  BlueStore* bstore = dynamic_cast<BlueStore*> (store.get());
+
+  coll_t cid(spg_t(pg_t(0, 0), shard_id_t::NO_SHARD));
+  auto ch = store->create_new_collection(cid);
+  {
+    ObjectStore::Transaction t;
+    t.create_collection(cid, 0);
+    ASSERT_EQ(queue_transaction(store, ch, std::move(t)), 0);
+  }
+  write_alloc_snapshot_objects(store.get(), ch, cid, 0, 8);
+  ch.reset();
+  bstore->umount();
+
+  {
+    // a kv-only open may change the freelist, so it drops the snapshot
+    KeyValueDB *db = nullptr;
+    ASSERT_EQ(bstore->start_kv_only(&db, false), 0);
+    bufferlist bl;
+    ASSERT_LT(db->get("A", "header", &bl), 0);
+    ASSERT_EQ(db->get("S", "freelist_gen", &bl), 0);
+    uint64_t gen;
+    auto p = bl.cbegin();
+    decode(gen, p);
+
+    // put back a header from before that open, as a restored backup of
+    // the kv store would
+    bluestore_alloc_snapshot_t h;
+    h.freelist_gen = gen - 1;
+    bl.clear();
+    encode(h, bl);
+    KeyValueDB::Transaction t = db->get_transaction();
+    t->set("A", "header", bl);
+    ASSERT_EQ(db->submit_transaction_sync(t), 0);
+    bstore->umount();
+  }
+
+  ASSERT_EQ(bstore->mount(), 0);
+  ASSERT_FALSE(bstore->is_alloc_snapshot_loaded());
+  ch = store->open_collection(cid);
+  write_alloc_snapshot_objects(store.get(), ch, cid, 8, 8);
+  ch.reset();
+  bstore->umount();
+  ASSERT_EQ(bstore->fsck(false), 0);
+  ASSERT_EQ(bstore->mount(), 0);
+}
+
 #endif  // WITH_BLUESTORE
 
 int main(int argc, char **argv) {
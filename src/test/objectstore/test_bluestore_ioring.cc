@@ -0,0 +1,126 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <list>
+#include <set>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "include/buffer.h"
+#include "os/bluestore/io_uring.h"
+
+class IoRingTest : public ::testing::Test {
+protected:
+  static constexpr unsigned iodepth = 16;
+
+  ioring_queue_t queue{iodepth, false};
+  std::vector<int> fds;
+  bool initialized = false;
+
+  void SetUp() override {
+    if (!ioring_queue_t::supported())
+      GTEST_SKIP() << "io_uring is not supported by this kernel";
+    char path[] = "unittest_bluestore_ioring.XXXXXX";
+    int fd = ::mkstemp(path);
+    ASSERT_LE(0, fd);
+    ::unlink(path);
+    fds.push_back(fd);
+    ASSERT_EQ(0, queue.init(fds));
+    initialized = true;
+  }
+
+  void TearDown() override {
+    if (initialized)
+      queue.shutdown();
+    for (auto fd : fds)
+      ::close(fd);
+  }
+
+  void submit(std::list<aio_t>& aios) {
+    int retries = 0;
+    int r = queue.submit_batch(aios.begin(), aios.end(), aios.size(),
+			       this, &retries);
+    ASSERT_EQ((int)aios.size(), r);
+  }
+
+  void reap(size_t n, std::set<aio_t*>* done) {
+    aio_t *paio[iodepth];
+    for (int tries = 0; done->size() < n && tries < 100; ++tries) {
+      int r = queue.get_next_completed(100, paio, iodepth);
+      ASSERT_LE(0, r);
+      for (int i = 0; i < r; ++i) {
+	ASSERT_EQ(this, paio[i]->priv);
+	ASSERT_TRUE(done->insert(paio[i]).second);
+      }
+    }
+    ASSERT_EQ(n, done->size());
+  }
+};
+
+TEST_F(IoRingTest, WriteThenRead)
+{
+  const unsigned n = 8;
+  const unsigned len = 4096;
+
+  std::list<aio_t> writes;
+  for (unsigned i = 0; i < n; ++i) {
+    writes.emplace_back(nullptr, fds[0]);
+    aio_t& aio = writes.back();
+    aio.bl.append(std::string(len, 'a' + i));
+    aio.bl.prepare_iov(&aio.iov);
+    aio.pwritev(i * len, len);
+  }
+  ASSERT_NO_FATAL_FAILURE(submit(writes));
+  std::set<aio_t*> done;
+  ASSERT_NO_FATAL_FAILURE(reap(n, &done));
+  for (auto& aio : writes) {
+    ASSERT_EQ(1u, done.count(&aio));
+    ASSERT_EQ((long)len, aio.get_return_value());
+  }
+
+  // read back in reverse order, in two iovecs each
+  std::list<aio_t> reads;
+  for (unsigned i = n; i-- > 0; ) {
+    reads.emplace_back(nullptr, fds[0]);
+    aio_t& aio = reads.back();
+    aio.bl.append(ceph::buffer::create(len / 2));
+    aio.bl.append(ceph::buffer::create(len / 2));
+    aio.bl.prepare_iov(&aio.iov);
+    ASSERT_EQ(2u, aio.iov.size());
+    aio.preadv(i * len, len);
+  }
+  ASSERT_NO_FATAL_FAILURE(submit(reads));
+  done.clear();
+  ASSERT_NO_FATAL_FAILURE(reap(n, &done));
+  unsigned i = n;
+  for (auto& aio : reads) {
+    --i;
+    ASSERT_EQ(1u, done.count(&aio));
+    ASSERT_EQ((long)len, aio.get_return_value());
+    ASSERT_EQ(std::string(len, 'a' + i), aio.bl.to_str());
+  }
+}
+
+TEST_F(IoRingTest, ReadPastEnd)
+{
+  std::list<aio_t> reads;
+  reads.emplace_back(nullptr, fds[0]);
+  aio_t& aio = reads.back();
+  aio.bl.append(ceph::buffer::create(4096));
+  aio.bl.prepare_iov(&aio.iov);
+  aio.preadv(1 << 20, 4096);
+  ASSERT_NO_FATAL_FAILURE(submit(reads));
+  std::set<aio_t*> done;
+  ASSERT_NO_FATAL_FAILURE(reap(1, &done));
+  ASSERT_EQ(0, aio.get_return_value());
+}
+
+TEST_F(IoRingTest, NothingCompleted)
+{
+  aio_t *paio[iodepth];
+  ASSERT_EQ(0, queue.get_next_completed(10, paio, iodepth));
+}
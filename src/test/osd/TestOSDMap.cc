@@ -295,6 +295,43 @@ TEST_F(OSDMapTest, MapFunctionsMatch) {
   EXPECT_EQ(acting_osds, acting_osds_two);
 }
 
+TEST_F(OSDMapTest, MapPGRange) {
+  set_up_map();
+
+  // pg_temp on one pg must be honored by the batched mapping as well
+  pg_t temp_pgid = osdmap.raw_pg_to_pg(pg_t(3, my_rep_pool));
+  vector<int> up_osds, acting_osds;
+  int up_primary, acting_primary;
+  osdmap.pg_to_up_acting_osds(temp_pgid, &up_osds, &up_primary,
+                              &acting_osds, &acting_primary);
+  OSDMap::Incremental pgtemp_map(osdmap.get_epoch() + 1);
+  pgtemp_map.new_pg_temp[temp_pgid] = mempool::osdmap::vector<int>(
+    acting_osds.rbegin(), acting_osds.rend());
+  osdmap.apply_incremental(pgtemp_map);
+
+  for (int64_t pool : {my_rep_pool, my_ec_pool}) {
+    unsigned pg_num = osdmap.get_pg_pool(pool)->get_pg_num();
+    unsigned count = 0;
+    osdmap.pg_range_to_up_acting_osds(
+      pool, 0, pg_num,
+      [&](unsigned ps,
+          vector<int>&& up, int up_primary,
+          vector<int>&& acting, int acting_primary) {
+        ASSERT_EQ(count++, ps);
+        vector<int> up_osds, acting_osds;
+        int up_primary_two, acting_primary_two;
+        osdmap.pg_to_up_acting_osds(pg_t(ps, pool),
+                                    &up_osds, &up_primary_two,
+                                    &acting_osds, &acting_primary_two);
+        EXPECT_EQ(up_osds, up);
+        EXPECT_EQ(up_primary_two, up_primary);
+        EXPECT_EQ(acting_osds, acting);
+        EXPECT_EQ(acting_primary_two, acting_primary);
+      });
+    EXPECT_EQ(pg_num, count);
+  }
+}
+
 /** This test must be removed or modified appropriately when we allow
  * other ways to specify a primary. */
 TEST_F(OSDMapTest, PrimaryIsFirst) {
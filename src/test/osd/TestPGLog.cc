@@ -21,10 +21,12 @@
 
 #include <stdio.h>
 #include <signal.h>
+#include <numeric>
 #include "gtest/gtest.h"
 #include "osd/PGLog.h"
 #include "osd/OSDMap.h"
 #include "include/coredumpctl.h"
+#include "common/load_concurrently.h"
 #include "../objectstore/store_test_fixture.h"
 
 
@@ -3243,6 +3245,98 @@ TEST_F(PGLogTrimTest, TestCopyAfter2) {
   EXPECT_EQ(7u, copy.dups.size()) << copy;
 }
 
+// OSD::load_pgs() reads the logs of many PGs at once from loader threads
+class PGLogConcurrentLoadTest : public StoreTestFixture, public PGLogTestBase {
+public:
+  static constexpr int num_pgs = 16;
+  static constexpr unsigned num_entries = 50;
+
+  struct Loaded {
+    PGLog::IndexedLog log;
+    pg_missing_tracker_t missing;
+  };
+
+  std::vector<spg_t> pgids;
+
+  PGLogConcurrentLoadTest() : StoreTestFixture("memstore") {}
+
+  void SetUp() override {
+    StoreTestFixture::SetUp();
+    for (int pg = 0; pg < num_pgs; ++pg) {
+      spg_t pgid(pg_t(pg, 1));
+      coll_t coll(pgid);
+      auto ch = store->create_new_collection(coll);
+      ObjectStore::Transaction t;
+      t.create_collection(coll, 0);
+      pg_log_t log;
+      pg_missing_tracker_t missing;
+      build(pg, &log, &missing);
+      map<string, bufferlist> km;
+      bool may_include_deletes_in_missing_dirty = false;
+      PGLog::write_log_and_missing(t, &km, log, coll, pgid.make_pgmeta_oid(),
+				   missing, false,
+				   &may_include_deletes_in_missing_dirty);
+      t.omap_setkeys(coll, pgid.make_pgmeta_oid(), km);
+      ASSERT_EQ(0, store->queue_transaction(ch, std::move(t)));
+      pgids.push_back(pgid);
+    }
+  }
+
+  // a log, dups and missing set that differ for each pg
+  static void build(int pg, pg_log_t *log, pg_missing_tracker_t *missing) {
+    for (unsigned i = 1; i <= num_entries; ++i) {
+      osd_reqid_t reqid(entity_name_t::CLIENT(pg), 0, i);
+      log->log.push_back(mk_ple_mod(mk_obj(pg * 1000 + i), mk_evt(10, i),
+				    mk_evt(9, i), reqid));
+      log->dups.push_back(pg_log_dup_t(mk_evt(5, i), i, reqid, 0));
+    }
+    log->head = mk_evt(10, num_entries);
+    missing->add(mk_obj(pg * 1000 + 1), mk_evt(10, 1), mk_evt(9, 1), false);
+  }
+
+  void verify(int pg, const Loaded& loaded) {
+    pg_log_t log;
+    pg_missing_tracker_t missing;
+    build(pg, &log, &missing);
+
+    ASSERT_EQ(log.log.size(), loaded.log.log.size());
+    auto e = loaded.log.log.begin();
+    for (auto& expected : log.log) {
+      ASSERT_EQ(expected.soid, e->soid);
+      ASSERT_EQ(expected.version, e->version);
+      ASSERT_EQ(expected.reqid, e->reqid);
+      ++e;
+    }
+    ASSERT_EQ(log.dups, loaded.log.dups);
+    ASSERT_EQ(missing.get_items(), loaded.missing.get_items());
+  }
+};
+
+TEST_F(PGLogConcurrentLoadTest, ReadLogs) {
+  std::vector<int> pgs(num_pgs);
+  std::iota(pgs.begin(), pgs.end(), 0);
+  std::vector<Loaded> loaded(num_pgs);
+  std::set<int> done;
+
+  ceph::load_concurrently(
+    "test_load_pgs", pgs, 8,
+    [&](int pg) {
+      auto ch = store->open_collection(coll_t(pgids[pg]));
+      pg_info_t info(pgids[pg]);
+      info.last_update = mk_evt(10, num_entries);
+      ostringstream err;
+      PGLog::read_log_and_missing(store.get(), ch,
+				  pgids[pg].make_pgmeta_oid(), info,
+				  loaded[pg].log, loaded[pg].missing,
+				  err, false);
+    },
+    [&](int pg) {
+      ASSERT_TRUE(done.insert(pg).second);
+      verify(pg, loaded[pg]);
+    });
+  ASSERT_EQ(size_t(num_pgs), done.size());
+}
+
 // Local Variables:
 // compile-command: "cd ../.. ; make unittest_pglog ; ./unittest_pglog --log-to-stderr=true  --debug-osd=20 # --gtest_filter=*.* "
 // End:
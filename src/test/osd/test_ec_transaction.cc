@@ -15,6 +15,7 @@
 #include <gtest/gtest.h>
 #include "osd/PGTransaction.h"
 #include "osd/ECTransaction.h"
+#include "erasure-code/ErasureCode.h"
 
 #include "test/unit.cc"
 
@@ -122,3 +123,189 @@ TEST(ectransaction, many_writes)
   ASSERT_EQ(0u, plan.to_read.size());
   ASSERT_EQ(1u, plan.will_write.size());
 }
+
+// k data chunks and a single coding chunk, their xor
+class XorCode : public ceph::ErasureCode {
+public:
+  XorCode(unsigned k, bool parity_delta)
+    : k(k), parity_delta(parity_delta) {}
+
+  unsigned int get_chunk_count() const override {
+    return k + 1;
+  }
+  unsigned int get_data_chunk_count() const override {
+    return k;
+  }
+  unsigned int get_chunk_size(unsigned int object_size) const override {
+    return (object_size + k - 1) / k;
+  }
+  int encode_chunks(const set<int> &want_to_encode,
+		    map<int, bufferlist> *encoded) override {
+    char *parity = (*encoded)[k].c_str();
+    unsigned len = (*encoded)[k].length();
+    memset(parity, 0, len);
+    for (unsigned i = 0; i < k; ++i) {
+      const char *data = (*encoded)[i].c_str();
+      for (unsigned j = 0; j < len; ++j)
+	parity[j] ^= data[j];
+    }
+    return 0;
+  }
+  uint64_t get_supported_optimizations() const override {
+    return parity_delta ?
+      FLAG_EC_PLUGIN_PARITY_DELTA_OPTIMIZATION : 0;
+  }
+  int apply_delta(const map<int, bufferlist> &deltas,
+		  map<int, bufferlist> *parity) override {
+    char *p = (*parity)[k].c_str();
+    for (auto &&i : deltas) {
+      bufferlist delta = i.second;
+      const char *d = delta.c_str();
+      for (unsigned j = 0; j < delta.length(); ++j)
+	p[j] ^= d[j];
+    }
+    return 0;
+  }
+
+private:
+  unsigned k;
+  bool parity_delta;
+};
+
+static ECTransaction::WritePlan plan_overwrite(
+  const ECUtil::stripe_info_t &sinfo,
+  ErasureCodeInterfaceRef &ec_impl,
+  uint64_t object_size,
+  uint64_t off,
+  uint64_t len)
+{
+  hobject_t h;
+  PGTransactionUPtr t(new PGTransaction);
+  bufferlist bl;
+  bl.append(std::string(len, 'x'));
+  t->write(h, off, len, bl, 0);
+
+  ECUtil::HashInfoRef hinfo(new ECUtil::HashInfo(ec_impl->get_chunk_count()));
+  hinfo->set_projected_total_logical_size(sinfo, object_size);
+  auto plan = ECTransaction::get_write_plan(
+    sinfo,
+    std::move(t),
+    [&](const hobject_t &i) {
+      return hinfo;
+    },
+    &dpp);
+  ECTransaction::plan_parity_delta(sinfo, ec_impl, plan);
+  return plan;
+}
+
+TEST(ectransaction, plan_parity_delta_small_overwrite)
+{
+  ErasureCodeInterfaceRef ec_impl(new XorCode(4, true));
+  ECUtil::stripe_info_t sinfo(4, 4 * 4096);
+
+  // 512 bytes in the first chunk of the second stripe
+  auto plan = plan_overwrite(sinfo, ec_impl, 4 * 16384, 16384 + 100, 512);
+  ASSERT_EQ(1u, plan.to_read.size());
+  ASSERT_EQ(1u, plan.parity_delta_reads.size());
+  ASSERT_EQ((set<int>{0, 4}), plan.parity_delta_reads.begin()->second);
+
+  // crossing into the next chunk reads both
+  plan = plan_overwrite(sinfo, ec_impl, 4 * 16384, 16384 + 4000, 512);
+  ASSERT_EQ(1u, plan.parity_delta_reads.size());
+  ASSERT_EQ((set<int>{0, 1, 4}), plan.parity_delta_reads.begin()->second);
+}
+
+TEST(ectransaction, plan_parity_delta_not_worth_it)
+{
+  ErasureCodeInterfaceRef ec_impl(new XorCode(4, true));
+  ECUtil::stripe_info_t sinfo(4, 4 * 4096);
+
+  // three of the four data chunks plus the parity: the whole stripe is
+  // no more to read
+  auto plan = plan_overwrite(sinfo, ec_impl, 4 * 16384, 16384 + 100, 8192);
+  ASSERT_EQ(1u, plan.to_read.size());
+  ASSERT_TRUE(plan.parity_delta_reads.empty());
+}
+
+TEST(ectransaction, plan_parity_delta_unsupported)
+{
+  ECUtil::stripe_info_t sinfo(4, 4 * 4096);
+
+  // the plugin can't do it
+  ErasureCodeInterfaceRef no_delta(new XorCode(4, false));
+  auto plan = plan_overwrite(sinfo, no_delta, 4 * 16384, 16384 + 100, 512);
+  ASSERT_EQ(1u, plan.to_read.size());
+  ASSERT_TRUE(plan.parity_delta_reads.empty());
+
+  // nothing is overwritten when appending
+  ErasureCodeInterfaceRef ec_impl(new XorCode(4, true));
+  plan = plan_overwrite(sinfo, ec_impl, 16384, 16384 + 100, 512);
+  ASSERT_TRUE(plan.to_read.empty());
+  ASSERT_TRUE(plan.parity_delta_reads.empty());
+}
+
+static map<uint64_t, bufferlist> get_writes(ObjectStore::Transaction &t)
+{
+  map<uint64_t, bufferlist> writes;
+  auto i = t.begin();
+  while (i.have_op()) {
+    auto op = i.decode_op();
+    if (op->op == ObjectStore::Transaction::OP_WRITE) {
+      bufferlist bl;
+      i.decode_bl(bl);
+      EXPECT_EQ(op->len, bl.length());
+      writes[op->off] = bl;
+    }
+  }
+  return writes;
+}
+
+TEST(ectransaction, encode_and_write_parity_delta)
+{
+  ErasureCodeInterfaceRef ec_impl(new XorCode(2, true));
+  ECUtil::stripe_info_t sinfo(2, 2 * 4096);
+  hobject_t h;
+
+  // the second stripe of the object, a..., b..., and their xor
+  std::string a(4096, 'a'), b(4096, 'b'), parity(4096, 'a' ^ 'b');
+  map<int, bufferlist> old_shards;
+  old_shards[0].append(a);
+  old_shards[2].append(parity);
+
+  // overwrite 200 bytes of the first chunk
+  bufferlist c;
+  c.append(std::string(200, 'c'));
+  extent_map new_data;
+  new_data.insert(8192 + 100, c.length(), c);
+
+  map<shard_id_t, ObjectStore::Transaction> transactions;
+  for (int i = 0; i < 3; ++i)
+    transactions[shard_id_t(i)];
+  ECTransaction::encode_and_write_parity_delta(
+    pg_t(), h, sinfo, ec_impl, 8192, old_shards, new_data, 0,
+    &transactions, &dpp);
+
+  std::string new_a = a;
+  new_a.replace(100, 200, std::string(200, 'c'));
+  std::string new_parity = parity;
+  for (unsigned i = 100; i < 300; ++i)
+    new_parity[i] = 'c' ^ 'b';
+
+  // only the shards that were read are written, at the chunk offset of
+  // the stripe
+  auto writes = get_writes(transactions[shard_id_t(0)]);
+  ASSERT_EQ(1u, writes.size());
+  ASSERT_EQ(4096u, writes.begin()->first);
+  ASSERT_EQ(new_a, writes.begin()->second.to_str());
+
+  ASSERT_TRUE(get_writes(transactions[shard_id_t(1)]).empty());
+
+  writes = get_writes(transactions[shard_id_t(2)]);
+  ASSERT_EQ(1u, writes.size());
+  ASSERT_EQ(4096u, writes.begin()->first);
+  ASSERT_EQ(new_parity, writes.begin()->second.to_str());
+
+  // the old shard contents given are left alone
+  ASSERT_EQ(a, old_shards[0].to_str());
+  ASSERT_EQ(parity, old_shards[2].to_str());
+}
@@ -0,0 +1,216 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+/*
+ * Measure how client op throughput through a single Objecter scales
+ * with the number of submitting threads.
+ *
+ * All threads share one librados handle (and so one Objecter); each
+ * keeps --queue-depth small ops in flight against a fixed set of
+ * objects.  Thread counts are swept 1, 2, 4, ... --threads: if the
+ * Objecter serializes submission or completion, ops/sec flattens long
+ * before the OSDs are saturated.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common/ceph_argparse.h"
+#include "common/common_init.h"
+#include "common/config.h"
+#include "common/debug.h"
+#include "common/errno.h"
+#include "global/global_init.h"
+#include "include/rados/librados.hpp"
+#include "include/stringify.h"
+
+static void usage()
+{
+  std::cerr << "usage: ceph_test_objecter_contention [options]\n"
+	    << "  --pool <name>        pool to use (default objecter_contention)\n"
+	    << "  --threads <n>        max submitting threads; runs 1,2,4..n (default 32)\n"
+	    << "  --queue-depth <n>    ops in flight per thread (default 16)\n"
+	    << "  --objects <n>        objects to spread ops over (default 256)\n"
+	    << "  --seconds <n>        duration of each run (default 10)\n"
+	    << "  --write              issue 4k writes instead of stats\n"
+	    << std::endl;
+}
+
+static std::string obj_name(int i)
+{
+  return "objecter_contention_" + stringify(i);
+}
+
+static uint64_t run(librados::IoCtx& ioctx, int num_threads, int queue_depth,
+		    int num_objects, int seconds, bool write)
+{
+  std::atomic<bool> stop = { false };
+  std::atomic<uint64_t> completed = { 0 };
+  std::atomic<int> errors = { 0 };
+  ceph::bufferlist data;
+  data.append(std::string(4096, 'x'));
+
+  auto worker = [&](int id) {
+    struct inflight_t {
+      librados::AioCompletion *c;
+      uint64_t size = 0;
+      time_t mtime = 0;
+    };
+    std::deque<inflight_t> inflight;
+    uint64_t n = 0;
+    uint64_t done = 0;
+    auto submit = [&] {
+      inflight.push_back({librados::Rados::aio_create_completion()});
+      auto& op = inflight.back();
+      std::string oid = obj_name((id * 7919 + n++) % num_objects);
+      if (write) {
+	ioctx.aio_write(oid, op.c, data, data.length(), 0);
+      } else {
+	ioctx.aio_stat(oid, op.c, &op.size, &op.mtime);
+      }
+    };
+    while (!stop) {
+      while ((int)inflight.size() < queue_depth) {
+	submit();
+      }
+      auto& op = inflight.front();
+      op.c->wait_for_complete();
+      if (op.c->get_return_value() < 0) {
+	++errors;
+      }
+      op.c->release();
+      inflight.pop_front();
+      ++done;
+    }
+    for (auto& op : inflight) {
+      op.c->wait_for_complete();
+      op.c->release();
+    }
+    completed += done;
+  };
+
+  std::vector<std::thread> threads;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < num_threads; ++i) {
+    threads.emplace_back(worker, i);
+  }
+  std::this_thread::sleep_for(std::chrono::seconds(seconds));
+  stop = true;
+  for (auto& t : threads) {
+    t.join();
+  }
+  std::chrono::duration<double> elapsed =
+    std::chrono::steady_clock::now() - start;
+  if (errors) {
+    std::cerr << "  " << errors << " ops failed" << std::endl;
+  }
+  return completed / elapsed.count();
+}
+
+int main(int argc, const char **argv)
+{
+  std::vector<const char*> args;
+  argv_to_vec(argc, argv, args);
+  auto cct = global_init(NULL, args, CEPH_ENTITY_TYPE_CLIENT,
+			 CODE_ENVIRONMENT_UTILITY,
+			 CINIT_FLAG_NO_DEFAULT_CONFIG_FILE);
+  common_init_finish(g_ceph_context);
+
+  std::string pool_name = "objecter_contention";
+  int max_threads = 32;
+  int queue_depth = 16;
+  int num_objects = 256;
+  int seconds = 10;
+  bool write = false;
+  std::string val;
+  std::ostringstream err;
+  for (auto i = args.begin(); i != args.end(); ) {
+    if (ceph_argparse_double_dash(args, i)) {
+      break;
+    } else if (ceph_argparse_witharg(args, i, &val, "--pool", (char*)NULL)) {
+      pool_name = val;
+    } else if (ceph_argparse_witharg(args, i, &max_threads, err,
+				     "--threads", (char*)NULL) ||
+	       ceph_argparse_witharg(args, i, &queue_depth, err,
+				     "--queue-depth", (char*)NULL) ||
+	       ceph_argparse_witharg(args, i, &num_objects, err,
+				     "--objects", (char*)NULL) ||
+	       ceph_argparse_witharg(args, i, &seconds, err,
+				     "--seconds", (char*)NULL)) {
+      if (!err.str().empty()) {
+	std::cerr << argv[0] << ": " << err.str() << std::endl;
+	return EXIT_FAILURE;
+      }
+    } else if (ceph_argparse_flag(args, i, "--write", (char*)NULL)) {
+      write = true;
+    } else {
+      std::cerr << "unknown option " << *i << std::endl;
+      usage();
+      return EXIT_FAILURE;
+    }
+  }
+  if (max_threads < 1 || queue_depth < 1 || num_objects < 1 || seconds < 1) {
+    usage();
+    return EXIT_FAILURE;
+  }
+
+  librados::Rados rados;
+  if (rados.init_with_context(g_ceph_context) < 0 ||
+      rados.conf_read_file(NULL) < 0 ||
+      rados.connect() < 0) {
+    std::cerr << "couldn't connect to cluster" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (rados.pool_lookup(pool_name.c_str()) < 0) {
+    int r = rados.pool_create(pool_name.c_str());
+    if (r < 0 && r != -EEXIST) {
+      std::cerr << "failed to create pool " << pool_name << ": "
+		<< cpp_strerror(r) << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+  librados::IoCtx ioctx;
+  int r = rados.ioctx_create(pool_name.c_str(), ioctx);
+  if (r < 0) {
+    std::cerr << "failed to open pool " << pool_name << ": "
+	      << cpp_strerror(r) << std::endl;
+    return EXIT_FAILURE;
+  }
+  ioctx.application_enable("rados", true);
+
+  ceph::bufferlist bl;
+  bl.append(std::string(4096, 'x'));
+  for (int i = 0; i < num_objects; ++i) {
+    r = ioctx.write_full(obj_name(i), bl);
+    if (r < 0) {
+      std::cerr << "failed to create " << obj_name(i) << ": "
+		<< cpp_strerror(r) << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  std::cout << "threads\tqueue_depth\tops/sec\tscaling" << std::endl;
+  uint64_t base = 0;
+  for (int t = 1; ; t = std::min(t * 2, max_threads)) {
+    uint64_t iops = run(ioctx, t, queue_depth, num_objects, seconds, write);
+    if (!base) {
+      base = std::max<uint64_t>(iops, 1);
+    }
+    std::cout << t << "\t" << queue_depth << "\t" << iops << "\t"
+	      << (double)iops / base << std::endl;
+    if (t == max_threads) {
+      break;
+    }
+  }
+
+  for (int i = 0; i < num_objects; ++i) {
+    ioctx.remove(obj_name(i));
+  }
+  return 0;
+}
@@ -0,0 +1,202 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "rgw/rgw_cache.h"
+
+#include <set>
+#include <thread>
+
+#include "global/global_context.h"
+#include <gtest/gtest.h>
+
+struct TestChainedCache : public RGWChainedCache {
+  std::set<string> chained;
+  std::set<string> invalidated;
+  int invalidated_all = 0;
+
+  void chain_cb(const string& key, void *data) override {
+    chained.insert(key);
+  }
+  void invalidate(const string& key) override {
+    invalidated.insert(key);
+  }
+  void invalidate_all() override {
+    ++invalidated_all;
+  }
+};
+
+class ObjectCacheTest : public ::testing::Test {
+ protected:
+  ObjectCache cache;
+
+  void SetUp() override {
+    g_ceph_context->_conf.set_val_or_die("rgw_cache_lru_size", "64");
+    cache.set_ctx(g_ceph_context);
+    cache.set_enabled(true);
+  }
+
+  void put(const string& name, const string& data,
+	   rgw_cache_entry_info *cache_info = nullptr) {
+    ObjectCacheInfo info;
+    info.status = 0;
+    info.flags = CACHE_FLAG_DATA;
+    info.data.append(data);
+    cache.put(name, info, cache_info);
+  }
+};
+
+TEST_F(ObjectCacheTest, PutGetRemove)
+{
+  ObjectCacheInfo info;
+  ASSERT_EQ(-ENOENT, cache.get("a", info, CACHE_FLAG_DATA, nullptr));
+
+  put("a", "foo");
+  ASSERT_EQ(0, cache.get("a", info, CACHE_FLAG_DATA, nullptr));
+  ASSERT_EQ("foo", info.data.to_str());
+  // cached, but without the requested xattrs
+  ASSERT_EQ(-ENOENT, cache.get("a", info, CACHE_FLAG_XATTRS, nullptr));
+
+  put("a", "bar");
+  ASSERT_EQ(0, cache.get("a", info, CACHE_FLAG_DATA, nullptr));
+  ASSERT_EQ("bar", info.data.to_str());
+
+  ASSERT_TRUE(cache.remove("a"));
+  ASSERT_FALSE(cache.remove("a"));
+  ASSERT_EQ(-ENOENT, cache.get("a", info, CACHE_FLAG_DATA, nullptr));
+}
+
+TEST_F(ObjectCacheTest, Disabled)
+{
+  put("a", "foo");
+  cache.set_enabled(false);
+  ObjectCacheInfo info;
+  ASSERT_EQ(-ENOENT, cache.get("a", info, CACHE_FLAG_DATA, nullptr));
+  cache.set_enabled(true);
+  // disabling drops everything
+  ASSERT_EQ(-ENOENT, cache.get("a", info, CACHE_FLAG_DATA, nullptr));
+}
+
+TEST_F(ObjectCacheTest, LRUBounded)
+{
+  const int count = 1000;
+  for (int i = 0; i < count; ++i) {
+    put("obj" + std::to_string(i), "x");
+  }
+  int cached = 0;
+  ObjectCacheInfo info;
+  for (int i = 0; i < count; ++i) {
+    if (cache.get("obj" + std::to_string(i), info, 0, nullptr) == 0) {
+      ++cached;
+    }
+  }
+  // each of the 16 shards holds 64/16 entries, plus the one being added
+  ASSERT_GT(cached, 0);
+  ASSERT_LE(cached, 16 * 5);
+  ASSERT_EQ(0, cache.get("obj" + std::to_string(count - 1), info, 0, nullptr));
+}
+
+TEST_F(ObjectCacheTest, ChainedInvalidation)
+{
+  TestChainedCache chained;
+  cache.chain_cache(&chained);
+
+  rgw_cache_entry_info a_info, b_info;
+  put("a", "foo", &a_info);
+  put("b", "bar", &b_info);
+  ObjectCacheInfo info;
+  ASSERT_EQ(0, cache.get("a", info, 0, &a_info));
+  ASSERT_EQ(0, cache.get("b", info, 0, &b_info));
+
+  string key = "user";
+  RGWChainedCache::Entry entry(&chained, key, nullptr);
+  ASSERT_TRUE(cache.chain_cache_entry({&a_info, &b_info}, &entry));
+  ASSERT_EQ(1u, chained.chained.count(key));
+
+  // overwriting either underlying entry invalidates the chained one
+  put("b", "baz");
+  ASSERT_EQ(1u, chained.invalidated.count(key));
+
+  // b_info now refers to a stale generation
+  chained.chained.clear();
+  ASSERT_FALSE(cache.chain_cache_entry({&a_info, &b_info}, &entry));
+  ASSERT_TRUE(chained.chained.empty());
+
+  chained.invalidated.clear();
+  ASSERT_EQ(0, cache.get("b", info, 0, &b_info));
+  ASSERT_TRUE(cache.chain_cache_entry({&a_info, &b_info}, &entry));
+  ASSERT_TRUE(cache.remove("a"));
+  ASSERT_EQ(1u, chained.invalidated.count(key));
+
+  cache.invalidate_all();
+  ASSERT_EQ(1, chained.invalidated_all);
+
+  cache.unchain_cache(&chained);
+}
+
+TEST_F(ObjectCacheTest, Concurrent)
+{
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 8; ++t) {
+    threads.emplace_back([this, t] {
+      ObjectCacheInfo info;
+      for (int i = 0; i < 2000; ++i) {
+	string name = "obj" + std::to_string((t * 31 + i) % 200);
+	switch (i % 4) {
+	case 0:
+	  put(name, name);
+	  break;
+	case 3:
+	  cache.remove(name);
+	  break;
+	default:
+	  if (cache.get(name, info, CACHE_FLAG_DATA, nullptr) == 0) {
+	    ASSERT_EQ(name, info.data.to_str());
+	  }
+	}
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+}
+
+TEST_F(ObjectCacheTest, PutRacesDisable)
+{
+  // large enough that nothing is evicted
+  g_ceph_context->_conf.set_val_or_die("rgw_cache_lru_size", "100000");
+  cache.set_ctx(g_ceph_context);
+
+  for (int round = 0; round < 20; ++round) {
+    std::atomic<bool> stop = { false };
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+      threads.emplace_back([this, t, round, &stop] {
+	for (int i = 0; !stop; i = (i + 1) % 1000) {
+	  string name = "obj" + std::to_string(round) + "." +
+	    std::to_string(t) + "." + std::to_string(i);
+	  put(name, name);
+	}
+      });
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    cache.set_enabled(false);
+    stop = true;
+    for (auto& t : threads) {
+      t.join();
+    }
+    cache.set_enabled(true);
+
+    // no put that started before the cache was disabled may have
+    // inserted anything after it was cleared
+    ObjectCacheInfo info;
+    for (int t = 0; t < 4; ++t) {
+      for (int i = 0; i < 1000; ++i) {
+	string name = "obj" + std::to_string(round) + "." +
+	  std::to_string(t) + "." + std::to_string(i);
+	ASSERT_EQ(-ENOENT, cache.get(name, info, CACHE_FLAG_DATA, nullptr))
+	  << name << " survived set_enabled(false)";
+      }
+    }
+  }
+}
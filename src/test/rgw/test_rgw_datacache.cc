@@ -0,0 +1,145 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "rgw/rgw_common.h"
+#include "rgw/rgw_datacache.h"
+#include "rgw/rgw_perf_counters.h"
+
+#include <chrono>
+#include <system_error>
+#include <thread>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if __has_include(<filesystem>)
+#include <filesystem>
+namespace fs = std::filesystem;
+#elif __has_include(<experimental/filesystem>)
+#include <experimental/filesystem>
+namespace fs = std::experimental::filesystem;
+#else
+#error std::filesystem not available!
+#endif
+
+#include "common/perf_counters.h"
+#include "global/global_context.h"
+#include <gtest/gtest.h>
+
+class DataCache : public ::testing::Test {
+ protected:
+  std::string dir;
+  std::unique_ptr<RGWDataCache> cache;
+
+  void SetUp() override {
+    ASSERT_EQ(0, rgw_perf_start(g_ceph_context));
+    dir = "/tmp/test_rgw_datacache." + std::to_string(getpid());
+    g_ceph_context->_conf.set_val_or_die("rgw_datacache_path", dir);
+    g_ceph_context->_conf.set_val_or_die("rgw_datacache_size", "12288");
+    cache = std::make_unique<RGWDataCache>(g_ceph_context);
+    ASSERT_EQ(0, cache->init());
+  }
+  void TearDown() override {
+    cache.reset();
+    std::error_code ec;
+    fs::remove_all(dir, ec);
+    rgw_perf_stop(g_ceph_context);
+  }
+
+  static bufferlist make_data(char c, size_t len) {
+    bufferlist bl;
+    bl.append(std::string(len, c));
+    return bl;
+  }
+
+  // fills are asynchronous; poll until the entry shows up
+  bool wait_get(const std::string& key, uint64_t len, bufferlist *bl) {
+    for (int i = 0; i < 500; ++i) {
+      if (cache->get(key, len, bl)) {
+	return true;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return false;
+  }
+};
+
+TEST_F(DataCache, Key)
+{
+  rgw_raw_obj obj{rgw_pool{"data"}, "marker__shadow_abc_1"};
+  bufferlist tag1, tag2;
+  tag1.append("tag1");
+  tag2.append("tag2");
+  auto k = RGWDataCache::make_key(obj, tag1, 0, 4096);
+  ASSERT_EQ(k, RGWDataCache::make_key(obj, tag1, 0, 4096));
+  ASSERT_NE(k, RGWDataCache::make_key(obj, tag2, 0, 4096));
+  ASSERT_NE(k, RGWDataCache::make_key(obj, tag1, 4096, 4096));
+  ASSERT_NE(k, RGWDataCache::make_key(obj, tag1, 0, 8192));
+}
+
+TEST_F(DataCache, FillAndHit)
+{
+  bufferlist out;
+  ASSERT_FALSE(cache->get("a", 4096, &out));
+  ASSERT_EQ(1u, perfcounter->get(l_rgw_datacache_miss));
+
+  auto data = make_data('a', 4096);
+  cache->put_async("a", data);
+  ASSERT_TRUE(wait_get("a", 4096, &out));
+  ASSERT_TRUE(out.contents_equal(data));
+  ASSERT_EQ(1u, perfcounter->get(l_rgw_datacache_hit));
+  ASSERT_EQ(4096u, perfcounter->get(l_rgw_datacache_hit_b));
+
+  // a read of a different length is a different entry
+  out.clear();
+  ASSERT_FALSE(cache->get("a", 2048, &out));
+  ASSERT_EQ(0u, out.length());
+}
+
+TEST_F(DataCache, EvictLRU)
+{
+  bufferlist out;
+  for (auto k : {"a", "b", "c"}) {
+    cache->put_async(k, make_data(k[0], 4096));
+    ASSERT_TRUE(wait_get(k, 4096, &out));
+  }
+  // touch "a" so that "b" is the least recently used
+  ASSERT_TRUE(cache->get("a", 4096, &out));
+  cache->put_async("d", make_data('d', 4096));
+  ASSERT_TRUE(wait_get("d", 4096, &out));
+
+  ASSERT_TRUE(cache->get("a", 4096, &out));
+  ASSERT_FALSE(cache->get("b", 4096, &out));
+  ASSERT_TRUE(cache->get("c", 4096, &out));
+  ASSERT_EQ(12288u, perfcounter->get(l_rgw_datacache_size));
+}
+
+TEST_F(DataCache, InitRemovesOnlyCacheFiles)
+{
+  bufferlist out;
+  cache->put_async("a", make_data('a', 4096));
+  ASSERT_TRUE(wait_get("a", 4096, &out));
+  cache.reset();
+
+  std::string digest(64, 'f');
+  bufferlist bl = make_data('x', 16);
+  ASSERT_EQ(0, bl.write_file((dir + "/" + digest + ".tmp").c_str()));
+  ASSERT_EQ(0, bl.write_file((dir + "/" + digest + ".bak").c_str()));
+  ASSERT_EQ(0, bl.write_file((dir + "/other").c_str()));
+  ASSERT_EQ(0, ::mkdir((dir + "/" + digest.substr(1) + "0").c_str(), 0700));
+
+  cache = std::make_unique<RGWDataCache>(g_ceph_context);
+  ASSERT_EQ(0, cache->init());
+  ASSERT_FALSE(cache->get("a", 4096, &out));
+
+  auto exists = [this](const std::string& name) {
+    return ::access((dir + "/" + name).c_str(), F_OK) == 0;
+  };
+  ASSERT_FALSE(exists(digest + ".tmp"));
+  ASSERT_TRUE(exists(digest + ".bak"));
+  ASSERT_TRUE(exists("other"));
+  ASSERT_TRUE(exists(digest.substr(1) + "0"));
+
+  ASSERT_TRUE(RGWDataCache::is_cache_file(digest));
+  ASSERT_FALSE(RGWDataCache::is_cache_file(std::string(64, 'F')));
+  ASSERT_FALSE(RGWDataCache::is_cache_file(digest.substr(1)));
+}
@@ -0,0 +1,250 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "rgw/rgw_gc.h"
+#include "rgw/rgw_aio_throttle.h"
+#include "rgw/rgw_perf_counters.h"
+
+#include <optional>
+#include "cls/refcount/cls_refcount_client.h"
+#include "cls/rgw/cls_rgw_client.h"
+#include "common/perf_counters.h"
+#include "global/global_context.h"
+#include <gtest/gtest.h>
+
+struct RadosEnv : public ::testing::Environment {
+ public:
+  static constexpr auto poolname = "ceph_test_rgw_gc";
+
+  static std::optional<RGWSI_RADOS> rados;
+
+  void SetUp() override {
+    rados.emplace(g_ceph_context);
+    ASSERT_EQ(0, rados->start());
+    int r = rados->pool({poolname}).create();
+    if (r == -EEXIST)
+      r = 0;
+    ASSERT_EQ(0, r);
+    ASSERT_EQ(0, rgw_perf_start(g_ceph_context));
+  }
+  void TearDown() override {
+    rgw_perf_stop(g_ceph_context);
+    rados.reset();
+  }
+};
+std::optional<RGWSI_RADOS> RadosEnv::rados;
+
+auto *const rados_env = ::testing::AddGlobalTestEnvironment(new RadosEnv);
+
+// a gc whose single omap log shard lives in the test pool
+class TestGC : public RGWGC {
+ public:
+  rgw_raw_obj shard_obj;
+
+  explicit TestGC(const std::string& shard_oid)
+    : shard_obj({RadosEnv::poolname}, shard_oid) {
+    transitioned_objects_cache = std::vector<std::atomic<bool>>(1);
+  }
+
+  rgw_raw_obj get_shard_obj(int index) const override { return shard_obj; }
+  int remove(int index, int num_entries) override { return -EOPNOTSUPP; }
+  bool going_down() override { return false; }
+};
+
+// forwards to a throttle, counting the ops actually in flight
+class CountingAio : public rgw::Aio {
+  rgw::BlockingAioThrottle throttle;
+ public:
+  std::atomic<int> submitted = { 0 };
+  std::atomic<int> in_flight = { 0 };
+  std::atomic<int> max_in_flight = { 0 };
+
+  explicit CountingAio(uint64_t window) : throttle(window) {}
+
+  rgw::AioResultList get(const RGWSI_RADOS::Obj& obj, OpFunc&& f,
+			 uint64_t cost, uint64_t id) override {
+    return throttle.get(obj,
+      [this, f = std::move(f)] (rgw::Aio*, rgw::AioResult& r) mutable {
+	++submitted;
+	int n = ++in_flight;
+	int max = max_in_flight;
+	while (n > max && !max_in_flight.compare_exchange_weak(max, n));
+	// complete through put() below
+	std::move(f)(this, r);
+      }, cost, id);
+  }
+  void put(rgw::AioResult& r) override {
+    --in_flight;
+    throttle.put(r);
+  }
+  rgw::AioResultList poll() override { return throttle.poll(); }
+  rgw::AioResultList wait() override { return throttle.wait(); }
+  rgw::AioResultList drain() override { return throttle.drain(); }
+};
+
+class GCIOManager : public ::testing::Test {
+ protected:
+  NoDoutPrefix dpp{g_ceph_context, ceph_subsys_rgw};
+
+  // use the test's name as an oid prefix so different tests don't conflict
+  std::string get_oid(const std::string& suffix) const {
+    return std::string(::testing::UnitTest::GetInstance()->
+		       current_test_info()->name()) + "." + suffix;
+  }
+
+  RGWSI_RADOS::Obj make_obj(const std::string& oid) {
+    auto obj = RadosEnv::rados->obj({{RadosEnv::poolname}, oid});
+    ceph_assert_always(0 == obj.open());
+    return obj;
+  }
+
+  // a tail object of size bytes, referenced by each of refs
+  cls_rgw_obj create_tail(const std::string& oid, uint64_t size,
+			  const std::vector<std::string>& refs = {}) {
+    librados::ObjectWriteOperation op;
+    bufferlist bl;
+    bl.append(std::string(size, 'x'));
+    op.write_full(bl);
+    for (auto& ref : refs) {
+      cls_refcount_get(op, ref);
+    }
+    auto obj = make_obj(oid);
+    ceph_assert_always(0 == obj.operate(&op, null_yield));
+
+    cls_rgw_obj tail;
+    tail.pool = RadosEnv::poolname;
+    tail.key.name = oid;
+    tail.size = size;
+    return tail;
+  }
+
+  bool exists(const std::string& oid) {
+    librados::ObjectReadOperation op;
+    op.stat(nullptr, nullptr, nullptr);
+    return make_obj(oid).operate(&op, nullptr, null_yield) == 0;
+  }
+
+  void add_gc_entry(const std::string& shard_oid, const std::string& tag) {
+    cls_rgw_gc_obj_info info;
+    info.tag = tag;
+    librados::ObjectWriteOperation op;
+    cls_rgw_gc_set_entry(op, 0, info);
+    auto obj = make_obj(shard_oid);
+    ASSERT_EQ(0, obj.operate(&op, null_yield));
+  }
+
+  // the tags still in the omap gc log
+  std::set<std::string> get_gc_tags(const std::string& shard_oid) {
+    std::set<std::string> keys;
+    librados::ObjectReadOperation op;
+    op.omap_get_keys2("", 1000, &keys, nullptr, nullptr);
+    bufferlist bl;
+    make_obj(shard_oid).operate(&op, &bl, null_yield);
+    // every entry is indexed by name as "0_<tag>"
+    std::set<std::string> tags;
+    for (auto& key : keys) {
+      if (key.compare(0, 2, "0_") == 0) {
+	tags.insert(key.substr(2));
+      }
+    }
+    return tags;
+  }
+};
+
+TEST(GCOrderByPG, RoundRobin)
+{
+  std::vector<std::pair<std::string, int>> items = {
+    {"a", 1}, {"b", 1}, {"c", 1}, {"d", 2}, {"e", 3}, {"f", 3},
+  };
+  rgw_gc_order_by_pg(items, [] (const std::pair<std::string, int>& i) {
+      return i.second;
+    });
+
+  std::string order;
+  for (auto& i : items) {
+    order += i.first;
+  }
+  // one from each pg in turn, keeping the order within a pg
+  ASSERT_EQ("adebfc", order);
+}
+
+TEST(GCOrderByPG, PoolAndPG)
+{
+  using PG = std::pair<std::string, uint32_t>;
+  std::vector<PG> items = {
+    {"p1", 0}, {"p1", 0}, {"p2", 0}, {"p1", 1},
+  };
+  rgw_gc_order_by_pg(items, [] (const PG& i) { return i; });
+  ASSERT_EQ((std::vector<PG>{{"p1", 0}, {"p1", 1}, {"p2", 0}, {"p1", 0}}),
+	    items);
+}
+
+TEST_F(GCIOManager, ReclaimOnlyRemoved)
+{
+  TestGC gc(get_oid("gc"));
+  RGWGCIOManager io_manager(&dpp, g_ceph_context, &gc, &*RadosEnv::rados);
+
+  auto removed = create_tail(get_oid("removed"), 4096);
+  auto shared = create_tail(get_oid("shared"), 8192, {"tag", "other"});
+
+  const uint64_t objs = perfcounter->get(l_rgw_gc_reclaim_obj);
+  const uint64_t bytes = perfcounter->get(l_rgw_gc_reclaim_b);
+
+  gc.transitioned_objects_cache[0] = true;
+  ASSERT_EQ(0, io_manager.schedule_io(removed, 0, "tag"));
+  ASSERT_EQ(0, io_manager.schedule_io(shared, 0, "tag"));
+  ASSERT_EQ(0, io_manager.drain_ios());
+
+  ASSERT_FALSE(exists(removed.key.name));
+  ASSERT_TRUE(exists(shared.key.name));
+  // the shared tail only lost a reference
+  ASSERT_EQ(objs + 1, perfcounter->get(l_rgw_gc_reclaim_obj));
+  ASSERT_EQ(bytes + 4096, perfcounter->get(l_rgw_gc_reclaim_b));
+}
+
+TEST_F(GCIOManager, ThrottleAndComplete)
+{
+  const std::string shard_oid = get_oid("gc");
+  TestGC gc(shard_oid);
+  auto aio = std::make_unique<CountingAio>(2);
+  auto& counts = *aio;
+  RGWGCIOManager io_manager(&dpp, g_ceph_context, &gc, &*RadosEnv::rados,
+			    std::move(aio));
+
+  // tag1 has three tails, tag2 one that cannot be removed
+  ASSERT_NO_FATAL_FAILURE(add_gc_entry(shard_oid, "tag1"));
+  ASSERT_NO_FATAL_FAILURE(add_gc_entry(shard_oid, "tag2"));
+  std::vector<cls_rgw_obj> tails;
+  for (int i = 0; i < 3; i++) {
+    tails.push_back(create_tail(get_oid("tail" + std::to_string(i)), 1024));
+  }
+  auto broken = create_tail(get_oid("broken"), 1024);
+  {
+    librados::ObjectWriteOperation op;
+    bufferlist bl;
+    bl.append("not a refcount");
+    op.setxattr("refcount", bl);
+    auto obj = make_obj(broken.key.name);
+    ASSERT_EQ(0, obj.operate(&op, null_yield));
+  }
+
+  io_manager.add_tag_io_size(0, "tag1", tails.size());
+  io_manager.add_tag_io_size(0, "tag2", 1);
+  for (auto& tail : tails) {
+    ASSERT_EQ(0, io_manager.schedule_io(tail, 0, "tag1"));
+  }
+  // errors are only returned for shards using the gc queue
+  ASSERT_EQ(0, io_manager.schedule_io(broken, 0, "tag2"));
+  io_manager.drain();
+
+  // four tail removals and one removal of tags from the log
+  ASSERT_EQ(5, counts.submitted.load());
+  ASSERT_EQ(0, counts.in_flight.load());
+  ASSERT_LE(counts.max_in_flight.load(), 2);
+
+  for (auto& tail : tails) {
+    ASSERT_FALSE(exists(tail.key.name));
+  }
+  ASSERT_TRUE(exists(broken.key.name));
+  ASSERT_EQ(std::set<std::string>{"tag2"}, get_gc_tags(shard_oid));
+}
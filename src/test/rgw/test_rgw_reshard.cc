@@ -66,3 +66,198 @@ TEST(TestRGWReshard, dynamic_reshard_shard_count)
   ASSERT_EQ(499u, RGWBucketReshard::get_preferred_shards(2000, 500));
   ASSERT_EQ(499u, RGWBucketReshard::get_preferred_shards(2001, 500));
 }
+
+static rgw_cls_bi_entry make_bi_entry(const string& idx, BIIndexType type,
+				      const string& name, const string& instance,
+				      uint64_t size)
+{
+  rgw_bucket_dir_entry dir_entry;
+  dir_entry.key = cls_rgw_obj_key(name, instance);
+  dir_entry.exists = true;
+  dir_entry.meta.category = RGWObjCategory::Main;
+  dir_entry.meta.size = size;
+  dir_entry.meta.accounted_size = size;
+
+  rgw_cls_bi_entry entry;
+  entry.type = type;
+  entry.idx = idx;
+  encode(dir_entry, entry.data);
+  return entry;
+}
+
+TEST(TestRGWReshard, plan_replay_overwrite)
+{
+  // the object was overwritten after it was copied
+  list<rgw_cls_bi_entry> copied = {
+    make_bi_entry("obj", BIIndexType::Plain, "obj", "", 100),
+  };
+  list<rgw_cls_bi_entry> current = {
+    make_bi_entry("obj", BIIndexType::Plain, "obj", "", 5000),
+  };
+
+  set<string> removals;
+  map<RGWObjCategory, rgw_bucket_category_stats> unaccounted;
+  RGWBucketReshard::plan_replay(current, copied, &removals, &unaccounted);
+
+  ASSERT_TRUE(removals.empty()) << "overwritten entries aren't removed";
+  ASSERT_EQ(1u, unaccounted.size());
+  auto& stats = unaccounted[RGWObjCategory::Main];
+  ASSERT_EQ(1u, stats.num_entries);
+  ASSERT_EQ(100u, stats.total_size);
+  ASSERT_EQ(4096u, stats.total_size_rounded);
+  ASSERT_EQ(100u, stats.actual_size);
+}
+
+TEST(TestRGWReshard, plan_replay_delete)
+{
+  // a versioned object lost an instance after it was copied
+  list<rgw_cls_bi_entry> copied = {
+    make_bi_entry("obj", BIIndexType::Plain, "obj", "v1", 10),
+    make_bi_entry("1000_obj_v1", BIIndexType::Instance, "obj", "v1", 10),
+    make_bi_entry("1000_obj_v2", BIIndexType::Instance, "obj", "v2", 20),
+  };
+  list<rgw_cls_bi_entry> current = {
+    make_bi_entry("obj", BIIndexType::Plain, "obj", "v1", 10),
+    make_bi_entry("1000_obj_v1", BIIndexType::Instance, "obj", "v1", 10),
+  };
+
+  set<string> removals;
+  map<RGWObjCategory, rgw_bucket_category_stats> unaccounted;
+  RGWBucketReshard::plan_replay(current, copied, &removals, &unaccounted);
+
+  ASSERT_EQ(set<string>{"1000_obj_v2"}, removals);
+  // only the plain entry counts towards the stats
+  auto& stats = unaccounted[RGWObjCategory::Main];
+  ASSERT_EQ(1u, stats.num_entries);
+  ASSERT_EQ(10u, stats.actual_size);
+}
+
+TEST(TestRGWReshard, plan_replay_new_object)
+{
+  // the object was created after the copy went past it
+  list<rgw_cls_bi_entry> copied;
+  list<rgw_cls_bi_entry> current = {
+    make_bi_entry("obj", BIIndexType::Plain, "obj", "", 100),
+  };
+
+  set<string> removals;
+  map<RGWObjCategory, rgw_bucket_category_stats> unaccounted;
+  RGWBucketReshard::plan_replay(current, copied, &removals, &unaccounted);
+
+  ASSERT_TRUE(removals.empty());
+  ASSERT_TRUE(unaccounted.empty());
+
+  // and removed again before the replay
+  RGWBucketReshard::plan_replay(copied, current, &removals, &unaccounted);
+  ASSERT_EQ(set<string>{"obj"}, removals);
+  ASSERT_EQ(1u, unaccounted[RGWObjCategory::Main].num_entries);
+}
+
+TEST(TestRGWReshard, unaccount_stats)
+{
+  map<RGWObjCategory, rgw_bucket_category_stats> stats;
+  auto& main = stats[RGWObjCategory::Main];
+  main.num_entries = 10;
+  main.total_size = 1000;
+  main.total_size_rounded = 40960;
+  main.actual_size = 1000;
+
+  map<RGWObjCategory, rgw_bucket_category_stats> removed;
+  auto& removed_main = removed[RGWObjCategory::Main];
+  removed_main.num_entries = 3;
+  removed_main.total_size = 300;
+  removed_main.total_size_rounded = 12288;
+  removed_main.actual_size = 300;
+
+  RGWBucketReshard::unaccount_stats(stats, removed);
+  ASSERT_EQ(7u, main.num_entries);
+  ASSERT_EQ(700u, main.total_size);
+  ASSERT_EQ(28672u, main.total_size_rounded);
+  ASSERT_EQ(700u, main.actual_size);
+
+  // stats never go below zero, even when the header missed some of
+  // what was removed
+  removed_main.num_entries = 10;
+  removed[RGWObjCategory::MultiMeta].num_entries = 1;
+  RGWBucketReshard::unaccount_stats(stats, removed);
+  ASSERT_EQ(0u, main.num_entries);
+  ASSERT_EQ(400u, main.total_size);
+  ASSERT_EQ(0u, stats[RGWObjCategory::MultiMeta].num_entries);
+}
+
+TEST(TestRGWReshard, checkpoint_encoding)
+{
+  cls_rgw_reshard_entry entry;
+  entry.bucket_name = "bucket";
+  entry.bucket_id = "old";
+  entry.new_instance_id = "bucket:new";
+  entry.new_num_shards = 7;
+  ASSERT_FALSE(entry.has_checkpoint());
+
+  entry.checkpoint_shard = 3;
+  entry.checkpoint_marker = "obj-42";
+  ASSERT_TRUE(entry.has_checkpoint());
+
+  bufferlist bl;
+  encode(entry, bl);
+  cls_rgw_reshard_entry decoded;
+  auto iter = bl.cbegin();
+  decode(decoded, iter);
+  ASSERT_TRUE(decoded.has_checkpoint());
+  ASSERT_EQ(3, decoded.checkpoint_shard);
+  ASSERT_EQ("obj-42", decoded.checkpoint_marker);
+
+  // entries queued by older radosgws have no progress to resume from
+  bufferlist v1;
+  ENCODE_START(1, 1, v1);
+  encode(entry.time, v1);
+  encode(entry.tenant, v1);
+  encode(entry.bucket_name, v1);
+  encode(entry.bucket_id, v1);
+  encode(entry.new_instance_id, v1);
+  encode(entry.old_num_shards, v1);
+  encode(entry.new_num_shards, v1);
+  ENCODE_FINISH(v1);
+  iter = v1.cbegin();
+  decode(decoded, iter);
+  ASSERT_FALSE(decoded.has_checkpoint());
+  ASSERT_EQ("bucket:new", decoded.new_instance_id);
+}
+
+TEST(TestRGWReshard, check_resume)
+{
+  RGWBucketInfo bucket_info;
+  bucket_info.bucket.name = "bucket";
+  bucket_info.bucket.bucket_id = "old";
+  bucket_info.new_bucket_instance_id = "new";
+
+  cls_rgw_reshard_entry entry;
+  entry.new_instance_id = "bucket:new";
+  entry.checkpoint_shard = 0;
+
+  list<cls_rgw_bucket_instance_entry> status(3);
+  for (auto& s : status) {
+    s.set_status("new", 7, CLS_RGW_RESHARD_IN_LOGRECORD);
+  }
+  ASSERT_EQ(0, RGWBucketReshard::check_resume(entry, bucket_info, status));
+
+  // a reshard that stopped with writes blocked is resumed too
+  status.back().set_status("new", 7, CLS_RGW_RESHARD_IN_PROGRESS);
+  ASSERT_EQ(0, RGWBucketReshard::check_resume(entry, bucket_info, status));
+
+  // a shard whose reshard was cancelled no longer logs writes
+  status.back().clear();
+  ASSERT_EQ(-ESTALE, RGWBucketReshard::check_resume(entry, bucket_info, status));
+  status.back().set_status("other", 7, CLS_RGW_RESHARD_IN_LOGRECORD);
+  ASSERT_EQ(-ESTALE, RGWBucketReshard::check_resume(entry, bucket_info, status));
+  status.back().set_status("new", 7, CLS_RGW_RESHARD_IN_LOGRECORD);
+
+  // the saved progress is for another reshard of the bucket
+  entry.new_instance_id = "bucket:older";
+  ASSERT_EQ(-ENOENT, RGWBucketReshard::check_resume(entry, bucket_info, status));
+  entry.new_instance_id = "bucket:new";
+
+  // no progress was saved
+  entry.checkpoint_shard = -1;
+  ASSERT_EQ(-ENOENT, RGWBucketReshard::check_resume(entry, bucket_info, status));
+}
@@ -81,6 +81,7 @@ TYPE(SequencerPosition)
 #ifdef WITH_BLUESTORE
 #include "os/bluestore/bluestore_types.h"
 TYPE(bluestore_bdev_label_t)
+TYPE(bluestore_alloc_snapshot_t)
 TYPE(bluestore_cnode_t)
 TYPE(bluestore_compression_header_t)
 TYPE(bluestore_extent_ref_map_t)
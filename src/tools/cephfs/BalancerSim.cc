@@ -0,0 +1,503 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ */
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+#include "common/ceph_json.h"
+
+#include "BalancerSim.h"
+
+
+void BalancerSim::usage()
+{
+  std::cout << "Usage: \n"
+    << "  cephfs-balancer-sim [options] [-v] <history file>\n"
+    << "\n"
+    << "Replays MDS load histories through the balancer policy.  The history\n"
+    << "is a series of 'dump loads' outputs in JSON, one per line, collected\n"
+    << "from every active rank in turn, e.g.\n"
+    << "\n"
+    << "  while sleep 10; do\n"
+    << "    for r in 0 1 2; do\n"
+    << "      ceph tell mds.<fs>:$r dump loads --format=json >> history\n"
+    << "      echo >> history\n"
+    << "    done\n"
+    << "  done\n"
+    << "\n"
+    << "Balancer options such as --mds_bal_mode, --mds_bal_min_rebalance,\n"
+    << "--mds_bal_migration_cost and --mds_bal_min_residency are taken from\n"
+    << "the command line or configuration as usual.\n"
+    << "\n"
+    << "  -v, --verbose   print loads and migrations for every round\n"
+    << std::endl;
+}
+
+static double json_double(JSONObj *obj, const char *name, double def = 0)
+{
+  JSONObj *o = obj->find_obj(name);
+  if (!o)
+    return def;
+  return strtod(o->get_data().c_str(), nullptr);
+}
+
+int BalancerSim::decode_dump(JSONObj *obj, Round *round, int *rank)
+{
+  if (JSONObj *loads = obj->find_obj("loads"))
+    obj = loads;
+
+  JSONObj *r = obj->find_obj("rank");
+  JSONObj *dfs = obj->find_obj("dirfrags");
+  if (!r || !dfs) {
+    std::cerr << "dump has no rank or dirfrags, is the MDS too old?"
+	      << std::endl;
+    return -EINVAL;
+  }
+  *rank = atoi(r->get_data().c_str());
+  round->stamp = json_double(obj, "stamp");
+  round->ranks.insert(*rank);
+
+  const char *metric = mode == 3 ? "cost_load" : "meta_load";
+  for (auto it = dfs->find_first(); !it.end(); ++it) {
+    JSONObj *dir = *it;
+    bool is_auth = false;
+    JSONDecoder::decode_json("is_auth", is_auth, dir);
+    if (!is_auth)
+      continue;
+
+    std::string path;
+    JSONDecoder::decode_json("path", path, dir);
+    if (path.empty())
+      path = "/";
+    else if (path[0] != '/')
+      continue;  // mdsdir and strays are never migrated
+
+    uint64_t num_dentries = 0;
+    JSONDecoder::decode_json("num_dentries", num_dentries, dir);
+
+    round->load[path] += json_double(dir, metric);
+    round->dentries[path] += num_dentries;
+    round->auth[path] = *rank;
+  }
+  return 0;
+}
+
+int BalancerSim::load_history(const std::string &path,
+			      std::vector<Round> *rounds)
+{
+  std::ifstream in(path);
+  if (!in.is_open()) {
+    std::cerr << "cannot open " << path << std::endl;
+    return -ENOENT;
+  }
+
+  Round round;
+  std::string line;
+  unsigned n = 0;
+  while (std::getline(in, line)) {
+    n++;
+    if (line.find_first_not_of(" \t\r") == std::string::npos)
+      continue;
+
+    JSONParser p;
+    if (!p.parse(line.c_str(), line.length())) {
+      std::cerr << path << ":" << n << ": cannot parse JSON" << std::endl;
+      return -EINVAL;
+    }
+
+    Round sample;
+    int rank;
+    int r;
+    try {
+      r = decode_dump(&p, &sample, &rank);
+    } catch (const JSONDecoder::err &e) {
+      std::cerr << path << ":" << n << ": " << e.what() << std::endl;
+      return -EINVAL;
+    }
+    if (r < 0)
+      return r;
+
+    // a rank repeating starts the next round
+    if (round.ranks.count(rank)) {
+      rounds->push_back(std::move(round));
+      round = Round();
+    }
+    if (round.ranks.empty())
+      round.stamp = sample.stamp;
+    round.ranks.insert(rank);
+    for (const auto &l : sample.load)
+      round.load[l.first] += l.second;
+    for (const auto &d : sample.dentries)
+      round.dentries[d.first] += d.second;
+    for (const auto &a : sample.auth)
+      round.auth[a.first] = a.second;
+  }
+  if (!round.ranks.empty())
+    rounds->push_back(std::move(round));
+  return 0;
+}
+
+std::string BalancerSim::parent_path(const std::string &path)
+{
+  if (path == "/")
+    return std::string();
+  auto pos = path.rfind('/');
+  if (pos == 0)
+    return "/";
+  return path.substr(0, pos);
+}
+
+bool BalancerSim::is_descendant(const std::string &path,
+				const std::string &of) const
+{
+  if (of == "/")
+    return path != "/";
+  return path.size() > of.size() &&
+    path.compare(0, of.size(), of) == 0 &&
+    path[of.size()] == '/';
+}
+
+const std::string& BalancerSim::placement_root(const std::string &path) const
+{
+  for (std::string p = path; !p.empty(); p = parent_path(p)) {
+    auto it = dirs.find(p);
+    if (it != dirs.end() && it->second.subtree_root)
+      return it->first;
+  }
+  return dirs.begin()->first;
+}
+
+void BalancerSim::place_new_dirs(const Round &round)
+{
+  // parents sort before their children
+  for (const auto &p : round.auth) {
+    if (dirs.count(p.first))
+      continue;
+
+    Dir &dir = dirs[p.first];
+    const Dir *parent = nullptr;
+    for (std::string pp = parent_path(p.first); !pp.empty();
+	 pp = parent_path(pp)) {
+      auto it = dirs.find(pp);
+      if (it != dirs.end()) {
+	parent = &it->second;
+	break;
+      }
+    }
+
+    if (!parent) {
+      dir.rank = p.second;
+      dir.subtree_root = true;
+    } else if (round_no == 1) {
+      // start from the placement the cluster actually had
+      dir.rank = p.second;
+      dir.subtree_root = (p.second != parent->rank);
+    } else {
+      dir.rank = parent->rank;
+    }
+  }
+}
+
+double BalancerSim::subtree_load(const Round &round, const std::string &root,
+				 uint64_t *dentries) const
+{
+  const std::string &proot = placement_root(root);
+  double load = 0;
+  for (auto it = dirs.find(root); it != dirs.end(); ++it) {
+    if (it->first != root && !is_descendant(it->first, root))
+      continue;
+    if (it->first != root && placement_root(it->first) != proot)
+      continue;  // a nested subtree, placed on its own
+    auto l = round.load.find(it->first);
+    if (l != round.load.end())
+      load += l->second;
+  }
+  auto d = round.dentries.find(root);
+  *dentries = d == round.dentries.end() ? 0 : d->second;
+  return load;
+}
+
+void BalancerSim::migrate(const std::string &root, int target, double stamp)
+{
+  const std::string proot = placement_root(root);
+  for (auto &p : dirs) {
+    if (p.first == root || !is_descendant(p.first, root))
+      continue;
+    if (placement_root(p.first) == proot)
+      p.second.rank = target;
+  }
+
+  Dir &dir = dirs[root];
+  if (dir.last_rank == target)
+    stats.bounces++;
+  dir.last_rank = dir.rank;
+  dir.rank = target;
+  dir.subtree_root = true;
+  dir.import_stamp = stamp;
+}
+
+bool BalancerSim::may_export(const Round &round, const std::string &path,
+			     double load) const
+{
+  if (mode != 3)
+    return true;
+  const Dir &dir = dirs.at(path);
+  if (dir.subtree_root && dir.import_stamp >= 0 &&
+      !model.may_reexport(round.stamp - dir.import_stamp))
+    return false;
+  auto d = round.dentries.find(path);
+  return model.worth_migrating(load,
+			       d == round.dentries.end() ? 0 : d->second);
+}
+
+void BalancerSim::export_dir(const Round &round, const std::string &path,
+			     int from, int target)
+{
+  uint64_t dentries;
+  double load = subtree_load(round, path, &dentries);
+  if (verbose)
+    *verbose << "  move " << path << " (load " << load << ") mds."
+	     << from << " -> mds." << target << std::endl;
+  migrate(path, target, round.stamp);
+  stats.migrations++;
+  stats.migration_cost += model.get_migration_cost(dentries);
+}
+
+void BalancerSim::find_exports(const Round &round, const std::string &path,
+			       int from, int target, double amount,
+			       double &have)
+{
+  if (!model.wants_exports(amount, have))
+    return;
+
+  double minchunk = model.get_minchunk(amount, have);
+  std::vector<BalancerCostModel::ExportCandidate<std::string>> candidates;
+  for (const auto &p : dirs) {
+    if (p.first == "/" || parent_path(p.first) != path ||
+	p.second.rank != from)
+      continue;
+    uint64_t dentries;
+    double load = subtree_load(round, p.first, &dentries);
+    if (load < minchunk || !may_export(round, p.first, load))
+      continue;
+    candidates.push_back({load, p.first, false});
+  }
+
+  model.choose_exports(
+    amount, have, candidates,
+    [&](const std::string &dir, double) {
+      export_dir(round, dir, from, target);
+    },
+    [&](const std::string &dir) {
+      find_exports(round, dir, from, target, amount, have);
+    });
+}
+
+void BalancerSim::try_rebalance(const Round &round, int rank,
+				const std::map<int, double> &targets,
+				double target_load)
+{
+  // the subtrees this rank holds, as MDBalancer::try_rebalance lists
+  // its imports
+  std::multimap<double, std::string> import_pop_map;
+  std::multimap<int, std::pair<std::string, double>> import_from_map;
+  for (const auto &p : dirs) {
+    if (!p.second.subtree_root || p.second.rank != rank)
+      continue;
+    if (mode == 3 && p.second.import_stamp >= 0 &&
+	!model.may_reexport(round.stamp - p.second.import_stamp))
+      continue;
+    uint64_t dentries;
+    double load = subtree_load(round, p.first, &dentries);
+    int from = p.first == "/" ? rank :
+      dirs.at(placement_root(parent_path(p.first))).rank;
+    import_pop_map.emplace(load, p.first);
+    import_from_map.emplace(from, std::make_pair(p.first, load));
+  }
+
+  auto forget_import = [&](const std::string &path, double load) {
+    for (auto q = import_pop_map.equal_range(load); q.first != q.second;
+	 ++q.first) {
+      if (q.first->second == path) {
+	import_pop_map.erase(q.first);
+	break;
+      }
+    }
+  };
+
+  // first hand back what was imported from the target
+  std::map<int, double> export_pop_map;
+  for (const auto &t : targets) {
+    int target = t.first;
+    double amount = t.second;
+    if (amount < BalancerCostModel::MIN_OFFLOAD)
+      continue;
+    if (amount * 10 * targets.size() < target_load)
+      continue;
+
+    double &have = export_pop_map[target];
+    for (auto p = import_from_map.equal_range(target);
+	 p.first != p.second; ) {
+      auto plast = p.first++;
+      const std::string path = plast->second.first;
+      double load = plast->second.second;
+      if (path == "/")
+	continue;
+      if (load <= amount - have && may_export(round, path, load)) {
+	export_dir(round, path, rank, target);
+	have += load;
+	import_from_map.erase(plast);
+	forget_import(path, load);
+      }
+      if (amount - have < BalancerCostModel::MIN_OFFLOAD)
+	break;
+    }
+  }
+
+  // then any other imports
+  for (const auto &t : targets) {
+    int target = t.first;
+    double amount = t.second;
+    if (!export_pop_map.count(target))
+      continue;
+    double &have = export_pop_map[target];
+    if (amount - have < BalancerCostModel::MIN_OFFLOAD)
+      continue;
+
+    for (auto p = import_pop_map.begin(); p != import_pop_map.end(); ) {
+      const std::string path = p->second;
+      double load = p->first;
+      if (path != "/" && load <= amount - have &&
+	  load > BalancerCostModel::MIN_REEXPORT &&
+	  may_export(round, path, load)) {
+	export_dir(round, path, rank, target);
+	have += load;
+	import_pop_map.erase(p++);
+      } else {
+	++p;
+      }
+      if (amount - have < BalancerCostModel::MIN_OFFLOAD)
+	break;
+    }
+  }
+
+  // and finally search the biggest imports for pieces of their load
+  for (const auto &t : targets) {
+    int target = t.first;
+    double amount = t.second;
+    if (!export_pop_map.count(target))
+      continue;
+    double &have = export_pop_map[target];
+    if (amount - have < BalancerCostModel::MIN_OFFLOAD)
+      continue;
+
+    for (auto p = import_pop_map.rbegin(); p != import_pop_map.rend(); ++p) {
+      if (dirs.at(p->second).rank != rank)
+	continue;  // exported to an earlier target
+      find_exports(round, p->second, rank, target, amount, have);
+      if (amount - have < BalancerCostModel::MIN_OFFLOAD)
+	break;
+    }
+  }
+}
+
+void BalancerSim::balance(const Round &round, std::map<int, double> &loads)
+{
+  double total = 0;
+  for (const auto &p : loads)
+    total += p.second;
+  double target_load = total / loads.size();
+
+  std::multimap<double, int> exporters, importers;
+  for (const auto &p : loads) {
+    if (p.second < target_load * (1.0 + min_rebalance))
+      last_round_under[p.first] = round_no;
+    if (p.second < target_load)
+      importers.insert(std::make_pair(p.second, p.first));
+    else if (model.overloaded_long_enough(last_round_under[p.first], round_no))
+      exporters.insert(std::make_pair(p.second, p.first));
+  }
+
+  // big exporters to big importers, as MDBalancer::prep_rebalance does
+  std::map<int, std::map<int, double>> targets;
+  std::map<int, double> exported, imported;
+  auto ex = exporters.rbegin();
+  auto im = importers.begin();
+  while (ex != exporters.rend() && im != importers.end()) {
+    double maxex = loads[ex->second] - target_load - exported[ex->second];
+    double maxim = target_load - loads[im->second] - imported[im->second];
+    if (maxex < .001 || maxim < .001)
+      break;
+    double amount = std::min(maxex, maxim);
+    targets[ex->second][im->second] += amount;
+    exported[ex->second] += amount;
+    imported[im->second] += amount;
+    if (maxex - amount <= .001)
+      ++ex;
+    if (maxim - amount <= .001)
+      ++im;
+  }
+
+  for (const auto &t : targets) {
+    if (last_round_under[t.first] == round_no)
+      continue;  // only overloaded ranks act on their targets
+    try_rebalance(round, t.first, t.second, target_load);
+  }
+}
+
+static double imbalance(const std::map<int, double> &loads)
+{
+  double total = 0, max = 0;
+  for (const auto &p : loads) {
+    total += p.second;
+    max = std::max(max, p.second);
+  }
+  if (total <= 0)
+    return 1.0;
+  return max / (total / loads.size());
+}
+
+void BalancerSim::run(const std::vector<Round> &rounds)
+{
+  for (const auto &round : rounds) {
+    round_no++;
+    stats.rounds++;
+    place_new_dirs(round);
+
+    std::map<int, double> loads, actual;
+    for (int rank : round.ranks) {
+      loads[rank] = 0;
+      actual[rank] = 0;
+    }
+    for (const auto &p : round.load) {
+      loads[dirs[p.first].rank] += p.second;
+      actual[round.auth.at(p.first)] += p.second;
+    }
+
+    double sim_imb = imbalance(loads);
+    double actual_imb = imbalance(actual);
+    stats.imbalance_sum += sim_imb;
+    stats.actual_imbalance_sum += actual_imb;
+
+    if (verbose) {
+      *verbose << "round " << round_no << " stamp " << round.stamp
+	       << " loads";
+      for (const auto &p : loads)
+	*verbose << " mds." << p.first << "=" << p.second;
+      *verbose << " imbalance " << sim_imb << " (actual " << actual_imb
+	       << ")" << std::endl;
+    }
+
+    if (loads.size() > 1)
+      balance(round, loads);
+  }
+}
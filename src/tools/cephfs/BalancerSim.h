@@ -0,0 +1,123 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ */
+
+#ifndef CEPHFS_BALANCER_SIM_H
+#define CEPHFS_BALANCER_SIM_H
+
+#include <iosfwd>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "mds/BalancerCostModel.h"
+
+class JSONObj;
+
+/**
+ * Offline replay of MDS load histories through the balancer policy.
+ *
+ * The input is a series of "dump loads" outputs, one JSON document per
+ * line, taken from every active rank in turn.  A round ends when a rank
+ * repeats.  Each round, the simulator works out what each rank's load
+ * would have been under its own placement of directories, runs the
+ * balancer policy over those loads, and moves directories accordingly.
+ *
+ * Directories are the unit of placement: the fragments of a directory
+ * are added together and always move as one.  A directory moves with
+ * its parent unless it has been migrated on its own.
+ *
+ * Each overloaded rank then acts as MDBalancer::try_rebalance would:
+ * it hands back imports to the rank they came from, then exports other
+ * imports, then searches its subtrees with the same choose_exports()
+ * the MDS uses.  What the replay cannot see, it leaves out:
+ *  - exporters are only matched big to big; the MDS also matches them
+ *    to the ranks they imported from, and alternates with small to big
+ *  - no directory is replicated, frozen, pinned or idle, so none is
+ *    skipped or exported back for those reasons
+ *  - subdirectories are searched in path order rather than in the
+ *    order the MDS last saw them used
+ *  - migrations take effect at once, with the load they were chosen for
+ */
+class BalancerSim
+{
+public:
+  struct Round {
+    double stamp = 0;
+    std::set<int> ranks;
+    std::map<std::string, double> load;       ///< path -> own load
+    std::map<std::string, uint64_t> dentries; ///< path -> cached dentries
+    std::map<std::string, int> auth;          ///< path -> actual auth rank
+  };
+
+  struct Stats {
+    unsigned rounds = 0;
+    unsigned migrations = 0;
+    unsigned bounces = 0;       ///< moves back to the rank a dir just left
+    double migration_cost = 0;
+    double imbalance_sum = 0;   ///< sum over rounds of max / mean load
+    double actual_imbalance_sum = 0;
+  };
+
+  BalancerSim(const BalancerCostModel &model, int mode, double min_rebalance,
+	      std::ostream *verbose)
+    : model(model), mode(mode), min_rebalance(min_rebalance),
+      verbose(verbose) {}
+
+  static void usage();
+
+  /// read a history file into rounds
+  int load_history(const std::string &path, std::vector<Round> *rounds);
+
+  void run(const std::vector<Round> &rounds);
+  const Stats& get_stats() const { return stats; }
+
+private:
+  struct Dir {
+    int rank = -1;
+    bool subtree_root = false;  ///< placed on its own, not with its parent
+    double import_stamp = -1;
+    int last_rank = -1;         ///< where it was before the last move
+  };
+
+  const BalancerCostModel model;
+  const int mode;
+  const double min_rebalance;
+  std::ostream *verbose;
+
+  std::map<std::string, Dir> dirs;
+  std::map<int, unsigned> last_round_under;
+  unsigned round_no = 0;
+  Stats stats;
+
+  int decode_dump(JSONObj *obj, Round *round, int *rank);
+
+  static std::string parent_path(const std::string &path);
+  bool is_descendant(const std::string &path, const std::string &of) const;
+  const std::string& placement_root(const std::string &path) const;
+
+  void place_new_dirs(const Round &round);
+  double subtree_load(const Round &round, const std::string &root,
+		      uint64_t *dentries) const;
+  void migrate(const std::string &root, int target, double stamp);
+  bool may_export(const Round &round, const std::string &path,
+		  double load) const;
+  void export_dir(const Round &round, const std::string &path,
+		  int from, int target);
+  void find_exports(const Round &round, const std::string &path,
+		    int from, int target, double amount, double &have);
+  void try_rebalance(const Round &round, int rank,
+		     const std::map<int, double> &targets,
+		     double target_load);
+  void balance(const Round &round, std::map<int, double> &loads);
+};
+
+#endif // CEPHFS_BALANCER_SIM_H
@@ -0,0 +1,76 @@
+#include "include/types.h"
+#include "common/config.h"
+#include "common/ceph_argparse.h"
+#include "common/errno.h"
+#include "global/global_context.h"
+#include "global/global_init.h"
+
+#include "BalancerSim.h"
+
+
+int main(int argc, const char **argv)
+{
+  vector<const char*> args;
+  argv_to_vec(argc, argv, args);
+
+  if (args.empty()) {
+    cerr << argv[0] << ": -h or --help for usage" << std::endl;
+    exit(1);
+  }
+  if (ceph_argparse_need_usage(args)) {
+    BalancerSim::usage();
+    exit(0);
+  }
+
+  auto cct = global_init(NULL, args, CEPH_ENTITY_TYPE_CLIENT,
+                         CODE_ENVIRONMENT_UTILITY,
+                         CINIT_FLAG_NO_MON_CONFIG);
+  common_init_finish(g_ceph_context);
+
+  bool verbose = false;
+  std::string history;
+  for (auto i = args.begin(); i != args.end(); ) {
+    if (ceph_argparse_flag(args, i, "-v", "--verbose", (char*)NULL)) {
+      verbose = true;
+    } else if (history.empty()) {
+      history = *i++;
+    } else {
+      BalancerSim::usage();
+      exit(1);
+    }
+  }
+  if (history.empty()) {
+    BalancerSim::usage();
+    exit(1);
+  }
+
+  BalancerCostModel model;
+  model.update(g_conf());
+  BalancerSim sim(model, g_conf()->mds_bal_mode,
+                  g_conf()->mds_bal_min_rebalance,
+                  verbose ? &std::cout : nullptr);
+
+  std::vector<BalancerSim::Round> rounds;
+  int r = sim.load_history(history, &rounds);
+  if (r < 0) {
+    std::cerr << "Error loading " << history << ": " << cpp_strerror(r)
+              << std::endl;
+    return 1;
+  }
+
+  sim.run(rounds);
+
+  const auto &stats = sim.get_stats();
+  std::cout << "rounds: " << stats.rounds << std::endl;
+  std::cout << "migrations: " << stats.migrations << " ("
+            << stats.bounces << " back to the rank a directory had just left)"
+            << std::endl;
+  std::cout << "migration cost: " << stats.migration_cost << std::endl;
+  if (stats.rounds) {
+    std::cout << "mean imbalance (max / mean rank load): "
+              << stats.imbalance_sum / stats.rounds << " simulated, "
+              << stats.actual_imbalance_sum / stats.rounds << " actual"
+              << std::endl;
+  }
+  return 0;
+}
@@ -64,7 +64,9 @@ static void format_op_features(Formatter *f, uint64_t op_features)
     {RBD_OPERATION_FEATURE_CLONE_PARENT, RBD_OPERATION_FEATURE_NAME_CLONE_PARENT},
     {RBD_OPERATION_FEATURE_CLONE_CHILD, RBD_OPERATION_FEATURE_NAME_CLONE_CHILD},
     {RBD_OPERATION_FEATURE_GROUP, RBD_OPERATION_FEATURE_NAME_GROUP},
-    {RBD_OPERATION_FEATURE_SNAP_TRASH, RBD_OPERATION_FEATURE_NAME_SNAP_TRASH}};
+    {RBD_OPERATION_FEATURE_SNAP_TRASH, RBD_OPERATION_FEATURE_NAME_SNAP_TRASH},
+    {RBD_OPERATION_FEATURE_DIRTY_BLOCKS,
+     RBD_OPERATION_FEATURE_NAME_DIRTY_BLOCKS}};
   format_bitmask(f, "op_feature", mapping, op_features);
 }
 